@@ -43,6 +43,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #include <zlib.h>
 
 #include <memory>
+#include <algorithm>
 
 #ifdef OSX_EMBEDED_MODE
 #include "Alta.h"
@@ -80,6 +81,65 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 static std::unique_ptr<ApogeeCCD> apogeeCCD(new ApogeeCCD());
 
+// Image sequences run by the camera through libapogee. The frames are read
+// one by one as the camera finishes them, not in bulk at the end, and the
+// camera goes back to single bulk downloads when the sequence is over.
+class ApogeeCamSequenceIo : public ApogeeSequenceIo
+{
+    public:
+        explicit ApogeeCamSequenceIo(ApogeeCam *cam) : cam(cam) {}
+
+        void start(uint16_t count, double duration, double delay, bool light) override
+        {
+            if (!armed)
+            {
+                bulkDownload  = cam->IsBulkDownloadOn();
+                sequenceDelay = cam->GetSequenceDelay();
+                armed         = true;
+            }
+            cam->SetBulkDownload(false);
+            cam->SetImageCount(count);
+            cam->SetSequenceDelay(delay);
+            cam->StartExposure(duration, light);
+        }
+        double delay() override
+        {
+            // Raised to the shortest delay the camera supports
+            return cam->GetSequenceDelay();
+        }
+        double readout() override
+        {
+            return 0;
+        }
+        uint16_t completed() override
+        {
+            return cam->GetImgSequenceCount();
+        }
+        void download(uint16_t *image, size_t numPixels) override
+        {
+            cam->GetImage(image, numPixels);
+        }
+        void abort() override
+        {
+            cam->StopExposure(false);
+        }
+        void restore() override
+        {
+            if (!armed)
+                return;
+            armed = false;
+            cam->SetImageCount(1);
+            cam->SetSequenceDelay(sequenceDelay);
+            cam->SetBulkDownload(bulkDownload);
+        }
+
+    private:
+        ApogeeCam *cam;
+        bool armed {false};
+        bool bulkDownload {true};
+        double sequenceDelay {0};
+};
+
 void ISGetProperties(const char *dev)
 {
     apogeeCCD->ISGetProperties(dev);
@@ -178,6 +238,11 @@ bool ApogeeCCD::initProperties()
     IUFillSwitchVector(&FilterTypeSP, FilterTypeS, 5, getDeviceName(), "FILTER_TYPE", "Type", FILTER_TAB, IP_RW,
                        ISR_1OFMANY, 0, IPS_IDLE);
 
+    IUFillNumber(&SequenceN[SEQ_COUNT], "SEQ_COUNT", "Frames", "%.f", 1, 65535, 1, 1);
+    IUFillNumber(&SequenceN[SEQ_DELAY], "SEQ_DELAY", "Delay (s)", "%.3f", 0, 60, 0.1, 0);
+    IUFillNumberVector(&SequenceNP, SequenceN, 2, getDeviceName(), "CCD_SEQUENCE", "Sequence", MAIN_CONTROL_TAB, IP_RW,
+                       60, IPS_IDLE);
+
     INDI::FilterInterface::initProperties(FILTER_TAB);
 
     setDriverInterface(getDriverInterface() | FILTER_INTERFACE);
@@ -212,6 +277,7 @@ bool ApogeeCCD::updateProperties()
         defineNumber(&CoolerNP);
         defineSwitch(&ReadOutSP);
         defineSwitch(&FanStatusSP);
+        defineNumber(&SequenceNP);
         getCameraParams();
 
         if (cfwFound)
@@ -229,6 +295,7 @@ bool ApogeeCCD::updateProperties()
         deleteProperty(ReadOutSP.name);
         deleteProperty(CamInfoTP.name);
         deleteProperty(FanStatusSP.name);
+        deleteProperty(SequenceNP.name);
 
         if (cfwFound)
         {
@@ -535,6 +602,23 @@ bool ApogeeCCD::ISNewNumber(const char *dev, const char *name, double values[],
             INDI::FilterInterface::processNumber(dev, name, values, names, n);
             return true;
         }
+
+        // Sequence
+        if (!strcmp(name, SequenceNP.name))
+        {
+            if (sequence.active())
+            {
+                LOG_ERROR("Cannot change the sequence while it is running.");
+                SequenceNP.s = IPS_ALERT;
+                IDSetNumber(&SequenceNP, nullptr);
+                return false;
+            }
+
+            IUUpdateNumber(&SequenceNP, values, names, n);
+            SequenceNP.s = IPS_OK;
+            IDSetNumber(&SequenceNP, nullptr);
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewNumber(dev, name, values, names, n);
@@ -542,6 +626,12 @@ bool ApogeeCCD::ISNewNumber(const char *dev, const char *name, double values[],
 
 bool ApogeeCCD::StartExposure(float duration)
 {
+    if (sequence.active())
+    {
+        LOG_ERROR("Cannot start an exposure while a sequence is running.");
+        return false;
+    }
+
     ExposureRequest = duration;
 
     imageFrameType = PrimaryCCD.getFrameType();
@@ -552,6 +642,9 @@ bool ApogeeCCD::StartExposure(float duration)
         LOGF_INFO("Bias Frame (s) : %.3f", ExposureRequest);
     }
 
+    if (SequenceN[SEQ_COUNT].value > 1)
+        return startSequence();
+
     if (isSimulation() == false)
         ApgCam->SetImageCount(1);
 
@@ -600,7 +693,9 @@ bool ApogeeCCD::AbortExposure()
 {
     try
     {
-        if (isSimulation() == false)
+        if (sequence.active())
+            sequence.abort();
+        else if (isSimulation() == false)
             ApgCam->StopExposure(false);
     }
     catch (std::runtime_error &err)
@@ -609,10 +704,108 @@ bool ApogeeCCD::AbortExposure()
         return false;
     }
 
+    if (SequenceNP.s == IPS_BUSY)
+    {
+        SequenceNP.s = IPS_IDLE;
+        IDSetNumber(&SequenceNP, nullptr);
+    }
+
     InExposure = false;
     return true;
 }
 
+bool ApogeeCCD::startSequence()
+{
+    int count = static_cast<int>(SequenceN[SEQ_COUNT].value);
+    bool light = (imageFrameType == INDI::CCDChip::LIGHT_FRAME || imageFrameType == INDI::CCDChip::FLAT_FRAME);
+
+    if (isSimulation())
+        sequenceIo.reset(new ApogeeSimSequenceIo());
+    else
+        sequenceIo.reset(new ApogeeCamSequenceIo(ApgCam.get()));
+    sequence.setIo(sequenceIo.get());
+
+    try
+    {
+        sequence.start(count, ExposureRequest, SequenceN[SEQ_DELAY].value, light);
+    }
+    catch (std::runtime_error &err)
+    {
+        LOGF_ERROR("Starting the sequence failed. %s.", err.what());
+        SequenceNP.s = IPS_ALERT;
+        IDSetNumber(&SequenceNP, nullptr);
+        return false;
+    }
+
+    // The camera may have raised the delay to its minimum
+    SequenceN[SEQ_DELAY].value = sequence.frameDelay();
+
+    PrimaryCCD.setExposureDuration(ExposureRequest);
+    gettimeofday(&ExpStart, nullptr);
+    LOGF_INFO("Taking a sequence of %d frames of %g seconds...", count, ExposureRequest);
+
+    SequenceNP.s = IPS_BUSY;
+    IDSetNumber(&SequenceNP, nullptr);
+
+    InExposure = true;
+    return true;
+}
+
+// Sends out every frame the camera finished since the last poll, each one as
+// its own image.
+void ApogeeCCD::downloadSequence()
+{
+    uint16_t *image = reinterpret_cast<uint16_t*>(PrimaryCCD.getFrameBuffer());
+
+    try
+    {
+        for (int ready = sequence.poll(); ready > 0; ready--)
+        {
+            std::unique_lock<std::mutex> guard(ccdBufferLock);
+            sequenceFrame = sequence.download(image, PrimaryCCD.getFrameBufferSize() / sizeof(uint16_t));
+            guard.unlock();
+
+            LOGF_DEBUG("Sequence frame %d of %d downloaded.", sequenceFrame + 1, sequence.frames());
+            ExposureComplete(&PrimaryCCD);
+        }
+    }
+    catch (std::runtime_error &err)
+    {
+        LOGF_ERROR("Sequence download failed. %s.", err.what());
+        try
+        {
+            sequence.abort();
+        }
+        catch (std::runtime_error &) {}
+
+        sequenceFrame = -1;
+        InExposure    = false;
+        PrimaryCCD.setExposureFailed();
+        SequenceNP.s = IPS_ALERT;
+        IDSetNumber(&SequenceNP, nullptr);
+        return;
+    }
+
+    sequenceFrame = -1;
+
+    if (sequence.active())
+    {
+        PrimaryCCD.setExposureLeft(sequence.timeLeft());
+        return;
+    }
+
+    LOGF_INFO("Sequence of %d frames complete.", sequence.frames());
+    InExposure   = false;
+    SequenceNP.s = IPS_OK;
+    IDSetNumber(&SequenceNP, nullptr);
+}
+
+// Poll twice per frame during sequences, never slower than usual
+int ApogeeCCD::sequencePollMs() const
+{
+    return std::max(10, std::min<int>(POLLMS, sequence.period() * 500));
+}
+
 float ApogeeCCD::CalcTimeLeft(timeval start, float req)
 {
     double timesince;
@@ -719,7 +912,6 @@ bool ApogeeCCD::UpdateCCDBin(int binx, int biny)
 
 int ApogeeCCD::grabImage()
 {
-    std::vector<uint16_t> pImageData;
     uint16_t *image = reinterpret_cast<uint16_t*>(PrimaryCCD.getFrameBuffer());
 
     try
@@ -733,10 +925,10 @@ int ApogeeCCD::grabImage()
         }
         else
         {
-            ApgCam->GetImage(pImageData);
+            // Reorder straight into the frame buffer, no copy of the image on the way
+            ApgCam->GetImage(image, PrimaryCCD.getFrameBufferSize() / sizeof(uint16_t));
             imageWidth  = ApgCam->GetRoiNumCols();
             imageHeight = ApgCam->GetRoiNumRows();
-            copy(pImageData.begin(), pImageData.end(), image);
         }
         guard.unlock();
     }
@@ -1241,6 +1433,12 @@ bool ApogeeCCD::Disconnect()
 {
     try
     {
+        if (sequence.active())
+            sequence.abort();
+        // Back to bulk downloads, even if a sequence failed half way
+        if (sequenceIo)
+            sequenceIo->restore();
+
         if (isSimulation() == false)
         {
             ApgCam->CloseConnection();
@@ -1303,7 +1501,18 @@ void ApogeeCCD::TimerHit()
     if (isConnected() == false)
         return;
 
-    if (InExposure)
+    if (sequence.active())
+    {
+        downloadSequence();
+
+        // Keep up with the frames, the temperature and cooler can wait for the usual period
+        if (sequence.active() && CalcTimeLeft(StatusPollTime, POLLMS / 1000.0) > 0)
+        {
+            timerID = SetTimer(sequencePollMs());
+            return;
+        }
+    }
+    else if (InExposure)
     {
         timeleft = CalcTimeLeft(ExpStart, ExposureRequest);
 
@@ -1334,6 +1543,8 @@ void ApogeeCCD::TimerHit()
         }
     }
 
+    gettimeofday(&StatusPollTime, nullptr);
+
     switch (TemperatureNP.s)
     {
         case IPS_IDLE:
@@ -1471,7 +1682,7 @@ void ApogeeCCD::TimerHit()
         }
     }
 
-    SetTimer(POLLMS);
+    timerID = SetTimer(sequence.active() ? sequencePollMs() : POLLMS);
     return;
 }
 
@@ -1486,6 +1697,7 @@ bool ApogeeCCD::saveConfigItems(FILE *fp)
 
     IUSaveConfigSwitch(fp, &PortTypeSP);
     IUSaveConfigText(fp, &NetworkInfoTP);
+    IUSaveConfigNumber(fp, &SequenceNP);
     if (FanStatusSP.s != IPS_ALERT)
         IUSaveConfigSwitch(fp, &FanStatusSP);
 
@@ -1499,6 +1711,36 @@ bool ApogeeCCD::saveConfigItems(FILE *fp)
     return true;
 }
 
+void ApogeeCCD::addFITSKeywords(fitsfile *fptr, INDI::CCDChip *targetChip)
+{
+    INDI::CCD::addFITSKeywords(fptr, targetChip);
+
+    if (sequenceFrame < 0)
+        return;
+
+    // The base class only knows when the sequence was requested, the sequence
+    // counter tells when each frame was taken.
+    double start = sequence.startedAt(sequenceFrame);
+    time_t t     = static_cast<time_t>(start);
+    long us      = lround((start - t) * 1e6);
+    if (us >= 1000000)
+    {
+        t++;
+        us -= 1000000;
+    }
+
+    char iso8601[32], dateObs[40];
+    strftime(iso8601, sizeof(iso8601), "%Y-%m-%dT%H:%M:%S", gmtime(&t));
+    snprintf(dateObs, sizeof(dateObs), "%s.%06ld", iso8601, us);
+
+    int status = 0;
+    int frame  = sequenceFrame + 1;
+    int frames = sequence.frames();
+    fits_update_key_str(fptr, "DATE-OBS", dateObs, "UTC start, within readout + one poll", &status);
+    fits_update_key_s(fptr, TINT, "SEQFRAME", &frame, "Frame number in the camera sequence", &status);
+    fits_update_key_s(fptr, TINT, "SEQCOUNT", &frames, "Frames in the camera sequence", &status);
+}
+
 int ApogeeCCD::QueryFilter()
 {
     try
@@ -30,6 +30,8 @@
 #include "FindDeviceEthernet.h"
 #include "FindDeviceUsb.h"
 
+#include "apogee_sequence.h"
+
 class ApogeeCCD : public INDI::CCD, public INDI::FilterInterface
 {
     public:
@@ -65,6 +67,8 @@ class ApogeeCCD : public INDI::CCD, public INDI::FilterInterface
         virtual bool SelectFilter(int) override;
         virtual int QueryFilter() override;
 
+        virtual void addFITSKeywords(fitsfile *fptr, INDI::CCDChip *targetChip) override;
+
     private:
         std::unique_ptr<ApogeeCam> ApgCam;
         std::unique_ptr<ApogeeFilterWheel> ApgCFW;
@@ -128,6 +132,15 @@ class ApogeeCCD : public INDI::CCD, public INDI::FilterInterface
             INFO_FIRMWARE,
         };
 
+        // On-camera image sequence
+        INumberVectorProperty SequenceNP;
+        INumber SequenceN[2];
+        enum
+        {
+            SEQ_COUNT,
+            SEQ_DELAY
+        };
+
         double minDuration;
         double ExposureRequest;
         int imageWidth, imageHeight;
@@ -135,6 +148,12 @@ class ApogeeCCD : public INDI::CCD, public INDI::FilterInterface
         bool cameraFound {false}, cfwFound {false};
         INDI::CCDChip::CCD_FRAME imageFrameType;
         struct timeval ExpStart;
+        struct timeval StatusPollTime;
+
+        std::unique_ptr<ApogeeSequenceIo> sequenceIo;
+        ApogeeSequence sequence;
+        // Frame of the sequence being sent, -1 outside of sequences
+        int sequenceFrame {-1};
 
         std::string ioInterface;
         std::string subnet;
@@ -162,6 +181,9 @@ class ApogeeCCD : public INDI::CCD, public INDI::FilterInterface
 
         float CalcTimeLeft(timeval, float);
         int grabImage();
+        bool startSequence();
+        void downloadSequence();
+        int sequencePollMs() const;
         bool getCameraParams();
         void activateCooler(bool enable);
 };
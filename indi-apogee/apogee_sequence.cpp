@@ -0,0 +1,189 @@
+/*
+    Apogee CCD
+    INDI Driver for Apogee CCDs and Filter Wheels
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "apogee_sequence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+// Shortest sequence delay of the Alta cameras, the camera raises shorter ones to it
+#define SEQUENCE_DELAY_MIN 327e-6
+
+static double utcNow()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/* ApogeeSimSequenceIo */
+
+ApogeeSimSequenceIo::ApogeeSimSequenceIo(double readout, double rate) : readoutTime(readout), rate(rate)
+{
+}
+
+void ApogeeSimSequenceIo::start(uint16_t count, double duration, double delay, bool light)
+{
+    (void)light;
+
+    if (running)
+        throw std::runtime_error("Simulated sequence already running");
+
+    this->count         = count;
+    this->duration      = duration;
+    this->sequenceDelay = std::max(delay, SEQUENCE_DELAY_MIN);
+    this->downloaded    = 0;
+    this->started       = Clock::now();
+    this->running       = true;
+}
+
+uint16_t ApogeeSimSequenceIo::completed()
+{
+    if (!running && downloaded == 0)
+        return 0;
+
+    // The next exposure starts once the frame is read out and the delay is over
+    double period  = duration + readoutTime + sequenceDelay;
+    double elapsed = std::chrono::duration<double>(Clock::now() - started).count() - duration - readoutTime;
+
+    if (elapsed < 0)
+        return 0;
+    if (period <= 0)
+        return count;
+
+    return static_cast<uint16_t>(std::min<double>(count, std::floor(elapsed / period) + 1));
+}
+
+void ApogeeSimSequenceIo::download(uint16_t *image, size_t numPixels)
+{
+    if (!running || downloaded >= completed())
+        throw std::runtime_error("No simulated frame ready");
+
+    if (rate > 0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(numPixels * sizeof(uint16_t) / rate));
+
+    for (size_t i = 0; i < numPixels; i++)
+        image[i] = static_cast<uint16_t>((i % 4096) * 8 + downloaded * 64);
+    if (numPixels > 0)
+        image[0] = downloaded;
+
+    if (++downloaded == count)
+        running = false;
+}
+
+void ApogeeSimSequenceIo::abort()
+{
+    running    = false;
+    downloaded = 0;
+}
+
+/* ApogeeSequence */
+
+ApogeeSequence::ApogeeSequence(ApogeeSequenceIo *io) : io(io)
+{
+}
+
+void ApogeeSequence::start(uint16_t count, double duration, double delay, bool light)
+{
+    try
+    {
+        io->start(count, duration, delay, light);
+        this->delay = io->delay();
+        readout     = io->readout();
+    }
+    catch (std::runtime_error &)
+    {
+        io->restore();
+        throw;
+    }
+
+    this->count      = count;
+    this->duration   = duration;
+    this->downloaded = 0;
+    stamps.clear();
+    stamps.reserve(count);
+    begun    = utcNow();
+    lastPoll = begun;
+    running  = true;
+}
+
+int ApogeeSequence::poll()
+{
+    if (!running)
+        return 0;
+
+    double now = utcNow();
+    int done   = std::min<int>(io->completed(), count);
+
+    // A camera that cannot tell its readout time shows it with the first frames
+    if (stamps.empty() && done > 0 && io->readout() <= 0)
+        readout = std::max(0.0, (now - begun - duration - (done - 1) * (duration + delay)) / done);
+
+    for (int i = stamps.size(); i < done; i++)
+        stamps.push_back(std::max(lastPoll, now - (done - 1 - i) * period()));
+    lastPoll = now;
+
+    return static_cast<int>(stamps.size()) - downloaded;
+}
+
+int ApogeeSequence::download(uint16_t *image, size_t numPixels)
+{
+    if (!running)
+        throw std::runtime_error("No image sequence in progress");
+
+    if (downloaded >= static_cast<int>(stamps.size()) && poll() <= 0)
+        throw std::runtime_error("No sequence frame ready");
+
+    io->download(image, numPixels);
+
+    int frame = downloaded++;
+    if (downloaded == count)
+        finish();
+    return frame;
+}
+
+void ApogeeSequence::abort()
+{
+    if (!running)
+        return;
+
+    running = false;
+    try
+    {
+        io->abort();
+    }
+    catch (std::runtime_error &)
+    {
+        io->restore();
+        throw;
+    }
+    io->restore();
+}
+
+void ApogeeSequence::finish()
+{
+    running = false;
+    io->restore();
+}
+
+double ApogeeSequence::timeLeft() const
+{
+    double due = begun + duration + readout + stamps.size() * period();
+    return std::max(0.0, due - utcNow());
+}
@@ -0,0 +1,160 @@
+/*
+    Apogee CCD
+    INDI Driver for Apogee CCDs and Filter Wheels
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Camera side of an on-camera image sequence. Errors are reported with
+// std::runtime_error, as libapogee does.
+class ApogeeSequenceIo
+{
+    public:
+        virtual ~ApogeeSequenceIo() = default;
+
+        // Arm the camera for count frames of duration seconds, delay seconds apart.
+        // The delay runs from the end of one readout to the next exposure.
+        virtual void start(uint16_t count, double duration, double delay, bool light) = 0;
+        // Delay the camera applied, which may be longer than the one asked for
+        virtual double delay() = 0;
+        // Seconds the camera takes to read a frame out, 0 if it cannot tell
+        virtual double readout() = 0;
+        // Number of frames the camera has finished, from its sequence counter
+        virtual uint16_t completed() = 0;
+        // Download the oldest frame not downloaded yet
+        virtual void download(uint16_t *image, size_t numPixels) = 0;
+        virtual void abort() = 0;
+        // Put back the settings start() changed, once the sequence ended or was aborted
+        virtual void restore() = 0;
+};
+
+// Stands in for the camera when there is none. Frames complete on the
+// clock, as the camera would run them, and hold a gradient whose first
+// pixel is the frame number.
+class ApogeeSimSequenceIo : public ApogeeSequenceIo
+{
+    public:
+        // readout: seconds to digitize a frame, rate: download speed in bytes per
+        // second, 0 for instant downloads
+        explicit ApogeeSimSequenceIo(double readout = 0.05, double rate = 0);
+
+        void start(uint16_t count, double duration, double delay, bool light) override;
+        double delay() override
+        {
+            return sequenceDelay;
+        }
+        double readout() override
+        {
+            return readoutTime;
+        }
+        uint16_t completed() override;
+        void download(uint16_t *image, size_t numPixels) override;
+        void abort() override;
+        void restore() override {}
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        double readoutTime;
+        double rate;
+        Clock::time_point started;
+        double duration {0}, sequenceDelay {0};
+        uint16_t count {0};
+        uint16_t downloaded {0};
+        bool running {false};
+};
+
+// Runs an N frame sequence on the camera and hands the frames out as the
+// sequence counter reports them done, instead of one exposure, poll and
+// download round trip per frame.
+class ApogeeSequence
+{
+    public:
+        explicit ApogeeSequence(ApogeeSequenceIo *io = nullptr);
+
+        void setIo(ApogeeSequenceIo *io)
+        {
+            this->io = io;
+        }
+
+        void start(uint16_t count, double duration, double delay, bool light);
+
+        // Reads the sequence counter and timestamps the frames done since the
+        // last poll. Returns the number of frames waiting to be downloaded.
+        int poll();
+
+        // Downloads the oldest frame done. Returns its number, counting from 0.
+        int download(uint16_t *image, size_t numPixels);
+
+        void abort();
+
+        bool active() const
+        {
+            return running;
+        }
+        int frames() const
+        {
+            return count;
+        }
+        int downloadedFrames() const
+        {
+            return downloaded;
+        }
+        // Delay between frames the camera applied
+        double frameDelay() const
+        {
+            return delay;
+        }
+        // Seconds from one frame to the next: exposure, readout and the delay the
+        // camera applied
+        double period() const
+        {
+            return duration + readout + delay;
+        }
+        // Seconds until the next frame is due, from the sequence timing
+        double timeLeft() const;
+
+        // UTC, in seconds since the epoch, at which the counter showed the frame
+        // done. Frames counted in the same poll are spread back from it one
+        // frame period apart, so the stamp is late by up to one poll interval.
+        double completedAt(int frame) const
+        {
+            return stamps[frame];
+        }
+        // Estimated UTC start of the exposure of the frame, within the readout
+        // time plus one poll interval
+        double startedAt(int frame) const
+        {
+            return stamps[frame] - readout - duration;
+        }
+
+    private:
+        void finish();
+
+        ApogeeSequenceIo *io;
+        std::vector<double> stamps;
+        double duration {0}, delay {0}, readout {0};
+        double begun {0}, lastPoll {0};
+        int count {0};
+        int downloaded {0};
+        bool running {false};
+};
@@ -0,0 +1,223 @@
+/*
+    Apogee CCD
+    INDI Driver for Apogee CCDs and Filter Wheels
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+ * Checks ApogeeSequence against the simulated camera, then compares a run
+ * of short exposures taken one exposure, poll and download at a time with
+ * the same run as an on-camera sequence:
+ *
+ *     apogee_sequence_check [frames] [exposure s] [poll ms]
+ *
+ * The simulated camera reads out in 10 ms and downloads 1024x1024 frames
+ * at 40 MB/s, about what an Alta U does on USB 2.0.
+ */
+
+#include "apogee_sequence.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#define READOUT   0.01
+#define USB_RATE  40e6
+#define WIDTH     1024
+#define HEIGHT    1024
+
+typedef std::chrono::steady_clock Clock;
+
+static double utcNow()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void sleepMs(double ms)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+/* Runs a sequence to the end, polling every pollMs, and checks the frames
+ * come out once each, in order, with increasing timestamps.
+ */
+static bool runSequence(const char *name, ApogeeSequenceIo &io, int count, double exposure, double delay,
+                        double pollMs, std::vector<uint16_t> &image)
+{
+    ApogeeSequence sequence(&io);
+    double t0 = utcNow();
+    sequence.start(count, exposure, delay, true);
+
+    int expected = 0;
+    while (sequence.active())
+    {
+        sleepMs(pollMs);
+        for (int ready = sequence.poll(); ready > 0; ready--)
+        {
+            int frame = sequence.download(image.data(), image.size());
+            if (frame != expected || image[0] != frame)
+            {
+                fprintf(stderr, "%s: got frame %d (pixel %d) instead of %d\n", name, frame, image[0], expected);
+                return false;
+            }
+            if (frame > 0 && sequence.completedAt(frame) <= sequence.completedAt(frame - 1))
+            {
+                fprintf(stderr, "%s: frame %d stamped %.6f, not after frame %d at %.6f\n", name, frame,
+                        sequence.completedAt(frame), frame - 1, sequence.completedAt(frame - 1));
+                return false;
+            }
+            expected++;
+        }
+    }
+
+    if (expected != count)
+    {
+        fprintf(stderr, "%s: %d frames of %d downloaded\n", name, expected, count);
+        return false;
+    }
+
+    double span   = sequence.completedAt(count - 1) - sequence.completedAt(0);
+    double period = exposure + READOUT + std::max(delay, 327e-6);
+
+    // The estimated exposure starts may be late by up to one poll interval
+    double worst = 0;
+    for (int frame = 0; frame < count; frame++)
+    {
+        double error = sequence.startedAt(frame) - (t0 + frame * period);
+        if (std::fabs(error) > std::fabs(worst))
+            worst = error;
+    }
+    printf("%s: %d frames in order, %.1f ms apart (camera period %.1f ms), start stamps off by %.1f ms at most\n",
+           name, count, 1000 * span / (count - 1), 1000 * period, 1000 * worst);
+    if (worst < -0.002 || worst > (pollMs + 5) / 1000)
+    {
+        fprintf(stderr, "%s: start stamps off by more than one %g ms poll\n", name, pollMs);
+        return false;
+    }
+
+    // The sequence timing has to follow the camera, or the stamps of frames
+    // counted in the same poll drift from when they were taken
+    if (std::fabs(sequence.period() - period) > 1e-9)
+    {
+        fprintf(stderr, "%s: sequence period %.3f ms, camera %.3f ms\n", name, 1000 * sequence.period(),
+                1000 * period);
+        return false;
+    }
+    return true;
+}
+
+static bool checkAbort(std::vector<uint16_t> &image)
+{
+    ApogeeSimSequenceIo io(READOUT);
+    ApogeeSequence sequence(&io);
+
+    sequence.start(10, 0.01, 0, true);
+    while (sequence.poll() < 1)
+        sleepMs(1);
+    sequence.download(image.data(), image.size());
+    sequence.abort();
+
+    if (sequence.active() || sequence.poll() != 0)
+    {
+        fprintf(stderr, "abort: sequence still running\n");
+        return false;
+    }
+    try
+    {
+        sequence.download(image.data(), image.size());
+        fprintf(stderr, "abort: frame downloaded after the abort\n");
+        return false;
+    }
+    catch (std::runtime_error &)
+    {
+    }
+
+    // The camera can be armed again straight away
+    return runSequence("restart", io, 3, 0.01, 0, 1, image);
+}
+
+/* What the driver does without sequences: expose, poll until the frame is
+ * ready, download it, and start over.
+ */
+static double singleFrames(int frames, double exposure, double pollMs, std::vector<uint16_t> &image)
+{
+    ApogeeSimSequenceIo io(READOUT, USB_RATE);
+    Clock::time_point start = Clock::now();
+
+    for (int i = 0; i < frames; i++)
+    {
+        io.start(1, exposure, 0, true);
+        do
+            sleepMs(pollMs);
+        while (io.completed() < 1);
+        io.download(image.data(), image.size());
+    }
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double sequenceFrames(int frames, double exposure, double pollMs, std::vector<uint16_t> &image)
+{
+    ApogeeSimSequenceIo io(READOUT, USB_RATE);
+    ApogeeSequence sequence(&io);
+    Clock::time_point start = Clock::now();
+
+    sequence.start(frames, exposure, 0, true);
+    while (sequence.active())
+    {
+        sleepMs(pollMs);
+        for (int ready = sequence.poll(); ready > 0; ready--)
+            sequence.download(image.data(), image.size());
+    }
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int frames      = argc > 1 ? atoi(argv[1]) : 50;
+    double exposure = argc > 2 ? atof(argv[2]) : 0.01;
+    double pollMs   = argc > 3 ? atof(argv[3]) : 50;
+
+    std::vector<uint16_t> image(WIDTH * HEIGHT);
+    bool ok = true;
+
+    {
+        ApogeeSimSequenceIo io(READOUT);
+        ok = runSequence("fast poll", io, 8, 0.02, 0.01, 2, image) && ok;
+    }
+    {
+        // Several frames finish between two polls
+        ApogeeSimSequenceIo io(READOUT);
+        ok = runSequence("slow poll", io, 12, 0.005, 0, 40, image) && ok;
+    }
+    ok = checkAbort(image) && ok;
+
+    if (!ok)
+        return 1;
+
+    double single   = singleFrames(frames, exposure, pollMs, image);
+    double sequence = sequenceFrames(frames, exposure, pollMs, image);
+    printf("%d frames of %g s, %g ms poll: single %.1f frames/s, sequence %.1f frames/s\n", frames, exposure, pollMs,
+           frames / single, frames / sequence);
+
+    return 0;
+}
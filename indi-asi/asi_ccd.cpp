@@ -21,6 +21,7 @@
 */
 
 #include "asi_ccd.h"
+#include "asi_rgb.h"
 
 #include "config.h"
 
@@ -38,7 +39,10 @@
 #define TEMP_THRESHOLD          .25  /* Differential temperature threshold (C)*/
 #define MAX_DEVICES             4    /* Max device cameraCount */
 
+#define STATS_TIMER_MS          1000 /* Streaming statistics refresh time (ms) */
+
 #define CONTROL_TAB "Controls"
+#define STREAMING_TAB "Streaming"
 
 //#define USE_SIMULATION
 
@@ -243,6 +247,13 @@ bool ASICCD::initProperties()
     IUFillText(&SDKVersionS[0], "VERSION", "Version", ASIGetSDKVersion());
     IUFillTextVector(&SDKVersionSP, SDKVersionS, 1, getDeviceName(), "SDK", "SDK", INFO_TAB, IP_RO, 60, IPS_IDLE);
 
+    IUFillNumber(&StreamStatsN[STATS_CAPTURED], "CAPTURED", "Captured frames", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&StreamStatsN[STATS_DROPPED], "DROPPED", "Dropped frames", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&StreamStatsN[STATS_LATENCY_AVG], "LATENCY_AVG", "Avg. latency (ms)", "%.2f", 0, 1e6, 0, 0);
+    IUFillNumber(&StreamStatsN[STATS_LATENCY_MAX], "LATENCY_MAX", "Max. latency (ms)", "%.2f", 0, 1e6, 0, 0);
+    IUFillNumberVector(&StreamStatsNP, StreamStatsN, NARRAY(StreamStatsN), getDeviceName(), "STREAM_STATS", "Stream Stats",
+                       STREAMING_TAB, IP_RO, 60, IPS_IDLE);
+
     int maxBin = 1;
 
     for (const auto &supportedBin: m_camInfo->SupportedBins)
@@ -349,6 +360,7 @@ bool ASICCD::updateProperties()
 
         defineNumber(&ADCDepthNP);
         defineText(&SDKVersionSP);
+        defineNumber(&StreamStatsNP);
     }
     else
     {
@@ -372,6 +384,7 @@ bool ASICCD::updateProperties()
         deleteProperty(BlinkNP.name);
         deleteProperty(SDKVersionSP.name);
         deleteProperty(ADCDepthNP.name);
+        deleteProperty(StreamStatsNP.name);
     }
 
     return true;
@@ -1209,38 +1222,23 @@ int ASICCD::grabImage()
 
     if (type == ASI_IMG_RGB24)
     {
-        buffer = static_cast<uint8_t *>(malloc(nTotalBytes));
-        if (buffer == nullptr)
-        {
-            LOGF_ERROR("%s: %d malloc failed (RGB 24)", getDeviceName());
-            return -1;
-        }
+        // Reuse the same scratch buffer for every exposure
+        if (m_RGBBuffer.size() < nTotalBytes)
+            m_RGBBuffer.resize(nTotalBytes);
+        buffer = m_RGBBuffer.data();
     }
 
     if ((errCode = ASIGetDataAfterExp(m_camInfo->CameraID, buffer, nTotalBytes)) != ASI_SUCCESS)
     {
         LOGF_ERROR("ASIGetDataAfterExp (%dx%d #%d channels) error (%d)", subW, subH, nChannels,
                    errCode);
-        if (type == ASI_IMG_RGB24)
-            free(buffer);
         return -1;
     }
 
     if (type == ASI_IMG_RGB24)
     {
-        uint8_t *subR = image;
-        uint8_t *subG = image + subW * subH;
-        uint8_t *subB = image + subW * subH * 2;
-        uint32_t nPixels = subW * subH * 3 - 3;
-
-        for (uint32_t i = 0; i <= nPixels; i += 3)
-        {
-            *subB++ = buffer[i];
-            *subG++ = buffer[i + 1];
-            *subR++ = buffer[i + 2];
-        }
-
-        free(buffer);
+        size_t nPixels = subW * subH;
+        ASIRGB::bgrToPlanarRGB(buffer, image, image + nPixels, image + nPixels * 2, nPixels);
     }
     guard.unlock();
 
@@ -1832,10 +1830,23 @@ void ASICCD::waitUntil(ImageState request)
     cv.wait(lock, [this, request] {return threadState == request;});
 }
 
+/*
+ * Producer side of video streaming. Frames are read from the SDK straight into
+ * a free slot of the frame ring, so the SDK read loop never waits for the
+ * streamer or recorder. If the stream thread falls behind, the frame is read
+ * into the overflow slot and counted as dropped.
+ */
 void ASICCD::streamVideo()
 {
-    //int ret;
-    //int frames = 0;
+    {
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        m_FrameRing.clear();
+        m_FrameRing.reserve(PrimaryCCD.getFrameBufferSize());
+    }
+
+    StreamStatsNP.s = IPS_BUSY;
+    m_StreamActive = true;
+    m_StreamThread = std::thread(&ASICCD::streamFrames, this);
 
     std::unique_lock<std::mutex> lock(condMutex);
 
@@ -1844,11 +1855,21 @@ void ASICCD::streamVideo()
         lock.unlock();
 
         std::unique_lock<std::mutex> guard(ccdBufferLock);
-        uint8_t *targetFrame = PrimaryCCD.getFrameBuffer();
         uint32_t totalBytes  = PrimaryCCD.getFrameBufferSize();
-        int waitMS           = static_cast<int>((ExposureRequest * 2000.0) + 500);
+        guard.unlock();
+
+        // Frame grew while streaming, let the stream thread drain the ring before reallocating.
+        if (totalBytes > m_FrameRing.frameSize())
+        {
+            while (m_FrameRing.empty() == false)
+                usleep(1000);
+            m_FrameRing.reserve(totalBytes);
+        }
+
+        int waitMS = static_cast<int>((ExposureRequest * 2000.0) + 500);
 
-        int ret = ASIGetVideoData(m_camInfo->CameraID, targetFrame, totalBytes, waitMS);
+        ASIFrameRing::Frame &frame = m_FrameRing.acquireWrite();
+        int ret = ASIGetVideoData(m_camInfo->CameraID, frame.data.data(), totalBytes, waitMS);
         if (ret != ASI_SUCCESS)
         {
             if (ret != ASI_ERROR_TIMEOUT)
@@ -1864,35 +1885,74 @@ void ASICCD::streamVideo()
             }
             else
             {
-                //frames = 0;
                 usleep(100);
             }
         }
         else
         {
-            if (currentVideoFormat == ASI_IMG_RGB24)
-                for (uint32_t i = 0; i < totalBytes; i += 3)
-                    std::swap(targetFrame[i], targetFrame[i + 2]);
+            m_FrameRing.commitWrite(totalBytes);
+        }
+
+        lock.lock();
+    }
+
+    lock.unlock();
 
-            guard.unlock();
+    m_StreamActive = false;
+    m_FrameRing.wakeAll();
+    m_StreamThread.join();
+
+    StreamStatsNP.s = IPS_IDLE;
+    updateStreamStats();
+
+    if (m_FrameRing.dropped() > 0)
+        LOGF_INFO("Stream finished: %llu frames captured, %llu dropped.",
+                  static_cast<unsigned long long>(m_FrameRing.captured() + m_FrameRing.dropped()),
+                  static_cast<unsigned long long>(m_FrameRing.dropped()));
+}
+
+/*
+ * Consumer side of video streaming. Runs on its own thread so that slow
+ * encoding or recording only ever delays this thread, never the SDK read loop.
+ */
+void ASICCD::streamFrames()
+{
+    auto lastStats = ASIFrameRing::Clock::now();
+
+    while (m_StreamActive)
+    {
+        ASIFrameRing::Frame *frame = m_FrameRing.acquireRead(std::chrono::milliseconds(100));
+        if (frame != nullptr)
+        {
+            uint8_t *targetFrame = frame->data.data();
+            uint32_t totalBytes  = frame->size;
+
+            if (currentVideoFormat == ASI_IMG_RGB24)
+                ASIRGB::bgrToRGB(targetFrame, totalBytes / 3);
 
             Streamer->newFrame(targetFrame, totalBytes);
 
-            //            /*
-            //             * Release the CPU every 30 frames
-            //             */
-            //            frames++;
-            //            if (frames == 30)
-            //            {
-            //                frames = 0;
-            //                usleep(10);
-            //            }
+            m_FrameRing.releaseRead();
         }
 
-        lock.lock();
+        auto now = ASIFrameRing::Clock::now();
+        if (now - lastStats >= std::chrono::milliseconds(STATS_TIMER_MS))
+        {
+            lastStats = now;
+            updateStreamStats();
+        }
     }
 }
 
+void ASICCD::updateStreamStats()
+{
+    StreamStatsN[STATS_CAPTURED].value    = m_FrameRing.captured() + m_FrameRing.dropped();
+    StreamStatsN[STATS_DROPPED].value     = m_FrameRing.dropped();
+    StreamStatsN[STATS_LATENCY_AVG].value = m_FrameRing.averageLatency();
+    StreamStatsN[STATS_LATENCY_MAX].value = m_FrameRing.maximumLatency();
+    IDSetNumber(&StreamStatsNP, nullptr);
+}
+
 void ASICCD::getExposure()
 {
     int statRetry = 0;
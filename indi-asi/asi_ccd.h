@@ -24,6 +24,8 @@
 
 #include <ASICamera2.h>
 
+#include "asi_frame_ring.h"
+
 #include <vector>
 
 #include <condition_variable>
@@ -89,6 +91,9 @@ class ASICCD : public INDI::CCD
         static void *imagingHelper(void *context);
         void *imagingThreadEntry();
         void streamVideo();
+        /** Consumer side of the video frame ring, hands captured frames over to the streamer */
+        void streamFrames();
+        void updateStreamStats();
         void getExposure();
         void exposureSetRequest(ImageState request);
 
@@ -172,6 +177,17 @@ class ASICCD : public INDI::CCD
         IText SDKVersionS[1] = {};
         ITextVectorProperty SDKVersionSP;
 
+        enum
+        {
+            STATS_CAPTURED,
+            STATS_DROPPED,
+            STATS_LATENCY_AVG,
+            STATS_LATENCY_MAX
+        };
+
+        INumber StreamStatsN[4];
+        INumberVectorProperty StreamStatsNP;
+
         struct timeval ExpStart;
         double ExposureRequest;
         double TemperatureRequest;
@@ -194,6 +210,12 @@ class ASICCD : public INDI::CCD
         std::mutex condMutex;
         std::condition_variable cv;
 
+        // Video frames are captured into the ring by the imaging thread
+        // and delivered to the streamer by the stream thread.
+        ASIFrameRing m_FrameRing;
+        std::thread m_StreamThread;
+        std::atomic<bool> m_StreamActive {false};
+
         // ST4
         float WEPulseRequest;
         struct timeval WEPulseStart;
@@ -207,6 +229,9 @@ class ASICCD : public INDI::CCD
         ASI_GUIDE_DIRECTION NSDir;
         const char *NSDirName;
 
+        // Scratch buffer for RGB24 downloads, converted into the planar frame buffer
+        std::vector<uint8_t> m_RGBBuffer;
+
         // Camera ROI
         uint32_t m_SubX = 0, m_SubY = 0, m_SubW = 0, m_SubH = 0;
 
@@ -0,0 +1,214 @@
+/*
+ ASI CCD Driver - Video frame ring
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief The ASIFrameRing class is a single producer / single consumer pool of preallocated
+ * video frames. The capture thread fills the slot at the head while the streaming thread
+ * consumes the slot at the tail. Slots are handed over through atomic indices, so neither
+ * side ever waits on the other while copying pixels. The mutex and condition variable are
+ * only used to park an idle consumer.
+ *
+ * When all slots are in use the producer receives the overflow slot instead. The frame
+ * read into it is discarded and counted as dropped, which keeps the SDK queue drained.
+ */
+class ASIFrameRing
+{
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Frame
+        {
+            std::vector<uint8_t> data;
+            uint32_t size {0};
+            Clock::time_point captured;
+        };
+
+        explicit ASIFrameRing(size_t count = 4) : m_Frames(count + 1) {}
+
+        /**
+         * @brief reserve Make sure every slot can hold at least frameSize bytes.
+         * @warning Only call this when the ring is empty and the consumer is not holding a slot.
+         */
+        void reserve(uint32_t frameSize)
+        {
+            for (auto &frame : m_Frames)
+            {
+                if (frame.data.size() < frameSize)
+                    frame.data.resize(frameSize);
+            }
+            m_FrameSize = frameSize;
+        }
+
+        uint32_t frameSize() const
+        {
+            return m_FrameSize;
+        }
+
+        /** Number of usable slots, not counting the overflow slot. */
+        size_t capacity() const
+        {
+            return m_Frames.size() - 1;
+        }
+
+        /** Number of filled slots waiting for the consumer. */
+        size_t pending() const
+        {
+            return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+        }
+
+        bool empty() const
+        {
+            return pending() == 0;
+        }
+
+        /**
+         * @brief acquireWrite Producer side. Returns the next free slot or, if the consumer
+         * is behind, the overflow slot whose content will be dropped on commit.
+         */
+        Frame &acquireWrite()
+        {
+            size_t head = m_Head.load(std::memory_order_relaxed);
+            m_Overflow = (head - m_Tail.load(std::memory_order_acquire)) >= capacity();
+            return m_Overflow ? m_Frames.back() : m_Frames[head % capacity()];
+        }
+
+        /**
+         * @brief commitWrite Publish the slot returned by acquireWrite.
+         * @return false if the frame had to be dropped.
+         */
+        bool commitWrite(uint32_t size)
+        {
+            if (m_Overflow)
+            {
+                ++m_Dropped;
+                return false;
+            }
+
+            size_t head = m_Head.load(std::memory_order_relaxed);
+            Frame &frame = m_Frames[head % capacity()];
+            frame.size     = size;
+            frame.captured = Clock::now();
+            m_Head.store(head + 1, std::memory_order_release);
+            ++m_Captured;
+
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_WakeCV.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief acquireRead Consumer side. Wait up to timeout for a filled slot.
+         * @return the oldest filled slot or nullptr on timeout.
+         */
+        Frame *acquireRead(std::chrono::milliseconds timeout)
+        {
+            if (empty())
+            {
+                std::unique_lock<std::mutex> lock(m_WakeMutex);
+                if (m_WakeCV.wait_for(lock, timeout, [this] { return !empty(); }) == false)
+                    return nullptr;
+            }
+
+            return &m_Frames[m_Tail.load(std::memory_order_relaxed) % capacity()];
+        }
+
+        /** @brief releaseRead Hand the slot returned by acquireRead back to the producer. */
+        void releaseRead()
+        {
+            size_t tail = m_Tail.load(std::memory_order_relaxed);
+            const Frame &frame = m_Frames[tail % capacity()];
+
+            uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - frame.captured).count();
+            m_LatencyTotal += latency;
+            if (latency > m_LatencyMax)
+                m_LatencyMax = latency;
+            ++m_Delivered;
+
+            m_Tail.store(tail + 1, std::memory_order_release);
+        }
+
+        /** Wake up a consumer blocked in acquireRead, e.g. when streaming is stopped. */
+        void wakeAll()
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_WakeCV.notify_all();
+        }
+
+        void clear()
+        {
+            m_Head = 0;
+            m_Tail = 0;
+            m_Captured = 0;
+            m_Delivered = 0;
+            m_Dropped = 0;
+            m_LatencyTotal = 0;
+            m_LatencyMax = 0;
+        }
+
+        // Statistics, safe to read from any thread.
+        uint64_t captured() const
+        {
+            return m_Captured;
+        }
+        uint64_t delivered() const
+        {
+            return m_Delivered;
+        }
+        uint64_t dropped() const
+        {
+            return m_Dropped;
+        }
+        /** Average capture to delivery latency in milliseconds. */
+        double averageLatency() const
+        {
+            uint64_t delivered = m_Delivered;
+            return delivered ? m_LatencyTotal / 1000.0 / delivered : 0;
+        }
+        /** Maximum capture to delivery latency in milliseconds. */
+        double maximumLatency() const
+        {
+            return m_LatencyMax / 1000.0;
+        }
+
+    private:
+        std::vector<Frame> m_Frames;
+        uint32_t m_FrameSize {0};
+        bool m_Overflow {false};
+
+        std::atomic<size_t> m_Head {0};
+        std::atomic<size_t> m_Tail {0};
+
+        std::atomic<uint64_t> m_Captured {0};
+        std::atomic<uint64_t> m_Delivered {0};
+        std::atomic<uint64_t> m_Dropped {0};
+        std::atomic<uint64_t> m_LatencyTotal {0};
+        std::atomic<uint64_t> m_LatencyMax {0};
+
+        std::mutex m_WakeMutex;
+        std::condition_variable m_WakeCV;
+};
@@ -0,0 +1,226 @@
+/*
+ ASI CCD Driver - RGB24 conversion kernels
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "asi_rgb.h"
+
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ASI_RGB_SSSE3
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ASI_RGB_NEON
+#include <arm_neon.h>
+#endif
+
+namespace ASIRGB
+{
+
+void bgrToPlanarRGBScalar(const uint8_t *bgr, uint8_t *r, uint8_t *g, uint8_t *b, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i++)
+    {
+        *b++ = bgr[0];
+        *g++ = bgr[1];
+        *r++ = bgr[2];
+        bgr += 3;
+    }
+}
+
+void bgrToRGBScalar(uint8_t *buffer, size_t pixels)
+{
+    for (size_t i = 0; i < pixels * 3; i += 3)
+        std::swap(buffer[i], buffer[i + 2]);
+}
+
+#ifdef ASI_RGB_SSSE3
+/*
+ * Both kernels work on 16 pixels (3 x 16 bytes) at a time. Every output register is
+ * assembled from the three input registers with PSHUFB: for each input register a
+ * mask picks the bytes it contributes and zeroes (0x80) the others.
+ */
+struct ShuffleMasks
+{
+    // masks[output][input]
+    __m128i masks[3][3];
+};
+
+template <typename Source>
+static ShuffleMasks buildMasks(Source source)
+{
+    ShuffleMasks result;
+    for (int out = 0; out < 3; out++)
+    {
+        for (int in = 0; in < 3; in++)
+        {
+            alignas(16) uint8_t mask[16];
+            for (int j = 0; j < 16; j++)
+            {
+                int src = source(out, j);
+                mask[j] = (src >= 0 && src / 16 == in) ? src % 16 : 0x80;
+            }
+            result.masks[out][in] = _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+        }
+    }
+    return result;
+}
+
+// Output plane 0 = R, 1 = G, 2 = B. Byte j of plane p comes from pixel j.
+static const ShuffleMasks planarMasks = buildMasks([](int plane, int j)
+{
+    return 3 * j + (2 - plane);
+});
+
+// Output byte i of the 48 byte block comes from the same pixel, channel mirrored.
+static const ShuffleMasks swapMasks = buildMasks([](int out, int j)
+{
+    int i = out * 16 + j;
+    return i - i % 3 + (2 - i % 3);
+});
+
+__attribute__((target("ssse3")))
+static inline __m128i gather(const ShuffleMasks &m, int out, __m128i a, __m128i b, __m128i c)
+{
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m.masks[out][0]), _mm_shuffle_epi8(b, m.masks[out][1])),
+                        _mm_shuffle_epi8(c, m.masks[out][2]));
+}
+
+__attribute__((target("ssse3")))
+static void bgrToPlanarRGBSSSE3(const uint8_t *bgr, uint8_t *r, uint8_t *g, uint8_t *b, size_t pixels)
+{
+    size_t blocks = pixels / 16;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bgr));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bgr + 16));
+        __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bgr + 32));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(r), gather(planarMasks, 0, a0, a1, a2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(g), gather(planarMasks, 1, a0, a1, a2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(b), gather(planarMasks, 2, a0, a1, a2));
+
+        bgr += 48;
+        r += 16;
+        g += 16;
+        b += 16;
+    }
+
+    bgrToPlanarRGBScalar(bgr, r, g, b, pixels % 16);
+}
+
+__attribute__((target("ssse3")))
+static void bgrToRGBSSSE3(uint8_t *buffer, size_t pixels)
+{
+    size_t blocks = pixels / 16;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 16));
+        __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 32));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer), gather(swapMasks, 0, a0, a1, a2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer + 16), gather(swapMasks, 1, a0, a1, a2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer + 32), gather(swapMasks, 2, a0, a1, a2));
+
+        buffer += 48;
+    }
+
+    bgrToRGBScalar(buffer, pixels % 16);
+}
+#endif
+
+#ifdef ASI_RGB_NEON
+static void bgrToPlanarRGBNEON(const uint8_t *bgr, uint8_t *r, uint8_t *g, uint8_t *b, size_t pixels)
+{
+    size_t blocks = pixels / 16;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        uint8x16x3_t px = vld3q_u8(bgr);
+        vst1q_u8(b, px.val[0]);
+        vst1q_u8(g, px.val[1]);
+        vst1q_u8(r, px.val[2]);
+
+        bgr += 48;
+        r += 16;
+        g += 16;
+        b += 16;
+    }
+
+    bgrToPlanarRGBScalar(bgr, r, g, b, pixels % 16);
+}
+
+static void bgrToRGBNEON(uint8_t *buffer, size_t pixels)
+{
+    size_t blocks = pixels / 16;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        uint8x16x3_t px = vld3q_u8(buffer);
+        uint8x16_t tmp = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = tmp;
+        vst3q_u8(buffer, px);
+
+        buffer += 48;
+    }
+
+    bgrToRGBScalar(buffer, pixels % 16);
+}
+#endif
+
+struct Kernels
+{
+    void (*planar)(const uint8_t *, uint8_t *, uint8_t *, uint8_t *, size_t);
+    void (*swap)(uint8_t *, size_t);
+    const char *name;
+};
+
+static Kernels selectKernels()
+{
+#if defined(ASI_RGB_SSSE3)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+        return { bgrToPlanarRGBSSSE3, bgrToRGBSSSE3, "SSSE3" };
+#elif defined(ASI_RGB_NEON)
+    return { bgrToPlanarRGBNEON, bgrToRGBNEON, "NEON" };
+#endif
+    return { bgrToPlanarRGBScalar, bgrToRGBScalar, "Scalar" };
+}
+
+static const Kernels &kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+void bgrToPlanarRGB(const uint8_t *bgr, uint8_t *r, uint8_t *g, uint8_t *b, size_t pixels)
+{
+    kernels().planar(bgr, r, g, b, pixels);
+}
+
+void bgrToRGB(uint8_t *buffer, size_t pixels)
+{
+    kernels().swap(buffer, pixels);
+}
+
+const char *kernelName()
+{
+    return kernels().name;
+}
+
+}
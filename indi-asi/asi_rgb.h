@@ -0,0 +1,57 @@
+/*
+ ASI CCD Driver - RGB24 conversion kernels
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Conversion kernels for the interleaved BGR frames returned by the SDK in ASI_IMG_RGB24 mode.
+ * The best implementation for the running CPU (SSSE3 on x86, NEON on ARM, scalar otherwise)
+ * is selected on first use.
+ */
+namespace ASIRGB
+{
+
+/**
+ * @brief bgrToPlanarRGB Split interleaved BGR pixels into separate R, G and B planes.
+ * @param bgr source buffer, 3 * pixels bytes.
+ * @param r destination red plane, pixels bytes.
+ * @param g destination green plane, pixels bytes.
+ * @param b destination blue plane, pixels bytes.
+ * @param pixels number of pixels.
+ */
+void bgrToPlanarRGB(const uint8_t *bgr, uint8_t *r, uint8_t *g, uint8_t *b, size_t pixels);
+
+/**
+ * @brief bgrToRGB Swap the R and B channels of interleaved BGR pixels in place.
+ * @param buffer interleaved buffer, 3 * pixels bytes.
+ * @param pixels number of pixels.
+ */
+void bgrToRGB(uint8_t *buffer, size_t pixels);
+
+/** Portable reference implementations, always available. */
+void bgrToPlanarRGBScalar(const uint8_t *bgr, uint8_t *r, uint8_t *g, uint8_t *b, size_t pixels);
+void bgrToRGBScalar(uint8_t *buffer, size_t pixels);
+
+/** @return name of the selected kernel set, e.g. "SSSE3". */
+const char *kernelName();
+
+}
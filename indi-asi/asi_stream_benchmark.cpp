@@ -0,0 +1,115 @@
+/*
+ ASI Stream Benchmark
+
+ Drives the video frame ring used by indi_asi_ccd with a fake ASIGetVideoData
+ producing frames at a fixed rate, while the consumer simulates a streamer
+ that stalls periodically. Reports delivered, dropped frames and latency.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "asi_frame_ring.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static std::chrono::steady_clock::time_point nextFrame;
+static std::chrono::microseconds framePeriod;
+static uint8_t frameCounter = 0;
+
+/* Fake ASIGetVideoData: blocks until the next frame is due, then fills the buffer */
+static int fakeGetVideoData(uint8_t *buffer, uint32_t size)
+{
+    std::this_thread::sleep_until(nextFrame);
+    nextFrame += framePeriod;
+    memset(buffer, frameCounter++, size);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int fps         = argc > 1 ? atoi(argv[1]) : 300;
+    int seconds     = argc > 2 ? atoi(argv[2]) : 5;
+    uint32_t width  = argc > 3 ? atoi(argv[3]) : 640;
+    uint32_t height = argc > 4 ? atoi(argv[4]) : 480;
+    int stallMS     = argc > 5 ? atoi(argv[5]) : 20;
+    int buffers     = argc > 6 ? atoi(argv[6]) : 4;
+
+    if (fps <= 0 || seconds <= 0 || buffers <= 0)
+    {
+        fprintf(stderr, "Usage: %s [fps] [seconds] [width] [height] [stall ms every 100 frames] [buffers]\n", argv[0]);
+        return -1;
+    }
+
+    uint32_t frameSize = width * height;
+    ASIFrameRing ring(buffers);
+    ring.reserve(frameSize);
+
+    std::atomic<bool> active {true};
+    uint64_t checksum = 0;
+
+    std::thread consumer([&]()
+    {
+        uint64_t frames = 0;
+        while (active)
+        {
+            ASIFrameRing::Frame *frame = ring.acquireRead(std::chrono::milliseconds(100));
+            if (frame == nullptr)
+                continue;
+
+            // Simulate encoder work, plus an occasional recorder stall
+            for (uint32_t i = 0; i < frame->size; i += 64)
+                checksum += frame->data[i];
+            if (stallMS > 0 && ++frames % 100 == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(stallMS));
+
+            ring.releaseRead();
+        }
+    });
+
+    framePeriod = std::chrono::microseconds(1000000 / fps);
+    nextFrame   = std::chrono::steady_clock::now();
+    auto start  = nextFrame;
+    int total   = fps * seconds;
+
+    for (int i = 0; i < total; i++)
+    {
+        ASIFrameRing::Frame &frame = ring.acquireWrite();
+        fakeGetVideoData(frame.data.data(), frameSize);
+        ring.commitWrite(frameSize);
+    }
+
+    while (ring.empty() == false)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    active = false;
+    ring.wakeAll();
+    consumer.join();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Frames: %d (%ux%u) in %.2f s, %.1f FPS requested, %.1f FPS delivered\n", total, width, height, elapsed,
+           static_cast<double>(fps), ring.delivered() / elapsed);
+    printf("Delivered: %llu, Dropped: %llu (%d buffers)\n", static_cast<unsigned long long>(ring.delivered()),
+           static_cast<unsigned long long>(ring.dropped()), buffers);
+    printf("Latency avg: %.3f ms, max: %.3f ms\n", ring.averageLatency(), ring.maximumLatency());
+    printf("Checksum: %llu\n", static_cast<unsigned long long>(checksum));
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+/*
+    Celestron Aux Mount Driver - AUX bus reader.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "auxbus.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <vector>
+
+// Reader wakes up this often to check for stop()
+#define POLL_TIMEOUT 100	// ms
+// Packets kept for the driver, the oldest are dropped beyond that
+#define MAX_RECEIVED 256
+
+////////////////////////////////////////////////
+//////  AUXLatency class
+////////////////////////////////////////////////
+
+void AUXLatency::add(double ms)
+{
+    recent.push_back(ms);
+    if (recent.size() > WINDOW)
+        recent.pop_front();
+    samples++;
+    totalMs += ms;
+    maxMs = std::max(maxMs, ms);
+}
+
+double AUXLatency::percentile(double p) const
+{
+    if (recent.empty())
+        return 0;
+    std::vector<double> sorted(recent.begin(), recent.end());
+    size_t n = std::min(sorted.size() - 1, size_t(p / 100.0 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+    return sorted[n];
+}
+
+////////////////////////////////////////////////
+//////  AUXBus class
+////////////////////////////////////////////////
+
+AUXBus::AUXBus() : fd(-1), running(false), stopping(false), dropped(0)
+{
+}
+
+AUXBus::~AUXBus()
+{
+    stop();
+}
+
+bool AUXBus::start(int fd)
+{
+    stop();
+    if (fd < 0)
+        return false;
+
+    this->fd = fd;
+    parser.reset();
+    dropped  = 0;
+    stopping = false;
+    running  = true;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.clear();
+        received.clear();
+    }
+    reader = std::thread(&AUXBus::run, this);
+    return true;
+}
+
+void AUXBus::stop()
+{
+    stopping = true;
+    if (reader.joinable())
+        reader.join();
+    running = false;
+    fd      = -1;
+}
+
+void AUXBus::expect(const AUXCommand &cmd)
+{
+    Request r;
+    r.src  = cmd.src;
+    r.dst  = cmd.dst;
+    r.cmd  = cmd.cmd;
+    r.sent = Clock::now();
+
+    std::lock_guard<std::mutex> guard(lock);
+    pending.push_back(r);
+}
+
+bool AUXBus::waitPending(int timeout)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    answered.wait_for(guard, std::chrono::milliseconds(timeout), [this]
+    {
+        return pending.empty() || !running;
+    });
+
+    bool all = pending.empty();
+    for (const Request &r : pending)
+        responseTimes[r.dst].addTimeout();
+    pending.clear();
+    return all;
+}
+
+bool AUXBus::takePacket(AUXCommand &cmd)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (received.empty())
+        return false;
+    cmd = received.front();
+    received.pop_front();
+    return true;
+}
+
+AUXLatency AUXBus::latency(AUXtargets trg)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return responseTimes[trg];
+}
+
+std::map<int, AUXLatency> AUXBus::latencies()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return responseTimes;
+}
+
+void AUXBus::clearLatency()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    responseTimes.clear();
+}
+
+void AUXBus::run()
+{
+    unsigned char buf[512];
+    AUXCommand cmd;
+
+    while (!stopping)
+    {
+        struct pollfd pfd;
+        pfd.fd     = fd;
+        pfd.events = POLLIN;
+        int rc = poll(&pfd, 1, POLL_TIMEOUT);
+        if (rc < 0 && errno != EINTR)
+            break;
+        if (rc <= 0)
+            continue;
+
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        // Connection closed or lost
+        if (n <= 0)
+            break;
+
+        Clock::time_point now = Clock::now();
+        parser.feed(buf, n);
+        while (parser.next(cmd))
+            packetReceived(cmd, now);
+        dropped = parser.dropped();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    running = false;
+    answered.notify_all();
+}
+
+void AUXBus::packetReceived(const AUXCommand &cmd, Clock::time_point when)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    // A response comes from the target of the request and goes back to its
+    // sender, echoes of our own requests do not match.
+    for (auto r = pending.begin(); r != pending.end(); ++r)
+    {
+        if (r->dst == cmd.src && r->src == cmd.dst && r->cmd == cmd.cmd)
+        {
+            responseTimes[r->dst].add(std::chrono::duration<double, std::milli>(when - r->sent).count());
+            pending.erase(r);
+            break;
+        }
+    }
+
+    received.push_back(cmd);
+    if (received.size() > MAX_RECEIVED)
+        received.pop_front();
+
+    if (pending.empty())
+        answered.notify_all();
+}
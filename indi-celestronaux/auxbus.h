@@ -0,0 +1,137 @@
+/*
+    Celestron Aux Mount Driver - AUX bus reader.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "auxproto.h"
+
+// Response times of one AUX target: the last WINDOW of them for the
+// percentiles, and running totals since the last clear().
+class AUXLatency
+{
+    public:
+        static const size_t WINDOW = 512;
+
+        void add(double ms);
+        void addTimeout()
+        {
+            lost++;
+        }
+
+        int count() const
+        {
+            return samples;
+        }
+        int timeouts() const
+        {
+            return lost;
+        }
+        double mean() const
+        {
+            return samples > 0 ? totalMs / samples : 0;
+        }
+        double max() const
+        {
+            return maxMs;
+        }
+        // p-th percentile of the recent response times, in ms
+        double percentile(double p) const;
+
+    private:
+        std::deque<double> recent;
+        int samples {0};
+        int lost {0};
+        double totalMs {0};
+        double maxMs {0};
+};
+
+// Reads the AUX bus (TCP socket or AUX/PC serial port) on its own thread.
+//
+// Every packet received is reassembled by an AUXParser and queued for the
+// driver, which processes them on its own thread with takePacket(). Requests
+// sent by the driver are registered with expect() before they are written,
+// so several of them, e.g. position queries to both motor controllers, can be
+// in flight at once. Responses are matched against the pending requests as
+// they arrive and their latency recorded per target.
+//
+// Nothing is written by the reader thread. The packets the driver sends come
+// back as echoes on the AUX ports and on the WiFi bridge, they are queued as
+// any other packet.
+class AUXBus
+{
+    public:
+        AUXBus();
+        ~AUXBus();
+
+        bool start(int fd);
+        void stop();
+        // False when stopped or after the connection was lost
+        bool isRunning() const
+        {
+            return running;
+        }
+
+        void expect(const AUXCommand &cmd);
+        // Waits up to timeout ms for the pending requests, dropping the ones
+        // still unanswered. Returns false if any was dropped.
+        bool waitPending(int timeout);
+        bool takePacket(AUXCommand &cmd);
+
+        AUXLatency latency(AUXtargets trg);
+        std::map<int, AUXLatency> latencies();
+        void clearLatency();
+        size_t droppedBytes() const
+        {
+            return dropped;
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Request
+        {
+            AUXtargets src, dst;
+            AUXCommands cmd;
+            Clock::time_point sent;
+        };
+
+        void run();
+        void packetReceived(const AUXCommand &cmd, Clock::time_point when);
+
+        int fd;
+        std::thread reader;
+        std::atomic<bool> running;
+        std::atomic<bool> stopping;
+        std::atomic<size_t> dropped;
+        AUXParser parser;
+
+        std::mutex lock;
+        std::condition_variable answered;
+        std::deque<Request> pending;
+        std::deque<AUXCommand> received;
+        std::map<int, AUXLatency> responseTimes;
+};
@@ -320,3 +320,72 @@ void AUXCommand::setRate(unsigned char r)
     len     = 4;
     data[0] = r;
 }
+
+////////////////////////////////////////////////
+//////  AUXParser class
+////////////////////////////////////////////////
+
+AUXParser::AUXParser()
+{
+    pending.reserve(BUFFER_SIZE);
+    start        = 0;
+    droppedBytes = 0;
+}
+
+void AUXParser::feed(const unsigned char *bytes, size_t n)
+{
+    // Compact the buffer only once the parsed part dominates it
+    if (start > 0 && start >= pending.size() / 2)
+    {
+        pending.erase(pending.begin(), pending.begin() + start);
+        start = 0;
+    }
+    pending.insert(pending.end(), bytes, bytes + n);
+}
+
+bool AUXParser::next(AUXCommand &cmd)
+{
+    while (start < pending.size())
+    {
+        // Skip to the packet preamble
+        if (pending[start] != 0x3b)
+        {
+            start++;
+            droppedBytes++;
+            continue;
+        }
+
+        // Wait for the length byte and then for the whole packet
+        if (pending.size() - start < 2)
+            return false;
+        size_t l = pending[start + 1];
+        if (l < 3)
+        {
+            start++;
+            droppedBytes++;
+            continue;
+        }
+        if (pending.size() - start < l + 3)
+            return false;
+
+        buffer b(pending.begin() + start, pending.begin() + start + l + 3);
+        if (cmd.checksum(b) != b.back())
+        {
+            // Not a packet after all, resync on the next preamble
+            start++;
+            droppedBytes++;
+            continue;
+        }
+        cmd.parseBuf(b);
+        start += l + 3;
+        return true;
+    }
+    return false;
+}
+
+void AUXParser::reset()
+{
+    pending.clear();
+    start        = 0;
+    droppedBytes = 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
 typedef std::vector<unsigned char> buffer;
@@ -82,3 +83,25 @@ class AUXCommand
     buffer data;
     bool valid;
 };
+
+// Reassembles AUX packets from a byte stream. Bytes may come in any chunks,
+// packets split across reads are completed by the following ones. Garbage
+// and packets with a bad checksum are skipped up to the next preamble.
+class AUXParser
+{
+  public:
+    AUXParser();
+
+    void feed(const unsigned char *bytes, size_t n);
+    bool next(AUXCommand &cmd);
+    void reset();
+    size_t dropped() const
+    {
+        return droppedBytes;
+    }
+
+  private:
+    buffer pending;
+    size_t start;
+    size_t droppedBytes;
+};
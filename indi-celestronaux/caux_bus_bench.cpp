@@ -0,0 +1,189 @@
+/*
+    Celestron Aux Mount Driver - AUX bus benchmark.
+
+    Checks the packet reassembly and measures the position query round
+    trips, one motor controller after the other and pipelined to both,
+    against a networked mount or simulator/nse_simulator.py:
+
+        python3 simulator/nse_simulator.py t
+        caux_bus_bench [host] [port] [rounds]
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "auxbus.h"
+
+#define RESPONSE_TIMEOUT 1000 // ms
+
+typedef std::chrono::steady_clock Clock;
+
+// Feeds a stream of packets, with garbage in between, in chunks of every
+// size from 1 byte up and checks they all come out.
+static bool checkParser()
+{
+    buffer stream;
+    std::vector<long> positions;
+    for (int i = 0; i < 50; i++)
+    {
+        AUXCommand cmd(MC_GET_POSITION, (i % 2) ? ALT : AZM, APP);
+        cmd.setPosition(long(i * 123457));
+        buffer b;
+        cmd.fillBuf(b);
+        stream.insert(stream.end(), b.begin(), b.end());
+        positions.push_back(cmd.getPosition());
+        // Noise, including a false preamble
+        if (i % 7 == 0)
+        {
+            stream.push_back(0x3b);
+            stream.push_back(0x05);
+            stream.push_back(0x00);
+        }
+    }
+
+    for (size_t chunk = 1; chunk <= stream.size(); chunk++)
+    {
+        AUXParser parser;
+        AUXCommand cmd;
+        size_t got = 0;
+        for (size_t i = 0; i < stream.size(); i += chunk)
+        {
+            parser.feed(stream.data() + i, std::min(chunk, stream.size() - i));
+            while (parser.next(cmd))
+            {
+                if (got >= positions.size() || cmd.getPosition() != positions[got])
+                {
+                    fprintf(stderr, "Parser: wrong packet %zu with %zu byte chunks\n", got, chunk);
+                    return false;
+                }
+                got++;
+            }
+        }
+        if (got != positions.size())
+        {
+            fprintf(stderr, "Parser: %zu of %zu packets with %zu byte chunks\n", got, positions.size(), chunk);
+            return false;
+        }
+    }
+    printf("Parser: %zu packets reassembled from chunks of 1 to %zu bytes\n", positions.size(), stream.size());
+    return true;
+}
+
+static int connectTo(const char *host, const char *port)
+{
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0)
+        return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai != nullptr; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static bool send(int fd, AUXBus &bus, AUXCommand cmd)
+{
+    buffer b;
+    cmd.fillBuf(b);
+    bus.expect(cmd);
+    return write(fd, b.data(), b.size()) == (ssize_t)b.size();
+}
+
+static void printLatency(AUXBus &bus, AUXtargets trg, const char *name)
+{
+    AUXLatency l = bus.latency(trg);
+    printf("  %s: n=%d mean=%.2f ms p50=%.2f ms p95=%.2f ms p99=%.2f ms max=%.2f ms timeouts=%d\n", name, l.count(),
+           l.mean(), l.percentile(50), l.percentile(95), l.percentile(99), l.max(), l.timeouts());
+}
+
+static void run(int fd, AUXBus &bus, int rounds, bool pipelined)
+{
+    AUXCommand packet;
+    bus.clearLatency();
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < rounds && bus.isRunning(); i++)
+    {
+        if (pipelined)
+        {
+            send(fd, bus, AUXCommand(MC_GET_POSITION, APP, ALT));
+            send(fd, bus, AUXCommand(MC_GET_POSITION, APP, AZM));
+            bus.waitPending(RESPONSE_TIMEOUT);
+        }
+        else
+        {
+            send(fd, bus, AUXCommand(MC_GET_POSITION, APP, ALT));
+            bus.waitPending(RESPONSE_TIMEOUT);
+            send(fd, bus, AUXCommand(MC_GET_POSITION, APP, AZM));
+            bus.waitPending(RESPONSE_TIMEOUT);
+        }
+        while (bus.takePacket(packet))
+            ;
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    printf("%s: %d rounds, %.2f ms per ALT+AZM position update\n", pipelined ? "Pipelined" : "Sequential", rounds,
+           ms / rounds);
+    printLatency(bus, ALT, "ALT");
+    printLatency(bus, AZM, "AZM");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *host = argc > 1 ? argv[1] : "localhost";
+    const char *port = argc > 2 ? argv[2] : "2000";
+    int rounds       = argc > 3 ? atoi(argv[3]) : 200;
+
+    if (!checkParser())
+        return 1;
+
+    int fd = connectTo(host, port);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Cannot connect to %s:%s\n", host, port);
+        return 1;
+    }
+
+    AUXBus bus;
+    bus.start(fd);
+    run(fd, bus, rounds, false);
+    run(fd, bus, rounds, true);
+    printf("Bytes skipped by the parser: %zu\n", bus.droppedBytes());
+    bus.stop();
+
+    close(fd);
+    return 0;
+}
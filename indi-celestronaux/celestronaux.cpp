@@ -32,8 +32,6 @@
 #include "celestronaux.h"
 #include "config.h"
 
-#define BUFFER_SIZE 10240
-
 #define READ_TIMEOUT 1 		// s
 #define CTS_TIMEOUT 100		// ms
 #define RTS_DELAY 50		// ms
@@ -305,6 +303,7 @@ bool CelestronAUX::Handshake()
                 if (!tty_set_speed(PortFD, B19200))
                     return false;
                 LOG_INFO("Setting serial speed to 19200 baud.");
+                auxBus.start(PortFD);
             }
             else
             {
@@ -323,6 +322,7 @@ bool CelestronAUX::Handshake()
         {
             LOG_INFO("Wait for mount connection to settle.");
             msleep(1000);
+            auxBus.start(PortFD);
             return true;
         }
 
@@ -337,6 +337,7 @@ bool CelestronAUX::Handshake()
         {
             LOG_ERROR("Got no response from target ALT or AZM.");
             LOG_ERROR("Cannot continue without connection to motor controllers.");
+            auxBus.stop();
             return false;
         }
 
@@ -356,6 +357,7 @@ bool CelestronAUX::Handshake()
 bool CelestronAUX::Disconnect()
 {
     Abort();
+    auxBus.stop();
     return INDI::Telescope::Disconnect();
 }
 
@@ -609,6 +611,15 @@ bool CelestronAUX::initProperties()
     IUFillSwitchVector(&GPSEmuSP, GPSEmuS, 2, getDeviceName(), "GPSEMU", "GPS Emu", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60,
                        IPS_IDLE);
 
+    IUFillNumber(&AuxLatencyN[LAT_ALT_MEAN], "ALT_MEAN", "ALT mean (ms)", "%.1f", 0, 10000, 0, 0);
+    IUFillNumber(&AuxLatencyN[LAT_ALT_P95], "ALT_P95", "ALT 95% (ms)", "%.0f", 0, 10000, 0, 0);
+    IUFillNumber(&AuxLatencyN[LAT_ALT_TIMEOUTS], "ALT_TIMEOUTS", "ALT timeouts", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&AuxLatencyN[LAT_AZM_MEAN], "AZM_MEAN", "AZM mean (ms)", "%.1f", 0, 10000, 0, 0);
+    IUFillNumber(&AuxLatencyN[LAT_AZM_P95], "AZM_P95", "AZM 95% (ms)", "%.0f", 0, 10000, 0, 0);
+    IUFillNumber(&AuxLatencyN[LAT_AZM_TIMEOUTS], "AZM_TIMEOUTS", "AZM timeouts", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumberVector(&AuxLatencyNP, AuxLatencyN, 6, getDeviceName(), "AUX_LATENCY", "AUX latency", MOUNTINFO_TAB,
+                       IP_RO, 0, IPS_IDLE);
+
     IUFillSwitch(&NetDetectS[ISS_OFF], "ISS_OFF", "Detect", ISS_OFF);
     IUFillSwitchVector(&NetDetectSP, NetDetectS, 1, getDeviceName(), "NETDETECT", "Network scope", CONNECTION_TAB, IP_RW,
                        ISR_ATMOST1, 60, IPS_IDLE);
@@ -659,6 +670,10 @@ bool CelestronAUX::updateProperties()
         IUSaveText(&FirmwareT[FW_LIGHT], "Ligts version");
         IUSaveText(&FirmwareT[FW_GPS], "GPS version");
         defineText(&FirmwareTP);
+
+        auxBus.clearLatency();
+        if (auxBus.isRunning())
+            defineNumber(&AuxLatencyNP);
     }
     else
     {
@@ -666,6 +681,7 @@ bool CelestronAUX::updateProperties()
         deleteProperty(CWPosSP.name);
         deleteProperty(GPSEmuSP.name);
         deleteProperty(FirmwareTP.name);
+        deleteProperty(AuxLatencyNP.name);
     }
     return true;
 }
@@ -1096,6 +1112,8 @@ void CelestronAUX::TimerHit()
     ltv = tv;
 
     TimerTick(dt);
+    if (TraceThisTick && auxBus.isRunning())
+        updateLatency();
 
     INDI::Telescope::TimerHit(); // This will call ReadScopeStatus
 
@@ -1515,24 +1533,60 @@ bool CelestronAUX::TimerTick(double dt)
 /////////////////////////////////////////////////////////////////////////////////////
 void CelestronAUX::querryStatus()
 {
-    AUXtargets trg[2] = { ALT, AZM };
-    for (int i = 0; i < 2; i++)
+    AUXCommand cmds[4];
+    int n = 0;
+
+    cmds[n++] = AUXCommand(MC_GET_POSITION, APP, ALT);
+    cmds[n++] = AUXCommand(MC_GET_POSITION, APP, AZM);
+    if (slewingAlt)
+        cmds[n++] = AUXCommand(MC_SLEW_DONE, APP, ALT);
+    if (slewingAz)
+        cmds[n++] = AUXCommand(MC_SLEW_DONE, APP, AZM);
+
+    if (auxBus.isRunning())
     {
-        AUXCommand cmd(MC_GET_POSITION, APP, trg[i]);
-        sendCmd(cmd);
-        readMsgs(cmd);
+        // Send all the queries at once and collect the responses together,
+        // the motor controllers answer them while the next ones are sent.
+        for (int i = 0; i < n; i++)
+            sendCmd(cmds[i]);
+        readMsgs(cmds[n - 1]);
     }
-    if (slewingAlt)
+    else
     {
-        AUXCommand cmd(MC_SLEW_DONE, APP, ALT);
-        sendCmd(cmd);
-        readMsgs(cmd);
+        // The HC passthrough answers one command at a time
+        for (int i = 0; i < n; i++)
+        {
+            sendCmd(cmds[i]);
+            readMsgs(cmds[i]);
+        }
     }
-    if (slewingAz)
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void CelestronAUX::updateLatency()
+{
+    AUXLatency alt = auxBus.latency(ALT);
+    AUXLatency azm = auxBus.latency(AZM);
+
+    AuxLatencyN[LAT_ALT_MEAN].value     = alt.mean();
+    AuxLatencyN[LAT_ALT_P95].value      = alt.percentile(95);
+    AuxLatencyN[LAT_ALT_TIMEOUTS].value = alt.timeouts();
+    AuxLatencyN[LAT_AZM_MEAN].value     = azm.mean();
+    AuxLatencyN[LAT_AZM_P95].value      = azm.percentile(95);
+    AuxLatencyN[LAT_AZM_TIMEOUTS].value = azm.timeouts();
+    AuxLatencyNP.s = (alt.timeouts() || azm.timeouts()) ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&AuxLatencyNP, nullptr);
+
+    // Every target that was queried
+    for (auto &it : auxBus.latencies())
     {
-        AUXCommand cmd(MC_SLEW_DONE, APP, AZM);
-        sendCmd(cmd);
-        readMsgs(cmd);
+        const AUXLatency &l = it.second;
+        AUXCommand cmd;
+        const char *name = cmd.node_name(AUXtargets(it.first));
+        DEBUGF(DBG_AUXMOUNT, "AUX latency %s: n=%d mean=%.1fms median=%.1fms 95%%=%.1fms max=%.1fms timeouts=%d",
+               name ? name : "?", l.count(), l.mean(), l.percentile(50), l.percentile(95), l.max(), l.timeouts());
     }
 }
 
@@ -1751,75 +1805,39 @@ bool CelestronAUX::serial_readMsgs(AUXCommand c)
     if ( PortFD <= 0 )
         return false;
 
-    if (isRTSCTS)
-    {
-        // if connected to AUX or PC ports, receive AUX command response.
-        // search for packet preamble (0x3b)
-        do
-        {
-            if (aux_tty_read(PortFD, (char*)buf, 1, READ_TIMEOUT, &n) != TTY_OK)
-                return false;
-        }
-        while (buf[0] != 0x3b);
-
-        // packet preamble is found, now read packet length.
-        if (aux_tty_read(PortFD, (char*)(buf + 1), 1, READ_TIMEOUT, &n) != TTY_OK)
-            return false;
-
-        // now packet length is known, read the rest of the packet.
-        if (aux_tty_read(PortFD, (char*)(buf + 2), buf[1] + 1, READ_TIMEOUT, &n)
-                != TTY_OK || n != buf[1] + 1)
-        {
-            DEBUG(DBG_CAUX, "Did not got whole packet. Dropping out.");
-            return false;
-        }
-
-        buffer b(buf, buf + (n + 2));
-
-        if (SERIAL_DEBUG)
-        {
-            hex_dump(hexbuf, b, b.size());
-            IDLog("Receive packet: <%s>\n", hexbuf);
-        }
+    // Connected to HC serial, build up the AUX command response from
+    // given AUX command and passthrough response without checksum.
+    // read passthrough response
+    if ((tty_read(PortFD, (char *)buf + 5, response_data_size + 1, READ_TIMEOUT, &n) !=
+            TTY_OK) || (n != response_data_size + 1))
+        return false;
 
-        cmd.parseBuf(b);
-    }
-    else
+    // if last char is not '#', there was an error.
+    if (buf[response_data_size + 5] != '#')
     {
-        // if connected to HC serial, build up the AUX command response from
-        // given AUX command and passthrough response without checksum.
-        // read passthrough response
-        if ((tty_read(PortFD, (char *)buf + 5, response_data_size + 1, READ_TIMEOUT, &n) !=
-                TTY_OK) || (n != response_data_size + 1))
-            return false;
-
-        // if last char is not '#', there was an error.
-        if (buf[response_data_size + 5] != '#')
-        {
-            LOGF_ERROR("Resp. char %d is %2.2x ascii %c", n, buf[n + 5], (char)buf[n + 5]);
-            buffer b(buf, buf + (response_data_size + 5));
-            hex_dump(hexbuf, b, b.size());
-            LOGF_ERROR("Receive packet: %s", hexbuf);
-            return false;
-        }
-
-        buf[0] = 0x3b;
-        buf[1] = response_data_size + 1;
-        buf[2] = c.dst;
-        buf[3] = c.src;
-        buf[4] = c.cmd;
-
+        LOGF_ERROR("Resp. char %d is %2.2x ascii %c", n, buf[n + 5], (char)buf[n + 5]);
         buffer b(buf, buf + (response_data_size + 5));
+        hex_dump(hexbuf, b, b.size());
+        LOGF_ERROR("Receive packet: %s", hexbuf);
+        return false;
+    }
 
-        if (SERIAL_DEBUG)
-        {
-            hex_dump(hexbuf, b, b.size());
-            IDLog("Receive packet (%d B): <%s>\n", (int)b.size(), hexbuf);
-        }
+    buf[0] = 0x3b;
+    buf[1] = response_data_size + 1;
+    buf[2] = c.dst;
+    buf[3] = c.src;
+    buf[4] = c.cmd;
+
+    buffer b(buf, buf + (response_data_size + 5));
 
-        cmd.parseBuf(b, false);
+    if (SERIAL_DEBUG)
+    {
+        hex_dump(hexbuf, b, b.size());
+        IDLog("Receive packet (%d B): <%s>\n", (int)b.size(), hexbuf);
     }
 
+    cmd.parseBuf(b, false);
+
     // Got the packet, process it
     // n:length field >=3
     // The buffer of n+2>=5 bytes contains:
@@ -1837,83 +1855,38 @@ bool CelestronAUX::serial_readMsgs(AUXCommand c)
 /////////////////////////////////////////////////////////////////////////////////////
 ///
 /////////////////////////////////////////////////////////////////////////////////////
-bool CelestronAUX::tcp_readMsgs()
+void CelestronAUX::processPackets()
 {
-
-    int n, i;
-    unsigned char buf[BUFFER_SIZE];
     AUXCommand cmd;
 
-    // We are not connected. Nothing to do.
-    if ( PortFD <= 0 )
-        return false;
-
-    timeval tv;
-    tv.tv_sec  = 0;
-    tv.tv_usec = 50000;
-    setsockopt(PortFD, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(struct timeval));
-
-    // Drain the channel
-    while ((n = recv(PortFD, buf, sizeof(buf), MSG_DONTWAIT | MSG_PEEK)) > 0)
+    while (auxBus.takePacket(cmd))
     {
         if (RD_DEBUG)
-        {
-            IDLog("Got %d bytes: ", n);
-            for (i = 0; i < n; i++)
-                IDLog("%02x ", buf[i]);
-            IDLog("\n");
-        }
-        for (i = 0; i < n;)
-        {
-            //if (RD_DEBUG) fprintf(stderr,"%d ",i);
-            if (buf[i] == 0x3b)
-            {
-                int shft;
-                shft = i + buf[i + 1] + 3;
-                if (shft <= n)
-                {
-                    //if (RD_DEBUG) prnBytes(buf+i,shft-i);
-                    buffer b(buf + i, buf + shft);
-                    //if (RD_DEBUG) dumpMsg(b);
-                    cmd.parseBuf(b);
-                    processCmd(cmd);
-                }
-                else
-                {
-                    IDLog("Partial message recv. dropping (i=%d %d/%d)\n", i, shft, n);
-                    prnBytes(buf + i, n - i);
-                    recv(PortFD, buf, n, MSG_DONTWAIT);
-                    break;
-                }
-                i = shft;
-            }
-            else
-            {
-                i++;
-            }
-        }
-        // Actually consume data we parsed. Leave the rest for later.
-        if (i > 0)
-        {
-            n = recv(PortFD, buf, i, MSG_DONTWAIT);
-            if (RD_DEBUG)
-                IDLog("Consumed %d/%d bytes \n", n, i);
-        }
+            cmd.pprint();
+        processCmd(cmd);
     }
-    //fprintf(stderr,"Nothing more to read\n");
-    return true;
 }
 
-
 /////////////////////////////////////////////////////////////////////////////////////
 ///
 /////////////////////////////////////////////////////////////////////////////////////
 bool CelestronAUX::readMsgs(AUXCommand c)
 {
-    if (getActiveConnection() == serialConnection)
+    // Network and AUX/PC port connections are read by the bus thread, wait
+    // for the responses to everything sent so far and process what came in.
+    if (auxBus.isRunning())
+    {
+        bool answered = auxBus.waitPending(READ_TIMEOUT * 1000);
+        processPackets();
+        if (!answered)
+            DEBUGF(DBG_CAUX, "No response to %s from %s.", c.cmd_name(c.cmd), c.node_name(c.dst));
+        return answered;
+    }
+
+    if (getActiveConnection() == serialConnection && !isRTSCTS)
         return serial_readMsgs(c);
-    else
-        return tcp_readMsgs();
+
+    return false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -1929,7 +1902,9 @@ int CelestronAUX::sendBuffer(int PortFD, buffer buf)
         if (aux_tty_write(PortFD, (char*)buf.data(), buf.size(), CTS_TIMEOUT, &n) != TTY_OK)
             return 0;
 
-        msleep(50);
+        // The bus thread picks up the response whenever it comes
+        if (!auxBus.isRunning())
+            msleep(50);
         if (n == -1)
             perror("CAUX::sendBuffer");
         if ((unsigned)n != buf.size())
@@ -1979,7 +1954,16 @@ bool CelestronAUX::sendCmd(AUXCommand &c)
         IDLog("Send packet: <%s>\n", hexbuf);
     }
 
-    tcflush(PortFD, TCIOFLUSH);
+    if (auxBus.isRunning())
+    {
+        // Responses to the other requests in flight must not be flushed.
+        // Requests are registered before they are written so that even
+        // the quickest response finds them.
+        if (c.src == APP)
+            auxBus.expect(c);
+    }
+    else
+        tcflush(PortFD, TCIOFLUSH);
     return sendBuffer(PortFD, buf) == (int)buf.size();
 }
 
@@ -2110,8 +2094,8 @@ int CelestronAUX::aux_tty_write(int PortFD, char *buf, int bufsiz, float timeout
     }
 
     // ports requiring hardware flow control echo all sent characters,
-    // verify them.
-    if (isRTSCTS)
+    // verify them. The bus thread reads them as packets from APP otherwise.
+    if (isRTSCTS && !auxBus.isRunning())
     {
         if (WR_DEBUG) IDLog("aux_tty_write: verify echo\n");
         if ((errcode = tty_read(PortFD, errmsg, *n, READ_TIMEOUT, &ne)) != TTY_OK)
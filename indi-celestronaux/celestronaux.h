@@ -28,6 +28,7 @@
 #include <connectionplugins/connectiontcp.h>
 #include <alignment/AlignmentSubsystemForDrivers.h>
 
+#include "auxbus.h"
 #include "auxproto.h"
 
 class CelestronAUX :
@@ -159,6 +160,8 @@ class CelestronAUX :
 
         // connection
         bool isRTSCTS;
+        // Reader of the AUX bus, for network and AUX/PC port connections
+        AUXBus auxBus;
 
         unsigned int DBG_CAUX;
         unsigned int DBG_AUXMOUNT;
@@ -170,9 +173,10 @@ class CelestronAUX :
         void closeConnection();
         void emulateGPS(AUXCommand &m);
         bool serial_readMsgs(AUXCommand c);
-        bool tcp_readMsgs();
         bool readMsgs(AUXCommand c);
+        void processPackets();
         void processCmd(AUXCommand &cmd);
+        void updateLatency();
         void querryStatus();
         int sendBuffer(int PortFD, buffer buf);
         bool sendCmd(AUXCommand &c);
@@ -226,4 +230,8 @@ class CelestronAUX :
         ISwitch GPSEmuS[2];
         ISwitchVectorProperty GPSEmuSP;
         enum { GPSEMU_OFF, GPSEMU_ON };
+        // AUX bus response latency
+        INumber AuxLatencyN[6];
+        INumberVectorProperty AuxLatencyNP;
+        enum { LAT_ALT_MEAN, LAT_ALT_P95, LAT_ALT_TIMEOUTS, LAT_AZM_MEAN, LAT_AZM_P95, LAT_AZM_TIMEOUTS };
 };
@@ -13,6 +13,7 @@
 #include "DsiException.h"
 #include "Util.h"
 
+#include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -130,6 +131,14 @@ DSI::Device::Device(const char *devname) : readout_mode(ReadoutMode::DUAL), usb_
     binning2x2 = false;
     ccd_temp   = -128.5;
 
+    continuous      = false;
+    armed           = false;
+    armed_binning   = false;
+    armed_at        = {};
+    exposure_start  = {};
+    exposure_gain   = 0;
+    exposure_offset = 0x0ff;
+
     initImager(devname);
 }
 
@@ -673,6 +682,11 @@ void DSI::Device::setVddOn(bool s)
     vdd_on = s;
 }
 
+void DSI::Device::setContinuous(bool c)
+{
+    continuous = c;
+}
+
 int DSI::Device::startExposure(int howlong, int gain, int offs)
 {
     // Monkey code.  Monkey see (SniffUSB), monkey do).  Some part of this
@@ -683,7 +697,41 @@ int DSI::Device::startExposure(int howlong, int gain, int offs)
     int interlaced;
 
     /* for safety reasons, just in case howlong is zero (gs) */
-    exposure_time = (howlong > 0 ? howlong : 1);
+    howlong = (howlong > 0 ? howlong : 1);
+
+    if (armed)
+    {
+        armed = false;
+
+        /* Time since the pending exposure was triggered, in the unit of
+         * exposure_time. */
+        struct timeval now;
+        gettimeofday(&now, 0);
+        double waited = ((now.tv_sec - armed_at.tv_sec) * 1e6 + (now.tv_usec - armed_at.tv_usec)) / 100.0;
+
+        /* The camera has been exposing with these settings since the last
+         * image was read out, just collect the image, unless it has been
+         * waiting for longer than an exposure time. */
+        if (((unsigned int)howlong == exposure_time) && (gain == exposure_gain) && (offs == exposure_offset) &&
+            (binning2x2 == armed_binning) && (waited <= 2.0 * exposure_time))
+        {
+            exposure_start = armed_at;
+            downloadImage();
+            return 0;
+        }
+
+        /* Settings changed or the image is stale, the pending image has to be
+         * read out before the camera takes new ones. */
+        bool keep  = continuous;
+        continuous = false;
+        delete[] downloadImage();
+        framebuffer = nullptr;
+        continuous  = keep;
+    }
+
+    exposure_time   = howlong;
+    exposure_gain   = gain;
+    exposure_offset = offs;
 
     // Check for DSI III: if not interlaced, it has to be DSI III.
     // Not very nice, but simplifies retrofitting the DSI I/II code (gs)
@@ -792,6 +840,8 @@ int DSI::Device::startExposure(int howlong, int gain, int offs)
         status = command(DeviceCommand::TRIGGER);
     }
 
+    gettimeofday(&exposure_start, 0);
+
     /* image download for short exposures (gs)
 	   If exposure time is smaller than 2s, download image immediately
 	   into framebuffer, otherwise there might be problems with
@@ -806,13 +856,10 @@ int DSI::Device::startExposure(int howlong, int gain, int offs)
 unsigned char *DSI::Device::downloadImage()
 {
     int status = 0;
-    int transfered = 0;
     int interlaced = 0;
-    int rawtemp = 0;
     unsigned int t_read_width = 0;
     unsigned int t_read_height_even = 0;
     unsigned int t_read_height_odd = 0;
-    unsigned int t_read_height = 0;
     unsigned int t_read_bpp = 0;
     unsigned int t_image_width = 0;
     unsigned int t_image_height = 0;
@@ -847,177 +894,109 @@ unsigned char *DSI::Device::downloadImage()
         t_image_offset_y   = image_offset_y;
     }
 
-    t_read_height = t_read_height_even + t_read_height_odd;
-    t_read_bpp    = read_bpp;
+    t_read_bpp = read_bpp;
 
-    unsigned int odd_size  = t_read_bpp * t_read_width * t_read_height_odd;
-    unsigned int even_size = t_read_bpp * t_read_width * t_read_height_even;
-    unsigned int all_size  = t_read_bpp * t_read_width * t_read_height;
-    unsigned char *odd_data = new unsigned char[odd_size];
-    unsigned char *even_data = nullptr;
+    if ((!interlaced) && (!vdd_on) && (exposure_time >= VDD_TRH))
+        status = command(DeviceCommand::SET_VDD_MODE, VddMode::ON.value());
 
-    if (interlaced)
-        even_data = new unsigned char[even_size];
+    FieldLayout layout = { t_read_width,   t_read_height_even, t_read_height_odd, t_read_bpp,
+                           t_image_width,  t_image_height,     t_image_offset_x,  t_image_offset_y };
 
-    framebuffer = new unsigned char[all_size];
-
-    if (interlaced)
-    {
-        /* XXX: There has to be  a way to calculate a more optimal readout
-               time here. */
-        status = libusb_bulk_transfer(handle, 0x86, even_data, even_size, &transfered, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)even_data, 0);
+    return readImage(layout, continuous);
+}
 
-            std::cerr << std::dec << "read even data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                 << std::endl
-                 << "    requested " << even_size << " bytes " << t_read_width << " x " << t_read_height_even
-                 << " (even pixels)" << std::endl
-                 << "Transfered: " << transfered << " bytes" << std::endl;
-        }
+/**
+ * Read an image from the camera into a new framebuffer.  The reads of all the
+ * fields are queued up front and every field is decoded as soon as it is in,
+ * while the camera is still sending the next one.  The commands that follow
+ * the readout are sent before the last field is decoded.
+ *
+ * @param layout geometry of the readout.
+ * @param rearm if true, trigger the next exposure right after the readout.
+ *
+ * @return the framebuffer, image_width x image_height big endian pixels.
+ */
+unsigned char *DSI::Device::readImage(const FieldLayout &layout, bool rearm)
+{
+    UsbFieldReader reader(handle, log_commands);
+    FieldPipeline pipeline(reader, layout);
 
-        if (status != 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read even data, status = (" << status << ") " << strerror(-status);
-            throw device_read_error(ss.str());
-        }
+    /* Released to the caller once the image is read, freed if the read throws. */
+    std::unique_ptr<unsigned char[]> image(new unsigned char[layout.imageSize()]);
 
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transfered, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)odd_data, 0);
+    if (log_commands)
+        std::cerr << "t_image_height  =" << layout.image_height << std::endl
+             << "t_image_width   =" << layout.image_width << std::endl
+             << "t_image_offset_x=" << layout.image_offset_x << std::endl
+             << "t_image_offset_y=" << layout.image_offset_y << std::endl
+             << "t_read_width    =" << layout.read_width << std::endl
+             << "t_read_height   =" << layout.read_height_even + layout.read_height_odd << std::endl
+             << "t_read_bpp      =" << layout.read_bpp << std::endl;
 
-            std::cerr << std::dec << "read odd data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                 << std::endl
-                 << "    requested " << odd_size << " bytes " << t_read_width << " x " << t_read_height_odd
-                 << " (odd pixels)" << std::endl
-                 << "Transfered: " << transfered << " bytes" << std::endl;
-        }
+    pipeline.submit();
 
-        if (status != 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read odd data, status = (" << status << ") " << strerror(-status);
-            throw device_read_error(ss.str());
-        }
-    }
-    else // progressive mode for DSI III (gs)
+    while (true)
     {
-        if ((!vdd_on) && (exposure_time >= VDD_TRH))
-            status = command(DeviceCommand::SET_VDD_MODE, VddMode::ON.value());
+        /* XXX: There has to be  a way to calculate a more optimal readout
+               time here. */
+        Field field = pipeline.wait(60000 * MILLISEC);
 
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transfered, 60000 * MILLISEC);
-        if (log_commands)
+        if (!pipeline.done())
         {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)odd_data, 0);
-
-            std::cerr << std::dec << "read progressive data, status = (" << status << ") " << std::endl
-                 << "    requested " << odd_size << " bytes " << t_read_width << " x " << t_read_height_odd
-                 << " (pixels)" << std::endl
-                 << "Transfered: " << transfered << " bytes" << std::endl;
+            pipeline.decode(field, image.get());
+            continue;
         }
 
-        if (status != 0)
+        /* Update temperature for devices with sensor (gs) */
+        if (has_tempsensor)
         {
-            std::stringstream ss;
-            ss << std::dec << "read progressive data, status = (" << status << ") ";
-            throw device_read_error(ss.str());
+            int rawtemp = command(DeviceCommand::GET_TEMP);
+            ccd_temp    = floor((float)rawtemp / 25.6) / 10.0;
         }
-    }
-
-    /* Update temperature for devices with sensor (gs) */
-
-    if (has_tempsensor)
-    {
-        rawtemp  = command(DeviceCommand::GET_TEMP);
-        ccd_temp = floor((float)rawtemp / 25.6) / 10.0;
-    }
-
-    status = command(DeviceCommand::GET_EXP_MODE);
 
-    /* disable 2x2 binning after downloading image (gs) */
-    disable2x2Binning();
-
-    unsigned char msb = 0, lsb = 0, is_odd = 0;
-    unsigned int x_ptr = 0, line_start = 0, y_ptr = 0, read_ptr = 0, write_ptr = 0;
-    char *even = (char *)even_data;
-    char *odd  = (char *)odd_data;
+        command(DeviceCommand::GET_EXP_MODE);
 
-    if (log_commands)
-        std::cerr << "t_image_height  =" << t_image_height << std::endl
-             << "t_image_width   =" << t_image_width << std::endl
-             << "t_image_offset_x=" << t_image_offset_x << std::endl
-             << "t_image_offset_y=" << t_image_offset_y << std::endl
-             << "t_read_width    =" << t_read_width << std::endl
-             << "t_read_height   =" << t_read_height << std::endl
-             << "t_read_bpp      =" << t_read_bpp << std::endl;
-
-    if (interlaced)
-    {
-        for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-        {
-            line_start = t_read_width * ((y_ptr + t_image_offset_y) / 2);
-            is_odd     = (y_ptr + t_image_offset_y) % 2;
+        /* disable 2x2 binning after downloading image (gs) */
+        disable2x2Binning();
 
-            std::cerr << "starting image row " << y_ptr << ", write_ptr=" << write_ptr << ", line_start=" << line_start
-                 << ", is_odd=" << (is_odd == 0 ? 0 : 1) << ", read_ptr=" << (line_start + t_image_offset_x) * 2
-                 << std::endl;
+        if (rearm)
+            rearmExposure();
 
-            for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-            {
-                read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-                if (is_odd == 1) // odd line
-                {
-                    msb = odd[read_ptr];
-                    lsb = odd[read_ptr + 1];
-                }
-                else
-                { // even line
-                    msb = even[read_ptr];
-                    lsb = even[read_ptr + 1];
-                }
-                framebuffer[write_ptr++] = msb;
-                framebuffer[write_ptr++] = lsb;
-            }
-        }
+        pipeline.decode(field, image.get());
+        break;
     }
-    else
-    {
-        for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-        {
-            line_start = t_read_width * (y_ptr + t_image_offset_y);
-
-            // std::cerr << "starting image row " << y_ptr
-            //      << ", write_ptr=" << write_ptr
-            //      << ", line_start=" << line_start
-            //      << ", read_ptr=" << (line_start+t_image_offset_x)*2
-            //      << std::endl;
-            for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-            {
-                read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
 
-                msb = odd[read_ptr];
-                lsb = odd[read_ptr + 1];
+    /* Keep the raw fields, e.g. to check the decoding off line. */
+    const char *dump_dir = getenv("DSI_FIELD_DUMP");
+    if (dump_dir != nullptr && !dumpFields(dump_dir, pipeline))
+        std::cerr << "cannot dump fields to " << dump_dir << std::endl;
 
-                framebuffer[write_ptr++] = msb;
-                framebuffer[write_ptr++] = lsb;
-            }
-        }
-    }
+    framebuffer = image.release();
+    return framebuffer;
+}
 
-    if (log_commands)
-        std::cerr << "write_ptr=" << write_ptr << std::endl;
+/**
+ * Trigger the next exposure of a continuous series with the settings of the
+ * last one.  Only short exposures are re-armed, a long one would hold the
+ * camera for nothing if the settings change in the meantime.
+ */
+void DSI::Device::rearmExposure()
+{
+    if (exposure_time >= LONGEXP)
+        return;
 
-    delete[] odd_data;
+    if (binning2x2)
+        enable2x2Binning();
 
-    if (interlaced)
-        delete[] even_data;
+    /* downloadImage() switched Vdd on for the readout (gs) */
+    if ((read_height_even == 0) && (!vdd_on) && (exposure_time >= VDD_TRH))
+        command(DeviceCommand::SET_VDD_MODE, VddMode::OFF.value());
 
-    return framebuffer;
+    command(DeviceCommand::TRIGGER);
+    gettimeofday(&armed_at, 0);
 
-    throw dsi_exception("unsupported image command");
+    armed         = true;
+    armed_binning = binning2x2;
 }
 
 /* ask camera for remaining exposure time for long exposures (gs) */
@@ -1086,8 +1065,6 @@ void DSI::Device::disable2x2Binning()
 
 unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
 {
-    int transfered = 0;
-
     if (((__command == DeviceCommand::TRIGGER)) || (__command == DeviceCommand::TEST_PATTERN))
     {
         // Monkey code.  Monkey see (SniffUSB), monkey do).  Some part of this
@@ -1095,7 +1072,6 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
         // to run the code.
         int status = 0;
         int interlaced = 0;
-        int rawtemp = 0;
 
         if (read_height_even > 0)
             interlaced = 1;
@@ -1296,16 +1272,8 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
             t_image_offset_y = 0;
         }
 
-        unsigned int odd_size  = t_read_bpp * t_read_width * t_read_height_odd;
-        unsigned int even_size = t_read_bpp * t_read_width * t_read_height_even;
-        unsigned int all_size  = t_read_bpp * t_read_width * t_read_height;
-        unsigned char *odd_data = new unsigned char[odd_size];
-        unsigned char *even_data = nullptr;
-
-        if (interlaced)
-            even_data = new unsigned char[even_size];
-
-        framebuffer = new unsigned char[all_size];
+        FieldLayout layout = { t_read_width,   t_read_height_even, t_read_height_odd, t_read_bpp,
+                               t_image_width,  t_image_height,     t_image_offset_x,  t_image_offset_y };
 
         /* The Meade driver seems to only issue a GET_EXP_TIME_COUNT command
          * when the exposure is over about 2 seconds (count = 20,000).  From
@@ -1325,131 +1293,7 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
         if (last_time == 0)
             last_time = get_sysclock_ms();
 
-        if (interlaced)
-        {
-            /* XXX: There has to be  a way to calculate a more optimal readout
-               time here. */
-            status = libusb_bulk_transfer(handle, 0x86, even_data, even_size, &transfered, 60000 * MILLISEC);
-            if (log_commands)
-            {
-                log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)even_data, 0);
-
-                std::cerr << std::dec << "read even data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                     << std::endl
-                     << "    requested " << even_size << " bytes " << t_read_width << " x " << t_read_height_even
-                     << " (even pixels)" << std::endl;
-            }
-
-            if (status < 0)
-            {
-                std::stringstream ss;
-                ss << std::dec << "read even data, status = (" << status << ") " << strerror(-status);
-                throw device_read_error(ss.str());
-            }
-        }
-
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transfered, 60000 * MILLISEC);
-        if (log_commands)
-        {
-            log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)even_data, 0);
-
-            std::cerr << std::dec << "read odd data, status = (" << status << ") " << (status > 0 ? "" : strerror(-status))
-                 << std::endl
-                 << "    requested " << odd_size << " bytes " << t_read_width << " x " << t_read_height_odd
-                 << " (odd pixels)" << std::endl;
-        }
-
-        if (status < 0)
-        {
-            std::stringstream ss;
-            ss << std::dec << "read odd data, status = (" << status << ") " << strerror(-status);
-            throw device_read_error(ss.str());
-        }
-
-        if (has_tempsensor)
-        {
-            rawtemp  = command(DeviceCommand::GET_TEMP);
-            ccd_temp = floor((float)rawtemp / 25.6) / 10.0;
-        }
-
-        status = command(DeviceCommand::GET_EXP_MODE);
-
-        disable2x2Binning();
-
-        unsigned char msb = 0, lsb = 0, is_odd = 0;
-        unsigned int x_ptr = 0, line_start = 0, y_ptr = 0, read_ptr = 0, write_ptr = 0;
-        char *even = (char *)even_data;
-        char *odd  = (char *)odd_data;
-
-        if (log_commands)
-            std::cerr << "t_image_height  =" << t_image_height << std::endl
-                 << "t_image_width   =" << t_image_width << std::endl
-                 << "t_image_offset_x=" << t_image_offset_x << std::endl
-                 << "t_image_offset_y=" << t_image_offset_y << std::endl
-                 << "t_read_width    =" << t_read_width << std::endl
-                 << "t_read_height   =" << t_read_height << std::endl
-                 << "t_read_bpp      =" << t_read_bpp << std::endl;
-
-        if (interlaced)
-        {
-            for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-            {
-                line_start = t_read_width * ((y_ptr + t_image_offset_y) / 2);
-                is_odd     = (y_ptr + t_image_offset_y) % 2;
-
-                std::cerr << "starting image row " << y_ptr << ", write_ptr=" << write_ptr << ", line_start=" << line_start
-                     << ", is_odd=" << (is_odd == 0 ? 0 : 1) << ", read_ptr=" << (line_start + t_image_offset_x) * 2
-                     << std::endl;
-                for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-                {
-                    read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-                    if (is_odd == 1) // odd line
-                    {
-                        msb = odd[read_ptr];
-                        lsb = odd[read_ptr + 1];
-                    }
-                    else
-                    { // even line
-                        msb = even[read_ptr];
-                        lsb = even[read_ptr + 1];
-                    }
-                    framebuffer[write_ptr++] = msb;
-                    framebuffer[write_ptr++] = lsb;
-                }
-            }
-        }
-        else
-        {
-            for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-            {
-                line_start = t_read_width * (y_ptr + t_image_offset_y);
-
-                //std::cerr << "starting image row " << y_ptr
-                //     << ", write_ptr=" << write_ptr
-                //     << ", line_start=" << line_start
-                //     << ", read_ptr=" << (line_start+t_image_offset_x)*2 << std::endl;
-                for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-                {
-                    read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-
-                    msb = odd[read_ptr];
-                    lsb = odd[read_ptr + 1];
-
-                    framebuffer[write_ptr++] = msb;
-                    framebuffer[write_ptr++] = lsb;
-                }
-            }
-        }
-
-        if (log_commands)
-            std::cerr << "write_ptr=" << write_ptr << std::endl;
-
-        delete[] odd_data;
-
-        if (interlaced)
-            delete[] even_data;
-
-        return framebuffer;
+        return readImage(layout, false);
     }
 
     throw dsi_exception("unsupported image command");
@@ -6,9 +6,11 @@
 
 #pragma once
 
+#include "DsiReadout.h"
 #include "DsiTypes.h"
 
 #include <libusb-1.0/libusb.h>
+#include <sys/time.h>
 
 #include <string>
 
@@ -88,6 +90,20 @@ class Device
     /* true if 2x2 binnig ist set for DSIIII (gs) */
     bool binning2x2;
 
+    /* In continuous mode the camera is triggered again with the same
+         * settings as soon as an image has been read out, so that the next
+         * exposure runs while the last one is processed.  armed is true while
+         * such an exposure is pending, armed_at is when it was triggered.
+         */
+    bool continuous;
+    bool armed;
+    bool armed_binning;
+    struct timeval armed_at;
+    /* When the exposure of the image startExposure() got was triggered. */
+    struct timeval exposure_start;
+    int exposure_gain;
+    int exposure_offset;
+
     /* Helper function for low-level diagnostics.  I use this to compare
          * what I think I'm sending with what a USB sniffer tells me my
          * command translates into.
@@ -177,6 +193,9 @@ class Device
 
     void sendRegister(AdRegister adr, unsigned int arg);
 
+    unsigned char *readImage(const FieldLayout &layout, bool rearm);
+    void rearmExposure();
+
   public:
     Device(const char *devname = 0);
     virtual ~Device();
@@ -212,6 +231,7 @@ class Device
     virtual unsigned char *downloadImage();
     virtual int startExposure(int howlong, int gain = 0, int offs = 0x0ff);
     virtual int ExposureInProgress();
+    virtual struct timeval getExposureStart() { return exposure_start; };
     virtual unsigned char *ccdFramebuffer();
 
     virtual void set1x1Binning();
@@ -223,6 +243,8 @@ class Device
     virtual int setGain(int gain);
 
     virtual void setVddOn(bool s);
+    virtual void setContinuous(bool c);
+    virtual bool isContinuous() { return continuous; };
 
     void setDebug(bool turnOn) { log_commands = turnOn; };
     bool isDebug() { return log_commands; }
@@ -0,0 +1,276 @@
+/*
+ * Image readout of the DSI cameras: field transfers and decoding.
+ *
+ */
+
+#include "DsiReadout.h"
+
+#include "DsiException.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+/* Image data comes from this endpoint. */
+#define IMAGE_ENDPOINT 0x86
+
+/* Longest we block in libusb before checking the timeout again, in ms. */
+#define EVENT_SLICE 100
+
+size_t DSI::FieldLayout::fieldSize(Field field) const
+{
+    return (size_t)read_bpp * read_width * (field == FIELD_EVEN ? read_height_even : read_height_odd);
+}
+
+size_t DSI::FieldLayout::imageSize() const
+{
+    return (size_t)read_bpp * image_width * image_height;
+}
+
+void DSI::decodeField(const FieldLayout &layout, Field field, const unsigned char *data, unsigned char *image)
+{
+    const size_t line_bytes = (size_t)layout.read_bpp * layout.read_width;
+    const size_t row_bytes  = (size_t)layout.read_bpp * layout.image_width;
+    const unsigned int lines = (field == FIELD_EVEN ? layout.read_height_even : layout.read_height_odd);
+
+    if (layout.image_offset_x + layout.image_width > layout.read_width)
+        return;
+
+    for (unsigned int y = 0; y < layout.image_height; y++)
+    {
+        unsigned int row  = y + layout.image_offset_y;
+        unsigned int line = row;
+
+        if (layout.interlaced())
+        {
+            if ((Field)(row % 2) != field)
+                continue;
+            line = row / 2;
+        }
+        else if (field != FIELD_ODD)
+            return;
+
+        if (line >= lines)
+            break;
+
+        memcpy(image + y * row_bytes, data + line * line_bytes + (size_t)layout.read_bpp * layout.image_offset_x,
+               row_bytes);
+    }
+}
+
+/******************************************************************************/
+
+DSI::UsbFieldReader::UsbFieldReader(libusb_device_handle *handle, bool log) : handle(handle), log_transfers(log), next(0)
+{
+}
+
+DSI::UsbFieldReader::~UsbFieldReader()
+{
+    cancel();
+}
+
+void LIBUSB_CALL DSI::UsbFieldReader::transferDone(libusb_transfer *transfer)
+{
+    ((Transfer *)transfer->user_data)->done = true;
+}
+
+void DSI::UsbFieldReader::submit(Field field, unsigned char *data, size_t length)
+{
+    Transfer *t  = new Transfer;
+    t->transfer  = libusb_alloc_transfer(0);
+    t->field     = field;
+    t->done      = false;
+
+    /* No libusb timeout: the reads are queued before the exposure is over,
+     * wait() enforces the timeout of each one as its turn comes. */
+    libusb_fill_bulk_transfer(t->transfer, handle, IMAGE_ENDPOINT, data, length, transferDone, t, 0);
+    transfers.push_back(t);
+
+    int status = libusb_submit_transfer(t->transfer);
+    if (status < 0)
+    {
+        t->done = true;
+        std::stringstream ss;
+        ss << std::dec << "submit " << (field == FIELD_EVEN ? "even" : "odd") << " data, status = (" << status << ") "
+           << libusb_error_name(status);
+        throw device_read_error(ss.str());
+    }
+
+    if (log_transfers)
+        std::cerr << "submitted " << (field == FIELD_EVEN ? "even" : "odd") << " field read of " << length << " bytes"
+                  << std::endl;
+}
+
+DSI::Field DSI::UsbFieldReader::wait(unsigned int timeout)
+{
+    if (next >= transfers.size())
+        throw device_read_error("no field read pending");
+
+    Transfer *t = transfers[next];
+    const char *name = (t->field == FIELD_EVEN ? "even" : "odd");
+
+    for (unsigned int waited = 0; !t->done; waited += EVENT_SLICE)
+    {
+        if (waited >= timeout)
+        {
+            cancel();
+            std::stringstream ss;
+            ss << "read " << name << " data timed out";
+            throw device_read_error(ss.str());
+        }
+
+        struct timeval tv = { 0, EVENT_SLICE * 1000 };
+        int status = libusb_handle_events_timeout_completed(nullptr, &tv, nullptr);
+        if (status < 0 && status != LIBUSB_ERROR_INTERRUPTED)
+        {
+            cancel();
+            std::stringstream ss;
+            ss << std::dec << "read " << name << " data, status = (" << status << ") " << libusb_error_name(status);
+            throw device_read_error(ss.str());
+        }
+    }
+    next++;
+
+    libusb_transfer *transfer = t->transfer;
+    if (log_transfers)
+        std::cerr << std::dec << "read " << name << " data, status = (" << transfer->status << ")" << std::endl
+                  << "    requested " << transfer->length << " bytes" << std::endl
+                  << "Transfered: " << transfer->actual_length << " bytes" << std::endl;
+
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+    {
+        std::stringstream ss;
+        ss << std::dec << "read " << name << " data, transfer status = (" << transfer->status << ")";
+        cancel();
+        throw device_read_error(ss.str());
+    }
+
+    return t->field;
+}
+
+void DSI::UsbFieldReader::cancel()
+{
+    for (Transfer *t : transfers)
+        if (!t->done)
+            libusb_cancel_transfer(t->transfer);
+
+    /* The buffers belong to libusb until every callback has run. */
+    for (Transfer *t : transfers)
+    {
+        while (!t->done)
+        {
+            struct timeval tv = { 0, EVENT_SLICE * 1000 };
+            if (libusb_handle_events_timeout_completed(nullptr, &tv, nullptr) < 0)
+                break;
+        }
+    }
+    release();
+}
+
+void DSI::UsbFieldReader::release()
+{
+    for (Transfer *t : transfers)
+    {
+        libusb_free_transfer(t->transfer);
+        delete t;
+    }
+    transfers.clear();
+    next = 0;
+}
+
+/******************************************************************************/
+
+DSI::FieldPipeline::FieldPipeline(FieldReader &reader, const FieldLayout &layout)
+    : reader(reader), layout(layout), fields(layout.interlaced() ? 2 : 1), received(0)
+{
+}
+
+DSI::FieldPipeline::~FieldPipeline()
+{
+    reader.cancel();
+}
+
+void DSI::FieldPipeline::submit()
+{
+    /* The camera sends the even field first. */
+    if (layout.interlaced())
+    {
+        data[FIELD_EVEN].resize(layout.fieldSize(FIELD_EVEN));
+        reader.submit(FIELD_EVEN, data[FIELD_EVEN].data(), data[FIELD_EVEN].size());
+    }
+    data[FIELD_ODD].resize(layout.fieldSize(FIELD_ODD));
+    reader.submit(FIELD_ODD, data[FIELD_ODD].data(), data[FIELD_ODD].size());
+}
+
+DSI::Field DSI::FieldPipeline::wait(unsigned int timeout)
+{
+    Field field = reader.wait(timeout);
+    received++;
+    return field;
+}
+
+void DSI::FieldPipeline::decode(Field field, unsigned char *image)
+{
+    decodeField(layout, field, data[field].data(), image);
+}
+
+/******************************************************************************/
+
+static bool writeFile(const std::string &path, const unsigned char *data, size_t length)
+{
+    std::ofstream out(path, std::ios::binary);
+    out.write((const char *)data, length);
+    return out.good();
+}
+
+static bool readFile(const std::string &path, std::vector<unsigned char> &data)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool DSI::dumpFields(const char *dir, const FieldPipeline &pipeline)
+{
+    const FieldLayout &layout = pipeline.getLayout();
+    std::string base(dir);
+
+    std::ofstream out(base + "/layout.txt");
+    out << layout.read_width << " " << layout.read_height_even << " " << layout.read_height_odd << " "
+        << layout.read_bpp << " " << layout.image_width << " " << layout.image_height << " " << layout.image_offset_x
+        << " " << layout.image_offset_y << std::endl;
+    if (!out.good())
+        return false;
+
+    if (layout.interlaced() &&
+        !writeFile(base + "/even.raw", pipeline.fieldData(FIELD_EVEN), layout.fieldSize(FIELD_EVEN)))
+        return false;
+    return writeFile(base + "/odd.raw", pipeline.fieldData(FIELD_ODD), layout.fieldSize(FIELD_ODD));
+}
+
+bool DSI::loadFields(const char *dir, FieldLayout &layout, std::vector<unsigned char> fields[2])
+{
+    std::string base(dir);
+
+    std::ifstream in(base + "/layout.txt");
+    in >> layout.read_width >> layout.read_height_even >> layout.read_height_odd >> layout.read_bpp >>
+        layout.image_width >> layout.image_height >> layout.image_offset_x >> layout.image_offset_y;
+    if (!in)
+        return false;
+
+    fields[FIELD_EVEN].clear();
+    if (layout.interlaced() && !readFile(base + "/even.raw", fields[FIELD_EVEN]))
+        return false;
+    if (!readFile(base + "/odd.raw", fields[FIELD_ODD]))
+        return false;
+
+    /* Short recordings are zero filled. */
+    fields[FIELD_EVEN].resize(layout.fieldSize(FIELD_EVEN));
+    fields[FIELD_ODD].resize(layout.fieldSize(FIELD_ODD));
+    return true;
+}
@@ -0,0 +1,138 @@
+/*
+ * Image readout of the DSI cameras: field transfers and decoding.
+ *
+ */
+
+#pragma once
+
+#include <libusb-1.0/libusb.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace DSI
+{
+/* Interlaced cameras (DSI I/II) send the even and the odd sensor rows as two
+ * fields, progressive ones (DSI III) send all rows as the odd field.
+ */
+enum Field
+{
+    FIELD_EVEN = 0,
+    FIELD_ODD  = 1
+};
+
+/* Geometry of one readout.  Widths and offsets are in pixels, field lines
+ * are read_width pixels of read_bpp bytes, big endian.
+ */
+struct FieldLayout
+{
+    unsigned int read_width;
+    unsigned int read_height_even;
+    unsigned int read_height_odd;
+    unsigned int read_bpp;
+    unsigned int image_width;
+    unsigned int image_height;
+    unsigned int image_offset_x;
+    unsigned int image_offset_y;
+
+    bool interlaced() const { return read_height_even > 0; }
+    size_t fieldSize(Field field) const;
+    size_t imageSize() const;
+};
+
+/**
+ * Copy the image rows carried by one field into the image, which is
+ * image_width x image_height pixels of read_bpp bytes, in the byte order of
+ * the camera.  Rows of the other field are left alone, so fields can be
+ * decoded in any order as they arrive.
+ */
+void decodeField(const FieldLayout &layout, Field field, const unsigned char *data, unsigned char *image);
+
+/* Source of field data.  The USB implementation is below, anything else
+ * (e.g. recorded fields) can stand in for it.
+ */
+class FieldReader
+{
+  public:
+    virtual ~FieldReader() {}
+
+    /* Queue the read of a field into data. */
+    virtual void submit(Field field, unsigned char *data, size_t length) = 0;
+
+    /* Wait up to timeout ms for the next submitted field to be complete.
+     * Throws device_read_error if it fails or times out.
+     */
+    virtual Field wait(unsigned int timeout) = 0;
+
+    /* Drop the reads still queued. */
+    virtual void cancel() = 0;
+};
+
+/* Asynchronous bulk transfers from the image endpoint.  Every field read
+ * is submitted at once, so the camera streams the odd field right after the
+ * even one while the even one is being decoded.
+ */
+class UsbFieldReader : public FieldReader
+{
+  public:
+    UsbFieldReader(libusb_device_handle *handle, bool log = false);
+    virtual ~UsbFieldReader();
+
+    virtual void submit(Field field, unsigned char *data, size_t length) override;
+    virtual Field wait(unsigned int timeout) override;
+    virtual void cancel() override;
+
+  private:
+    struct Transfer
+    {
+        libusb_transfer *transfer;
+        Field field;
+        bool done;
+    };
+
+    static void LIBUSB_CALL transferDone(libusb_transfer *transfer);
+    void release();
+
+    libusb_device_handle *handle;
+    bool log_transfers;
+    std::vector<Transfer *> transfers;
+    size_t next;
+};
+
+/* Reads the fields of one image and decodes each as soon as it is in:
+ *
+ *     pipeline.submit();
+ *     while (!pipeline.done())
+ *         pipeline.decode(pipeline.wait(timeout), image);
+ */
+class FieldPipeline
+{
+  public:
+    FieldPipeline(FieldReader &reader, const FieldLayout &layout);
+    /* Cancels the reads still pending, which write into the field buffers. */
+    ~FieldPipeline();
+
+    void submit();
+    Field wait(unsigned int timeout);
+    void decode(Field field, unsigned char *image);
+
+    /* True once every field has been received. */
+    bool done() const { return received == fields; }
+
+    const unsigned char *fieldData(Field field) const { return data[field].data(); }
+    const FieldLayout &getLayout() const { return layout; }
+
+  private:
+    FieldReader &reader;
+    FieldLayout layout;
+    std::vector<unsigned char> data[2];
+    int fields;
+    int received;
+};
+
+/* Recorded fields: layout.txt holds the FieldLayout members in order, even.raw
+ * and odd.raw the field data as read from the camera.
+ */
+bool dumpFields(const char *dir, const FieldPipeline &pipeline);
+bool loadFields(const char *dir, FieldLayout &layout, std::vector<unsigned char> fields[2]);
+};
@@ -25,6 +25,7 @@
 
 #include <iostream>
 #include <math.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
@@ -203,6 +204,14 @@ bool DSICCD::initProperties()
     IUFillSwitchVector(&VddExpSP, VddExpS, 2, getDeviceName(), "DSI III exposure", "", IMAGE_SETTINGS_TAB, IP_RW,
                        ISR_1OFMANY, 0, IPS_IDLE);
 
+    /* In continuous mode the camera starts the next exposure as soon as an
+       image has been read out, so a series of short exposures with the same
+       settings (e.g. while focusing) does not wait for each trigger.        */
+    IUFillSwitch(&ContinuousS[0], "INDI_ENABLED", "On", ISS_OFF);
+    IUFillSwitch(&ContinuousS[1], "INDI_DISABLED", "Off", ISS_ON);
+    IUFillSwitchVector(&ContinuousSP, ContinuousS, 2, getDeviceName(), "DSI_CONTINUOUS", "Continuous", IMAGE_SETTINGS_TAB,
+                       IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
     /* Add Temp number property (gs) */
 
     IUFillNumber(CCDTempN, "CCDTEMP", "CCD Temperature [°C]", "%.1f", -128.5, 128.5, 0.1, -128.5);
@@ -242,6 +251,7 @@ bool DSICCD::updateProperties()
         defineNumber(&OffsetNP);
         defineNumber(&CCDTempNP);
         defineSwitch(&VddExpSP);
+        defineSwitch(&ContinuousSP);
     }
     else
     {
@@ -249,6 +259,7 @@ bool DSICCD::updateProperties()
         deleteProperty(OffsetNP.name);
         deleteProperty(CCDTempNP.name);
         deleteProperty(VddExpSP.name);
+        deleteProperty(ContinuousSP.name);
     }
 
     return true;
@@ -327,6 +338,10 @@ bool DSICCD::StartExposure(float duration)
 
     dsi->startExposure(duration * 10000, gain, offset);
 
+    /* In continuous mode the image may have been triggered with the readout
+       of the last one */
+    ExpStart = dsi->getExposureStart();
+
     return true;
 }
 
@@ -415,6 +430,21 @@ bool DSICCD::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
 
             return true;
         }
+
+        if (!strcmp(name, ContinuousSP.name))
+        {
+            if (IUUpdateSwitch(&ContinuousSP, states, names, n) < 0)
+                return false;
+
+            index = IUFindOnSwitchIndex(&ContinuousSP);
+
+            dsi->setContinuous(index == 0);
+
+            ContinuousSP.s = IPS_OK;
+            IDSetSwitch(&ContinuousSP, index == 0 ? "Continuous mode is ON" : "Continuous mode is OFF");
+
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
@@ -485,10 +515,28 @@ bool DSICCD::saveConfigItems(FILE *fp)
     IUSaveConfigNumber(fp, &GainNP);
     IUSaveConfigNumber(fp, &OffsetNP);
     IUSaveConfigSwitch(fp, &VddExpSP);
+    IUSaveConfigSwitch(fp, &ContinuousSP);
 
     return true;
 }
 
+/*******************************************************************************
+ * Date the image by its trigger, INDI::CCD only knows when it was requested
+*******************************************************************************/
+
+void DSICCD::addFITSKeywords(fitsfile *fptr, INDI::CCDChip *targetChip)
+{
+    INDI::CCD::addFITSKeywords(fptr, targetChip);
+
+    char iso8601[32], dateObs[40];
+    time_t t = ExpStart.tv_sec;
+    strftime(iso8601, sizeof(iso8601), "%Y-%m-%dT%H:%M:%S", gmtime(&t));
+    snprintf(dateObs, sizeof(dateObs), "%s.%06ld", iso8601, (long)ExpStart.tv_usec);
+
+    int status = 0;
+    fits_update_key_str(fptr, "DATE-OBS", dateObs, "UTC start of exposure", &status);
+}
+
 /*******************************************************************************
  * Download image from DSI
 *******************************************************************************/
@@ -525,7 +573,7 @@ void DSICCD::grabImage()
         }
     }
 
-    delete buf;
+    delete[] (unsigned char *)buf;
 
     // Let INDI::CCD know we're done filling the image buffer
     ExposureComplete(&PrimaryCCD);
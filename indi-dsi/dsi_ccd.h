@@ -51,6 +51,7 @@ class DSICCD : public INDI::CCD
 
     // misc functions
     virtual bool saveConfigItems(FILE *fp) override;
+    virtual void addFITSKeywords(fitsfile *fptr, INDI::CCDChip *targetChip) override;
 
   private:
     // Utility functions
@@ -75,6 +76,9 @@ class DSICCD : public INDI::CCD
     ISwitch VddExpS[2];
     ISwitchVectorProperty VddExpSP;
 
+    ISwitch ContinuousS[2];
+    ISwitchVectorProperty ContinuousSP;
+
     INumber OffsetN[1];
     INumberVectorProperty OffsetNP;
 
@@ -0,0 +1,251 @@
+/*
+ * Field decoding check and readout benchmark for the DSI cameras.
+ *
+ * Checks decodeField() against a pixel by pixel decode for the layouts of
+ * the DSI models, then times the readout of an image, fields read one after
+ * the other and decoded at the end versus the field pipeline.  The camera is
+ * replaced by a reader which hands out the fields at USB 2.0 speed:
+ *
+ *     dsi_readout_bench [dump dir] [rounds]
+ *
+ * The fields of a real camera are used when the driver ran with
+ * DSI_FIELD_DUMP=<dump dir>, synthetic ones otherwise.
+ */
+
+#include "DsiReadout.h"
+
+#include "DsiException.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Sustained bulk rate of the image endpoint, bytes per second. */
+#define USB_RATE 30e6
+
+typedef std::chrono::steady_clock Clock;
+
+/* Stands in for the camera: every field submitted completes at the rate of
+ * the USB bus, after the ones queued before it.
+ */
+class ReplayReader : public DSI::FieldReader
+{
+  public:
+    ReplayReader(const std::vector<unsigned char> *fields) : fields(fields) {}
+
+    virtual void submit(DSI::Field field, unsigned char *data, size_t length) override
+    {
+        Clock::time_point start = Clock::now();
+        if (!queue.empty() && queue.back().due > start)
+            start = queue.back().due;
+
+        Read r;
+        r.field  = field;
+        r.data   = data;
+        r.length = length;
+        r.due    = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(length / USB_RATE));
+        queue.push_back(r);
+    }
+
+    virtual DSI::Field wait(unsigned int) override
+    {
+        if (queue.empty())
+            throw DSI::device_read_error("no field read pending");
+
+        Read r = queue.front();
+        queue.pop_front();
+        std::this_thread::sleep_until(r.due);
+
+        const std::vector<unsigned char> &src = fields[r.field];
+        memcpy(r.data, src.data(), std::min(r.length, src.size()));
+        return r.field;
+    }
+
+    virtual void cancel() override { queue.clear(); }
+
+  private:
+    struct Read
+    {
+        DSI::Field field;
+        unsigned char *data;
+        size_t length;
+        Clock::time_point due;
+    };
+
+    const std::vector<unsigned char> *fields;
+    std::deque<Read> queue;
+};
+
+/* The decode the driver did before the pipeline. */
+static void referenceDecode(const DSI::FieldLayout &l, const unsigned char *even, const unsigned char *odd,
+                            unsigned char *image)
+{
+    unsigned int write_ptr = 0;
+
+    for (unsigned int y = 0; y < l.image_height; y++)
+    {
+        unsigned int row        = y + l.image_offset_y;
+        unsigned int line_start = l.read_width * (l.interlaced() ? row / 2 : row);
+        const unsigned char *src = (l.interlaced() && row % 2 == 0) ? even : odd;
+
+        for (unsigned int x = 0; x < l.image_width; x++)
+        {
+            unsigned int read_ptr = (line_start + x + l.image_offset_x) * 2;
+
+            image[write_ptr++] = src[read_ptr];
+            image[write_ptr++] = src[read_ptr + 1];
+        }
+    }
+}
+
+/* Layout of a readout as DSI::Device::downloadImage() computes it. */
+static DSI::FieldLayout cameraLayout(unsigned int width, unsigned int even, unsigned int odd, unsigned int image_width,
+                                     unsigned int image_height, unsigned int offset_x, unsigned int offset_y,
+                                     bool binning2x2)
+{
+    unsigned int div = binning2x2 ? 2 : 1;
+    DSI::FieldLayout l;
+
+    l.read_width       = ((2 * width / 512) + 1) * 256 / div;
+    l.read_height_even = even / div;
+    l.read_height_odd  = odd / div;
+    l.read_bpp         = 2;
+    l.image_width      = image_width / div;
+    l.image_height     = image_height / div;
+    l.image_offset_x   = offset_x / div;
+    l.image_offset_y   = offset_y / div;
+    return l;
+}
+
+static void fillFields(const DSI::FieldLayout &l, std::vector<unsigned char> fields[2])
+{
+    unsigned int seed = 12345;
+
+    for (int f = 0; f < 2; f++)
+    {
+        fields[f].resize(l.fieldSize((DSI::Field)f));
+        for (unsigned char &b : fields[f])
+        {
+            seed = seed * 1103515245 + 12345;
+            b    = seed >> 16;
+        }
+    }
+}
+
+static bool check(const char *name, const DSI::FieldLayout &l, const std::vector<unsigned char> fields[2])
+{
+    std::vector<unsigned char> expected(l.imageSize()), image(l.imageSize());
+
+    referenceDecode(l, fields[DSI::FIELD_EVEN].data(), fields[DSI::FIELD_ODD].data(), expected.data());
+
+    /* The odd field may come in first, the result must not depend on it. */
+    DSI::decodeField(l, DSI::FIELD_ODD, fields[DSI::FIELD_ODD].data(), image.data());
+    if (l.interlaced())
+        DSI::decodeField(l, DSI::FIELD_EVEN, fields[DSI::FIELD_EVEN].data(), image.data());
+
+    if (image != expected)
+    {
+        fprintf(stderr, "%s: decoded image differs\n", name);
+        return false;
+    }
+    printf("%s: %ux%u %s image decoded\n", name, l.image_width, l.image_height,
+           l.interlaced() ? "interlaced" : "progressive");
+    return true;
+}
+
+static double sequential(const DSI::FieldLayout &l, const std::vector<unsigned char> fields[2], unsigned char *image)
+{
+    ReplayReader reader(fields);
+    std::vector<unsigned char> even(l.fieldSize(DSI::FIELD_EVEN)), odd(l.fieldSize(DSI::FIELD_ODD));
+
+    Clock::time_point start = Clock::now();
+    if (l.interlaced())
+    {
+        reader.submit(DSI::FIELD_EVEN, even.data(), even.size());
+        reader.wait(0);
+    }
+    reader.submit(DSI::FIELD_ODD, odd.data(), odd.size());
+    reader.wait(0);
+    referenceDecode(l, even.data(), odd.data(), image);
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double pipelined(const DSI::FieldLayout &l, const std::vector<unsigned char> fields[2], unsigned char *image)
+{
+    ReplayReader reader(fields);
+    DSI::FieldPipeline pipeline(reader, l);
+
+    Clock::time_point start = Clock::now();
+    pipeline.submit();
+    while (!pipeline.done())
+        pipeline.decode(pipeline.wait(0), image);
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void bench(const char *name, const DSI::FieldLayout &l, const std::vector<unsigned char> fields[2], int rounds)
+{
+    std::vector<unsigned char> image(l.imageSize());
+    double seq = 0, pipe = 0;
+
+    for (int i = 0; i < rounds; i++)
+    {
+        seq += sequential(l, fields, image.data());
+        pipe += pipelined(l, fields, image.data());
+    }
+    printf("%s: sequential %.2f ms, pipelined %.2f ms per image\n", name, seq / rounds, pipe / rounds);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dump = argc > 1 ? argv[1] : nullptr;
+    int rounds       = argc > 2 ? atoi(argv[2]) : 20;
+
+    struct
+    {
+        const char *name;
+        DSI::FieldLayout layout;
+    } cameras[] = {
+        { "DSI Pro", cameraLayout(537, 253, 252, 508, 488, 23, 13, false) },
+        { "DSI Color II", cameraLayout(795, 299, 298, 748, 577, 30, 13, false) },
+        { "DSI Pro III", cameraLayout(1434, 0, 1050, 1360, 1024, 30, 13, false) },
+        { "DSI Pro III 2x2", cameraLayout(1434, 0, 1050, 1360, 1024, 30, 13, true) },
+    };
+
+    std::vector<unsigned char> fields[2];
+    bool ok = true;
+
+    for (auto &c : cameras)
+    {
+        fillFields(c.layout, fields);
+        ok = check(c.name, c.layout, fields) && ok;
+    }
+
+    if (dump != nullptr)
+    {
+        DSI::FieldLayout l;
+        if (!DSI::loadFields(dump, l, fields))
+        {
+            fprintf(stderr, "Cannot load the fields from %s\n", dump);
+            return 1;
+        }
+        ok = check(dump, l, fields) && ok;
+        if (ok)
+            bench(dump, l, fields, rounds);
+    }
+    else if (ok)
+    {
+        for (auto &c : cameras)
+        {
+            fillFields(c.layout, fields);
+            bench(c.name, c.layout, fields, rounds);
+        }
+    }
+
+    return ok ? 0 : 1;
+}
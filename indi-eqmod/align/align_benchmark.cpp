@@ -0,0 +1,187 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    Align Benchmark
+
+    Fills the alignment point set with synthetic sync points spread over the sphere and times
+    the nearest point and containing face lookups done on every tracking poll, against a
+    linear scan of the points as previously done by PointSet::ComputeDistances.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "eqmodbase.h"
+#include "align/pointset.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+#include <set>
+
+#define QUERIES 20000
+// the linear scan is only timed on the first queries
+#define LINEAR_QUERIES 1000
+
+static double uniform(double min, double max)
+{
+    return min + (max - min) * rand() / RAND_MAX;
+}
+
+static double elapsedUS(std::chrono::steady_clock::time_point start, int count)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+/* Same distance and ordering as the former PointSet::ComputeDistances */
+static double haversine(double theta1, double theta2, double phi1, double phi2)
+{
+    double sqrt_haversin_lat  = sin(((phi2 - phi1) / 2) * (M_PI / 180));
+    double sqrt_haversin_long = sin(((theta2 - theta1) / 2) * (M_PI / 180));
+    return (2 * asin(sqrt((sqrt_haversin_lat * sqrt_haversin_lat) +
+                          cos(phi1 * (M_PI / 180)) * cos(phi2 * (M_PI / 180)) * (sqrt_haversin_long * sqrt_haversin_long))));
+}
+
+static bool compelt(PointSet::Distance d1, PointSet::Distance d2)
+{
+    return d1.value < d2.value;
+}
+
+static bool run(EQMod &scope, int count)
+{
+    struct ln_lnlat_posn position;
+    PointSet pointset(&scope);
+    std::vector<PointSet::Point *> points;
+    std::vector<PointSet::Distance> nearest;
+    int mismatches = 0, found = 0;
+    double linear, indexed;
+
+    position.lat = 50.0;
+    position.lng = 15.0;
+    pointset.Init();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        AlignData data;
+        double alt, az;
+        data.lst          = 0.0;
+        data.jd           = -1.0;
+        data.targetRA     = uniform(0.0, 24.0);
+        data.targetDEC    = asin(uniform(-1.0, 1.0)) * 180.0 / M_PI;
+        data.telescopeRA  = pointset.range24(data.targetRA + uniform(-0.01, 0.01));
+        data.telescopeDEC = std::max(-90.0, std::min(90.0, data.targetDEC + uniform(-0.1, 0.1)));
+        pointset.AddPoint(data, &position);
+        pointset.AltAzFromRaDecSidereal(data.targetRA, data.targetDEC, data.lst, &alt, &az, &position);
+        points.push_back(pointset.getPoint(cc_radec2ID(az, alt, 19)));
+    }
+    double build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // nearest point, the first query also builds the index
+    start = std::chrono::steady_clock::now();
+    pointset.ComputeDistances(0.0, 0.0, PointSet::None, true, 1, nearest);
+    double indexing = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> alts, azs;
+    for (int i = 0; i < QUERIES; i++)
+    {
+        alts.push_back(asin(uniform(-1.0, 1.0)) * 180.0 / M_PI);
+        azs.push_back(uniform(0.0, 360.0));
+    }
+
+    std::vector<HtmID> expected;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LINEAR_QUERIES; i++)
+    {
+        std::set<PointSet::Distance, bool (*)(PointSet::Distance, PointSet::Distance)> distances(compelt);
+        for (PointSet::Point *p : points)
+        {
+            PointSet::Distance elt;
+            elt.htmID = p->htmID;
+            elt.value = haversine(azs[i], p->celestialAZ, alts[i], p->celestialALT);
+            distances.insert(elt);
+        }
+        expected.push_back(distances.begin()->htmID);
+    }
+    linear = elapsedUS(start, LINEAR_QUERIES);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < QUERIES; i++)
+    {
+        pointset.ComputeDistances(alts[i], azs[i], PointSet::None, true, 1, nearest);
+        if (i < LINEAR_QUERIES && nearest.front().htmID != expected[i])
+            mismatches++;
+    }
+    indexed = elapsedUS(start, QUERIES);
+
+    fprintf(stderr, "%6d points %6d faces: build %.2f s, index %.2f ms\n", count, pointset.getNbTriangles(), build,
+            indexing);
+    fprintf(stderr, "    nearest point: linear %9.2f us, indexed %6.2f us, %d mismatches\n", linear, indexed,
+            mismatches);
+
+    // containing face while tracking, one query per second of time
+    double ra = uniform(0.0, 24.0), dec = uniform(-60.0, 60.0), jd = 2459000.5;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < QUERIES; i++)
+    {
+        if (pointset.findFace(ra, dec, jd + i / 86400.0, 0.0, 0.0, &position, true).size() == 3)
+            found++;
+    }
+    fprintf(stderr, "    tracking face: %6.2f us (%d/%d inside)\n", elapsedUS(start, QUERIES), found, QUERIES);
+
+    // containing face after slews to random targets
+    found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < QUERIES; i++)
+    {
+        std::vector<HtmID> face =
+            pointset.findFace(uniform(0.0, 24.0), uniform(-90.0, 90.0), jd, 0.0, 0.0, &position, false);
+        if (face.size() == 3)
+            found++;
+    }
+    fprintf(stderr, "    slewing face:  %6.2f us (%d/%d inside)\n", elapsedUS(start, QUERIES), found, QUERIES);
+
+    pointset.Reset();
+    return mismatches == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> counts;
+    bool success = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (atoi(argv[i]) <= 0)
+        {
+            fprintf(stderr, "Usage: %s [points...]\n", argv[0]);
+            return -1;
+        }
+        counts.push_back(atoi(argv[i]));
+    }
+    if (counts.empty())
+        counts = { 1000, 2000, 5000, 10000 };
+
+    INDI::Logger::getInstance().configure("", INDI::Logger::file_off, INDI::Logger::DBG_ERROR,
+                                          INDI::Logger::DBG_ERROR);
+    me = strdup("indi_eqmod_align_benchmark");
+    srand(1);
+
+    EQMod scope;
+    for (int count : counts)
+        success &= run(scope, count);
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,440 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "convexhull.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+// Volumes and cross products below these are taken as null, coordinates are about the unit
+#define HULL_VOLUME_EPSILON 1E-15
+#define HULL_AREA_EPSILON   1E-15
+
+ConvexHull::ConvexHull()
+{
+    clear();
+}
+
+void ConvexHull::clear()
+{
+    vertices.clear();
+    pending.clear();
+    clearFaces();
+}
+
+void ConvexHull::clearFaces()
+{
+    edges.clear();
+    faces.clear();
+    freeedges.clear();
+    freefaces.clear();
+    nbfaces = 0;
+    built   = false;
+}
+
+int ConvexHull::addVertex(double x, double y, double z)
+{
+    Vertex vertex;
+    vertex.v[0]      = x;
+    vertex.v[1]      = y;
+    vertex.v[2]      = z;
+    vertex.duplicate = -1;
+    vertices.push_back(vertex);
+    return vertices.size() - 1;
+}
+
+int ConvexHull::addPoint(double x, double y, double z)
+{
+    int v = addVertex(x, y, z);
+    insert(v);
+    return v;
+}
+
+bool ConvexHull::insert(int v)
+{
+    if (built)
+        return addOne(v);
+    pending.push_back(v);
+    return buildTetrahedron();
+}
+
+void ConvexHull::getFaces(std::vector<Triangle> &triangles) const
+{
+    triangles.clear();
+    for (const Face &f : faces)
+    {
+        if (f.alive)
+            triangles.push_back(Triangle { { f.vertex[0], f.vertex[1], f.vertex[2] } });
+    }
+}
+
+/* Same sign convention as chull.c VolumeSign: negative iff p sees the face */
+int ConvexHull::volumeSign(const Face &f, int p) const
+{
+    const double *pv = vertices[p].v;
+    const double *a = vertices[f.vertex[0]].v, *b = vertices[f.vertex[1]].v, *c = vertices[f.vertex[2]].v;
+    double ax = a[0] - pv[0], ay = a[1] - pv[1], az = a[2] - pv[2];
+    double bx = b[0] - pv[0], by = b[1] - pv[1], bz = b[2] - pv[2];
+    double cx = c[0] - pv[0], cy = c[1] - pv[1], cz = c[2] - pv[2];
+    double vol = ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+
+    if (vol > HULL_VOLUME_EPSILON)
+        return 1;
+    else if (vol < -HULL_VOLUME_EPSILON)
+        return -1;
+    return 0;
+}
+
+bool ConvexHull::collinear(int a, int b, int c) const
+{
+    const double *va = vertices[a].v, *vb = vertices[b].v, *vc = vertices[c].v;
+    double ux = vb[0] - va[0], uy = vb[1] - va[1], uz = vb[2] - va[2];
+    double wx = vc[0] - va[0], wy = vc[1] - va[1], wz = vc[2] - va[2];
+    double nx = uy * wz - uz * wy, ny = uz * wx - ux * wz, nz = ux * wy - uy * wx;
+    return nx * nx + ny * ny + nz * nz <= HULL_AREA_EPSILON * HULL_AREA_EPSILON;
+}
+
+int ConvexHull::makeEdge()
+{
+    int e;
+    if (freeedges.empty())
+    {
+        e = edges.size();
+        edges.push_back(Edge());
+    }
+    else
+    {
+        e = freeedges.back();
+        freeedges.pop_back();
+    }
+    Edge &edge      = edges[e];
+    edge.adjface[0] = edge.adjface[1] = edge.newface = -1;
+    edge.endpts[0] = edge.endpts[1] = -1;
+    edge.removed                    = false;
+    return e;
+}
+
+int ConvexHull::makeFace()
+{
+    int f;
+    if (freefaces.empty())
+    {
+        f = faces.size();
+        faces.push_back(Face());
+    }
+    else
+    {
+        f = freefaces.back();
+        freefaces.pop_back();
+    }
+    Face &face = faces[f];
+    for (int i = 0; i < 3; i++)
+        face.edge[i] = face.vertex[i] = -1;
+    face.visible = false;
+    face.alive   = true;
+    nbfaces++;
+    return f;
+}
+
+void ConvexHull::releaseFace(int f)
+{
+    faces[f].alive   = false;
+    faces[f].visible = false;
+    freefaces.push_back(f);
+    nbfaces--;
+}
+
+/* DoubleTriangle of chull.c, waits for more vertices instead of exiting on degenerate input */
+bool ConvexHull::buildTetrahedron()
+{
+    int v0 = pending[0], v1 = -1, v2 = -1, v3 = -1;
+
+    for (size_t i = 1; i < pending.size() && v2 < 0; i++)
+    {
+        if (v1 < 0)
+        {
+            const double *a = vertices[v0].v, *b = vertices[pending[i]].v;
+            if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2])
+                v1 = pending[i];
+        }
+        else if (!collinear(v0, v1, pending[i]))
+            v2 = pending[i];
+    }
+    if (v2 < 0)
+        return false;
+
+    // Create the two twin faces sharing the same edges, in opposite order
+    int f0 = makeFace(), f1 = makeFace();
+    int tri[3] = { v0, v1, v2 };
+    for (int k = 0; k < 3; k++)
+    {
+        int e                = makeEdge();
+        edges[e].endpts[0]   = tri[k];
+        edges[e].endpts[1]   = tri[(k + 1) % 3];
+        edges[e].adjface[0]  = f0;
+        edges[e].adjface[1]  = f1;
+        faces[f0].edge[k]    = e;
+        faces[f0].vertex[k]  = tri[k];
+        faces[f1].edge[2 - k] = e;
+        faces[f1].vertex[k]  = tri[2 - k];
+    }
+
+    for (size_t i = 0; i < pending.size() && v3 < 0; i++)
+    {
+        if (volumeSign(faces[f0], pending[i]) != 0)
+            v3 = pending[i];
+    }
+    if (v3 < 0)
+    {
+        // all coplanar so far
+        clearFaces();
+        return false;
+    }
+
+    // v3 sees one of the twin faces
+    built = true;
+    addOne(v3);
+    for (int v : pending)
+    {
+        if (v != v0 && v != v1 && v != v2 && v != v3)
+            addOne(v);
+    }
+    pending.clear();
+    return true;
+}
+
+/* AddOne of chull.c followed by its CleanUp */
+bool ConvexHull::addOne(int p)
+{
+    int start = -1;
+
+    // Recently created faces are the most likely to be seen by the next sync point
+    for (int f = faces.size() - 1; f >= 0 && start < 0; f--)
+    {
+        if (faces[f].alive && volumeSign(faces[f], p) < 0)
+            start = f;
+    }
+    if (start < 0)
+        return false;
+
+    // The visible region is connected, flood it through the edges
+    visiblefaces.clear();
+    stack.clear();
+    faces[start].visible = true;
+    visiblefaces.push_back(start);
+    stack.push_back(start);
+    while (!stack.empty())
+    {
+        int f = stack.back();
+        stack.pop_back();
+        for (int k = 0; k < 3; k++)
+        {
+            const Edge &e = edges[faces[f].edge[k]];
+            int g         = (e.adjface[0] == f) ? e.adjface[1] : e.adjface[0];
+            if (!faces[g].visible && volumeSign(faces[g], p) < 0)
+            {
+                faces[g].visible = true;
+                visiblefaces.push_back(g);
+                stack.push_back(g);
+            }
+        }
+    }
+
+    // Interior edges of the visible region go away, a cone face is erected on each border edge
+    horizon.clear();
+    removededges.clear();
+    for (int f : visiblefaces)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int e = faces[f].edge[k];
+            if (faces[edges[e].adjface[0]].visible && faces[edges[e].adjface[1]].visible)
+            {
+                if (!edges[e].removed)
+                {
+                    edges[e].removed = true;
+                    removededges.push_back(e);
+                }
+            }
+            else if (edges[e].newface < 0)
+            {
+                int cone         = makeConeFace(e, p);
+                edges[e].newface = cone;
+                horizon.push_back(e);
+            }
+        }
+    }
+
+    // CleanEdges, CleanFaces and CleanVertices
+    for (int e : horizon)
+    {
+        Edge &edge = edges[e];
+        if (faces[edge.adjface[0]].visible)
+            edge.adjface[0] = edge.newface;
+        else
+            edge.adjface[1] = edge.newface;
+        edge.newface                         = -1;
+        vertices[edge.endpts[0]].duplicate = -1;
+        vertices[edge.endpts[1]].duplicate = -1;
+    }
+    for (int e : removededges)
+        freeedges.push_back(e);
+    for (int f : visiblefaces)
+        releaseFace(f);
+    return true;
+}
+
+int ConvexHull::makeConeFace(int e, int p)
+{
+    int newedge[2];
+
+    // Make two new edges, unless already made for the neighbour border edge
+    for (int i = 0; i < 2; i++)
+    {
+        int v = edges[e].endpts[i];
+        if ((newedge[i] = vertices[v].duplicate) < 0)
+        {
+            newedge[i]                    = makeEdge();
+            edges[newedge[i]].endpts[0] = v;
+            edges[newedge[i]].endpts[1] = p;
+            vertices[v].duplicate       = newedge[i];
+        }
+    }
+
+    int f            = makeFace();
+    faces[f].edge[0] = e;
+    faces[f].edge[1] = newedge[0];
+    faces[f].edge[2] = newedge[1];
+    makeCcw(f, e, p);
+
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            if (edges[newedge[i]].adjface[j] < 0)
+            {
+                edges[newedge[i]].adjface[j] = f;
+                break;
+            }
+        }
+    }
+    return f;
+}
+
+/* Give f the orientation of the visible face adjacent to e, p is always the third vertex */
+void ConvexHull::makeCcw(int f, int e, int p)
+{
+    const Edge &edge = edges[e];
+    const Face &fv   = faces[edge.adjface[0]].visible ? faces[edge.adjface[0]] : faces[edge.adjface[1]];
+    Face &face       = faces[f];
+    int i;
+
+    for (i = 0; fv.vertex[i] != edge.endpts[0]; ++i)
+        ;
+    if (fv.vertex[(i + 1) % 3] != edge.endpts[1])
+    {
+        face.vertex[0] = edge.endpts[1];
+        face.vertex[1] = edge.endpts[0];
+    }
+    else
+    {
+        face.vertex[0] = edge.endpts[0];
+        face.vertex[1] = edge.endpts[1];
+        std::swap(face.edge[1], face.edge[2]);
+    }
+    face.vertex[2] = p;
+}
+
+bool ConvexHull::restore(const std::vector<Triangle> &triangles)
+{
+    std::map<std::pair<int, int>, int> edgemap;
+    std::set<int> used;
+    bool valid = triangles.size() >= 4;
+
+    clearFaces();
+
+    for (size_t t = 0; t < triangles.size() && valid; t++)
+    {
+        const Triangle &tri = triangles[t];
+        for (int k = 0; k < 3 && valid; k++)
+            valid = tri[k] >= 0 && tri[k] < (int)vertices.size() && tri[k] != tri[(k + 1) % 3];
+        if (!valid)
+            break;
+
+        int f = makeFace();
+        for (int k = 0; k < 3 && valid; k++)
+        {
+            int a = tri[k], b = tri[(k + 1) % 3];
+            faces[f].vertex[k] = a;
+            auto it            = edgemap.find(std::make_pair(std::min(a, b), std::max(a, b)));
+            if (it == edgemap.end())
+            {
+                int e                                                   = makeEdge();
+                edges[e].endpts[0]                                      = a;
+                edges[e].endpts[1]                                      = b;
+                edges[e].adjface[0]                                     = f;
+                edgemap[std::make_pair(std::min(a, b), std::max(a, b))] = e;
+                faces[f].edge[k]                                        = e;
+            }
+            else
+            {
+                // the second face of an edge runs it the other way
+                Edge &edge = edges[it->second];
+                valid      = edge.adjface[1] < 0 && edge.endpts[0] == b && edge.endpts[1] == a;
+                edge.adjface[1]  = f;
+                faces[f].edge[k] = it->second;
+            }
+            used.insert(a);
+        }
+    }
+
+    // closed surface of genus 0
+    for (size_t e = 0; e < edges.size() && valid; e++)
+        valid = edges[e].adjface[1] >= 0;
+    valid = valid && (used.size() + faces.size() == edges.size() + 2);
+
+    // locally convex everywhere, hence convex
+    for (size_t e = 0; e < edges.size() && valid; e++)
+    {
+        const Face &f1 = faces[edges[e].adjface[0]], &f2 = faces[edges[e].adjface[1]];
+        for (int k = 0; k < 3; k++)
+        {
+            int d = f2.vertex[k];
+            if (d != edges[e].endpts[0] && d != edges[e].endpts[1])
+                valid = volumeSign(f1, d) >= 0;
+        }
+    }
+
+    // and the vertices left out are inside
+    for (size_t v = 0; v < vertices.size() && valid; v++)
+    {
+        if (used.count(v))
+            continue;
+        for (size_t f = 0; f < faces.size() && valid; f++)
+            valid = volumeSign(faces[f], v) >= 0;
+    }
+
+    if (!valid)
+    {
+        clearFaces();
+        return false;
+    }
+    pending.clear();
+    built = true;
+    return true;
+}
@@ -0,0 +1,102 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Incremental 3D convex hull, after the chull.c code of "Computational Geometry in C"
+ * (J. O'Rourke, chapter 4), in double precision. Vertices, edges and faces live in
+ * vectors and reference each other by index; deleted edges and faces are recycled,
+ * and clear() releases everything at once.
+ *
+ * Faces are oriented counterclockwise seen from outside the hull. Instead of testing
+ * every face, an added point only visits the faces it can see, found from a first
+ * visible face through the edge adjacency.
+ */
+class ConvexHull
+{
+  public:
+    typedef std::array<int, 3> Triangle;
+
+    ConvexHull();
+    void clear();
+
+    /* Register a vertex without inserting it in the hull, returns its index */
+    int addVertex(double x, double y, double z);
+    /* Insert a registered vertex, returns false if it is not on the hull (yet) */
+    bool insert(int v);
+    int addPoint(double x, double y, double z);
+
+    /* False until four non coplanar vertices were inserted */
+    bool isValid() const { return built; }
+    size_t vertexCount() const { return vertices.size(); }
+    size_t faceCount() const { return nbfaces; }
+    void getFaces(std::vector<Triangle> &triangles) const;
+
+    /*
+     * Rebuild the hull of the registered vertices from a list of faces, e.g. saved by
+     * getFaces(). Fails if the faces are not a closed convex surface of these vertices,
+     * vertices inserted before a failed restore are still waiting for the first tetrahedron.
+     */
+    bool restore(const std::vector<Triangle> &triangles);
+
+  private:
+    typedef struct Vertex
+    {
+        double v[3];
+        int duplicate;
+    } Vertex;
+    typedef struct Edge
+    {
+        int adjface[2];
+        int endpts[2];
+        int newface;
+        bool removed;
+    } Edge;
+    typedef struct Face
+    {
+        int edge[3];
+        int vertex[3];
+        bool visible;
+        bool alive;
+    } Face;
+
+    void clearFaces();
+    bool buildTetrahedron();
+    bool addOne(int p);
+    int volumeSign(const Face &f, int p) const;
+    bool collinear(int a, int b, int c) const;
+    int makeEdge();
+    int makeFace();
+    int makeConeFace(int e, int p);
+    void makeCcw(int f, int e, int p);
+    void releaseFace(int f);
+
+    std::vector<Vertex> vertices;
+    std::vector<Edge> edges;
+    std::vector<Face> faces;
+    std::vector<int> freeedges, freefaces;
+    // inserted vertices waiting for a non degenerate tetrahedron
+    std::vector<int> pending;
+    size_t nbfaces;
+    bool built;
+    // scratch lists reused by addOne
+    std::vector<int> visiblefaces, stack, horizon, removededges;
+};
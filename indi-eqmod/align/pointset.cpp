@@ -23,8 +23,10 @@
 #include <libnova/sidereal_time.h>
 #include <libnova/transform.h>
 
+#include <algorithm>
 #include <math.h>
 #include <string.h>
+#include <string>
 #include <wordexp.h>
 
 double PointSet::range24(double r)
@@ -115,19 +117,23 @@ void PointSet::RaDecFromAltAz(double alt, double az, double jd, double *ra, doub
     *dec = lnradec.dec;
 }
 
-/* Using haversine: http://en.wikipedia.org/wiki/Haversine_formula */
-double sphere_unit_distance(double theta1, double theta2, double phi1, double phi2)
+// Triangulation cache, saved next to the align data file
+#define ALIGN_CACHE_SUFFIX ".hull"
+
+// A face walk longer than this is slower than a query of the face index
+#define FACE_WALK_STEPS 16
+
+static double tripleProduct(const double p[3], const double e1[3], const double e2[3])
 {
-    double sqrt_haversin_lat  = sin(((phi2 - phi1) / 2) * (M_PI / 180));
-    double sqrt_haversin_long = sin(((theta2 - theta1) / 2) * (M_PI / 180));
-    return (2 *
-            asin(sqrt((sqrt_haversin_lat * sqrt_haversin_lat) + cos(phi1 * (M_PI / 180)) * cos(phi2 * (M_PI / 180)) *
-                                                                    (sqrt_haversin_long * sqrt_haversin_long))));
+    return (p[0] * e1[1] * e2[2]) + (p[2] * e1[0] * e2[1]) + (p[1] * e1[2] * e2[0]) - (p[2] * e1[1] * e2[0]) -
+           (p[0] * e1[2] * e2[1]) - (p[1] * e1[0] * e2[2]);
 }
 
-bool compelt(PointSet::Distance d1, PointSet::Distance d2)
+static void pointVector(const PointSet::Point *p, bool ingoto, double v[3])
 {
-    return d1.value < d2.value;
+    v[0] = ingoto ? p->cx : p->tx;
+    v[1] = ingoto ? p->cy : p->ty;
+    v[2] = ingoto ? p->cz : p->tz;
 }
 
 PointSet::PointSet(INDI::Telescope *t)
@@ -135,6 +141,11 @@ PointSet::PointSet(INDI::Telescope *t)
     telescope  = t;
     lnalignpos = nullptr;
     PointSetInitialized = false;
+    PointSetMap      = nullptr;
+    Triangulation    = nullptr;
+    currentFace      = nullptr;
+    indexValid       = false;
+    currentFaceIndex = -1;
 }
 
 const char *PointSet::getDeviceName()
@@ -142,39 +153,40 @@ const char *PointSet::getDeviceName()
     return telescope->getDeviceName();
 }
 
-std::set<PointSet::Distance, bool (*)(PointSet::Distance, PointSet::Distance)> *
-PointSet::ComputeDistances(double alt, double az, PointFilter filter, bool ingoto)
+size_t PointSet::ComputeDistances(double alt, double az, PointFilter filter, bool ingoto, size_t count,
+                                  std::vector<Distance> &distances)
 {
     INDI_UNUSED(filter);
-    std::map<HtmID, Point>::iterator it;
-    std::set<Distance, bool (*)(Distance, Distance)> *distances =
-        new std::set<Distance, bool (*)(Distance, Distance)>(compelt);
-    std::set<Distance>::iterator distit;
-    std::pair<std::set<Distance>::iterator, bool> ret;
-    /* IDLog("Compute distances for point alt=%f az=%f\n", alt, az);*/
-    for (it = PointSetMap->begin(); it != PointSetMap->end(); it++)
+    double q[3];
+    double horangle = range360(-180.0 - az) * M_PI / 180.0;
+    double altangle = alt * M_PI / 180.0;
+    q[0]            = cos(altangle) * cos(horangle);
+    q[1]            = cos(altangle) * sin(horangle);
+    q[2]            = sin(altangle);
+
+    updateIndex();
+    distances.clear();
+    pointIndex[ingoto].nearest(q, count, neighbours);
+    for (auto &neighbour : neighbours)
     {
-        double d;
-        if (ingoto)
-            d = sphere_unit_distance(az, (*it).second.celestialAZ, alt, (*it).second.celestialALT);
-        else
-            d = sphere_unit_distance(az, (*it).second.telescopeAZ, alt, (*it).second.telescopeALT);
         Distance elt;
-        elt.htmID = (*it).first;
-        elt.value = d;
-        ret       = distances->insert(elt);
-        /*IDLog("  Point %lld (alt=%f az=%f): distance %f \n",  elt.htmID, (*it).second.celestialALT, (*it).second.celestialAZ, elt.value);*/
+        elt.htmID = indexedPoints[neighbour.second]->htmID;
+        elt.value = SphereIndex::chord2angle(neighbour.first);
+        distances.push_back(elt);
     }
-    /*
-  IDLog("  Ordered distances for point alt=%f az=%f\n", alt, az);
-  for ( distit=distances->begin() ; distit != distances->end(); distit++ ) {
-    IDLog("  Point %lld: distance %f \n",  distit->htmID, distit->value);
-  }
-  */
-    return distances;
+    return distances.size();
 }
 
 void PointSet::AddPoint(AlignData aligndata, struct ln_lnlat_posn *pos)
+{
+    Point *point = insertPoint(aligndata, pos);
+    Triangulation->AddPoint(point->htmID);
+    LOGF_INFO("Align Pointset: added point %d alt = %g az = %g\n", point->index,
+           point->celestialALT, point->celestialAZ);
+    LOGF_INFO("Align Triangulate: number of faces is %d\n", (int)Triangulation->getNbFaces());
+}
+
+PointSet::Point *PointSet::insertPoint(AlignData aligndata, struct ln_lnlat_posn *pos)
 {
     Point point;
     point.aligndata = aligndata;
@@ -211,7 +223,9 @@ void PointSet::AddPoint(AlignData aligndata, struct ln_lnlat_posn *pos)
     cc_ID2name(point.htmname, point.htmID);
     point.index = getNbPoints();
     //IDLog("Adding sync point index = %d htm id = %lld htm name = %s\n ", point.index, point.htmID, point.htmname);
-    PointSetMap->insert(std::pair<HtmID, Point>(point.htmID, point));
+    std::pair<std::map<HtmID, Point>::iterator, bool> ret =
+        PointSetMap->insert(std::pair<HtmID, Point>(point.htmID, point));
+    indexValid = false;
     //IDLog("       sync point celestial alt = %g az = %g\n ", point.celestialALT, point.celestialAZ);
     //IDLog("       sync point telescope alt = %g az = %g\n ", point.telescopeALT, point.telescopeAZ);
     // compute new Delaunay triangulation of the points on the unit sphere
@@ -221,10 +235,7 @@ void PointSet::AddPoint(AlignData aligndata, struct ln_lnlat_posn *pos)
     //for ( it=PointSetMap->begin() ; it != PointSetMap->end(); it++ ) {
     //IDLog("%f %f %f\n", it->second.cx, it->second.cy, it->second.cz);
     //}
-    Triangulation->AddPoint(point.htmID);
-    LOGF_INFO("Align Pointset: added point %d alt = %g az = %g\n", point.index,
-           point.celestialALT, point.celestialAZ);
-    LOGF_INFO("Align Triangulate: number of faces is %d\n", Triangulation->getFaces().size());
+    return &ret.first->second;
 }
 
 PointSet::Point *PointSet::getPoint(HtmID htmid)
@@ -239,7 +250,7 @@ int PointSet::getNbPoints()
 
 int PointSet::getNbTriangles()
 {
-    return Triangulation->getFaces().size();
+    return Triangulation->getNbFaces();
 }
 
 bool PointSet::isInitialized()
@@ -253,6 +264,7 @@ void PointSet::Init()
     PointSetMap     = new std::map<HtmID, Point>();
     Triangulation   = new TriangulateCHull(PointSetMap);
     PointSetXmlRoot = nullptr;
+    indexValid      = false;
     PointSetInitialized=true;
 }
 
@@ -272,6 +284,7 @@ void PointSet::Reset()
         free(lnalignpos);
     lnalignpos = nullptr;
     Triangulation->Reset();
+    indexValid = false;
 }
 
 char *PointSet::LoadDataFile(const char *filename)
@@ -285,6 +298,9 @@ char *PointSet::LoadDataFile(const char *filename)
     XMLAtt *ap;
     char *sitename;
     std::map<HtmID, Point>::iterator it;
+    std::vector<HtmID> ids;
+    std::string cachefile;
+    bool cached;
 
     if (wordexp(filename, &wexp, 0))
     {
@@ -297,6 +313,7 @@ char *PointSet::LoadDataFile(const char *filename)
         wordfree(&wexp);
         return strerror(errno);
     }
+    cachefile = std::string(wexp.we_wordv[0]) + ALIGN_CACHE_SUFFIX;
     wordfree(&wexp);
     lp = newLilXML();
     if (PointSetXmlRoot)
@@ -339,6 +356,7 @@ char *PointSet::LoadDataFile(const char *filename)
     lnalignpos->lng = lon;
     lnalignpos->lat = lat;
     PointSetMap->clear();
+    indexValid   = false;
     alignxml     = nextXMLEle(sitexml, 1);
     aligndata.jd = -1.0;
     while (alignxml)
@@ -353,9 +371,14 @@ char *PointSet::LoadDataFile(const char *filename)
         sscanf(pcdataXMLEle(findXMLEle(alignxml, "telescopede")), "%lf", &aligndata.telescopeDEC);
         //IDLog("Load alignment point: %f %f %f %f %f\n", aligndata.lst, aligndata.targetRA, aligndata.targetDEC,
         //  aligndata.telescopeRA, aligndata.telescopeDEC);
-        AddPoint(aligndata, lnalignpos);
+        Point *point = insertPoint(aligndata, lnalignpos);
+        if (point->index == (int)ids.size())
+            ids.push_back(point->htmID);
         alignxml = nextXMLEle(sitexml, 0);
     }
+    // triangulate all the points at once, or reuse the triangulation saved with them
+    cached = Triangulation->LoadPoints(ids, cachefile.c_str());
+    IDLog("  number of faces: %d%s\n", (int)Triangulation->getNbFaces(), cached ? " (cached)" : "");
     /*
   IDLog("Resulting Alignment map;\n");
   for ( it=PointSetMap->begin() ; it != PointSetMap->end(); it++ )
@@ -370,6 +393,9 @@ char *PointSet::WriteDataFile(const char *filename)
     wordexp_t wexp;
     FILE *fp;
     XMLEle *root;
+    std::map<HtmID, Point>::iterator it;
+    std::vector<HtmID> ids;
+    std::string cachefile;
 
     if (wordexp(filename, &wexp, 0))
     {
@@ -388,10 +414,18 @@ char *PointSet::WriteDataFile(const char *filename)
         wordfree(&wexp);
         return strerror(errno);
     }
+    cachefile = std::string(wexp.we_wordv[0]) + ALIGN_CACHE_SUFFIX;
+    wordfree(&wexp);
     root = toXML();
 
     prXMLEle(fp, root, 0);
     fclose(fp);
+    delXMLEle(root);
+    // points are written, and loaded back, in map order
+    for (it = PointSetMap->begin(); it != PointSetMap->end(); it++)
+        ids.push_back(it->first);
+    if (!Triangulation->WriteCache(cachefile.c_str(), ids))
+        remove(cachefile.c_str());
     return nullptr;
 }
 
@@ -508,25 +542,31 @@ double PointSet::scalarTripleProduct(Point *p, Point *e1, Point *e2, bool ingoto
 }
 
 bool PointSet::isPointInside(Point *p, std::vector<HtmID> f, bool ingoto)
+{
+    if (f.size() < 3)
+        return false;
+    Point *v[3] = { &PointSetMap->at(f[0]), &PointSetMap->at(f[1]), &PointSetMap->at(f[2]) };
+    return isPointInside(p, v, ingoto);
+}
+
+bool PointSet::isPointInside(Point *p, Point *const v[3], bool ingoto)
 {
     double r;
     bool left  = false;
     bool right = false;
-    if (f.size() < 3)
-        return false;
-    r = scalarTripleProduct(p, &PointSetMap->at(f[2]), &PointSetMap->at(f[0]), ingoto);
+    r = scalarTripleProduct(p, v[2], v[0], ingoto);
     if (r < 0)
         left = true;
     else
         right = true;
-    r = scalarTripleProduct(p, &PointSetMap->at(f[0]), &PointSetMap->at(f[1]), ingoto);
+    r = scalarTripleProduct(p, v[0], v[1], ingoto);
     if (r < 0)
         left = true;
     else
         right = true;
     if (left && right)
         return false;
-    r = scalarTripleProduct(p, &PointSetMap->at(f[1]), &PointSetMap->at(f[2]), ingoto);
+    r = scalarTripleProduct(p, v[1], v[2], ingoto);
     if (r < 0)
         left = true;
     else
@@ -536,6 +576,146 @@ bool PointSet::isPointInside(Point *p, std::vector<HtmID> f, bool ingoto)
     return true;
 }
 
+void PointSet::updateIndex()
+{
+    std::map<HtmID, Point>::iterator it;
+    std::map<std::pair<HtmID, HtmID>, int> edges;
+    std::vector<Face *> faces;
+    double v[3];
+
+    if (indexValid)
+        return;
+
+    indexedPoints.clear();
+    pointIndex[0].clear();
+    pointIndex[1].clear();
+    for (it = PointSetMap->begin(); it != PointSetMap->end(); it++)
+    {
+        pointVector(&it->second, false, v);
+        pointIndex[0].add(v, 0.0, indexedPoints.size());
+        pointVector(&it->second, true, v);
+        pointIndex[1].add(v, 0.0, indexedPoints.size());
+        indexedPoints.push_back(&it->second);
+    }
+    pointIndex[0].build();
+    pointIndex[1].build();
+
+    faceLinks.clear();
+    faceIndex[0].clear();
+    faceIndex[1].clear();
+    faces = Triangulation->getFaces();
+    for (size_t i = 0; i < faces.size(); i++)
+    {
+        FaceLink link;
+        bool complete = true;
+        link.face     = faces[i];
+        for (int k = 0; k < 3; k++)
+        {
+            it = PointSetMap->find(faces[i]->v[k]);
+            if (it == PointSetMap->end())
+            {
+                complete = false;
+                break;
+            }
+            link.v[k]         = &it->second;
+            link.neighbour[k] = -1;
+        }
+        if (!complete)
+            continue;
+
+        // bounding cap of the face, the whole sphere for faces wider than a hemisphere
+        for (int ingoto = 0; ingoto < 2; ingoto++)
+        {
+            double vertices[3][3], norm, radius = 0.0;
+            double *center = link.center[ingoto];
+            bool hemisphere = true;
+            center[0] = center[1] = center[2] = 0.0;
+            for (int k = 0; k < 3; k++)
+            {
+                pointVector(link.v[k], ingoto, vertices[k]);
+                center[0] += vertices[k][0];
+                center[1] += vertices[k][1];
+                center[2] += vertices[k][2];
+            }
+            norm = sqrt(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]);
+            if (norm > 0.0)
+            {
+                center[0] /= norm;
+                center[1] /= norm;
+                center[2] /= norm;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                double dx = vertices[k][0] - center[0], dy = vertices[k][1] - center[1],
+                       dz = vertices[k][2] - center[2];
+                radius    = std::max(radius, sqrt(dx * dx + dy * dy + dz * dz));
+                if (vertices[k][0] * center[0] + vertices[k][1] * center[1] + vertices[k][2] * center[2] <= 0.0)
+                    hemisphere = false;
+            }
+            faceIndex[ingoto].add(center, hemisphere ? radius : 2.0, faceLinks.size());
+        }
+
+        // link faces sharing an edge
+        int f = faceLinks.size();
+        for (int k = 0; k < 3; k++)
+        {
+            HtmID a = link.v[(k + 1) % 3]->htmID, b = link.v[(k + 2) % 3]->htmID;
+            std::pair<HtmID, HtmID> edge(std::min(a, b), std::max(a, b));
+            std::map<std::pair<HtmID, HtmID>, int>::iterator e = edges.find(edge);
+            if (e == edges.end())
+            {
+                edges[edge] = f * 3 + k;
+                continue;
+            }
+            link.neighbour[k]                                   = e->second / 3;
+            faceLinks[e->second / 3].neighbour[e->second % 3] = f;
+        }
+        faceLinks.push_back(link);
+    }
+    faceIndex[0].build();
+    faceIndex[1].build();
+
+    currentFace      = nullptr;
+    currentFaceIndex = -1;
+    indexValid       = true;
+}
+
+bool PointSet::isInsideFace(Point *p, int face, bool ingoto)
+{
+    const double *center = faceLinks[face].center[ingoto];
+    // the sign test alone also accepts the face opposite to p on the sphere
+    if (p->cx * center[0] + p->cy * center[1] + p->cz * center[2] <= 0.0)
+        return false;
+    return isPointInside(p, faceLinks[face].v, ingoto);
+}
+
+int PointSet::walkFace(Point *p, int start, bool ingoto)
+{
+    double q[3] = { p->cx, p->cy, p->cz };
+    int face = start, previous = -1;
+
+    for (int step = 0; step < FACE_WALK_STEPS && face >= 0; step++)
+    {
+        if (isInsideFace(p, face, ingoto))
+            return face;
+        FaceLink &link = faceLinks[face];
+        double v[3][3];
+        int next = -1;
+        for (int k = 0; k < 3; k++)
+            pointVector(link.v[k], ingoto, v[k]);
+        // cross the first edge having p and the opposite vertex on different sides
+        for (int k = 0; k < 3 && next < 0; k++)
+        {
+            const double *a = v[(k + 1) % 3], *b = v[(k + 2) % 3];
+            if (tripleProduct(q, a, b) * tripleProduct(v[k], a, b) < 0.0 && link.neighbour[k] != previous)
+                next = link.neighbour[k];
+        }
+        previous = face;
+        face     = next;
+    }
+    return -1;
+}
+
 std::vector<HtmID> PointSet::findFace(double currentRA, double currentDEC, double jd, double pointalt, double pointaz,
                                       ln_lnlat_posn *position, bool ingoto)
 {
@@ -543,8 +723,7 @@ std::vector<HtmID> PointSet::findFace(double currentRA, double currentDEC, doubl
     INDI_UNUSED(pointaz);
     Point point;
     double horangle = 0, altangle = 0;
-    std::vector<Face *> faces;
-    std::vector<Face *>::iterator it;
+    int face        = -1;
 
     point.aligndata.jd        = jd;
     point.aligndata.targetRA  = currentRA;
@@ -558,24 +737,42 @@ std::vector<HtmID> PointSet::findFace(double currentRA, double currentDEC, doubl
     point.cy = cos(altangle) * sin(horangle);
     point.cz = sin(altangle);
 
-    if (Triangulation->isValid() && isPointInside(&point, current, ingoto))
-        return current;
-    faces = Triangulation->getFaces();
-    it    = faces.begin();
-    while (it < faces.end())
+    updateIndex();
+    // while tracking the point stays in the last face or moves to a neighbour
+    if (currentFaceIndex >= 0)
+        face = walkFace(&point, currentFaceIndex, ingoto);
+    if (face < 0)
     {
-        if (isPointInside(&point, (*it)->v, ingoto))
+        double q[3] = { point.cx, point.cy, point.cz };
+        faceIndex[ingoto].enclosing(q, candidates);
+        // lowest index first, as the former linear scan of the faces did on shared edges
+        std::sort(candidates.begin(), candidates.end());
+        for (size_t i = 0; i < candidates.size(); i++)
         {
-            currentFace = *it;
-            current     = (*it)->v;
-            LOGF_INFO("Align: current face is {%d, %d, %d}", PointSetMap->at(current[0]).index,
-                   PointSetMap->at(current[1]).index, PointSetMap->at(current[2]).index);
-            return current;
+            if (isInsideFace(&point, candidates[i], ingoto))
+            {
+                face = candidates[i];
+                break;
+            }
         }
-        it++;
     }
-    if (current.size() > 0)
-        LOG_INFO("Align: current face is empty");
-    current.clear();
+
+    if (face < 0)
+    {
+        if (current.size() > 0)
+            LOG_INFO("Align: current face is empty");
+        current.clear();
+        currentFace      = nullptr;
+        currentFaceIndex = -1;
+        return current;
+    }
+    if (face != currentFaceIndex)
+    {
+        currentFaceIndex = face;
+        currentFace      = faceLinks[face].face;
+        current          = currentFace->v;
+        LOGF_INFO("Align: current face is {%d, %d, %d}", PointSetMap->at(current[0]).index,
+                  PointSetMap->at(current[1]).index, PointSetMap->at(current[2]).index);
+    }
     return current;
 }
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "htm.h"
+#include "sphereindex.h"
 
 #include <map>
 #include <set>
@@ -72,8 +73,8 @@ class PointSet
     void setBlobData(IBLOBVectorProperty *bp);
     void setPointBlobData(IBLOB *blob);
     void setTriangulationBlobData(IBLOB *blob);
-    std::set<Distance, bool (*)(Distance, Distance)> *ComputeDistances(double alt, double az, PointFilter filter,
-                                                                       bool ingoto);
+    size_t ComputeDistances(double alt, double az, PointFilter filter, bool ingoto, size_t count,
+                            std::vector<Distance> &distances);
     std::vector<HtmID> findFace(double currentRA, double currentDEC, double jd, double pointalt, double pointaz,
                                 ln_lnlat_posn *position, bool ingoto);
     double lat, lon, alt;
@@ -85,15 +86,39 @@ class PointSet
     void RaDecFromAltAz(double alt, double az, double jd, double *ra, double *dec, struct ln_lnlat_posn *pos);
     double scalarTripleProduct(Point *p, Point *e1, Point *e2, bool ingoto);
     bool isPointInside(Point *p, std::vector<HtmID> f, bool ingoto);
+    bool isPointInside(Point *p, Point *const v[3], bool ingoto);
 
   protected:
   private:
+    typedef struct FaceLink
+    {
+        Face *face;
+        Point *v[3];
+        // face across the edge opposite to v[i], -1 on the triangulation border
+        int neighbour[3];
+        // normalized centroid, telescope and celestial coordinates
+        double center[2][3];
+    } FaceLink;
+    Point *insertPoint(AlignData aligndata, struct ln_lnlat_posn *pos);
+    void updateIndex();
+    bool isInsideFace(Point *p, int face, bool ingoto);
+    int walkFace(Point *p, int start, bool ingoto);
     XMLEle *PointSetXmlRoot;
     std::map<HtmID, Point> *PointSetMap;
     bool PointSetInitialized;
     TriangulateCHull *Triangulation;
     Face *currentFace;
     std::vector<HtmID> current;
+    // spatial index, rebuilt on the first query after the point set changed
+    // arrays are indexed by ingoto: telescope coordinates first, then celestial ones
+    bool indexValid;
+    std::vector<Point *> indexedPoints;
+    SphereIndex pointIndex[2];
+    std::vector<FaceLink> faceLinks;
+    SphereIndex faceIndex[2];
+    int currentFaceIndex;
+    std::vector<SphereIndex::Neighbour> neighbours;
+    std::vector<size_t> candidates;
     // to get access to lat/long data
     INDI::Telescope *telescope;
     // from align data file
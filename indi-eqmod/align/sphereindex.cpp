@@ -0,0 +1,180 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sphereindex.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Slack for points lying exactly on a face edge or vertex
+#define SPHEREINDEX_EPSILON 1E-9
+
+static double distance2(const double a[3], const double b[3])
+{
+    double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+double SphereIndex::chord2angle(double chord)
+{
+    return 2.0 * asin(std::min(chord / 2.0, 1.0));
+}
+
+void SphereIndex::clear()
+{
+    items.clear();
+    nodes.clear();
+}
+
+void SphereIndex::add(const double v[3], double radius, size_t id)
+{
+    Item item;
+    item.v[0]   = v[0];
+    item.v[1]   = v[1];
+    item.v[2]   = v[2];
+    item.radius = radius;
+    item.id     = id;
+    items.push_back(item);
+}
+
+void SphereIndex::build()
+{
+    nodes.resize(items.size());
+    build(0, items.size());
+}
+
+void SphereIndex::build(size_t lo, size_t hi)
+{
+    if (lo >= hi)
+        return;
+
+    Node node;
+    node.maxradius = 0.0;
+    for (int k = 0; k < 3; k++)
+    {
+        node.bmin[k] = items[lo].v[k];
+        node.bmax[k] = items[lo].v[k];
+    }
+    for (size_t i = lo; i < hi; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            node.bmin[k] = std::min(node.bmin[k], items[i].v[k]);
+            node.bmax[k] = std::max(node.bmax[k], items[i].v[k]);
+        }
+        node.maxradius = std::max(node.maxradius, items[i].radius);
+    }
+    node.axis = 0;
+    for (int k = 1; k < 3; k++)
+        if (node.bmax[k] - node.bmin[k] > node.bmax[node.axis] - node.bmin[node.axis])
+            node.axis = k;
+
+    size_t mid = lo + (hi - lo) / 2;
+    int axis   = node.axis;
+    std::nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi,
+                     [axis](const Item &a, const Item &b) { return a.v[axis] < b.v[axis]; });
+    nodes[mid] = node;
+
+    build(lo, mid);
+    build(mid + 1, hi);
+}
+
+double SphereIndex::boxDistance2(const Node &node, const double q[3]) const
+{
+    double d = 0.0;
+    for (int k = 0; k < 3; k++)
+    {
+        if (q[k] < node.bmin[k])
+            d += (node.bmin[k] - q[k]) * (node.bmin[k] - q[k]);
+        else if (q[k] > node.bmax[k])
+            d += (q[k] - node.bmax[k]) * (q[k] - node.bmax[k]);
+    }
+    return d;
+}
+
+size_t SphereIndex::nearest(const double q[3], size_t n, std::vector<Neighbour> &result) const
+{
+    result.clear();
+    if (n == 0)
+        return 0;
+    result.reserve(n + 1);
+    // result is kept as a max-heap of squared distances during the search
+    nearest(0, items.size(), q, n, result);
+    std::sort_heap(result.begin(), result.end());
+    for (auto &neighbour : result)
+        neighbour.first = sqrt(neighbour.first);
+    return result.size();
+}
+
+void SphereIndex::nearest(size_t lo, size_t hi, const double q[3], size_t n, std::vector<Neighbour> &heap) const
+{
+    if (lo >= hi)
+        return;
+
+    size_t mid       = lo + (hi - lo) / 2;
+    const Node &node = nodes[mid];
+    if (heap.size() == n && boxDistance2(node, q) > heap.front().first)
+        return;
+
+    double d = distance2(q, items[mid].v);
+    if (heap.size() < n || d < heap.front().first)
+    {
+        heap.push_back(Neighbour(d, items[mid].id));
+        std::push_heap(heap.begin(), heap.end());
+        if (heap.size() > n)
+        {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+        }
+    }
+
+    if (q[node.axis] < items[mid].v[node.axis])
+    {
+        nearest(lo, mid, q, n, heap);
+        nearest(mid + 1, hi, q, n, heap);
+    }
+    else
+    {
+        nearest(mid + 1, hi, q, n, heap);
+        nearest(lo, mid, q, n, heap);
+    }
+}
+
+size_t SphereIndex::enclosing(const double q[3], std::vector<size_t> &result) const
+{
+    result.clear();
+    enclosing(0, items.size(), q, result);
+    return result.size();
+}
+
+void SphereIndex::enclosing(size_t lo, size_t hi, const double q[3], std::vector<size_t> &result) const
+{
+    if (lo >= hi)
+        return;
+
+    size_t mid       = lo + (hi - lo) / 2;
+    const Node &node = nodes[mid];
+    double reach     = node.maxradius + SPHEREINDEX_EPSILON;
+    if (boxDistance2(node, q) > reach * reach)
+        return;
+
+    reach = items[mid].radius + SPHEREINDEX_EPSILON;
+    if (distance2(q, items[mid].v) <= reach * reach)
+        result.push_back(items[mid].id);
+
+    enclosing(lo, mid, q, result);
+    enclosing(mid + 1, hi, q, result);
+}
@@ -0,0 +1,69 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/*
+ * Static k-d tree over vectors of the unit sphere. Each entry is a ball (center, radius):
+ * alignment points are stored with a null radius and queried for their nearest neighbours,
+ * triangulation faces are stored with their bounding cap and queried for the caps enclosing
+ * a direction. Distances are chord lengths, which order points like great circle distances.
+ */
+class SphereIndex
+{
+  public:
+    typedef std::pair<double, size_t> Neighbour;
+
+    void clear();
+    void add(const double v[3], double radius, size_t id);
+    /* Balance the tree, call once all entries are added */
+    void build();
+    size_t size() const { return items.size(); }
+
+    /* The n nearest entries to q, sorted by increasing chord distance */
+    size_t nearest(const double q[3], size_t n, std::vector<Neighbour> &result) const;
+    /* The entries whose ball contains q */
+    size_t enclosing(const double q[3], std::vector<size_t> &result) const;
+
+    static double chord2angle(double chord);
+
+  private:
+    typedef struct Item
+    {
+        double v[3];
+        double radius;
+        size_t id;
+    } Item;
+    typedef struct Node
+    {
+        int axis;
+        double bmin[3], bmax[3];
+        double maxradius;
+    } Node;
+
+    void build(size_t lo, size_t hi);
+    void nearest(size_t lo, size_t hi, const double q[3], size_t n, std::vector<Neighbour> &heap) const;
+    void enclosing(size_t lo, size_t hi, const double q[3], std::vector<size_t> &result) const;
+    double boxDistance2(const Node &node, const double q[3]) const;
+
+    std::vector<Item> items;
+    // one node per item, node i is the root of the subtree stored around items[i]
+    std::vector<Node> nodes;
+};
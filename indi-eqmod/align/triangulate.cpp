@@ -68,6 +68,11 @@ std::vector<Face *> Triangulate::getFaces()
     return vfaces;
 }
 
+size_t Triangulate::getNbFaces()
+{
+    return vfaces.size();
+}
+
 bool Triangulate::isValid()
 {
     return isvalid;
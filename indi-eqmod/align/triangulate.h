@@ -42,6 +42,7 @@ class Triangulate
     virtual void AddPoint(HtmID id);
     virtual XMLEle *toXML();
     virtual std::vector<Face *> getFaces();
+    virtual size_t getNbFaces();
     virtual bool isValid();
 
   protected:
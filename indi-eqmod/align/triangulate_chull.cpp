@@ -17,86 +17,187 @@
 
 #include "triangulate_chull.h"
 
-#include "chull.h"
+#include <stdint.h>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Triangulation cache: header, then the hull faces as triples of point numbers,
+ * 0 for the origin and i + 1 for the i-th point of the align data file.
+ * Written in host byte order, a foreign file simply fails to validate.
+ */
+#define HULL_CACHE_MAGIC   "EQHL"
+#define HULL_CACHE_VERSION 1
+
+typedef struct HullCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t nbpoints;
+    uint32_t nbfaces;
+} HullCacheHeader;
 
 TriangulateCHull::TriangulateCHull(std::map<HtmID, PointSet::Point> *p) : Triangulate::Triangulate(p)
 {
-    tVertex v;
-    vnum     = 0;
-    vertices = nullptr;
-    edges    = nullptr;
-    faces    = nullptr;
-    v        = MakeNullVertex();
-    v->v[X]  = 0;
-    v->v[Y]  = 0;
-    v->v[Z]  = 0;
-    v->vnum  = vnum++;
+    // the origin is vertex 0
+    hull.insert(hull.addVertex(0.0, 0.0, 0.0));
+    facesvalid = true;
 }
 
 void TriangulateCHull::Reset()
 {
-    tVertex v;
     Triangulate::Reset();
-    vnum = 0;
-    //SHOULD Free everything
-    vertices = nullptr;
-    edges    = nullptr;
-    faces    = nullptr;
-    v        = MakeNullVertex();
-    v->v[X]  = 0;
-    v->v[Y]  = 0;
-    v->v[Z]  = 0;
-    v->vnum  = vnum++;
+    hull.clear();
+    hull.insert(hull.addVertex(0.0, 0.0, 0.0));
+    facestore.clear();
+    facesvalid = true;
+}
+
+int TriangulateCHull::addVertex(HtmID id)
+{
+    PointSet::Point &p = pmap->at(id);
+    vvertices.push_back(id);
+    return hull.addVertex(p.cx, p.cy, p.cz);
 }
 
 void TriangulateCHull::AddPoint(HtmID id)
 {
-    tVertex v, vnext;
-    PointSet::Point p;
-    tFace f;
     Triangulate::AddPoint(id);
-    //fprintf(stderr, "Triangulate addpoint: %ld\n", id);
-    p = pmap->at(id);
-    //fprintf(stderr, "Triangulate addpoint: point retrieved %d\n", p.index);
-    v       = MakeNullVertex();
-    v->v[X] = (int)(p.cx * 1000000);
-    v->v[Y] = (int)(p.cy * 1000000);
-    v->v[Z] = (int)(p.cz * 1000000);
-    v->vnum = vnum++;
-    //fprintf(stderr, "Triangulate addpoint: vertex created %d\n", v->vnum);
-    vvertices.push_back(id);
-    //fprintf(stderr, "Triangulate addpoint: vertex added (%d total)\n", vvertices.size());
-    if (vnum < 4)
+    hull.insert(addVertex(id));
+    facesvalid = false;
+}
+
+void TriangulateCHull::updateFaces()
+{
+    std::vector<ConvexHull::Triangle> triangles;
+
+    if (facesvalid)
         return;
-    if (vnum == 4)
+    hull.getFaces(triangles);
+    vfaces.clear();
+    facestore.clear();
+    facestore.reserve(triangles.size());
+    for (const ConvexHull::Triangle &t : triangles)
     {
-        DoubleTriangle();
-        ConstructHull();
+        //skip faces containing the origin vertex
+        if ((t[0] == 0) || (t[1] == 0) || (t[2] == 0))
+            continue;
+        facestore.push_back(Face(vvertices.at(t[0] - 1), vvertices.at(t[1] - 1), vvertices.at(t[2] - 1)));
     }
-    if (vnum > 4)
+    for (Face &f : facestore)
+        vfaces.push_back(&f);
+    facesvalid = true;
+}
+
+XMLEle *TriangulateCHull::toXML()
+{
+    updateFaces();
+    return Triangulate::toXML();
+}
+
+std::vector<Face *> TriangulateCHull::getFaces()
+{
+    updateFaces();
+    return Triangulate::getFaces();
+}
+
+size_t TriangulateCHull::getNbFaces()
+{
+    updateFaces();
+    return vfaces.size();
+}
+
+bool TriangulateCHull::LoadPoints(const std::vector<HtmID> &ids, const char *cachefile)
+{
+    Reset();
+    for (HtmID id : ids)
+        addVertex(id);
+    facesvalid = false;
+
+    if (cachefile && readCache(cachefile))
+        return true;
+
+    // the origin inserted by Reset() is still pending
+    for (size_t i = 0; i < ids.size(); i++)
+        hull.insert(i + 1);
+    if (cachefile)
+        WriteCache(cachefile, vvertices);
+    return false;
+}
+
+bool TriangulateCHull::readCache(const char *cachefile)
+{
+    HullCacheHeader header;
+    std::vector<ConvexHull::Triangle> triangles;
+    std::vector<int32_t> data;
+    FILE *fp;
+    bool res;
+
+    if (!(fp = fopen(cachefile, "rb")))
+        return false;
+    res = (fread(&header, sizeof(header), 1, fp) == 1) && !memcmp(header.magic, HULL_CACHE_MAGIC, 4) &&
+          (header.version == HULL_CACHE_VERSION) && (header.nbpoints == vvertices.size()) &&
+          (header.nbfaces <= 2 * (header.nbpoints + 1));
+    if (res)
     {
-        vnext = v->next;
-        AddOne(v);
-        CleanUp(&vnext);
+        data.resize(3 * header.nbfaces);
+        res = (fread(data.data(), sizeof(int32_t), data.size(), fp) == data.size());
     }
-    vfaces.clear();
-    f = faces;
-    do
+    fclose(fp);
+    if (!res)
+        return false;
+
+    for (uint32_t f = 0; f < header.nbfaces; f++)
+        triangles.push_back(ConvexHull::Triangle { { data[3 * f], data[3 * f + 1], data[3 * f + 2] } });
+    // the faces are checked against the points just loaded
+    return hull.restore(triangles);
+}
+
+bool TriangulateCHull::WriteCache(const char *cachefile, const std::vector<HtmID> &order)
+{
+    std::vector<ConvexHull::Triangle> triangles;
+    std::map<HtmID, int32_t> number;
+    std::vector<int32_t> data;
+    std::string tmpfile = std::string(cachefile) + ".tmp";
+    HullCacheHeader header;
+    FILE *fp;
+    bool res;
+
+    if (!hull.isValid())
+        return false;
+    for (size_t i = 0; i < order.size(); i++)
+        number[order[i]] = i + 1;
+    hull.getFaces(triangles);
+    for (const ConvexHull::Triangle &t : triangles)
     {
-        //fprintf(stderr, "Triangulate addpoint: adding face (%d total)\n", vfaces.size());
-        //skip faces containing the origin vertex
-        if ((f->vertex[0]->vnum == 0) || (f->vertex[1]->vnum == 0) || (f->vertex[2]->vnum == 0))
+        for (int k = 0; k < 3; k++)
         {
-            f = f->next;
-            continue;
+            if (t[k] == 0)
+            {
+                data.push_back(0);
+                continue;
+            }
+            std::map<HtmID, int32_t>::iterator it = number.find(vvertices.at(t[k] - 1));
+            if (it == number.end())
+                return false;
+            data.push_back(it->second);
         }
-        vfaces.push_back(new Face(vvertices.at(f->vertex[0]->vnum - 1), vvertices.at(f->vertex[1]->vnum - 1),
-                                  vvertices.at(f->vertex[2]->vnum - 1)));
-        //fprintf(stderr, "Triangulate addpoint: added face (%d total)\n", vfaces.size());
-        f = f->next;
-    } while (f != faces);
-}
+    }
 
-//XMLEle *TriangulateCHull::toXML()
-//{
-//}
+    memcpy(header.magic, HULL_CACHE_MAGIC, 4);
+    header.version  = HULL_CACHE_VERSION;
+    header.nbpoints = order.size();
+    header.nbfaces  = triangles.size();
+    if (!(fp = fopen(tmpfile.c_str(), "wb")))
+        return false;
+    res = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+          (fwrite(data.data(), sizeof(int32_t), data.size(), fp) == data.size());
+    res = (fclose(fp) == 0) && res;
+    // replace the previous cache at once
+    if (res)
+        res = (rename(tmpfile.c_str(), cachefile) == 0);
+    if (!res)
+        remove(tmpfile.c_str());
+    return res;
+}
@@ -17,16 +17,33 @@
 
 #pragma once
 
+#include "convexhull.h"
 #include "triangulate.h"
 
+/*
+ * Delaunay triangulation of the sync points on the unit sphere: the convex hull of the
+ * points and the origin, less the faces holding the origin.
+ */
 class TriangulateCHull : public Triangulate
 {
   public:
     TriangulateCHull(std::map<HtmID, PointSet::Point> *p);
     void Reset();
     void AddPoint(HtmID id);
-    //XMLEle *toXML();
+    XMLEle *toXML();
+    std::vector<Face *> getFaces();
+    size_t getNbFaces();
+    /* Triangulate a whole point list, reading the hull from cachefile when it matches them */
+    bool LoadPoints(const std::vector<HtmID> &ids, const char *cachefile);
+    /* Save the hull, numbering the points in the given order */
+    bool WriteCache(const char *cachefile, const std::vector<HtmID> &order);
 
   private:
-    int vnum;
+    int addVertex(HtmID id);
+    bool readCache(const char *cachefile);
+    void updateFaces();
+
+    ConvexHull hull;
+    std::vector<Face> facestore;
+    bool facesvalid;
 };
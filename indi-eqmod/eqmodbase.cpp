@@ -335,6 +335,8 @@ void EQMod::ISGetProperties(const char *dev)
         defineSwitch(TrackDefaultSP);
         defineSwitch(ST4GuideRateNSSP);
         defineSwitch(ST4GuideRateWESP);
+        defineSwitch(PipelineSP);
+        defineNumber(LatencyNP);
 
 #if defined WITH_ALIGN && defined WITH_ALIGN_GEEHALEL
         defineSwitch(&AlignMethodSP);
@@ -425,6 +427,8 @@ bool EQMod::loadProperties()
     AutoHomeSP          = getSwitch("AUTOHOME");
     AuxEncoderSP        = getSwitch("AUXENCODER");
     AuxEncoderNP        = getNumber("AUXENCODERVALUES");
+    PipelineSP          = getSwitch("COMMAND_PIPELINE");
+    LatencyNP           = getNumber("COMMAND_LATENCY");
     ST4GuideRateNSSP    = getSwitch("ST4_GUIDE_RATE_NS");
     ST4GuideRateWESP    = getSwitch("ST4_GUIDE_RATE_WE");
     RAPPECTrainingSP    = getSwitch("RA_PPEC_TRAINING");
@@ -498,6 +502,8 @@ bool EQMod::updateProperties()
         defineSwitch(TrackDefaultSP);
         defineSwitch(ST4GuideRateNSSP);
         defineSwitch(ST4GuideRateWESP);
+        defineSwitch(PipelineSP);
+        defineNumber(LatencyNP);
 
 #if defined WITH_ALIGN && defined WITH_ALIGN_GEEHALEL
         defineSwitch(&AlignMethodSP);
@@ -592,6 +598,9 @@ bool EQMod::updateProperties()
             mount->SetBacklashRA((uint32_t)(IUFindNumber(BacklashNP, "BACKLASHRA")->value));
             mount->SetBacklashDE((uint32_t)(IUFindNumber(BacklashNP, "BACKLASHDE")->value));
 
+            mount->setPipelining(PipelineSP->sp[1].s == ISS_ON);
+            mount->ClearLatency();
+
             if (mount->HasSnapPort1())
             {
                 defineSwitch(SNAPPORT1SP);
@@ -662,6 +671,8 @@ bool EQMod::updateProperties()
         deleteProperty(UseBacklashSP->name);
         deleteProperty(ST4GuideRateNSSP->name);
         deleteProperty(ST4GuideRateWESP->name);
+        deleteProperty(PipelineSP->name);
+        deleteProperty(LatencyNP->name);
         deleteProperty(LEDBrightnessNP->name);
         //if (!strcmp(MountInformationTP->tp[0].text, "EQ8") || !strcmp(MountInformationTP->tp[0].text, "AZEQ6"))
         if (mount->HasHomeIndexers())
@@ -867,6 +878,7 @@ bool EQMod::ReadScopeStatus()
     try
     {
         TelescopePierSide pierSide;
+        mount->PollStatus();
         currentRAEncoder = mount->GetRAEncoder();
         currentDEEncoder = mount->GetDEEncoder();
         DEBUGF(DBG_SCOPE_STATUS, "Current encoders RA=%ld DE=%ld", static_cast<long>(currentRAEncoder),
@@ -988,6 +1000,22 @@ bool EQMod::ReadScopeStatus()
             IDSetNumber(AuxEncoderNP, nullptr);
         }
 
+        SkywatcherLatency latency = mount->GetLatency();
+        double latencyvalues[]     = { latency.mean(), latency.percentile(95), latency.max(),
+                                       static_cast<double>(latency.count()), static_cast<double>(latency.timeouts())
+                                     };
+        const char *latencynames[] = { "LATENCY_MEAN", "LATENCY_P95", "LATENCY_MAX", "LATENCY_COUNT", "LATENCY_TIMEOUTS" };
+        IUUpdateNumber(LatencyNP, latencyvalues, (char **)latencynames, 5);
+        IDSetNumber(LatencyNP, nullptr);
+        if ((PipelineSP->sp[1].s == ISS_ON) != mount->isPipelining())
+        {
+            // The mount turned it off
+            IUResetSwitch(PipelineSP);
+            PipelineSP->sp[mount->isPipelining() ? 1 : 0].s = ISS_ON;
+            PipelineSP->s = IPS_ALERT;
+            IDSetSwitch(PipelineSP, nullptr);
+        }
+
         if (gotoInProgress())
         {
             if (!(mount->IsRARunning()) && !(mount->IsDERunning()))
@@ -2965,6 +2993,17 @@ bool EQMod::ISNewSwitch(const char *dev, const char *name, ISState *states, char
             }
         }
 
+        if (PipelineSP && strcmp(name, PipelineSP->name) == 0)
+        {
+            IUUpdateSwitch(PipelineSP, states, names, n);
+            mount->setPipelining(PipelineSP->sp[1].s == ISS_ON);
+            mount->ClearLatency();
+            LOGF_INFO("Command pipeline %s.", mount->isPipelining() ? "on" : "off");
+            PipelineSP->s = IPS_OK;
+            IDSetSwitch(PipelineSP, nullptr);
+            return true;
+        }
+
         if (mount->HasAuxEncoders())
         {
             if (AuxEncoderSP && strcmp(name, AuxEncoderSP->name) == 0)
@@ -3776,6 +3815,8 @@ bool EQMod::saveConfigItems(FILE *fp)
         IUSaveConfigSwitch(fp, ReverseDECSP);
     if (LEDBrightnessNP)
         IUSaveConfigNumber(fp, LEDBrightnessNP);
+    if (PipelineSP)
+        IUSaveConfigSwitch(fp, PipelineSP);
     if (HasPECState())
     {
         IUSaveConfigSwitch(fp, RAPPECSP);
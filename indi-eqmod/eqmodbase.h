@@ -124,6 +124,8 @@ class EQMod : public INDI::Telescope, public INDI::GuiderInterface
         ISwitchVectorProperty *AutoHomeSP   = nullptr;
         ISwitchVectorProperty *AuxEncoderSP = nullptr;
         INumberVectorProperty *AuxEncoderNP = nullptr;
+        ISwitchVectorProperty *PipelineSP   = nullptr;
+        INumberVectorProperty *LatencyNP    = nullptr;
 
         ISwitchVectorProperty *ST4GuideRateNSSP = nullptr;
         ISwitchVectorProperty *ST4GuideRateWESP = nullptr;
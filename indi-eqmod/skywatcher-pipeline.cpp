@@ -0,0 +1,204 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "skywatcher-pipeline.h"
+
+#include <termios.h>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/* SkywatcherLatency */
+
+SkywatcherLatency::SkywatcherLatency()
+{
+    clear();
+}
+
+void SkywatcherLatency::add(double ms)
+{
+    int i = 0;
+    while (i < BUCKETS - 1 && ms >= bucketLimit(i))
+        i++;
+    buckets[i]++;
+    samples++;
+    sumMs += ms;
+    if (ms > maxMs)
+        maxMs = ms;
+}
+
+void SkywatcherLatency::addTimeout()
+{
+    lost++;
+}
+
+void SkywatcherLatency::clear()
+{
+    for (int i = 0; i < BUCKETS; i++)
+        buckets[i] = 0;
+    samples = 0;
+    lost    = 0;
+    sumMs   = 0;
+    maxMs   = 0;
+}
+
+double SkywatcherLatency::bucketLimit(int i)
+{
+    return double(1 << i);
+}
+
+double SkywatcherLatency::mean() const
+{
+    return samples > 0 ? sumMs / samples : 0;
+}
+
+double SkywatcherLatency::percentile(double p) const
+{
+    if (samples == 0)
+        return 0;
+    int n = 0;
+    for (int i = 0; i < BUCKETS - 1; i++)
+    {
+        n += buckets[i];
+        if (n >= p / 100.0 * samples)
+            return bucketLimit(i);
+    }
+    // The last bucket is open ended
+    return maxMs;
+}
+
+/* SkywatcherTtyLink */
+
+SkywatcherTtyLink::SkywatcherTtyLink(int fd, int timeout) : fd(fd), timeout(timeout)
+{
+}
+
+void SkywatcherTtyLink::flush()
+{
+    tcflush(fd, TCIOFLUSH);
+}
+
+int SkywatcherTtyLink::send(const char *command, int *nbytes_written)
+{
+    return tty_write_string(fd, command, nbytes_written);
+}
+
+int SkywatcherTtyLink::receive(char *reply, int size, int *nbytes_read)
+{
+    int err_code = tty_read_section(fd, reply, 0x0D, timeout, nbytes_read);
+    if (err_code == TTY_OK && *nbytes_read >= size)
+        *nbytes_read = size - 1;
+    return err_code;
+}
+
+/* SkywatcherPipeline */
+
+SkywatcherPipeline::SkywatcherPipeline() : nexttag(0)
+{
+}
+
+SkywatcherPipeline::Result SkywatcherPipeline::run(SkywatcherLink *link, SkywatcherRequest *requests, int count,
+        int *index, int *ttyerror)
+{
+    std::vector<Clock::time_point> sent(count);
+
+    *ttyerror = TTY_OK;
+    link->flush();
+
+    for (int i = 0; i < count; i++)
+    {
+        int nbytes_written   = 0;
+        requests[i].tag      = nextTag();
+        requests[i].reply[0] = '\0';
+        sent[i]              = Clock::now();
+        if ((*ttyerror = link->send(requests[i].command, &nbytes_written)) != TTY_OK)
+        {
+            *index = i;
+            return PIPELINE_SEND_ERROR;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        SkywatcherRequest &r = requests[i];
+        char reply[SKYWATCHER_MAX_CMD * 2];
+        int nbytes_read = 0;
+
+        *index = i;
+        if ((*ttyerror = link->receive(reply, sizeof(reply), &nbytes_read)) != TTY_OK)
+        {
+            histogram.addTimeout();
+            return PIPELINE_READ_ERROR;
+        }
+        r.latency = std::chrono::duration<double, std::milli>(Clock::now() - sent[i]).count();
+        histogram.add(r.latency);
+
+        // Remove CR
+        if (nbytes_read > 0 && reply[nbytes_read - 1] == 0x0D)
+            nbytes_read--;
+        reply[nbytes_read] = '\0';
+        strncpy(r.reply, reply, SKYWATCHER_MAX_CMD - 1);
+        r.reply[SKYWATCHER_MAX_CMD - 1] = '\0';
+
+        if (r.reply[0] == '!')
+            return PIPELINE_FAILED_CMD;
+        if (r.reply[0] != '=' || (r.replylength > 0 && nbytes_read - 1 != r.replylength))
+            return PIPELINE_BAD_REPLY;
+    }
+
+    return PIPELINE_OK;
+}
+
+SkywatcherPipeline::Result SkywatcherPipeline::runOrRetry(SkywatcherLink *link, SkywatcherRequest *requests,
+        int count, int *index, int *ttyerror, bool *retried)
+{
+    *retried      = false;
+    Result result = run(link, requests, count, index, ttyerror);
+    if (result == PIPELINE_OK || result == PIPELINE_SEND_ERROR)
+        return result;
+
+    // The replies come in order, none after a timeout. After a wrong reply
+    // read the rest of the batch, up to the first that does not come (the
+    // lost one), so that none of them is taken for the reply of a command
+    // sent again.
+    if (result != PIPELINE_READ_ERROR)
+    {
+        for (int i = *index + 1; i < count; i++)
+        {
+            char reply[SKYWATCHER_MAX_CMD * 2];
+            int nbytes_read = 0;
+            if (link->receive(reply, sizeof(reply), &nbytes_read) != TTY_OK)
+                break;
+        }
+    }
+
+    *retried = true;
+    for (int i = 0; i < count; i++)
+        requests[i].reply[0] = '\0';
+    for (int i = 0; i < count; i++)
+    {
+        int one = 0;
+        if ((result = run(link, &requests[i], 1, &one, ttyerror)) != PIPELINE_OK)
+        {
+            *index = i;
+            return result;
+        }
+    }
+
+    return PIPELINE_OK;
+}
@@ -0,0 +1,196 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <indicom.h>
+
+#include <deque>
+#include <string>
+
+#define SKYWATCHER_MAX_CMD 16
+
+// Round trip times of the commands, in power of two buckets starting at 1 ms.
+class SkywatcherLatency
+{
+    public:
+        static const int BUCKETS = 12;
+
+        SkywatcherLatency();
+
+        void add(double ms);
+        void addTimeout();
+        void clear();
+
+        int count() const
+        {
+            return samples;
+        }
+        int timeouts() const
+        {
+            return lost;
+        }
+        int bucket(int i) const
+        {
+            return buckets[i];
+        }
+        // Upper bound of bucket i, in ms
+        static double bucketLimit(int i);
+
+        double mean() const;
+        double max() const
+        {
+            return maxMs;
+        }
+        // Upper bound of the bucket holding the p-th percentile, in ms
+        double percentile(double p) const;
+
+    private:
+        int buckets[BUCKETS];
+        int samples;
+        int lost;
+        double sumMs;
+        double maxMs;
+};
+
+// Link to a motor controller. The controller answers the commands one after
+// the other, so whatever the link the replies come back in the order the
+// commands were sent.
+class SkywatcherLink
+{
+    public:
+        virtual ~SkywatcherLink() {}
+
+        // Drop the replies not read yet
+        virtual void flush() {}
+        // Send one command, CR included. Returns a TTY_* code.
+        virtual int send(const char *command, int *nbytes_written) = 0;
+        // Read one reply up to its CR. Returns a TTY_* code.
+        virtual int receive(char *reply, int size, int *nbytes_read) = 0;
+};
+
+// Serial port, or TCP/UDP socket of a WiFi adapter.
+class SkywatcherTtyLink : public SkywatcherLink
+{
+    public:
+        SkywatcherTtyLink(int fd, int timeout);
+
+        virtual void flush() override;
+        virtual int send(const char *command, int *nbytes_written) override;
+        virtual int receive(char *reply, int size, int *nbytes_read) override;
+
+    private:
+        int fd;
+        int timeout;
+};
+
+// Drives any controller with the process/reply interface of the simulators.
+// Each command is answered as soon as it is sent, the replies wait in a queue
+// until they are read.
+template <class Simulator>
+class SkywatcherSimulatorLink : public SkywatcherLink
+{
+    public:
+        explicit SkywatcherSimulatorLink(Simulator *simulator) : simulator(simulator) {}
+
+        virtual void flush() override
+        {
+            replies.clear();
+        }
+        virtual int send(const char *command, int *nbytes_written) override
+        {
+            char reply[64];
+            int nbytes_read = 0;
+            simulator->receive_cmd(command, nbytes_written);
+            simulator->send_reply(reply, &nbytes_read);
+            replies.push_back(std::string(reply, nbytes_read));
+            return TTY_OK;
+        }
+        virtual int receive(char *reply, int size, int *nbytes_read) override
+        {
+            if (replies.empty())
+                return TTY_TIME_OUT;
+            std::string r = replies.front();
+            replies.pop_front();
+            *nbytes_read = r.copy(reply, size - 1);
+            reply[*nbytes_read] = '\0';
+            return TTY_OK;
+        }
+
+    private:
+        Simulator *simulator;
+        std::deque<std::string> replies;
+};
+
+// A command and its reply. Tags number the commands in the order they are
+// sent, the reply of a command is the one read at its turn.
+struct SkywatcherRequest
+{
+    char command[SKYWATCHER_MAX_CMD];
+    char reply[SKYWATCHER_MAX_CMD];
+    // Number of characters after '=' in a valid reply, 0 to accept any
+    int replylength;
+    unsigned int tag;
+    // Round trip time, ms
+    double latency;
+};
+
+// Sends a batch of commands before reading the first reply, so the round
+// trips to the controller overlap instead of adding up.
+//
+// The protocol has no tags, replies are matched to commands by their order
+// only. The reply length check catches a lost reply, or a reply of the wrong
+// command when the two differ in length, but not two replies of the same
+// length that come back swapped, e.g. those of :j1 and :j2 or :f1 and :f2.
+// A lost reply shifts all the later ones, so runOrRetry() keeps none of a
+// batch in which a reply is missing or wrong.
+class SkywatcherPipeline
+{
+    public:
+        enum Result
+        {
+            PIPELINE_OK,
+            PIPELINE_SEND_ERROR,
+            PIPELINE_READ_ERROR,
+            PIPELINE_FAILED_CMD, // '!' reply
+            PIPELINE_BAD_REPLY   // garbled reply, or of the wrong length
+        };
+
+        SkywatcherPipeline();
+
+        // On error, *index is the request it happened on and *ttyerror the
+        // TTY_* code of a link error. The replies after it are not read, the
+        // next run flushes them.
+        Result run(SkywatcherLink *link, SkywatcherRequest *requests, int count, int *index, int *ttyerror);
+        // Same, but if a reply times out or fails the checks, the replies of
+        // the batch still on their way are read and dropped, and the commands
+        // are sent again one at a time. *retried tells whether they were.
+        Result runOrRetry(SkywatcherLink *link, SkywatcherRequest *requests, int count, int *index, int *ttyerror,
+                          bool *retried);
+
+        unsigned int nextTag()
+        {
+            return nexttag++;
+        }
+        SkywatcherLatency &latency()
+        {
+            return histogram;
+        }
+
+    private:
+        unsigned int nexttag;
+        SkywatcherLatency histogram;
+};
@@ -22,6 +22,7 @@
 #include <indicom.h>
 
 #include <termios.h>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 
@@ -32,6 +33,7 @@ Skywatcher::Skywatcher(EQMod *t)
     simulation    = false;
     telescope     = t;
     reconnect     = false;
+    timerclear(&lastpoll);
 }
 
 Skywatcher::~Skywatcher(void)
@@ -100,6 +102,14 @@ bool Skywatcher::Disconnect()
         return true;
     StopMotor(Axis1);
     StopMotor(Axis2);
+
+    const SkywatcherLatency &latency = pipeline.latency();
+    LOGF_DEBUG("Command latency: %d commands, %d timeouts, mean %.1f ms, max %.1f ms", latency.count(),
+               latency.timeouts(), latency.mean(), latency.max());
+    for (int i = 0; i < SkywatcherLatency::BUCKETS; i++)
+        if (latency.bucket(i) > 0)
+            LOGF_DEBUG("  %s %4.0f ms: %d", (i < SkywatcherLatency::BUCKETS - 1) ? "<" : ">=",
+                       SkywatcherLatency::bucketLimit(i < SkywatcherLatency::BUCKETS - 1 ? i : i - 1), latency.bucket(i));
     // Deactivate motor (for geehalel mount only)
     /*
     if (MountCode == 0xF0) {
@@ -113,7 +123,8 @@ bool Skywatcher::Disconnect()
 uint32_t Skywatcher::GetRAEncoder()
 {
     // Axis Position
-    dispatch_command(GetAxisPosition, Axis1, nullptr);
+    if (!take_polled_reply(GetAxisPosition, Axis1))
+        dispatch_command(GetAxisPosition, Axis1, nullptr);
     //read_eqmod();
     RAStep = Revu24str2long(response + 1);
     gettimeofday(&lastreadmotorposition[Axis1], nullptr);
@@ -128,7 +139,8 @@ uint32_t Skywatcher::GetRAEncoder()
 uint32_t Skywatcher::GetDEEncoder()
 {
     // Axis Position
-    dispatch_command(GetAxisPosition, Axis2, nullptr);
+    if (!take_polled_reply(GetAxisPosition, Axis2))
+        dispatch_command(GetAxisPosition, Axis2, nullptr);
     //read_eqmod();
 
     DEStep = Revu24str2long(response + 1);
@@ -690,7 +702,8 @@ bool Skywatcher::IsDERunning()
 
 void Skywatcher::ReadMotorStatus(SkywatcherAxis axis)
 {
-    dispatch_command(GetAxisStatus, axis, nullptr);
+    if (!take_polled_reply(GetAxisStatus, axis))
+        dispatch_command(GetAxisStatus, axis, nullptr);
     //read_eqmod();
     switch (axis)
     {
@@ -1248,7 +1261,8 @@ void Skywatcher::TurnDEEncoder(bool on)
 
 uint32_t Skywatcher::ReadEncoder(SkywatcherAxis axis)
 {
-    dispatch_command(InquireAuxEncoder, axis, nullptr);
+    if (!take_polled_reply(InquireAuxEncoder, axis))
+        dispatch_command(InquireAuxEncoder, axis, nullptr);
     //read_eqmod();
     return Revu24str2long(response + 1);
 }
@@ -1685,6 +1699,9 @@ double Skywatcher::get_max_rate()
 
 bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, char *command_arg)
 {
+    // Whatever the command, the polled replies may be out of date now
+    polledreplies.clear();
+
     for (uint8_t i = 0; i < EQMOD_MAX_RETRY; i++)
     {
         // Clear string
@@ -1697,6 +1714,7 @@ bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, ch
                      SkywatcherTrailingChar);
 
         int nbytes_written = 0;
+        std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
         if (!isSimulation())
         {
             int err_code = 0;
@@ -1727,16 +1745,22 @@ bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, ch
 
         //if (INDI::Logger::debugSerial(cmd)) {
         command[nbytes_written - 1] = '\0'; //hmmm, remove \r, the  SkywatcherTrailingChar
-        DEBUGF(telescope->DBG_COMM, "dispatch_command: \"%s\", %d bytes written", command, nbytes_written);
+        unsigned int tag = pipeline.nextTag();
+        DEBUGF(telescope->DBG_COMM, "dispatch_command: #%u \"%s\", %d bytes written", tag, command, nbytes_written);
         debugnextread = true;
 
         try
         {
             if (read_eqmod())
+            {
+                pipeline.latency().add(
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count());
                 return true;
+            }
         }
         catch (EQModError)
         {
+            pipeline.latency().addTimeout();
             // By this time, we just rethrow the error
             // JM 2018-05-07 immediately rethrow if GET_FEATURES_CMD
             if (i == EQMOD_MAX_RETRY - 1 || cmd == GetFeatureCmd)
@@ -1793,6 +1817,135 @@ bool Skywatcher::read_eqmod()
     return true;
 }
 
+void Skywatcher::PollStatus()
+{
+    const SkywatcherCommand polled[] = { GetAxisPosition, GetAxisStatus, InquireAuxEncoder };
+    SkywatcherRequest requests[6];
+    SkywatcherPolledReply replies[6];
+    int count = 0;
+
+    polledreplies.clear();
+    if (!pipelining)
+        return;
+
+    for (int c = 0; c < (HasAuxEncoders() ? 3 : 2); c++)
+    {
+        for (int a = Axis1; a < NUMBER_OF_SKYWATCHERAXIS; a++)
+        {
+            replies[count].cmd  = polled[c];
+            replies[count].axis = static_cast<SkywatcherAxis>(a);
+            snprintf(requests[count].command, SKYWATCHER_MAX_CMD, "%c%c%c%c", SkywatcherLeadingChar, polled[c],
+                     AxisCmd[a], SkywatcherTrailingChar);
+            requests[count].replylength = reply_length(polled[c]);
+            count++;
+        }
+    }
+
+    int index = 0, ttyerror = TTY_OK;
+    bool retried = false;
+    SkywatcherPipeline::Result result;
+    if (isSimulation())
+    {
+        SkywatcherSimulatorLink<EQModSimulator> link(telescope->simulator);
+        result = pipeline.runOrRetry(&link, requests, count, &index, &ttyerror, &retried);
+    }
+    else
+    {
+        SkywatcherTtyLink link(PortFD, EQMOD_TIMEOUT);
+        result = pipeline.runOrRetry(&link, requests, count, &index, &ttyerror, &retried);
+    }
+
+    if (retried || result != SkywatcherPipeline::PIPELINE_OK)
+    {
+        if (retried)
+            DEBUG(telescope->DBG_COMM, "PollStatus: replies of the batch dropped, polling one command at a time");
+        if (++pipelinefailures >= EQMOD_MAX_RETRY)
+        {
+            pipelining = false;
+            LOG_WARN("Pipelined commands keep failing, sending them one at a time.");
+        }
+    }
+    else
+        pipelinefailures = 0;
+
+    if (result != SkywatcherPipeline::PIPELINE_OK)
+    {
+        // The getters send their own commands then, with the usual retries
+        char ttyerrormsg[ERROR_MSG_LENGTH] = "";
+        if (ttyerror != TTY_OK)
+            tty_error_msg(ttyerror, ttyerrormsg, ERROR_MSG_LENGTH);
+        DEBUGF(telescope->DBG_COMM, "PollStatus: #%u \"%c%c\" failed (%d) %s, reply \"%s\"", requests[index].tag,
+               replies[index].cmd, AxisCmd[replies[index].axis], result, ttyerrormsg, requests[index].reply);
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        DEBUGF(telescope->DBG_COMM, "PollStatus: #%u \"%c%c\" -> \"%s\" in %.1f ms", requests[i].tag, replies[i].cmd,
+               AxisCmd[replies[i].axis], requests[i].reply, requests[i].latency);
+        strncpy(replies[i].reply, requests[i].reply, SKYWATCHER_MAX_CMD);
+        polledreplies.push_back(replies[i]);
+    }
+    gettimeofday(&lastpoll, nullptr);
+}
+
+bool Skywatcher::take_polled_reply(SkywatcherCommand cmd, SkywatcherAxis axis)
+{
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (((now.tv_sec - lastpoll.tv_sec) + ((now.tv_usec - lastpoll.tv_usec) / 1e6)) > SKYWATCHER_MAXREFRESH)
+        polledreplies.clear();
+
+    for (auto r = polledreplies.begin(); r != polledreplies.end(); ++r)
+    {
+        if (r->cmd == cmd && r->axis == axis)
+        {
+            strncpy(response, r->reply, SKYWATCHER_MAX_CMD);
+            polledreplies.erase(r);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Length of the data in the reply to a query, 0 if not checked
+int Skywatcher::reply_length(SkywatcherCommand cmd)
+{
+    switch (cmd)
+    {
+        case GetAxisPosition:
+        case InquireAuxEncoder:
+        case GetStepPeriod:
+            return 6;
+        case GetAxisStatus:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+void Skywatcher::setPipelining(bool enable)
+{
+    pipelining       = enable;
+    pipelinefailures = 0;
+    polledreplies.clear();
+}
+
+bool Skywatcher::isPipelining()
+{
+    return pipelining;
+}
+
+SkywatcherLatency Skywatcher::GetLatency()
+{
+    return pipeline.latency();
+}
+
+void Skywatcher::ClearLatency()
+{
+    pipeline.latency().clear();
+}
+
 uint32_t Skywatcher::Revu24str2long(char *s)
 {
     uint32_t res = 0;
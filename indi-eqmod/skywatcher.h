@@ -18,6 +18,7 @@
 #pragma once
 
 #include "eqmoderror.h"
+#include "skywatcher-pipeline.h"
 
 #include <inditelescope.h>
 
@@ -25,12 +26,12 @@
 
 #include <time.h>
 #include <sys/time.h>
+#include <vector>
 
 class EQMod; // TODO
 
 #include "simulator/simulator.h"
 
-#define SKYWATCHER_MAX_CMD      16
 #define SKYWATCHER_MAX_TRIES    3
 #define SKYWATCHER_ERROR_BUFFER 1024
 
@@ -132,6 +133,15 @@ class Skywatcher
         bool GetSnapPort1Status();
         bool GetSnapPort2Status();
 
+        // Queries the encoders and the status of both axes (and the aux
+        // encoders) in one pipelined batch. The getters called right after
+        // use the replies instead of sending their own command.
+        void PollStatus();
+        void setPipelining(bool enable);
+        bool isPipelining();
+        SkywatcherLatency GetLatency();
+        void ClearLatency();
+
         void setPortFD(int value);
 
     private:
@@ -277,6 +287,8 @@ class Skywatcher
 
         bool read_eqmod();
         bool dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, char *arg);
+        bool take_polled_reply(SkywatcherCommand cmd, SkywatcherAxis axis);
+        int reply_length(SkywatcherCommand cmd);
 
         uint32_t Revu24str2long(char *);
         uint32_t Highstr2long(char *);
@@ -342,6 +354,19 @@ class Skywatcher
 
         bool snapportstatus[NUMBER_OF_SKYWATCHERAXIS];
 
+        // Command pipeline
+        SkywatcherPipeline pipeline;
+        bool pipelining {true};
+        int pipelinefailures {0};
+        struct SkywatcherPolledReply
+        {
+            SkywatcherCommand cmd;
+            SkywatcherAxis axis;
+            char reply[SKYWATCHER_MAX_CMD];
+        };
+        std::vector<SkywatcherPolledReply> polledreplies;
+        struct timeval lastpoll;
+
         const uint8_t EQMOD_TIMEOUT = 5;
         const uint8_t EQMOD_MAX_RETRY = 3;
 };
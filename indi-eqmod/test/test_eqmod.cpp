@@ -4,6 +4,16 @@
 #include "config.h"
 #include "eqmodbase.h"
 
+#include <cstring>
+#ifdef WITH_ALIGN_GEEHALEL
+#include "align/convexhull.h"
+#include "align/sphereindex.h"
+#include "align/chull.h"
+
+#include <algorithm>
+#include <set>
+#endif
+
 
 using ::testing::_;
 using ::testing::StrEq;
@@ -185,6 +195,376 @@ TEST(EqmodTest, encoder_target_south)
     eqmod.TestEncoderTarget();
 }
 
+TEST(EqmodTest, command_pipeline_properties)
+{
+    TestEQMod eqmod;
+
+    ISwitchVectorProperty * const sp = eqmod.getSwitch("COMMAND_PIPELINE");
+    ASSERT_NE(sp, nullptr);
+    EXPECT_EQ(IUFindOnSwitch(sp), IUFindSwitch(sp, "PIPELINE_ON"));
+    INumberVectorProperty * const np = eqmod.getNumber("COMMAND_LATENCY");
+    ASSERT_NE(np, nullptr);
+    EXPECT_NE(IUFindNumber(np, "LATENCY_P95"), nullptr);
+}
+
+// The receive_cmd/send_reply interface of EQModSimulator, without the INDI device
+class SimulatorPort
+{
+public:
+    SimulatorPort()
+    {
+        sim.setupVersion("020300");
+        sim.setupRA(180, 47, 12, 200, 64, 2);
+        sim.setupDE(180, 47, 12, 200, 64, 2);
+    }
+    void receive_cmd(const char *cmd, int *received)
+    {
+        sim.process_command(cmd, received);
+    }
+    void send_reply(char *buf, int *sent)
+    {
+        sim.get_reply(buf, sent);
+    }
+
+private:
+    SkywatcherSimulator sim {};
+};
+
+// Loses the reply to one command
+class LossyLink : public SkywatcherLink
+{
+public:
+    LossyLink(SkywatcherLink *link, int lost) : link(link), lost(lost) {}
+
+    virtual void flush() override
+    {
+        link->flush();
+    }
+    virtual int send(const char *command, int *nbytes_written) override
+    {
+        return link->send(command, nbytes_written);
+    }
+    virtual int receive(char *reply, int size, int *nbytes_read) override
+    {
+        if (received++ == lost)
+            link->receive(reply, size, nbytes_read);
+        return link->receive(reply, size, nbytes_read);
+    }
+
+private:
+    SkywatcherLink *link;
+    int lost;
+    int received {0};
+};
+
+// Keeps the replies still on their way when flushed, as a serial port does
+class InFlightLink : public LossyLink
+{
+public:
+    InFlightLink(SkywatcherLink *link, int lost) : LossyLink(link, lost) {}
+
+    virtual void flush() override {}
+};
+
+static int fill_status_requests(SkywatcherRequest *requests)
+{
+    const char *commands[] = { ":j1\r", ":j2\r", ":f1\r", ":f2\r" };
+    const int lengths[]    = { 6, 6, 3, 3 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        strcpy(requests[i].command, commands[i]);
+        requests[i].replylength = lengths[i];
+    }
+    return 4;
+}
+
+TEST(EqmodTest, skywatcher_pipeline_replies)
+{
+    SimulatorPort port;
+    SkywatcherSimulatorLink<SimulatorPort> link(&port);
+    SkywatcherPipeline pipeline;
+    SkywatcherRequest batch[4], single[4];
+    int index, ttyerror;
+
+    int count = fill_status_requests(batch);
+    fill_status_requests(single);
+
+    ASSERT_EQ(pipeline.run(&link, batch, count, &index, &ttyerror), SkywatcherPipeline::PIPELINE_OK);
+    for (int i = 0; i < count; i++)
+    {
+        ASSERT_EQ(pipeline.run(&link, &single[i], 1, &index, &ttyerror), SkywatcherPipeline::PIPELINE_OK);
+        // The motors are stopped, the replies do not change
+        EXPECT_STREQ(batch[i].reply, single[i].reply);
+        EXPECT_EQ(strlen(batch[i].reply), 1u + batch[i].replylength);
+        if (i > 0)
+        {
+            EXPECT_EQ(batch[i].tag, batch[i - 1].tag + 1);
+        }
+        EXPECT_GT(single[i].tag, batch[count - 1].tag);
+    }
+    EXPECT_EQ(pipeline.latency().count(), 2 * count);
+    EXPECT_EQ(pipeline.latency().timeouts(), 0);
+
+    // Unknown command
+    SkywatcherRequest bad = { ":z1\r", "", 0, 0, 0 };
+    EXPECT_EQ(pipeline.run(&link, &bad, 1, &index, &ttyerror), SkywatcherPipeline::PIPELINE_FAILED_CMD);
+}
+
+TEST(EqmodTest, skywatcher_pipeline_lost_reply)
+{
+    SimulatorPort port;
+    SkywatcherSimulatorLink<SimulatorPort> simlink(&port);
+    SkywatcherPipeline pipeline;
+    SkywatcherRequest requests[4];
+    int index, ttyerror;
+    int count = fill_status_requests(requests);
+
+    // The status of axis 1 is read in place of the position of axis 2
+    LossyLink lose_j2(&simlink, 1);
+    EXPECT_EQ(pipeline.run(&lose_j2, requests, count, &index, &ttyerror), SkywatcherPipeline::PIPELINE_BAD_REPLY);
+    EXPECT_EQ(index, 1);
+
+    // Same length, shifted: only the missing last reply tells
+    LossyLink lose_f1(&simlink, 2);
+    EXPECT_EQ(pipeline.run(&lose_f1, requests, count, &index, &ttyerror), SkywatcherPipeline::PIPELINE_READ_ERROR);
+    EXPECT_EQ(index, 3);
+    EXPECT_EQ(ttyerror, TTY_TIME_OUT);
+    EXPECT_EQ(pipeline.latency().timeouts(), 1);
+
+    // The next batch starts clean
+    EXPECT_EQ(pipeline.run(&simlink, requests, count, &index, &ttyerror), SkywatcherPipeline::PIPELINE_OK);
+}
+
+TEST(EqmodTest, skywatcher_pipeline_retry)
+{
+    SimulatorPort port;
+    SkywatcherSimulatorLink<SimulatorPort> simlink(&port);
+    SkywatcherPipeline pipeline;
+    SkywatcherRequest expected[4], requests[4];
+    int index, ttyerror;
+    bool retried;
+    int count = fill_status_requests(expected);
+    ASSERT_EQ(pipeline.run(&simlink, expected, count, &index, &ttyerror), SkywatcherPipeline::PIPELINE_OK);
+
+    fill_status_requests(requests);
+    EXPECT_EQ(pipeline.runOrRetry(&simlink, requests, count, &index, &ttyerror, &retried),
+              SkywatcherPipeline::PIPELINE_OK);
+    EXPECT_FALSE(retried);
+
+    // Whichever reply is lost, the replies read before it are not kept either:
+    // losing the one of :j1 gives :j1 the reply of :j2, of the same length
+    for (int lost = 0; lost < count; lost++)
+    {
+        InFlightLink link(&simlink, lost);
+        fill_status_requests(requests);
+        EXPECT_EQ(pipeline.runOrRetry(&link, requests, count, &index, &ttyerror, &retried),
+                  SkywatcherPipeline::PIPELINE_OK);
+        EXPECT_TRUE(retried);
+        for (int i = 0; i < count; i++)
+        {
+            EXPECT_STREQ(requests[i].reply, expected[i].reply) << "reply " << lost << " lost";
+        }
+    }
+}
+
+TEST(EqmodTest, skywatcher_latency_histogram)
+{
+    SkywatcherLatency latency;
+
+    EXPECT_EQ(latency.percentile(95), 0);
+    for (int i = 0; i < 90; i++)
+        latency.add(0.5);
+    for (int i = 0; i < 9; i++)
+        latency.add(3);
+    latency.add(5000);
+    latency.addTimeout();
+
+    EXPECT_EQ(latency.count(), 100);
+    EXPECT_EQ(latency.timeouts(), 1);
+    EXPECT_EQ(latency.bucket(0), 90);
+    EXPECT_EQ(latency.bucket(2), 9);
+    EXPECT_EQ(latency.bucket(SkywatcherLatency::BUCKETS - 1), 1);
+    EXPECT_DOUBLE_EQ(latency.percentile(50), 1);
+    EXPECT_DOUBLE_EQ(latency.percentile(95), 4);
+    EXPECT_DOUBLE_EQ(latency.percentile(100), 5000);
+    EXPECT_DOUBLE_EQ(latency.max(), 5000);
+    EXPECT_NEAR(latency.mean(), (90 * 0.5 + 9 * 3 + 5000) / 100, 1e-9);
+
+    latency.clear();
+    EXPECT_EQ(latency.count(), 0);
+    EXPECT_EQ(latency.timeouts(), 0);
+}
+
+#ifdef WITH_ALIGN_GEEHALEL
+TEST(EqmodTest, align_sphere_index)
+{
+    SphereIndex index;
+    std::vector<std::vector<double>> points;
+    std::vector<SphereIndex::Neighbour> nearest;
+    std::vector<size_t> enclosing;
+
+    srand(7);
+    for (size_t i = 0; i < 2000; i++)
+    {
+        double z = 2.0 * rand() / RAND_MAX - 1.0, phi = 2.0 * M_PI * rand() / RAND_MAX;
+        std::vector<double> v = { sqrt(1.0 - z * z) * cos(phi), sqrt(1.0 - z * z) * sin(phi), z };
+        index.add(v.data(), (i % 10) * 0.01, i);
+        points.push_back(v);
+    }
+    index.build();
+
+    for (size_t i = 0; i < 200; i++)
+    {
+        double z = 2.0 * rand() / RAND_MAX - 1.0, phi = 2.0 * M_PI * rand() / RAND_MAX;
+        double q[3] = { sqrt(1.0 - z * z) * cos(phi), sqrt(1.0 - z * z) * sin(phi), z };
+        std::vector<SphereIndex::Neighbour> brute;
+        size_t inside = 0;
+        for (size_t j = 0; j < points.size(); j++)
+        {
+            double d = sqrt((q[0] - points[j][0]) * (q[0] - points[j][0]) + (q[1] - points[j][1]) * (q[1] - points[j][1]) +
+                            (q[2] - points[j][2]) * (q[2] - points[j][2]));
+            brute.push_back(SphereIndex::Neighbour(d, j));
+            if (d <= (j % 10) * 0.01)
+                inside++;
+        }
+        std::sort(brute.begin(), brute.end());
+
+        ASSERT_EQ(index.nearest(q, 5, nearest), 5u);
+        for (size_t k = 0; k < 5; k++)
+        {
+            EXPECT_EQ(nearest[k].second, brute[k].second);
+            EXPECT_NEAR(nearest[k].first, brute[k].first, 1E-12);
+        }
+        EXPECT_EQ(index.enclosing(q, enclosing), inside);
+    }
+}
+
+static ConvexHull::Triangle canonicalFace(int v0, int v1, int v2)
+{
+    // rotate the smallest vertex first, keeping the orientation
+    if (v1 < v0 && v1 < v2)
+        return ConvexHull::Triangle { { v1, v2, v0 } };
+    if (v2 < v0 && v2 < v1)
+        return ConvexHull::Triangle { { v2, v0, v1 } };
+    return ConvexHull::Triangle { { v0, v1, v2 } };
+}
+
+static std::vector<std::array<double, 3>> randomSphere(size_t count, double minz)
+{
+    // the origin first, as in the alignment triangulation
+    std::vector<std::array<double, 3>> points(1, std::array<double, 3> { { 0.0, 0.0, 0.0 } });
+    for (size_t i = 0; i < count; i++)
+    {
+        double z = minz + (1.0 - minz) * rand() / RAND_MAX, phi = 2.0 * M_PI * rand() / RAND_MAX;
+        points.push_back(std::array<double, 3> { { sqrt(1.0 - z * z) * cos(phi), sqrt(1.0 - z * z) * sin(phi), z } });
+    }
+    return points;
+}
+
+static std::set<ConvexHull::Triangle> chullFaces(const std::vector<std::array<double, 3>> &points)
+{
+    std::set<ConvexHull::Triangle> result;
+    tVertex v, vnext;
+    tFace f;
+    int vnum = 0;
+
+    // same calls as the former TriangulateCHull
+    vertices = nullptr;
+    edges    = nullptr;
+    faces    = nullptr;
+    for (const std::array<double, 3> &p : points)
+    {
+        v       = MakeNullVertex();
+        v->v[X] = (int)(p[0] * 1000000);
+        v->v[Y] = (int)(p[1] * 1000000);
+        v->v[Z] = (int)(p[2] * 1000000);
+        v->vnum = vnum++;
+        if (vnum < 4)
+            continue;
+        if (vnum == 4)
+        {
+            DoubleTriangle();
+            ConstructHull();
+        }
+        else
+        {
+            vnext = v->next;
+            AddOne(v);
+            CleanUp(&vnext);
+        }
+    }
+    f = faces;
+    do
+    {
+        result.insert(canonicalFace(f->vertex[0]->vnum, f->vertex[1]->vnum, f->vertex[2]->vnum));
+        f = f->next;
+    } while (f != faces);
+    return result;
+}
+
+static std::set<ConvexHull::Triangle> hullFaces(const ConvexHull &hull)
+{
+    std::set<ConvexHull::Triangle> result;
+    std::vector<ConvexHull::Triangle> triangles;
+    hull.getFaces(triangles);
+    for (const ConvexHull::Triangle &t : triangles)
+        result.insert(canonicalFace(t[0], t[1], t[2]));
+    EXPECT_EQ(result.size(), triangles.size());
+    return result;
+}
+
+TEST(EqmodTest, align_convex_hull)
+{
+    srand(11);
+    for (double minz : { -1.0, 0.0 })
+    {
+        for (size_t count : { 4, 50, 500 })
+        {
+            std::vector<std::array<double, 3>> points = randomSphere(count, minz);
+            ConvexHull hull;
+            for (const std::array<double, 3> &p : points)
+                hull.addPoint(p[0], p[1], p[2]);
+            ASSERT_TRUE(hull.isValid());
+            EXPECT_EQ(hullFaces(hull), chullFaces(points));
+        }
+    }
+}
+
+TEST(EqmodTest, align_convex_hull_restore)
+{
+    std::vector<std::array<double, 3>> points = randomSphere(300, -0.5);
+    std::vector<ConvexHull::Triangle> triangles;
+    ConvexHull hull, restored;
+
+    for (size_t i = 0; i < points.size() - 1; i++)
+    {
+        hull.addPoint(points[i][0], points[i][1], points[i][2]);
+        restored.addVertex(points[i][0], points[i][1], points[i][2]);
+    }
+    hull.getFaces(triangles);
+
+    // a hole or a flipped face is refused
+    std::vector<ConvexHull::Triangle> broken(triangles.begin() + 1, triangles.end());
+    EXPECT_FALSE(restored.restore(broken));
+    broken = triangles;
+    std::swap(broken[0][0], broken[0][1]);
+    EXPECT_FALSE(restored.restore(broken));
+    EXPECT_FALSE(restored.isValid());
+
+    // a restored hull keeps growing like the original one
+    ASSERT_TRUE(restored.restore(triangles));
+    EXPECT_EQ(hullFaces(restored), hullFaces(hull));
+    hull.addPoint(points.back()[0], points.back()[1], points.back()[2]);
+    restored.addPoint(points.back()[0], points.back()[1], points.back()[2]);
+    EXPECT_EQ(hullFaces(restored), hullFaces(hull));
+
+    hull.clear();
+    EXPECT_FALSE(hull.isValid());
+    EXPECT_EQ(hull.faceCount(), 0u);
+}
+#endif
+
 #ifdef WITH_SCOPE_LIMITS
 TEST(EqmodTest, scope_limits_properties)
 {
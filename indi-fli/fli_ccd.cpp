@@ -24,6 +24,7 @@
 #include <memory>
 #include <time.h>
 #include <math.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/time.h>
 
@@ -39,11 +40,52 @@
 #define MAX_X_BIN      16   /* Max Horizontal binning */
 #define MAX_Y_BIN      16   /* Max Vertical binning */
 #define TEMP_THRESHOLD .25  /* Differential temperature threshold (C)*/
+#define SIM_VIDEO_FPS  100  /* Frame rate of the simulated video mode */
+#define STREAMING_TAB  "Streaming"
 
 static std::unique_ptr<FLICCD> fliCCD(new FLICCD());
 
 const flidomain_t Domains[] = { FLIDOMAIN_USB, FLIDOMAIN_SERIAL, FLIDOMAIN_PARALLEL_PORT, FLIDOMAIN_INET };
 
+// Video mode on the camera, for FLIVideoStream
+class FLICameraVideoIo : public FLIVideoIo
+{
+    public:
+        FLICameraVideoIo(flidev_t dev, std::mutex &lock) : dev(dev), lock(lock) {}
+
+        long start(const FLIVideoSettings &settings) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            long err = 0;
+
+            // The image area is set with the binned lower right corner, as in UpdateCCDFrame()
+            if ((err = FLISetExposureTime(dev, settings.exposureMs)) ||
+                    (err = FLISetHBin(dev, settings.binX)) ||
+                    (err = FLISetVBin(dev, settings.binY)) ||
+                    (err = FLISetImageArea(dev, settings.x, settings.y, settings.x + settings.width,
+                                           settings.y + settings.height)))
+                return err;
+
+            return FLIStartVideoMode(dev);
+        }
+
+        long grab(uint16_t *image, size_t numPixels) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return FLIGrabVideoFrame(dev, image, numPixels * sizeof(uint16_t));
+        }
+
+        long stop() override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return FLIStopVideoMode(dev);
+        }
+
+    private:
+        flidev_t dev;
+        std::mutex &lock;
+};
+
 void ISGetProperties(const char *dev)
 {
     fliCCD->ISGetProperties(dev);
@@ -127,6 +169,13 @@ bool FLICCD::initProperties()
     IUFillSwitch(&BackgroundFlushS[1], "DISABLED", "Disabled", ISS_OFF);
     IUFillSwitchVector(&BackgroundFlushSP, BackgroundFlushS, 2, getDeviceName(), "CCD_BACKGROUND_FLUSH", "BKG. Flush", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // Video Stream Statistics
+    IUFillNumber(&StreamStatsN[STATS_FPS], "FPS", "Frames/s", "%.1f", 0, 1e4, 0, 0);
+    IUFillNumber(&StreamStatsN[STATS_CAPTURED], "CAPTURED", "Captured frames", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&StreamStatsN[STATS_DROPPED], "DROPPED", "Dropped frames", "%.f", 0, 1e12, 0, 0);
+    IUFillNumberVector(&StreamStatsNP, StreamStatsN, 3, getDeviceName(), "STREAM_STATS", "Stream Stats", STREAMING_TAB,
+                       IP_RO, 60, IPS_IDLE);
+
     SetCCDCapability(CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME | CCD_HAS_COOLER | CCD_HAS_SHUTTER);
 
     PrimaryCCD.setMinMaxStep("CCD_EXPOSURE", "CCD_EXPOSURE_VALUE", 0.04, 3600, 1, false);
@@ -159,6 +208,9 @@ bool FLICCD::updateProperties()
         if (CameraModeS != nullptr)
             defineSwitch(&CameraModeSP);
 
+        if (HasStreaming())
+            defineNumber(&StreamStatsNP);
+
         timerID = SetTimer(POLLMS);
     }
     else
@@ -171,6 +223,8 @@ bool FLICCD::updateProperties()
         if (CameraModeS != nullptr)
             deleteProperty(CameraModeSP.name);
 
+        deleteProperty(StreamStatsNP.name);
+
         rmTimer(timerID);
     }
 
@@ -186,7 +240,11 @@ bool FLICCD::ISNewNumber(const char *dev, const char *name, double values[], cha
             int err = 0;
             long nflushes = values[0];
 
-            if ((err = FLISetNFlushes(fli_dev, nflushes)))
+            std::unique_lock<std::mutex> guard(fliLock);
+            err = FLISetNFlushes(fli_dev, nflushes);
+            guard.unlock();
+
+            if (err)
             {
                 LOGF_DEBUG("Error: FLISetNFlushes() failed. %s.", strerror(-err));
                 FlushNP.s = IPS_ALERT;
@@ -224,7 +282,12 @@ bool FLICCD::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
         {
             int err = 0;
             bool enabled = !strcmp(IUFindOnSwitchName(states, names, n), "ENABLED");
-            if ((err = FLIControlBackgroundFlush(fli_dev, enabled ? FLI_BGFLUSH_START : FLI_BGFLUSH_STOP)))
+
+            std::unique_lock<std::mutex> guard(fliLock);
+            err = FLIControlBackgroundFlush(fli_dev, enabled ? FLI_BGFLUSH_START : FLI_BGFLUSH_STOP);
+            guard.unlock();
+
+            if (err)
             {
                 LOGF_ERROR("Error: FLIControlBackgroundFlush() %s failed. %s.", (enabled ? "starting" : "stopping"), strerror(-err));
                 BackgroundFlushSP.s = IPS_ALERT;
@@ -248,7 +311,12 @@ bool FLICCD::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
             LIBFLIAPI errCode = 0;
             IUUpdateSwitch(&CameraModeSP, states, names, n);
             flimode_t cameraModelIndex = static_cast<flimode_t>(IUFindOnSwitchIndex(&CameraModeSP));
-            if ( (errCode = FLISetCameraMode(fli_dev, cameraModelIndex)))
+
+            std::unique_lock<std::mutex> guard(fliLock);
+            errCode = FLISetCameraMode(fli_dev, cameraModelIndex);
+            guard.unlock();
+
+            if (errCode)
             {
                 LOGF_ERROR("Error: FLISetCameraMode(%ld) failed. %s.", cameraModelIndex, strerror(-errCode));
                 IUResetSwitch(&CameraModeSP);
@@ -281,6 +349,9 @@ bool FLICCD::Connect()
     if (sim)
     {
         LOG_DEBUG("Simulator used.");
+        SetCCDCapability(GetCCDCapability() | CCD_HAS_STREAMING);
+        videoIo.reset(new FLISimVideoIo(SIM_VIDEO_FPS));
+        videoStream.setIo(videoIo.get());
         return true;
     }
 
@@ -298,6 +369,17 @@ bool FLICCD::Connect()
         return false;
     }
 
+    // libfli has no query for video mode, FLIStopVideoMode() fails on the cameras without it
+    if (FLIStopVideoMode(fli_dev) == 0)
+    {
+        LOG_DEBUG("Camera supports video mode.");
+        SetCCDCapability(GetCCDCapability() | CCD_HAS_STREAMING);
+        videoIo.reset(new FLICameraVideoIo(fli_dev, fliLock));
+        videoStream.setIo(videoIo.get());
+    }
+    else
+        SetCCDCapability(GetCCDCapability() & ~CCD_HAS_STREAMING);
+
     /* Success! */
     LOGF_DEBUG("CCD %s is online.", FLICam.name);
     return true;
@@ -307,6 +389,9 @@ bool FLICCD::Disconnect()
 {
     int err;
 
+    if (streamActive)
+        StopStreaming();
+
     if (sim)
         return true;
 
@@ -525,7 +610,12 @@ int FLICCD::SetTemperature(double temperature)
 {
     int err = 0;
 
-    if (!sim && (err = FLISetTemperature(fli_dev, temperature)))
+    std::unique_lock<std::mutex> guard(fliLock);
+    if (!sim)
+        err = FLISetTemperature(fli_dev, temperature);
+    guard.unlock();
+
+    if (err)
     {
         LOGF_ERROR("FLISetTemperature() failed. %s.", strerror(-err));
         return -1;
@@ -590,6 +680,9 @@ bool FLICCD::UpdateCCDFrameType(INDI::CCDChip::CCD_FRAME fType)
     if (sim)
         return true;
 
+    // The video frames are read with the frame type in place
+    std::lock_guard<std::mutex> guard(fliLock);
+
     int err = 0;
     switch (fType)
     {
@@ -636,18 +729,26 @@ bool FLICCD::UpdateCCDFrame(int x, int y, int w, int h)
     LOGF_DEBUG("Binning (%dx%d). Final FLI image area is (%d, %d), (%ld, %ld). Size (%dx%d)", PrimaryCCD.getBinX(), PrimaryCCD.getBinY(),
                x, y, bin_right, bin_bottom, w / PrimaryCCD.getBinX(), h / PrimaryCCD.getBinY());
 
-    if (!sim && (err = FLISetImageArea(fli_dev, x, y, bin_right, bin_bottom)))
+    // While streaming, the capture thread applies it between two video frames
+    if (!sim && !streamActive && (err = FLISetImageArea(fli_dev, x, y, bin_right, bin_bottom)))
     {
         LOGF_ERROR("FLISetImageArea() failed. %s.", strerror(-err));
         return false;
     }
 
+    std::unique_lock<std::mutex> guard(frameLock);
+
     // Set UNBINNED coords
     PrimaryCCD.setFrame(x, y, w, h);
 
     int nbuf = (w / PrimaryCCD.getBinX()) * (h / PrimaryCCD.getBinY()) * (PrimaryCCD.getBPP() / 8);
     PrimaryCCD.setFrameBufferSize(nbuf);
 
+    guard.unlock();
+
+    if (streamActive)
+        videoStream.update(videoSettings());
+
     return true;
 }
 
@@ -656,20 +757,23 @@ bool FLICCD::UpdateCCDBin(int binx, int biny)
     int err = 0;
 
     /* X horizontal binning */
-    if (!sim && (err = FLISetHBin(fli_dev, binx)))
+    if (!sim && !streamActive && (err = FLISetHBin(fli_dev, binx)))
     {
         LOGF_ERROR("FLISetBin() failed. %s.", strerror(-err));
         return false;
     }
 
     /* Y vertical binning */
-    if (!sim && (err = FLISetVBin(fli_dev, biny)))
+    if (!sim && !streamActive && (err = FLISetVBin(fli_dev, biny)))
     {
         LOGF_ERROR("FLISetVBin() failed. %s.", strerror(-err));
         return false;
     }
 
-    PrimaryCCD.setBin(binx, biny);
+    {
+        std::lock_guard<std::mutex> guard(frameLock);
+        PrimaryCCD.setBin(binx, biny);
+    }
 
     return UpdateCCDFrame(PrimaryCCD.getSubX(), PrimaryCCD.getSubY(), PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
 }
@@ -692,8 +796,20 @@ bool FLICCD::grabImage()
     }
     else
     {
+        size_t frameSize = static_cast<size_t>(row_size) * height;
+        size_t grabbed   = 0;
+
+        // libfli requests the next rows over USB while it converts the previous ones
+        err = FLIGrabFrame(fli_dev, image, frameSize, &grabbed);
+        if (err && err != -EINVAL)
+        {
+            LOGF_ERROR("FLIGrabFrame() failed after %zu of %zu bytes. %s.", grabbed, frameSize, strerror(-err));
+            return false;
+        }
+
+        // Older libfli has no FLIGrabFrame(), read whatever is left row by row
         bool success = true;
-        for (int i = 0; i < height; i++)
+        for (int i = grabbed / row_size; i < height; i++)
         {
             if ((err = FLIGrabRow(fli_dev, image + (i * row_size), width)))
             {
@@ -776,6 +892,18 @@ void FLICCD::TimerHit()
         }
     }
 
+    if (streamActive && !videoStream.active())
+    {
+        LOGF_ERROR("FLIGrabVideoFrame() failed. %s.", strerror(-videoStream.error()));
+        Streamer->setStream(false);
+    }
+
+    if (StreamStatsNP.s == IPS_BUSY)
+        updateStreamStats();
+
+    // Waits for the video frame being read, if any
+    std::unique_lock<std::mutex> guard(fliLock);
+
     switch (TemperatureNP.s)
     {
         case IPS_IDLE:
@@ -857,11 +985,105 @@ void FLICCD::TimerHit()
             break;
     }
 
+    guard.unlock();
+
     if (timerID == -1)
         SetTimer(POLLMS);
     return;
 }
 
+bool FLICCD::StartStreaming()
+{
+    ExposureRequest = 1.0 / Streamer->getTargetFPS();
+    Streamer->setPixelFormat(INDI_MONO, 16);
+
+    long err = videoStream.start(videoSettings());
+    if (err)
+    {
+        LOGF_ERROR("FLIStartVideoMode() failed. %s.", strerror(-err));
+        return false;
+    }
+
+    streamActive    = true;
+    StreamStatsNP.s = IPS_BUSY;
+    streamThread    = std::thread(&FLICCD::streamFrames, this);
+
+    return true;
+}
+
+bool FLICCD::StopStreaming()
+{
+    streamActive = false;
+    if (streamThread.joinable())
+        streamThread.join();
+
+    videoStream.stop();
+
+    StreamStatsNP.s = IPS_IDLE;
+    updateStreamStats();
+
+    if (videoStream.dropped() > 0)
+        LOGF_INFO("Stream finished: %llu frames captured, %llu dropped.",
+                  static_cast<unsigned long long>(videoStream.captured()),
+                  static_cast<unsigned long long>(videoStream.dropped()));
+
+    return true;
+}
+
+FLIVideoSettings FLICCD::videoSettings()
+{
+    FLIVideoSettings settings;
+
+    settings.x          = PrimaryCCD.getSubX();
+    settings.y          = PrimaryCCD.getSubY();
+    settings.width      = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
+    settings.height     = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+    settings.binX       = PrimaryCCD.getBinX();
+    settings.binY       = PrimaryCCD.getBinY();
+    settings.exposureMs = static_cast<long>(ExposureRequest * 1000);
+
+    return settings;
+}
+
+/*
+ * Consumer side of video streaming. The camera is read on the FLIVideoStream
+ * thread, so a slow encoder or recorder costs dropped frames rather than
+ * stalling the camera.
+ */
+void FLICCD::streamFrames()
+{
+    while (streamActive)
+    {
+        FLIVideoStream::Frame *frame = videoStream.next(std::chrono::milliseconds(100));
+        if (frame == nullptr)
+        {
+            // The camera failed, TimerHit() reports it and stops the stream
+            if (!videoStream.active())
+                break;
+            continue;
+        }
+
+        // Frames read before a subframe or binning change no longer match the
+        // streamer, which takes the frame size from the chip as it sends
+        {
+            std::lock_guard<std::mutex> guard(frameLock);
+            if (frame->settings.sameArea(videoSettings()))
+                Streamer->newFrame(reinterpret_cast<uint8_t *>(frame->pixels.data()),
+                                   frame->pixels.size() * sizeof(uint16_t));
+        }
+
+        videoStream.release(frame);
+    }
+}
+
+void FLICCD::updateStreamStats()
+{
+    StreamStatsN[STATS_FPS].value      = videoStream.fps();
+    StreamStatsN[STATS_CAPTURED].value = videoStream.captured();
+    StreamStatsN[STATS_DROPPED].value  = videoStream.dropped();
+    IDSetNumber(&StreamStatsNP, nullptr);
+}
+
 bool FLICCD::findFLICCD(flidomain_t domain)
 {
     char **names;
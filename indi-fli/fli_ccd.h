@@ -25,7 +25,13 @@
 
 #include <libfli.h>
 #include <indiccd.h>
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "fli_video.h"
 
 using namespace std;
 
@@ -47,6 +53,9 @@ class FLICCD : public INDI::CCD
         bool StartExposure(float duration) override;
         bool AbortExposure() override;
 
+        bool StartStreaming() override;
+        bool StopStreaming() override;
+
         virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
         virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
 
@@ -73,6 +82,12 @@ class FLICCD : public INDI::CCD
         // Get initial CCD values upon connection
         bool setupParams();
 
+        // Video stream settings from the current subframe and binning
+        FLIVideoSettings videoSettings();
+        // Hands captured video frames to the streamer
+        void streamFrames();
+        void updateStreamStats();
+
         typedef struct
         {
             flidomain_t domain;
@@ -107,6 +122,15 @@ class FLICCD : public INDI::CCD
         ISwitch *CameraModeS = nullptr;
         ISwitchVectorProperty CameraModeSP;
 
+        enum
+        {
+            STATS_FPS,
+            STATS_CAPTURED,
+            STATS_DROPPED,
+        };
+        INumber StreamStatsN[3];
+        INumberVectorProperty StreamStatsNP;
+
         int timerID = 0;
 
         // Exposure timing
@@ -118,4 +142,14 @@ class FLICCD : public INDI::CCD
 
         // Simulation mode
         bool sim = false;
+
+        // Video mode. fliLock keeps the temperature polling and property changes
+        // from talking to the camera in the middle of a video frame. frameLock
+        // keeps the subframe and binning from changing while a frame is sent.
+        std::mutex fliLock;
+        std::mutex frameLock;
+        std::unique_ptr<FLIVideoIo> videoIo;
+        FLIVideoStream videoStream;
+        std::thread streamThread;
+        std::atomic<bool> streamActive {false};
 };
@@ -0,0 +1,297 @@
+/*
+    FLI CCD
+    INDI Interface for Finger Lakes Instrument CCDs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fli_video.h"
+
+#include <algorithm>
+#include <errno.h>
+
+/* FLISimVideoIo */
+
+FLISimVideoIo::FLISimVideoIo(double fps) : fps(fps)
+{
+}
+
+long FLISimVideoIo::start(const FLIVideoSettings &settings)
+{
+    if (settings.width <= 0 || settings.height <= 0)
+        return -EINVAL;
+
+    this->settings = settings;
+    next           = Clock::now();
+    running        = true;
+    return 0;
+}
+
+long FLISimVideoIo::grab(uint16_t *image, size_t numPixels)
+{
+    if (!running)
+        return -EINVAL;
+    // FLIGrabVideoFrame() refuses buffers smaller than the image area
+    if (numPixels < settings.pixels())
+        return -ENOMEM;
+
+    // A frame takes the longer of the frame period and the exposure
+    double period = std::max(1.0 / fps, settings.exposureMs / 1000.0);
+    next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+
+    // Catch up rather than burst if the reader fell behind, like the camera would
+    Clock::time_point now = Clock::now();
+    if (next < now)
+        next = now;
+    std::this_thread::sleep_until(next);
+
+    for (size_t i = 0; i < numPixels; i++)
+        image[i] = static_cast<uint16_t>((i % settings.width) * 8 + frame * 64);
+    image[0] = frame;
+    if (numPixels > 2)
+    {
+        image[1] = static_cast<uint16_t>(settings.width);
+        image[2] = static_cast<uint16_t>(settings.height);
+    }
+
+    frame++;
+    return 0;
+}
+
+long FLISimVideoIo::stop()
+{
+    running = false;
+    return 0;
+}
+
+/* FLIVideoStream */
+
+FLIVideoStream::FLIVideoStream(FLIVideoIo *io, size_t poolSize) : io(io)
+{
+    // Two buffers at least: one the camera reads into, one with the consumer
+    poolSize = std::max<size_t>(poolSize, 2);
+    for (size_t i = 0; i < poolSize; i++)
+        pool.emplace_back(new Frame());
+}
+
+FLIVideoStream::~FLIVideoStream()
+{
+    stop();
+}
+
+long FLIVideoStream::start(const FLIVideoSettings &settings)
+{
+    stop();
+
+    long err = io->start(settings);
+    if (err)
+        return err;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    freeFrames.clear();
+    readyFrames.clear();
+    for (auto &frame : pool)
+        freeFrames.push_back(frame.get());
+
+    this->settings  = settings;
+    settingsChanged = false;
+    lastError       = 0;
+    capturedFrames = deliveredFrames = droppedFrames = 0;
+    rate            = 0;
+    running         = true;
+
+    thread = std::thread(&FLIVideoStream::capture, this);
+    return 0;
+}
+
+void FLIVideoStream::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!thread.joinable())
+            return;
+        running = false;
+    }
+    readyCond.notify_all();
+
+    // The capture thread finishes the frame it is reading first
+    thread.join();
+    io->stop();
+}
+
+void FLIVideoStream::update(const FLIVideoSettings &settings)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    this->settings  = settings;
+    settingsChanged = true;
+    settingsVersion++;
+}
+
+FLIVideoStream::Frame *FLIVideoStream::next(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    readyCond.wait_for(guard, timeout, [this]
+    {
+        return !readyFrames.empty() || !running;
+    });
+    if (readyFrames.empty())
+        return nullptr;
+
+    Frame *frame = readyFrames.front();
+    readyFrames.pop_front();
+    deliveredFrames++;
+    return frame;
+}
+
+void FLIVideoStream::release(Frame *frame)
+{
+    if (frame == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    freeFrames.push_back(frame);
+}
+
+bool FLIVideoStream::stale(const Frame *frame) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return frame->version != settingsVersion;
+}
+
+bool FLIVideoStream::active() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return running;
+}
+
+long FLIVideoStream::error() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return lastError;
+}
+
+uint64_t FLIVideoStream::captured() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return capturedFrames;
+}
+
+uint64_t FLIVideoStream::delivered() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return deliveredFrames;
+}
+
+uint64_t FLIVideoStream::dropped() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return droppedFrames;
+}
+
+double FLIVideoStream::fps() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return rate;
+}
+
+void FLIVideoStream::capture()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    FLIVideoSettings current = settings;
+    uint64_t version         = settingsVersion;
+
+    rateStart  = Clock::now();
+    rateFrames = 0;
+
+    while (running)
+    {
+        if (settingsChanged)
+        {
+            current         = settings;
+            version         = settingsVersion;
+            settingsChanged = false;
+
+            guard.unlock();
+            io->stop();
+            long err = io->start(current);
+            guard.lock();
+
+            if (err)
+            {
+                lastError = err;
+                running   = false;
+                break;
+            }
+        }
+
+        Frame *frame = nullptr;
+        if (!freeFrames.empty())
+        {
+            frame = freeFrames.front();
+            freeFrames.pop_front();
+        }
+        else if (!readyFrames.empty())
+        {
+            frame = readyFrames.front();
+            readyFrames.pop_front();
+            droppedFrames++;
+        }
+        else
+        {
+            // Every buffer is with the consumer
+            readyCond.wait_for(guard, std::chrono::milliseconds(10));
+            continue;
+        }
+
+        guard.unlock();
+
+        // Only reallocates when the frame grows past what the buffer held before
+        frame->pixels.resize(current.pixels());
+        long err             = io->grab(frame->pixels.data(), frame->pixels.size());
+        Clock::time_point at = Clock::now();
+
+        guard.lock();
+
+        if (err)
+        {
+            freeFrames.push_back(frame);
+            lastError = err;
+            running   = false;
+            break;
+        }
+
+        frame->settings = current;
+        frame->number   = capturedFrames++;
+        frame->version  = version;
+        frame->captured = at;
+        readyFrames.push_back(frame);
+
+        rateFrames++;
+        double elapsed = std::chrono::duration<double>(at - rateStart).count();
+        if (elapsed >= 1)
+        {
+            rate       = rateFrames / elapsed;
+            rateStart  = at;
+            rateFrames = 0;
+        }
+
+        readyCond.notify_all();
+    }
+
+    guard.unlock();
+    readyCond.notify_all();
+}
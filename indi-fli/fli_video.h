@@ -0,0 +1,165 @@
+/*
+    FLI CCD
+    INDI Interface for Finger Lakes Instrument CCDs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Image area and timing of a video stream. x and y are unbinned, width and
+// height are the binned size of the frames, as FLISetImageArea() takes them.
+struct FLIVideoSettings
+{
+    long x {0}, y {0};
+    long width {0}, height {0};
+    int binX {1}, binY {1};
+    long exposureMs {0};
+
+    size_t pixels() const
+    {
+        return static_cast<size_t>(width) * height;
+    }
+
+    // Same image area and binning, whatever the exposure
+    bool sameArea(const FLIVideoSettings &other) const
+    {
+        return x == other.x && y == other.y && width == other.width && height == other.height &&
+               binX == other.binX && binY == other.binY;
+    }
+};
+
+// Camera side of video mode. Errors are returned as -errno, as libfli does.
+class FLIVideoIo
+{
+    public:
+        virtual ~FLIVideoIo() = default;
+
+        // Apply the settings and put the camera in video mode
+        virtual long start(const FLIVideoSettings &settings) = 0;
+        // Wait for the next frame and read it into image
+        virtual long grab(uint16_t *image, size_t numPixels) = 0;
+        virtual long stop() = 0;
+};
+
+// Stands in for the camera when there is none. Frames come out at a fixed
+// rate, or one per exposure if that is longer, and hold a gradient whose
+// first pixel is the frame number and next two the frame size.
+class FLISimVideoIo : public FLIVideoIo
+{
+    public:
+        explicit FLISimVideoIo(double fps = 30);
+
+        long start(const FLIVideoSettings &settings) override;
+        long grab(uint16_t *image, size_t numPixels) override;
+        long stop() override;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        double fps;
+        FLIVideoSettings settings;
+        Clock::time_point next;
+        uint16_t frame {0};
+        bool running {false};
+};
+
+// Reads video frames on its own thread into a small pool of buffers that are
+// handed to the consumer and recycled, so a slow consumer costs frames rather
+// than stalling the camera. When no buffer is free, the oldest frame waiting
+// for the consumer is overwritten and counted as dropped.
+class FLIVideoStream
+{
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Frame
+        {
+            std::vector<uint16_t> pixels;
+            FLIVideoSettings settings;
+            uint64_t number {0};
+            uint64_t version {0};
+            Clock::time_point captured;
+        };
+
+        explicit FLIVideoStream(FLIVideoIo *io = nullptr, size_t poolSize = 4);
+        ~FLIVideoStream();
+
+        void setIo(FLIVideoIo *io)
+        {
+            this->io = io;
+        }
+
+        // Starts video mode and the capture thread. Returns 0 or the -errno of
+        // the camera.
+        long start(const FLIVideoSettings &settings);
+        void stop();
+
+        // New settings take effect from the next frame. The capture thread stops
+        // video mode and restarts it with them, as the camera needs.
+        void update(const FLIVideoSettings &settings);
+
+        // Waits up to timeout for a frame. The frame belongs to the caller until
+        // it is given back with release(). Returns nullptr on timeout, or when
+        // capture has stopped.
+        Frame *next(std::chrono::milliseconds timeout);
+        void release(Frame *frame);
+
+        // True if the frame was taken with settings older than the last update()
+        bool stale(const Frame *frame) const;
+
+        bool active() const;
+        // Camera error that ended capture, 0 if none
+        long error() const;
+
+        uint64_t captured() const;
+        uint64_t delivered() const;
+        uint64_t dropped() const;
+        // Frames captured per second over the last second or so
+        double fps() const;
+
+    private:
+        void capture();
+
+        FLIVideoIo *io;
+        std::vector<std::unique_ptr<Frame>> pool;
+        std::deque<Frame *> freeFrames;
+        std::deque<Frame *> readyFrames;
+
+        mutable std::mutex lock;
+        std::condition_variable readyCond;
+        std::thread thread;
+
+        FLIVideoSettings settings;
+        uint64_t settingsVersion {0};
+        bool settingsChanged {false};
+        bool running {false};
+        long lastError {0};
+
+        uint64_t capturedFrames {0}, deliveredFrames {0}, droppedFrames {0};
+        Clock::time_point rateStart;
+        uint64_t rateFrames {0};
+        double rate {0};
+};
@@ -0,0 +1,237 @@
+/*
+    FLI CCD
+    INDI Interface for Finger Lakes Instrument CCDs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+ * Checks FLIVideoStream against the simulated camera: the frame rate it
+ * keeps up with, the frames it drops behind a slow consumer, subframe and
+ * binning changes while streaming, and a camera error ending the stream:
+ *
+ *     fli_video_check [fps] [seconds]
+ */
+
+#include "fli_video.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <errno.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static FLIVideoSettings makeSettings(long x, long y, long width, long height, int bin)
+{
+    FLIVideoSettings settings;
+    settings.x      = x;
+    settings.y      = y;
+    settings.width  = width;
+    settings.height = height;
+    settings.binX   = bin;
+    settings.binY   = bin;
+    return settings;
+}
+
+/* Takes frames for the given time, consumerMs per frame, and checks they
+ * come out in order and match the settings they were taken with.
+ */
+static bool consume(const char *name, FLIVideoStream &stream, double seconds, double consumerMs, uint64_t &received)
+{
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    int64_t last = -1;
+
+    received = 0;
+    while (Clock::now() < end)
+    {
+        FLIVideoStream::Frame *frame = stream.next(std::chrono::milliseconds(100));
+        if (frame == nullptr)
+            continue;
+
+        const FLIVideoSettings &settings = frame->settings;
+        if (static_cast<int64_t>(frame->number) <= last || frame->pixels.size() != settings.pixels() ||
+                frame->pixels[0] != static_cast<uint16_t>(frame->number) || frame->pixels[1] != settings.width ||
+                frame->pixels[2] != settings.height)
+        {
+            fprintf(stderr, "%s: frame %llu after %lld, %zu pixels for %ldx%ld, header %u %u %u\n", name,
+                    static_cast<unsigned long long>(frame->number), static_cast<long long>(last), frame->pixels.size(),
+                    settings.width, settings.height, frame->pixels[0], frame->pixels[1], frame->pixels[2]);
+            stream.release(frame);
+            return false;
+        }
+        last = frame->number;
+        received++;
+
+        if (consumerMs > 0)
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(consumerMs));
+        stream.release(frame);
+    }
+
+    return true;
+}
+
+static bool checkRate(double fps, double seconds)
+{
+    FLISimVideoIo io(fps);
+    FLIVideoStream stream(&io);
+    uint64_t received = 0;
+
+    if (stream.start(makeSettings(0, 0, 320, 240, 1)) != 0)
+        return false;
+    bool ok = consume("rate", stream, seconds, 0, received);
+    double measured = stream.fps();
+    stream.stop();
+
+    printf("rate: camera at %.0f frames/s, measured %.1f frames/s, %llu captured, %llu dropped\n", fps, measured,
+           static_cast<unsigned long long>(stream.captured()), static_cast<unsigned long long>(stream.dropped()));
+
+    if (std::fabs(measured - fps) > fps * 0.1 || stream.dropped() != 0)
+    {
+        fprintf(stderr, "rate: expected %.0f frames/s without drops\n", fps);
+        return false;
+    }
+    return ok;
+}
+
+static bool checkSlowConsumer(double fps, double seconds)
+{
+    FLISimVideoIo io(fps);
+    FLIVideoStream stream(&io);
+    uint64_t received = 0;
+    double consumerMs = 2500 / fps;
+
+    if (stream.start(makeSettings(0, 0, 320, 240, 1)) != 0)
+        return false;
+    bool ok = consume("slow", stream, seconds, consumerMs, received);
+    stream.stop();
+
+    uint64_t captured = stream.captured(), delivered = stream.delivered(), dropped = stream.dropped();
+    printf("slow consumer: %.1f ms per frame, %llu captured, %llu delivered, %llu dropped\n", consumerMs,
+           static_cast<unsigned long long>(captured), static_cast<unsigned long long>(delivered),
+           static_cast<unsigned long long>(dropped));
+
+    // The camera keeps its rate, the frames the consumer misses are dropped
+    if (captured < fps * seconds * 0.9 || dropped == 0 || delivered + dropped > captured ||
+            captured - delivered - dropped > 4)
+    {
+        fprintf(stderr, "slow consumer: counters do not add up\n");
+        return false;
+    }
+    return ok;
+}
+
+static bool checkLiveChanges(double fps)
+{
+    FLISimVideoIo io(fps);
+    FLIVideoStream stream(&io);
+    uint64_t received = 0;
+
+    const FLIVideoSettings steps[] =
+    {
+        makeSettings(0, 0, 640, 480, 1),
+        makeSettings(100, 50, 64, 32, 1),
+        makeSettings(0, 0, 320, 240, 2),
+        makeSettings(0, 0, 1280, 1024, 1),
+    };
+
+    if (stream.start(steps[0]) != 0)
+        return false;
+
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        if (i > 0)
+            stream.update(steps[i]);
+
+        // Frames taken before the change may still be queued
+        FLIVideoStream::Frame *frame = nullptr;
+        for (int tries = 0; tries < 20; tries++)
+        {
+            frame = stream.next(std::chrono::milliseconds(500));
+            if (frame == nullptr || !stream.stale(frame))
+                break;
+            stream.release(frame);
+            frame = nullptr;
+        }
+        if (frame == nullptr || !frame->settings.sameArea(steps[i]))
+        {
+            fprintf(stderr, "live changes: no %ldx%ld bin %d frame\n", steps[i].width, steps[i].height, steps[i].binX);
+            stream.release(frame);
+            return false;
+        }
+        stream.release(frame);
+
+        if (!consume("live changes", stream, 0.5, 0, received))
+            return false;
+    }
+
+    stream.stop();
+    printf("live changes: %zu subframe and binning changes applied while streaming\n", sizeof(steps) / sizeof(steps[0]) - 1);
+    return true;
+}
+
+// Fails like a camera unplugged mid stream
+class FailingVideoIo : public FLISimVideoIo
+{
+    public:
+        FailingVideoIo(double fps, int frames) : FLISimVideoIo(fps), frames(frames) {}
+
+        long grab(uint16_t *image, size_t numPixels) override
+        {
+            if (frames-- <= 0)
+                return -EIO;
+            return FLISimVideoIo::grab(image, numPixels);
+        }
+
+    private:
+        int frames;
+};
+
+static bool checkError(double fps)
+{
+    FailingVideoIo io(fps, 5);
+    FLIVideoStream stream(&io);
+    uint64_t received = 0;
+
+    if (stream.start(makeSettings(0, 0, 320, 240, 1)) != 0)
+        return false;
+    bool ok = consume("error", stream, 10 / fps + 0.2, 0, received);
+
+    if (stream.active() || stream.error() != -EIO || received != 5)
+    {
+        fprintf(stderr, "error: stream %s, error %ld, %llu frames\n", stream.active() ? "active" : "stopped",
+                stream.error(), static_cast<unsigned long long>(received));
+        return false;
+    }
+    stream.stop();
+
+    printf("error: stream stopped after %llu frames\n", static_cast<unsigned long long>(received));
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    double fps     = argc > 1 ? atof(argv[1]) : 50;
+    double seconds = argc > 2 ? atof(argv[2]) : 2.5;
+
+    bool ok = true;
+
+    ok = checkRate(fps, seconds) && ok;
+    ok = checkSlowConsumer(fps, seconds) && ok;
+    ok = checkLiveChanges(fps) && ok;
+    ok = checkError(fps) && ok;
+
+    return ok ? 0 : 1;
+}
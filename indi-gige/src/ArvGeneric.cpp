@@ -20,6 +20,8 @@
 
 using namespace arv;
 
+#define STREAM_POP_TIMEOUT_US (100000) /* Bounds the time stream_stop() waits for the acquisition thread */
+
 const char *ArvGeneric::_str_val(const char *s)
 {
     return (s ? s : "None");
@@ -104,6 +106,8 @@ bool ArvGeneric::_stream_active()
 
 ArvGeneric::ArvGeneric(void *camera_device) : ArvCamera(camera_device)
 {
+    this->n_buffers     = STREAM_DEFAULT_BUFFERS;
+    this->packet_resend = true;
     this->_init();
     this->camera = (::ArvCamera *)camera_device;
     this->dev    = arv_camera_get_device(this->camera);
@@ -147,10 +151,16 @@ bool ArvGeneric::_configure(void)
 
 void ArvGeneric::_init()
 {
-    this->camera        = nullptr;
-    this->buffer        = nullptr;
-    this->stream        = nullptr;
-    this->stream_active = false;
+    this->camera            = nullptr;
+    this->stream            = nullptr;
+    this->stream_active     = false;
+    this->free_run          = false;
+    this->streaming         = false;
+    this->stream_callback   = nullptr;
+    this->stream_usr_ptr    = nullptr;
+    this->buffer_payload    = 0;
+    this->stream_stats_base = ARV_STREAM_STATISTICS();
+    this->buffers.clear();
 
     /* Don't clear device_id, its needed to re-attach with connect() */
 }
@@ -159,7 +169,9 @@ bool ArvGeneric::disconnect()
 {
     if (this->is_connected())
     {
+        this->stream_stop();
         this->_test_exposure_and_abort();
+        this->_stream_destroy();
         g_clear_object(&this->camera);
     }
     this->_init();
@@ -264,36 +276,71 @@ void ArvGeneric::set_exposure_time(double const val)
     this->_set_cam_exposure_property(arv_camera_set_exposure_time, &this->cam.exposure, val);
 }
 
-::ArvBuffer *ArvGeneric::_buffer_create(void)
+bool ArvGeneric::_stream_prepare(void)
 {
-    ::ArvBuffer *buffer;
+    gint const payload = arv_camera_get_payload(this->camera);
 
-    /* Ensure no buffers in stream */
-    while (1)
+    /* Buffers can't be taken back from a stream, so a new payload size or pool size needs a new stream */
+    if (this->stream && ((size_t)payload != this->buffer_payload || this->buffers.size() != (size_t)this->n_buffers))
+        this->_stream_destroy();
+
+    if (this->stream)
     {
-        buffer = arv_stream_try_pop_buffer(this->stream);
-        if (buffer)
-            g_clear_object(&buffer);
-        else
-            break;
+        /* Recycle whatever an aborted or failed acquisition left behind */
+        ::ArvBuffer *buffer;
+        gint n_input, n_output;
+        arv_stream_get_n_buffers(this->stream, &n_input, &n_output);
+        while (n_output-- > 0 && (buffer = arv_stream_try_pop_buffer(this->stream)) != nullptr)
+            arv_stream_push_buffer(this->stream, buffer);
+        return true;
     }
 
-    gint const payload = arv_camera_get_payload(this->camera);
-    buffer             = arv_buffer_new(payload, nullptr);
-    arv_stream_push_buffer(this->stream, buffer);
-    return buffer;
+    this->stream = arv_camera_create_stream(this->camera, nullptr, nullptr);
+    if (!this->stream)
+        return false;
+
+    this->_stream_apply_packet_resend();
+
+    for (int i = 0; i < this->n_buffers; i++)
+    {
+        ::ArvBuffer *const buffer = arv_buffer_new(payload, nullptr);
+        this->buffers.push_back(buffer);
+        arv_stream_push_buffer(this->stream, buffer);
+    }
+    this->buffer_payload = payload;
+    return true;
 }
 
-::ArvStream *ArvGeneric::_stream_create(void)
+void ArvGeneric::_stream_destroy(void)
 {
-    ::ArvStream *stream = arv_camera_create_stream(this->camera, nullptr, nullptr);
-    return stream;
+    /* The stream releases the buffers it holds */
+    g_clear_object(&this->stream);
+    this->buffers.clear();
+    this->buffer_payload    = 0;
+    this->stream_stats_base = ARV_STREAM_STATISTICS();
+}
+
+void ArvGeneric::_stream_apply_packet_resend(void)
+{
+    if (this->stream && ARV_IS_GV_STREAM(this->stream))
+    {
+        g_object_set(this->stream, "packet-resend",
+                     this->packet_resend ? ARV_GV_STREAM_PACKET_RESEND_ALWAYS : ARV_GV_STREAM_PACKET_RESEND_NEVER,
+                     nullptr);
+    }
 }
 
 void ArvGeneric::_stream_start()
 {
     this->stream_active = true;
 
+    /* Back from free-run to one software triggered frame per acquisition */
+    if (this->free_run)
+    {
+        arv_camera_set_trigger(this->camera, "Software");
+        this->free_run = false;
+    }
+
     /* Start the acquisition stream */
     arv_camera_set_acquisition_mode(this->camera, ARV_ACQUISITION_MODE_SINGLE_FRAME);
     arv_camera_start_acquisition(this->camera);
@@ -301,9 +348,8 @@ void ArvGeneric::_stream_start()
 
 void ArvGeneric::_stream_stop()
 {
-    /* stop the acquisition stream */
+    /* stop the acquisition stream, the stream and its buffers are kept for the next one */
     arv_camera_stop_acquisition(this->camera);
-    g_object_unref(this->stream);
 
     this->stream_active = false;
 }
@@ -317,8 +363,8 @@ void ArvGeneric::_trigger_exposure()
 void ArvGeneric::exposure_start(void)
 {
     this->_test_exposure_and_abort();
-    this->stream = this->_stream_create();
-    this->buffer = this->_buffer_create();
+    if (this->is_streaming() || !this->_stream_prepare())
+        return;
 
     this->_stream_start();
     this->_trigger_exposure();
@@ -333,22 +379,14 @@ void ArvGeneric::exposure_abort(void)
     }
 }
 
-void ArvGeneric::_get_image(void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr)
+void ArvGeneric::_get_image(::ArvBuffer *const buffer,
+                            void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr)
 {
-    ArvBuffer *const popped_buf = arv_stream_timeout_pop_buffer(this->stream, 100000);
-    if ((popped_buf != nullptr) && (popped_buf == this->buffer) &&
-        arv_buffer_get_status(this->buffer) == ARV_BUFFER_STATUS_SUCCESS)
-    {
-        if (fn_image_callback != nullptr)
-        {
-            size_t size;
-            uint8_t const *const data = (uint8_t const *const)arv_buffer_get_data(this->buffer, &size);
-            fn_image_callback(usr_ptr, data, size);
-        }
-    }
-    else
+    if (fn_image_callback != nullptr)
     {
-        //TODO: failure...
+        size_t size;
+        uint8_t const *const data = (uint8_t const *const)arv_buffer_get_data(buffer, &size);
+        fn_image_callback(usr_ptr, data, size);
     }
 }
 
@@ -358,27 +396,132 @@ ARV_EXPOSURE_STATUS ArvGeneric::exposure_poll(void (*fn_image_callback)(void *co
     if (!this->_stream_active())
         return ARV_EXPOSURE_UNKNOWN;
 
-    ::ArvBufferStatus const status = arv_buffer_get_status(this->buffer);
-    switch (status)
+    /* Buffers come back to the output queue in the order they were filled */
+    ::ArvBuffer *const buffer = arv_stream_try_pop_buffer(this->stream);
+    if (buffer == nullptr)
+    {
+        for (::ArvBuffer *const pending : this->buffers)
+        {
+            if (arv_buffer_get_status(pending) == ARV_BUFFER_STATUS_FILLING)
+                return ARV_EXPOSURE_FILLING;
+        }
+        return ARV_EXPOSURE_BUSY;
+    }
+
+    ::ArvBufferStatus const status = arv_buffer_get_status(buffer);
+    ARV_EXPOSURE_STATUS result     = ARV_EXPOSURE_FAILED;
+    if (status == ARV_BUFFER_STATUS_SUCCESS)
+    {
+        this->_get_image(buffer, fn_image_callback, usr_ptr);
+        result = ARV_EXPOSURE_FINISHED;
+    }
+
+    arv_stream_push_buffer(this->stream, buffer);
+    this->_stream_stop();
+    return result;
+}
+
+void ArvGeneric::set_stream_buffers(int const count)
+{
+    /* Takes effect with the next stream created */
+    this->n_buffers = (count < 2 ? 2 : count);
+}
+
+void ArvGeneric::set_packet_resend(bool const enable)
+{
+    this->packet_resend = enable;
+    this->_stream_apply_packet_resend();
+}
+
+bool ArvGeneric::is_streaming()
+{
+    return this->streaming;
+}
+
+bool ArvGeneric::stream_start(double const frame_rate,
+                              void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                              void *const usr_ptr)
+{
+    this->_test_exposure_and_abort();
+    if (this->is_streaming())
+        return true;
+    if (!this->_stream_prepare())
+        return false;
+
+    this->stream_callback = fn_image_callback;
+    this->stream_usr_ptr  = usr_ptr;
+
+    /* Free-run: the camera paces the frames itself */
+    this->cam.frame_rate.set(frame_rate);
+    arv_camera_set_frame_rate(this->camera, this->cam.frame_rate.val());
+    arv_device_set_string_feature_value(this->dev, "TriggerMode", "Off");
+    this->free_run = true;
+
+    this->stream_stats_base = this->_stream_read_statistics();
+    this->streaming         = true;
+
+    arv_camera_set_acquisition_mode(this->camera, ARV_ACQUISITION_MODE_CONTINUOUS);
+    arv_camera_start_acquisition(this->camera);
+
+    this->acquisition_thread = std::thread(&ArvGeneric::_acquisition_loop, this);
+    return true;
+}
+
+void ArvGeneric::stream_stop(void)
+{
+    if (!this->is_streaming())
+        return;
+
+    this->streaming = false;
+    this->acquisition_thread.join();
+    arv_camera_stop_acquisition(this->camera);
+}
+
+void ArvGeneric::_acquisition_loop(void)
+{
+    while (this->streaming)
     {
-        case ARV_BUFFER_STATUS_CLEARED:
-            return ARV_EXPOSURE_BUSY;
-        case ARV_BUFFER_STATUS_FILLING:
-            return ARV_EXPOSURE_FILLING;
-        case ARV_BUFFER_STATUS_UNKNOWN:
-            return ARV_EXPOSURE_UNKNOWN;
-        case ARV_BUFFER_STATUS_SUCCESS:
-            this->_get_image(fn_image_callback, usr_ptr);
-            this->_stream_stop();
-            return ARV_EXPOSURE_FINISHED;
-        case ARV_BUFFER_STATUS_TIMEOUT:
-        case ARV_BUFFER_STATUS_MISSING_PACKETS:
-        case ARV_BUFFER_STATUS_WRONG_PACKET_ID:
-        case ARV_BUFFER_STATUS_SIZE_MISMATCH:
-        case ARV_BUFFER_STATUS_ABORTED:
-            this->_stream_stop();
-            return ARV_EXPOSURE_FAILED;
-        default:
-            return ARV_EXPOSURE_UNKNOWN;
+        ::ArvBuffer *const buffer = arv_stream_timeout_pop_buffer(this->stream, STREAM_POP_TIMEOUT_US);
+        if (buffer == nullptr)
+            continue;
+
+        /* Failed frames are counted by the stream statistics, just recycle them */
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS)
+            this->_get_image(buffer, this->stream_callback, this->stream_usr_ptr);
+        arv_stream_push_buffer(this->stream, buffer);
     }
 }
+
+ARV_STREAM_STATISTICS ArvGeneric::_stream_read_statistics(void)
+{
+    ARV_STREAM_STATISTICS stats = ARV_STREAM_STATISTICS();
+    if (!this->stream)
+        return stats;
+
+    guint64 completed, failures, underruns;
+    arv_stream_get_statistics(this->stream, &completed, &failures, &underruns);
+    stats.completed = completed;
+    stats.failures  = failures;
+    stats.underruns = underruns;
+
+    if (ARV_IS_GV_STREAM(this->stream))
+    {
+        guint64 resent, missing;
+        arv_gv_stream_get_statistics(ARV_GV_STREAM(this->stream), &resent, &missing);
+        stats.resent_packets  = resent;
+        stats.missing_packets = missing;
+    }
+    return stats;
+}
+
+ARV_STREAM_STATISTICS ArvGeneric::get_stream_statistics(void)
+{
+    /* Counted from the start of the last continuous acquisition */
+    ARV_STREAM_STATISTICS stats = this->_stream_read_statistics();
+    stats.completed -= this->stream_stats_base.completed;
+    stats.failures -= this->stream_stats_base.failures;
+    stats.underruns -= this->stream_stats_base.underruns;
+    stats.resent_packets -= this->stream_stats_base.resent_packets;
+    stats.missing_packets -= this->stream_stats_base.missing_packets;
+    return stats;
+}
@@ -25,6 +25,10 @@ extern "C" {
 #include <arv.h>
 }
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "ArvInterface.h"
 
 using namespace arv;
@@ -66,6 +70,14 @@ class ArvGeneric : public arv::ArvCamera
     ARV_EXPOSURE_STATUS exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                       void *const usr_ptr);
 
+    void set_stream_buffers(int const count);
+    void set_packet_resend(bool const enable);
+    bool is_streaming();
+    bool stream_start(double const frame_rate, void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                      void *const usr_ptr);
+    void stream_stop(void);
+    ARV_STREAM_STATISTICS get_stream_statistics(void);
+
   protected:
     void _init(void);
     bool _configure(void);
@@ -78,23 +90,41 @@ class ArvGeneric : public arv::ArvCamera
     const char *_str_val(const char *s);
     bool _get_initial_config();
     bool _set_initial_config();
-    void _get_image(void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr);
+    void _get_image(::ArvBuffer *const buffer, void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                    void *const usr_ptr);
 
     /* aravis library state variables */
     ::ArvCamera *camera;
     ::ArvDevice *dev;
     ::ArvStream *stream;
-    ::ArvBuffer *buffer;
+
+    /* Buffers pushed to the stream once, and pushed back after every frame. The stream
+     * owns them, the pointers are only kept to look at their status */
+    std::vector<::ArvBuffer *> buffers;
+    size_t buffer_payload;
+    int n_buffers;
+    bool packet_resend;
 
     /* streaming, capturing functions */
-    ::ArvStream *_stream_create(void);
-    ::ArvBuffer *_buffer_create(void);
+    bool _stream_prepare(void);
+    void _stream_destroy(void);
+    void _stream_apply_packet_resend(void);
+    ARV_STREAM_STATISTICS _stream_read_statistics(void);
     bool _stream_active();
     void _stream_start();
     void _stream_stop();
     void _trigger_exposure();
+    void _acquisition_loop(void);
 
     bool stream_active;
+    bool free_run;
+
+    /* Continuous acquisition state */
+    std::thread acquisition_thread;
+    std::atomic<bool> streaming;
+    void (*stream_callback)(void *const, uint8_t const *const, size_t);
+    void *stream_usr_ptr;
+    ARV_STREAM_STATISTICS stream_stats_base;
 
     /* Camera properties */
     struct
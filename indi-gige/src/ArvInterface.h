@@ -22,6 +22,9 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/* Stream buffers queued to the camera unless set_stream_buffers() says otherwise */
+#define STREAM_DEFAULT_BUFFERS (8)
+
 namespace arv
 {
 typedef enum {
@@ -33,6 +36,14 @@ typedef enum {
 
 } ARV_EXPOSURE_STATUS;
 
+typedef struct {
+    uint64_t completed;       //!< Frames received complete
+    uint64_t failures;        //!< Frames received with an error (timeout, missing packets, ...)
+    uint64_t underruns;       //!< Frames dropped because no buffer was queued
+    uint64_t resent_packets;  //!< Packets the camera had to resend (GigE Vision only)
+    uint64_t missing_packets; //!< Packets lost in spite of resend requests (GigE Vision only)
+} ARV_STREAM_STATISTICS;
+
 template <class T>
 class min_max_property
 {
@@ -109,6 +120,16 @@ class ArvCamera
     virtual void exposure_abort(void)                      = 0;
     virtual ARV_EXPOSURE_STATUS exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                               void *const) = 0;
+
+    /* Continuous acquisition, frames are passed to the callback from the acquisition thread */
+    virtual void set_stream_buffers(int const count)  = 0;
+    virtual void set_packet_resend(bool const enable) = 0;
+    virtual bool is_streaming()                       = 0;
+    virtual bool stream_start(double const frame_rate,
+                              void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                              void *const)             = 0;
+    virtual void stream_stop(void)                    = 0;
+    virtual ARV_STREAM_STATISTICS get_stream_statistics(void) = 0;
 };
 
 class ArvFactory
@@ -41,7 +41,9 @@
 #define TIMER_US_TO_MS (1000)
 #define TIMER_US_TO_S  (1000000)
 #define TIMER_TICK_MS  (100)
-#define CAPS           (CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME)
+#define CAPS           (CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME | CCD_HAS_STREAMING)
+
+#define STREAM_STATS_TICKS (10) /* Refresh the stream statistics every second while streaming */
 
 #define FOR_EVERY_CAMERA                       \
     {                                          \
@@ -159,7 +161,8 @@ const char *GigECCD::getDefaultName()
 
 GigECCD::GigECCD(arv::ArvCamera *camera)
 {
-    this->camera = camera;
+    this->camera             = camera;
+    this->stream_stats_ticks = 0;
     snprintf(this->name, sizeof(this->name), "%s", this->camera->model_name());
     setDeviceName(this->name);
 }
@@ -220,14 +223,40 @@ void GigECCD::_update_indi_properties(void)
     IUFillTextVector(&indiprop_info_prop, indiprop_info, 3, getDeviceName(), "Camera Info", "", MAIN_CONTROL_TAB, IP_RO,
                      0, IPS_IDLE);
 
+    IUFillNumber(&this->indiprop_stream_buffers[0], "Count", "", "%.f", 2., 64., 1., STREAM_DEFAULT_BUFFERS);
+    IUFillNumberVector(&this->indiprop_stream_buffers_prop, this->indiprop_stream_buffers, 1, getDeviceName(),
+                       "Stream Buffers", "", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&this->indiprop_packet_resend[0], "On", "", ISS_ON);
+    IUFillSwitch(&this->indiprop_packet_resend[1], "Off", "", ISS_OFF);
+    IUFillSwitchVector(&this->indiprop_packet_resend_prop, this->indiprop_packet_resend, 2, getDeviceName(),
+                       "Packet Resend", "", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&this->indiprop_stream_stats[0], "Completed", "", "%.f", 0., 0., 0., 0.);
+    IUFillNumber(&this->indiprop_stream_stats[1], "Failures", "", "%.f", 0., 0., 0., 0.);
+    IUFillNumber(&this->indiprop_stream_stats[2], "Underruns", "", "%.f", 0., 0., 0., 0.);
+    IUFillNumber(&this->indiprop_stream_stats[3], "Resent Packets", "", "%.f", 0., 0., 0., 0.);
+    IUFillNumber(&this->indiprop_stream_stats[4], "Missing Packets", "", "%.f", 0., 0., 0., 0.);
+    IUFillNumberVector(&this->indiprop_stream_stats_prop, this->indiprop_stream_stats, 5, getDeviceName(),
+                       "Stream Statistics", "", OPTIONS_TAB, IP_RO, 0, IPS_IDLE);
+
+    this->camera->set_stream_buffers(STREAM_DEFAULT_BUFFERS);
+    this->camera->set_packet_resend(true);
+
     defineText(&indiprop_info_prop);
     defineNumber(&this->indiprop_gain_prop);
+    defineNumber(&this->indiprop_stream_buffers_prop);
+    defineSwitch(&this->indiprop_packet_resend_prop);
+    defineNumber(&this->indiprop_stream_stats_prop);
 }
 
 void GigECCD::_delete_indi_properties(void)
 {
     this->deleteProperty(this->indiprop_gain_prop.name);
     this->deleteProperty(this->indiprop_info_prop.name);
+    this->deleteProperty(this->indiprop_stream_buffers_prop.name);
+    this->deleteProperty(this->indiprop_packet_resend_prop.name);
+    this->deleteProperty(this->indiprop_stream_stats_prop.name);
 }
 
 //Initial call
@@ -263,6 +292,7 @@ bool GigECCD::Connect()
 bool GigECCD::Disconnect()
 {
     LOGF_INFO("%s", __PRETTY_FUNCTION__);
+    camera->stream_stop();
 #if 0
     //TODO: re-iterate and acquire proper camera from AvrFactory (based on ID?)
     return camera->disconnect();
@@ -277,6 +307,12 @@ bool GigECCD::StartExposure(float duration)
     if (PrimaryCCD.getFrameType() == INDI::CCDChip::BIAS_FRAME)
         duration = 0;
 
+    if (camera->is_streaming())
+    {
+        LOG_ERROR("Cannot take exposure while streaming/recording is active.");
+        return false;
+    }
+
     camera->set_exposure_time((double)(duration)*1000000.0);
 
     TIME_VAL_INIT(&this->exposure_transfer_time);
@@ -319,6 +355,67 @@ void GigECCD::_receive_image_hook(void *const class_ptr, uint8_t const *const da
     cls->_update_image(data, size);
 }
 
+bool GigECCD::StartStreaming()
+{
+    LOGF_INFO("%s fps=%.2f", __PRETTY_FUNCTION__, Streamer->getTargetFPS());
+
+    /* Expose for the whole frame period, the camera clamps both to what it supports */
+    camera->set_exposure_time(1000000.0 / Streamer->getTargetFPS());
+
+    Streamer->setPixelFormat(INDI_MONO, 16);
+    Streamer->setSize(this->camera->get_width().val(), this->camera->get_height().val());
+
+    if (!camera->stream_start(Streamer->getTargetFPS(), this->_receive_stream_hook, this))
+    {
+        LOG_ERROR("Failed to start the acquisition stream");
+        return false;
+    }
+
+    this->stream_stats_ticks = 0;
+    return true;
+}
+
+bool GigECCD::StopStreaming()
+{
+    LOGF_INFO("%s", __PRETTY_FUNCTION__);
+    camera->stream_stop();
+    this->_update_stream_statistics();
+    return true;
+}
+
+void GigECCD::_update_stream(uint8_t const *const data, size_t size)
+{
+    /* Called from the acquisition thread */
+    if (size != (size_t)PrimaryCCD.getFrameBufferSize())
+    {
+        LOGF_DEBUG("Dropping %zu bytes stream frame, expected %i", size, PrimaryCCD.getFrameBufferSize());
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+    Streamer->newFrame(data, size);
+}
+
+void GigECCD::_receive_stream_hook(void *const class_ptr, uint8_t const *const data, size_t size)
+{
+    GigECCD *const cls = static_cast<GigECCD *const>(class_ptr);
+    cls->_update_stream(data, size);
+}
+
+void GigECCD::_update_stream_statistics(void)
+{
+    arv::ARV_STREAM_STATISTICS const stats = this->camera->get_stream_statistics();
+
+    this->indiprop_stream_stats[0].value = stats.completed;
+    this->indiprop_stream_stats[1].value = stats.failures;
+    this->indiprop_stream_stats[2].value = stats.underruns;
+    this->indiprop_stream_stats[3].value = stats.resent_packets;
+    this->indiprop_stream_stats[4].value = stats.missing_packets;
+    this->indiprop_stream_stats_prop.s =
+        (stats.failures || stats.underruns || stats.missing_packets) ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&this->indiprop_stream_stats_prop, nullptr);
+}
+
 void GigECCD::_handle_failed(void)
 {
     LOG_ERROR("Failure occurred, filling image with black");
@@ -358,6 +455,12 @@ void GigECCD::_handle_timeout(struct timeval *const tv, uint32_t timeout_us)
 void GigECCD::TimerHit()
 {
     this->timer_id = this->SetTimer(TIMER_TICK_MS);
+    if (this->camera->is_streaming() && ++this->stream_stats_ticks >= STREAM_STATS_TICKS)
+    {
+        this->stream_stats_ticks = 0;
+        this->_update_stream_statistics();
+    }
+
     if (!this->camera->is_connected() || !this->camera->is_exposing())
         return;
 
@@ -397,14 +500,56 @@ bool GigECCD::ISNewNumber(const char *dev, const char *name, double values[], ch
             IDSetNumber(&this->indiprop_gain_prop, nullptr);
             return true;
         }
+
+        if (!strcmp(name, this->indiprop_stream_buffers_prop.name))
+        {
+            IUUpdateNumber(&this->indiprop_stream_buffers_prop, values, names, n);
+            this->camera->set_stream_buffers((int)this->indiprop_stream_buffers[0].value);
+            this->indiprop_stream_buffers_prop.s = IPS_OK;
+            if (this->camera->is_streaming())
+                LOG_INFO("The new buffer count applies from the next stream");
+            IDSetNumber(&this->indiprop_stream_buffers_prop, nullptr);
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewNumber(dev, name, values, names, n);
 }
 
+bool GigECCD::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (!strcmp(dev, this->getDeviceName()))
+    {
+        if (!strcmp(name, this->indiprop_packet_resend_prop.name))
+        {
+            IUUpdateSwitch(&this->indiprop_packet_resend_prop, states, names, n);
+            this->camera->set_packet_resend(this->indiprop_packet_resend[0].s == ISS_ON);
+            this->indiprop_packet_resend_prop.s = IPS_OK;
+            IDSetSwitch(&this->indiprop_packet_resend_prop, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
+}
+
+bool GigECCD::saveConfigItems(FILE *fp)
+{
+    INDI::CCD::saveConfigItems(fp);
+
+    IUSaveConfigNumber(fp, &this->indiprop_stream_buffers_prop);
+    IUSaveConfigSwitch(fp, &this->indiprop_packet_resend_prop);
+    return true;
+}
+
 bool GigECCD::UpdateCCDFrame(int x, int y, int w, int h)
 {
     LOGF_INFO("%s x=%i y=%i w=%i h=%i", __PRETTY_FUNCTION__, x, y, w, h);
+    if (this->camera->is_streaming())
+    {
+        LOG_ERROR("Cannot change the frame while streaming");
+        return false;
+    }
 
     this->camera->set_geometry(x, y, w, h);
     return this->_update_geometry();
@@ -413,6 +558,11 @@ bool GigECCD::UpdateCCDFrame(int x, int y, int w, int h)
 bool GigECCD::UpdateCCDBin(int binx, int biny)
 {
     LOGF_INFO("%s binx=%i biny=%i", __PRETTY_FUNCTION__, binx, biny);
+    if (this->camera->is_streaming())
+    {
+        LOG_ERROR("Cannot change binning while streaming");
+        return false;
+    }
     camera->set_bin(binx, biny);
     return UpdateCCDFrame(PrimaryCCD.getSubX(), PrimaryCCD.getSubY(), PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
 }
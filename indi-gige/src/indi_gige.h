@@ -44,8 +44,12 @@ class GigECCD : public INDI::CCD
     bool StartExposure(float duration);
     bool AbortExposure();
 
+    bool StartStreaming();
+    bool StopStreaming();
+
   protected:
     void TimerHit();
+    bool saveConfigItems(FILE *fp);
     virtual bool UpdateCCDFrame(int x, int y, int w, int h);
     virtual bool UpdateCCDBin(int binx, int biny);
     virtual bool UpdateCCDFrameType(INDI::CCDChip::CCD_FRAME fType);
@@ -56,6 +60,9 @@ class GigECCD : public INDI::CCD
     bool _update_geometry(void);
     void _update_image(uint8_t const *const data, size_t size);
     static void _receive_image_hook(void *const class_ptr, uint8_t const *const data, size_t size);
+    void _update_stream(uint8_t const *const data, size_t size);
+    static void _receive_stream_hook(void *const class_ptr, uint8_t const *const data, size_t size);
+    void _update_stream_statistics(void);
 
     void _handle_failed(void);
     void _handle_timeout(struct timeval *const tv, uint32_t timeout_us);
@@ -65,6 +72,7 @@ class GigECCD : public INDI::CCD
     int timer_id;
     struct timeval exposure_start_time;
     struct timeval exposure_transfer_time;
+    int stream_stats_ticks;
 
     /* Indi properties */
 
@@ -72,8 +80,15 @@ class GigECCD : public INDI::CCD
     INumberVectorProperty indiprop_gain_prop;
     IText indiprop_info[3] {};
     ITextVectorProperty indiprop_info_prop;
+    INumber indiprop_stream_buffers[1];
+    INumberVectorProperty indiprop_stream_buffers_prop;
+    ISwitch indiprop_packet_resend[2];
+    ISwitchVectorProperty indiprop_packet_resend_prop;
+    INumber indiprop_stream_stats[5];
+    INumberVectorProperty indiprop_stream_stats_prop;
 
     virtual bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n);
+    virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n);
 
     friend void ::ISGetProperties(const char *dev);
     friend void ::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int num);
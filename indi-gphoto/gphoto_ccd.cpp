@@ -27,6 +27,7 @@
 #include "gphoto_readimage.h"
 
 #include <algorithm>
+#include <chrono>
 #include <stream/streammanager.h>
 
 #include <math.h>
@@ -323,6 +324,7 @@ GPhotoCCD::GPhotoCCD(const char * model, const char * port) : FI(this)
 //==========================================================================
 GPhotoCCD::~GPhotoCCD()
 {
+    stopPipeline();
     free(on_off[0]);
     free(on_off[1]);
     expTID = 0;
@@ -418,6 +420,23 @@ bool GPhotoCCD::initProperties()
     IUFillSwitchVector(&forceBULBSP, forceBULBS, 2, getDeviceName(), "CCD_FORCE_BLOB", "Force BULB",
                        OPTIONS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    IUFillSwitch(&PipelineS[PIPELINE_ON], "PIPELINE_ON", "On", ISS_OFF);
+    IUFillSwitch(&PipelineS[PIPELINE_OFF], "PIPELINE_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&PipelineSP, PipelineS, 2, getDeviceName(), "CCD_PIPELINE", "Pipeline", OPTIONS_TAB, IP_RW,
+                       ISR_1OFMANY, 0, IPS_IDLE);
+
+    IUFillNumber(&PipelineN[PIPELINE_COUNT], "PIPELINE_COUNT", "Sequence", "%.f", 1, 10000, 1, 1);
+    IUFillNumber(&PipelineN[PIPELINE_FRAMES], "PIPELINE_FRAMES", "Remaining", "%.f", 0, 10000, 1, 0);
+    IUFillNumber(&PipelineN[PIPELINE_QUEUED], "PIPELINE_QUEUED", "Queued", "%.f", 0, PIPELINE_DEPTH, 1, 0);
+    IUFillNumberVector(&PipelineNP, PipelineN, NARRAY(PipelineN), getDeviceName(), "CCD_PIPELINE_SEQUENCE",
+                       "Sequence", MAIN_CONTROL_TAB, IP_RW, 0, IPS_IDLE);
+
+    IUFillNumber(&DownloadTimingN[TIMING_DOWNLOAD], "DOWNLOAD", "Download (ms)", "%.f", 0, 1e6, 0, 0);
+    IUFillNumber(&DownloadTimingN[TIMING_DECODE], "DECODE", "Decode (ms)", "%.f", 0, 1e6, 0, 0);
+    IUFillNumber(&DownloadTimingN[TIMING_FITS], "FITS", "FITS (ms)", "%.f", 0, 1e6, 0, 0);
+    IUFillNumberVector(&DownloadTimingNP, DownloadTimingN, NARRAY(DownloadTimingN), getDeviceName(), "CCD_DOWNLOAD_TIMING",
+                       "Timing", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
     // Upload File
     IUFillText(&UploadFileT[0], "PATH", "Path", nullptr);
     IUFillTextVector(&UploadFileTP, UploadFileT, 1, getDeviceName(), "CCD_UPLOAD_FILE", "Upload File", OPTIONS_TAB, IP_RW, 0,
@@ -548,6 +567,11 @@ bool GPhotoCCD::updateProperties()
         }
 
         defineSwitch(&forceBULBSP);
+        defineNumber(&DownloadTimingNP);
+
+        defineSwitch(&PipelineSP);
+        if (PipelineS[PIPELINE_ON].s == ISS_ON)
+            defineNumber(&PipelineNP);
 
         //timerID = SetTimer(POLLMS);
     }
@@ -579,6 +603,9 @@ bool GPhotoCCD::updateProperties()
         deleteProperty(SDCardImageSP.name);
 
         deleteProperty(forceBULBSP.name);
+        deleteProperty(DownloadTimingNP.name);
+        deleteProperty(PipelineSP.name);
+        deleteProperty(PipelineNP.name);
 
         HideExtendedOptions();
     }
@@ -699,6 +726,34 @@ bool GPhotoCCD::ISNewSwitch(const char * dev, const char * name, ISState * state
             return true;
         }
 
+        ///////////////////////////////////////////////////////////////////////////////////////////////
+        // Pipeline
+        // Capture the configured number of frames back to back. The next exposure starts as soon as
+        // the previous image is downloaded, while a worker thread decodes it and sends it in order.
+        ///////////////////////////////////////////////////////////////////////////////////////////////
+        if (!strcmp(name, PipelineSP.name))
+        {
+            if (IUUpdateSwitch(&PipelineSP, states, names, n) < 0)
+                return false;
+
+            if (PipelineS[PIPELINE_ON].s == ISS_ON)
+            {
+                defineNumber(&PipelineNP);
+                LOGF_INFO("Pipeline is enabled. Each exposure request captures a sequence of %.f frames.",
+                          PipelineN[PIPELINE_COUNT].value);
+            }
+            else
+            {
+                abortPipeline();
+                deleteProperty(PipelineNP.name);
+                LOG_INFO("Pipeline is disabled.");
+            }
+
+            PipelineSP.s = IPS_OK;
+            IDSetSwitch(&PipelineSP, nullptr);
+            return true;
+        }
+
         if (!strcmp(name, mExposurePresetSP.name))
         {
             if (IUUpdateSwitch(&mExposurePresetSP, states, names, n) < 0)
@@ -941,6 +996,18 @@ bool GPhotoCCD::ISNewNumber(const char * dev, const char * name, double values[]
             return true;
         }
 
+        // Only the sequence length can be set, remaining and queued frames are reported by the driver.
+        if (!strcmp(name, PipelineNP.name))
+        {
+            for (int i = 0; i < n; i++)
+            {
+                if (!strcmp(names[i], PipelineN[PIPELINE_COUNT].name))
+                    PipelineN[PIPELINE_COUNT].value = std::max(1.0, round(values[i]));
+            }
+            IDSetNumber(&PipelineNP, nullptr);
+            return true;
+        }
+
         if (CamOptions.find(name) != CamOptions.end())
         {
             cam_opt * opt = CamOptions[name];
@@ -1146,6 +1213,8 @@ bool GPhotoCCD::Connect()
 
 bool GPhotoCCD::Disconnect()
 {
+    stopPipeline();
+
     if (isSimulation())
         return true;
     gphoto_close(gphotodrv);
@@ -1205,6 +1274,14 @@ bool GPhotoCCD::StartExposure(float duration)
     gettimeofday(&ExpStart, nullptr);
     InExposure = true;
 
+    // A client request starts a new pipelined sequence
+    if (m_PipelineRestart == false && PipelineS[PIPELINE_ON].s == ISS_ON)
+    {
+        PipelineN[PIPELINE_FRAMES].value = PipelineN[PIPELINE_COUNT].value;
+        PipelineNP.s = IPS_BUSY;
+        IDSetNumber(&PipelineNP, nullptr);
+    }
+
     SetTimer(POLLMS);
 
     return true;
@@ -1212,6 +1289,8 @@ bool GPhotoCCD::StartExposure(float duration)
 
 bool GPhotoCCD::AbortExposure()
 {
+    abortPipeline();
+
     if (!isSimulation())
         gphoto_abort_exposure(gphotodrv);
     InExposure = false;
@@ -1394,171 +1473,25 @@ bool GPhotoCCD::grabImage()
 
     if (TransferFormatS[FORMAT_FITS].s == ISS_ON)
     {
-        char filename[MAXRBUF] = "/tmp/indi_XXXXXX";
-        const char *extension = "unknown";
-        if (isSimulation())
-        {
-            if (!UploadFileT[0].text[0])
-            {
-                LOG_WARN("You must specify simulation file path under Options.");
-                return false;
-            }
-
-            strncpy(filename, UploadFileT[0].text, MAXRBUF);
-            extension = strchr(filename, '.') + 1;
-        }
-        else
-        {
-            int fd = mkstemp(filename);
-            int ret = gphoto_read_exposure_fd(gphotodrv, fd);
-            if (ret != GP_OK || fd == -1)
-            {
-                if (fd == -1)
-                    LOGF_ERROR("Exposure failed to save image. Cannot create temp file %s", tmpfile);
-                else
-                {
-                    LOGF_ERROR("Exposure failed to save image... %s", gp_result_as_string(ret));
-                    // As suggested on INDI forums, this result could be misleading.
-                    if (ret == GP_ERROR_DIRECTORY_NOT_FOUND)
-                        LOG_INFO("Make sure BULB switch is ON in the camera. Try setting AF switch to OFF.");
-                }
-                unlink(filename);
-                return false;
-            }
-
-            extension = gphoto_get_file_extension(gphotodrv);
-        }
-
-        if (!strcmp(extension, "unknown"))
-        {
-            LOG_ERROR("Exposure failed.");
+        std::unique_ptr<DSLRImage> image(new DSLRImage());
+        if (downloadImage(*image) == false)
             return false;
-        }
 
         // We're done exposing
         if (ExposureRequest > 3)
             LOG_INFO("Exposure done, downloading image...");
 
-        if (strcasecmp(extension, "jpg") == 0 || strcasecmp(extension, "jpeg") == 0)
-        {
-            if (read_jpeg(filename, &memptr, &memsize, &naxis, &w, &h))
-            {
-                LOG_ERROR("Exposure failed to parse jpeg.");
-                if (!isSimulation())
-                    unlink(filename);
-                return false;
-            }
-
-            LOGF_DEBUG("read_jpeg: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis, w, h, bpp);
-
-            SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
-        }
-        else
-        {
-            char bayer_pattern[8] = {};
-
-            if (read_libraw(filename, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
-            {
-                LOG_ERROR("Exposure failed to parse raw image.");
-                if (!isSimulation())
-                    unlink(filename);
-                return false;
-            }
-
-            LOGF_DEBUG("read_libraw: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d) bayer pattern (%s)",
-                       memsize, naxis, w, h, bpp, bayer_pattern);
+        // In pipelined mode the camera is free again, decoding continues on the pipeline thread.
+        if (PipelineS[PIPELINE_ON].s == ISS_ON)
+            return queueImage(std::move(image));
 
-            if (!isSimulation())
-                unlink(filename);
-
-            IUSaveText(&BayerT[2], bayer_pattern);
-            IDSetText(&BayerTP, nullptr);
-            SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
-        }
+        bool rc = processImage(*image);
 
-        PrimaryCCD.setImageExtension("fits");
-
-        uint16_t subW = PrimaryCCD.getSubW();
-        uint16_t subH = PrimaryCCD.getSubH();
-
-        // If subframing is requested
-        // If either axis is less than the image resolution
-        // then we subframe, given the OTHER axis is within range as well.
-        if ( (subW > 0 && subH > 0) && ((subW < w && subH <= h) || (subH < h && subW <= w)))
-        {
-            uint16_t subX = PrimaryCCD.getSubX();
-            uint16_t subY = PrimaryCCD.getSubY();
-
-            // Align all boundaries to be even
-            // This should fix issues with subframed bayered images.
-            //            subX -= subX % 2;
-            //            subY -= subY % 2;
-            //            subW -= subW % 2;
-            //            subH -= subH % 2;
-
-            int subFrameSize     = subW * subH * bpp / 8 * ((naxis == 3) ? 3 : 1);
-            int oneFrameSize     = subW * subH * bpp / 8;
-
-            int lineW  = subW * bpp / 8;
-
-            LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - subX: %d - subY: %d - subW: %d - subH: %d",
-                       subFrameSize, oneFrameSize,
-                       subX, subY, subW, subH);
-
-            if (naxis == 2)
-            {
-                // JM 2020-08-29: Using memmove since regions are overlaping
-                // as proposed by Camiel Severijns on INDI forums.
-                for (int i = subY; i < subY + subH; i++)
-                    memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
-            }
-            else
-            {
-                uint8_t * subR = memptr;
-                uint8_t * subG = memptr + oneFrameSize;
-                uint8_t * subB = memptr + oneFrameSize * 2;
-
-                uint8_t * startR = memptr;
-                uint8_t * startG = memptr + (w * h * bpp / 8);
-                uint8_t * startB = memptr + (w * h * bpp / 8 * 2);
-
-                for (int i = subY; i < subY + subH; i++)
-                {
-                    memcpy(subR + (i - subY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
-                    memcpy(subG + (i - subY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
-                    memcpy(subB + (i - subY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
-                }
-            }
-
-            PrimaryCCD.setFrameBuffer(memptr);
-            PrimaryCCD.setFrameBufferSize(memsize, false);
-            PrimaryCCD.setResolution(w, h);
-            PrimaryCCD.setFrame(subX, subY, subW, subH);
-            PrimaryCCD.setNAxis(naxis);
-            PrimaryCCD.setBPP(bpp);
-
-            ExposureComplete(&PrimaryCCD);
-
-            // Restore old pointer and release memory
-            //PrimaryCCD.setFrameBuffer(memptr);
-            //PrimaryCCD.setFrameBufferSize(memsize, false);
-            //delete [] (subframeBuf);
-        }
-        else
-        {
-            if (PrimaryCCD.getSubW() != 0 && (w > PrimaryCCD.getSubW() || h > PrimaryCCD.getSubH()))
-                LOGF_WARN("Camera image size (%dx%d) is less than requested size (%d,%d). Purge configuration and update frame size to match camera size.",
-                          w, h, PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
-
-            PrimaryCCD.setFrame(0, 0, w, h);
-            PrimaryCCD.setFrameBuffer(memptr);
-            PrimaryCCD.setFrameBufferSize(memsize, false);
-            PrimaryCCD.setResolution(w, h);
-            PrimaryCCD.setNAxis(naxis);
-            PrimaryCCD.setBPP(bpp);
+        // Release the camera file now, it can be as large as the decoded image.
+        if (isSimulation() == false)
+            gphoto_free_buffer(gphotodrv);
 
-            ExposureComplete(&PrimaryCCD);
-        }
+        return rc;
     }
     // Read Native image AS IS
     else
@@ -1625,6 +1558,9 @@ bool GPhotoCCD::grabImage()
                 LOG_DEBUG("Exposure done, downloading image...");
             uint8_t * newMemptr = nullptr;
             gphoto_get_buffer(gphotodrv, const_cast<const char **>(reinterpret_cast<char **>(&newMemptr)), &memsize);
+            // The pipeline thread may still be publishing a decoded frame
+            std::unique_lock<std::mutex> guard(ccdBufferLock);
+            memptr = PrimaryCCD.getFrameBuffer();
             // We copy the obtained memory pointer to avoid freeing some gphoto memory
             memptr = static_cast<uint8_t *>(realloc(memptr, memsize));
             memcpy(memptr, newMemptr, memsize);
@@ -1640,6 +1576,7 @@ bool GPhotoCCD::grabImage()
                 PrimaryCCD.setResolution(w, h);
             PrimaryCCD.setNAxis(naxis);
             PrimaryCCD.setBPP(bpp);
+            guard.unlock();
 
         }
 
@@ -1650,6 +1587,472 @@ bool GPhotoCCD::grabImage()
     return true;
 }
 
+bool GPhotoCCD::downloadImage(DSLRImage &image)
+{
+    image.generation = m_PipelineGeneration;
+
+    if (isSimulation())
+    {
+        image.downloadTime = 0;
+
+        if (UploadFileT[0].text[0])
+        {
+            const char *extension = strchr(UploadFileT[0].text, '.');
+            image.filename  = UploadFileT[0].text;
+            image.extension = extension ? extension + 1 : "unknown";
+        }
+        // Without an upload file, generate a synthetic raw frame so the capture path can be exercised.
+        else
+        {
+            image.width     = PrimaryCCD.getXRes() > 0 ? PrimaryCCD.getXRes() : SIMULATION_WIDTH;
+            image.height    = PrimaryCCD.getYRes() > 0 ? PrimaryCCD.getYRes() : SIMULATION_HEIGHT;
+            image.extension = "sim";
+            image.data.resize(image.width * image.height * sizeof(uint16_t));
+
+            uint16_t *pixels = reinterpret_cast<uint16_t *>(image.data.data());
+            uint16_t level   = static_cast<uint16_t>(1000 + (m_SimulationFrame++ % 16) * 100);
+            for (int y = 0; y < image.height; y++)
+                for (int x = 0; x < image.width; x++)
+                    *pixels++ = level + static_cast<uint16_t>((x + y) % 256) + static_cast<uint16_t>(rand() % 32);
+
+            image.buffer = reinterpret_cast<const char *>(image.data.data());
+            image.size   = image.data.size();
+        }
+    }
+    else
+    {
+        // Download the image into memory, it is decoded from there without a round-trip to disk.
+        int ret = gphoto_read_exposure(gphotodrv);
+        if (ret != GP_OK)
+        {
+            LOGF_ERROR("Exposure failed to save image... %s", gp_result_as_string(ret));
+            // As suggested on INDI forums, this result could be misleading.
+            if (ret == GP_ERROR_DIRECTORY_NOT_FOUND)
+                LOG_INFO("Make sure BULB switch is ON in the camera. Try setting AF switch to OFF.");
+            return false;
+        }
+
+        image.extension = gphoto_get_file_extension(gphotodrv);
+        image.downloadTime = gphoto_get_last_download_time(gphotodrv) * 1000.0;
+        gphoto_get_buffer(gphotodrv, &image.buffer, &image.size);
+        if (image.buffer == nullptr || image.size == 0)
+        {
+            LOG_ERROR("Exposure failed to download image.");
+            gphoto_free_buffer(gphotodrv);
+            return false;
+        }
+
+        // The driver replaces its camera file on the next exposure, so pipelined images take it over.
+        if (PipelineS[PIPELINE_ON].s == ISS_ON)
+            image.file.reset(gphoto_take_file(gphotodrv));
+    }
+
+    if (image.extension == "unknown")
+    {
+        LOG_ERROR("Exposure failed.");
+        if (isSimulation() == false)
+            gphoto_free_buffer(gphotodrv);
+        return false;
+    }
+
+    return true;
+}
+
+bool GPhotoCCD::processImage(const DSLRImage &image)
+{
+    // The decoders reallocate the frame buffer, which may run on the pipeline thread.
+    // Hold the buffer until the new one is published.
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+    uint8_t * memptr = PrimaryCCD.getFrameBuffer();
+    size_t memsize = 0;
+    int naxis = 2, w = 0, h = 0, bpp = 8;
+    char filename[MAXRBUF] = "/tmp/indi_XXXXXX";
+    bool isTempFile = false;
+    const char *extension = image.extension.c_str();
+
+    if (image.filename.empty() == false)
+        strncpy(filename, image.filename.c_str(), MAXRBUF - 1);
+
+    // Fallback for images the in-memory decoders cannot handle: write them to disk and decode the file.
+    auto saveTempFile = [&]()
+    {
+        int fd = mkstemp(filename);
+        if (fd == -1)
+        {
+            LOGF_ERROR("Exposure failed to save image. Cannot create temp file %s", filename);
+            return false;
+        }
+
+        isTempFile = true;
+        size_t written = 0;
+        while (written < image.size)
+        {
+            ssize_t rc = write(fd, image.buffer + written, image.size - written);
+            if (rc <= 0)
+            {
+                LOGF_ERROR("Exposure failed to save image to %s: %s", filename, strerror(errno));
+                close(fd);
+                return false;
+            }
+            written += rc;
+        }
+        close(fd);
+        return true;
+    };
+
+    auto decodeStart = std::chrono::steady_clock::now();
+
+    if (strcasecmp(extension, "jpg") == 0 || strcasecmp(extension, "jpeg") == 0)
+    {
+        int rc = -1;
+        if (image.buffer)
+        {
+            rc = read_jpeg_mem_planar(reinterpret_cast<unsigned char *>(const_cast<char *>(image.buffer)), image.size,
+                                      &memptr, &memsize, &naxis, &w, &h);
+            if (rc != 0 && saveTempFile())
+            {
+                LOG_DEBUG("In-memory jpeg decoding failed, retrying from file.");
+                rc = read_jpeg(filename, &memptr, &memsize, &naxis, &w, &h);
+            }
+        }
+        else
+            rc = read_jpeg(filename, &memptr, &memsize, &naxis, &w, &h);
+
+        if (rc)
+        {
+            LOG_ERROR("Exposure failed to parse jpeg.");
+            if (isTempFile)
+                unlink(filename);
+            return false;
+        }
+
+        LOGF_DEBUG("read_jpeg: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis, w, h, bpp);
+
+        SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
+    }
+    else if (strcmp(extension, "sim") == 0)
+    {
+        // Synthetic 16bit RGGB frame generated by the simulator
+        w = image.width;
+        h = image.height;
+        bpp = 16;
+        memsize = image.size;
+        memptr = static_cast<uint8_t *>(realloc(memptr, memsize));
+        memcpy(memptr, image.buffer, memsize);
+
+        IUSaveText(&BayerT[2], "RGGB");
+        IDSetText(&BayerTP, nullptr);
+        SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
+    }
+    else
+    {
+        char bayer_pattern[8] = {};
+
+        int rc = -1;
+        if (image.buffer)
+        {
+            rc = read_libraw_mem(image.buffer, image.size, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern);
+            if (rc != 0 && saveTempFile())
+            {
+                LOG_DEBUG("In-memory raw decoding failed, retrying from file.");
+                rc = read_libraw(filename, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern);
+            }
+        }
+        else
+            rc = read_libraw(filename, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern);
+
+        if (rc)
+        {
+            LOG_ERROR("Exposure failed to parse raw image.");
+            if (isTempFile)
+                unlink(filename);
+            return false;
+        }
+
+        LOGF_DEBUG("read_libraw: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d) bayer pattern (%s)",
+                   memsize, naxis, w, h, bpp, bayer_pattern);
+
+        IUSaveText(&BayerT[2], bayer_pattern);
+        IDSetText(&BayerTP, nullptr);
+        SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
+    }
+
+    if (isTempFile)
+        unlink(filename);
+
+    // The decoders may have reallocated the frame buffer
+    PrimaryCCD.setFrameBuffer(memptr);
+    PrimaryCCD.setFrameBufferSize(memsize, false);
+
+    // An aborted pipeline drops the frames it was still decoding
+    if (image.generation != m_PipelineGeneration)
+        return true;
+
+    PrimaryCCD.setImageExtension("fits");
+
+    uint16_t subW = PrimaryCCD.getSubW();
+    uint16_t subH = PrimaryCCD.getSubH();
+
+    // If subframing is requested
+    // If either axis is less than the image resolution
+    // then we subframe, given the OTHER axis is within range as well.
+    if ( (subW > 0 && subH > 0) && ((subW < w && subH <= h) || (subH < h && subW <= w)))
+    {
+        uint16_t subX = PrimaryCCD.getSubX();
+        uint16_t subY = PrimaryCCD.getSubY();
+
+        // Align all boundaries to be even
+        // This should fix issues with subframed bayered images.
+        //            subX -= subX % 2;
+        //            subY -= subY % 2;
+        //            subW -= subW % 2;
+        //            subH -= subH % 2;
+
+        int subFrameSize     = subW * subH * bpp / 8 * ((naxis == 3) ? 3 : 1);
+        int oneFrameSize     = subW * subH * bpp / 8;
+
+        int lineW  = subW * bpp / 8;
+
+        LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - subX: %d - subY: %d - subW: %d - subH: %d",
+                   subFrameSize, oneFrameSize,
+                   subX, subY, subW, subH);
+
+        if (naxis == 2)
+        {
+            // JM 2020-08-29: Using memmove since regions are overlaping
+            // as proposed by Camiel Severijns on INDI forums.
+            for (int i = subY; i < subY + subH; i++)
+                memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
+        }
+        else
+        {
+            uint8_t * subR = memptr;
+            uint8_t * subG = memptr + oneFrameSize;
+            uint8_t * subB = memptr + oneFrameSize * 2;
+
+            uint8_t * startR = memptr;
+            uint8_t * startG = memptr + (w * h * bpp / 8);
+            uint8_t * startB = memptr + (w * h * bpp / 8 * 2);
+
+            for (int i = subY; i < subY + subH; i++)
+            {
+                memcpy(subR + (i - subY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
+                memcpy(subG + (i - subY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
+                memcpy(subB + (i - subY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
+            }
+        }
+
+        PrimaryCCD.setFrameBuffer(memptr);
+        PrimaryCCD.setFrameBufferSize(memsize, false);
+        PrimaryCCD.setResolution(w, h);
+        PrimaryCCD.setFrame(subX, subY, subW, subH);
+        PrimaryCCD.setNAxis(naxis);
+        PrimaryCCD.setBPP(bpp);
+        guard.unlock();
+
+        completeTimedExposure(image, decodeStart);
+
+        // Restore old pointer and release memory
+        //PrimaryCCD.setFrameBuffer(memptr);
+        //PrimaryCCD.setFrameBufferSize(memsize, false);
+        //delete [] (subframeBuf);
+    }
+    else
+    {
+        if (PrimaryCCD.getSubW() != 0 && (w > PrimaryCCD.getSubW() || h > PrimaryCCD.getSubH()))
+            LOGF_WARN("Camera image size (%dx%d) is less than requested size (%d,%d). Purge configuration and update frame size to match camera size.",
+                      w, h, PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+
+        PrimaryCCD.setFrame(0, 0, w, h);
+        PrimaryCCD.setFrameBuffer(memptr);
+        PrimaryCCD.setFrameBufferSize(memsize, false);
+        PrimaryCCD.setResolution(w, h);
+        PrimaryCCD.setNAxis(naxis);
+        PrimaryCCD.setBPP(bpp);
+        guard.unlock();
+
+        completeTimedExposure(image, decodeStart);
+    }
+
+    return true;
+}
+
+/*
+ * Pipelined capture: the image is handed to the pipeline thread and, if more frames of the
+ * sequence are pending, the next exposure starts right away while this one is decoded.
+ * At most PIPELINE_DEPTH downloaded images are queued. When the queue is full, the next
+ * exposure waits on the event loop until the pipeline thread catches up, so the queue
+ * always has room for the image of an exposure in progress.
+ */
+bool GPhotoCCD::queueImage(std::unique_ptr<DSLRImage> image)
+{
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+
+        if (m_PipelineThread.joinable() == false)
+        {
+            m_PipelineTerminate = false;
+            m_PipelineThread = std::thread(&GPhotoCCD::pipelineThreadEntry, this);
+        }
+
+        m_PipelineQueue.push_back(std::move(image));
+        PipelineN[PIPELINE_QUEUED].value = m_PipelineQueue.size();
+        full = m_PipelineQueue.size() >= PIPELINE_DEPTH;
+    }
+    m_PipelineCV.notify_all();
+
+    if (PipelineN[PIPELINE_FRAMES].value > 1)
+    {
+        PipelineN[PIPELINE_FRAMES].value--;
+        IDSetNumber(&PipelineNP, nullptr);
+
+        if (full)
+        {
+            LOG_DEBUG("Pipeline queue is full, next exposure waits for the decoder.");
+            m_PipelineTimerID = IEAddTimer(POLLMS, GPhotoCCD::ResumePipelineHelper, this);
+        }
+        else
+            startPipelineFrame();
+    }
+    else
+    {
+        PipelineN[PIPELINE_FRAMES].value = 0;
+        PipelineNP.s = IPS_OK;
+        IDSetNumber(&PipelineNP, nullptr);
+    }
+
+    return true;
+}
+
+void GPhotoCCD::startPipelineFrame()
+{
+    m_PipelineRestart = true;
+    bool rc = StartExposure(ExposureRequest);
+    m_PipelineRestart = false;
+
+    if (rc == false)
+    {
+        PipelineNP.s = IPS_ALERT;
+        IDSetNumber(&PipelineNP, nullptr);
+    }
+}
+
+void GPhotoCCD::ResumePipelineHelper(void *context)
+{
+    static_cast<GPhotoCCD *>(context)->ResumePipeline();
+}
+
+void GPhotoCCD::ResumePipeline()
+{
+    m_PipelineTimerID = -1;
+
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+        full = m_PipelineQueue.size() >= PIPELINE_DEPTH;
+    }
+
+    if (full)
+        m_PipelineTimerID = IEAddTimer(POLLMS, GPhotoCCD::ResumePipelineHelper, this);
+    else
+        startPipelineFrame();
+}
+
+void GPhotoCCD::pipelineThreadEntry()
+{
+    std::unique_lock<std::mutex> lock(m_PipelineMutex);
+
+    while (true)
+    {
+        m_PipelineCV.wait(lock, [this]()
+        {
+            return m_PipelineTerminate || m_PipelineQueue.empty() == false;
+        });
+
+        if (m_PipelineTerminate)
+            break;
+
+        std::unique_ptr<DSLRImage> image = std::move(m_PipelineQueue.front());
+        m_PipelineQueue.pop_front();
+        m_PipelineBusy = true;
+        PipelineN[PIPELINE_QUEUED].value = m_PipelineQueue.size();
+        lock.unlock();
+        m_PipelineCV.notify_all();
+        IDSetNumber(&PipelineNP, nullptr);
+
+        // Frames queued before an abort are dropped without decoding
+        if (image->generation == m_PipelineGeneration && processImage(*image) == false)
+            PrimaryCCD.setExposureFailed();
+
+        lock.lock();
+        m_PipelineBusy = false;
+        m_PipelineCV.notify_all();
+    }
+}
+
+void GPhotoCCD::abortPipeline()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_PipelineMutex);
+        m_PipelineGeneration++;
+        m_PipelineQueue.clear();
+        m_PipelineCV.notify_all();
+
+        // The frame being decoded is dropped before it is sent, but the decoder still writes the
+        // CCD buffer. Wait for it, so a new exposure or a disconnect cannot free the buffer under it.
+        m_PipelineCV.wait(lock, [this]()
+        {
+            return m_PipelineBusy == false;
+        });
+    }
+
+    if (m_PipelineTimerID != -1)
+    {
+        IERmTimer(m_PipelineTimerID);
+        m_PipelineTimerID = -1;
+    }
+
+    if (PipelineN[PIPELINE_FRAMES].value > 0)
+    {
+        PipelineN[PIPELINE_FRAMES].value = 0;
+        PipelineN[PIPELINE_QUEUED].value = 0;
+        PipelineNP.s = IPS_IDLE;
+        IDSetNumber(&PipelineNP, nullptr);
+    }
+}
+
+void GPhotoCCD::stopPipeline()
+{
+    abortPipeline();
+
+    {
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+        m_PipelineTerminate = true;
+    }
+    m_PipelineCV.notify_all();
+
+    if (m_PipelineThread.joinable())
+        m_PipelineThread.join();
+}
+
+void GPhotoCCD::completeTimedExposure(const DSLRImage &image, std::chrono::steady_clock::time_point decodeStart)
+{
+    auto fitsStart = std::chrono::steady_clock::now();
+    DownloadTimingN[TIMING_DOWNLOAD].value = image.downloadTime;
+    DownloadTimingN[TIMING_DECODE].value = std::chrono::duration<double, std::milli>(fitsStart - decodeStart).count();
+
+    ExposureComplete(&PrimaryCCD);
+
+    DownloadTimingN[TIMING_FITS].value = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                         fitsStart).count();
+    DownloadTimingNP.s = IPS_OK;
+    IDSetNumber(&DownloadTimingNP, nullptr);
+
+    LOGF_DEBUG("Download %.f ms, decode %.f ms, FITS %.f ms", DownloadTimingN[TIMING_DOWNLOAD].value,
+               DownloadTimingN[TIMING_DECODE].value, DownloadTimingN[TIMING_FITS].value);
+}
+
 ISwitch * GPhotoCCD::create_switch(const char * basestr, char ** options, int max_opts, int setidx)
 {
     int i;
@@ -2176,6 +2579,10 @@ bool GPhotoCCD::saveConfigItems(FILE * fp)
     // Mirror Locking
     IUSaveConfigNumber(fp, &mMirrorLockNP);
 
+    // Pipeline
+    IUSaveConfigSwitch(fp, &PipelineSP);
+    IUSaveConfigNumber(fp, &PipelineNP);
+
     // Capture Target
     if (captureTargetSP.s == IPS_OK)
     {
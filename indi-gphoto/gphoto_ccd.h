@@ -27,9 +27,15 @@
 #include <indiccd.h>
 #include <indifocuserinterface.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
 #include <future>
 #include <string>
+#include <vector>
 
 #define MAXEXPERR 10 /* max err in exp time we allow, secs */
 #define OPENDT    5  /* open retry delay, secs */
@@ -42,6 +48,27 @@ enum
     OFF_S
 };
 
+/* A downloaded image waiting to be decoded */
+struct DSLRImage
+{
+    // Camera file taken over from the driver, only used in pipeline mode
+    std::unique_ptr<CameraFile, int (*)(CameraFile *)> file {nullptr, gp_file_free};
+    // Synthetic simulation frame
+    std::vector<uint8_t> data;
+    // Image file content, or nullptr when the image is in filename
+    const char * buffer {nullptr};
+    size_t size {0};
+    std::string extension;
+    std::string filename;
+    // Frame size of synthetic simulation images
+    int width {0};
+    int height {0};
+    // Download time in milliseconds
+    double downloadTime {0};
+    // Pipeline generation at download time, frames of aborted sequences are dropped
+    uint32_t generation {0};
+};
+
 typedef struct
 {
     gphoto_widget * widget;
@@ -61,6 +88,9 @@ typedef struct
 
 class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
 {
+        // Drives the download and decode pipeline without a camera
+        friend class GPhotoPipelineCheck;
+
     public:
         explicit GPhotoCCD();
         explicit GPhotoCCD(const char * model, const char * port);
@@ -89,6 +119,9 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
         static void UpdateExtendedOptions(void * vp);
         void UpdateExtendedOptions(bool force = false);
 
+        static void ResumePipelineHelper(void *context);
+        void ResumePipeline();
+
         static void UpdateFocusMotionHelper(void *context);
         void UpdateFocusMotionCallback();
 
@@ -141,6 +174,19 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
 
         double CalcTimeLeft();
         bool grabImage();
+        /** Download the captured image from the camera */
+        bool downloadImage(DSLRImage &image);
+        /** Decode the image into the CCD buffer and send it */
+        bool processImage(const DSLRImage &image);
+        /** Send the decoded frame and record decode and FITS timing */
+        void completeTimedExposure(const DSLRImage &image, std::chrono::steady_clock::time_point decodeStart);
+
+        // Pipeline
+        bool queueImage(std::unique_ptr<DSLRImage> image);
+        void startPipelineFrame();
+        void pipelineThreadEntry();
+        void abortPipeline();
+        void stopPipeline();
 
         char name[MAXINDIDEVICE];
         char model[MAXINDINAME];
@@ -224,6 +270,33 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
             FORCE_BULB_OFF
         };
 
+        INumber DownloadTimingN[3];
+        INumberVectorProperty DownloadTimingNP;
+        enum
+        {
+            TIMING_DOWNLOAD,
+            TIMING_DECODE,
+            TIMING_FITS
+        };
+
+        // Pipeline: download the next frame of a sequence while the previous one is decoded
+        ISwitch PipelineS[2];
+        ISwitchVectorProperty PipelineSP;
+        enum
+        {
+            PIPELINE_ON,
+            PIPELINE_OFF
+        };
+
+        INumber PipelineN[3];
+        INumberVectorProperty PipelineNP;
+        enum
+        {
+            PIPELINE_COUNT,
+            PIPELINE_FRAMES,
+            PIPELINE_QUEUED
+        };
+
         // Upload file, used for testing purposes under simulation under native mode
         ITextVectorProperty UploadFileTP;
         IText UploadFileT[1] {};
@@ -236,8 +309,28 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
         // Threading
         std::thread liveViewThread;
 
+        std::thread m_PipelineThread;
+        std::mutex m_PipelineMutex;
+        std::condition_variable m_PipelineCV;
+        std::deque<std::unique_ptr<DSLRImage>> m_PipelineQueue;
+        bool m_PipelineTerminate {false};
+        // The pipeline thread is decoding a frame
+        bool m_PipelineBusy {false};
+        // Waits on the event loop for room in the queue before the next exposure
+        int m_PipelineTimerID {-1};
+        bool m_PipelineRestart {false};
+        std::atomic<uint32_t> m_PipelineGeneration {0};
+
+        uint32_t m_SimulationFrame {0};
+
         static constexpr double MINUMUM_CAMERA_TEMPERATURE = -60.0;
 
+        // Maximum number of downloaded images waiting to be decoded
+        static constexpr size_t PIPELINE_DEPTH = 2;
+        // Synthetic frame size when no CCD information is set in simulation
+        static constexpr int SIMULATION_WIDTH = 1280;
+        static constexpr int SIMULATION_HEIGHT = 1024;
+
         // Ratio from far 3 to far 2
         static constexpr double FOCUS_HIGH_MED_RATIO = 7.33;
         // Ratio from far 2 to far 1
@@ -157,6 +157,7 @@ struct _gphoto_driver
 
     bool supports_temperature;
     float last_sensor_temp;
+    double last_download_time;
     bool bulb_mode {false};
 
     DSUSBDriver *dsusb;
@@ -824,9 +825,16 @@ static int download_image(gphoto_driver *gphoto, CameraFilePath *fn, int fd)
             DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "gp_file_new_from_fd failed (%s)", gp_result_as_string(result));
     }
 
+    struct timeval download_start, download_end;
+    gettimeofday(&download_start, nullptr);
+
     result = gp_camera_file_get(gphoto->camera, fn->folder, fn->name, GP_FILE_TYPE_NORMAL, gphoto->camerafile,
                                 gphoto->context);
 
+    gettimeofday(&download_end, nullptr);
+    gphoto->last_download_time = (download_end.tv_sec - download_start.tv_sec) +
+                                 (download_end.tv_usec - download_start.tv_usec) / 1e6;
+
     //if (!(gphoto->command & DSLR_CMD_ABORT))
     //    DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "Downloading image (%s) in folder (%s)", fn->name, fn->folder);
 
@@ -1026,6 +1034,11 @@ float gphoto_get_last_sensor_temperature(gphoto_driver *gphoto)
     return gphoto->last_sensor_temp;
 }
 
+double gphoto_get_last_download_time(gphoto_driver *gphoto)
+{
+    return gphoto->last_download_time;
+}
+
 int gphoto_mirrorlock(gphoto_driver *gphoto, int msec)
 {
     if (gphoto->bulb_widget && !strcmp(gphoto->bulb_widget->name, "eosremoterelease"))
@@ -2077,6 +2090,14 @@ void gphoto_free_buffer(gphoto_driver *gphoto)
     }
 }
 
+/* Hands the downloaded file over to the caller, who releases it with gp_file_free() */
+CameraFile *gphoto_take_file(gphoto_driver *gphoto)
+{
+    CameraFile *file   = gphoto->camerafile;
+    gphoto->camerafile = nullptr;
+    return file;
+}
+
 const char *gphoto_get_file_extension(gphoto_driver *gphoto)
 {
     if (gphoto->filename[0])
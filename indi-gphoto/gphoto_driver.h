@@ -91,6 +91,7 @@ gphoto_driver *gphoto_open(Camera *camera, GPContext *context, const char *model
 int gphoto_close(gphoto_driver *gphoto);
 void gphoto_get_buffer(gphoto_driver *gphoto, const char **buffer, size_t *size);
 void gphoto_free_buffer(gphoto_driver *gphoto);
+CameraFile *gphoto_take_file(gphoto_driver *gphoto);
 const char *gphoto_get_file_extension(gphoto_driver *gphoto);
 void gphoto_show_options(gphoto_driver *gphoto);
 gphoto_widget_list *gphoto_find_all_widgets(gphoto_driver *gphoto);
@@ -115,5 +116,7 @@ const char *gphoto_get_model(gphoto_driver *gphoto);
 int gphoto_delete_sdcard_image(gphoto_driver *gphoto, bool delete_sdcard_image);
 bool gphoto_supports_temperature(gphoto_driver *gphoto);
 float gphoto_get_last_sensor_temperature(gphoto_driver *gphoto);
+/* Duration in seconds of the last image transfer from the camera */
+double gphoto_get_last_download_time(gphoto_driver *gphoto);
 void gphoto_force_bulb(gphoto_driver *gphoto, bool enabled);
 void gphoto_set_view_finder(gphoto_driver *gphoto, bool enabled);
@@ -0,0 +1,223 @@
+/*
+    Driver type: GPhoto Camera INDI Driver
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+    or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+    License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this library; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+
+*/
+
+/*
+ * Runs a real raw file through the download and decode pipeline, without a camera:
+ *
+ *     gphoto_pipeline_check <raw file> [frames]
+ *
+ * The file is decoded once the way the serial path does it, then queued from memory as a
+ * camera download would be, frames times through the pipeline thread. Every pipelined frame
+ * must come out identical to the serial one. Last, the pipeline is aborted with frames still
+ * queued, and no frame may be sent after abortPipeline() returns.
+ */
+
+#include "gphoto_ccd.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+struct FrameSum
+{
+    uint64_t sum {0};
+    int width {0}, height {0}, bpp {0}, naxis {0};
+
+    bool operator==(const FrameSum &other) const
+    {
+        return sum == other.sum && width == other.width && height == other.height && bpp == other.bpp &&
+               naxis == other.naxis;
+    }
+};
+
+class GPhotoPipelineCheck : public GPhotoCCD
+{
+    public:
+        static constexpr size_t depth = PIPELINE_DEPTH;
+
+        GPhotoPipelineCheck()
+        {
+            setSimulation(true);
+            initProperties();
+        }
+
+        // Serial path: the file is decoded from disk
+        bool decodeFile(const char *path)
+        {
+            IUSaveText(&UploadFileT[0], path);
+
+            DSLRImage image;
+            if (downloadImage(image) == false)
+                return false;
+            return processImage(image);
+        }
+
+        // Pipelined path: the file is decoded from memory, as a camera download
+        bool queueFile(const std::vector<uint8_t> &content, const char *extension)
+        {
+            {
+                // An exposure only starts when the queue has room for its image
+                std::unique_lock<std::mutex> lock(m_PipelineMutex);
+                m_PipelineCV.wait(lock, [this]()
+                {
+                    return m_PipelineQueue.size() < PIPELINE_DEPTH;
+                });
+            }
+
+            std::unique_ptr<DSLRImage> image(new DSLRImage());
+            image->data       = content;
+            image->buffer     = reinterpret_cast<const char *>(image->data.data());
+            image->size       = image->data.size();
+            image->extension  = extension;
+            image->generation = m_PipelineGeneration;
+
+            PipelineN[PIPELINE_FRAMES].value = 1;
+            return queueImage(std::move(image));
+        }
+
+        void drain()
+        {
+            std::unique_lock<std::mutex> lock(m_PipelineMutex);
+            m_PipelineCV.wait(lock, [this]()
+            {
+                return m_PipelineQueue.empty() && m_PipelineBusy == false;
+            });
+        }
+
+        void abort()
+        {
+            abortPipeline();
+        }
+
+        bool idle()
+        {
+            std::lock_guard<std::mutex> lock(m_PipelineMutex);
+            return m_PipelineQueue.empty() && m_PipelineBusy == false;
+        }
+
+        std::vector<FrameSum> frames()
+        {
+            std::lock_guard<std::mutex> lock(framesLock);
+            return sums;
+        }
+
+    protected:
+        bool ExposureComplete(INDI::CCDChip *targetChip) override
+        {
+            std::lock_guard<std::mutex> guard(ccdBufferLock);
+
+            FrameSum frame;
+            frame.width  = targetChip->getSubW();
+            frame.height = targetChip->getSubH();
+            frame.bpp    = targetChip->getBPP();
+            frame.naxis  = targetChip->getNAxis();
+
+            // FNV-1a over the image the driver would send
+            const uint8_t *buffer = targetChip->getFrameBuffer();
+            size_t size = static_cast<size_t>(frame.width) * frame.height * frame.bpp / 8 * (frame.naxis == 3 ? 3 : 1);
+            frame.sum = 14695981039346656037ULL;
+            for (size_t i = 0; i < size; i++)
+                frame.sum = (frame.sum ^ buffer[i]) * 1099511628211ULL;
+
+            std::lock_guard<std::mutex> lock(framesLock);
+            sums.push_back(frame);
+            return true;
+        }
+
+    private:
+        std::mutex framesLock;
+        std::vector<FrameSum> sums;
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <raw file> [frames]\n", argv[0]);
+        return 2;
+    }
+
+    const char *path = argv[1];
+    int count = argc > 2 ? atoi(argv[2]) : 8;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const char *extension = strrchr(path, '.');
+    if (content.empty() || extension == nullptr)
+    {
+        fprintf(stderr, "%s: cannot read raw file\n", path);
+        return 2;
+    }
+    extension++;
+
+    GPhotoPipelineCheck ccd;
+    bool ok = true;
+
+    // Serial reference
+    if (ccd.decodeFile(path) == false || ccd.frames().size() != 1)
+    {
+        fprintf(stderr, "serial: %s failed to decode\n", path);
+        return 1;
+    }
+    FrameSum reference = ccd.frames()[0];
+    printf("serial: %dx%d, %d bit, %d axis\n", reference.width, reference.height, reference.bpp, reference.naxis);
+
+    // Pipelined frames decode from memory on the pipeline thread
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+        ok = ccd.queueFile(content, extension) && ok;
+    ccd.drain();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<FrameSum> frames = ccd.frames();
+    int matched = 0;
+    for (size_t i = 1; i < frames.size(); i++)
+        matched += frames[i] == reference;
+    printf("pipeline: %d frames, %zu sent, %d identical to serial, %.1f frames/s\n", count, frames.size() - 1, matched,
+           count / elapsed);
+    if (static_cast<int>(frames.size()) != count + 1 || matched != count)
+    {
+        fprintf(stderr, "pipeline: frames differ from the serial decode\n");
+        ok = false;
+    }
+
+    // Abort with frames queued and one being decoded
+    size_t before = ccd.frames().size();
+    for (size_t i = 0; i < GPhotoPipelineCheck::depth; i++)
+        ok = ccd.queueFile(content, extension) && ok;
+    ccd.abort();
+    size_t aborted = ccd.frames().size();
+    bool idle = ccd.idle();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(elapsed / count * 2000) + 100));
+    size_t after = ccd.frames().size();
+    printf("abort: %zu of %zu frames sent, worker %s\n", aborted - before, GPhotoPipelineCheck::depth,
+           idle ? "idle" : "busy");
+    if (idle == false || after != aborted)
+    {
+        fprintf(stderr, "abort: %zu frames sent after abortPipeline() returned\n", after - aborted);
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -308,25 +308,16 @@ int dcraw_parse_header_info(const char *filename, struct dcraw_header *header)
     return 0;
 }
 
-int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel,
-                char *bayer_pattern)
+/* Unpack an opened LibRaw image and copy its visible area into memptr */
+static int unpack_libraw(LibRaw &RawProcessor, const char *source, uint8_t **memptr, size_t *memsize, int *n_axis,
+                         int *w, int *h, int *bitsperpixel, char *bayer_pattern)
 {
     int ret = 0;
-    // Creation of image processing object
-    LibRaw RawProcessor;
-
-    // Let us open the file
-    if ((ret = RawProcessor.open_file(filename)) != LIBRAW_SUCCESS)
-    {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot open %s: %s", filename, libraw_strerror(ret));
-        RawProcessor.recycle();
-        return -1;
-    }
 
     // Let us unpack the image
     if ((ret = RawProcessor.unpack()) != LIBRAW_SUCCESS)
     {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot unpack %s: %s", filename, libraw_strerror(ret));
+        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot unpack %s: %s", source, libraw_strerror(ret));
         RawProcessor.recycle();
         return -1;
     }
@@ -334,7 +325,7 @@ int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_
     // Covert to image
     if ((ret = RawProcessor.raw2image()) != LIBRAW_SUCCESS)
     {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot convert %s : %s", filename, libraw_strerror(ret));
+        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot convert %s : %s", source, libraw_strerror(ret));
         RawProcessor.recycle();
         return -1;
     }
@@ -369,16 +360,58 @@ int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_
     uint16_t *image = reinterpret_cast<uint16_t *>(*memptr);
     uint16_t *src   = RawProcessor.imgdata.rawdata.raw_image + first_visible_pixel;
 
-    for (int i = 0; i < RawProcessor.imgdata.rawdata.sizes.height; i++)
+    // Without margins the visible area is contiguous
+    if (RawProcessor.imgdata.rawdata.sizes.raw_width == RawProcessor.imgdata.rawdata.sizes.width)
+        memcpy(image, src, *memsize);
+    else
     {
-        memcpy(image, src, RawProcessor.imgdata.rawdata.sizes.width * 2);
-        image += RawProcessor.imgdata.rawdata.sizes.width;
-        src += RawProcessor.imgdata.rawdata.sizes.raw_width;
+        for (int i = 0; i < RawProcessor.imgdata.rawdata.sizes.height; i++)
+        {
+            memcpy(image, src, RawProcessor.imgdata.rawdata.sizes.width * 2);
+            image += RawProcessor.imgdata.rawdata.sizes.width;
+            src += RawProcessor.imgdata.rawdata.sizes.raw_width;
+        }
     }
 
     return 0;
 }
 
+int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel,
+                char *bayer_pattern)
+{
+    int ret = 0;
+    // Creation of image processing object
+    LibRaw RawProcessor;
+
+    // Let us open the file
+    if ((ret = RawProcessor.open_file(filename)) != LIBRAW_SUCCESS)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot open %s: %s", filename, libraw_strerror(ret));
+        RawProcessor.recycle();
+        return -1;
+    }
+
+    return unpack_libraw(RawProcessor, filename, memptr, memsize, n_axis, w, h, bitsperpixel, bayer_pattern);
+}
+
+int read_libraw_mem(const void *inBuffer, size_t inSize, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h,
+                    int *bitsperpixel, char *bayer_pattern)
+{
+    int ret = 0;
+    // Creation of image processing object
+    LibRaw RawProcessor;
+
+    // Let us open the buffer. LibRaw does not modify it.
+    if ((ret = RawProcessor.open_buffer(const_cast<void *>(inBuffer), inSize)) != LIBRAW_SUCCESS)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "Cannot open raw buffer: %s", libraw_strerror(ret));
+        RawProcessor.recycle();
+        return -1;
+    }
+
+    return unpack_libraw(RawProcessor, "raw buffer", memptr, memsize, n_axis, w, h, bitsperpixel, bayer_pattern);
+}
+
 int read_dcraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel)
 {
     struct dcraw_header header;
@@ -412,60 +445,46 @@ int read_dcraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_a
     return rc;
 }
 
-int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *naxis, int *w, int *h)
+/*
+ * Decompress a JPEG whose source is already set up in cinfo. When planar is set, color images
+ * are split into R, G and B planes as required by FITS, otherwise pixels are kept interleaved.
+ */
+static int decompress_jpeg(struct jpeg_decompress_struct *cinfo, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
+                           int *h, bool planar)
 {
-    unsigned char *r_data = nullptr, *g_data = nullptr, *b_data = nullptr;
-
-    /* these are standard libjpeg structures for reading(decompression) */
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
     /* libjpeg data structure for storing one row, that is, scanline of an image */
     JSAMPROW row_pointer[1] = { nullptr };
 
-    FILE *infile = fopen(filename, "rb");
-
-    if (!infile)
-    {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "Error opening jpeg file %s!", filename);
-        return -1;
-    }
-    /* here we set up the standard libjpeg error handler */
-    cinfo.err = jpeg_std_error(&jerr);
-    /* setup decompression process and source, then read JPEG header */
-    jpeg_create_decompress(&cinfo);
-    /* this makes the library read from infile */
-    jpeg_stdio_src(&cinfo, infile);
     /* reading the image header which contains image information */
-    jpeg_read_header(&cinfo, (boolean)TRUE);
+    jpeg_read_header(cinfo, (boolean)TRUE);
 
     /* Start decompression jpeg here */
-    jpeg_start_decompress(&cinfo);
+    jpeg_start_decompress(cinfo);
 
-    *memsize = cinfo.output_width * cinfo.output_height * cinfo.num_components;
+    *memsize = cinfo->output_width * cinfo->output_height * cinfo->num_components;
     *memptr  = (uint8_t *)realloc(*memptr, *memsize);
-    uint8_t *oldmem =
-        *memptr; // if you do some ugly pointer math, remember to restore the original pointer or some random crashes will happen. This is why I do not like pointers!!
-    *naxis = cinfo.num_components;
-    *w     = cinfo.output_width;
-    *h     = cinfo.output_height;
+
+    *naxis = cinfo->num_components;
+    *w     = cinfo->output_width;
+    *h     = cinfo->output_height;
+
+    uint8_t *destmem = *memptr;
+    uint8_t *r_data  = *memptr;
+    uint8_t *g_data  = r_data + cinfo->output_width * cinfo->output_height;
+    uint8_t *b_data  = r_data + 2 * cinfo->output_width * cinfo->output_height;
 
     /* now actually read the jpeg into the raw buffer */
-    row_pointer[0] = (unsigned char *)malloc(cinfo.output_width * cinfo.num_components);
-    if (cinfo.num_components)
-    {
-        r_data = (unsigned char *)*memptr;
-        g_data = r_data + cinfo.output_width * cinfo.output_height;
-        b_data = r_data + 2 * cinfo.output_width * cinfo.output_height;
-    }
+    row_pointer[0] = (unsigned char *)malloc(cinfo->output_width * cinfo->num_components);
+
     /* read one scan line at a time */
-    for (unsigned int row = 0; row < cinfo.image_height; row++)
+    for (unsigned int row = 0; row < cinfo->output_height; row++)
     {
         unsigned char *ppm8 = row_pointer[0];
-        jpeg_read_scanlines(&cinfo, row_pointer, 1);
+        jpeg_read_scanlines(cinfo, row_pointer, 1);
 
-        if (cinfo.num_components == 3)
+        if (planar && cinfo->num_components == 3)
         {
-            for (unsigned int i = 0; i < cinfo.output_width; i++)
+            for (unsigned int i = 0; i < cinfo->output_width; i++)
             {
                 *r_data++ = *ppm8++;
                 *g_data++ = *ppm8++;
@@ -474,76 +493,76 @@ int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *naxi
         }
         else
         {
-            memcpy(*memptr, ppm8, cinfo.output_width);
-            *memptr += cinfo.output_width;
+            memcpy(destmem, ppm8, cinfo->output_width * cinfo->num_components);
+            destmem += cinfo->output_width * cinfo->num_components;
         }
     }
 
     /* wrap up decompression, destroy objects, free pointers and close open files */
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
+    jpeg_finish_decompress(cinfo);
+    jpeg_destroy_decompress(cinfo);
 
     if (row_pointer[0])
         free(row_pointer[0]);
-    if (infile)
-        fclose(infile);
-
-    *memptr = oldmem;
 
     return 0;
 }
 
-int read_jpeg_mem(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
-                  int *h)
+int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *naxis, int *w, int *h)
 {
     /* these are standard libjpeg structures for reading(decompression) */
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_mgr jerr;
-    /* libjpeg data structure for storing one row, that is, scanline of an image */
-    JSAMPROW row_pointer[1] = { nullptr };
 
+    FILE *infile = fopen(filename, "rb");
+
+    if (!infile)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "Error opening jpeg file %s!", filename);
+        return -1;
+    }
     /* here we set up the standard libjpeg error handler */
     cinfo.err = jpeg_std_error(&jerr);
     /* setup decompression process and source, then read JPEG header */
     jpeg_create_decompress(&cinfo);
     /* this makes the library read from infile */
-    jpeg_mem_src(&cinfo, inBuffer, inSize);
-
-    /* reading the image header which contains image information */
-    jpeg_read_header(&cinfo, (boolean)TRUE);
+    jpeg_stdio_src(&cinfo, infile);
 
-    /* Start decompression jpeg here */
-    jpeg_start_decompress(&cinfo);
+    int rc = decompress_jpeg(&cinfo, memptr, memsize, naxis, w, h, true);
 
-    *memsize = cinfo.output_width * cinfo.output_height * cinfo.num_components;
-    *memptr  = (uint8_t *)realloc(*memptr, *memsize);
+    fclose(infile);
 
-    uint8_t *destmem = *memptr;
+    return rc;
+}
 
-    *naxis = cinfo.num_components;
-    *w     = cinfo.output_width;
-    *h     = cinfo.output_height;
+int read_jpeg_mem(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
+                  int *h)
+{
+    /* these are standard libjpeg structures for reading(decompression) */
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
 
-    /* now actually read the jpeg into the raw buffer */
-    row_pointer[0] = (unsigned char *)malloc(cinfo.output_width * cinfo.num_components);
+    /* here we set up the standard libjpeg error handler */
+    cinfo.err = jpeg_std_error(&jerr);
+    /* setup decompression process and source, then read JPEG header */
+    jpeg_create_decompress(&cinfo);
+    /* this makes the library read from memory */
+    jpeg_mem_src(&cinfo, inBuffer, inSize);
 
-    /* read one scan line at a time */
-    for (unsigned int row = 0; row < cinfo.image_height; row++)
-    {
-        unsigned char *ppm8 = row_pointer[0];
-        jpeg_read_scanlines(&cinfo, row_pointer, 1);
-        memcpy(destmem, ppm8, cinfo.output_width * cinfo.num_components);
-        destmem += cinfo.output_width * cinfo.num_components;
-    }
+    return decompress_jpeg(&cinfo, memptr, memsize, naxis, w, h, false);
+}
 
-    /* wrap up decompression, destroy objects, free pointers and close open files */
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
+int read_jpeg_mem_planar(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis,
+                         int *w, int *h)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
 
-    if (row_pointer[0])
-        free(row_pointer[0]);
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, inBuffer, inSize);
 
-    return 0;
+    return decompress_jpeg(&cinfo, memptr, memsize, naxis, w, h, true);
 }
 
 int read_jpeg_size(unsigned char *inBuffer, unsigned long inSize, int *w, int *h)
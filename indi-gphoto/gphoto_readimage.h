@@ -7,8 +7,14 @@
 int read_dcraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel);
 int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel,
                 char *bayer_pattern);
+/* Decode a raw image already in memory, e.g. straight from the camera file, without a temporary file */
+int read_libraw_mem(const void *inBuffer, size_t inSize, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h,
+                    int *bitsperpixel, char *bayer_pattern);
 int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h);
 int read_jpeg_mem(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
                   int *h);
+/* Same as read_jpeg_mem, but color channels are split into planes as read_jpeg does for FITS */
+int read_jpeg_mem_planar(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis,
+                         int *w, int *h);
 int read_jpeg_size(unsigned char *inBuffer, unsigned long inSize, int *w, int *h);
 void gphoto_read_set_debug(const char *name);
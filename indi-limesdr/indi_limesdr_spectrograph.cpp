@@ -23,6 +23,7 @@
 #include <unistd.h>
 #include <indilogger.h>
 #include <memory>
+#include <algorithm>
 
 #define min(a, b)               \
     ({                          \
@@ -36,6 +37,7 @@
 #define MIN_FRAME_SIZE (512)
 #define MAX_FRAME_SIZE (SUBFRAME_SIZE * 16)
 #define SPECTRUM_SIZE  (256)
+#define TOTAL_POWER_POINTS (4096)
 
 static int iNumofConnectedSpectrographs;
 static LIMESDR *receivers[MAX_DEVICES];
@@ -172,7 +174,7 @@ void ISSnoopDevice(XMLEle *root)
     }
 }
 
-LIMESDR::LIMESDR(uint32_t index)
+LIMESDR::LIMESDR(uint32_t index) : integrator(SPECTRUM_SIZE, TOTAL_POWER_POINTS)
 {
     InIntegration = false;
     spectrographIndex = index;
@@ -209,6 +211,8 @@ bool LIMESDR::Connect()
 bool LIMESDR::Disconnect()
 {
     InIntegration = false;
+    if (readerThread.joinable())
+        readerThread.join();
     LMS_Close(lime_dev);
     setBufferSize(1);
     LOG_INFO("LIME-SDR Spectrograph disconnected successfully!");
@@ -242,6 +246,16 @@ bool LIMESDR::initProperties()
     setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_BANDWIDTH", 400.0e+6, 3.8e+9, 1, false);
     setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_BITSPERSAMPLE", -32, -32, 0, false);
     setIntegrationFileExtension("fits");
+
+    // Raw samples, or spectrum and total power integrated as samples arrive
+    IUFillSwitch(&IntegrationModeS[MODE_RAW], "MODE_RAW", "Raw samples", ISS_ON);
+    IUFillSwitch(&IntegrationModeS[MODE_FFT], "MODE_FFT", "Streaming FFT", ISS_OFF);
+    IUFillSwitchVector(&IntegrationModeSP, IntegrationModeS, 2, getDeviceName(), "SPECTROGRAPH_INTEGRATION_MODE",
+                       "Integration", MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillBLOB(&TotalPowerB, "TOTAL_POWER", "Total power", ".fits");
+    IUFillBLOBVector(&TotalPowerBP, &TotalPowerB, 1, getDeviceName(), "SPECTROGRAPH_TOTAL_POWER", "Total power",
+                     MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
     /*
     // PrimarySpectrograph Device Continuum Blob
     IUFillBLOB(&TFitsB[0], "TRMT", "Transmit1", "");
@@ -273,6 +287,8 @@ bool LIMESDR::updateProperties()
         // Inital values
         setupParams(1000000, 1420000000, 10000, 10);
         //defineBLOB(&TFitsBP);
+        defineSwitch(&IntegrationModeSP);
+        defineBLOB(&TotalPowerBP);
 
         // Start the timer
         SetTimer(POLLMS);
@@ -280,11 +296,20 @@ bool LIMESDR::updateProperties()
     else
     {
         //deleteProperty(TFitsBP.name);
+        deleteProperty(IntegrationModeSP.name);
+        deleteProperty(TotalPowerBP.name);
     }
 
     return true;
 }
 
+bool LIMESDR::saveConfigItems(FILE *fp)
+{
+    INDI::Spectrograph::saveConfigItems(fp);
+    IUSaveConfigSwitch(fp, &IntegrationModeSP);
+    return true;
+}
+
 /**************************************************************************************
 ** Client is asking us to start an exposure
 ***************************************************************************************/
@@ -297,19 +322,33 @@ bool LIMESDR::StartIntegration(float duration)
     b_read  = 0;
     to_read = getSampleRate() * getIntegrationTime();
 
-    setBufferSize(to_read * sizeof(float));
+    bool streamingFFT = IntegrationModeS[MODE_FFT].s == ISS_ON;
+    if (streamingFFT)
+    {
+        // Only the spectrum is kept, the FIFO just has to absorb the reader latency
+        setBufferSize(SPECTRUM_SIZE * sizeof(float));
+        integrator.reset(to_read);
+        samples.resize(SUBFRAME_SIZE * 2);
+    }
+    else
+        setBufferSize(to_read * sizeof(float));
 
     if (to_read > 0)
     {
+        if (readerThread.joinable())
+            readerThread.join();
+
         lime_stream.channel             = 0;
         lime_stream.isTx                = false;
-        lime_stream.fifoSize            = to_read;
+        lime_stream.fifoSize            = streamingFFT ? MAX_FRAME_SIZE : to_read;
         lime_stream.dataFmt             = lms_stream_t::LMS_FMT_F32;
         lime_stream.throughputVsLatency = 0.5;
         LMS_SetupStream(lime_dev, &lime_stream);
         LMS_StartStream(&lime_stream);
         gettimeofday(&CapStart, nullptr);
         InIntegration = true;
+        if (streamingFFT)
+            readerThread = std::thread(&LIMESDR::Callback, this);
         LOG_INFO("Integration started...");
         return true;
     }
@@ -357,12 +396,38 @@ bool LIMESDR::ISNewNumber(const char *dev, const char *name, double values[], ch
     return processNumber(dev, name, values, names, n) & !r;
 }
 
+bool LIMESDR::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, IntegrationModeSP.name))
+    {
+        if (InIntegration)
+        {
+            LOG_WARN("Cannot change the integration mode while integrating.");
+            IntegrationModeSP.s = IPS_ALERT;
+            IDSetSwitch(&IntegrationModeSP, nullptr);
+            return true;
+        }
+
+        IUUpdateSwitch(&IntegrationModeSP, states, names, n);
+        IntegrationModeSP.s = IPS_OK;
+        IDSetSwitch(&IntegrationModeSP, nullptr);
+        return true;
+    }
+    return INDI::Spectrograph::ISNewSwitch(dev, name, states, names, n);
+}
+
 /**************************************************************************************
 ** Client is asking us to abort a capture
 ***************************************************************************************/
 bool LIMESDR::AbortIntegration()
 {
-    if (InIntegration)
+    if (readerThread.joinable())
+    {
+        // The reader thread stops and destroys the stream
+        InIntegration = false;
+        readerThread.join();
+    }
+    else if (InIntegration)
     {
         lms_stream_status_t status;
         LMS_GetStreamStatus(&lime_stream, &status);
@@ -411,11 +476,12 @@ void LIMESDR::TimerHit()
         {
             /* We're done capturing */
             LOG_INFO("Integration done, expecting data...");
-            lms_stream_status_t status;
-            LMS_GetStreamStatus(&lime_stream, &status);
-            if (status.active)
+            // In FFT mode the stream belongs to the reader thread, which may be destroying it
+            if (IntegrationModeS[MODE_RAW].s == ISS_ON && !readerThread.joinable())
             {
-                if (status.fifoFilledCount >= status.fifoSize)
+                lms_stream_status_t status;
+                LMS_GetStreamStatus(&lime_stream, &status);
+                if (status.active && status.fifoFilledCount >= status.fifoSize)
                 {
                     n_read = status.fifoFilledCount;
                     grabData();
@@ -435,9 +501,47 @@ void LIMESDR::TimerHit()
 /**************************************************************************************
 ** Create the spectrum
 ***************************************************************************************/
+void LIMESDR::Callback()
+{
+    while (InIntegration && to_read > 0)
+        grabData();
+
+    // The reader thread owns the stream, whether the integration completed, failed or was aborted
+    LMS_StopStream(&lime_stream);
+    LMS_DestroyStream(lime_dev, &lime_stream);
+}
+
 void LIMESDR::grabData()
 {
-    if (InIntegration)
+    if (InIntegration && IntegrationModeS[MODE_FFT].s == ISS_ON)
+    {
+        int len = min(SUBFRAME_SIZE, to_read);
+        int n   = LMS_RecvStream(&lime_stream, samples.data(), len, NULL, 1000);
+        if (n < 0)
+        {
+            // Callback() destroys the stream
+            LOG_ERROR("Error receiving samples.");
+            InIntegration = false;
+            return;
+        }
+        integrator.addF32(samples.data(), n);
+        b_read += n;
+        to_read -= n;
+
+        if (to_read <= 0)
+        {
+            // Callback() destroys the stream once the loop ends
+            continuum = getBuffer();
+            if (integrator.getSpectrum(reinterpret_cast<float *>(continuum)) == 0)
+                memset(continuum, 0, getBufferSize());
+            InIntegration = false;
+            sendTotalPower(integrator, &TotalPowerBP, getSampleRate());
+
+            LOG_INFO("Download complete.");
+            IntegrationComplete();
+        }
+    }
+    else if (InIntegration)
     {
         continuum = getBuffer();
         LOG_INFO("Downloading...");
@@ -450,3 +554,4 @@ void LIMESDR::grabData()
         IntegrationComplete();
     }
 }
+
@@ -21,6 +21,11 @@
 
 #include <lime/LimeSuite.h>
 #include "indispectrograph.h"
+#include "sdr_integrator.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
 
 enum Settings
 {
@@ -35,6 +40,7 @@ class LIMESDR : public INDI::Spectrograph
     LIMESDR(uint32_t index);
 
     bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n);
+    bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n);
 
   protected:
 	// General device functions
@@ -43,6 +49,7 @@ class LIMESDR : public INDI::Spectrograph
 	const char *getDefaultName();
 	bool initProperties();
 	bool updateProperties();
+    bool saveConfigItems(FILE *fp);
 
     // Spectrograph specific functions
     bool StartIntegration(float duration);
@@ -51,6 +58,7 @@ class LIMESDR : public INDI::Spectrograph
     void TimerHit();
 
     void grabData();
+    void Callback();
 
   private:
     lms_device_t *lime_dev = { nullptr };
@@ -59,7 +67,7 @@ class LIMESDR : public INDI::Spectrograph
     void setupParams(float sr, float freq, float bw, float gain);
     lms_stream_t lime_stream;
 	// Are we exposing?
-    bool InIntegration;
+    std::atomic<bool> InIntegration;
 	// Struct to keep timing
 	struct timeval CapStart;
     int to_read;
@@ -73,4 +81,18 @@ class LIMESDR : public INDI::Spectrograph
 
     IBLOB TFitsB[5];
     IBLOBVectorProperty TFitsBP;
+
+    // Streaming FFT mode: a reader thread integrates the spectrum and total power as samples arrive
+    ISwitch IntegrationModeS[2];
+    ISwitchVectorProperty IntegrationModeSP;
+    enum
+    {
+        MODE_RAW,
+        MODE_FFT
+    };
+    IBLOB TotalPowerB;
+    IBLOBVectorProperty TotalPowerBP;
+    SDRIntegrator integrator;
+    std::vector<float> samples;
+    std::thread readerThread;
 };
@@ -26,6 +26,7 @@
 
 #include <libnova/julian_day.h>
 #include <algorithm>
+#include <errno.h>
 #include <math.h>
 
 #define TEMP_THRESHOLD       0.05   /* Differential temperature threshold (C)*/
@@ -429,6 +430,17 @@ bool QHYCCD::initProperties()
     IUFillText(&GPSDataNowT[GPS_DATA_NOW_TS], "GPS_DATA_NOW_TS", "TS", "NA");
     IUFillTextVector(&GPSDataNowTP, GPSDataNowT, 4, getDeviceName(), "GPS_DATA_NOW", "Now", GPS_DATA_TAB, IP_RO, 60, IPS_IDLE);
 
+    // GPS Data refresh rate while streaming, 0 to refresh on every frame
+    IUFillNumber(&GPSDataRateN[0], "GPS_DATA_RATE_VALUE", "Rate (Hz)", "%.1f", 0, 100, 1, 1);
+    IUFillNumberVector(&GPSDataRateNP, GPSDataRateN, 1, getDeviceName(), "GPS_DATA_RATE", "Refresh", GPS_DATA_TAB, IP_RW, 60,
+                       IPS_IDLE);
+
+    // GPS timing journal written next to stream recordings
+    IUFillSwitch(&GPSJournalS[INDI_ENABLED], "INDI_ENABLED", "Enable", ISS_ON);
+    IUFillSwitch(&GPSJournalS[INDI_DISABLED], "INDI_DISABLED", "Disable", ISS_OFF);
+    IUFillSwitchVector(&GPSJournalSP, GPSJournalS, 2, getDeviceName(), "GPS_JOURNAL", "Journal", GPS_DATA_TAB, IP_RW,
+                       ISR_1OFMANY, 0, IPS_IDLE);
+
     addAuxControls();
     setDriverInterface(getDriverInterface() | FILTER_INTERFACE);
 
@@ -500,6 +512,8 @@ void QHYCCD::ISGetProperties(const char *dev)
             defineText(&GPSDataStartTP);
             defineText(&GPSDataEndTP);
             defineText(&GPSDataNowTP);
+            defineNumber(&GPSDataRateNP);
+            defineSwitch(&GPSJournalSP);
         }
     }
 }
@@ -716,6 +730,8 @@ bool QHYCCD::updateProperties()
             defineText(&GPSDataStartTP);
             defineText(&GPSDataEndTP);
             defineText(&GPSDataNowTP);
+            defineNumber(&GPSDataRateNP);
+            defineSwitch(&GPSJournalSP);
         }
 
         // Let's get parameters now from CCD
@@ -785,6 +801,8 @@ bool QHYCCD::updateProperties()
             deleteProperty(GPSDataStartTP.name);
             deleteProperty(GPSDataEndTP.name);
             deleteProperty(GPSDataNowTP.name);
+            deleteProperty(GPSDataRateNP.name);
+            deleteProperty(GPSJournalSP.name);
         }
     }
 
@@ -1482,6 +1500,10 @@ int QHYCCD::grabImage()
             return -1;
         }
     }
+
+    bool hasGPSHeader = HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON;
+    if (hasGPSHeader)
+        GPSHeader.decode(PrimaryCCD.getFrameBuffer());
     guard.unlock();
 
     // Perform software binning if necessary
@@ -1493,8 +1515,8 @@ int QHYCCD::grabImage()
     else
         LOG_DEBUG("Download complete.");
 
-    if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
-        decodeGPSHeader();
+    if (hasGPSHeader)
+        updateGPSProperties();
 
     ExposureComplete(&PrimaryCCD);
 
@@ -1713,6 +1735,18 @@ bool QHYCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
             return true;
         }
 
+        //////////////////////////////////////////////////////////////////////
+        /// GPS Journal
+        //////////////////////////////////////////////////////////////////////
+        else if (!strcmp(GPSJournalSP.name, name))
+        {
+            // The imaging thread opens or closes the journal on the next frame
+            IUUpdateSwitch(&GPSJournalSP, states, names, n);
+            GPSJournalSP.s = IPS_OK;
+            IDSetSwitch(&GPSJournalSP, nullptr);
+            return true;
+        }
+
         //////////////////////////////////////////////////////////////////////
         /// GPS Slaving Mode
         //////////////////////////////////////////////////////////////////////
@@ -2098,6 +2132,17 @@ bool QHYCCD::ISNewNumber(const char *dev, const char *name, double values[], cha
             return true;
         }
 
+        //////////////////////////////////////////////////////////////////////
+        /// GPS Data Refresh Rate
+        //////////////////////////////////////////////////////////////////////
+        else if (!strcmp(name, GPSDataRateNP.name))
+        {
+            IUUpdateNumber(&GPSDataRateNP, values, names, n);
+            GPSDataRateNP.s = IPS_OK;
+            IDSetNumber(&GPSDataRateNP, nullptr);
+            return true;
+        }
+
     }
 
     return INDI::CCD::ISNewNumber(dev, name, values, names, n);
@@ -2249,6 +2294,8 @@ bool QHYCCD::saveConfigItems(FILE *fp)
     {
         IUSaveConfigSwitch(fp, &GPSControlSP);
         IUSaveConfigSwitch(fp, &GPSSlavingSP);
+        IUSaveConfigNumber(fp, &GPSDataRateNP);
+        IUSaveConfigSwitch(fp, &GPSJournalSP);
         IUSaveConfigNumber(fp, &VCOXFreqNP);
     }
 
@@ -2448,17 +2495,38 @@ void QHYCCD::streamVideo()
             else
                 break;
         }
+        bool hasGPSHeader = ret == QHYCCD_SUCCESS && HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON;
+        if (hasGPSHeader)
+            GPSHeader.decode(buffer);
         guard.unlock();
         if (ret == QHYCCD_SUCCESS)
         {
             Streamer->newFrame(buffer, w * h * bpp / 8 * channels);
 
-            if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
-                decodeGPSHeader();
+            if (hasGPSHeader)
+            {
+                journalGPSHeader();
+
+                // Formatting and sending the GPS properties on every frame floods clients at high frame rates
+                auto now = std::chrono::steady_clock::now();
+                if (GPSDataRateN[0].value <= 0 ||
+                        std::chrono::duration<double>(now - m_GPSUpdateTime).count() >= 1.0 / GPSDataRateN[0].value)
+                {
+                    m_GPSUpdateTime = now;
+                    updateGPSProperties();
+                }
+            }
         }
 
         pthread_mutex_lock(&condMutex);
     }
+
+    if (m_GPSJournal.isOpen())
+    {
+        m_GPSJournal.close();
+        LOGF_INFO("GPS journal %s closed: %u frames, %u dropped.", m_GPSJournal.path().c_str(), m_GPSJournal.frames(),
+                  m_GPSJournal.dropped());
+    }
 }
 
 void QHYCCD::getExposure()
@@ -2668,115 +2736,59 @@ void QHYCCD::setLEDStartPosNP(const INumberVectorProperty &value)
     GPSLEDStartPosNP = value;
 }
 
-void QHYCCD::decodeGPSHeader()
+void QHYCCD::updateGPSProperties()
 {
     char ts[64] = {0}, iso8601[64] = {0}, data[64] = {0};
 
-    uint8_t gpsarray[64] = {0};
-    memcpy(gpsarray, PrimaryCCD.getFrameBuffer(), 64);
-
-    // Sequence Number
-    GPSHeader.seqNumber = gpsarray[0] << 24 | gpsarray[1] << 16 | gpsarray[2] << 8 | gpsarray[3];
+    // Header
     snprintf(data, 64, "%u", GPSHeader.seqNumber);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_SEQ_NUMBER], data);
-
-    GPSHeader.tempNumber = gpsarray[4];
-
-    // Width
-    GPSHeader.width = gpsarray[5] << 8 | gpsarray[6];
     snprintf(data, 64, "%u", GPSHeader.width);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_WIDTH], data);
-
-    // Height
-    GPSHeader.height = gpsarray[7] << 8 | gpsarray[8];
     snprintf(data, 64, "%u", GPSHeader.height);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_HEIGHT], data);
-
-    // Latitude
-    GPSHeader.latitude = gpsarray[9] << 24 | gpsarray[10] << 16 | gpsarray[11] << 8 | gpsarray[12];
     snprintf(data, 64, "%u", GPSHeader.latitude);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_LATITUDE], data);
-
-    // Longitude
-    GPSHeader.longitude = gpsarray[13] << 24 | gpsarray[14] << 16 | gpsarray[15] << 8 | gpsarray[16];
     snprintf(data, 64, "%u", GPSHeader.longitude);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_LONGITUDE], data);
+    snprintf(data, 64, "%u", GPSHeader.max_clock);
+    IUSaveText(&GPSDataHeaderT[GPS_DATA_MAX_CLOCK], data);
 
-    // Start Flag
-    GPSHeader.start_flag = gpsarray[17];
+    // Start
     snprintf(data, 64, "%u", GPSHeader.start_flag);
     IUSaveText(&GPSDataStartT[GPS_DATA_START_FLAG], data);
-
-    // Start Seconds
-    GPSHeader.start_sec = gpsarray[18] << 24 | gpsarray[19] << 16 | gpsarray[20] << 8 | gpsarray[21];
     snprintf(data, 64, "%u", GPSHeader.start_sec);
     IUSaveText(&GPSDataStartT[GPS_DATA_START_SEC], data);
-
-    // Start microseconds
-    // It's a 10Mhz crystal so we divide by 10 to get microseconds
-    GPSHeader.start_us = (gpsarray[22] << 16 | gpsarray[23] << 8 | gpsarray[24]) / 10.0;
     snprintf(data, 64, "%.1f", GPSHeader.start_us);
     IUSaveText(&GPSDataStartT[GPS_DATA_START_USEC], data);
-
-    // Start JD
-    GPSHeader.start_jd = JStoJD(GPSHeader.start_sec, GPSHeader.start_us);
     // Get ISO8601
     JDtoISO8601(GPSHeader.start_jd, iso8601);
     // Add millisecond
     snprintf(ts, sizeof(ts), "%s.%03d", iso8601, static_cast<int>(GPSHeader.start_us / 1000.0));
     IUSaveText(&GPSDataStartT[GPS_DATA_START_TS], ts);
 
-    // End Flag
-    GPSHeader.end_flag = gpsarray[25];
+    // End
     snprintf(data, 64, "%u", GPSHeader.end_flag);
     IUSaveText(&GPSDataEndT[GPS_DATA_END_FLAG], data);
-
-    // End Seconds
-    GPSHeader.end_sec = gpsarray[26] << 24 | gpsarray[27] << 16 | gpsarray[28] << 8 | gpsarray[29];
     snprintf(data, 64, "%u", GPSHeader.end_sec);
     IUSaveText(&GPSDataEndT[GPS_DATA_END_SEC], data);
-
-    // End Microseconds
-    GPSHeader.end_us = (gpsarray[30] << 16 | gpsarray[31] << 8 | gpsarray[32]) / 10.0;
     snprintf(data, 64, "%.1f", GPSHeader.end_us);
     IUSaveText(&GPSDataEndT[GPS_DATA_END_USEC], data);
-
-    // End JD
-    GPSHeader.end_jd = JStoJD(GPSHeader.end_sec, GPSHeader.end_us);
-    // Get ISO8601
     JDtoISO8601(GPSHeader.end_jd, iso8601);
-    // Add millisecond
     snprintf(ts, sizeof(ts), "%s.%03d", iso8601, static_cast<int>(GPSHeader.end_us / 1000.0));
     IUSaveText(&GPSDataEndT[GPS_DATA_END_TS], ts);
 
-    // Now Flag
-    GPSHeader.now_flag = gpsarray[33];
+    // Now
     snprintf(data, 64, "%u", GPSHeader.now_flag);
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_FLAG], data);
-
-    // Now Seconds
-    GPSHeader.now_sec = gpsarray[34] << 24 | gpsarray[35] << 16 | gpsarray[36] << 8 | gpsarray[37];
     snprintf(data, 64, "%u", GPSHeader.now_sec);
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_SEC], data);
-
-    // Now microseconds
-    GPSHeader.now_us = (gpsarray[38] << 16 | gpsarray[39] << 8 | gpsarray[40]) / 10.0;
     snprintf(data, 64, "%.1f", GPSHeader.now_us);
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_USEC], data);
-
-    // Now JD
-    GPSHeader.now_jd = JStoJD(GPSHeader.now_sec, GPSHeader.now_us);
-    // Get ISO8601
     JDtoISO8601(GPSHeader.now_jd, iso8601);
-    // Add millisecond
     snprintf(ts, sizeof(ts), "%s.%03d", iso8601, static_cast<int>(GPSHeader.now_us / 1000.0));
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_TS], ts);
 
-    // PPS
-    GPSHeader.max_clock = gpsarray[41] << 16 | gpsarray[42] << 8 | gpsarray[43];
-    snprintf(data, 64, "%u", GPSHeader.max_clock);
-    IUSaveText(&GPSDataHeaderT[GPS_DATA_MAX_CLOCK], data);
-
     IDSetText(&GPSDataHeaderTP, nullptr);
     IDSetText(&GPSDataStartTP, nullptr);
     IDSetText(&GPSDataEndTP, nullptr);
@@ -2796,14 +2808,6 @@ void QHYCCD::decodeGPSHeader()
     }
 }
 
-double QHYCCD::JStoJD(uint32_t JS, double us)
-{
-    // Convert Julian seconds (plus microsecond) to Julian Days since epoch 2450000
-    // Since this is why QHY apparently uses as the basis.
-    // The 0.5 is added there since JD starts from MID day of the previous day
-    return (JS + us / 1e6) / (3600 * 24) + 2450000.5;
-}
-
 void QHYCCD::JDtoISO8601(double JD, char *iso8601)
 {
     struct tm *tp = nullptr;
@@ -2814,3 +2818,58 @@ void QHYCCD::JDtoISO8601(double JD, char *iso8601)
     // Format it in ISO8601 format
     strftime(iso8601, MAXINDIDEVICE, "%Y-%m-%dT%H:%M:%S", tp);
 }
+
+void QHYCCD::journalGPSHeader()
+{
+    bool recording = GPSJournalS[INDI_ENABLED].s == ISS_ON && Streamer->isRecording();
+
+    if (recording && !m_GPSJournal.isOpen())
+    {
+        std::string path = getGPSJournalPath();
+        if (m_GPSJournal.open(path))
+            LOGF_INFO("Recording GPS timing journal to %s", path.c_str());
+        else
+        {
+            LOGF_WARN("Failed to create GPS journal %s: %s. Journal disabled.", path.c_str(), strerror(errno));
+            IUResetSwitch(&GPSJournalSP);
+            GPSJournalS[INDI_DISABLED].s = ISS_ON;
+            GPSJournalSP.s = IPS_ALERT;
+            IDSetSwitch(&GPSJournalSP, nullptr);
+        }
+    }
+    else if (!recording && m_GPSJournal.isOpen())
+    {
+        m_GPSJournal.close();
+        LOGF_INFO("GPS journal %s closed: %u frames, %u dropped.", m_GPSJournal.path().c_str(), m_GPSJournal.frames(),
+                  m_GPSJournal.dropped());
+    }
+
+    if (m_GPSJournal.isOpen())
+        m_GPSJournal.append(GPSHeader, GPSJournal::systemTime());
+}
+
+std::string QHYCCD::getGPSJournalPath()
+{
+    // Same directory and name as the stream recording, using the same placeholders
+    ITextVectorProperty *recordFileTP = getText("RECORD_FILE");
+    IText *dirT = recordFileTP ? IUFindText(recordFileTP, "RECORD_FILE_DIR") : nullptr;
+    IText *nameT = recordFileTP ? IUFindText(recordFileTP, "RECORD_FILE_NAME") : nullptr;
+    std::string path = std::string(dirT ? dirT->text : getenv("HOME")) + "/" +
+                       (nameT ? nameT->text : "indi_record__T_");
+
+    char date[32], hour[32], datetime[32];
+    time_t now = time(nullptr);
+    struct tm *tp = gmtime(&now);
+    strftime(date, sizeof(date), "%Y-%m-%d", tp);
+    strftime(hour, sizeof(hour), "%H-%M-%S", tp);
+    strftime(datetime, sizeof(datetime), "%Y-%m-%d@%H-%M-%S", tp);
+
+    const std::pair<const char *, const char *> patterns[] = { { "_D_", date }, { "_H_", hour }, { "_T_", datetime } };
+    for (const auto &pattern : patterns)
+    {
+        for (size_t pos = path.find(pattern.first); pos != std::string::npos; pos = path.find(pattern.first, pos))
+            path.replace(pos, 3, pattern.second);
+    }
+
+    return path + GPSJournal::EXTENSION;
+}
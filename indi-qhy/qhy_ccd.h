@@ -21,10 +21,13 @@
 
 #pragma once
 
+#include "qhy_gps_journal.h"
+
 #include <qhyccd.h>
 #include <indiccd.h>
 #include <indifilterinterface.h>
 #include <unistd.h>
+#include <chrono>
 #include <functional>
 #include <pthread.h>
 
@@ -262,6 +265,13 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
             GPS_DATA_NOW_TS,
         };
 
+        // GPS Data refresh rate while streaming
+        INumberVectorProperty GPSDataRateNP;
+        INumber GPSDataRateN[1];
+
+        // GPS timing journal of recordings
+        ISwitchVectorProperty GPSJournalSP;
+        ISwitch GPSJournalS[2];
 
     private:
         /////////////////////////////////////////////////////////////////////////////
@@ -295,48 +305,7 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
             GPS_LOCKED
         } GPSState;
 
-        struct
-        {
-            // Sequences
-            uint32_t seqNumber = 0;
-            uint32_t seqNumber_old = 0;
-            uint8_t tempNumber = 0;
-
-            // Dimension
-            uint16_t width = 0;
-            uint16_t height = 0;
-
-            // Location
-            uint32_t latitude = 0;
-            uint32_t longitude = 0;
-
-            // Start Time
-            uint8_t start_flag = 0;
-            uint32_t start_sec = 0;
-            double start_us = 0;
-            double start_jd = 0;
-            char start_js_ts[MAXINDIDEVICE] = {0};
-
-            // End Time
-            uint8_t end_flag = 0;
-            uint32_t end_sec = 0;
-            double end_us = 0;
-            double end_jd = 0;
-            char end_js_ts[MAXINDIDEVICE] = {0};
-
-            // Now time
-            uint8_t now_flag = 0;
-            uint32_t now_sec = 0;
-            double now_us = 0;
-            double now_jd = 0;
-            char now_js_ts[MAXINDIDEVICE] = {0};
-
-            // Clock
-            uint32_t max_clock = 0;
-
-            // GPS Status
-            GPSState gps_status = GPS_ON;
-        } GPSHeader;
+        QHYGPSHeader GPSHeader;
 
         struct
         {
@@ -379,15 +348,11 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         bool isQHY5PIIC();
         // Call when max filter count is known
         bool updateFilterProperties();
-        // Decode GPS Header
-        void decodeGPSHeader();
-        /**
-         * @brief JStoJD Convert Julian Second to Julian Date
-         * @param JS Julian Second
-         * @param us microsends
-         * @return Julian Date
-         */
-        double JStoJD(uint32_t JS, double us);
+        // Publish the decoded GPS Header
+        void updateGPSProperties();
+        // Append the decoded GPS Header to the journal of the current recording
+        void journalGPSHeader();
+        std::string getGPSJournalPath();
         void JDtoISO8601(double JD, char *iso8601);
 
         /////////////////////////////////////////////////////////////////////////////
@@ -432,6 +397,9 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         double m_LastGainRequest = 1e6;
         // Filter Wheel Timeout
         uint16_t m_FilterCheckCounter = 0;
+        // GPS timing journal, only used by the imaging thread
+        GPSJournal m_GPSJournal;
+        std::chrono::steady_clock::time_point m_GPSUpdateTime;
 
         /////////////////////////////////////////////////////////////////////////////
         /// Threading
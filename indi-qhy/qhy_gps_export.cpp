@@ -0,0 +1,88 @@
+/*
+ QHY GPS Journal Export
+
+ Prints the GPS timing journal written next to QHY stream recordings as CSV.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qhy_gps_journal.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// UTC timestamp with 0.1 us resolution of a GPS time
+static void GPStoISO8601(uint32_t sec, uint32_t ticks, char *iso8601, size_t size)
+{
+    time_t t = static_cast<time_t>(QHYGPSHeader::EPOCH) + sec;
+    char base[32];
+    struct tm *tp = gmtime(&t);
+    strftime(base, sizeof(base), "%Y-%m-%dT%H:%M:%S", tp);
+    snprintf(iso8601, size, "%s.%07u", base, ticks);
+}
+
+int main(int argc, char *argv[])
+{
+    GPSJournal::Header header;
+    std::vector<GPSJournal::Record> records;
+    FILE *out = stdout;
+    char start[64], end[64], now[64];
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s journal%s [output.csv]\n", argv[0], GPSJournal::EXTENSION);
+        return 1;
+    }
+
+    if (!GPSJournal::read(argv[1], header, records))
+    {
+        fprintf(stderr, "%s: not a valid GPS journal.\n", argv[1]);
+        return 1;
+    }
+
+    if (argc == 3 && (out = fopen(argv[2], "w")) == nullptr)
+    {
+        fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+
+    if (header.records == 0)
+        fprintf(stderr, "Warning: journal was not closed, %zu records found.\n", records.size());
+    else if (header.dropped > 0)
+        fprintf(stderr, "Warning: %u records were dropped while recording.\n", header.dropped);
+
+    fprintf(out, "frame,seq,start_flag,start_jd,start_utc,end_flag,end_jd,end_utc,now_flag,now_jd,now_utc,"
+            "exposure_ms,max_clock,system_time,system_offset_ms\n");
+    for (const GPSJournal::Record &record : records)
+    {
+        GPStoISO8601(record.startSec, record.startTicks, start, sizeof(start));
+        GPStoISO8601(record.endSec, record.endTicks, end, sizeof(end));
+        GPStoISO8601(record.nowSec, record.nowTicks, now, sizeof(now));
+        // Differences are computed in seconds, before any rounding to Julian Dates
+        double exposure = (static_cast<double>(record.endSec) - record.startSec) +
+                          (static_cast<double>(record.endTicks) - record.startTicks) / 1e7;
+        double offset = record.systemTime - (static_cast<double>(QHYGPSHeader::EPOCH) + record.nowSec + record.nowTicks / 1e7);
+        fprintf(out, "%u,%u,%u,%.8f,%s,%u,%.8f,%s,%u,%.8f,%s,%.4f,%u,%.6f,%.3f\n", record.frame, record.seqNumber,
+                record.startFlag, record.startJD(), start, record.endFlag, record.endJD(), end, record.nowFlag,
+                record.nowJD(), now, exposure * 1000.0, record.maxClock, record.systemTime, offset * 1000.0);
+    }
+
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ QHY GPS Timing Journal
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qhy_gps_journal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+
+static_assert(sizeof(GPSJournal::Header) == 32, "GPS journal header layout");
+static_assert(sizeof(GPSJournal::Record) == 48, "GPS journal record layout");
+
+// Writer thread period, the ring holds several seconds of frames at 1 kHz
+#define JOURNAL_WRITE_PERIOD_MS 20
+
+constexpr size_t QHYGPSHeader::SIZE;
+constexpr uint32_t QHYGPSHeader::EPOCH;
+constexpr const char *GPSJournal::MAGIC;
+constexpr uint32_t GPSJournal::VERSION;
+constexpr const char *GPSJournal::EXTENSION;
+
+void QHYGPSHeader::decode(const uint8_t *gpsarray)
+{
+    // Sequence Number
+    seqNumber = gpsarray[0] << 24 | gpsarray[1] << 16 | gpsarray[2] << 8 | gpsarray[3];
+    tempNumber = gpsarray[4];
+
+    // Width & Height
+    width = gpsarray[5] << 8 | gpsarray[6];
+    height = gpsarray[7] << 8 | gpsarray[8];
+
+    // Latitude & Longitude
+    latitude = gpsarray[9] << 24 | gpsarray[10] << 16 | gpsarray[11] << 8 | gpsarray[12];
+    longitude = gpsarray[13] << 24 | gpsarray[14] << 16 | gpsarray[15] << 8 | gpsarray[16];
+
+    // Start
+    start_flag = gpsarray[17];
+    start_sec = gpsarray[18] << 24 | gpsarray[19] << 16 | gpsarray[20] << 8 | gpsarray[21];
+    // It's a 10Mhz crystal so we divide by 10 to get microseconds
+    start_us = (gpsarray[22] << 16 | gpsarray[23] << 8 | gpsarray[24]) / 10.0;
+    start_jd = JStoJD(start_sec, start_us);
+
+    // End
+    end_flag = gpsarray[25];
+    end_sec = gpsarray[26] << 24 | gpsarray[27] << 16 | gpsarray[28] << 8 | gpsarray[29];
+    end_us = (gpsarray[30] << 16 | gpsarray[31] << 8 | gpsarray[32]) / 10.0;
+    end_jd = JStoJD(end_sec, end_us);
+
+    // Now
+    now_flag = gpsarray[33];
+    now_sec = gpsarray[34] << 24 | gpsarray[35] << 16 | gpsarray[36] << 8 | gpsarray[37];
+    now_us = (gpsarray[38] << 16 | gpsarray[39] << 8 | gpsarray[40]) / 10.0;
+    now_jd = JStoJD(now_sec, now_us);
+
+    // PPS
+    max_clock = gpsarray[41] << 16 | gpsarray[42] << 8 | gpsarray[43];
+}
+
+double QHYGPSHeader::JStoJD(uint32_t JS, double us)
+{
+    // Convert Julian seconds (plus microsecond) to Julian Days since epoch 2450000
+    // Since this is why QHY apparently uses as the basis.
+    // The 0.5 is added there since JD starts from MID day of the previous day
+    return (JS + us / 1e6) / (3600 * 24) + 2450000.5;
+}
+
+GPSJournal::GPSJournal(size_t capacity) : m_Ring(capacity)
+{
+}
+
+GPSJournal::~GPSJournal()
+{
+    close();
+}
+
+double GPSJournal::systemTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+bool GPSJournal::open(const std::string &path)
+{
+    Header header;
+
+    close();
+
+    m_File = fopen(path.c_str(), "wb");
+    if (m_File == nullptr)
+        return false;
+
+    m_Path = path;
+    m_Head = 0;
+    m_Tail = 0;
+    m_Dropped = 0;
+    m_Frame = 0;
+    m_Written = 0;
+    m_OpenTime = systemTime();
+
+    // Header is rewritten with the record count on close
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.recordSize = sizeof(Record);
+    header.openTime = m_OpenTime;
+    fwrite(&header, sizeof(header), 1, m_File);
+
+    m_Running = true;
+    m_Writer = std::thread(&GPSJournal::writerThread, this);
+    return true;
+}
+
+void GPSJournal::close()
+{
+    Header header;
+
+    if (m_File == nullptr)
+        return;
+
+    m_Running = false;
+    if (m_Writer.joinable())
+        m_Writer.join();
+    drain();
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.recordSize = sizeof(Record);
+    header.records = m_Written;
+    header.dropped = m_Dropped;
+    header.openTime = m_OpenTime;
+    fseek(m_File, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, m_File);
+
+    fclose(m_File);
+    m_File = nullptr;
+}
+
+bool GPSJournal::append(const QHYGPSHeader &header, double systemTime)
+{
+    uint32_t head = m_Head.load(std::memory_order_relaxed);
+    uint32_t frame = m_Frame++;
+
+    if (head - m_Tail.load(std::memory_order_acquire) >= m_Ring.size())
+    {
+        m_Dropped++;
+        return false;
+    }
+
+    Record &record = m_Ring[head % m_Ring.size()];
+    record.frame = frame;
+    record.seqNumber = header.seqNumber;
+    record.startFlag = header.start_flag;
+    record.endFlag = header.end_flag;
+    record.nowFlag = header.now_flag;
+    record.tempNumber = header.tempNumber;
+    record.maxClock = header.max_clock;
+    record.startSec = header.start_sec;
+    record.startTicks = lround(header.start_us * 10);
+    record.endSec = header.end_sec;
+    record.endTicks = lround(header.end_us * 10);
+    record.nowSec = header.now_sec;
+    record.nowTicks = lround(header.now_us * 10);
+    record.systemTime = systemTime;
+
+    m_Head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t GPSJournal::drain()
+{
+    uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+    uint32_t head = m_Head.load(std::memory_order_acquire);
+    size_t count = head - tail;
+
+    // Write the pending records in at most two contiguous chunks of the ring
+    while (tail != head)
+    {
+        size_t index = tail % m_Ring.size();
+        size_t chunk = std::min<size_t>(head - tail, m_Ring.size() - index);
+        fwrite(&m_Ring[index], sizeof(Record), chunk, m_File);
+        tail += chunk;
+        m_Tail.store(tail, std::memory_order_release);
+    }
+    m_Written += count;
+    return count;
+}
+
+void GPSJournal::writerThread()
+{
+    while (m_Running)
+    {
+        if (drain() > 0)
+            fflush(m_File);
+        std::this_thread::sleep_for(std::chrono::milliseconds(JOURNAL_WRITE_PERIOD_MS));
+    }
+}
+
+bool GPSJournal::read(const std::string &path, Header &header, std::vector<Record> &records)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    Record record;
+
+    records.clear();
+    if (fp == nullptr)
+        return false;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 || strncmp(header.magic, MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != VERSION || header.recordSize != sizeof(Record))
+    {
+        fclose(fp);
+        return false;
+    }
+
+    // Records of a journal that was not closed are still usable
+    while (fread(&record, sizeof(record), 1, fp) == 1)
+        records.push_back(record);
+    fclose(fp);
+
+    return header.records == 0 || header.records == records.size();
+}
@@ -0,0 +1,201 @@
+/*
+ QHY GPS Timing Journal
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief QHYGPSHeader holds the fields of the 64 bytes GPS header that GPS capable QHY
+ * cameras write at the start of every frame. Decoding is plain arithmetic so it can be
+ * done for every frame of a stream.
+ */
+struct QHYGPSHeader
+{
+    // Sequences
+    uint32_t seqNumber = 0;
+    uint8_t tempNumber = 0;
+
+    // Dimension
+    uint16_t width = 0;
+    uint16_t height = 0;
+
+    // Location
+    uint32_t latitude = 0;
+    uint32_t longitude = 0;
+
+    // Start Time
+    uint8_t start_flag = 0;
+    uint32_t start_sec = 0;
+    double start_us = 0;
+    double start_jd = 0;
+
+    // End Time
+    uint8_t end_flag = 0;
+    uint32_t end_sec = 0;
+    double end_us = 0;
+    double end_jd = 0;
+
+    // Now time
+    uint8_t now_flag = 0;
+    uint32_t now_sec = 0;
+    double now_us = 0;
+    double now_jd = 0;
+
+    // Clock
+    uint32_t max_clock = 0;
+
+    static constexpr size_t SIZE = 64;
+    // Seconds between JD 2440587.5 (1970) and JD 2450000.5, the origin of the GPS seconds
+    static constexpr uint32_t EPOCH = 813283200;
+
+    /** Decode the header found at the start of a frame buffer. */
+    void decode(const uint8_t *data);
+
+    /**
+     * @brief JStoJD Convert Julian Second to Julian Date
+     * @param JS Julian Second
+     * @param us microsends
+     * @return Julian Date
+     */
+    static double JStoJD(uint32_t JS, double us);
+};
+
+/**
+ * @brief GPSJournal writes the GPS timing of every frame of a recording to a binary file.
+ *
+ * The file starts with a Header followed by fixed size Records, in host byte order. GPS
+ * times are kept as the camera seconds and 10 MHz ticks, a double Julian Date would only
+ * resolve some 40 us.
+ *
+ * The capture thread appends records to a preallocated single producer / single consumer
+ * ring without taking any lock; a writer thread drains the ring to the file every few ms.
+ * When the writer falls behind by more than the ring capacity, records are dropped and
+ * counted.
+ */
+class GPSJournal
+{
+    public:
+        typedef struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t recordSize;
+            // Filled on close, 0 if the journal was not closed properly
+            uint32_t records;
+            uint32_t dropped;
+            // System clock when the journal was opened, seconds since 1970
+            double openTime;
+        } Header;
+
+        typedef struct Record
+        {
+            // Frame number in the recording, starting at 0
+            uint32_t frame;
+            // Camera sequence number
+            uint32_t seqNumber;
+            uint8_t startFlag;
+            uint8_t endFlag;
+            uint8_t nowFlag;
+            uint8_t tempNumber;
+            // PPS counter
+            uint32_t maxClock;
+            // Seconds since JD 2450000.5 and 10 MHz ticks
+            uint32_t startSec;
+            uint32_t startTicks;
+            uint32_t endSec;
+            uint32_t endTicks;
+            uint32_t nowSec;
+            uint32_t nowTicks;
+            // System clock when the frame was received, seconds since 1970
+            double systemTime;
+
+            double startJD() const
+            {
+                return QHYGPSHeader::JStoJD(startSec, startTicks / 10.0);
+            }
+            double endJD() const
+            {
+                return QHYGPSHeader::JStoJD(endSec, endTicks / 10.0);
+            }
+            double nowJD() const
+            {
+                return QHYGPSHeader::JStoJD(nowSec, nowTicks / 10.0);
+            }
+        } Record;
+
+        static constexpr const char *MAGIC = "QHYGPSJ";
+        static constexpr uint32_t VERSION = 1;
+        static constexpr const char *EXTENSION = ".gpsj";
+
+        explicit GPSJournal(size_t capacity = 8192);
+        ~GPSJournal();
+
+        bool open(const std::string &path);
+        void close();
+        bool isOpen() const
+        {
+            return m_File != nullptr;
+        }
+        const std::string &path() const
+        {
+            return m_Path;
+        }
+
+        /**
+         * @brief append Capture thread side, never blocks.
+         * @return false if the record was dropped because the ring is full.
+         */
+        bool append(const QHYGPSHeader &header, double systemTime);
+
+        uint32_t frames() const
+        {
+            return m_Frame;
+        }
+        uint32_t dropped() const
+        {
+            return m_Dropped.load();
+        }
+
+        /** System clock in seconds since 1970 */
+        static double systemTime();
+
+        /** Read a journal file, returns false if it is not a valid journal. */
+        static bool read(const std::string &path, Header &header, std::vector<Record> &records);
+
+    private:
+        void writerThread();
+        size_t drain();
+
+        std::vector<Record> m_Ring;
+        std::atomic<uint32_t> m_Head { 0 };
+        std::atomic<uint32_t> m_Tail { 0 };
+        std::atomic<uint32_t> m_Dropped { 0 };
+        std::atomic<bool> m_Running { false };
+        std::thread m_Writer;
+        FILE *m_File { nullptr };
+        std::string m_Path;
+        uint32_t m_Frame { 0 };
+        uint32_t m_Written { 0 };
+        double m_OpenTime { 0 };
+};
@@ -0,0 +1,202 @@
+/*
+ QHY GPS Journal Test
+
+ Replays synthetic GPS headers at 1 kHz through the header decoder and the timing
+ journal, as the streaming thread does, then reads the journal back and checks every
+ record. A second pass appends without pacing into a small ring to check that records
+ the writer could not keep up with are dropped and counted, never corrupted.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qhy_gps_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#define FRAME_RATE 1000
+// Seconds of the QHY epoch at the first frame
+#define FIRST_SECOND 800000000u
+
+static void put32(uint8_t *data, uint32_t value)
+{
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+}
+
+static void put24(uint8_t *data, uint32_t value)
+{
+    data[0] = value >> 16;
+    data[1] = value >> 8;
+    data[2] = value;
+}
+
+/* Header of frame i: 1 ms frames with a 0.8 ms exposure, timed by a 10 MHz clock */
+static void makeHeader(uint32_t i, uint8_t *data)
+{
+    uint32_t start = i * 10000, end = start + 8000, now = end + 500;
+
+    memset(data, 0, QHYGPSHeader::SIZE);
+    put32(data, i + 1);
+    data[4] = i % 256;
+    data[5] = 640 >> 8;
+    data[6] = 640 & 0xFF;
+    data[7] = 480 >> 8;
+    data[8] = 480 & 0xFF;
+    put32(data + 9, 45123456);
+    put32(data + 13, 7654321);
+    data[17] = 0x30;
+    put32(data + 18, FIRST_SECOND + start / 10000000);
+    put24(data + 22, start % 10000000);
+    data[25] = 0x30;
+    put32(data + 26, FIRST_SECOND + end / 10000000);
+    put24(data + 30, end % 10000000);
+    data[33] = 0x30;
+    put32(data + 34, FIRST_SECOND + now / 10000000);
+    put24(data + 38, now % 10000000);
+    put24(data + 41, 10000000 - 1);
+}
+
+static bool checkRecord(const GPSJournal::Record &record, uint32_t i)
+{
+    uint32_t start = i * 10000, end = start + 8000, now = end + 500;
+
+    return record.seqNumber == i + 1 && record.tempNumber == i % 256 && record.startFlag == 0x30 &&
+           record.endFlag == 0x30 && record.nowFlag == 0x30 && record.maxClock == 10000000 - 1 &&
+           record.startSec == FIRST_SECOND + start / 10000000 && record.startTicks == start % 10000000 &&
+           record.endSec == FIRST_SECOND + end / 10000000 && record.endTicks == end % 10000000 &&
+           record.nowSec == FIRST_SECOND + now / 10000000 && record.nowTicks == now % 10000000 &&
+           record.startJD() == QHYGPSHeader::JStoJD(FIRST_SECOND + start / 10000000, (start % 10000000) / 10.0);
+}
+
+static bool replay(const std::string &path, uint32_t frames)
+{
+    GPSJournal journal;
+    GPSJournal::Header header;
+    std::vector<GPSJournal::Record> records;
+    QHYGPSHeader gps;
+    uint8_t data[QHYGPSHeader::SIZE];
+    double total = 0, worst = 0;
+    uint32_t late = 0, errors = 0;
+
+    if (!journal.open(path))
+    {
+        fprintf(stderr, "Cannot create %s\n", path.c_str());
+        return false;
+    }
+
+    auto period = std::chrono::microseconds(1000000 / FRAME_RATE);
+    auto next = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        std::this_thread::sleep_until(next);
+        next += period;
+        if (std::chrono::steady_clock::now() > next)
+            late++;
+
+        makeHeader(i, data);
+        auto start = std::chrono::steady_clock::now();
+        gps.decode(data);
+        journal.append(gps, GPSJournal::systemTime());
+        double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        total += elapsed;
+        worst = std::max(worst, elapsed);
+
+        if (gps.width != 640 || gps.height != 480 || gps.latitude != 45123456 || gps.longitude != 7654321)
+            errors++;
+    }
+    journal.close();
+
+    if (!GPSJournal::read(path, header, records))
+    {
+        fprintf(stderr, "Cannot read back %s\n", path.c_str());
+        return false;
+    }
+    for (uint32_t i = 0; i < records.size(); i++)
+    {
+        if (records[i].frame != i || !checkRecord(records[i], i))
+            errors++;
+    }
+
+    printf("Replay: %u frames at %d Hz, %u late, decode + append %.2f us average, %.2f us worst\n", frames,
+           FRAME_RATE, late, total / frames, worst);
+    printf("        %zu records read back, %u dropped, %u errors\n", records.size(), header.dropped, errors);
+
+    return errors == 0 && header.dropped == 0 && header.records == frames && records.size() == frames;
+}
+
+static bool burst(const std::string &path, uint32_t frames)
+{
+    GPSJournal journal(64);
+    GPSJournal::Header header;
+    std::vector<GPSJournal::Record> records;
+    QHYGPSHeader gps;
+    uint8_t data[QHYGPSHeader::SIZE];
+    uint32_t errors = 0, previous = 0;
+
+    if (!journal.open(path))
+        return false;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        makeHeader(i, data);
+        gps.decode(data);
+        journal.append(gps, GPSJournal::systemTime());
+    }
+    journal.close();
+
+    if (!GPSJournal::read(path, header, records))
+        return false;
+    for (uint32_t i = 0; i < records.size(); i++)
+    {
+        // Frame numbers keep counting across drops
+        if ((i > 0 && records[i].frame <= previous) || !checkRecord(records[i], records[i].frame))
+            errors++;
+        previous = records[i].frame;
+    }
+
+    printf("Burst:  %u frames, %zu records, %u dropped, %u errors\n", frames, records.size(), header.dropped, errors);
+
+    return errors == 0 && records.size() + header.dropped == frames;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seconds = argc > 1 ? atoi(argv[1]) : 5;
+    char path[] = "/tmp/qhy_gps_journal_XXXXXX";
+    int fd = mkstemp(path);
+    bool success;
+
+    if (fd < 0 || seconds == 0)
+    {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+    close(fd);
+
+    success = replay(path, seconds * FRAME_RATE);
+    success = burst(path, 100000) && success;
+    unlink(path);
+
+    printf("%s\n", success ? "PASSED" : "FAILED");
+    return success ? 0 : 1;
+}
@@ -50,6 +50,7 @@ public:
     BroadcomPipeline() {}
     virtual void data_received(uint8_t  *data,  uint32_t length) override;
     virtual void reset();
+    virtual const char *name() const override { return "Broadcom"; }
     BroadcomHeader header;
 
 private:
@@ -128,8 +128,10 @@ void CameraControl::signal_data_received(uint8_t *data, uint32_t length)
         print_first = false;
     }
 
+    // The MMAL buffer is only borrowed, async stages copy what they need.
+    PipelineBuffer buffer(data, length);
     for(auto p : pipelines) {
-        p->data_received(data, length);
+        p->receive(buffer);
     }
 
 #ifndef NDEBUG
@@ -141,6 +143,14 @@ void CameraControl::signal_complete()
 {
     std::chrono::duration<double> diff = std::chrono::steady_clock::now() - start_time;
     LOGF_TEST("all buffers received after %f s", diff.count());
+
+    // Let async stages finish the image before anyone uses it.
+    for(auto p : pipelines) {
+        p->flush();
+    }
+
+    diff = std::chrono::steady_clock::now() - start_time;
+    LOGF_TEST("all buffers processed after %f s", diff.count());
     for(auto p : capture_listeners) {
         p->capture_complete();
     }
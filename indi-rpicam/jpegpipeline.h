@@ -53,6 +53,7 @@ public:
 
     virtual void data_received(uint8_t *data,  uint32_t length) override;
     virtual void reset() override;
+    virtual const char *name() const override { return "JPEG"; }
 
     State getState() { return state; }
 
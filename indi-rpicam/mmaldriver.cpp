@@ -23,6 +23,7 @@
  */
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/types.h>
@@ -274,6 +275,11 @@ bool MMALDriver::updateProperties()
         }
 #endif
         defineNumber(&mGainNP);
+
+        if (!mPipelineStatsN.empty())
+        {
+            defineNumber(&mPipelineStatsNP);
+        }
     }
     else
     {
@@ -285,6 +291,7 @@ bool MMALDriver::updateProperties()
 #endif
 
         deleteProperty(mGainNP.name);
+        deleteProperty(mPipelineStatsNP.name);
     }
 
     return true;
@@ -470,6 +477,8 @@ void MMALDriver::TimerHit()
             // Stop capturing (must be done from main thread).
             camera_control->stopCapture();
 
+            updatePipelineStatistics();
+
             // Let INDI::CCD know we're done filling the image buffer
             LOG_DEBUG("Exposure complete.");
             ExposureComplete(&PrimaryCCD);
@@ -616,4 +625,66 @@ void MMALDriver::setupPipeline()
         LOGF_WARN("%s: Unknown camera type: %s\n", __FUNCTION__, camera_control->get_camera()->getModel());
         return;
     }
+
+    // Only the JPEG skipping runs in the MMAL callback. Header parsing and bayer unpacking get their own
+    // threads, the first of them copies the MMAL buffers and the next one works on the same copy.
+    for (Pipeline *p = raw_pipe->next(); p != nullptr; p = p->next())
+    {
+        p->set_async(PIPELINE_QUEUE_DEPTH);
+    }
+
+    setupPipelineStatistics();
+}
+
+void MMALDriver::setupPipelineStatistics()
+{
+    static const struct
+    {
+        const char *suffix;
+        const char *label;
+        const char *format;
+    } fields[] = { { "MB", "MB", "%.2f" }, { "BUSY", "busy (ms)", "%.1f" }, { "LATENCY", "latency (ms)", "%.1f" } };
+
+    mPipelineStatsN.clear();
+    for (Pipeline *p = raw_pipe.get(); p != nullptr; p = p->next())
+    {
+        std::string stage = p->name();
+        std::string upper = stage;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+        for (const auto &field : fields)
+        {
+            INumber number;
+            IUFillNumber(&number, (upper + "_" + field.suffix).c_str(), (stage + " " + field.label).c_str(), field.format,
+                         0, 1e9, 0, 0);
+            mPipelineStatsN.push_back(number);
+        }
+    }
+
+    IUFillNumberVector(&mPipelineStatsNP, mPipelineStatsN.data(), mPipelineStatsN.size(), getDeviceName(),
+                       "CCD_PIPELINE_STATS", "Pipeline", IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+}
+
+void MMALDriver::updatePipelineStatistics()
+{
+    if (!raw_pipe || mPipelineStatsN.empty())
+    {
+        return;
+    }
+
+    size_t i = 0;
+    for (Pipeline *p = raw_pipe.get(); p != nullptr && i + 3 <= mPipelineStatsN.size(); p = p->next())
+    {
+        Pipeline::Statistics s = p->statistics();
+        mPipelineStatsN[i++].value = s.bytes / 1e6;
+        mPipelineStatsN[i++].value = s.busy_ms;
+        mPipelineStatsN[i++].value = s.max_latency_ms;
+
+        LOGF_DEBUG("Pipeline %s: %llu bytes in %llu buffers, busy %.1f ms, latency %.1f ms (max %.1f ms), max queued %u",
+                   p->name(), static_cast<unsigned long long>(s.bytes), static_cast<unsigned long long>(s.buffers),
+                   s.busy_ms, s.latency_ms, s.max_latency_ms, s.max_queued);
+    }
+
+    mPipelineStatsNP.s = IPS_OK;
+    IDSetNumber(&mPipelineStatsNP, nullptr);
 }
@@ -25,6 +25,7 @@
 #include <atomic>
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include "cameracontrol.h"
 #include "jpegpipeline.h"
 #include "broadcompipeline.h"
@@ -77,6 +78,10 @@ private:
   /** Setup the pipeline of buffer processors, depending of camera type. */
   void setupPipeline();
 
+  /** Build and update the per stage statistics property from the pipeline. */
+  void setupPipelineStatistics();
+  void updatePipelineStatistics();
+
   // Struct to keep timing
   struct timeval ExpStart { 0, 0 };
 
@@ -92,6 +97,13 @@ private:
   INumber mGainN[1];
   INumberVectorProperty mGainNP;
 
+  // Bytes, busy time and latency for every pipeline stage.
+  std::vector<INumber> mPipelineStatsN;
+  INumberVectorProperty mPipelineStatsNP;
+
+  // Buffers queued in front of each async pipeline stage.
+  static constexpr size_t PIPELINE_QUEUE_DEPTH = 16;
+
   std::unique_ptr<CameraControl> camera_control; // Controller object for the camera communication.
 
   std::unique_ptr<Pipeline> raw_pipe; // Start of pipeline that recieved raw data from camera.
@@ -18,6 +18,8 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include "pipeline.h"
 
@@ -28,6 +30,15 @@ Pipeline::Pipeline()
 
 Pipeline::~Pipeline()
 {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminate = true;
+        }
+        queue_cv.notify_all();
+        worker.join();
+    }
+
     // Cascade delete.
     if (nextPipeline) {
         delete nextPipeline;
@@ -43,20 +54,195 @@ void Pipeline::daisyChain(Pipeline *p)
     last->nextPipeline = p;
 }
 
+void Pipeline::set_async(size_t depth)
+{
+    if (worker.joinable()) {
+        return;
+    }
+
+    queue_depth = std::max<size_t>(1, depth);
+    worker = std::thread(&Pipeline::worker_loop, this);
+}
+
+void Pipeline::receive(const PipelineBuffer &buffer)
+{
+    if (!worker.joinable()) {
+        process(buffer);
+        return;
+    }
+
+    // Borrowed memory is only valid until we return, keep a copy.
+    PipelineBuffer queued = buffer;
+    if (!buffer.owned()) {
+        auto storage = acquire_storage(buffer.length());
+        memcpy(storage->data(), buffer.data(), buffer.length());
+        queued = PipelineBuffer(storage, buffer.length(), buffer.received());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_cv.wait(lock, [this] { return queue.size() < queue_depth || terminate; });
+    queue.push_back(std::move(queued));
+    if (queue.size() > stat_max_queued) {
+        stat_max_queued = queue.size();
+    }
+    queue_cv.notify_all();
+}
+
+/**
+ * Storage blocks are recycled once no buffer refers to them any more. Only the thread sending to
+ * this stage calls this, so the pool itself needs no locking.
+ */
+std::shared_ptr<PipelineBuffer::Storage> Pipeline::acquire_storage(uint32_t length)
+{
+    for (auto &storage : storage_pool) {
+        if (storage.use_count() == 1) {
+            if (storage->size() < length) {
+                storage->resize(length);
+            }
+            return storage;
+        }
+    }
+
+    storage_pool.push_back(std::make_shared<PipelineBuffer::Storage>(length));
+    return storage_pool.back();
+}
+
+void Pipeline::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        queue_cv.wait(lock, [this] { return terminate || !queue.empty(); });
+        if (terminate) {
+            return;
+        }
+
+        PipelineBuffer buffer = std::move(queue.front());
+        queue.pop_front();
+        processing = true;
+        queue_cv.notify_all();
+
+        // After an error the rest of the image is dropped until the pipeline is flushed.
+        if (!error) {
+            lock.unlock();
+            try {
+                process(buffer);
+            }
+            catch (...) {
+                lock.lock();
+                error = std::current_exception();
+                lock.unlock();
+            }
+            buffer = PipelineBuffer();
+            lock.lock();
+        }
+
+        processing = false;
+        queue_cv.notify_all();
+    }
+}
+
+void Pipeline::process(const PipelineBuffer &buffer)
+{
+    auto start = PipelineBuffer::Clock::now();
+    const PipelineBuffer *previous = current;
+    current = &buffer;
+    forward_time = PipelineBuffer::Clock::duration::zero();
+
+    try {
+        data_received(buffer.data(), buffer.length());
+    }
+    catch (...) {
+        current = previous;
+        throw;
+    }
+    current = previous;
+
+    auto end = PipelineBuffer::Clock::now();
+    uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(end - buffer.received()).count();
+
+    // Time spent in following synchronous stages is accounted there.
+    stat_busy_us += std::chrono::duration_cast<std::chrono::microseconds>(end - start - forward_time).count();
+    stat_bytes += buffer.length();
+    stat_buffers++;
+    stat_latency_us = latency;
+    if (latency > stat_max_latency_us) {
+        stat_max_latency_us = latency;
+    }
+}
+
 void Pipeline::forward(uint8_t *data,  uint32_t length)
 {
     if (nextPipeline == nullptr) {
         throw std::runtime_error("No next pipeline to forward bytes to.");
     }
 
-    nextPipeline->data_received(data, length);
+    auto start = PipelineBuffer::Clock::now();
+    if (current && current->contains(data, length)) {
+        nextPipeline->receive(current->slice(data, length));
+    }
+    else {
+        nextPipeline->receive(PipelineBuffer(data, length, current ? current->received() : start));
+    }
+    forward_time += PipelineBuffer::Clock::now() - start;
+}
+
+std::exception_ptr Pipeline::wait_idle()
+{
+    if (!worker.joinable()) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_cv.wait(lock, [this] { return queue.empty() && !processing; });
+
+    std::exception_ptr e = error;
+    error = nullptr;
+    return e;
+}
+
+void Pipeline::flush()
+{
+    std::exception_ptr e = wait_idle();
+    if (e) {
+        std::rethrow_exception(e);
+    }
+
+    if (nextPipeline) {
+        nextPipeline->flush();
+    }
 }
 
 void Pipeline::reset_pipe()
 {
     Pipeline *pipe = this;
     while(pipe != nullptr) {
+        // Anything left from an earlier, failed or aborted image is of no interest any more.
+        pipe->wait_idle();
         pipe->reset();
+        pipe->reset_statistics();
         pipe = pipe->nextPipeline;
     }
 }
+
+void Pipeline::reset_statistics()
+{
+    stat_bytes = 0;
+    stat_buffers = 0;
+    stat_busy_us = 0;
+    stat_latency_us = 0;
+    stat_max_latency_us = 0;
+    stat_max_queued = 0;
+}
+
+Pipeline::Statistics Pipeline::statistics() const
+{
+    Statistics s;
+    s.bytes = stat_bytes;
+    s.buffers = stat_buffers;
+    s.busy_ms = stat_busy_us / 1000.0;
+    s.latency_ms = stat_latency_us / 1000.0;
+    s.max_latency_ms = stat_max_latency_us / 1000.0;
+    s.max_queued = stat_max_queued;
+    return s;
+}
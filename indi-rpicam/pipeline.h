@@ -21,11 +21,42 @@
 #ifndef PIPELINE_H
 #define PIPELINE_H
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "pipelinebuffer.h"
+
+/**
+ * @brief The Pipeline class
+ * A stage of the chain that turns the buffers received from the camera into an image.
+ *
+ * Stages implement data_received() and pass their output on with forward(). By default a stage
+ * runs on the thread delivering the data. A stage made asynchronous with set_async() gets its own
+ * worker thread and a bounded queue, the sender blocks while the queue is full. Borrowed buffers
+ * are copied into recycled storage when they are queued, owned buffers are queued as they are.
+ *
+ * Every stage counts the bytes it receives, the time spent in data_received() and the latency from
+ * the moment a buffer entered the pipeline until the stage is done with it.
+ */
 class Pipeline
 {
 public:
+    struct Statistics
+    {
+        uint64_t bytes;
+        uint64_t buffers;
+        double busy_ms;         // Time spent in data_received().
+        double latency_ms;      // Latest buffer, from entering the pipeline until processed here.
+        double max_latency_ms;
+        uint32_t max_queued;    // Highest queue length seen by an async stage.
+    };
+
     Pipeline();
     virtual ~Pipeline();
 
@@ -38,9 +69,37 @@ public:
 
     /**
      * Cascading reset of whole pipeline.
+     *
+     * Waits for buffers still queued in async stages and clears the statistics first.
      */
     void reset_pipe();
 
+    /**
+     * Entry point for data, processes the buffer or queues it if this stage is async.
+     */
+    void receive(const PipelineBuffer &buffer);
+
+    /**
+     * Wait until this and all following stages have processed everything queued.
+     * Rethrows an exception raised by an async stage since the last flush.
+     */
+    void flush();
+
+    /**
+     * Run this stage on its own thread with a queue of at most depth buffers.
+     * Must be called before any data is received.
+     */
+    void set_async(size_t depth);
+    bool is_async() const { return worker.joinable(); }
+
+    /** Next stage in the chain, or nullptr. */
+    Pipeline *next() const { return nextPipeline; }
+
+    /** Short name of the stage, used in statistics. */
+    virtual const char *name() const { return "Pipeline"; }
+
+    Statistics statistics() const;
+
     virtual void data_received(uint8_t  *data,  uint32_t length) = 0;
 
     /**
@@ -55,7 +114,36 @@ protected:
     void forward(uint8_t *data,  uint32_t length);
 
 private:
+    void process(const PipelineBuffer &buffer);
+    void worker_loop();
+    std::exception_ptr wait_idle();
+    std::shared_ptr<PipelineBuffer::Storage> acquire_storage(uint32_t length);
+    void reset_statistics();
+
     Pipeline *nextPipeline {};
+
+    // Buffer being processed, forward() passes slices of it on.
+    const PipelineBuffer *current {nullptr};
+    PipelineBuffer::Clock::duration forward_time {};
+
+    // Async stage.
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queue_cv;
+    std::deque<PipelineBuffer> queue;
+    std::vector<std::shared_ptr<PipelineBuffer::Storage>> storage_pool;
+    size_t queue_depth {0};
+    bool processing {false};
+    bool terminate {false};
+    std::exception_ptr error;
+
+    // Statistics, written by the processing thread.
+    std::atomic<uint64_t> stat_bytes {0};
+    std::atomic<uint64_t> stat_buffers {0};
+    std::atomic<uint64_t> stat_busy_us {0};
+    std::atomic<uint64_t> stat_latency_us {0};
+    std::atomic<uint64_t> stat_max_latency_us {0};
+    std::atomic<uint32_t> stat_max_queued {0};
 };
 
 #endif // PIPELINE_H
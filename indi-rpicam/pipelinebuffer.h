@@ -0,0 +1,82 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PIPELINEBUFFER_H
+#define PIPELINEBUFFER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The PipelineBuffer class
+ * A range of bytes passed between pipeline stages.
+ *
+ * A buffer either borrows memory owned by someone else, like an MMAL buffer that is only valid
+ * during the callback, or shares ownership of a storage block. Slices of an owned buffer keep the
+ * storage alive, so a stage can hand parts of it to an asynchronous stage without copying.
+ */
+class PipelineBuffer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::vector<uint8_t> Storage;
+
+    PipelineBuffer() {}
+
+    /** Borrowed memory, must be copied before it is queued. */
+    PipelineBuffer(uint8_t *data, uint32_t length, Clock::time_point received = Clock::now())
+        : ptr(data), len(length), time(received) {}
+
+    /** Shares ownership of storage, which holds at least length bytes. */
+    PipelineBuffer(std::shared_ptr<Storage> storage, uint32_t length, Clock::time_point received)
+        : ptr(storage->data()), len(length), time(received), owner(std::move(storage)) {}
+
+    uint8_t *data() const { return ptr; }
+    uint32_t length() const { return len; }
+
+    /** Time the data entered the pipeline, used for latency statistics. */
+    Clock::time_point received() const { return time; }
+
+    /** True if the buffer keeps its memory alive and may be queued as is. */
+    bool owned() const { return owner != nullptr; }
+
+    /** True if [data, data + length) lies within this buffer. */
+    bool contains(const uint8_t *data, uint32_t length) const
+    {
+        return ptr != nullptr && data >= ptr && data + length <= ptr + len;
+    }
+
+    /** A part of this buffer, sharing its owner. */
+    PipelineBuffer slice(uint8_t *data, uint32_t length) const
+    {
+        PipelineBuffer b(*this);
+        b.ptr = data;
+        b.len = length;
+        return b;
+    }
+
+private:
+    uint8_t *ptr {nullptr};
+    uint32_t len {0};
+    Clock::time_point time {};
+    std::shared_ptr<Storage> owner {};
+};
+
+#endif // PIPELINEBUFFER_H
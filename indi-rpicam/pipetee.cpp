@@ -36,7 +36,7 @@ PipeTee::~PipeTee()
 
 void PipeTee::data_received(uint8_t *data,  uint32_t length)
 {
-    fwrite(&data, 1, length, fp);
+    fwrite(data, 1, length, fp);
     forward(data, length);
 }
 
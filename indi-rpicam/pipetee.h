@@ -31,6 +31,7 @@ public:
     virtual ~PipeTee();
     virtual void data_received(uint8_t *data,  uint32_t length) override;
     virtual void reset() override;
+    virtual const char *name() const override { return "Tee"; }
 
 private:
     FILE *fp {};
@@ -21,11 +21,7 @@
 #ifndef RAW12TOBAYER16PIPELINE_H
 #define RAW12TOBAYER16PIPELINE_H
 
-#include <cstddef>
-#include "pipeline.h"
-
-struct BroadcomPipeline;
-class ChipWrapper;
+#include "rawtobayer16pipeline.h"
 
 /**
  * @brief The Raw12ToBayer16Pipeline class
@@ -33,24 +29,14 @@ class ChipWrapper;
  * RAW12 format is like | {R03,R02,R01,R00,G11,G10,G09,G08} | {R11,R10,R09,R08,R07,R06,R05,R04} | {G07,G06,G05,G04,G03,G02,G01} |
  *                                   b1                                      b2                               b3
  * Odd lines are swapped R->G, G-B
+ *
+ * The 12 bits values are upshifted so bit 11 becomes bit 15.
  */
-class Raw12ToBayer16Pipeline : public Pipeline
+class Raw12ToBayer16Pipeline : public RawToBayer16Pipeline
 {
 public:
-    Raw12ToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd) : Pipeline(), bcm_pipe(bcm_pipe), ccd(ccd) {}
-
-    virtual void data_received(uint8_t *data,  uint32_t length) override;
-    virtual void reset() override;
-
-private:
-    const BroadcomPipeline *bcm_pipe;
-    ChipWrapper *ccd;
-    int x {0};
-    int y {0};
-    int raw_x {0}; //! Position in the raw-data comming in.
-    int raw_y {0}; //! Position in the raw-data comming in.
-    int startRawX {0};
-    uint8_t state = 0; //! Which byte in the RAW12 format (see above).
+    Raw12ToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd)
+        : RawToBayer16Pipeline(bcm_pipe, ccd, RawUnpacker::Format::RAW12) {}
 };
 
 #endif // RAW12TOBAYER16PIPELINE_H
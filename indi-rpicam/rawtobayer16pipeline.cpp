@@ -0,0 +1,131 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "rawtobayer16pipeline.h"
+#include "broadcompipeline.h"
+#include "chipwrapper.h"
+#include "inditest.h"
+
+RawToBayer16Pipeline::RawToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd, RawUnpacker::Format format)
+    : Pipeline(), bcm_pipe(bcm_pipe), ccd(ccd), unpacker(format)
+{
+}
+
+void RawToBayer16Pipeline::reset()
+{
+    // The frame geometry is picked up with the first buffer, the broadcom header is not parsed yet here.
+    bytes_consumed = 0;
+    raw_width = 0;
+}
+
+const char *RawToBayer16Pipeline::name() const
+{
+    return unpacker.format() == RawUnpacker::Format::RAW10 ? "Raw10" : "Raw12";
+}
+
+void RawToBayer16Pipeline::data_received(uint8_t *data,  uint32_t length)
+{
+    if (raw_width == 0) {
+        raw_width = bcm_pipe->header.omx_data.raw_width;
+        if (raw_width == 0) {
+            throw std::runtime_error("Raw row width missing in broadcom header.");
+        }
+
+        RawUnpacker::Format format = unpacker.format();
+        uint32_t subX = std::max(0, ccd->getSubX());
+        uint32_t subY = std::max(0, ccd->getSubY());
+        uint32_t subW = std::max(0, ccd->getSubW());
+        uint32_t subH = std::max(0, ccd->getSubH());
+        uint32_t xRes = std::max(0, ccd->getXRes());
+        uint32_t yRes = std::max(0, ccd->getYRes());
+
+        frame_buffer = reinterpret_cast<uint16_t *>(ccd->getFrameBuffer());
+        stride = subW;
+        first_row = subY;
+        first_pixel = subX;
+
+        // Stay within the sensor, the raw row and the frame buffer.
+        pixels = subX < xRes ? std::min(subW, xRes - subX) : 0;
+        while (pixels > 0 && RawUnpacker::row_bytes(format, first_pixel + pixels) > raw_width) {
+            pixels--;
+        }
+        uint32_t rows = subY < yRes ? std::min(subH, yRes - subY) : 0;
+        if (stride > 0) {
+            rows = std::min<uint32_t>(rows, ccd->getFrameBufferSize() / (stride * sizeof(uint16_t)));
+        }
+        end_row = first_row + rows;
+
+        if (row_buffer.size() < raw_width) {
+            row_buffer.resize(raw_width);
+        }
+
+        LOGF_TEST("raw_width=%u, rows %u-%u, pixels %u-%u, %u threads, %s", raw_width, first_row, end_row,
+                  first_pixel, first_pixel + pixels, unpacker.threads(), RawUnpacker::kernel_name());
+    }
+
+    while (length > 0) {
+        uint64_t row = bytes_consumed / raw_width;
+        uint32_t offset = bytes_consumed % raw_width;
+
+        // Beyond the subframe, nothing left to do for this image.
+        if (row >= end_row || pixels == 0) {
+            bytes_consumed += length;
+            return;
+        }
+
+        // Skip ahead to start of subframe.
+        if (row < first_row) {
+            uint32_t diff = std::min<uint64_t>(length, static_cast<uint64_t>(first_row) * raw_width - bytes_consumed);
+            data += diff;
+            length -= diff;
+            bytes_consumed += diff;
+            continue;
+        }
+
+        // Row split between buffers, collect it first.
+        if (offset != 0 || length < raw_width) {
+            uint32_t diff = std::min(length, raw_width - offset);
+            memcpy(row_buffer.data() + offset, data, diff);
+            data += diff;
+            length -= diff;
+            bytes_consumed += diff;
+
+            if (offset + diff == raw_width) {
+                unpack(row_buffer.data(), row, 1);
+            }
+            continue;
+        }
+
+        // Whole rows in this buffer, decode them in place.
+        uint32_t rows = std::min<uint64_t>(length / raw_width, end_row - row);
+        unpack(data, row, rows);
+        data += rows * raw_width;
+        length -= rows * raw_width;
+        bytes_consumed += static_cast<uint64_t>(rows) * raw_width;
+    }
+}
+
+void RawToBayer16Pipeline::unpack(const uint8_t *data, uint64_t row, uint32_t rows)
+{
+    uint16_t *dst = frame_buffer + static_cast<size_t>(row - first_row) * stride;
+    unpacker.unpack_rows(data, raw_width, dst, stride, rows, first_pixel, pixels);
+}
@@ -0,0 +1,65 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RAWTOBAYER16PIPELINE_H
+#define RAWTOBAYER16PIPELINE_H
+
+#include <cstddef>
+#include <vector>
+#include "pipeline.h"
+#include "rawunpacker.h"
+
+struct BroadcomPipeline;
+class ChipWrapper;
+
+/**
+ * @brief The RawToBayer16Pipeline class
+ * Common part of the RAW10 and RAW12 pipelines. Tracks the position in the raw stream,
+ * skips rows outside of the subframe and hands every complete row to the RawUnpacker.
+ *
+ * Rows that are fully contained in a received buffer are decoded in place, split across
+ * the unpacker threads. A row split between two buffers is collected in a row buffer first.
+ */
+class RawToBayer16Pipeline : public Pipeline
+{
+public:
+    RawToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd, RawUnpacker::Format format);
+
+    virtual void data_received(uint8_t *data,  uint32_t length) override;
+    virtual void reset() override;
+    virtual const char *name() const override;
+
+private:
+    void unpack(const uint8_t *data, uint64_t row, uint32_t rows);
+
+    const BroadcomPipeline *bcm_pipe;
+    ChipWrapper *ccd;
+    RawUnpacker unpacker;
+
+    uint64_t bytes_consumed {0};      //! Position in the raw-data comming in.
+    uint32_t raw_width {0};           //! Bytes per raw row, including padding.
+    uint32_t first_row {0};
+    uint32_t end_row {0};
+    uint32_t first_pixel {0};
+    uint32_t pixels {0};
+    uint32_t stride {0};              //! Pixels per row in the frame buffer.
+    uint16_t *frame_buffer {nullptr};
+    std::vector<uint8_t> row_buffer;  //! Row split between two buffers.
+};
+
+#endif // RAWTOBAYER16PIPELINE_H
@@ -0,0 +1,314 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "rawunpacker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RAWUNPACKER_SSSE3
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__NEON__)
+#define RAWUNPACKER_NEON
+#include <arm_neon.h>
+#endif
+
+// {{{ Scalar group decoders, also used for the partial groups at both ends of a row.
+static inline void decode_raw10_group(const uint8_t *s, uint16_t *p)
+{
+    uint8_t lo = s[4];
+    p[0] = static_cast<uint16_t>((s[0] << 8) | ((lo << 6) & 0xC0));
+    p[1] = static_cast<uint16_t>((s[1] << 8) | ((lo << 4) & 0xC0));
+    p[2] = static_cast<uint16_t>((s[2] << 8) | ((lo << 2) & 0xC0));
+    p[3] = static_cast<uint16_t>((s[3] << 8) | ((lo << 0) & 0xC0));
+}
+
+static inline void decode_raw12_group(const uint8_t *s, uint16_t *p)
+{
+    p[0] = static_cast<uint16_t>((s[0] << 8) | ((s[2] << 4) & 0xF0));
+    p[1] = static_cast<uint16_t>((s[1] << 8) | (s[2] & 0xF0));
+}
+
+static void raw10_groups_scalar(const uint8_t *src, uint16_t *dst, uint32_t groups)
+{
+    for (; groups; groups--, src += 5, dst += 4) {
+        decode_raw10_group(src, dst);
+    }
+}
+
+static void raw12_groups_scalar(const uint8_t *src, uint16_t *dst, uint32_t groups)
+{
+    for (; groups; groups--, src += 3, dst += 2) {
+        decode_raw12_group(src, dst);
+    }
+}
+// }}}
+
+#ifdef RAWUNPACKER_SSSE3
+// {{{ SSSE3: 8 pixels per iteration. PSHUFB places the high byte of every pixel in the upper half of
+// its 16 bits lane and the byte holding its low bits in the lower half. A per lane multiply then moves
+// the pixel's low bits to the top of the lower half, where they are masked out.
+__attribute__((target("ssse3")))
+static void raw10_groups_ssse3(const uint8_t *src, uint16_t *dst, uint32_t groups)
+{
+    const __m128i shuffle = _mm_setr_epi8(4, 0, 4, 1, 4, 2, 4, 3, 9, 5, 9, 6, 9, 7, 9, 8);
+    const __m128i shift = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+    const __m128i lowMask = _mm_set1_epi16(0x00C0);
+    const __m128i highMask = _mm_set1_epi16(static_cast<short>(0xFF00));
+    const __m128i byteMask = _mm_set1_epi16(0x00FF);
+
+    // Each iteration uses 10 bytes but loads 16, stay 4 groups away from the end.
+    for (; groups >= 4; groups -= 2, src += 10, dst += 8) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), shuffle);
+        __m128i lo = _mm_and_si128(_mm_mullo_epi16(_mm_and_si128(v, byteMask), shift), lowMask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(_mm_and_si128(v, highMask), lo));
+    }
+
+    raw10_groups_scalar(src, dst, groups);
+}
+
+__attribute__((target("ssse3")))
+static void raw12_groups_ssse3(const uint8_t *src, uint16_t *dst, uint32_t groups)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 0, 2, 1, 5, 3, 5, 4, 8, 6, 8, 7, 11, 9, 11, 10);
+    const __m128i shift = _mm_setr_epi16(16, 1, 16, 1, 16, 1, 16, 1);
+    const __m128i lowMask = _mm_set1_epi16(0x00F0);
+    const __m128i highMask = _mm_set1_epi16(static_cast<short>(0xFF00));
+    const __m128i byteMask = _mm_set1_epi16(0x00FF);
+
+    // Each iteration uses 12 bytes but loads 16, stay 6 groups away from the end.
+    for (; groups >= 6; groups -= 4, src += 12, dst += 8) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), shuffle);
+        __m128i lo = _mm_and_si128(_mm_mullo_epi16(_mm_and_si128(v, byteMask), shift), lowMask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(_mm_and_si128(v, highMask), lo));
+    }
+
+    raw12_groups_scalar(src, dst, groups);
+}
+// }}}
+#endif
+
+#ifdef RAWUNPACKER_NEON
+// {{{ NEON
+static void raw10_groups_neon(const uint8_t *src, uint16_t *dst, uint32_t groups)
+{
+    static const uint8_t index[16] = {4, 0, 4, 1, 4, 2, 4, 3, 9, 5, 9, 6, 9, 7, 9, 8};
+    static const int16_t shifts[8] = {6, 4, 2, 0, 6, 4, 2, 0};
+    const uint8x8_t indexLow = vld1_u8(index);
+    const uint8x8_t indexHigh = vld1_u8(index + 8);
+    const int16x8_t shift = vld1q_s16(shifts);
+    const uint16x8_t lowMask = vdupq_n_u16(0x00C0);
+    const uint16x8_t highMask = vdupq_n_u16(0xFF00);
+    const uint16x8_t byteMask = vdupq_n_u16(0x00FF);
+
+    // Each iteration uses 10 bytes but loads 16, stay 4 groups away from the end.
+    for (; groups >= 4; groups -= 2, src += 10, dst += 8) {
+        uint8x8x2_t table;
+        table.val[0] = vld1_u8(src);
+        table.val[1] = vld1_u8(src + 8);
+        uint16x8_t v = vreinterpretq_u16_u8(vcombine_u8(vtbl2_u8(table, indexLow), vtbl2_u8(table, indexHigh)));
+        uint16x8_t lo = vandq_u16(vshlq_u16(vandq_u16(v, byteMask), shift), lowMask);
+        vst1q_u16(dst, vorrq_u16(vandq_u16(v, highMask), lo));
+    }
+
+    raw10_groups_scalar(src, dst, groups);
+}
+
+static void raw12_groups_neon(const uint8_t *src, uint16_t *dst, uint32_t groups)
+{
+    const uint8x8_t highNibble = vdup_n_u8(0xF0);
+
+    // 8 groups (16 pixels) per iteration, de-interleaved by the load.
+    for (; groups >= 8; groups -= 8, src += 24, dst += 16) {
+        uint8x8x3_t in = vld3_u8(src);
+        uint16x8x2_t out;
+        out.val[0] = vorrq_u16(vshll_n_u8(in.val[0], 8), vmovl_u8(vshl_n_u8(in.val[2], 4)));
+        out.val[1] = vorrq_u16(vshll_n_u8(in.val[1], 8), vmovl_u8(vand_u8(in.val[2], highNibble)));
+        vst2q_u16(dst, out);
+    }
+
+    raw12_groups_scalar(src, dst, groups);
+}
+// }}}
+#endif
+
+namespace
+{
+typedef void (*GroupsKernel)(const uint8_t *src, uint16_t *dst, uint32_t groups);
+
+struct Kernels
+{
+    GroupsKernel raw10;
+    GroupsKernel raw12;
+    const char *name;
+};
+
+Kernels select_kernels()
+{
+#if defined(RAWUNPACKER_SSSE3)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        return { raw10_groups_ssse3, raw12_groups_ssse3, "SSSE3" };
+    }
+#elif defined(RAWUNPACKER_NEON)
+    return { raw10_groups_neon, raw12_groups_neon, "NEON" };
+#endif
+    return { raw10_groups_scalar, raw12_groups_scalar, "Scalar" };
+}
+
+const Kernels &kernels()
+{
+    static const Kernels selected = select_kernels();
+    return selected;
+}
+}
+
+RawUnpacker::RawUnpacker(Format format, unsigned int threads) : fmt(format)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int slice = 1; slice < threads; slice++) {
+        workers.emplace_back(&RawUnpacker::worker_loop, this, slice);
+    }
+}
+
+RawUnpacker::~RawUnpacker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminate = true;
+    }
+    start_cv.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+uint32_t RawUnpacker::row_bytes(Format format, uint32_t pixels)
+{
+    if (format == Format::RAW10) {
+        return (pixels + 3) / 4 * 5;
+    }
+    return (pixels + 1) / 2 * 3;
+}
+
+const char *RawUnpacker::kernel_name()
+{
+    return kernels().name;
+}
+
+void RawUnpacker::unpack_row(Format format, const uint8_t *src, uint16_t *dst, uint32_t firstPixel, uint32_t pixels)
+{
+    const bool raw10 = format == Format::RAW10;
+    const uint32_t groupPixels = raw10 ? 4 : 2;
+    const uint32_t groupBytes = raw10 ? 5 : 3;
+    auto decode_group = raw10 ? decode_raw10_group : decode_raw12_group;
+    uint16_t group[4];
+
+    src += (firstPixel / groupPixels) * groupBytes;
+
+    // Subframe starting inside a group.
+    uint32_t skip = firstPixel % groupPixels;
+    if (skip && pixels) {
+        uint32_t n = std::min(groupPixels - skip, pixels);
+        decode_group(src, group);
+        memcpy(dst, group + skip, n * sizeof(uint16_t));
+        src += groupBytes;
+        dst += n;
+        pixels -= n;
+    }
+
+    uint32_t groups = pixels / groupPixels;
+    (raw10 ? kernels().raw10 : kernels().raw12)(src, dst, groups);
+    src += groups * groupBytes;
+    dst += groups * groupPixels;
+    pixels -= groups * groupPixels;
+
+    // Subframe ending inside a group.
+    if (pixels) {
+        decode_group(src, group);
+        memcpy(dst, group, pixels * sizeof(uint16_t));
+    }
+}
+
+void RawUnpacker::unpack_rows(const uint8_t *src, uint32_t srcStride, uint16_t *dst, uint32_t dstStride, uint32_t rows,
+                              uint32_t firstPixel, uint32_t pixels)
+{
+    unsigned int slices = std::min<unsigned int>(threads(), std::max<uint32_t>(1, rows / MIN_ROWS_PER_THREAD));
+    Job current = { src, srcStride, dst, dstStride, rows, firstPixel, pixels, slices };
+
+    if (slices <= 1) {
+        run_slice(current, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = current;
+        busy = slices - 1;
+        generation++;
+    }
+    start_cv.notify_all();
+
+    run_slice(current, 0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return busy == 0; });
+}
+
+void RawUnpacker::run_slice(const Job &job, unsigned int slice) const
+{
+    uint32_t begin = static_cast<uint64_t>(job.rows) * slice / job.slices;
+    uint32_t end = static_cast<uint64_t>(job.rows) * (slice + 1) / job.slices;
+
+    for (uint32_t row = begin; row < end; row++) {
+        unpack_row(fmt, job.src + static_cast<size_t>(row) * job.srcStride,
+                   job.dst + static_cast<size_t>(row) * job.dstStride, job.firstPixel, job.pixels);
+    }
+}
+
+void RawUnpacker::worker_loop(unsigned int slice)
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        start_cv.wait(lock, [&] { return terminate || generation != seen; });
+        if (terminate) {
+            return;
+        }
+
+        seen = generation;
+        if (slice >= job.slices) {
+            continue;
+        }
+
+        Job current = job;
+        lock.unlock();
+        run_slice(current, slice);
+        lock.lock();
+
+        if (--busy == 0) {
+            done_cv.notify_one();
+        }
+    }
+}
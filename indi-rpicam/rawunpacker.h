@@ -0,0 +1,116 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RAWUNPACKER_H
+#define RAWUNPACKER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The RawUnpacker class
+ * Converts rows of packed Broadcom RAW10 / RAW12 data into 16 bits bayer pixels, upshifted so
+ * the most significant bit of the sample is bit 15.
+ *
+ * RAW10 packs 4 pixels in 5 bytes: | P0h | P1h | P2h | P3h | P3l P2l P1l P0l |
+ * RAW12 packs 2 pixels in 3 bytes: | P0h | P1h | P1l P0l |
+ *
+ * Rows are decoded a whole group at a time using SSSE3 or NEON when available. Any first pixel
+ * is accepted, a partial group at the start or end of a subframe is decoded and trimmed.
+ *
+ * unpack_rows() splits the rows between a fixed set of worker threads created up front, so
+ * no memory is allocated while a frame is received.
+ */
+class RawUnpacker
+{
+public:
+    enum class Format {
+        RAW10,
+        RAW12
+    };
+
+    /**
+     * @param threads number of threads used by unpack_rows(), including the calling thread.
+     * 0 selects one per CPU core.
+     */
+    explicit RawUnpacker(Format format, unsigned int threads = 0);
+    ~RawUnpacker();
+
+    RawUnpacker(const RawUnpacker &) = delete;
+    RawUnpacker &operator=(const RawUnpacker &) = delete;
+
+    /**
+     * @brief unpack_row Decode pixels [firstPixel, firstPixel + pixels) of a single raw row.
+     * @param src start of the raw row.
+     * @param dst destination for pixels 16 bits values.
+     */
+    static void unpack_row(Format format, const uint8_t *src, uint16_t *dst, uint32_t firstPixel, uint32_t pixels);
+
+    /**
+     * @brief unpack_rows Decode the same pixel range of several consecutive rows, using all threads.
+     * @param src start of the first raw row.
+     * @param srcStride bytes between raw rows.
+     * @param dst start of the first destination row.
+     * @param dstStride pixels between destination rows.
+     */
+    void unpack_rows(const uint8_t *src, uint32_t srcStride, uint16_t *dst, uint32_t dstStride, uint32_t rows,
+                     uint32_t firstPixel, uint32_t pixels);
+
+    /** Bytes used by a RAW row containing the given number of pixels. */
+    static uint32_t row_bytes(Format format, uint32_t pixels);
+
+    Format format() const { return fmt; }
+    unsigned int threads() const { return workers.size() + 1; }
+
+    /** @return name of the selected row kernel, e.g. "SSSE3". */
+    static const char *kernel_name();
+
+    /** Rows are not split between threads below this many rows per thread. */
+    static constexpr uint32_t MIN_ROWS_PER_THREAD = 16;
+
+private:
+    struct Job
+    {
+        const uint8_t *src;
+        uint32_t srcStride;
+        uint16_t *dst;
+        uint32_t dstStride;
+        uint32_t rows;
+        uint32_t firstPixel;
+        uint32_t pixels;
+        unsigned int slices;
+    };
+
+    void run_slice(const Job &job, unsigned int slice) const;
+    void worker_loop(unsigned int slice);
+
+    Format fmt;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    Job job {};
+    uint64_t generation {0};
+    unsigned int busy {0};
+    bool terminate {false};
+};
+
+#endif // RAWUNPACKER_H
@@ -0,0 +1,289 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+
+ Replays a raw capture through the JPEG, broadcom and raw10/raw12 pipelines the
+ same way MMAL delivers it, synchronously and with async stages, checks the
+ result against a per pixel reference decoder and reports timings. Runs on any
+ machine, no camera needed.
+
+ Usage: raw_unpack_benchmark [capture.raw|imx477|imx219] [subX subY subW subH] [buffer size] [iterations]
+
+ The capture is the file written by "raspistill --raw" (JPEG followed by the
+ @BRCMo header and the raw data). With "imx477" (default) or "imx219" a RAW12
+ or RAW10 capture of that sensor size is synthesized.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <jpegpipeline.h>
+#include <broadcompipeline.h>
+#include <raw10tobayer16pipeline.h>
+#include <raw12tobayer16pipeline.h>
+#include <rawunpacker.h>
+#include <chipwrapper.h>
+
+// Size of the @BRCMo block in front of the raw data.
+static const size_t BRCM_BLOCK_SIZE = 32768;
+
+// {{{ MockCCD: frame buffer and subframe, like in the camera tests.
+class MockCCD : public ChipWrapper
+{
+public:
+    MockCCD(int width, int height, int x, int y, int w, int h)
+        : width(width), height(height), subx(x), suby(y), subw(w), subh(h), frameBuffer(w * h * 2) {}
+
+    virtual int getFrameBufferSize() override { return frameBuffer.size(); }
+    virtual uint8_t* getFrameBuffer() override { return frameBuffer.data(); }
+    virtual int getSubX() override { return subx; }
+    virtual int getSubY() override { return suby; }
+    virtual int getSubW() override { return subw; }
+    virtual int getSubH() override { return subh; }
+    virtual int getXRes() override { return width; }
+    virtual int getYRes() override { return height; }
+
+private:
+    int width, height;
+    int subx, suby, subw, subh;
+    std::vector<uint8_t> frameBuffer;
+};
+// }}}
+
+// {{{ Reference decoder, one pixel at a time.
+static uint16_t reference_pixel(RawUnpacker::Format format, const uint8_t *row, uint32_t x)
+{
+    if (format == RawUnpacker::Format::RAW10) {
+        const uint8_t *group = row + (x / 4) * 5;
+        uint32_t low = (group[4] >> (2 * (x % 4))) & 0x03;
+        return static_cast<uint16_t>(((group[x % 4] << 2) | low) << 6);
+    }
+
+    const uint8_t *group = row + (x / 2) * 3;
+    uint32_t low = (x % 2) ? group[2] >> 4 : group[2] & 0x0F;
+    return static_cast<uint16_t>(((group[x % 2] << 4) | low) << 4);
+}
+
+static void reference_decode(RawUnpacker::Format format, const uint8_t *raw, uint32_t rawWidth, MockCCD &ccd,
+                             std::vector<uint16_t> &out)
+{
+    out.assign(ccd.getSubW() * ccd.getSubH(), 0);
+    for (int y = 0; y < ccd.getSubH(); y++) {
+        const uint8_t *row = raw + static_cast<size_t>(ccd.getSubY() + y) * rawWidth;
+        for (int x = 0; x < ccd.getSubW(); x++) {
+            out[y * ccd.getSubW() + x] = reference_pixel(format, row, ccd.getSubX() + x);
+        }
+    }
+}
+// }}}
+
+// {{{ Synthetic capture: minimal JPEG, @BRCMo block and random raw rows.
+static std::vector<uint8_t> synthesize_capture(uint16_t width, uint16_t height, uint16_t rawWidth)
+{
+    std::vector<uint8_t> capture = { 0xFF, 0xD8, 0xFF, 0xD9 };
+    size_t brcm = capture.size();
+    capture.resize(brcm + BRCM_BLOCK_SIZE + static_cast<size_t>(rawWidth) * height);
+
+    BroadcomHeader header {};
+    header.omx_data.raw_width = rawWidth;
+    header.omx_data.width = width;
+    header.omx_data.height = height;
+    memcpy(&capture[brcm], "BRCMo", 5);
+    memcpy(&capture[brcm + 8], &header.omx_data, sizeof header.omx_data);
+
+    for (size_t i = brcm + BRCM_BLOCK_SIZE; i < capture.size(); i++) {
+        capture[i] = static_cast<uint8_t>(rand());
+    }
+    return capture;
+}
+// }}}
+
+template <typename Function>
+static double time_ms(int iterations, Function f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint8_t> capture;
+
+    if (argc < 2 || strcmp(argv[1], "imx477") == 0) {
+        capture = synthesize_capture(4056, 3040, 6112);
+    }
+    else if (strcmp(argv[1], "imx219") == 0) {
+        capture = synthesize_capture(3280, 2464, 4128);
+    }
+    else {
+        std::ifstream in(argv[1], std::ios::binary);
+        if (!in) {
+            fprintf(stderr, "Cannot open %s\n", argv[1]);
+            return 1;
+        }
+        capture.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Locate the broadcom header to learn the geometry.
+    static const char brcmo[] = "BRCMo";
+    auto brcm = std::search(capture.begin(), capture.end(), brcmo, brcmo + 5);
+    if (brcm == capture.end() || static_cast<size_t>(capture.end() - brcm) < BRCM_BLOCK_SIZE) {
+        fprintf(stderr, "No @BRCMo header found in capture.\n");
+        return 1;
+    }
+
+    BroadcomHeader header {};
+    memcpy(&header.omx_data, &*brcm + 8, sizeof header.omx_data);
+    const uint8_t *raw = &*brcm + BRCM_BLOCK_SIZE;
+    uint32_t rawWidth = header.omx_data.raw_width;
+    uint32_t width = header.omx_data.width;
+    uint32_t height = std::min<uint32_t>(header.omx_data.height, (capture.data() + capture.size() - raw) / rawWidth);
+    RawUnpacker::Format format = rawWidth >= width * 3 / 2 ? RawUnpacker::Format::RAW12 : RawUnpacker::Format::RAW10;
+
+    int subX = argc > 5 ? atoi(argv[2]) : 0;
+    int subY = argc > 5 ? atoi(argv[3]) : 0;
+    int subW = argc > 5 ? atoi(argv[4]) : width;
+    int subH = argc > 5 ? atoi(argv[5]) : height;
+    uint32_t bufferSize = argc > 6 ? atoi(argv[6]) : 81920;
+    int iterations = argc > 7 ? atoi(argv[7]) : 5;
+
+    if (subW <= 0 || subH <= 0 || subX + subW > static_cast<int>(width) || subY + subH > static_cast<int>(height) ||
+            bufferSize == 0 || iterations <= 0) {
+        fprintf(stderr, "Usage: %s [capture.raw|imx477|imx219] [subX subY subW subH] [buffer size] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%s %ux%u (raw width %u), subframe %d,%d %dx%d, %u bytes buffers, %s kernels\n",
+           format == RawUnpacker::Format::RAW10 ? "RAW10" : "RAW12", width, height, rawWidth, subX, subY, subW, subH,
+           bufferSize, RawUnpacker::kernel_name());
+
+    MockCCD ccd(width, height, subX, subY, subW, subH);
+
+    JpegPipeline jpeg_pipe;
+    BroadcomPipeline *brcm_pipe = new BroadcomPipeline();
+    jpeg_pipe.daisyChain(brcm_pipe);
+    RawToBayer16Pipeline *raw_pipe;
+    if (format == RawUnpacker::Format::RAW10) {
+        raw_pipe = new Raw10ToBayer16Pipeline(brcm_pipe, &ccd);
+    }
+    else {
+        raw_pipe = new Raw12ToBayer16Pipeline(brcm_pipe, &ccd);
+    }
+    brcm_pipe->daisyChain(raw_pipe);
+
+    // Feed the capture in MMAL sized buffers, borrowed like in the MMAL callback.
+    auto replay = [&]() {
+        jpeg_pipe.reset_pipe();
+        for (size_t pos = 0; pos < capture.size(); pos += bufferSize) {
+            uint32_t length = std::min<size_t>(bufferSize, capture.size() - pos);
+            jpeg_pipe.receive(PipelineBuffer(capture.data() + pos, length));
+        }
+        jpeg_pipe.flush();
+    };
+
+    std::vector<uint16_t> expected;
+    double reference = time_ms(1, [&]() {
+        reference_decode(format, raw, rawWidth, ccd, expected);
+    });
+
+    auto matches_reference = [&]() {
+        memset(ccd.getFrameBuffer(), 0, ccd.getFrameBufferSize());
+        replay();
+
+        const uint16_t *actual = reinterpret_cast<const uint16_t *>(ccd.getFrameBuffer());
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (actual[i] != expected[i]) {
+                fprintf(stderr, "Mismatch at x=%zu y=%zu: %04x, expected %04x\n", i % subW, i / subW, actual[i],
+                        expected[i]);
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (!matches_reference()) {
+        return 1;
+    }
+    printf("Pipeline output matches reference decoder.\n");
+
+    // Every subframe start and width within a couple of groups, one and all threads.
+    RawUnpacker single(format, 1);
+    // At least 4 threads, so the row split is exercised on small machines too.
+    RawUnpacker multi(format, std::max(4u, std::thread::hardware_concurrency()));
+    std::vector<uint16_t> rows(64 * 64), check(64 * 64);
+    for (uint32_t first = 0; first < 8; first++) {
+        for (uint32_t pixels = 0; pixels <= 40; pixels++) {
+            single.unpack_rows(raw, rawWidth, rows.data(), 64, 4, first, pixels);
+            for (uint32_t y = 0; y < 4; y++) {
+                for (uint32_t x = 0; x < pixels; x++) {
+                    if (rows[y * 64 + x] != reference_pixel(format, raw + y * rawWidth, first + x)) {
+                        fprintf(stderr, "Mismatch for first pixel %u, %u pixels\n", first, pixels);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    multi.unpack_rows(raw, rawWidth, rows.data(), 64, 64, 3, 61);
+    single.unpack_rows(raw, rawWidth, check.data(), 64, 64, 3, 61);
+    if (rows != check) {
+        fprintf(stderr, "Multi threaded output differs\n");
+        return 1;
+    }
+    printf("Unaligned subframes match reference decoder.\n");
+
+    std::vector<uint16_t> frame(static_cast<size_t>(subW) * subH);
+    double pipeline = time_ms(iterations, replay);
+    double one = time_ms(iterations, [&]() {
+        single.unpack_rows(raw + subY * rawWidth, rawWidth, frame.data(), subW, subH, subX, subW);
+    });
+    double all = time_ms(iterations, [&]() {
+        multi.unpack_rows(raw + subY * rawWidth, rawWidth, frame.data(), subW, subH, subX, subW);
+    });
+
+    printf("Reference decoder:       %8.2f ms\n", reference);
+    printf("Unpacker, 1 thread:      %8.2f ms\n", one);
+    printf("Unpacker, %2u threads:    %8.2f ms\n", multi.threads(), all);
+    printf("Pipeline replay:         %8.2f ms (%.1f MB/s)\n", pipeline, capture.size() / pipeline / 1000.0);
+
+    // Same again with the broadcom and raw stages on their own threads, as in the driver.
+    brcm_pipe->set_async(16);
+    raw_pipe->set_async(16);
+    if (!matches_reference()) {
+        return 1;
+    }
+    double async = time_ms(iterations, replay);
+    printf("Async pipeline replay:   %8.2f ms (%.1f MB/s)\n", async, capture.size() / async / 1000.0);
+
+    for (Pipeline *p = &jpeg_pipe; p != nullptr; p = p->next()) {
+        Pipeline::Statistics st = p->statistics();
+        printf("  %-8s %10llu bytes %6llu buffers, busy %8.2f ms, latency %8.2f ms, max queued %u\n", p->name(),
+               static_cast<unsigned long long>(st.bytes), static_cast<unsigned long long>(st.buffers), st.busy_ms,
+               st.max_latency_ms, st.max_queued);
+    }
+
+    return 0;
+}
@@ -28,6 +28,8 @@
 #include <termios.h>
 #include <indilogger.h>
 #include <memory>
+#include <vector>
+#include <algorithm>
 #include <indicom.h>
 
 #define min(a, b)               \
@@ -41,6 +43,11 @@
 #define MIN_FRAME_SIZE (512)
 #define MAX_FRAME_SIZE (SUBFRAME_SIZE * 16)
 #define SPECTRUM_SIZE  (256)
+#define TOTAL_POWER_POINTS (4096)
+#define IQ_SAMPLE_SIZE (2)
+// 256 blocks of 6.8 ms at 2.4 MS/s, about 1.7 s of samples while processing or BLOB encoding runs
+#define RING_BLOCK_SIZE (SUBFRAME_SIZE * 2)
+#define RING_BLOCKS    (256)
 
 static int iNumofConnectedSpectrographs;
 static RTLSDR **receivers;
@@ -58,36 +65,120 @@ static void cleanup()
     }
 }
 
+/**************************************************************************************
+** Processing thread: integrate the blocks queued by the acquisition thread
+***************************************************************************************/
 void RTLSDR::Callback()
 {
-    b_read  = 0;
-    to_read = getSampleRate() * IntegrationRequest * getBPS() / 8;
-    setBufferSize(to_read);
-
-    int len            = min(MAX_FRAME_SIZE, to_read);
-    int olen           = 0;
-    unsigned char *buf = (unsigned char *)malloc(len);
-    if((getSensorConnection() & CONNECTION_TCP) == 0)
-        rtlsdr_reset_buffer(rtl_dev);
-    else
-        tcflush(PortFD, TCOFLUSH);
-    setIntegrationTime(IntegrationRequest);
-    while (InIntegration)
+    while (!terminateThread)
     {
-        if((getSensorConnection() & CONNECTION_TCP) == 0)
-            rtlsdr_read_sync(rtl_dev, buf, len, &olen);
-        else
-            olen = read(PortFD, buf, len);
-        if(olen < 0 )
-            AbortIntegration();
-        else {
-            buffer = buf;
-            n_read = olen;
+        SDRBlockRing::Block *block = ring.acquireRead(std::chrono::milliseconds(100));
+        if (block == nullptr)
+        {
+            if (InIntegration && !terminateThread)
+                ring.countUnderrun();
+            continue;
+        }
+
+        if (flushRing.exchange(false))
+        {
+            ring.releaseRead();
+            ring.clear();
+            continue;
+        }
+
+        // A block can end an integration and, when streaming, start the next one
+        uint32_t offset = 0;
+        while (offset < block->size && InIntegration)
+        {
+            buffer = block->data.data() + offset;
+            n_read = block->size - offset;
             grabData();
+            if (n_read <= 0)
+                break;
+            offset += n_read;
         }
+        ring.releaseRead();
     }
 }
 
+/**************************************************************************************
+** librtlsdr asynchronous read callback, runs in the acquisition thread
+***************************************************************************************/
+void RTLSDR::asyncCallback(unsigned char *buf, uint32_t len, void *ctx)
+{
+    RTLSDR *receiver = static_cast<RTLSDR *>(ctx);
+    SDRBlockRing::Block &block = receiver->ring.acquireWrite();
+    len = min(len, receiver->ring.blockSize());
+    memcpy(block.data.data(), buf, len);
+    receiver->ring.commitWrite(len);
+}
+
+void RTLSDR::startAcquisition()
+{
+    stopAcquisition();
+    ring.clearStatistics();
+    statsBytes = 0;
+    statsTime  = std::chrono::steady_clock::now();
+    terminateThread = false;
+
+    if((getSensorConnection() & CONNECTION_TCP) == 0) {
+        rtlsdr_reset_buffer(rtl_dev);
+        acquisitionThread = std::thread([this]()
+        {
+            if (rtlsdr_read_async(rtl_dev, &RTLSDR::asyncCallback, this, 0, RING_BLOCK_SIZE) < 0)
+                LOG_ERROR("Asynchronous read from the RTL-SDR failed.");
+        });
+    } else if (!tcpReader.start(PortFD)) {
+        LOG_ERROR("Failed to start reading from the rtl_tcp server.");
+    }
+
+    processThread = std::thread(&RTLSDR::Callback, this);
+}
+
+void RTLSDR::stopAcquisition()
+{
+    InIntegration   = false;
+    terminateThread = true;
+
+    if (acquisitionThread.joinable())
+    {
+        rtlsdr_cancel_async(rtl_dev);
+        acquisitionThread.join();
+    }
+    tcpReader.stop();
+
+    ring.wakeAll();
+    if (processThread.joinable())
+        processThread.join();
+}
+
+void RTLSDR::updateAcquisitionStats()
+{
+    auto now       = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - statsTime).count();
+    uint64_t bytes = ring.bytes();
+    if (seconds <= 0)
+        return;
+
+    double rate = (bytes - statsBytes) / static_cast<double>(IQ_SAMPLE_SIZE) / seconds / 1e6;
+    statsBytes  = bytes;
+    statsTime   = now;
+
+    if (fabs(rate - AcquisitionStatsN[STATS_RATE].value) < 0.001 &&
+            AcquisitionStatsN[STATS_BLOCKS].value == ring.delivered() &&
+            AcquisitionStatsN[STATS_OVERFLOWS].value == ring.overflows() &&
+            AcquisitionStatsN[STATS_UNDERRUNS].value == ring.underruns())
+        return;
+
+    AcquisitionStatsN[STATS_RATE].value      = rate;
+    AcquisitionStatsN[STATS_BLOCKS].value    = ring.delivered();
+    AcquisitionStatsN[STATS_OVERFLOWS].value = ring.overflows();
+    AcquisitionStatsN[STATS_UNDERRUNS].value = ring.underruns();
+    AcquisitionStatsNP.s = ring.overflows() > 0 ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&AcquisitionStatsNP, nullptr);
+}
+
 void ISInit()
 {
     if (!isInit)
@@ -97,12 +188,12 @@ void ISInit()
         iNumofConnectedSpectrographs = static_cast<int>(rtlsdr_get_device_count());
         if (iNumofConnectedSpectrographs == 0)
         {
-            //Try sending IDMessage as well?
-            IDLog("No USB RTLSDR receivers detected. Power on?");// Trying with TCP..");
-            IDMessage(nullptr, "No USB RTLSDR receivers detected. Power on?");// Trying with TCP..");
-            //iNumofConnectedSpectrographs = -1;
-            //receivers = static_cast<RTLSDR**>(malloc(fabs(iNumofConnectedSpectrographs)*sizeof(RTLSDR*)));
-            //receivers[0] = new RTLSDR(-1);
+            // Fall back to rtl_tcp, e.g. a remote dongle or rtl_tcp_replay
+            IDLog("No USB RTLSDR receivers detected. Trying with TCP..");
+            IDMessage(nullptr, "No USB RTLSDR receivers detected. Trying with TCP..");
+            iNumofConnectedSpectrographs = -1;
+            receivers = static_cast<RTLSDR**>(malloc(fabs(iNumofConnectedSpectrographs)*sizeof(RTLSDR*)));
+            receivers[0] = new RTLSDR(-1);
         }
         else
         {
@@ -211,6 +302,7 @@ void ISSnoopDevice(XMLEle *root)
 }
 
 RTLSDR::RTLSDR(int32_t index)
+    : integrator(SPECTRUM_SIZE, TOTAL_POWER_POINTS), ring(RING_BLOCKS, RING_BLOCK_SIZE), tcpReader(ring)
 {
     InIntegration = false;
     if(index<0) {
@@ -228,6 +320,11 @@ RTLSDR::RTLSDR(int32_t index)
 
 }
 
+RTLSDR::~RTLSDR()
+{
+    stopAcquisition();
+}
+
 bool RTLSDR::Connect()
 {
     if((getSensorConnection() & CONNECTION_TCP) == 0) {
@@ -245,7 +342,7 @@ bool RTLSDR::Connect()
 ***************************************************************************************/
 bool RTLSDR::Disconnect()
 {
-    InIntegration = false;
+    stopAcquisition();
     if((getSensorConnection() & CONNECTION_TCP) == 0) {
         rtlsdr_close(rtl_dev);
     }
@@ -254,7 +351,6 @@ bool RTLSDR::Disconnect()
     setBufferSize(1);
     pthread_mutex_lock(&condMutex);
     streamPredicate = 1;
-    terminateThread = true;
     pthread_cond_signal(&cv);
     pthread_mutex_unlock(&condMutex);
     LOG_INFO("RTL-SDR Spectrograph disconnected successfully!");
@@ -282,9 +378,26 @@ bool RTLSDR::initProperties()
     setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_SAMPLERATE", 2.5e+5, 2.0e+6, 2.5e+5, false);
     setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_GAIN", 0.0, 25.0, 0.1, false);
     setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_BANDWIDTH", 2.5e+5, 2.0e+6, 2.5e+5, false);
-    setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_BITSPERSAMPLE", 16, 16, 0, false);
+    setMinMaxStep("SPECTROGRAPH_SETTINGS", "SPECTROGRAPH_BITSPERSAMPLE", -32, 16, 0, false);
     setIntegrationFileExtension("fits");
 
+    // Raw samples, or spectrum and total power integrated as samples arrive
+    IUFillSwitch(&IntegrationModeS[MODE_RAW], "MODE_RAW", "Raw samples", ISS_ON);
+    IUFillSwitch(&IntegrationModeS[MODE_FFT], "MODE_FFT", "Streaming FFT", ISS_OFF);
+    IUFillSwitchVector(&IntegrationModeSP, IntegrationModeS, 2, getDeviceName(), "SPECTROGRAPH_INTEGRATION_MODE",
+                       "Integration", MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillBLOB(&TotalPowerB, "TOTAL_POWER", "Total power", ".fits");
+    IUFillBLOBVector(&TotalPowerBP, &TotalPowerB, 1, getDeviceName(), "SPECTROGRAPH_TOTAL_POWER", "Total power",
+                     MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
+    IUFillNumber(&AcquisitionStatsN[STATS_RATE], "RATE", "Rate (MS/s)", "%.3f", 0, 100, 0, 0);
+    IUFillNumber(&AcquisitionStatsN[STATS_BLOCKS], "BLOCKS", "Blocks", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&AcquisitionStatsN[STATS_OVERFLOWS], "OVERFLOWS", "Overflows", "%.f", 0, 1e12, 0, 0);
+    IUFillNumber(&AcquisitionStatsN[STATS_UNDERRUNS], "UNDERRUNS", "Underruns", "%.f", 0, 1e12, 0, 0);
+    IUFillNumberVector(&AcquisitionStatsNP, AcquisitionStatsN, 4, getDeviceName(), "SPECTROGRAPH_ACQUISITION_STATS",
+                       "Acquisition", INFO_TAB, IP_RO, 60, IPS_IDLE);
+
     // Add Debug, Simulator, and Configuration controls
     addAuxControls();
 
@@ -305,14 +418,31 @@ bool RTLSDR::updateProperties()
     {
         // Inital values
         setupParams(1000000, 1420000000, 10);
+        defineSwitch(&IntegrationModeSP);
+        defineBLOB(&TotalPowerBP);
+        defineNumber(&AcquisitionStatsNP);
+        startAcquisition();
 
         // Start the timer
         SetTimer(POLLMS);
     }
+    else
+    {
+        deleteProperty(IntegrationModeSP.name);
+        deleteProperty(TotalPowerBP.name);
+        deleteProperty(AcquisitionStatsNP.name);
+    }
 
     return true;
 }
 
+bool RTLSDR::saveConfigItems(FILE *fp)
+{
+    INDI::Spectrograph::saveConfigItems(fp);
+    IUSaveConfigSwitch(fp, &IntegrationModeSP);
+    return true;
+}
+
 /**************************************************************************************
 ** Setting up Spectrograph parameters
 ***************************************************************************************/
@@ -332,7 +462,7 @@ void RTLSDR::setupParams(float sr, float freq, float gain)
             LOG_INFO("Issue(s) setting parameters.");
         }
 
-        setBPS(16);
+        setBPS(IntegrationModeS[MODE_FFT].s == ISS_ON ? -32 : 16);
         setGain(static_cast<double>(rtlsdr_get_tuner_gain(rtl_dev))/10.0);
         setFrequency(static_cast<double>(rtlsdr_get_center_freq(rtl_dev)));
         setSampleRate(static_cast<double>(rtlsdr_get_sample_rate(rtl_dev)));
@@ -346,7 +476,7 @@ void RTLSDR::setupParams(float sr, float freq, float gain)
         sendTcpCommand(CMD_SET_AGC_MODE, 0);
         sendTcpCommand(CMD_SET_TUNER_GAIN_INDEX, 0);
 
-        setBPS(16);
+        setBPS(IntegrationModeS[MODE_FFT].s == ISS_ON ? -32 : 16);
         setGain(gain);
         setFrequency(freq);
         setSampleRate(sr);
@@ -357,15 +487,15 @@ void RTLSDR::setupParams(float sr, float freq, float gain)
 bool RTLSDR::sendTcpCommand(int cmd, int value)
 {
     unsigned char tosend[5];
+    // rtl_tcp expects the parameter in network byte order
     tosend[0] = static_cast<unsigned char>(cmd);
-    tosend[1] = value&0xff;
-    value >>= 8;
-    tosend[2] = value&0xff;
+    tosend[4] = value&0xff;
     value >>= 8;
     tosend[3] = value&0xff;
     value >>= 8;
-    tosend[4] = value&0xff;
+    tosend[2] = value&0xff;
     value >>= 8;
+    tosend[1] = value&0xff;
     tcflush(PortFD, TCOFLUSH);
     int count = 0;
     while(count < 5) {
@@ -393,13 +523,35 @@ bool RTLSDR::ISNewNumber(const char *dev, const char *name, double values[], cha
         values[SPECTROGRAPH_BANDWIDTH] = getBandwidth();
         values[SPECTROGRAPH_FREQUENCY] = getFrequency();
         values[SPECTROGRAPH_SAMPLERATE] = getSampleRate();
-        values[SPECTROGRAPH_BITSPERSAMPLE] = 16;
+        values[SPECTROGRAPH_BITSPERSAMPLE] = getBPS();
         IUUpdateNumber(&SpectrographSettingsNP, values, names, n);
         IDSetNumber(&SpectrographSettingsNP, nullptr);
     }
     return processNumber(dev, name, values, names, n) & !r;
 }
 
+bool RTLSDR::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, IntegrationModeSP.name))
+    {
+        if (InIntegration)
+        {
+            LOG_WARN("Cannot change the integration mode while integrating.");
+            IntegrationModeSP.s = IPS_ALERT;
+            IDSetSwitch(&IntegrationModeSP, nullptr);
+            return true;
+        }
+
+        IUUpdateSwitch(&IntegrationModeSP, states, names, n);
+        setBPS(IntegrationModeS[MODE_FFT].s == ISS_ON ? -32 : 16);
+        IntegrationModeSP.s = IPS_OK;
+        IDSetSwitch(&IntegrationModeSP, nullptr);
+        IDSetNumber(&SpectrographSettingsNP, nullptr);
+        return true;
+    }
+    return INDI::Spectrograph::ISNewSwitch(dev, name, states, names, n);
+}
+
 /**************************************************************************************
 ** Client is asking us to start an exposure
 ***************************************************************************************/
@@ -408,15 +560,27 @@ bool RTLSDR::StartIntegration(double duration)
     IntegrationRequest = static_cast<float>(duration);
     AbortIntegration();
 
+    b_read  = 0;
+    to_read = getSampleRate() * IntegrationRequest * IQ_SAMPLE_SIZE;
+    if (IntegrationModeS[MODE_FFT].s == ISS_ON)
+    {
+        // Only the spectrum is kept, whatever the integration time
+        setBufferSize(SPECTRUM_SIZE * sizeof(float));
+        integrator.reset(to_read / IQ_SAMPLE_SIZE);
+    }
+    else
+        setBufferSize(to_read);
+    setIntegrationTime(IntegrationRequest);
+
+    // Streamed frames follow each other without a gap, otherwise start from fresh samples
+    if (!streamPredicate)
+        flushRing = true;
+
     LOG_INFO("Integration started...");
-    // Run threads
-    std::thread(&RTLSDR::Callback, this).detach();
     gettimeofday(&IntStart, nullptr);
+    // The processing thread picks the integration up from here
     InIntegration = true;
     return true;
-
-    // We're done
-    return false;
 }
 
 /**************************************************************************************
@@ -459,6 +623,8 @@ void RTLSDR::TimerHit()
     if (isConnected() == false)
         return; //  No need to reset timer if we are not connected anymore
 
+    updateAcquisitionStats();
+
     if (InIntegration)
     {
         timeleft = static_cast<long>(CalcTimeLeft());
@@ -484,11 +650,15 @@ void RTLSDR::grabData()
 {
     if (InIntegration)
     {
+        bool streamingFFT = IntegrationModeS[MODE_FFT].s == ISS_ON;
         n_read    = min(to_read, n_read);
         continuum = getBuffer();
         if (n_read > 0)
         {
-            memcpy(continuum + b_read, buffer, n_read);
+            if (streamingFFT)
+                integrator.addU8(buffer, n_read);
+            else
+                memcpy(continuum + b_read, buffer, n_read);
             b_read += n_read;
             to_read -= n_read;
         }
@@ -496,7 +666,11 @@ void RTLSDR::grabData()
         if (to_read <= 0)
         {
             InIntegration = false;
+            if (streamingFFT && integrator.getSpectrum(reinterpret_cast<float *>(continuum)) == 0)
+                memset(continuum, 0, getBufferSize());
             if(!streamPredicate) {
+                if (streamingFFT)
+                    sendTotalPower(integrator, &TotalPowerBP, getSampleRate());
                 LOG_INFO("Download complete.");
                 IntegrationComplete();
             } else {
@@ -538,6 +712,21 @@ bool RTLSDR::Handshake()
             LOG_ERROR("Failed to connect to rtl_tcp server.");
             return false;
         }
+
+        // rtl_tcp sends a 12 bytes dongle information header first, it must not be integrated as samples
+        char header[12];
+        int nbytes = 0;
+        if (tty_read(PortFD, header, sizeof(header), 5, &nbytes) != TTY_OK || strncmp(header, "RTL0", 4) != 0)
+        {
+            LOG_ERROR("No dongle information received from the rtl_tcp server.");
+            return false;
+        }
+        auto be32 = [&](int offset)
+        {
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(header + offset);
+            return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        };
+        LOGF_INFO("rtl_tcp tuner type %d, %d gain values.", be32(4), be32(8));
     }
 
     streamPredicate = 0;
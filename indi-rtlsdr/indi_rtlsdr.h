@@ -26,6 +26,13 @@
 #include <rtl-sdr.h>
 #include "indispectrograph.h"
 #include "stream/streammanager.h"
+#include "sdr_integrator.h"
+#include "sdr_block_ring.h"
+#include "rtl_tcp_reader.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 enum Settings
 {
@@ -38,15 +45,17 @@ class RTLSDR : public INDI::Spectrograph
 {
   public:
     RTLSDR(int32_t index);
+    ~RTLSDR();
 
     void grabData();
     rtlsdr_dev_t *rtl_dev = { nullptr };
     int to_read;
     // Are we integrating?
-    bool InIntegration;
+    std::atomic<bool> InIntegration;
     uint8_t *buffer;
     int b_read, n_read;
     bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+    bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
 
   protected:
     // General device functions
@@ -55,6 +64,7 @@ class RTLSDR : public INDI::Spectrograph
     const char *getDefaultName() override;
     bool initProperties() override;
     bool updateProperties() override;
+    bool saveConfigItems(FILE *fp) override;
 
     // Spectrograph specific functions
     bool StartIntegration(double duration) override;
@@ -71,6 +81,12 @@ class RTLSDR : public INDI::Spectrograph
   private:
     void Callback();
 
+    // Acquisition runs while connected, the processing thread (Callback) consumes the ring
+    void startAcquisition();
+    void stopAcquisition();
+    void updateAcquisitionStats();
+    static void asyncCallback(unsigned char *buf, uint32_t len, void *ctx);
+
     // Utility functions
     float CalcTimeLeft();
 
@@ -81,9 +97,40 @@ class RTLSDR : public INDI::Spectrograph
 
     int32_t spectrographIndex = { 0 };
 
+    // Streaming FFT mode: spectrum and total power are integrated as samples arrive
+    ISwitch IntegrationModeS[2];
+    ISwitchVectorProperty IntegrationModeSP;
+    enum
+    {
+        MODE_RAW,
+        MODE_FFT
+    };
+    IBLOB TotalPowerB;
+    IBLOBVectorProperty TotalPowerBP;
+    SDRIntegrator integrator;
+
+    SDRBlockRing ring;
+    RTLTCPReader tcpReader;
+    std::thread acquisitionThread;
+    std::thread processThread;
+    // Drop the samples queued before a new integration
+    std::atomic<bool> flushRing { false };
+
+    INumber AcquisitionStatsN[4];
+    INumberVectorProperty AcquisitionStatsNP;
+    enum
+    {
+        STATS_RATE,
+        STATS_BLOCKS,
+        STATS_OVERFLOWS,
+        STATS_UNDERRUNS
+    };
+    uint64_t statsBytes { 0 };
+    std::chrono::steady_clock::time_point statsTime;
+
     int streamPredicate;
     pthread_t primary_thread;
-    bool terminateThread;
+    std::atomic<bool> terminateThread;
 
     bool sendTcpCommand(int cmd, int value);
     enum TcpCommands {
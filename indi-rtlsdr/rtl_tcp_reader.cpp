@@ -0,0 +1,130 @@
+/*
+    rtl_tcp_reader - epoll based rtl_tcp sample reader for indi_rtlsdr
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "rtl_tcp_reader.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+RTLTCPReader::~RTLTCPReader()
+{
+    stop();
+}
+
+bool RTLTCPReader::start(int fd)
+{
+    stop();
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd  = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd < 0 || stopFd < 0)
+    {
+        stop();
+        return false;
+    }
+
+    epoll_event event {};
+    event.events  = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        stop();
+        return false;
+    }
+    event.data.fd = stopFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event);
+
+    socketFd    = fd;
+    isConnected = true;
+    thread      = std::thread(&RTLTCPReader::loop, this);
+    return true;
+}
+
+void RTLTCPReader::stop()
+{
+    if (thread.joinable())
+    {
+        uint64_t one = 1;
+        ssize_t written = write(stopFd, &one, sizeof(one));
+        (void)written;
+        thread.join();
+    }
+
+    if (epollFd >= 0)
+        close(epollFd);
+    if (stopFd >= 0)
+        close(stopFd);
+    epollFd     = -1;
+    stopFd      = -1;
+    socketFd    = -1;
+    isConnected = false;
+}
+
+void RTLTCPReader::loop()
+{
+    SDRBlockRing::Block *block = &ring.acquireWrite();
+    uint32_t fill = 0;
+
+    while (isConnected)
+    {
+        epoll_event events[2];
+        int n = epoll_wait(epollFd, events, 2, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (events[i].data.fd == stopFd)
+                return;
+        }
+
+        // Drain everything available, the socket is not switched to non-blocking mode
+        while (true)
+        {
+            ssize_t len = recv(socketFd, block->data.data() + fill, block->data.size() - fill, MSG_DONTWAIT);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (len <= 0)
+            {
+                isConnected = false;
+                break;
+            }
+
+            fill += len;
+            if (fill == block->data.size())
+            {
+                ring.commitWrite(fill);
+                block = &ring.acquireWrite();
+                fill  = 0;
+            }
+        }
+    }
+
+    if (fill > 0)
+        ring.commitWrite(fill);
+    ring.wakeAll();
+}
@@ -0,0 +1,58 @@
+/*
+    rtl_tcp_reader - epoll based rtl_tcp sample reader for indi_rtlsdr
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include "sdr_block_ring.h"
+
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief The RTLTCPReader class drains an rtl_tcp socket into an SDRBlockRing from its own
+ * thread. The thread sleeps in epoll_wait until the socket is readable, then reads without
+ * blocking straight into the block at the head of the ring, and publishes it once full.
+ *
+ * The socket itself is left in blocking mode so commands can still be written to it.
+ */
+class RTLTCPReader
+{
+  public:
+    explicit RTLTCPReader(SDRBlockRing &ring) : ring(ring) {}
+    ~RTLTCPReader();
+
+    RTLTCPReader(const RTLTCPReader &) = delete;
+    RTLTCPReader &operator=(const RTLTCPReader &) = delete;
+
+    /** Start reading from the connected socket fd, which must stay open until stop(). */
+    bool start(int fd);
+    void stop();
+
+    /** False once the server closed the connection or a read failed. */
+    bool connected() const { return isConnected; }
+
+  private:
+    void loop();
+
+    SDRBlockRing &ring;
+    int socketFd { -1 };
+    int epollFd { -1 };
+    int stopFd { -1 };
+    std::atomic<bool> isConnected { false };
+    std::thread thread;
+};
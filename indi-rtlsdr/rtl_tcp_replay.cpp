@@ -0,0 +1,516 @@
+/*
+    rtl_tcp_replay - serves recorded IQ files with the rtl_tcp protocol
+
+    Lets indi_rtlsdr be run offline: start the replay server, then connect the
+    "RTL-SDR Receiver TCP" device to it. The file holds interleaved 8 bits I/Q
+    bytes, as written by rtl_sdr. The replay is paced at the sample rate set by
+    the client, or by -s.
+
+    With --self-test a synthetic recording is served on a local port, read back
+    through a client doing what the driver does, and integrated with the same
+    SDRIntegrator as the driver's streaming FFT mode.
+
+    With --benchmark the recording is served at a sustained sample rate and read
+    through the driver acquisition path: epoll reader, block ring, then a consumer
+    that integrates the samples and stalls once per second, as BLOB encoding does.
+    Overflows (dropped blocks) and underruns (starved consumer) are reported.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "rtl_tcp_reader.h"
+#include "sdr_integrator.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define CHUNK_SIZE      (16384)
+#define RING_BLOCK_SIZE (CHUNK_SIZE * 2)
+#define SPECTRUM_SIZE   (256)
+#define CMD_SET_FREQ        0x1
+#define CMD_SET_SAMPLE_RATE 0x2
+#define RTLSDR_TUNER_R820T  5
+#define R820T_GAIN_COUNT    29
+
+struct ReplayOptions
+{
+    uint16_t port { 1234 };
+    double sampleRate { 2.048e6 };
+    bool loop { false };
+    bool verbose { false };
+};
+
+static int listenSocket(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(port);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 1) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = read(fd, data, len);
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Handle the 5 bytes commands already received, without blocking. Only the sample rate matters here. */
+static bool readCommands(int fd, ReplayOptions &options)
+{
+    pollfd pfd { fd, POLLIN, 0 };
+    while (poll(&pfd, 1, 0) > 0)
+    {
+        uint8_t cmd[5];
+        if (!readAll(fd, cmd, sizeof(cmd)))
+            return false;
+
+        uint32_t param = (cmd[1] << 24) | (cmd[2] << 16) | (cmd[3] << 8) | cmd[4];
+        if (cmd[0] == CMD_SET_SAMPLE_RATE && param > 0)
+            options.sampleRate = param;
+        if (options.verbose)
+            fprintf(stderr, "command 0x%02x param %u\n", cmd[0], param);
+    }
+    return true;
+}
+
+/* Serve one client: dongle info header, then the file paced at the sample rate. */
+static void serveClient(int fd, const std::vector<uint8_t> &iq, ReplayOptions options)
+{
+    uint8_t header[12] = { 'R', 'T', 'L', '0' };
+    uint32_t tuner = htonl(RTLSDR_TUNER_R820T), gains = htonl(R820T_GAIN_COUNT);
+    memcpy(header + 4, &tuner, 4);
+    memcpy(header + 8, &gains, 4);
+    if (!sendAll(fd, header, sizeof(header)))
+        return;
+
+    auto next   = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    while (sent < iq.size())
+    {
+        if (!readCommands(fd, options))
+            return;
+
+        size_t len = std::min<size_t>(CHUNK_SIZE, iq.size() - sent);
+        if (!sendAll(fd, iq.data() + sent, len))
+            return;
+        sent += len;
+        if (sent == iq.size() && options.loop)
+            sent = 0;
+
+        if (options.sampleRate > 0)
+        {
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(len / 2 / options.sampleRate));
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    // Closing with unread commands would reset the connection and drop the samples still queued
+    shutdown(fd, SHUT_WR);
+    uint8_t discard[64];
+    while (read(fd, discard, sizeof(discard)) > 0)
+        ;
+}
+
+static std::vector<uint8_t> syntheticRecording(size_t samples, double toneBin, unsigned seed)
+{
+    std::vector<uint8_t> iq(samples * 2);
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0, 0.05);
+    for (size_t k = 0; k < samples; k++)
+    {
+        double phase = 2 * M_PI * toneBin * k / SPECTRUM_SIZE;
+        double i     = 0.5 * cos(phase) + noise(rng);
+        double q     = 0.5 * sin(phase) + noise(rng);
+        iq[2 * k]     = static_cast<uint8_t>(std::max(0.0, std::min(255.0, round(127.5 + 127.5 * i))));
+        iq[2 * k + 1] = static_cast<uint8_t>(std::max(0.0, std::min(255.0, round(127.5 + 127.5 * q))));
+    }
+    return iq;
+}
+
+/* Connect to the local server and integrate the recording the way the driver streaming FFT mode does. */
+static bool selfTest()
+{
+    const double toneBin  = 64;
+    const size_t samples  = 1 << 20;
+    const size_t points   = 64;
+    std::vector<uint8_t> iq = syntheticRecording(samples, toneBin, 1);
+
+    int server = -1;
+    uint16_t port = 0;
+    for (port = 40000; port < 40100 && server < 0; port++)
+        server = listenSocket(port);
+    port--;
+    if (server < 0)
+    {
+        fprintf(stderr, "Unable to listen on a local port.\n");
+        return false;
+    }
+
+    ReplayOptions options;
+    options.sampleRate = 0;
+    std::thread serverThread([&]()
+    {
+        int fd = accept(server, nullptr, nullptr);
+        if (fd >= 0)
+        {
+            serveClient(fd, iq, options);
+            close(fd);
+        }
+    });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(port);
+    bool ok = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+
+    uint8_t header[12];
+    ok = ok && readAll(fd, header, sizeof(header)) && memcmp(header, "RTL0", 4) == 0;
+    if (!ok)
+        fprintf(stderr, "rtl_tcp header not received.\n");
+
+    // Network byte order, as rtl_tcp expects
+    uint8_t cmd[5] = { CMD_SET_FREQ, 0x54, 0xA3, 0x7B, 0x00 };
+    ok = ok && write(fd, cmd, sizeof(cmd)) == sizeof(cmd);
+
+    SDRIntegrator streamed(SPECTRUM_SIZE, points);
+    streamed.reset();
+    std::vector<uint8_t> chunk(CHUNK_SIZE);
+    std::mt19937 rng(2);
+    size_t received = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (ok && received < iq.size())
+    {
+        // Odd read sizes split samples between reads, as a socket does
+        size_t len = std::min<size_t>(1 + rng() % CHUNK_SIZE, iq.size() - received);
+        ssize_t n  = read(fd, chunk.data(), len);
+        if (n <= 0)
+            break;
+        streamed.addU8(chunk.data(), n);
+        received += n;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(fd);
+    serverThread.join();
+    close(server);
+
+    if (received != iq.size())
+    {
+        fprintf(stderr, "Received %zu of %zu bytes.\n", received, iq.size());
+        return false;
+    }
+
+    // The same recording integrated in one go must give the same results
+    SDRIntegrator direct(SPECTRUM_SIZE, points);
+    direct.reset();
+    direct.addU8(iq.data(), iq.size());
+
+    std::vector<float> spectrum(SPECTRUM_SIZE), expectedSpectrum(SPECTRUM_SIZE);
+    std::vector<double> power(points), expectedPower(points);
+    size_t bins      = streamed.getSpectrum(spectrum.data());
+    size_t nPoints   = streamed.getTotalPower(power.data());
+    direct.getSpectrum(expectedSpectrum.data());
+    size_t nExpected = direct.getTotalPower(expectedPower.data());
+
+    if (bins != SPECTRUM_SIZE || spectrum != expectedSpectrum || nPoints != nExpected ||
+            !std::equal(power.begin(), power.begin() + nPoints, expectedPower.begin()))
+    {
+        fprintf(stderr, "Streamed integration differs from the direct integration.\n");
+        return false;
+    }
+
+    size_t peak = std::max_element(spectrum.begin(), spectrum.end()) - spectrum.begin();
+    if (peak != SPECTRUM_SIZE / 2 + toneBin)
+    {
+        fprintf(stderr, "Tone found in bin %zu instead of %g.\n", peak, SPECTRUM_SIZE / 2 + toneBin);
+        return false;
+    }
+
+    double meanPower = 0, spectrumPower = 0;
+    for (size_t k = 0; k < samples * 2; k++)
+    {
+        double v = (iq[k] - 127.5) / 127.5;
+        meanPower += v * v;
+    }
+    meanPower /= samples;
+    for (float bin : spectrum)
+        spectrumPower += bin;
+    double seriesPower = 0;
+    for (size_t k = 0; k < nPoints; k++)
+        seriesPower += power[k];
+    seriesPower /= nPoints;
+    if (fabs(spectrumPower / meanPower - 1) > 0.02 || fabs(seriesPower / meanPower - 1) > 1e-6 || nPoints > points)
+    {
+        fprintf(stderr, "Power mismatch: samples %g, spectrum %g, time series %g (%zu points).\n", meanPower,
+                spectrumPower, seriesPower, nPoints);
+        return false;
+    }
+
+    printf("rtl_tcp replay: %zu samples in %.3f s (%.1f MS/s), %llu blocks, %zu points of %llu blocks.\n", samples,
+           seconds, samples / seconds / 1e6, static_cast<unsigned long long>(streamed.blocks()), nPoints,
+           static_cast<unsigned long long>(streamed.blocksPerPoint()));
+    return true;
+}
+
+/* Serve a looped recording on a local port and return the connected client socket, after the header. */
+static int localReplay(const std::vector<uint8_t> &iq, const ReplayOptions &options, std::thread &serverThread)
+{
+    int server = -1;
+    uint16_t port = 0;
+    for (port = 40100; port < 40200 && server < 0; port++)
+        server = listenSocket(port);
+    port--;
+    if (server < 0)
+        return -1;
+
+    serverThread = std::thread([&iq, options, server]()
+    {
+        int fd = accept(server, nullptr, nullptr);
+        close(server);
+        if (fd >= 0)
+        {
+            serveClient(fd, iq, options);
+            close(fd);
+        }
+    });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(port);
+    uint8_t header[12];
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            !readAll(fd, header, sizeof(header)) || memcmp(header, "RTL0", 4) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool benchmark(double rate, int seconds, int stallMS, int blocks)
+{
+    std::vector<uint8_t> iq = syntheticRecording(1 << 20, 64, 1);
+    ReplayOptions options;
+    options.sampleRate = rate;
+    options.loop       = true;
+
+    std::thread serverThread;
+    int fd = localReplay(iq, options, serverThread);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Unable to start the local rtl_tcp server.\n");
+        if (serverThread.joinable())
+            serverThread.join();
+        return false;
+    }
+
+    SDRBlockRing ring(blocks, RING_BLOCK_SIZE);
+    RTLTCPReader reader(ring);
+    SDRIntegrator integrator(SPECTRUM_SIZE, 4096);
+    integrator.reset();
+    reader.start(fd);
+
+    auto start    = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(seconds);
+    uint64_t consumed = 0, nextStall = rate * 2;
+    while (std::chrono::steady_clock::now() < deadline && reader.connected())
+    {
+        SDRBlockRing::Block *block = ring.acquireRead(std::chrono::milliseconds(100));
+        if (block == nullptr)
+        {
+            ring.countUnderrun();
+            continue;
+        }
+        integrator.addU8(block->data.data(), block->size);
+        consumed += block->size;
+        ring.releaseRead();
+
+        if (stallMS > 0 && consumed >= nextStall)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(stallMS));
+            nextStall += rate * 2;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    reader.stop();
+    close(fd);
+    serverThread.join();
+
+    // Blocks still queued when the time is up are not lost, only late
+    for (SDRBlockRing::Block *block; (block = ring.acquireRead(std::chrono::milliseconds(0))) != nullptr; )
+    {
+        integrator.addU8(block->data.data(), block->size);
+        consumed += block->size;
+        ring.releaseRead();
+    }
+
+    double sustained = ring.bytes() / 2 / elapsed;
+    printf("rtl_tcp benchmark: %.3f MS/s requested, %.3f MS/s received, %.3f MS/s integrated over %.1f s\n", rate / 1e6,
+           sustained / 1e6, consumed / 2 / elapsed / 1e6, elapsed);
+    printf("Blocks: %llu of %u bytes, %llu overflows, %llu underruns, %llu of %d blocks used at most (%d ms stall per second)\n",
+           static_cast<unsigned long long>(ring.delivered()), ring.blockSize(),
+           static_cast<unsigned long long>(ring.overflows()), static_cast<unsigned long long>(ring.underruns()),
+           static_cast<unsigned long long>(ring.maxPending()), blocks, stallMS);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-p port] [-s samplerate] [-l] [-v] file.iq\n", name);
+    fprintf(stderr, "       %s --self-test\n", name);
+    fprintf(stderr, "       %s --benchmark [MS/s] [seconds] [stall ms per second] [ring blocks]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 2 && !strcmp(argv[1], "--self-test"))
+    {
+        bool ok = selfTest();
+        printf("%s\n", ok ? "Self test passed." : "Self test FAILED.");
+        return ok ? 0 : 1;
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--benchmark"))
+    {
+        double rate = argc > 2 ? atof(argv[2]) * 1e6 : 2.4e6;
+        int seconds = argc > 3 ? atoi(argv[3]) : 5;
+        int stallMS = argc > 4 ? atoi(argv[4]) : 200;
+        int blocks  = argc > 5 ? atoi(argv[5]) : 256;
+        if (rate <= 0 || seconds <= 0 || blocks <= 0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return benchmark(rate, seconds, stallMS, blocks) ? 0 : 1;
+    }
+
+    ReplayOptions options;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:s:lv")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                options.port = static_cast<uint16_t>(atoi(optarg));
+                break;
+            case 's':
+                options.sampleRate = atof(optarg);
+                break;
+            case 'l':
+                options.loop = true;
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *fp = fopen(argv[optind], "rb");
+    if (fp == nullptr)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    std::vector<uint8_t> iq;
+    uint8_t buf[CHUNK_SIZE];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        iq.insert(iq.end(), buf, buf + n);
+    fclose(fp);
+    if (iq.size() < 2)
+    {
+        fprintf(stderr, "%s holds no samples.\n", argv[optind]);
+        return 1;
+    }
+
+    int server = listenSocket(options.port);
+    if (server < 0)
+    {
+        perror("listen");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    printf("Replaying %zu samples on 127.0.0.1:%u\n", iq.size() / 2, options.port);
+
+    while (true)
+    {
+        int fd = accept(server, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        printf("Client connected.\n");
+        serveClient(fd, iq, options);
+        close(fd);
+        printf("Client disconnected.\n");
+    }
+}
@@ -0,0 +1,178 @@
+/*
+    sdr_block_ring - preallocated sample block ring for the INDI SDR spectrographs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief The SDRBlockRing class is a single producer / single consumer ring of sample blocks,
+ * filled by the acquisition thread and drained by the processing thread. It follows
+ * ASIFrameRing of indi-asi, overflow block included; the drivers are packaged separately, so
+ * each carries its own copy. Here the producer only takes the mutex when the consumer is parked,
+ * and clear() drops stale samples without resetting the producer.
+ */
+class SDRBlockRing
+{
+  public:
+    struct Block
+    {
+        std::vector<uint8_t> data;
+        uint32_t size { 0 };
+    };
+
+    SDRBlockRing(size_t count, uint32_t blockSize) : blocks(count + 1)
+    {
+        for (auto &block : blocks)
+            block.data.resize(blockSize);
+    }
+
+    uint32_t blockSize() const { return static_cast<uint32_t>(blocks[0].data.size()); }
+
+    /** Number of usable blocks, not counting the overflow block. */
+    size_t capacity() const { return blocks.size() - 1; }
+
+    /** Number of filled blocks waiting for the consumer. */
+    size_t pending() const { return head.load() - tail.load(); }
+
+    bool empty() const { return pending() == 0; }
+
+    /**
+     * @brief acquireWrite Producer side. Returns the next free block or, when the consumer
+     * is behind, the overflow block whose content is dropped on commit.
+     */
+    Block &acquireWrite()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        overflow = (h - tail.load(std::memory_order_acquire)) >= capacity();
+        return overflow ? blocks.back() : blocks[h % capacity()];
+    }
+
+    /**
+     * @brief commitWrite Publish the block returned by acquireWrite.
+     * @return false if the block had to be dropped.
+     */
+    bool commitWrite(uint32_t size)
+    {
+        receivedBytes += size;
+        if (overflow)
+        {
+            ++overflowCount;
+            return false;
+        }
+
+        size_t h = head.load(std::memory_order_relaxed);
+        blocks[h % capacity()].size = size;
+        head.store(h + 1);
+        ++blockCount;
+
+        size_t queued = h + 1 - tail.load(std::memory_order_relaxed);
+        if (queued > maxPendingCount)
+            maxPendingCount = queued;
+
+        // Pairs with the waiting flag set by acquireRead, a parked consumer always sees the new head
+        if (waiting.load())
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCV.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief acquireRead Consumer side. Wait up to timeout for a filled block.
+     * @return the oldest filled block or nullptr on timeout.
+     */
+    Block *acquireRead(std::chrono::milliseconds timeout)
+    {
+        if (empty())
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            waiting.store(true);
+            bool filled = wakeCV.wait_for(lock, timeout, [this] { return !empty() || woken; });
+            waiting.store(false);
+            woken = false;
+            if (!filled || empty())
+                return nullptr;
+        }
+
+        return &blocks[tail.load(std::memory_order_relaxed) % capacity()];
+    }
+
+    /** @brief releaseRead Hand the block returned by acquireRead back to the producer. */
+    void releaseRead()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Count a consumer that needed samples and found none. */
+    void countUnderrun() { ++underrunCount; }
+
+    /** Wake up a consumer blocked in acquireRead, e.g. when acquisition is stopped. */
+    void wakeAll()
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        woken = true;
+        wakeCV.notify_all();
+    }
+
+    /** Consumer side. Drop the filled blocks, e.g. stale samples before an integration. */
+    void clear()
+    {
+        tail.store(head.load(), std::memory_order_release);
+    }
+
+    void clearStatistics()
+    {
+        receivedBytes   = 0;
+        blockCount      = 0;
+        overflowCount   = 0;
+        underrunCount   = 0;
+        maxPendingCount = 0;
+    }
+
+    // Statistics, safe to read from any thread.
+    uint64_t bytes() const { return receivedBytes; }
+    uint64_t delivered() const { return blockCount; }
+    uint64_t overflows() const { return overflowCount; }
+    uint64_t underruns() const { return underrunCount; }
+    uint64_t maxPending() const { return maxPendingCount; }
+
+  private:
+    std::vector<Block> blocks;
+    bool overflow { false };
+
+    std::atomic<size_t> head { 0 };
+    std::atomic<size_t> tail { 0 };
+
+    std::atomic<uint64_t> receivedBytes { 0 };
+    std::atomic<uint64_t> blockCount { 0 };
+    std::atomic<uint64_t> overflowCount { 0 };
+    std::atomic<uint64_t> underrunCount { 0 };
+    std::atomic<uint64_t> maxPendingCount { 0 };
+
+    std::atomic<bool> waiting { false };
+    bool woken { false };
+    std::mutex wakeMutex;
+    std::condition_variable wakeCV;
+};
@@ -0,0 +1,213 @@
+/*
+    sdr_integrator - streaming FFT integration for the INDI SDR spectrographs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "sdr_integrator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+SDRIntegrator::SDRIntegrator(size_t bins, size_t points)
+    : fftSize(bins)
+{
+    if (bins < 2 || (bins & (bins - 1)) != 0)
+        throw std::invalid_argument("SDRIntegrator: bins must be a power of two");
+
+    window.resize(bins);
+    twiddles.resize(bins / 2);
+    bitReverse.resize(bins);
+    block.resize(bins);
+    work.resize(bins);
+    spectrum.resize(bins);
+    // Merging halves the series, so keep an even capacity
+    series.resize(std::max<size_t>(2, points + (points & 1)));
+
+    int bits = 0;
+    while ((static_cast<size_t>(1) << bits) < bins)
+        bits++;
+
+    for (size_t k = 0; k < bins; k++)
+    {
+        window[k] = static_cast<float>(0.5 - 0.5 * cos(2 * M_PI * k / bins));
+        windowPower += window[k] * window[k];
+
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; b++)
+            reversed |= ((k >> b) & 1) << (bits - 1 - b);
+        bitReverse[k] = reversed;
+    }
+
+    for (size_t k = 0; k < bins / 2; k++)
+        twiddles[k] = std::polar(1.0f, static_cast<float>(-2 * M_PI * k / bins));
+
+    for (int v = 0; v < 256; v++)
+        u8Table[v] = (v - 127.5f) / 127.5f;
+
+    reset();
+}
+
+void SDRIntegrator::reset(uint64_t expectedSamples)
+{
+    std::fill(spectrum.begin(), spectrum.end(), 0.0);
+    blockFill   = 0;
+    blockCount  = 0;
+    sampleCount = 0;
+    pendingI    = -1;
+
+    seriesCount = 0;
+    pointSum    = 0;
+    pointFill   = 0;
+
+    uint64_t expectedBlocks = expectedSamples / fftSize;
+    pointBlocks = std::max<uint64_t>(1, (expectedBlocks + series.size() - 1) / series.size());
+}
+
+template <typename Convert>
+void SDRIntegrator::add(size_t samples, Convert convert)
+{
+    size_t done = 0;
+    while (done < samples)
+    {
+        size_t n = std::min(samples - done, fftSize - blockFill);
+        for (size_t k = 0; k < n; k++)
+            block[blockFill + k] = convert(done + k);
+
+        blockFill += n;
+        done += n;
+        if (blockFill == fftSize)
+            processBlock();
+    }
+    sampleCount += samples;
+}
+
+void SDRIntegrator::addU8(const uint8_t *iq, size_t bytes)
+{
+    if (bytes == 0)
+        return;
+
+    if (pendingI >= 0)
+    {
+        const std::complex<float> sample(u8Table[pendingI], u8Table[iq[0]]);
+        add(1, [&](size_t)
+        {
+            return sample;
+        });
+        pendingI = -1;
+        iq++;
+        bytes--;
+    }
+
+    add(bytes / 2, [&](size_t k)
+    {
+        return std::complex<float>(u8Table[iq[2 * k]], u8Table[iq[2 * k + 1]]);
+    });
+
+    if (bytes & 1)
+        pendingI = iq[bytes - 1];
+}
+
+void SDRIntegrator::addF32(const float *iq, size_t samples)
+{
+    add(samples, [&](size_t k)
+    {
+        return std::complex<float>(iq[2 * k], iq[2 * k + 1]);
+    });
+}
+
+void SDRIntegrator::processBlock()
+{
+    double power = 0;
+    for (size_t k = 0; k < fftSize; k++)
+    {
+        const std::complex<float> &x = block[k];
+        power += x.real() * x.real() + x.imag() * x.imag();
+        work[bitReverse[k]] = x * window[k];
+    }
+    blockFill = 0;
+
+    // Iterative radix-2 decimation in time, the products are written out to keep them inlined
+    for (size_t len = 2; len <= fftSize; len <<= 1)
+    {
+        const size_t half = len / 2;
+        const size_t step = fftSize / len;
+        for (size_t start = 0; start < fftSize; start += len)
+        {
+            for (size_t k = 0; k < half; k++)
+            {
+                const std::complex<float> &w = twiddles[k * step];
+                std::complex<float> &a = work[start + k];
+                std::complex<float> &b = work[start + k + half];
+                const std::complex<float> t(w.real() * b.real() - w.imag() * b.imag(),
+                                            w.real() * b.imag() + w.imag() * b.real());
+                b = a - t;
+                a += t;
+            }
+        }
+    }
+
+    // Bins sum to the block power for white noise, negative frequencies first
+    const double scale = 1.0 / (static_cast<double>(fftSize) * windowPower);
+    const size_t half  = fftSize / 2;
+    for (size_t k = 0; k < fftSize; k++)
+    {
+        const std::complex<float> &X = work[k];
+        spectrum[(k + half) & (fftSize - 1)] += (X.real() * X.real() + X.imag() * X.imag()) * scale;
+    }
+
+    blockCount++;
+    addPoint(power / fftSize);
+}
+
+void SDRIntegrator::addPoint(double power)
+{
+    pointSum += power;
+    if (++pointFill < pointBlocks)
+        return;
+
+    series[seriesCount++] = pointSum / pointBlocks;
+    pointSum  = 0;
+    pointFill = 0;
+
+    if (seriesCount == series.size())
+    {
+        for (size_t i = 0; i < seriesCount / 2; i++)
+            series[i] = (series[2 * i] + series[2 * i + 1]) / 2;
+        seriesCount /= 2;
+        pointBlocks *= 2;
+    }
+}
+
+size_t SDRIntegrator::getSpectrum(float *out) const
+{
+    if (blockCount == 0)
+        return 0;
+
+    for (size_t k = 0; k < fftSize; k++)
+        out[k] = static_cast<float>(spectrum[k] / blockCount);
+    return fftSize;
+}
+
+size_t SDRIntegrator::getTotalPower(double *power) const
+{
+    std::copy(series.begin(), series.begin() + seriesCount, power);
+    if (pointFill == 0)
+        return seriesCount;
+
+    power[seriesCount] = pointSum / pointFill;
+    return seriesCount + 1;
+}
@@ -0,0 +1,116 @@
+/*
+    sdr_integrator - streaming FFT integration for the INDI SDR spectrographs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The SDRIntegrator class integrates a stream of complex IQ samples into an averaged
+ * power spectrum and a total power time series.
+ *
+ * Samples are buffered until a block of bins samples is complete, then the block is windowed
+ * (Hann), transformed and its power added to the spectrum. All memory is allocated by the
+ * constructor, so the memory used does not depend on the integration time.
+ *
+ * Each point of the time series holds the mean power of blocksPerPoint() blocks. When the
+ * series is full, adjacent points are merged and blocksPerPoint() doubles.
+ */
+class SDRIntegrator
+{
+  public:
+    /**
+     * @param bins FFT size, a power of two.
+     * @param points capacity of the total power time series.
+     */
+    SDRIntegrator(size_t bins, size_t points);
+
+    /**
+     * @brief reset Clear the spectrum and the time series before a new integration.
+     * @param expectedSamples samples expected for the integration, 0 if unknown. It is
+     * used to pick a time resolution that fills the series without merging.
+     */
+    void reset(uint64_t expectedSamples = 0);
+
+    /** Add interleaved 8 bits offset binary I/Q bytes, as read from librtlsdr and rtl_tcp. */
+    void addU8(const uint8_t *iq, size_t bytes);
+
+    /** Add interleaved float I/Q samples, as read from LimeSuite with LMS_FMT_F32. */
+    void addF32(const float *iq, size_t samples);
+
+    /**
+     * @brief getSpectrum Copy the mean power spectrum, with DC at bin bins() / 2.
+     * The bins sum to the mean power of the samples.
+     * @return number of bins written, 0 if no block was complete.
+     */
+    size_t getSpectrum(float *spectrum) const;
+
+    /**
+     * @brief getTotalPower Copy the total power time series, including the last partial point.
+     * @return number of points written.
+     */
+    size_t getTotalPower(double *power) const;
+
+    size_t bins() const { return fftSize; }
+    size_t capacity() const { return series.size(); }
+    uint64_t blocks() const { return blockCount; }
+    uint64_t samples() const { return sampleCount; }
+    uint64_t blocksPerPoint() const { return pointBlocks; }
+
+  private:
+    template <typename Convert>
+    void add(size_t samples, Convert convert);
+    void processBlock();
+    void addPoint(double power);
+
+    size_t fftSize;
+    std::vector<float> window;
+    std::vector<std::complex<float>> twiddles;
+    std::vector<uint32_t> bitReverse;
+    std::vector<std::complex<float>> block;
+    std::vector<std::complex<float>> work;
+    size_t blockFill { 0 };
+    float windowPower { 0 };
+
+    std::vector<double> spectrum;
+    uint64_t blockCount { 0 };
+    uint64_t sampleCount { 0 };
+
+    std::vector<double> series;
+    size_t seriesCount { 0 };
+    uint64_t pointBlocks { 1 };
+    double pointSum { 0 };
+    uint64_t pointFill { 0 };
+
+    // Lookup table for the 8 bits samples, and the I byte of a sample split between reads
+    float u8Table[256];
+    int pendingI { -1 };
+};
+
+typedef struct _IBLOBVectorProperty IBLOBVectorProperty;
+
+/**
+ * @brief sendTotalPower Send the total power time series of an integration as a FITS BLOB
+ * in the first BLOB of property. Defined in sdr_total_power.cpp, which only the drivers build.
+ * @param sampleRate sample rate in Hz, to report the time resolution.
+ * @return number of points sent, 0 if there were none or the FITS could not be created.
+ */
+size_t sendTotalPower(const SDRIntegrator &integrator, IBLOBVectorProperty *property, double sampleRate);
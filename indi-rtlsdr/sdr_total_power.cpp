@@ -0,0 +1,61 @@
+/*
+    sdr_integrator - streaming FFT integration for the INDI SDR spectrographs
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "sdr_integrator.h"
+
+#include <dsp.h>
+#include <indidevapi.h>
+#include <indilogger.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+size_t sendTotalPower(const SDRIntegrator &integrator, IBLOBVectorProperty *property, double sampleRate)
+{
+    std::vector<double> power(integrator.capacity());
+    size_t points = integrator.getTotalPower(power.data());
+    if (points == 0)
+        return 0;
+
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, static_cast<int>(points));
+    dsp_stream_alloc_buffer(stream, stream->len);
+    std::copy(power.begin(), power.begin() + points, stream->buf);
+
+    size_t memsize = 0;
+    void *fits     = dsp_file_write_fits(-32, &memsize, stream);
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+    if (fits == nullptr)
+    {
+        DEBUGDEVICE(property->device, INDI::Logger::DBG_ERROR, "Unable to create the total power FITS.");
+        return 0;
+    }
+
+    IBLOB *blob   = property->bp;
+    blob->blob    = fits;
+    blob->bloblen = blob->size = static_cast<int>(memsize);
+    property->s   = IPS_OK;
+    IDSetBLOB(property, nullptr);
+    free(fits);
+    blob->blob = nullptr;
+
+    DEBUGFDEVICE(property->device, INDI::Logger::DBG_SESSION, "Total power: %zu points of %.3f ms.", points,
+                 integrator.blocksPerPoint() * integrator.bins() * 1000.0 / sampleRate);
+    return points;
+}
@@ -48,6 +48,11 @@
 #define MAX_DEVICES         20   /* Max device cameraCount */
 #define MAX_THREAD_RETRIES  3
 #define MAX_THREAD_WAIT     300000
+#define READOUT_BATCH_MS    100  /* Default time the imaging chip readout holds the driver */
+
+/* Simulated readout speed, close to a USB 2 STXL */
+#define SIM_PIXEL_RATE       1000000
+#define SIM_LINE_OVERHEAD_US 100
 
 static int cameraCount;
 static SBIGCCD *cameras[MAX_DEVICES];
@@ -157,6 +162,33 @@ void ISSnoopDevice(XMLEle *root)
 
 //==========================================================================
 
+void SBIGLock::lock()
+{
+    std::unique_lock<std::mutex> guard(m_Mutex);
+    if (m_Depth > 0 && m_Owner == std::this_thread::get_id())
+    {
+        m_Depth++;
+        return;
+    }
+    uint32_t ticket = m_NextTicket++;
+    m_Condition.wait(guard, [&] { return m_Serving == ticket; });
+    m_Owner = std::this_thread::get_id();
+    m_Depth = 1;
+}
+
+void SBIGLock::unlock()
+{
+    std::lock_guard<std::mutex> guard(m_Mutex);
+    if (--m_Depth == 0)
+    {
+        m_Owner = std::thread::id();
+        m_Serving++;
+        m_Condition.notify_all();
+    }
+}
+
+//==========================================================================
+
 void SBIGCCD::loadFirmwareOnOSXifNeeded()
 {
     // Upload firmware in case of MacOS
@@ -371,6 +403,8 @@ int SBIGCCD::CloseDevice()
 SBIGCCD::SBIGCCD() : FilterInterface(this)
 {
     InitVars();
+    m_ReadoutBusy[READOUT_PRIMARY] = m_ReadoutBusy[READOUT_GUIDE] = false;
+    m_ReadoutAbort[READOUT_PRIMARY] = m_ReadoutAbort[READOUT_GUIDE] = false;
     int res = OpenDriver();
     if (res != CE_NO_ERROR)
         LOGF_DEBUG("%s: Error (%s)", __FUNCTION__, GetErrorString(res));
@@ -398,6 +432,7 @@ SBIGCCD::SBIGCCD() : FilterInterface(this)
 
 SBIGCCD::~SBIGCCD()
 {
+    stopReadoutThread();
     CloseDevice();
     CloseDriver();
 }
@@ -544,6 +579,24 @@ bool SBIGCCD::initProperties()
     IUFillSwitchVector(&FilterConnectionSP, FilterConnectionS, 2, getDeviceName(), "CFW_CONNECTION", "Connect",
                        FILTER_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // Readout progress of the primary camera
+    IUFillNumber(&ReadoutN[READOUT_PROGRESS], "READOUT_PROGRESS", "Progress [%]", "%.f", 0, 100, 0, 0);
+    IUFillNumber(&ReadoutN[READOUT_SPEED], "READOUT_SPEED", "Speed [kpx/s]", "%.f", 0, 1e6, 0, 0);
+    IUFillNumber(&ReadoutN[READOUT_GUIDE_FRAMES], "READOUT_GUIDE_FRAMES", "Guide frames", "%.f", 0, 1e6, 0, 0);
+    IUFillNumberVector(&ReadoutNP, ReadoutN, 3, getDeviceName(), "CCD_READOUT", "Readout", MAIN_CONTROL_TAB, IP_RO, 0,
+                       IPS_IDLE);
+
+    // Time the primary camera readout holds the driver before guide head and status commands get their turn
+    IUFillNumber(&ReadoutBatchN[0], "BATCH_MS", "Batch [ms]", "%.f", 10, 2000, 10, READOUT_BATCH_MS);
+    IUFillNumberVector(&ReadoutBatchNP, ReadoutBatchN, 1, getDeviceName(), "CCD_READOUT_BATCH", "Readout", OPTIONS_TAB,
+                       IP_RW, 60, IPS_IDLE);
+
+    // When guide frames finished during a primary camera readout are read
+    IUFillSwitch(&ReadoutGuideS[READOUT_GUIDE_BETWEEN_BATCHES], "BETWEEN_BATCHES", "Between batches", ISS_ON);
+    IUFillSwitch(&ReadoutGuideS[READOUT_GUIDE_AFTER_READOUT], "AFTER_READOUT", "After readout", ISS_OFF);
+    IUFillSwitchVector(&ReadoutGuideSP, ReadoutGuideS, 2, getDeviceName(), "CCD_READOUT_GUIDE", "Guide readout",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
     /////////////////////////////////////////////////////////////////////////////
     /// Adaptive Optics
     /////////////////////////////////////////////////////////////////////////////
@@ -605,6 +658,10 @@ bool SBIGCCD::updateProperties()
             defineNumber(&CoolerNP);
         }
         defineSwitch(&IgnoreErrorsSP);
+        defineNumber(&ReadoutNP);
+        defineNumber(&ReadoutBatchNP);
+        if (HasGuideHead())
+            defineSwitch(&ReadoutGuideSP);
         if (m_hasFilterWheel)
         {
             defineSwitch(&FilterConnectionSP);
@@ -647,6 +704,10 @@ bool SBIGCCD::updateProperties()
             deleteProperty(CoolerNP.name);
         }
         deleteProperty(IgnoreErrorsSP.name);
+        deleteProperty(ReadoutNP.name);
+        deleteProperty(ReadoutBatchNP.name);
+        if (HasGuideHead())
+            deleteProperty(ReadoutGuideSP.name);
 
         if (m_hasAO)
         {
@@ -720,6 +781,15 @@ bool SBIGCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, ch
             IDSetSwitch(&PortSP, nullptr);
             return true;
         }
+        // Guide frames during a primary camera readout
+        else if (strcmp(name, ReadoutGuideSP.name) == 0)
+        {
+            IUUpdateSwitch(&ReadoutGuideSP, states, names, n);
+            m_ReadoutGuideBetweenBatches = ReadoutGuideS[READOUT_GUIDE_BETWEEN_BATCHES].s == ISS_ON;
+            ReadoutGuideSP.s = IPS_OK;
+            IDSetSwitch(&ReadoutGuideSP, nullptr);
+            return true;
+        }
         // Fan Status
         else if (strcmp(name, FanStateSP.name) == 0)
         {
@@ -836,6 +906,14 @@ bool SBIGCCD::ISNewNumber(const char *dev, const char *name, double values[], ch
             INDI::FilterInterface::processNumber(dev, name, values, names, n);
             return true;
         }
+        // Readout batch
+        else if (!strcmp(name, ReadoutBatchNP.name))
+        {
+            IUUpdateNumber(&ReadoutBatchNP, values, names, n);
+            ReadoutBatchNP.s = IPS_OK;
+            IDSetNumber(&ReadoutBatchNP, nullptr);
+            return true;
+        }
         // NS Adaptive Optics
         else if (!strcmp(name, AONSNP.name))
         {
@@ -933,6 +1011,8 @@ bool SBIGCCD::Connect()
 
             m_hasAO = AoCenter() == CE_NO_ERROR;
 
+            startReadoutThread();
+
             return true;
         }
         else
@@ -951,15 +1031,9 @@ bool SBIGCCD::Disconnect()
 {
     if (!isConnected())
         return true;
+    stopReadoutThread();
     m_useExternalTrackingCCD = false;
     m_hasGuideHead           = false;
-#ifdef ASYNC_READOUT
-    pthread_mutex_lock(&condMutex);
-    grabPredicate   = GRAB_PRIMARY_CCD;
-    terminateThread = true;
-    pthread_cond_signal(&cv);
-    pthread_mutex_unlock(&condMutex);
-#endif
     if (FilterConnectionS[0].s == ISS_ON)
         CFWDisconnect();
     if (CloseDevice() == CE_NO_ERROR)
@@ -1149,7 +1223,7 @@ int SBIGCCD::StartExposure(INDI::CCDChip *targetChip, double duration)
 
     for (int i = 0; i < MAX_THREAD_RETRIES; i++)
     {
-        std::unique_lock<std::mutex> guard(sbigLock);
+        std::unique_lock<SBIGLock> guard(sbigLock);
         res = StartExposure(&sep);
         guard.unlock();
         if (res == CE_NO_ERROR)
@@ -1186,6 +1260,12 @@ int SBIGCCD::StartExposure(INDI::CCDChip *targetChip, double duration)
 
 bool SBIGCCD::StartExposure(float duration)
 {
+    if (m_ReadoutBusy[READOUT_PRIMARY])
+    {
+        LOG_ERROR("Primary camera is still downloading the previous frame");
+        return false;
+    }
+
     ExposureRequest = duration;
 
     if (duration >= 3)
@@ -1205,6 +1285,12 @@ bool SBIGCCD::StartExposure(float duration)
 
 bool SBIGCCD::StartGuideExposure(float duration)
 {
+    if (m_ReadoutBusy[READOUT_GUIDE])
+    {
+        LOG_ERROR("Guide head is still downloading the previous frame");
+        return false;
+    }
+
     GuideExposureRequest = duration;
 
     if (duration >= 3)
@@ -1235,7 +1321,7 @@ int SBIGCCD::AbortExposure(INDI::CCDChip *targetChip)
     }
     EndExposureParams eep;
     eep.ccd = ccd;
-    std::unique_lock<std::mutex> guard(sbigLock);
+    std::unique_lock<SBIGLock> guard(sbigLock);
     int res = EndExposure(&eep);
     guard.unlock();
     return res;
@@ -1244,6 +1330,14 @@ int SBIGCCD::AbortExposure(INDI::CCDChip *targetChip)
 bool SBIGCCD::AbortExposure()
 {
     int res = CE_NO_ERROR;
+    // The exposure is over, drop the frame being downloaded
+    if (m_ReadoutBusy[READOUT_PRIMARY])
+    {
+        m_ReadoutAbort[READOUT_PRIMARY] = true;
+        InExposure = false;
+        LOG_DEBUG("Primary camera download aborted");
+        return true;
+    }
     LOG_DEBUG("Aborting primary camera exposure...");
     for (int i = 0; i < MAX_THREAD_RETRIES; i++)
     {
@@ -1267,6 +1361,13 @@ bool SBIGCCD::AbortExposure()
 bool SBIGCCD::AbortGuideExposure()
 {
     int res = CE_NO_ERROR;
+    if (m_ReadoutBusy[READOUT_GUIDE])
+    {
+        m_ReadoutAbort[READOUT_GUIDE] = true;
+        InGuideExposure = false;
+        LOG_DEBUG("Guide head download aborted");
+        return true;
+    }
     LOG_DEBUG("Aborting guide head exposure...");
     for (int i = 0; i < MAX_THREAD_RETRIES; i++)
     {
@@ -1282,7 +1383,7 @@ bool SBIGCCD::AbortGuideExposure()
         LOG_ERROR("Failed to abort guide head exposure");
         return false;
     }
-    InExposure = false;
+    InGuideExposure = false;
     LOG_DEBUG("Guide head exposure aborted");
     return true;
 }
@@ -1337,6 +1438,11 @@ bool SBIGCCD::updateFrameProperties(INDI::CCDChip *targetChip)
 
 bool SBIGCCD::UpdateCCDFrame(int x, int y, int w, int h)
 {
+    if (m_ReadoutBusy[READOUT_PRIMARY])
+    {
+        LOG_ERROR("Cannot change the main camera frame while a frame is downloading");
+        return false;
+    }
     LOGF_DEBUG("The final main camera image area is (%ld, %ld), (%ld, %ld)", x, y, w, h);
     PrimaryCCD.setFrame(x, y, w, h);
     int nbuf = (w * h * PrimaryCCD.getBPP() / 8) + 512;
@@ -1347,6 +1453,11 @@ bool SBIGCCD::UpdateCCDFrame(int x, int y, int w, int h)
 
 bool SBIGCCD::UpdateGuiderFrame(int x, int y, int w, int h)
 {
+    if (m_ReadoutBusy[READOUT_GUIDE])
+    {
+        LOG_ERROR("Cannot change the guide head frame while a frame is downloading");
+        return false;
+    }
     LOGF_DEBUG("The final guide head image area is (%ld, %ld), (%ld, %ld)", x, y, w, h);
     GuideCCD.setFrame(x, y, w, h);
     int nbuf = (w * h * GuideCCD.getBPP() / 8) + 512;
@@ -1460,82 +1571,202 @@ IPState SBIGCCD::GuideWest(uint32_t ms)
     return (ActivateRelay(&rp) == CE_NO_ERROR ? IPS_BUSY : IPS_ALERT);
 }
 
-#ifdef ASYNC_READOUT
-void *SBIGCCD::grabCCDHelper(void *context)
+void SBIGCCD::startReadoutThread()
 {
-    return ((SBIGCCD *)context)->grabCCD();
+    stopReadoutThread();
+    m_ReadoutRequest[READOUT_PRIMARY] = m_ReadoutRequest[READOUT_GUIDE] = false;
+    m_ReadoutBusy[READOUT_PRIMARY] = m_ReadoutBusy[READOUT_GUIDE] = false;
+    m_ReadoutTerminate = false;
+    m_ReadoutThread = std::thread(&SBIGCCD::readoutThread, this);
 }
 
-void *SBIGCCD::grabCCD()
+void SBIGCCD::stopReadoutThread()
 {
-    LOG_DEBUG("grabCCD thread started...");
-    INDI::CCDChip *targetChip = nullptr;
-    pthread_mutex_lock(&condMutex);
-    while (true)
+    if (!m_ReadoutThread.joinable())
+        return;
     {
-        while (grabPredicate == GRAB_NO_CCD)
-        {
-            pthread_cond_wait(&cv, &condMutex);
-        }
-        targetChip    = (grabPredicate == GRAB_PRIMARY_CCD) ? &PrimaryCCD : &GuideCCD;
-        grabPredicate = GRAB_NO_CCD;
-        if (terminateThread)
-            break;
-        pthread_mutex_unlock(&condMutex);
-        if (grabImage(targetChip) == false)
-        {
-            targetChip->setExposureFailed();
-        }
-        pthread_mutex_lock(&condMutex);
+        std::lock_guard<std::mutex> lock(m_ReadoutMutex);
+        m_ReadoutTerminate = true;
     }
-    pthread_mutex_unlock(&condMutex);
-    LOG_DEBUG("grabCCD thread finished");
-    return 0;
+    m_ReadoutCondition.notify_one();
+    m_ReadoutThread.join();
 }
-#endif
 
-bool SBIGCCD::grabImage(INDI::CCDChip *targetChip)
+void SBIGCCD::requestReadout(int chip)
 {
-    uint16_t left   = targetChip->getSubX() / targetChip->getBinX();
-    uint16_t top    = targetChip->getSubY() / targetChip->getBinX();
-    uint16_t width  = targetChip->getSubW() / targetChip->getBinX();
-    uint16_t height = targetChip->getSubH() / targetChip->getBinY();
+    m_ReadoutBusy[chip] = true;
+    m_ReadoutAbort[chip] = false;
+    {
+        std::lock_guard<std::mutex> lock(m_ReadoutMutex);
+        m_ReadoutRequest[chip] = true;
+    }
+    m_ReadoutCondition.notify_one();
+}
 
-    LOGF_DEBUG("%s readout in progress...", targetChip == &PrimaryCCD ? "Primary camera" : "Guide head");
+void SBIGCCD::readoutThread()
+{
+    LOG_DEBUG("Readout thread started...");
+    ReadoutJob primary {};
+    bool primaryActive = false;
+    bool guidePending = false;
+    uint32_t guideFrames = 0;
 
-    if (isSimulation())
+    std::unique_lock<std::mutex> lock(m_ReadoutMutex);
+    while (true)
     {
-        uint8_t *image = targetChip->getFrameBuffer();
-        for (int i = 0; i < height * 2; i++)
+        // While the imaging chip is read out, requests are only checked between batches
+        if (!primaryActive)
+            m_ReadoutCondition.wait(lock, [this]
         {
-            for (int j = 0; j < width; j++)
+            return m_ReadoutTerminate || m_ReadoutRequest[READOUT_PRIMARY] || m_ReadoutRequest[READOUT_GUIDE];
+        });
+        if (m_ReadoutTerminate)
+            break;
+        bool readGuide    = m_ReadoutRequest[READOUT_GUIDE];
+        bool startPrimary = m_ReadoutRequest[READOUT_PRIMARY];
+        m_ReadoutRequest[READOUT_PRIMARY] = m_ReadoutRequest[READOUT_GUIDE] = false;
+        lock.unlock();
+
+        // Guide frames are small and wanted as soon as possible, they are read ahead of the
+        // rest of the imaging frame unless they are set to wait for the end of its readout
+        guidePending = guidePending || readGuide;
+        if (guidePending && (!primaryActive || m_ReadoutGuideBetweenBatches))
+        {
+            readoutGuideFrame();
+            guidePending = false;
+            if (primaryActive)
+                guideFrames++;
+        }
+
+        if (startPrimary)
+        {
+            if (primaryActive)
+                endReadout(primary);
+            primaryActive = prepareReadout(&PrimaryCCD, primary);
+            guideFrames = 0;
+            if (!primaryActive)
             {
-                image[i * width + j] = rand() % 255;
+                m_ReadoutBusy[READOUT_PRIMARY] = false;
+                PrimaryCCD.setExposureFailed();
             }
         }
+
+        if (primaryActive)
+        {
+            primaryActive = readoutPrimaryBatch(primary, guideFrames);
+            if (!primaryActive && guidePending)
+            {
+                readoutGuideFrame();
+                guidePending = false;
+            }
+        }
+
+        lock.lock();
     }
-    else
+    lock.unlock();
+
+    if (primaryActive)
+        endReadout(primary);
+    m_ReadoutBusy[READOUT_PRIMARY] = m_ReadoutBusy[READOUT_GUIDE] = false;
+    LOG_DEBUG("Readout thread finished");
+}
+
+void SBIGCCD::readoutGuideFrame()
+{
+    ReadoutJob job {};
+    int res = CE_NO_ERROR;
+
+    if (!prepareReadout(&GuideCCD, job))
+        res = CE_BAD_PARAMETER;
+    while (res == CE_NO_ERROR && job.line < job.height && !m_ReadoutAbort[READOUT_GUIDE])
     {
-        uint16_t *buffer = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
-        int res                = 0;
-        for (int i = 0; i < MAX_THREAD_RETRIES; i++)
+        res = readoutBatch(job, 0);
+        if (res != CE_NO_ERROR && ++job.retries < MAX_THREAD_RETRIES)
         {
-            res = readoutCCD(left, top, width, height, buffer, targetChip);
-            if (res == CE_NO_ERROR)
-                break;
-            LOGF_DEBUG("Readout error, retrying...", res);
+            LOGF_DEBUG("Guide head readout error (%s), retrying...", GetErrorString(res));
+            endReadout(job);
             usleep(MAX_THREAD_WAIT);
+            res = CE_NO_ERROR;
         }
-        if (res != CE_NO_ERROR)
+    }
+
+    if (m_ReadoutAbort[READOUT_GUIDE])
+    {
+        if (job.line > 0 && job.line < job.height)
+            endReadout(job);
+        m_ReadoutBusy[READOUT_GUIDE] = false;
+        LOG_DEBUG("Guide head frame dropped");
+        return;
+    }
+    m_ReadoutBusy[READOUT_GUIDE] = false;
+    if (res != CE_NO_ERROR)
+    {
+        LOG_ERROR("Guide head readout error");
+        GuideCCD.setExposureFailed();
+        return;
+    }
+    LOG_DEBUG("Guide head readout complete");
+    ExposureComplete(&GuideCCD);
+}
+
+bool SBIGCCD::readoutPrimaryBatch(ReadoutJob &job, uint32_t guideFrames)
+{
+    if (m_ReadoutAbort[READOUT_PRIMARY])
+    {
+        if (job.line > 0)
+            endReadout(job);
+        m_ReadoutBusy[READOUT_PRIMARY] = false;
+        ReadoutNP.s = IPS_IDLE;
+        IDSetNumber(&ReadoutNP, nullptr);
+        LOG_DEBUG("Primary camera frame dropped");
+        return false;
+    }
+
+    uint16_t first = job.line;
+    auto start = std::chrono::steady_clock::now();
+    int res = readoutBatch(job, ReadoutBatchN[0].value / 1000.0);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (res != CE_NO_ERROR)
+    {
+        endReadout(job);
+        if (++job.retries < MAX_THREAD_RETRIES)
         {
-            LOGF_ERROR("%s readout error",
-                       targetChip == &PrimaryCCD ? "Primary camera" : "Guide head");
-            return false;
+            LOGF_DEBUG("Primary camera readout error (%s), retrying...", GetErrorString(res));
+            usleep(MAX_THREAD_WAIT);
+            return true;
         }
+        m_ReadoutBusy[READOUT_PRIMARY] = false;
+        ReadoutNP.s = IPS_ALERT;
+        IDSetNumber(&ReadoutNP, nullptr);
+        LOG_ERROR("Primary camera readout error");
+        PrimaryCCD.setExposureFailed();
+        return false;
     }
-    LOGF_DEBUG("%s readout complete", targetChip == &PrimaryCCD ? "Primary camera" : "Guide head");
-    ExposureComplete(targetChip);
-    return true;
+
+    double pixels = static_cast<double>(job.line - first) * job.width;
+    ReadoutN[READOUT_PROGRESS].value     = 100.0 * job.line / job.height;
+    ReadoutN[READOUT_SPEED].value        = elapsed.count() > 0 ? pixels / elapsed.count() / 1000.0 : 0;
+    ReadoutN[READOUT_GUIDE_FRAMES].value = guideFrames;
+    LOGF_DEBUG("Primary camera lines %d-%d of %d read in %.1f ms", first, job.line - 1, job.height,
+               elapsed.count() * 1000.0);
+
+    if (job.line < job.height)
+    {
+        ReadoutNP.s = IPS_BUSY;
+        IDSetNumber(&ReadoutNP, nullptr);
+        return true;
+    }
+
+    // Average speed over the whole download, including the interleaved commands
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - job.start;
+    ReadoutN[READOUT_SPEED].value = static_cast<double>(job.width) * job.height / total.count() / 1000.0;
+    ReadoutNP.s = IPS_OK;
+    IDSetNumber(&ReadoutNP, nullptr);
+    LOGF_DEBUG("Primary camera readout complete in %.2f s, %u guide frames read meanwhile", total.count(), guideFrames);
+    m_ReadoutBusy[READOUT_PRIMARY] = false;
+    ExposureComplete(&PrimaryCCD);
+    return false;
 }
 
 bool SBIGCCD::saveConfigItems(FILE *fp)
@@ -1545,6 +1776,8 @@ bool SBIGCCD::saveConfigItems(FILE *fp)
     IUSaveConfigSwitch(fp, &PortSP);
     IUSaveConfigText(fp, &IpTP);
     IUSaveConfigSwitch(fp, &IgnoreErrorsSP);
+    IUSaveConfigNumber(fp, &ReadoutBatchNP);
+    IUSaveConfigSwitch(fp, &ReadoutGuideSP);
 
     if (FilterNameT)
         INDI::FilterInterface::saveConfigItems(fp);
@@ -1572,8 +1805,7 @@ void SBIGCCD::TimerHit()
             LOG_DEBUG("Primay camera exposure done, downloading image...");
             targetChip->setExposureLeft(0);
             InExposure = false;
-            if (grabImage(targetChip) == false)
-                targetChip->setExposureFailed();
+            requestReadout(READOUT_PRIMARY);
         }
         else
         {
@@ -1592,8 +1824,7 @@ void SBIGCCD::TimerHit()
             LOG_DEBUG("Guide head exposure done, downloading image...");
             targetChip->setExposureLeft(0);
             InGuideExposure = false;
-            if (grabImage(targetChip) == false)
-                targetChip->setExposureFailed();
+            requestReadout(READOUT_GUIDE);
         }
         else
         {
@@ -1678,6 +1909,15 @@ int SBIGCCD::StartReadout(StartReadoutParams *srp)
 int SBIGCCD::ReadoutLine(ReadoutLineParams *rlp, uint16_t *results, bool bSubtract)
 {
     int res;
+    if (isSimulation())
+    {
+        // Model the time the camera takes to digitize and transfer a line
+        std::this_thread::sleep_for(std::chrono::microseconds(SIM_LINE_OVERHEAD_US +
+                                    rlp->pixelLength * 1000000LL / SIM_PIXEL_RATE));
+        for (int i = 0; i < rlp->pixelLength; i++)
+            results[i] = rand() % 255;
+        return CE_NO_ERROR;
+    }
     if (bSubtract)
     {
         res = SBIGUnivDrvCommand(CC_READ_SUBTRACT_LINE, rlp, results);
@@ -2243,6 +2483,8 @@ int SBIGCCD::SBIGUnivDrvCommand(PAR_COMMAND command, void *params, void *results
     {
         return CE_NO_ERROR;
     }
+    // Commands may come from the event loop and the readout thread
+    std::unique_lock<SBIGLock> guard(sbigLock);
     // Make sure we have a valid handle to the driver.
     if (GetDriverHandle() == INVALID_HANDLE_VALUE)
     {
@@ -2463,7 +2705,7 @@ void SBIGCCD::updateTemperature()
     bool enabled;
     double ccdTemp, setpointTemp, percentTE, power;
 
-    std::unique_lock<std::mutex> guard(sbigLock);
+    std::unique_lock<SBIGLock> guard(sbigLock);
     int res = QueryTemperatureStatus(enabled, ccdTemp, setpointTemp, percentTE);
     guard.unlock();
 
@@ -2553,7 +2795,7 @@ bool SBIGCCD::isExposureDone(INDI::CCDChip *targetChip)
 
     // Query command status:
     qcsp.command = CC_START_EXPOSURE2;
-    std::unique_lock<std::mutex> guard(sbigLock);
+    std::unique_lock<SBIGLock> guard(sbigLock);
     int res = QueryCommandStatus(&qcsp, &qcsr);
     if (res != CE_NO_ERROR)
     {
@@ -2584,60 +2826,93 @@ bool SBIGCCD::isExposureDone(INDI::CCDChip *targetChip)
 
 //==========================================================================
 
-int SBIGCCD::readoutCCD(uint16_t left, uint16_t top, uint16_t width, uint16_t height,
-                        uint16_t *buffer, INDI::CCDChip *targetChip)
+bool SBIGCCD::prepareReadout(INDI::CCDChip *targetChip, ReadoutJob &job)
 {
-    int h, ccd, binning, res;
+    job.chip = targetChip;
     if (targetChip == &PrimaryCCD)
     {
-        ccd = CCD_IMAGING;
+        job.ccd = CCD_IMAGING;
     }
     else
     {
-        ccd = m_useExternalTrackingCCD ? CCD_EXT_TRACKING : CCD_TRACKING;
+        job.ccd = m_useExternalTrackingCCD ? CCD_EXT_TRACKING : CCD_TRACKING;
     }
-    if ((res = getBinningMode(targetChip, binning)) != CE_NO_ERROR)
+    if (getBinningMode(targetChip, job.binning) != CE_NO_ERROR)
     {
-        return res;
+        return false;
     }
-    StartReadoutParams srp;
-    srp.ccd         = ccd;
-    srp.readoutMode = binning;
-    srp.left        = left;
-    srp.top         = top;
-    srp.width       = width;
-    srp.height      = height;
-    std::unique_lock<std::mutex> guard(sbigLock);
-    res = StartReadout(&srp);
-    if (res != CE_NO_ERROR)
-    {
-        LOGF_ERROR("%s readoutCCD - StartReadout error! (%s)",
-                   (targetChip == &PrimaryCCD) ? "Primary" : "Guide", GetErrorString(res));
-        guard.unlock();
-        return res;
+    job.left    = targetChip->getSubX() / targetChip->getBinX();
+    job.top     = targetChip->getSubY() / targetChip->getBinY();
+    job.width   = targetChip->getSubW() / targetChip->getBinX();
+    job.height  = targetChip->getSubH() / targetChip->getBinY();
+    job.buffer  = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
+    job.line    = 0;
+    job.retries = 0;
+    job.start   = std::chrono::steady_clock::now();
+    LOGF_DEBUG("%s readout in progress...", targetChip == &PrimaryCCD ? "Primary camera" : "Guide head");
+    return true;
+}
+
+// Reads lines for at most the given time, or up to the end of the frame if the time is 0.
+int SBIGCCD::readoutBatch(ReadoutJob &job, double seconds)
+{
+    int res;
+    const char *chipName = (job.chip == &PrimaryCCD) ? "Primary" : "Guide";
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>
+                    (std::chrono::duration<double>(seconds));
+    std::unique_lock<SBIGLock> guard(sbigLock);
+    if (job.line == 0)
+    {
+        StartReadoutParams srp;
+        srp.ccd         = job.ccd;
+        srp.readoutMode = job.binning;
+        srp.left        = job.left;
+        srp.top         = job.top;
+        srp.width       = job.width;
+        srp.height      = job.height;
+        res = StartReadout(&srp);
+        if (res != CE_NO_ERROR)
+        {
+            LOGF_ERROR("%s readoutBatch - StartReadout error! (%s)", chipName, GetErrorString(res));
+            return res;
+        }
     }
     ReadoutLineParams rlp;
-    rlp.ccd         = ccd;
-    rlp.readoutMode = binning;
-    rlp.pixelStart  = left;
-    rlp.pixelLength = width;
-    for (h = 0; h < height; h++)
+    rlp.ccd         = job.ccd;
+    rlp.readoutMode = job.binning;
+    rlp.pixelStart  = job.left;
+    rlp.pixelLength = job.width;
+    while (job.line < job.height)
     {
-        ReadoutLine(&rlp, buffer + (h * width), false);
+        if ((res = ReadoutLine(&rlp, job.buffer + (job.line * job.width), false)) != CE_NO_ERROR)
+        {
+            return res;
+        }
+        job.line++;
+        if (seconds > 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            return CE_NO_ERROR;
+        }
     }
     EndReadoutParams erp;
-    erp.ccd = ccd;
+    erp.ccd = job.ccd;
     if ((res = EndReadout(&erp)) != CE_NO_ERROR)
     {
-        LOGF_ERROR("%s readoutCCD - EndReadout error! (%s)",
-                   (targetChip == &PrimaryCCD) ? "Primary" : "Guide", GetErrorString(res));
-        guard.unlock();
-        return res;
+        LOGF_ERROR("%s readoutBatch - EndReadout error! (%s)", chipName, GetErrorString(res));
     }
-    guard.unlock();
     return res;
 }
 
+// Ends an unfinished readout, the next batch starts the frame over
+void SBIGCCD::endReadout(ReadoutJob &job)
+{
+    EndReadoutParams erp;
+    erp.ccd = job.ccd;
+    std::unique_lock<SBIGLock> guard(sbigLock);
+    EndReadout(&erp);
+    job.line = 0;
+}
+
 //==========================================================================
 
 int SBIGCCD::CFWConnect()
@@ -37,7 +37,12 @@
 #include <sbigudrv.h>
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #define DEVICE struct usb_device *
 
@@ -113,6 +118,26 @@ typedef enum { CCD_THERMISTOR, AMBIENT_THERMISTOR } THERMISTOR_TYPE;
 
 typedef unsigned long   ulong;            /* Short for unsigned long */
 
+/**
+ * @brief The SBIGLock class serializes the access to the SBIG Universal Driver. It is recursive, so
+ * that a command sequence can hold it across single commands, and it is granted in request order, so
+ * that the commands waiting for the driver get their turn between two line batches of a readout.
+ */
+class SBIGLock
+{
+    public:
+        void lock();
+        void unlock();
+
+    private:
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::thread::id m_Owner;
+        uint32_t m_Depth { 0 };
+        uint32_t m_NextTicket { 0 };
+        uint32_t m_Serving { 0 };
+};
+
 class SBIGCCD : public INDI::CCD, public INDI::FilterInterface
 {
     public:
@@ -128,9 +153,6 @@ class SBIGCCD : public INDI::CCD, public INDI::FilterInterface
         virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
         void updateTemperature();
         static void updateTemperatureHelper(void *);
-#ifdef ASYNC_READOUT
-        static void *grabCCDHelper(void *context);
-#endif
         bool isExposureDone(INDI::CCDChip *targetChip);
 
         static void NSGuideHelper(void *context);
@@ -259,6 +281,29 @@ class SBIGCCD : public INDI::CCD, public INDI::FilterInterface
         ISwitch FilterConnectionS[2];
         ISwitchVectorProperty FilterConnectionSP;
 
+        /////////////////////////////////////////////////////////////////////////////
+        /// Readout Properties
+        /////////////////////////////////////////////////////////////////////////////
+        INumberVectorProperty ReadoutNP;
+        INumber ReadoutN[3];
+        enum
+        {
+            READOUT_PROGRESS,
+            READOUT_SPEED,
+            READOUT_GUIDE_FRAMES,
+        };
+
+        INumberVectorProperty ReadoutBatchNP;
+        INumber ReadoutBatchN[1];
+
+        ISwitchVectorProperty ReadoutGuideSP;
+        ISwitch ReadoutGuideS[2];
+        enum
+        {
+            READOUT_GUIDE_BETWEEN_BATCHES,
+            READOUT_GUIDE_AFTER_READOUT,
+        };
+
         /////////////////////////////////////////////////////////////////////////////
         /// Camera capabilities
         /////////////////////////////////////////////////////////////////////////////
@@ -271,7 +316,46 @@ class SBIGCCD : public INDI::CCD, public INDI::FilterInterface
         /////////////////////////////////////////////////////////////////////////////
         /// Threading Variables
         /////////////////////////////////////////////////////////////////////////////
-        std::mutex sbigLock;
+        SBIGLock sbigLock;
+
+        /////////////////////////////////////////////////////////////////////////////
+        /// Readout Scheduler
+        /////////////////////////////////////////////////////////////////////////////
+        // Frames are read on a readout thread. The imaging chip is read in batches of lines
+        // and the driver is released between batches, so that guide frames, guide pulses and
+        // status queries do not wait for the whole download.
+        // By default a guide frame finished during an imaging download is read between two
+        // batches, with the imaging readout suspended. The SBIG universal driver does not
+        // document this for both CCDs, so CCD_READOUT_GUIDE can hold guide frames until the
+        // imaging readout ends instead.
+        typedef struct ReadoutJob
+        {
+            INDI::CCDChip *chip;
+            int ccd;
+            int binning;
+            uint16_t left, top, width, height;
+            uint16_t *buffer;
+            // Next line to read, 0 before the readout is started
+            uint16_t line;
+            int retries;
+            std::chrono::steady_clock::time_point start;
+        } ReadoutJob;
+
+        enum
+        {
+            READOUT_PRIMARY,
+            READOUT_GUIDE,
+        };
+
+        std::thread m_ReadoutThread;
+        std::mutex m_ReadoutMutex;
+        std::condition_variable m_ReadoutCondition;
+        bool m_ReadoutRequest[2] { false, false };
+        bool m_ReadoutTerminate { false };
+        // Set from the exposure being done until the frame is complete, dropped or failed
+        std::atomic<bool> m_ReadoutBusy[2];
+        std::atomic<bool> m_ReadoutAbort[2];
+        std::atomic<bool> m_ReadoutGuideBetweenBatches {true};
 
         /////////////////////////////////////////////////////////////////////////////
         /// Exposure Variables
@@ -402,8 +486,19 @@ class SBIGCCD : public INDI::CCD, public INDI::FilterInterface
         int getBinningMode(INDI::CCDChip *targetChip, int &binning);
         int getFrameType(INDI::CCDChip *targetChip, INDI::CCDChip::CCD_FRAME *frameType);
         int getShutterMode(INDI::CCDChip *targetChip, int &shutter);
-        int readoutCCD(unsigned short left, unsigned short top, unsigned short width, unsigned short height,
-                       unsigned short *buffer, INDI::CCDChip *targetChip);
+        bool prepareReadout(INDI::CCDChip *targetChip, ReadoutJob &job);
+        int readoutBatch(ReadoutJob &job, double seconds);
+        void endReadout(ReadoutJob &job);
+
+        /////////////////////////////////////////////////////////////////////////////
+        /// Readout Thread Functions
+        /////////////////////////////////////////////////////////////////////////////
+        void startReadoutThread();
+        void stopReadoutThread();
+        void requestReadout(int chip);
+        void readoutThread();
+        void readoutGuideFrame();
+        bool readoutPrimaryBatch(ReadoutJob &job, uint32_t guideFrames);
 
         /////////////////////////////////////////////////////////////////////////////
         /// Filter Wheel Functions
@@ -428,7 +523,6 @@ class SBIGCCD : public INDI::CCD, public INDI::FilterInterface
         /////////////////////////////////////////////////////////////////////////////
         /// Utility Functions
         /////////////////////////////////////////////////////////////////////////////
-        bool grabImage(INDI::CCDChip *targetChip);
         bool setupParams();
         // SBIG's software interface to the Universal Driver Library function:
         int SBIGUnivDrvCommand(PAR_COMMAND, void *, void *);
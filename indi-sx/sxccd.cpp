@@ -198,11 +198,15 @@ SXCCD::SXCCD(DEVICE device, const char *name)
     ExposureTimerID       = 0;
     DidFlush              = false;
     DidLatch              = false;
+    InExposure            = false;
     GuideExposureTimerID  = 0;
     InGuideExposure       = false;
     DidGuideLatch         = false;
     NSGuiderTimerID       = 0;
     WEGuiderTimerID       = 0;
+    ReadoutRequest[0]     = false;
+    ReadoutRequest[1]     = false;
+    ReadoutTerminate      = false;
     snprintf(this->name, 32, "SX CCD %s", name);
     setDeviceName(this->name);
     setVersion(VERSION_MAJOR, VERSION_MINOR);
@@ -210,6 +214,7 @@ SXCCD::SXCCD(DEVICE device, const char *name)
 
 SXCCD::~SXCCD()
 {
+    StopReadout();
     if (handle)
         sxClose(&handle);
 }
@@ -374,6 +379,8 @@ bool SXCCD::Connect()
 
             SetCCDCapability(cap);
 
+            StartReadout();
+
             return true;
         }
     }
@@ -382,6 +389,7 @@ bool SXCCD::Connect()
 
 bool SXCCD::Disconnect()
 {
+    StopReadout();
     if (handle != nullptr)
     {
         sxClose(&handle);
@@ -446,7 +454,9 @@ void SXCCD::TimerHit()
 {
     if (isConnected() && HasCooler)
     {
-        if (!DidLatch && !DidGuideLatch)
+        // The cooler is updated on the next tick if pixels are being read
+        std::unique_lock<std::mutex> usb(UsbMutex, std::try_to_lock);
+        if (usb.owns_lock())
         {
             unsigned char status;
             unsigned short temperature;
@@ -478,6 +488,19 @@ int SXCCD::SetTemperature(double temperature)
     TemperatureRequest = temperature;
     unsigned char status;
     unsigned short sx_temperature;
+
+    CoolerSP.s   = IPS_OK;
+    CoolerS[0].s = ISS_ON;
+    CoolerS[1].s = ISS_OFF;
+
+    // Left to TimerHit() while pixels are being read
+    std::unique_lock<std::mutex> usb(UsbMutex, std::try_to_lock);
+    if (!usb.owns_lock())
+    {
+        IDSetSwitch(&CoolerSP, nullptr);
+        return 0;
+    }
+
     sxSetCooler(handle, (unsigned char)(CoolerS[0].s == ISS_ON), (unsigned short)(TemperatureRequest * 10 + 2730),
                 &status, &sx_temperature);
     TemperatureReported = TemperatureN[0].value = (sx_temperature - 2730) / 10.0;
@@ -486,9 +509,6 @@ int SXCCD::SetTemperature(double temperature)
     else
         result = 0;
 
-    CoolerSP.s   = IPS_OK;
-    CoolerS[0].s = ISS_ON;
-    CoolerS[1].s = ISS_OFF;
     IDSetSwitch(&CoolerSP, nullptr);
 
     return result;
@@ -496,6 +516,11 @@ int SXCCD::SetTemperature(double temperature)
 
 bool SXCCD::StartExposure(float n)
 {
+    if (DidLatch)
+    {
+        LOG_ERROR("Previous frame is still being read out.");
+        return false;
+    }
     InExposure = true;
     PrimaryCCD.setExposureDuration(n);
     if (sxIsInterlaced(model) && PrimaryCCD.getBinY() == 1)
@@ -507,7 +532,10 @@ bool SXCCD::StartExposure(float n)
     else
         sxClearPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0);
     if (HasShutter && PrimaryCCD.getFrameType() != INDI::CCDChip::DARK_FRAME)
+    {
+        std::lock_guard<std::mutex> usb(UsbMutex);
         sxSetShutter(handle, 0);
+    }
     int time = (int)(1000 * n);
     if (time < 1)
         time = 1;
@@ -530,11 +558,15 @@ bool SXCCD::AbortExposure()
     {
         if (ExposureTimerID)
             IERmTimer(ExposureTimerID);
-        if (HasShutter)
+        // Once latched, the shutter is closed and the frame read out is dropped
+        if (HasShutter && !DidLatch)
+        {
+            std::lock_guard<std::mutex> usb(UsbMutex);
             sxSetShutter(handle, 1);
+        }
         ExposureTimerID = 0;
         PrimaryCCD.setExposureLeft(ExposureTimeLeft = 0);
-        DidLatch = false;
+        InExposure = false;
         DidFlush = false;
         return true;
     }
@@ -553,124 +585,20 @@ void SXCCD::ExposureTimerHit()
         }
         else
         {
-            int rc;
-            ExposureTimerID   = 0;
-            bool isInterlaced = sxIsInterlaced(model);
-            int subX          = PrimaryCCD.getSubX();
-            int subY          = PrimaryCCD.getSubY();
-            int subW          = PrimaryCCD.getSubW();
-            int subH          = PrimaryCCD.getSubH();
-            int binX          = PrimaryCCD.getBinX();
-            int binY          = PrimaryCCD.getBinY();
-            int subWW         = subW * 2;
-            bool isICX453     = sxIsICX453(model);
-            uint8_t *buf      = PrimaryCCD.getFrameBuffer();
-            int size;
-            if (isInterlaced && binY > 1)
-                size = subW * subH / 2 / binX / (binY / 2);
-            else
-                size = subW * subH / binX / binY;
-            if (HasShutter)
-                sxSetShutter(handle, 1);
-            DidLatch = true;
-            if (isInterlaced)
-            {
-                if (binY > 1)
-                {
-                    rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY / binY, subW, subH / 2, binX,
-                                       binY / 2);
-                    if (rc)
-                        rc = sxReadPixels(handle, buf, size * 2);
-                }
-                else
-                {
-                    rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_EVEN | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2, subW,
-                                       subH / 2, binX, 1);
-                    struct timeval tv;
-                    gettimeofday(&tv, nullptr);
-                    long startTime = tv.tv_sec * 1000000 + tv.tv_usec;
-                    if (rc)
-                        rc = sxReadPixels(handle, evenBuf, size);
-                    gettimeofday(&tv, nullptr);
-                    wipeDelay = tv.tv_sec * 1000000 + tv.tv_usec - startTime;
-                    if (rc)
-                        rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_ODD | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2,
-                                           subW, subH / 2, binX, 1);
-                    if (rc)
-                        rc = sxReadPixels(handle, oddBuf, size);
-                    if (rc)
-                    {
-                        for (int i = 0, j = 0; i < subH; i += 2, j++)
-                        {
-                            memcpy(buf + i * subWW, oddBuf + (j * subWW), subWW);
-                            memcpy(buf + ((i + 1) * subWW), evenBuf + (j * subWW), subWW);
-                        }
-                        //            deinterlace((unsigned short *)buf, subW, subH);
-                    }
-                }
-            }
-            else if (isICX453)
-            {
-                rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX * 2, subY / 2, subW * 2, subH / 2, binX, binY);
-                if (rc)
-                {
-                    if (binX == 1 && binY == 1)
-                    {
-                        rc = sxReadPixels(handle, evenBuf, size * 2);
-                        if (rc)
-                        {
-                            uint16_t *buf16 = reinterpret_cast<uint16_t *>(buf);
-                            uint16_t *evenBuf16 = reinterpret_cast<uint16_t *>(evenBuf);
-
-                            int offset_1 = 2, offset_2 = 3;
-                            if (strstr(getDeviceName(), "SXVF-M25C"))
-                            {
-                                // Patch by Greg Bosch on 2020-01-02 to fix bayer pattern
-                                // on SXVF-M25C.
-                                offset_1 = 3;
-                                offset_2 = 2;
-                            }
-
-                            for (int i = 0; i < subH; i += 2)
-                            {
-                                for (int j = 0; j < subW; j += 2)
-                                {
-                                    int isubW = i * subW;
-                                    int i1subW = (i + 1) * subW;
-                                    int j2 = j * 2;
-
-                                    buf16[isubW + j]  = evenBuf16[isubW + j2];
-                                    buf16[isubW + j + 1]  = evenBuf16[isubW + j2 + offset_1];
-                                    buf16[i1subW + j]  = evenBuf16[isubW + j2 + 1];
-                                    buf16[i1subW + j + 1]  = evenBuf16[isubW + j2 + offset_2];
-
-                                }
-                            }
-                        }
-                    }
-                    else
-                    {
-                        rc = sxReadPixels(handle, buf, size * 2);
-                    }
-                }
-            }
-            else
-            {
-                rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY, subW, subH, binX, binY);
-                if (rc)
-                    rc = sxReadPixels(handle, buf, size * 2);
-            }
-            DidLatch   = false;
-            InExposure = false;
-            PrimaryCCD.setExposureLeft(ExposureTimeLeft = 0);
-            if (rc)
-                ExposureComplete(&PrimaryCCD);
+            ExposureTimerID = 0;
+            DidLatch        = true;
+            RequestReadout(0);
         }
     }
 }
 
 bool SXCCD::StartGuideExposure(float n)
 {
+    if (DidGuideLatch)
+    {
+        LOG_ERROR("Previous guide frame is still being read out.");
+        return false;
+    }
     InGuideExposure = true;
     GuideCCD.setExposureDuration(n);
     sxClearPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 1);
@@ -690,7 +618,7 @@ bool SXCCD::AbortGuideExposure()
             IERmTimer(GuideExposureTimerID);
         GuideCCD.setExposureLeft(GuideExposureTimeLeft = 0);
         GuideExposureTimerID = 0;
-        DidGuideLatch        = false;
+        InGuideExposure      = false;
         return true;
     }
     return false;
@@ -700,25 +628,252 @@ void SXCCD::GuideExposureTimerHit()
 {
     if (InGuideExposure)
     {
-        int rc;
         GuideExposureTimerID = 0;
-        int subX             = GuideCCD.getSubX();
-        int subY             = GuideCCD.getSubY();
-        int subW             = GuideCCD.getSubW();
-        int subH             = GuideCCD.getSubH();
-        int binX             = GuideCCD.getBinX();
-        int binY             = GuideCCD.getBinY();
-        int size             = subW * subH / binX / binY;
-        uint8_t *buf         = GuideCCD.getFrameBuffer();
         DidGuideLatch        = true;
-        rc                   = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 1, subX, subY, subW, subH, binX, binY);
+        RequestReadout(1);
+    }
+}
+
+/*
+ * Rows of a field, or of a raw ICX453 frame, are rearranged as soon as they are read, while
+ * the next chunks are transferred.
+ */
+struct t_row_reorder
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    unsigned long rowBytes;
+    int rows;
+    // Interlaced: frame row of the first field row
+    int firstRow;
+    // ICX453: frame width and the positions of the second pixel of each pair
+    int subW;
+    int offset1, offset2;
+};
+
+static void interlacedRows(void *context, unsigned long offset, unsigned long count)
+{
+    t_row_reorder *reorder = static_cast<t_row_reorder *>(context);
+    int ready = (offset + count) / reorder->rowBytes;
+    for (; reorder->rows < ready; reorder->rows++)
+        memcpy(reorder->dst + (2 * reorder->rows + reorder->firstRow) * reorder->rowBytes,
+               reorder->src + reorder->rows * reorder->rowBytes, reorder->rowBytes);
+}
+
+static void icx453Rows(void *context, unsigned long offset, unsigned long count)
+{
+    t_row_reorder *reorder = static_cast<t_row_reorder *>(context);
+    const uint16_t *src16 = reinterpret_cast<const uint16_t *>(reorder->src);
+    uint16_t *dst16 = reinterpret_cast<uint16_t *>(reorder->dst);
+    int subW = reorder->subW;
+    int ready = (offset + count) / reorder->rowBytes;
+    // Every raw row holds two frame rows
+    for (; reorder->rows < ready; reorder->rows++)
+    {
+        const uint16_t *row = src16 + reorder->rows * 2 * subW;
+        uint16_t *even = dst16 + reorder->rows * 2 * subW;
+        uint16_t *odd = even + subW;
+        for (int j = 0; j < subW; j += 2)
+        {
+            int j2 = j * 2;
+            even[j]     = row[j2];
+            even[j + 1] = row[j2 + reorder->offset1];
+            odd[j]      = row[j2 + 1];
+            odd[j + 1]  = row[j2 + reorder->offset2];
+        }
+    }
+}
+
+void SXCCD::StartReadout()
+{
+    StopReadout();
+    ReadoutRequest[0] = ReadoutRequest[1] = false;
+    ReadoutTerminate = false;
+    ReadoutThread = std::thread(&SXCCD::ReadoutLoop, this);
+}
+
+void SXCCD::StopReadout()
+{
+    if (!ReadoutThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(ReadoutMutex);
+        ReadoutTerminate = true;
+    }
+    ReadoutCondition.notify_one();
+    ReadoutThread.join();
+}
+
+void SXCCD::RequestReadout(int camIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(ReadoutMutex);
+        ReadoutRequest[camIndex] = true;
+    }
+    ReadoutCondition.notify_one();
+}
+
+void SXCCD::ReadoutLoop()
+{
+    std::unique_lock<std::mutex> lock(ReadoutMutex);
+    while (true)
+    {
+        ReadoutCondition.wait(lock, [this] { return ReadoutTerminate || ReadoutRequest[0] || ReadoutRequest[1]; });
+        if (ReadoutTerminate)
+            break;
+        // Guide frames are small and guiding waits for them, they go first
+        int camIndex = ReadoutRequest[1] ? 1 : 0;
+        ReadoutRequest[camIndex] = false;
+        lock.unlock();
+        if (camIndex == 1)
+            ReadGuidePixels();
+        else
+            ReadPixels();
+        lock.lock();
+    }
+}
+
+void SXCCD::ReadPixels()
+{
+    std::unique_lock<std::mutex> usb(UsbMutex);
+    int rc;
+    bool isInterlaced = sxIsInterlaced(model);
+    int subX          = PrimaryCCD.getSubX();
+    int subY          = PrimaryCCD.getSubY();
+    int subW          = PrimaryCCD.getSubW();
+    int subH          = PrimaryCCD.getSubH();
+    int binX          = PrimaryCCD.getBinX();
+    int binY          = PrimaryCCD.getBinY();
+    bool isICX453     = sxIsICX453(model);
+    uint8_t *buf      = PrimaryCCD.getFrameBuffer();
+    int size;
+    if (isInterlaced && binY > 1)
+        size = subW * subH / 2 / binX / (binY / 2);
+    else
+        size = subW * subH / binX / binY;
+    if (HasShutter)
+        sxSetShutter(handle, 1);
+    if (isInterlaced)
+    {
+        if (binY > 1)
+        {
+            rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY / binY, subW, subH / 2, binX,
+                               binY / 2);
+            if (rc)
+                rc = sxReadPixelsAsync(handle, buf, size * 2, nullptr, nullptr);
+        }
+        else
+        {
+            // Field rows are interleaved into the frame while the rest of the field is read
+            t_row_reorder reorder;
+            memset(&reorder, 0, sizeof(reorder));
+            reorder.dst      = buf;
+            reorder.rowBytes = subW / binX * 2;
+
+            rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_EVEN | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2, subW,
+                               subH / 2, binX, 1);
+            struct timeval tv;
+            gettimeofday(&tv, nullptr);
+            long startTime = tv.tv_sec * 1000000 + tv.tv_usec;
+            reorder.src      = reinterpret_cast<uint8_t *>(evenBuf);
+            reorder.firstRow = 1;
+            if (rc)
+                rc = sxReadPixelsAsync(handle, evenBuf, size, interlacedRows, &reorder);
+            gettimeofday(&tv, nullptr);
+            wipeDelay = tv.tv_sec * 1000000 + tv.tv_usec - startTime;
+            if (rc)
+                rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_ODD | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2,
+                                   subW, subH / 2, binX, 1);
+            reorder.src      = reinterpret_cast<uint8_t *>(oddBuf);
+            reorder.rows     = 0;
+            reorder.firstRow = 0;
+            if (rc)
+                rc = sxReadPixelsAsync(handle, oddBuf, size, interlacedRows, &reorder);
+        }
+    }
+    else if (isICX453)
+    {
+        rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX * 2, subY / 2, subW * 2, subH / 2, binX, binY);
         if (rc)
-            rc = sxReadPixels(handle, buf, size);
-        DidGuideLatch   = false;
-        InGuideExposure = false;
-        GuideCCD.setExposureLeft(GuideExposureTimeLeft = 0);
+        {
+            if (binX == 1 && binY == 1)
+            {
+                t_row_reorder reorder;
+                memset(&reorder, 0, sizeof(reorder));
+                reorder.src      = reinterpret_cast<uint8_t *>(evenBuf);
+                reorder.dst      = buf;
+                reorder.rowBytes = subW * 2 * 2;
+                reorder.subW     = subW;
+                reorder.offset1  = 2;
+                reorder.offset2  = 3;
+                if (strstr(getDeviceName(), "SXVF-M25C"))
+                {
+                    // Patch by Greg Bosch on 2020-01-02 to fix bayer pattern
+                    // on SXVF-M25C.
+                    reorder.offset1 = 3;
+                    reorder.offset2 = 2;
+                }
+                rc = sxReadPixelsAsync(handle, evenBuf, size * 2, icx453Rows, &reorder);
+            }
+            else
+            {
+                rc = sxReadPixelsAsync(handle, buf, size * 2, nullptr, nullptr);
+            }
+        }
+    }
+    else
+    {
+        rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY, subW, subH, binX, binY);
         if (rc)
-            ExposureComplete(&GuideCCD);
+            rc = sxReadPixelsAsync(handle, buf, size * 2, nullptr, nullptr);
+    }
+    usb.unlock();
+
+    // An exposure aborted during the readout is dropped
+    bool aborted = !InExposure;
+    DidLatch   = false;
+    InExposure = false;
+    PrimaryCCD.setExposureLeft(ExposureTimeLeft = 0);
+    if (aborted)
+        return;
+    if (rc)
+        ExposureComplete(&PrimaryCCD);
+    else
+    {
+        LOG_ERROR("Failed to read pixels.");
+        PrimaryCCD.setExposureFailed();
+    }
+}
+
+void SXCCD::ReadGuidePixels()
+{
+    std::unique_lock<std::mutex> usb(UsbMutex);
+    int rc;
+    int subX     = GuideCCD.getSubX();
+    int subY     = GuideCCD.getSubY();
+    int subW     = GuideCCD.getSubW();
+    int subH     = GuideCCD.getSubH();
+    int binX     = GuideCCD.getBinX();
+    int binY     = GuideCCD.getBinY();
+    int size     = subW * subH / binX / binY;
+    uint8_t *buf = GuideCCD.getFrameBuffer();
+    rc           = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 1, subX, subY, subW, subH, binX, binY);
+    if (rc)
+        rc = sxReadPixelsAsync(handle, buf, size, nullptr, nullptr);
+    usb.unlock();
+
+    bool aborted    = !InGuideExposure;
+    DidGuideLatch   = false;
+    InGuideExposure = false;
+    GuideCCD.setExposureLeft(GuideExposureTimeLeft = 0);
+    if (aborted)
+        return;
+    if (rc)
+        ExposureComplete(&GuideCCD);
+    else
+    {
+        LOG_ERROR("Failed to read guide pixels.");
+        GuideCCD.setExposureFailed();
     }
 }
 
@@ -853,6 +1008,7 @@ bool SXCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, char
         IUUpdateSwitch(&ShutterSP, states, names, n);
         ShutterSP.s = IPS_OK;
         IDSetSwitch(&ShutterSP, nullptr);
+        std::lock_guard<std::mutex> usb(UsbMutex);
         sxSetShutter(handle, ShutterS[0].s != ISS_ON);
         result = true;
     }
@@ -861,13 +1017,18 @@ bool SXCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, char
         IUUpdateSwitch(&CoolerSP, states, names, n);
         CoolerSP.s = IPS_OK;
         IDSetSwitch(&CoolerSP, nullptr);
-        unsigned char status;
-        unsigned short temperature;
-        sxSetCooler(handle, (unsigned char)(CoolerS[0].s == ISS_ON), (unsigned short)(TemperatureRequest * 10 + 2730),
-                    &status, &temperature);
-        TemperatureReported = TemperatureN[0].value = (temperature - 2730) / 10.0;
-        TemperatureNP.s                             = IPS_OK;
-        IDSetNumber(&TemperatureNP, nullptr);
+        // Left to TimerHit() while pixels are being read
+        std::unique_lock<std::mutex> usb(UsbMutex, std::try_to_lock);
+        if (usb.owns_lock())
+        {
+            unsigned char status;
+            unsigned short temperature;
+            sxSetCooler(handle, (unsigned char)(CoolerS[0].s == ISS_ON), (unsigned short)(TemperatureRequest * 10 + 2730),
+                        &status, &temperature);
+            TemperatureReported = TemperatureN[0].value = (temperature - 2730) / 10.0;
+            TemperatureNP.s                             = IPS_OK;
+            IDSetNumber(&TemperatureNP, nullptr);
+        }
         result = true;
     }
     //    else if (strcmp(name, BayerSP.name) == 0)
@@ -35,6 +35,11 @@
 
 #include <indiccd.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 void ExposureTimerCallback(void *p);
 void GuideExposureTimerCallback(void *p);
 void WEGuiderTimerCallback(void *p);
@@ -64,10 +69,21 @@ class SXCCD : public INDI::CCD
         int WEGuiderTimerID;
         int NSGuiderTimerID;
         bool DidFlush;
-        bool DidLatch;
-        bool DidGuideLatch;
-        bool InGuideExposure;
+        std::atomic<bool> DidLatch;
+        std::atomic<bool> DidGuideLatch;
+        // Cleared by the readout thread
+        std::atomic<bool> InExposure;
+        std::atomic<bool> InGuideExposure;
         char GuideStatus;
+        // Readout worker, pixels are read off the INDI event loop
+        std::thread ReadoutThread;
+        std::mutex ReadoutMutex;
+        std::condition_variable ReadoutCondition;
+        bool ReadoutRequest[2];
+        bool ReadoutTerminate;
+        // Held while pixels are read and by commands with a reply, which comes on the same
+        // endpoint as the pixels. Commands without a reply can be sent at any time.
+        std::mutex UsbMutex;
 
     protected:
         const char *getDefaultName();
@@ -86,6 +102,12 @@ class SXCCD : public INDI::CCD
         void TimerHit();
         void ExposureTimerHit();
         void GuideExposureTimerHit();
+        void StartReadout();
+        void StopReadout();
+        void RequestReadout(int camIndex);
+        void ReadoutLoop();
+        void ReadPixels();
+        void ReadGuidePixels();
         void WEGuiderTimerHit();
         void NSGuiderTimerHit();
         //bool saveConfigItems(FILE *fp);
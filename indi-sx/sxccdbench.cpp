@@ -0,0 +1,302 @@
+/*
+ Starlight Xpress CCD INDI Driver
+
+ Readout benchmark against the libusb mock in sxccdmock.cpp. Compares the readout
+ run synchronously on the event loop, as the driver did before, with the asynchronous
+ readout run on a worker thread, and the deinterlacing of two fields done after the
+ readout with the deinterlacing done chunk by chunk while the transfers go on.
+
+ This program is free software; you can redistribute it and/or modify it
+ under the terms of the GNU General Public License as published by the Free
+ Software Foundation; either version 2 of the License, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ more details.
+
+ You should have received a copy of the GNU General Public License along with
+ this program; if not, write to the Free Software Foundation, Inc., 59
+ Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+ The full GNU General Public License is included in this distribution in the
+ file called LICENSE.
+ */
+
+#include "sxccdusb.h"
+#include "sxccdmock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Period of the simulated INDI timers
+#define TIMER_PERIOD_MS 10
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+ * Stand-in for the INDI event loop: runs a timer every TIMER_PERIOD_MS and the jobs
+ * posted to it, and records how late the timers fire.
+ */
+class EventLoop
+{
+    public:
+        EventLoop() : thread(&EventLoop::loop, this) {}
+
+        ~EventLoop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            condition.notify_one();
+            thread.join();
+        }
+
+        void post(std::function<void()> job)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(job);
+            condition.notify_one();
+        }
+
+        void resetLatency()
+        {
+            maxLatency = 0;
+        }
+
+        double latency() const
+        {
+            return maxLatency / 1000.0;
+        }
+
+    private:
+        void loop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            Clock::time_point next = Clock::now() + std::chrono::milliseconds(TIMER_PERIOD_MS);
+            while (running)
+            {
+                if (!jobs.empty())
+                {
+                    std::function<void()> job = jobs.front();
+                    jobs.erase(jobs.begin());
+                    lock.unlock();
+                    job();
+                    lock.lock();
+                    continue;
+                }
+                if (condition.wait_until(lock, next) == std::cv_status::timeout)
+                {
+                    long late = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - next).count();
+                    if (late > maxLatency)
+                        maxLatency = late;
+                    next = Clock::now() + std::chrono::milliseconds(TIMER_PERIOD_MS);
+                }
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<std::function<void()>> jobs;
+        std::atomic<long> maxLatency { 0 };
+        bool running { true };
+        std::thread thread;
+};
+
+struct t_field
+{
+    const unsigned short *src;
+    unsigned short *dst;
+    int width;
+    int rows;
+    int firstRow;
+};
+
+static void interlace(t_field *field, int ready)
+{
+    for (; field->rows < ready; field->rows++)
+        memcpy(field->dst + (2 * field->rows + field->firstRow) * field->width, field->src + field->rows * field->width,
+               field->width * 2);
+}
+
+static void fieldRows(void *context, unsigned long offset, unsigned long count)
+{
+    t_field *field = static_cast<t_field *>(context);
+    interlace(field, (offset + count) / (field->width * 2));
+}
+
+static double seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool checkFrame(const unsigned short *pixels, unsigned long count, unsigned latch)
+{
+    for (unsigned long i = 0; i < count; i++)
+        if (pixels[i] != sxMockPixel(latch, i))
+            return false;
+    return true;
+}
+
+static bool checkFields(const unsigned short *pixels, int width, int height, unsigned latch)
+{
+    for (int y = 0; y < height; y++)
+    {
+        // Even rows come from the first field read, odd rows from the second one
+        unsigned field = latch + ((y & 1) ? 1 : 0);
+        for (int x = 0; x < width; x++)
+            if (pixels[y * width + x] != sxMockPixel(field, (unsigned long)(y / 2) * width + x))
+                return false;
+    }
+    return true;
+}
+
+/* Blocks the caller until job has run on the event loop, as the driver's timer callbacks did */
+static void runOnLoop(EventLoop &loop, std::function<void()> job)
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    loop.post([&]
+    {
+        job();
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        condition.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return done; });
+}
+
+int main(int argc, char *argv[])
+{
+    int width      = argc > 1 ? atoi(argv[1]) : 2750;
+    int height     = argc > 2 ? atoi(argv[2]) : 2200;
+    double rate    = argc > 3 ? atof(argv[3]) * 1e6 : 40e6;
+    int frames     = argc > 4 ? atoi(argv[4]) : 3;
+    DEVICE devices[4];
+    const char *names[4];
+    HANDLE handle;
+    bool success = true;
+
+    if (width < 2 || height < 2 || rate <= 0 || frames < 1)
+    {
+        fprintf(stderr, "Usage: %s [width] [height] [MB/s] [frames]\n", argv[0]);
+        return 1;
+    }
+    height &= ~1;
+    sxMockSetup(0x94, width, height, rate);
+    if (sxList(devices, names, 4) < 1 || !sxOpen(devices[0], &handle))
+    {
+        fprintf(stderr, "Mock camera not found\n");
+        return 1;
+    }
+
+    unsigned long count = (unsigned long)width * height;
+    std::vector<unsigned short> frame(count), field(count / 2);
+    double mb = count * 2 / 1e6;
+    EventLoop loop;
+
+    printf("%dx%d pixels, %.1f MB frames, bus at %.1f MB/s, %d ms timers\n\n", width, height, mb, rate / 1e6,
+           TIMER_PERIOD_MS);
+
+    // Full frames, read on the event loop
+    double elapsed = 0;
+    bool valid = true;
+    loop.resetLatency();
+    for (int i = 0; i < frames; i++)
+    {
+        auto start = Clock::now();
+        runOnLoop(loop, [&]
+        {
+            sxLatchPixels(handle, 0x03, 0, 0, 0, width, height, 1, 1);
+            valid = sxReadPixels(handle, frame.data(), count * 2) && valid;
+        });
+        elapsed += seconds(start);
+        valid = checkFrame(frame.data(), count, sxMockLatches() - 1) && valid;
+    }
+    printf("frame  sync  on event loop   %7.1f MB/s   timer latency %7.1f ms   %s\n", frames * mb / elapsed,
+           loop.latency(), valid ? "OK" : "BAD PIXELS");
+    success = success && valid;
+
+    // Full frames, read asynchronously on a worker thread
+    elapsed = 0;
+    valid = true;
+    loop.resetLatency();
+    for (int i = 0; i < frames; i++)
+    {
+        auto start = Clock::now();
+        std::thread worker([&]
+        {
+            sxLatchPixels(handle, 0x03, 0, 0, 0, width, height, 1, 1);
+            valid = sxReadPixelsAsync(handle, frame.data(), count * 2, nullptr, nullptr) && valid;
+        });
+        worker.join();
+        elapsed += seconds(start);
+        valid = checkFrame(frame.data(), count, sxMockLatches() - 1) && valid;
+    }
+    printf("frame  async on worker       %7.1f MB/s   timer latency %7.1f ms   %s\n", frames * mb / elapsed,
+           loop.latency(), valid ? "OK" : "BAD PIXELS");
+    success = success && valid;
+
+    // Interlaced fields, deinterlaced once each field is read
+    elapsed = 0;
+    valid = true;
+    for (int i = 0; i < frames; i++)
+    {
+        memset(frame.data(), 0, count * 2);
+        auto start = Clock::now();
+        unsigned latch = sxMockLatches();
+        for (int f = 0; f < 2; f++)
+        {
+            t_field reorder = { field.data(), frame.data(), width, 0, f };
+            sxLatchPixels(handle, f ? 0x02 : 0x01, 0, 0, 0, width, height, 1, 2);
+            valid = sxReadPixels(handle, field.data(), count) && valid;
+            interlace(&reorder, height / 2);
+        }
+        elapsed += seconds(start);
+        valid = checkFields(frame.data(), width, height, latch) && valid;
+    }
+    printf("fields sync, copy after      %7.1f MB/s   %26s   %s\n", frames * mb / elapsed, "",
+           valid ? "OK" : "BAD PIXELS");
+    success = success && valid;
+
+    // Interlaced fields, deinterlaced chunk by chunk
+    elapsed = 0;
+    valid = true;
+    for (int i = 0; i < frames; i++)
+    {
+        memset(frame.data(), 0, count * 2);
+        auto start = Clock::now();
+        unsigned latch = sxMockLatches();
+        for (int f = 0; f < 2; f++)
+        {
+            t_field reorder = { field.data(), frame.data(), width, 0, f };
+            sxLatchPixels(handle, f ? 0x02 : 0x01, 0, 0, 0, width, height, 1, 2);
+            valid = sxReadPixelsAsync(handle, field.data(), count, fieldRows, &reorder) && valid;
+            valid = reorder.rows == height / 2 && valid;
+        }
+        elapsed += seconds(start);
+        valid = checkFields(frame.data(), width, height, latch) && valid;
+    }
+    printf("fields async, copy per chunk %7.1f MB/s   %26s   %s\n", frames * mb / elapsed, "",
+           valid ? "OK" : "BAD PIXELS");
+    success = success && valid;
+
+    sxClose(&handle);
+
+    printf("\n%s\n", success ? "PASSED" : "FAILED");
+    return success ? 0 : 1;
+}
@@ -0,0 +1,504 @@
+/*
+  Starlight Xpress CCD INDI Driver
+
+  libusb mock of a SX camera, for benchmarks and tests without hardware.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, and/or sell copies of the Software, and to permit persons
+  to whom the Software is furnished to do so, provided that the above
+  copyright notice(s) and this permission notice appear in all copies of
+  the Software and that both the above copyright notice(s) and this
+  permission notice appear in supporting documentation.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+  OF THIRD PARTY RIGHTS. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  HOLDERS INCLUDED IN THIS NOTICE BE LIABLE FOR ANY CLAIM, OR ANY SPECIAL
+  INDIRECT OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING
+  FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+  NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+  WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "sxccdmock.h"
+#include "sxccdusb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_VID      0x1278
+#define MOCK_PID      0x194
+#define MOCK_BULK_IN  0x82
+
+// SX commands answered by the mock, see sxccdusb.cpp
+#define MOCK_READ_PIXELS_DELAYED 2
+#define MOCK_READ_PIXELS         3
+#define MOCK_GET_CCD             8
+#define MOCK_CAMERA_MODEL        14
+#define MOCK_READ_PIXELS_GATED   18
+#define MOCK_COOLER              30
+
+// Pixels are streamed in blocks, transfers can be cancelled between two blocks
+#define MOCK_BLOCK_SIZE (64 * 1024)
+
+struct libusb_context
+{
+    int unused;
+};
+
+struct libusb_device
+{
+    struct libusb_device_descriptor descriptor;
+};
+
+struct libusb_device_handle
+{
+    libusb_device *device;
+};
+
+namespace
+{
+
+typedef struct Request
+{
+    // Null for synchronous transfers
+    struct libusb_transfer *transfer;
+    unsigned char *data;
+    int length;
+    int actual;
+    std::chrono::steady_clock::time_point deadline;
+    bool cancelled;
+    bool done;
+    enum libusb_transfer_status status;
+} Request;
+
+class MockCamera
+{
+    public:
+        MockCamera()
+        {
+            memset(&device.descriptor, 0, sizeof(device.descriptor));
+            device.descriptor.idVendor  = MOCK_VID;
+            device.descriptor.idProduct = MOCK_PID;
+        }
+
+        ~MockCamera()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            deviceCondition.notify_all();
+            if (thread.joinable())
+                thread.join();
+        }
+
+        void start()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running)
+            {
+                running = true;
+                thread  = std::thread(&MockCamera::deviceThread, this);
+            }
+        }
+
+        void command(const unsigned char *data, int length);
+        void submit(Request *request);
+        bool cancel(struct libusb_transfer *transfer);
+        int handleEvents(struct timeval *tv);
+
+        libusb_device device;
+        unsigned short model { 0x94 };
+        unsigned short width { 2750 };
+        unsigned short height { 2200 };
+        double rate { 40e6 };
+        unsigned latches { 0 };
+
+        std::mutex mutex;
+        std::condition_variable deviceCondition;
+        std::condition_variable doneCondition;
+
+    private:
+        void deviceThread();
+        void complete(Request *request, enum libusb_transfer_status status);
+
+        std::thread thread;
+        bool running { false };
+        std::deque<Request *> queue;
+        std::deque<struct libusb_transfer *> completed;
+        std::vector<unsigned char> reply;
+        // Pixel stream of the last latch
+        unsigned long streamOffset { 0 };
+        unsigned long streamSize { 0 };
+};
+
+MockCamera camera;
+
+void MockCamera::command(const unsigned char *data, int length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (length < 8)
+        return;
+    unsigned request = data[1];
+    unsigned wLength = data[6] | (data[7] << 8);
+    reply.clear();
+    if ((request == MOCK_READ_PIXELS || request == MOCK_READ_PIXELS_DELAYED || request == MOCK_READ_PIXELS_GATED) &&
+            length >= 18)
+    {
+        unsigned w    = data[12] | (data[13] << 8);
+        unsigned h    = data[14] | (data[15] << 8);
+        unsigned xbin = std::max<unsigned>(data[16], 1);
+        unsigned ybin = std::max<unsigned>(data[17], 1);
+        streamOffset  = 0;
+        streamSize    = (unsigned long)(w / xbin) * (h / ybin) * 2;
+        // The delay of the delayed and gated readouts is not simulated
+        latches++;
+    }
+    else if (data[0] & 0x80)
+    {
+        reply.assign(wLength, 0);
+        if (request == MOCK_CAMERA_MODEL && wLength >= 2)
+        {
+            reply[0] = model & 0xFF;
+            reply[1] = model >> 8;
+        }
+        else if (request == MOCK_GET_CCD && wLength >= 17)
+        {
+            reply[2]  = width & 0xFF;
+            reply[3]  = width >> 8;
+            reply[6]  = height & 0xFF;
+            reply[7]  = height >> 8;
+            // 4.54 um pixels
+            reply[8]  = reply[10] = 0x8A;
+            reply[9]  = reply[11] = 0x04;
+            reply[12] = 0xFF;
+            reply[13] = 0x0F;
+            reply[14] = 16;
+            reply[16] = SXCCD_CAPS_STAR2K | SXUSB_CAPS_COOLER;
+        }
+    }
+    else if (request == MOCK_COOLER)
+    {
+        // The cooler answers although the request has no data stage
+        reply.assign(3, 0);
+        reply[0] = data[2];
+        reply[1] = data[3];
+        reply[2] = data[4];
+    }
+    deviceCondition.notify_all();
+}
+
+void MockCamera::submit(Request *request)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(request);
+    deviceCondition.notify_all();
+}
+
+bool MockCamera::cancel(struct libusb_transfer *transfer)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Request *request : queue)
+    {
+        if (request->transfer == transfer)
+        {
+            request->cancelled = true;
+            deviceCondition.notify_all();
+            return true;
+        }
+    }
+    return false;
+}
+
+void MockCamera::complete(Request *request, enum libusb_transfer_status status)
+{
+    request->status = status;
+    request->done   = true;
+    if (request->transfer != nullptr)
+    {
+        request->transfer->status        = status;
+        request->transfer->actual_length = request->actual;
+        completed.push_back(request->transfer);
+        delete request;
+    }
+    doneCondition.notify_all();
+}
+
+void MockCamera::deviceThread()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto next = std::chrono::steady_clock::now();
+    while (running)
+    {
+        if (queue.empty())
+        {
+            deviceCondition.wait(lock);
+            // The bus time lost while no transfer is queued is not caught up
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+        Request *request = queue.front();
+        if (request->cancelled)
+        {
+            queue.pop_front();
+            complete(request, LIBUSB_TRANSFER_CANCELLED);
+            continue;
+        }
+        if (!reply.empty())
+        {
+            request->actual = std::min<int>(request->length, reply.size());
+            memcpy(request->data, reply.data(), request->actual);
+            reply.clear();
+            queue.pop_front();
+            complete(request, LIBUSB_TRANSFER_COMPLETED);
+            continue;
+        }
+        if (streamOffset >= streamSize)
+        {
+            if (std::chrono::steady_clock::now() >= request->deadline)
+            {
+                queue.pop_front();
+                complete(request, LIBUSB_TRANSFER_TIMED_OUT);
+            }
+            else
+                deviceCondition.wait_until(lock, request->deadline);
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        // One block of pixels at the bus rate
+        unsigned long size = std::min<unsigned long>(request->length - request->actual, streamSize - streamOffset);
+        size = std::min<unsigned long>(size, MOCK_BLOCK_SIZE);
+        unsigned latch = latches - 1;
+        for (unsigned long i = 0; i < size; i++)
+        {
+            unsigned long offset = streamOffset + i;
+            unsigned short pixel = sxMockPixel(latch, offset / 2);
+            request->data[request->actual + i] = (offset & 1) ? pixel >> 8 : pixel & 0xFF;
+        }
+        streamOffset += size;
+        request->actual += size;
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(size / rate));
+        lock.unlock();
+        std::this_thread::sleep_until(next);
+        lock.lock();
+
+        // A transfer ends when it is full or with a short packet at the end of the frame
+        if (request->actual == request->length || streamOffset >= streamSize)
+        {
+            queue.pop_front();
+            complete(request, LIBUSB_TRANSFER_COMPLETED);
+        }
+    }
+}
+
+int MockCamera::handleEvents(struct timeval *tv)
+{
+    std::deque<struct libusb_transfer *> ready;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto timeout = std::chrono::seconds(tv->tv_sec) + std::chrono::microseconds(tv->tv_usec);
+        doneCondition.wait_for(lock, timeout, [this] { return !completed.empty(); });
+        ready.swap(completed);
+    }
+    // Callbacks run in the thread handling events, as with libusb
+    for (struct libusb_transfer *transfer : ready)
+        transfer->callback(transfer);
+    return 0;
+}
+
+struct libusb_interface_descriptor mockAltsetting;
+struct libusb_interface mockInterface = { &mockAltsetting, 1 };
+struct libusb_config_descriptor mockConfig;
+
+}
+
+void sxMockSetup(unsigned short model, unsigned short width, unsigned short height, double bytesPerSecond)
+{
+    std::lock_guard<std::mutex> lock(camera.mutex);
+    camera.model  = model;
+    camera.width  = width;
+    camera.height = height;
+    camera.rate   = bytesPerSecond;
+}
+
+unsigned sxMockLatches()
+{
+    std::lock_guard<std::mutex> lock(camera.mutex);
+    return camera.latches;
+}
+
+unsigned short sxMockPixel(unsigned latch, unsigned long index)
+{
+    return (index * 7 + latch * 0x1111) & 0xFFFF;
+}
+
+int LIBUSB_CALL libusb_init(libusb_context **ctx)
+{
+    static libusb_context context;
+    if (ctx != nullptr)
+        *ctx = &context;
+    camera.start();
+    return LIBUSB_SUCCESS;
+}
+
+ssize_t LIBUSB_CALL libusb_get_device_list(libusb_context *ctx, libusb_device ***list)
+{
+    (void)ctx;
+    *list      = static_cast<libusb_device **>(calloc(2, sizeof(libusb_device *)));
+    (*list)[0] = &camera.device;
+    return 1;
+}
+
+void LIBUSB_CALL libusb_free_device_list(libusb_device **list, int unref_devices)
+{
+    (void)unref_devices;
+    free(list);
+}
+
+libusb_device * LIBUSB_CALL libusb_ref_device(libusb_device *dev)
+{
+    return dev;
+}
+
+int LIBUSB_CALL libusb_get_device_descriptor(libusb_device *dev, struct libusb_device_descriptor *desc)
+{
+    *desc = dev->descriptor;
+    return LIBUSB_SUCCESS;
+}
+
+int LIBUSB_CALL libusb_get_config_descriptor(libusb_device *dev, uint8_t config_index, struct libusb_config_descriptor **config)
+{
+    (void)dev;
+    (void)config_index;
+    mockConfig.bNumInterfaces = 1;
+    mockConfig.interface      = &mockInterface;
+    *config                   = &mockConfig;
+    return LIBUSB_SUCCESS;
+}
+
+void LIBUSB_CALL libusb_free_config_descriptor(struct libusb_config_descriptor *config)
+{
+    (void)config;
+}
+
+int LIBUSB_CALL libusb_open(libusb_device *dev, libusb_device_handle **dev_handle)
+{
+    *dev_handle           = new libusb_device_handle;
+    (*dev_handle)->device = dev;
+    return LIBUSB_SUCCESS;
+}
+
+void LIBUSB_CALL libusb_close(libusb_device_handle *dev_handle)
+{
+    delete dev_handle;
+}
+
+int LIBUSB_CALL libusb_kernel_driver_active(libusb_device_handle *dev_handle, int interface_number)
+{
+    (void)dev_handle;
+    (void)interface_number;
+    return 0;
+}
+
+int LIBUSB_CALL libusb_detach_kernel_driver(libusb_device_handle *dev_handle, int interface_number)
+{
+    (void)dev_handle;
+    (void)interface_number;
+    return LIBUSB_SUCCESS;
+}
+
+int LIBUSB_CALL libusb_claim_interface(libusb_device_handle *dev_handle, int interface_number)
+{
+    (void)dev_handle;
+    (void)interface_number;
+    return LIBUSB_SUCCESS;
+}
+
+const char * LIBUSB_CALL libusb_error_name(int errcode)
+{
+    switch (errcode)
+    {
+        case LIBUSB_SUCCESS:
+            return "LIBUSB_SUCCESS";
+        case LIBUSB_ERROR_IO:
+            return "LIBUSB_ERROR_IO";
+        case LIBUSB_ERROR_TIMEOUT:
+            return "LIBUSB_ERROR_TIMEOUT";
+        case LIBUSB_ERROR_INTERRUPTED:
+            return "LIBUSB_ERROR_INTERRUPTED";
+        default:
+            return "LIBUSB_ERROR_OTHER";
+    }
+}
+
+int LIBUSB_CALL libusb_bulk_transfer(libusb_device_handle *dev_handle, unsigned char endpoint, unsigned char *data,
+                                     int length, int *actual_length, unsigned int timeout)
+{
+    (void)dev_handle;
+    if (!(endpoint & 0x80))
+    {
+        camera.command(data, length);
+        *actual_length = length;
+        return LIBUSB_SUCCESS;
+    }
+
+    Request request = Request();
+    request.data     = data;
+    request.length   = length;
+    request.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    camera.submit(&request);
+    std::unique_lock<std::mutex> lock(camera.mutex);
+    camera.doneCondition.wait(lock, [&request] { return request.done; });
+    *actual_length = request.actual;
+    return request.status == LIBUSB_TRANSFER_COMPLETED ? LIBUSB_SUCCESS : LIBUSB_ERROR_TIMEOUT;
+}
+
+struct libusb_transfer * LIBUSB_CALL libusb_alloc_transfer(int iso_packets)
+{
+    (void)iso_packets;
+    return static_cast<struct libusb_transfer *>(calloc(1, sizeof(struct libusb_transfer)));
+}
+
+void LIBUSB_CALL libusb_free_transfer(struct libusb_transfer *transfer)
+{
+    free(transfer);
+}
+
+int LIBUSB_CALL libusb_submit_transfer(struct libusb_transfer *transfer)
+{
+    if (transfer->endpoint != MOCK_BULK_IN)
+        return LIBUSB_ERROR_NOT_SUPPORTED;
+    Request *request   = new Request();
+    request->transfer  = transfer;
+    request->data      = transfer->buffer;
+    request->length    = transfer->length;
+    request->deadline  = std::chrono::steady_clock::now() + std::chrono::milliseconds(transfer->timeout);
+    camera.submit(request);
+    return LIBUSB_SUCCESS;
+}
+
+int LIBUSB_CALL libusb_cancel_transfer(struct libusb_transfer *transfer)
+{
+    return camera.cancel(transfer) ? LIBUSB_SUCCESS : LIBUSB_ERROR_NOT_FOUND;
+}
+
+int LIBUSB_CALL libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed)
+{
+    (void)ctx;
+    (void)completed;
+    return camera.handleEvents(tv);
+}
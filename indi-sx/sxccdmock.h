@@ -0,0 +1,41 @@
+/*
+  Starlight Xpress CCD INDI Driver
+
+  libusb mock of a SX camera, for benchmarks and tests without hardware.
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, and/or sell copies of the Software, and to permit persons
+  to whom the Software is furnished to do so, provided that the above
+  copyright notice(s) and this permission notice appear in all copies of
+  the Software and that both the above copyright notice(s) and this
+  permission notice appear in supporting documentation.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT
+  OF THIRD PARTY RIGHTS. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  HOLDERS INCLUDED IN THIS NOTICE BE LIABLE FOR ANY CLAIM, OR ANY SPECIAL
+  INDIRECT OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING
+  FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+  NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+  WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#pragma once
+
+/*
+ * The mock replaces libusb-1.0 at link time. It shows a single camera which answers the
+ * SX commands used by sxccdusb.cpp and streams pixels on the bulk IN endpoint at a fixed
+ * rate once they are latched.
+ */
+
+void sxMockSetup(unsigned short model, unsigned short width, unsigned short height, double bytesPerSecond);
+
+/* Number of frames or fields latched so far */
+unsigned sxMockLatches();
+
+/* Value of pixel index of the latch-th latched frame or field, counted from 0 */
+unsigned short sxMockPixel(unsigned latch, unsigned long index);
@@ -125,6 +125,12 @@
 //#warning "Intel mode, 16MB CHUNK_SIZE"
 #endif
 
+/*
+ * Asynchronous readout, ASYNC_TRANSFERS bulk transfers of ASYNC_CHUNK_SIZE are kept in flight.
+ */
+#define ASYNC_CHUNK_SIZE (512 * 1024)
+#define ASYNC_TRANSFERS  4
+
 #if 1
 #define TRACE(c) (c)
 #define DEBUG(c) (c)
@@ -755,6 +761,122 @@ int sxReadPixels(HANDLE sxHandle, void *pixels, unsigned long count)
     return rc >= 0;
 }
 
+struct t_sx_async_read
+{
+    HANDLE handle;
+    unsigned char *pixels;
+    unsigned long count;
+    unsigned long submitted;
+    unsigned long completed;
+    int active;
+    int rc;
+    sxReadProgress progress;
+    void *context;
+    struct libusb_transfer *transfers[ASYNC_TRANSFERS];
+    bool busy[ASYNC_TRANSFERS];
+};
+
+static void LIBUSB_CALL sxReadCallback(struct libusb_transfer *transfer);
+
+static bool sxSubmitChunk(struct t_sx_async_read *read, int index)
+{
+    int size = read->count - read->submitted;
+    if (size > ASYNC_CHUNK_SIZE)
+        size = ASYNC_CHUNK_SIZE;
+    struct libusb_transfer *transfer = read->transfers[index];
+    libusb_fill_bulk_transfer(transfer, read->handle, BULK_IN, read->pixels + read->submitted, size, sxReadCallback,
+                              read, BULK_DATA_TIMEOUT);
+    int rc = libusb_submit_transfer(transfer);
+    if (rc < 0)
+    {
+        DEBUG(log(true, "sxReadPixelsAsync: libusb_submit_transfer -> %s\n", libusb_error_name(rc)));
+        read->rc = rc;
+        return false;
+    }
+    read->submitted += size;
+    read->busy[index] = true;
+    read->active++;
+    return true;
+}
+
+static void LIBUSB_CALL sxReadCallback(struct libusb_transfer *transfer)
+{
+    struct t_sx_async_read *read = (struct t_sx_async_read *)transfer->user_data;
+    int index = 0;
+    while (read->transfers[index] != transfer)
+        index++;
+    read->busy[index] = false;
+    read->active--;
+    if (read->rc < 0)
+        return;
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+    {
+        read->rc = transfer->status == LIBUSB_TRANSFER_TIMED_OUT ? LIBUSB_ERROR_TIMEOUT : LIBUSB_ERROR_IO;
+        DEBUG(log(true, "sxReadPixelsAsync: transfer status %d\n", transfer->status));
+        return;
+    }
+    // Transfers on the same endpoint complete in order, a short one means the data went out of sync
+    if (transfer->actual_length != transfer->length)
+    {
+        read->rc = LIBUSB_ERROR_IO;
+        DEBUG(log(true, "sxReadPixelsAsync: short transfer %d of %d\n", transfer->actual_length, transfer->length));
+        return;
+    }
+    unsigned long offset = read->completed;
+    read->completed += transfer->actual_length;
+    // Queue the next chunk before processing this one, so that the bus stays busy
+    if (read->submitted < read->count)
+        sxSubmitChunk(read, index);
+    if (read->progress != nullptr)
+        read->progress(read->context, offset, transfer->actual_length);
+}
+
+int sxReadPixelsAsync(HANDLE sxHandle, void *pixels, unsigned long count, sxReadProgress progress, void *context)
+{
+    struct t_sx_async_read read;
+    memset(&read, 0, sizeof(read));
+    read.handle   = sxHandle;
+    read.pixels   = (unsigned char *)pixels;
+    read.count    = count;
+    read.progress = progress;
+    read.context  = context;
+    for (int i = 0; i < ASYNC_TRANSFERS; i++)
+    {
+        read.transfers[i] = libusb_alloc_transfer(0);
+        if (read.transfers[i] == nullptr)
+        {
+            for (int j = 0; j < i; j++)
+                libusb_free_transfer(read.transfers[j]);
+            int rc = sxReadPixels(sxHandle, pixels, count);
+            if (rc && progress != nullptr)
+                progress(context, 0, count);
+            return rc;
+        }
+    }
+    for (int i = 0; i < ASYNC_TRANSFERS && read.submitted < count && read.rc >= 0; i++)
+        sxSubmitChunk(&read, i);
+    bool cancelled = false;
+    while (read.active > 0)
+    {
+        if (read.rc < 0 && !cancelled)
+        {
+            for (int i = 0; i < ASYNC_TRANSFERS; i++)
+                if (read.busy[i])
+                    libusb_cancel_transfer(read.transfers[i]);
+            cancelled = true;
+        }
+        struct timeval tv = { 1, 0 };
+        int rc = libusb_handle_events_timeout_completed(ctx, &tv, nullptr);
+        if (rc < 0 && rc != LIBUSB_ERROR_INTERRUPTED && read.rc >= 0)
+            read.rc = rc;
+    }
+    for (int i = 0; i < ASYNC_TRANSFERS; i++)
+        libusb_free_transfer(read.transfers[i]);
+    DEBUG(log(true, "sxReadPixelsAsync: %lu of %lu bytes -> %s\n", read.completed, count,
+              read.rc < 0 ? libusb_error_name(read.rc) : "OK"));
+    return read.rc >= 0 && read.completed == count;
+}
+
 int sxSetSTAR2000(HANDLE sxHandle, char star2k)
 {
     unsigned char setup_data[8];
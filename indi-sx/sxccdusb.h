@@ -160,6 +160,12 @@ int sxExposePixelsGated(HANDLE sxHandle, unsigned short flags, unsigned short ca
                         unsigned short yoffset, unsigned short width, unsigned short height, unsigned short xbin,
                         unsigned short ybin, unsigned long msec);
 int sxReadPixels(HANDLE sxHandle, void *pixels, unsigned long count);
+/*
+ * Read pixels with several transfers in flight. Progress is called by libusb event handling
+ * for every chunk received, in order, while the next chunks are transferred.
+ */
+typedef void (*sxReadProgress)(void *context, unsigned long offset, unsigned long count);
+int sxReadPixelsAsync(HANDLE sxHandle, void *pixels, unsigned long count, sxReadProgress progress, void *context);
 int sxSetShutter(HANDLE sxHandle, unsigned short state);
 int sxSetTimer(HANDLE sxHandle, unsigned long msec);
 unsigned long sxGetTimer(HANDLE sxHandle);
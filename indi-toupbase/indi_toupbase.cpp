@@ -25,7 +25,9 @@
 
 #include <stream/streammanager.h>
 
+#include <algorithm>
 #include <math.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #define MAX_EXP_RETRIES         3
@@ -33,6 +35,9 @@
 #define TEMP_TIMER_MS           1000 /* Temperature polling time (ms) */
 #define TEMP_THRESHOLD          .25  /* Differential temperature threshold (C)*/
 #define MAX_DEVICES             4    /* Max device cameraCount */
+#define MAX_CLOCK_DRIFT         50e-6 /* Max drift between camera and system clocks (s/s) */
+#define STATS_UPDATE_PERIOD     1    /* Frame statistics update period (s) */
+#define MAX_POOL_FRAMES         2    /* Max free buffers kept by the frame pool */
 
 #define CONTROL_TAB "Controls"
 #define LEVEL_TAB "Levels"
@@ -334,6 +339,17 @@ bool ToupBase::initProperties()
     IUFillNumber(&ADCN[0], "ADC_BITDEPTH", "Bit Depth", "%.f", 8, 32, 0, 8);
     IUFillNumberVector(&ADCNP, ADCN, 1, getDeviceName(), "ADC", "ADC", IMAGE_INFO_TAB,  IP_RO, 60, IPS_IDLE);
 
+    ///////////////////////////////////////////////////////////////////////////////////
+    /// Frame Statistics
+    ///////////////////////////////////////////////////////////////////////////////////
+    IUFillNumber(&FrameStatsN[TC_STATS_FRAMES], "TC_STATS_FRAMES", "Frames", "%.f", 0, 1e9, 0, 0);
+    IUFillNumber(&FrameStatsN[TC_STATS_DROPPED], "TC_STATS_DROPPED", "Dropped", "%.f", 0, 1e9, 0, 0);
+    IUFillNumber(&FrameStatsN[TC_STATS_INTERVAL], "TC_STATS_INTERVAL", "Interval (ms)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&FrameStatsN[TC_STATS_JITTER], "TC_STATS_JITTER", "Jitter (ms)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&FrameStatsN[TC_STATS_MAX_INTERVAL], "TC_STATS_MAX_INTERVAL", "Max Interval (ms)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumberVector(&FrameStatsNP, FrameStatsN, 5, getDeviceName(), "TC_FRAME_STATS", "Frame Stats", IMAGE_INFO_TAB, IP_RO,
+                       60, IPS_IDLE);
+
     ///////////////////////////////////////////////////////////////////////////////////
     /// Gain Conversion settings
     ///////////////////////////////////////////////////////////////////////////////////
@@ -442,6 +458,7 @@ bool ToupBase::updateProperties()
         defineSwitch(&VideoFormatSP);
         defineSwitch(&ResolutionSP);
         defineNumber(&ADCNP);
+        defineNumber(&FrameStatsNP);
 
         if (m_Instance->model->flag & (CP(FLAG_CG) | CP(FLAG_CGHDR)))
         {
@@ -488,6 +505,7 @@ bool ToupBase::updateProperties()
         deleteProperty(VideoFormatSP.name);
         deleteProperty(ResolutionSP.name);
         deleteProperty(ADCNP.name);
+        deleteProperty(FrameStatsNP.name);
 
         if (m_Instance->model->flag & (CP(FLAG_CG) | CP(FLAG_CGHDR)))
         {
@@ -615,6 +633,9 @@ bool ToupBase::Disconnect()
 
     FP(Close(m_CameraHandle));
 
+    m_FramePool.clear();
+    m_ClockOffsetValid = false;
+
     return true;
 }
 
@@ -1788,6 +1809,8 @@ bool ToupBase::StartStreaming()
     }
     m_CurrentTriggerMode = TRIGGER_VIDEO;
 
+    resetFrameStats();
+
     return true;
 }
 
@@ -1812,6 +1835,9 @@ bool ToupBase::StopStreaming()
     // Return auto exposure to what it was
     FP(put_AutoExpoEnable(m_CameraHandle, AutoExposureS[TC_AUTO_EXPOSURE_ON].s == ISS_ON ? 1 : 0));
 
+    FrameStatsNP.s = IPS_OK;
+    IDSetNumber(&FrameStatsNP, nullptr);
+
     return true;
 }
 
@@ -2246,6 +2272,170 @@ void ToupBase::addFITSKeywords(fitsfile * fptr, INDI::CCDChip * targetChip)
         int status = 0;
         fits_update_key_s(fptr, TDOUBLE, "Gain", &(gainNP->value), "Gain", &status);
     }
+
+    int status = 0;
+
+    // The camera clock gives the start of the exposure to the microsecond, the base class only
+    // knows when the exposure was requested.
+    if (m_FrameInfo.flag & CP(FRAMEINFO_FLAG_TIMESTAMP))
+    {
+        double start = m_FrameTime - targetChip->getExposureDuration();
+        time_t t = static_cast<time_t>(start);
+        long us = lround((start - t) * 1e6);
+        if (us >= 1000000)
+        {
+            t++;
+            us -= 1000000;
+        }
+
+        char iso8601[32], dateObs[40];
+        strftime(iso8601, sizeof(iso8601), "%Y-%m-%dT%H:%M:%S", gmtime(&t));
+        snprintf(dateObs, sizeof(dateObs), "%s.%06ld", iso8601, us);
+        fits_update_key_str(fptr, "DATE-OBS", dateObs, "UTC start date of observation", &status);
+
+        LONGLONG timestamp = m_FrameInfo.timestamp;
+        fits_update_key_s(fptr, TLONGLONG, "HWTSTAMP", &timestamp, "Camera timestamp of the frame (us)", &status);
+    }
+
+    if (m_FrameInfo.flag & CP(FRAMEINFO_FLAG_SEQ))
+    {
+        unsigned int seq = m_FrameInfo.seq;
+        fits_update_key_s(fptr, TUINT, "FRAMESEQ", &seq, "Camera frame sequence number", &status);
+    }
+}
+
+ToupBase::FrameBuffer ToupBase::FramePool::acquire(size_t size)
+{
+    FrameBuffer buffer;
+
+    std::unique_lock<std::mutex> guard(m_Lock);
+    if (m_Free.empty() == false)
+    {
+        buffer = std::move(m_Free.back());
+        m_Free.pop_back();
+    }
+    guard.unlock();
+
+    // Buffers are only reallocated when the frame grows
+    if (buffer.size < size)
+    {
+        buffer.data.reset(new uint8_t[size]);
+        buffer.size = size;
+    }
+
+    return buffer;
+}
+
+void ToupBase::FramePool::release(FrameBuffer &&buffer)
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    if (m_Free.size() < MAX_POOL_FRAMES)
+        m_Free.push_back(std::move(buffer));
+}
+
+void ToupBase::FramePool::clear()
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    m_Free.clear();
+}
+
+void ToupBase::processFrameInfo(const XP(FrameInfoV2) &info, bool streaming)
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    double now = tv.tv_sec + tv.tv_usec / 1e6;
+    double frameTime = now;
+
+    if (info.flag & CP(FRAMEINFO_FLAG_TIMESTAMP))
+    {
+        double camera = info.timestamp / 1e6;
+        double offset = now - camera;
+
+        // A camera clock going backwards was restarted
+        if ((m_FrameInfo.flag & CP(FRAMEINFO_FLAG_TIMESTAMP)) && info.timestamp < m_FrameInfo.timestamp)
+            m_ClockOffsetValid = false;
+
+        // The frame with the shortest transfer gives the closest offset. The estimate is allowed
+        // to rise by the max clock drift so a slower camera clock is followed as well.
+        if (m_ClockOffsetValid)
+            m_ClockOffset = std::min(offset, m_ClockOffset + MAX_CLOCK_DRIFT * (now - m_ClockOffsetUpdate));
+        else
+            m_ClockOffset = offset;
+        m_ClockOffsetUpdate = now;
+        m_ClockOffsetValid = true;
+
+        frameTime = camera + m_ClockOffset;
+    }
+
+    if (streaming)
+    {
+        if (m_StatsFrames > 0)
+        {
+            // Gaps in the camera sequence are frames lost on the way
+            if ((info.flag & m_FrameInfo.flag & CP(FRAMEINFO_FLAG_SEQ)) && info.seq > m_FrameInfo.seq + 1)
+                m_StatsDropped += info.seq - m_FrameInfo.seq - 1;
+
+            double interval;
+            if (info.flag & m_FrameInfo.flag & CP(FRAMEINFO_FLAG_TIMESTAMP))
+                interval = (static_cast<double>(info.timestamp) - m_FrameInfo.timestamp) / 1000.0;
+            else
+                interval = (frameTime - m_FrameTime) * 1000.0;
+
+            m_StatsIntervals++;
+            m_StatsIntervalSum += interval;
+            m_StatsIntervalSquares += interval * interval;
+            m_StatsIntervalMax = std::max(m_StatsIntervalMax, interval);
+        }
+        m_StatsFrames++;
+    }
+
+    m_FrameInfo = info;
+    m_FrameTime = frameTime;
+
+    if (streaming && now - m_StatsUpdate >= STATS_UPDATE_PERIOD)
+    {
+        m_StatsUpdate = now;
+        updateFrameStats();
+    }
+}
+
+void ToupBase::resetFrameStats()
+{
+    m_StatsFrames = 0;
+    m_StatsDropped = 0;
+    m_StatsIntervals = 0;
+    m_StatsIntervalSum = 0;
+    m_StatsIntervalSquares = 0;
+    m_StatsIntervalMax = 0;
+    m_StatsUpdate = 0;
+
+    for (int i = 0; i < FrameStatsNP.nnp; i++)
+        FrameStatsN[i].value = 0;
+    FrameStatsNP.s = IPS_BUSY;
+    IDSetNumber(&FrameStatsNP, nullptr);
+}
+
+void ToupBase::updateFrameStats()
+{
+    FrameStatsN[TC_STATS_FRAMES].value = m_StatsFrames;
+    FrameStatsN[TC_STATS_DROPPED].value = m_StatsDropped;
+
+    // Interval and jitter of the frames since the last update
+    if (m_StatsIntervals > 0)
+    {
+        double mean = m_StatsIntervalSum / m_StatsIntervals;
+        double variance = m_StatsIntervalSquares / m_StatsIntervals - mean * mean;
+        FrameStatsN[TC_STATS_INTERVAL].value = mean;
+        FrameStatsN[TC_STATS_JITTER].value = variance > 0 ? sqrt(variance) : 0;
+        FrameStatsN[TC_STATS_MAX_INTERVAL].value = m_StatsIntervalMax;
+    }
+
+    m_StatsIntervals = 0;
+    m_StatsIntervalSum = 0;
+    m_StatsIntervalSquares = 0;
+    m_StatsIntervalMax = 0;
+
+    IDSetNumber(&FrameStatsNP, nullptr);
 }
 
 bool ToupBase::saveConfigItems(FILE * fp)
@@ -2315,6 +2505,21 @@ void ToupBase::AutoExposureChanged()
     // TODO
 }
 
+// RGB to three separate R-frame, G-frame, and B-frame for color FITS
+static void splitRGB(const uint8_t *rgb, uint8_t *image, uint32_t pixels)
+{
+    uint8_t *subR = image;
+    uint8_t *subG = image + pixels;
+    uint8_t *subB = image + pixels * 2;
+
+    for (uint32_t i = 0; i < pixels; i++)
+    {
+        subR[i] = rgb[i * 3];
+        subG[i] = rgb[i * 3 + 1];
+        subB[i] = rgb[i * 3 + 2];
+    }
+}
+
 void ToupBase::pushCB(const void* pData, const XP(FrameInfoV2)* pInfo, int bSnap, void* pCallbackCtx)
 {
     static_cast<ToupBase*>(pCallbackCtx)->pushCallback(pData, pInfo, bSnap);
@@ -2322,69 +2527,36 @@ void ToupBase::pushCB(const void* pData, const XP(FrameInfoV2)* pInfo, int bSnap
 
 void ToupBase::pushCallback(const void* pData, const XP(FrameInfoV2)* pInfo, int bSnap)
 {
-    //int captureBits = m_BitsPerPixel == 8 ? 8 : m_MaxBitDepth;
-
     INDI_UNUSED(bSnap);
 
     if (Streamer->isStreaming() || Streamer->isRecording())
     {
-        //std::unique_lock<std::mutex> guard(ccdBufferLock);
-        //HRESULT rc = FP(PullImageV2(m_CameraHandle, PrimaryCCD.getFrameBuffer(), captureBits * m_Channels, &info));
-        //guard.unlock();
-        //if (rc >= 0)
+        processFrameInfo(*pInfo, true);
         Streamer->newFrame(reinterpret_cast<const uint8_t*>(pData), PrimaryCCD.getFrameBufferSize());
     }
     else if (InExposure)
     {
         InExposure  = false;
         PrimaryCCD.setExposureLeft(0);
-        uint8_t *buffer = PrimaryCCD.getFrameBuffer();
-        uint32_t size = PrimaryCCD.getFrameBufferSize();
-
-        if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-        {
-            size = PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3;
-            buffer = static_cast<uint8_t*>(malloc(size));
-        }
 
-        //        std::unique_lock<std::mutex> guard(ccdBufferLock);
-        //        HRESULT rc = FP(PullImageV2(m_CameraHandle, buffer, captureBits * m_Channels, &info));
-        //        guard.unlock();
         if (pData == nullptr)
         {
             LOG_ERROR("Failed to push image.");
             PrimaryCCD.setExposureFailed();
-            if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                free(buffer);
         }
         else
         {
-            memcpy(buffer, pData, size);
+            const uint8_t *data = reinterpret_cast<const uint8_t*>(pData);
 
+            std::unique_lock<std::mutex> guard(ccdBufferLock);
             if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-            {
-                std::unique_lock<std::mutex> guard(ccdBufferLock);
-                uint8_t *image  = PrimaryCCD.getFrameBuffer();
-                uint32_t width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * (PrimaryCCD.getBPP() / 8);
-                uint32_t height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * (PrimaryCCD.getBPP() / 8);
-
-                uint8_t *subR = image;
-                uint8_t *subG = image + width * height;
-                uint8_t *subB = image + width * height * 2;
-                int size      = width * height * 3 - 3;
-
-                // RGB to three sepearate R-frame, G-frame, and B-frame for color FITS
-                for (int i = 0; i <= size; i += 3)
-                {
-                    *subR++ = buffer[i];
-                    *subG++ = buffer[i + 1];
-                    *subB++ = buffer[i + 2];
-                }
-
-                guard.unlock();
-                free(buffer);
-            }
+                splitRGB(data, PrimaryCCD.getFrameBuffer(), PrimaryCCD.getSubW() / PrimaryCCD.getBinX() *
+                         PrimaryCCD.getSubH() / PrimaryCCD.getBinY());
+            else
+                memcpy(PrimaryCCD.getFrameBuffer(), data, PrimaryCCD.getFrameBufferSize());
+            guard.unlock();
 
+            processFrameInfo(*pInfo, false);
             LOGF_DEBUG("Image received. Width: %d Height: %d flag: %d timestamp: %ld"
                        , pInfo->width,
                        pInfo->height,
@@ -2422,57 +2594,51 @@ void ToupBase::eventPullCallBack(unsigned event)
 
                 if (Streamer->isStreaming() || Streamer->isRecording())
                 {
-                    std::unique_lock<std::mutex> guard(ccdBufferLock);
-                    HRESULT rc = FP(PullImageV2(m_CameraHandle, PrimaryCCD.getFrameBuffer(), captureBits * m_Channels, &info));
-                    guard.unlock();
+                    // Stream frames are pulled into a recycled buffer and handed over as is, the
+                    // frame buffer stays free for exposures.
+                    uint32_t size = PrimaryCCD.getFrameBufferSize();
+                    FrameBuffer frame = m_FramePool.acquire(size);
+                    HRESULT rc = FP(PullImageV2(m_CameraHandle, frame.data.get(), captureBits * m_Channels, &info));
                     if (SUCCEEDED(rc))
-                        Streamer->newFrame(PrimaryCCD.getFrameBuffer(), PrimaryCCD.getFrameBufferSize());
+                    {
+                        processFrameInfo(info, true);
+                        Streamer->newFrame(frame.data.get(), size);
+                    }
+                    m_FramePool.release(std::move(frame));
                 }
                 else if (InExposure)
                 {
                     InExposure = false;
                     PrimaryCCD.setExposureLeft(0);
-                    uint8_t *buffer = PrimaryCCD.getFrameBuffer();
 
+                    HRESULT rc;
                     if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                        buffer = static_cast<uint8_t*>(malloc(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3));
+                    {
+                        // Interleaved RGB is pulled into a recycled buffer, then split into the frame buffer
+                        uint32_t pixels = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+                        FrameBuffer frame = m_FramePool.acquire(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3);
+                        rc = FP(PullImageV2(m_CameraHandle, frame.data.get(), captureBits * m_Channels, &info));
+                        if (SUCCEEDED(rc))
+                        {
+                            std::unique_lock<std::mutex> guard(ccdBufferLock);
+                            splitRGB(frame.data.get(), PrimaryCCD.getFrameBuffer(), pixels);
+                        }
+                        m_FramePool.release(std::move(frame));
+                    }
+                    else
+                    {
+                        std::unique_lock<std::mutex> guard(ccdBufferLock);
+                        rc = FP(PullImageV2(m_CameraHandle, PrimaryCCD.getFrameBuffer(), captureBits * m_Channels, &info));
+                    }
 
-                    std::unique_lock<std::mutex> guard(ccdBufferLock);
-                    HRESULT rc = FP(PullImageV2(m_CameraHandle, buffer, captureBits * m_Channels, &info));
-                    guard.unlock();
                     if (FAILED(rc))
                     {
                         LOGF_ERROR("Failed to pull image. %s", errorCodes[rc].c_str());
                         PrimaryCCD.setExposureFailed();
-                        if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                            free(buffer);
                     }
                     else
                     {
-                        if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                        {
-                            std::unique_lock<std::mutex> guard(ccdBufferLock);
-                            uint8_t *image  = PrimaryCCD.getFrameBuffer();
-                            uint32_t width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * (PrimaryCCD.getBPP() / 8);
-                            uint32_t height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * (PrimaryCCD.getBPP() / 8);
-
-                            uint8_t *subR = image;
-                            uint8_t *subG = image + width * height;
-                            uint8_t *subB = image + width * height * 2;
-                            int size      = width * height * 3 - 3;
-
-                            // RGB to three sepearate R-frame, G-frame, and B-frame for color FITS
-                            for (int i = 0; i <= size; i += 3)
-                            {
-                                *subR++ = buffer[i];
-                                *subG++ = buffer[i + 1];
-                                *subB++ = buffer[i + 2];
-                            }
-
-                            guard.unlock();
-                            free(buffer);
-                        }
-
+                        processFrameInfo(info, false);
                         LOGF_DEBUG("Image received. Width: %d Height: %d flag: %d timestamp: %ld", info.width, info.height, info.flag,
                                    info.timestamp);
                         ExposureComplete(&PrimaryCCD);
@@ -2507,6 +2673,7 @@ void ToupBase::eventPullCallBack(unsigned event)
                 {
                     PrimaryCCD.setExposureLeft(0);
                     InExposure  = false;
+                    processFrameInfo(info, false);
                     ExposureComplete(&PrimaryCCD);
                     LOGF_DEBUG("Image captured. Width: %d Height: %d flag: %d timestamp: %ld", info.width, info.height, info.flag,
                                info.timestamp);
@@ -22,6 +22,9 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <indiccd.h>
 
 #ifdef BUILD_TOUPCAM
@@ -409,6 +412,33 @@ class ToupBase : public INDI::CCD
         // Get the current Bayer string used
         const char *getBayerString();
 
+        //#############################################################################
+        // Frame Buffers & Timing
+        //#############################################################################
+        typedef struct FrameBuffer
+        {
+            std::unique_ptr<uint8_t[]> data;
+            size_t size { 0 };
+        } FrameBuffer;
+
+        // Buffers frames are pulled into, recycled instead of allocated for every frame
+        class FramePool
+        {
+            public:
+                FrameBuffer acquire(size_t size);
+                void release(FrameBuffer &&buffer);
+                void clear();
+
+            private:
+                std::mutex m_Lock;
+                std::vector<FrameBuffer> m_Free;
+        };
+
+        // Time the frame from the camera clock and update the streaming statistics
+        void processFrameInfo(const XP(FrameInfoV2) &info, bool streaming);
+        void resetFrameStats();
+        void updateFrameStats();
+
         //#############################################################################
         // Callbacks
         //#############################################################################
@@ -605,6 +635,18 @@ class ToupBase : public INDI::CCD
             GAIN_HDR
         };
 
+        // Frame Statistics
+        INumberVectorProperty FrameStatsNP;
+        INumber FrameStatsN[5];
+        enum
+        {
+            TC_STATS_FRAMES,
+            TC_STATS_DROPPED,
+            TC_STATS_INTERVAL,
+            TC_STATS_JITTER,
+            TC_STATS_MAX_INTERVAL,
+        };
+
         uint8_t m_CurrentVideoFormat = TC_VIDEO_COLOR_RGB;
         INDI_PIXEL_FORMAT m_CameraPixelFormat = INDI_RGB;
         eTriggerMode m_CurrentTriggerMode = TRIGGER_VIDEO;
@@ -625,6 +667,25 @@ class ToupBase : public INDI::CCD
         uint32_t m_MaxGainHCG { 0 };
         uint32_t m_NativeGain { 0 };
 
+        FramePool m_FramePool;
+
+        // Last frame pulled and its system time, from the camera clock when it has a timestamp
+        XP(FrameInfoV2) m_FrameInfo {};
+        double m_FrameTime { 0 };
+        // System time minus camera time (s)
+        double m_ClockOffset { 0 };
+        double m_ClockOffsetUpdate { 0 };
+        bool m_ClockOffsetValid { false };
+
+        // Streaming statistics, intervals are accumulated (ms) until the next update
+        uint32_t m_StatsFrames { 0 };
+        uint32_t m_StatsDropped { 0 };
+        uint32_t m_StatsIntervals { 0 };
+        double m_StatsIntervalSum { 0 };
+        double m_StatsIntervalSquares { 0 };
+        double m_StatsIntervalMax { 0 };
+        double m_StatsUpdate { 0 };
+
         friend void ::ISGetProperties(const char *dev);
         friend void ::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int num);
         friend void ::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int num);
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 */
 
+#include <chrono>
 #include <zlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -33,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 extern "C" {
 #endif
 #include "libavutil/dict.h"
+#include "libavutil/pixdesc.h"
 #ifdef __cplusplus 
 }
 #endif
@@ -41,6 +43,12 @@ extern "C" {
 
 std::unique_ptr<indi_webcam> webcam(new indi_webcam());
 
+//Seconds since start, for the capture timings
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
 void ISInit()
 {
     static int isInit =0;
@@ -143,7 +151,7 @@ void indi_webcam::findAVFoundationVideoSources()
     //Need to disconnect the source to probe the streams
     if(isConnected())
     {
-        avcodec_close(pCodecCtx);
+        avcodec_free_context(&pCodecCtx);
         avformat_close_input(&pFormatCtx);
     }
     else
@@ -156,7 +164,7 @@ void indi_webcam::findAVFoundationVideoSources()
             DEBUG(INDI::Logger::DBG_SESSION, "Briefly connecting to avfoundation to update the source list");
             if(ConnectToSource("avfoundation", "default", frameRate, videoSize, "Not using IP Camera"))
                 DEBUG(INDI::Logger::DBG_SESSION, "Source List Updated");
-            avcodec_close(pCodecCtx);
+            avcodec_free_context(&pCodecCtx);
             avformat_close_input(&pFormatCtx);
         }
     }
@@ -195,6 +203,8 @@ indi_webcam::indi_webcam()
   pCodec = nullptr;
   optionsDict=nullptr;
   pFrame = nullptr;
+  pFrameSW = nullptr;
+  pDecoded = nullptr;
   pFrameOUT = nullptr;
   sws_ctx = nullptr;
   buffer = nullptr;
@@ -223,8 +233,9 @@ indi_webcam::indi_webcam()
   frameRate = 30;
   videoSize = "640x480";
   webcamStacking = false;
-  averaging = false;
+  stackMode = WebcamStack::STACK_SUM;
   outputFormat = "8 bit RGB";
+  captureOutput = WebcamCapture::OUTPUT_RGB8;
 
   IPAddress = "xxx.xxx.x.xxx";
   port = "xxxx";
@@ -278,7 +289,7 @@ bool indi_webcam::ConnectToSource(std::string device, std::string source, int fr
     snprintf(stringFrameRate,16,"%u",framerate);
     if(isConnected())
     {
-        avcodec_close(pCodecCtx);
+        avcodec_free_context(&pCodecCtx);
         avformat_close_input(&pFormatCtx);
     }
 
@@ -345,11 +356,16 @@ bool indi_webcam::ConnectToSource(std::string device, std::string source, int fr
     }
 
     //Attempt to open the codec.  If that fails, abort the connection.
-    if(avcodec_open2(pCodecCtx, pCodec, &optionsDict)<0)
+    std::string hardwareDevice;
+    if(!WebcamCapture::openDecoder(pCodecCtx, pCodec, useHardwareDecoder, &optionsDict, hardwareDevice))
     {
       DEBUG(INDI::Logger::DBG_SESSION,"Failed to open codec.");
       return false;
     }
+    if(!hardwareDevice.empty())
+        LOGF_INFO("Decoding %s on the %s hardware decoder.", pCodec->name, hardwareDevice.c_str());
+    else if(useHardwareDecoder)
+        LOGF_INFO("No hardware decoder available for %s, decoding in software.", pCodec->name);
 
     //Set the initial parameters for the CCD.
     SetCCDParams(pCodecCtx->width, pCodecCtx->height, 8, 5, 5); //Note 5 microns is a guess!
@@ -489,7 +505,7 @@ bool indi_webcam::Disconnect()
 {
     if (isConnected()) {
       // Close the codecs
-      avcodec_close(pCodecCtx);
+      avcodec_free_context(&pCodecCtx);
 
       // Close the video file
       avformat_close_input(&pFormatCtx);
@@ -517,26 +533,51 @@ bool indi_webcam::initProperties()
     // Must init parent properties first!
     INDI::CCD::initProperties();
 
-    RapidStacking = new ISwitch[3];
+    RapidStacking = new ISwitch[4];
     IUFillSwitch(&RapidStacking[0], "Integration", "Integration", ISS_OFF);
     IUFillSwitch(&RapidStacking[1], "Average", "Average", ISS_OFF);
-    IUFillSwitch(&RapidStacking[2], "Off", "Off", ISS_ON);
+    IUFillSwitch(&RapidStacking[2], "Sigma Clip", "Sigma Clip", ISS_OFF);
+    IUFillSwitch(&RapidStacking[3], "Off", "Off", ISS_ON);
 
-    IUFillSwitchVector(&RapidStackingSelection, RapidStacking, 3, getDeviceName(), "RAPID_STACKING_OPTION", "Rapid Stacking",
+    IUFillSwitchVector(&RapidStackingSelection, RapidStacking, 4, getDeviceName(), "RAPID_STACKING_OPTION", "Rapid Stacking",
                        MAIN_CONTROL_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
     defineSwitch(&RapidStackingSelection);
 
-    OutputFormats = new ISwitch[3];
+    IUFillNumber(&RapidStackingSigmaN[0], "SIGMA", "Sigma", "%.1f", 1, 10, 0.5, 3);
+    IUFillNumberVector(&RapidStackingSigmaNP, RapidStackingSigmaN, 1, getDeviceName(), "RAPID_STACKING_SIGMA", "Sigma Clip",
+                       MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
+    defineNumber(&RapidStackingSigmaNP);
+
+    OutputFormats = new ISwitch[4];
     IUFillSwitch(&OutputFormats[0], "16 bit Grayscale", "16 bit Grayscale", ISS_OFF);
     IUFillSwitch(&OutputFormats[1], "16 bit RGB", "16 bit RGB", ISS_OFF);
     IUFillSwitch(&OutputFormats[2], "8 bit RGB", "8 bit RGB", ISS_ON);
+    IUFillSwitch(&OutputFormats[3], "Native", "Native Gray/Bayer", ISS_OFF);
 
-    IUFillSwitchVector(&OutputFormatSelection, OutputFormats, 3, getDeviceName(), "OUTPUT_FORMAT_OPTION", "Output Format",
+    IUFillSwitchVector(&OutputFormatSelection, OutputFormats, 4, getDeviceName(), "OUTPUT_FORMAT_OPTION", "Output Format",
                        MAIN_CONTROL_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
     defineSwitch(&OutputFormatSelection);
 
+    IUFillSwitch(&HardwareDecoderS[0], "INDI_ENABLED", "On", ISS_OFF);
+    IUFillSwitch(&HardwareDecoderS[1], "INDI_DISABLED", "Off", ISS_ON);
+    IUFillSwitchVector(&HardwareDecoderSP, HardwareDecoderS, 2, getDeviceName(), "HARDWARE_DECODER", "Hardware Decoder",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    defineSwitch(&HardwareDecoderSP);
+
+    //Average time per frame spent in each stage of the last exposure, or of the last second of streaming
+    IUFillNumber(&CaptureTimingsN[0], "READ", "Read (ms)", "%.2f", 0, 10000, 0, 0);
+    IUFillNumber(&CaptureTimingsN[1], "DECODE", "Decode (ms)", "%.2f", 0, 10000, 0, 0);
+    IUFillNumber(&CaptureTimingsN[2], "CONVERT", "Convert (ms)", "%.2f", 0, 10000, 0, 0);
+    IUFillNumber(&CaptureTimingsN[3], "STACK", "Stack (ms)", "%.2f", 0, 10000, 0, 0);
+    IUFillNumber(&CaptureTimingsN[4], "FRAMES", "Frames", "%.f", 0, 1e9, 0, 0);
+    IUFillNumberVector(&CaptureTimingsNP, CaptureTimingsN, 5, getDeviceName(), "CAPTURE_TIMINGS", "Capture Timings",
+                       OPTIONS_TAB, IP_RO, 60, IPS_IDLE);
+    defineNumber(&CaptureTimingsNP);
+
     loadConfig(true, "RAPID_STACKING_OPTION");
+    loadConfig(true, "RAPID_STACKING_SIGMA");
     loadConfig(true, "OUTPUT_FORMAT_OPTION");
+    loadConfig(true, "HARDWARE_DECODER");
 
 
     /* Add debug controls so we may debug driver if necessary */
@@ -766,7 +807,15 @@ bool indi_webcam::ISNewNumber (const char *dev, const char *name, double values[
     if (dev && strcmp (getDeviceName(), dev))
       return true;
     DEBUGF(INDI::Logger::DBG_SESSION, "Setting number %s", name);
-    
+
+    if (!strcmp(name, RapidStackingSigmaNP.name))
+    {
+        IUUpdateNumber(&RapidStackingSigmaNP, values, names, n);
+        RapidStackingSigmaNP.s = IPS_OK;
+        IDSetNumber(&RapidStackingSigmaNP, nullptr);
+        return true;
+    }
+
     return INDI::CCD::ISNewNumber(dev,name,values,names,n);
 }
 
@@ -879,17 +928,22 @@ bool indi_webcam::ISNewSwitch (const char *dev, const char *name, ISState *state
            if(!strcmp(sp->name, "Integration"))
            {
                webcamStacking = true;
-               averaging = false;
+               stackMode = WebcamStack::STACK_SUM;
            }
            if(!strcmp(sp->name, "Average"))
            {
                webcamStacking = true;
-               averaging = true;
+               stackMode = WebcamStack::STACK_AVERAGE;
+           }
+           if(!strcmp(sp->name, "Sigma Clip"))
+           {
+               webcamStacking = true;
+               stackMode = WebcamStack::STACK_SIGMA_CLIP;
            }
            if(!strcmp(sp->name, "Off"))
            {
                webcamStacking = false;
-               averaging = false;
+               stackMode = WebcamStack::STACK_SUM;
            }
                 RapidStackingSelection.s = IPS_OK;
                 IDSetSwitch(&RapidStackingSelection, nullptr);
@@ -912,6 +966,30 @@ bool indi_webcam::ISNewSwitch (const char *dev, const char *name, ISState *state
         return false;
     }
 
+    if (!strcmp(name, HardwareDecoderSP.name))
+    {
+        IUUpdateSwitch(&HardwareDecoderSP, states, names, n);
+        bool enabled = HardwareDecoderS[0].s == ISS_ON;
+        if(enabled != useHardwareDecoder)
+        {
+            useHardwareDecoder = enabled;
+            //The decoder is picked when the source is opened
+            if(isConnected() && !InExposure)
+            {
+                bool was_streaming = is_streaming;
+                if(was_streaming)
+                    StopStreaming();
+                std::string htmlSourceString = "http://" + username + ":" + password + "@" + IPAddress + ":" + port;
+                ConnectToSource(videoDevice, videoSource, frameRate, videoSize, htmlSourceString);
+                if(was_streaming)
+                    StartStreaming();
+            }
+        }
+        HardwareDecoderSP.s = IPS_OK;
+        IDSetSwitch(&HardwareDecoderSP, nullptr);
+        return true;
+    }
+
     if (!strcmp(name, RefreshSP.name))
     {
         bool a = refreshInputDevices();
@@ -1010,55 +1088,103 @@ bool indi_webcam::StartExposure(float duration)
         return 0;
     }
 
-    //This resets the stack buffer
-    if(webcamStacking){
-        if(stackBuffer)
-            free(stackBuffer);
-        stackBuffer = nullptr;
-    }
-
     //This sets up the output format for the exposure
+    if(!setupOutput())
+        return -1;
+
+    //This sets up the exposure time settings
+    ExposureRequest = duration;
+    PrimaryCCD.setExposureDuration(duration);
+    gettimeofday(&ExpStart, nullptr);
+    timerID = SetTimer(POLLMS);
+    InExposure = true;
+    //Set up the stream, if there is an error, return
+    if(!setupStreaming())
+        return -1;
+    //Frames are cropped to the subframe as they are converted
+    converter.configure(captureOutput, PrimaryCCD.getSubX(), PrimaryCCD.getSubY(), PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+    resetTimings();
+    //This starts a new stack for the frames of this exposure
+    if(webcamStacking && !startStack())
+        return -1;
+     //This will ensure that we get the current frame, not some old frame still in the buffer
+    if(flush_frame_buffer())
+        return 0;
+    else
+        return -1;
+}
+
+//This sets up the output format of the exposure.
+//The native format keeps the samples of gray and Bayer sources as they are, without going through swscale.
+bool indi_webcam::setupOutput()
+{
+    const char *bayerPattern = nullptr;
     if(outputFormat == "16 bit RGB")
     {
+        captureOutput = WebcamCapture::OUTPUT_RGB16;
         out_pix_fmt=AV_PIX_FMT_RGB48LE;
         PrimaryCCD.setBPP(16);
         PrimaryCCD.setNAxis(3);
     }
     else if(outputFormat == "8 bit RGB")
     {
+        captureOutput = WebcamCapture::OUTPUT_RGB8;
         out_pix_fmt=AV_PIX_FMT_RGB24;
         PrimaryCCD.setBPP(8);
         PrimaryCCD.setNAxis(3);
     }
     else if(outputFormat == "16 bit Grayscale")
     {
+        captureOutput = WebcamCapture::OUTPUT_GRAY16;
         out_pix_fmt=AV_PIX_FMT_GRAY16LE;
         PrimaryCCD.setBPP(16);
         PrimaryCCD.setNAxis(2);
     }
+    else if(outputFormat == "Native")
+    {
+        int bpp = 8;
+        if(!WebcamCapture::nativeFormat(pCodecCtx->pix_fmt, &bpp, &bayerPattern))
+        {
+            LOGF_ERROR("The source delivers %s frames, the native format needs a gray or Bayer source.",
+                       av_get_pix_fmt_name(pCodecCtx->pix_fmt));
+            return false;
+        }
+        captureOutput = WebcamCapture::OUTPUT_NATIVE;
+        out_pix_fmt=pCodecCtx->pix_fmt;
+        PrimaryCCD.setBPP(bpp);
+        PrimaryCCD.setNAxis(2);
+    }
     else
-        return -1;
+        return false;
 
-    //This sets up the exposure time settings
-    ExposureRequest = duration;
-    PrimaryCCD.setExposureDuration(duration);
-    gettimeofday(&ExpStart, nullptr);
-    timerID = SetTimer(POLLMS);
-    InExposure = true;
-    //Set up the stream, if there is an error, return
-    if(!setupStreaming())
-        return -1;
-     //This will ensure that we get the current frame, not some old frame still in the buffer
-    if(flush_frame_buffer())
-        return 0;
-    else
-        return -1;
+    //Only native Bayer frames need debayering by the client
+    uint32_t cap = GetCCDCapability();
+    if(bayerPattern)
+    {
+        IUSaveText(&BayerT[0], "0");
+        IUSaveText(&BayerT[1], "0");
+        IUSaveText(&BayerT[2], bayerPattern);
+        if(!HasBayer())
+        {
+            SetCCDCapability(cap | CCD_HAS_BAYER);
+            defineText(&BayerTP);
+            //A subframe set before the source was known to be Bayer may start on an odd pixel
+            UpdateCCDFrame(PrimaryCCD.getSubX(), PrimaryCCD.getSubY(), PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+        }
+        else
+            IDSetText(&BayerTP, nullptr);
+    }
+    else if(HasBayer())
+    {
+        SetCCDCapability(cap & ~CCD_HAS_BAYER);
+        deleteProperty(BayerTP.name);
+    }
+    return true;
 }
 
 bool indi_webcam::AbortExposure()
 {
-    if(stackBuffer)
-        free(stackBuffer);
+    stacker.abort();
     InExposure = false;
     return true;
 }
@@ -1126,8 +1252,11 @@ void indi_webcam::TimerHit()
             if(webcamStacking)
                 grabImage();  //This will take another frame which will get added to the average.
         }
-        if(webcamStacking)
+        if(webcamStacking && InExposure)
+        {
             SetTimer(10);//The time should be as short as possible to get as many frames as possible in the set.
+            return;
+        }
     }
 
     SetTimer(POLLMS);
@@ -1139,185 +1268,103 @@ void indi_webcam::TimerHit()
 
 bool indi_webcam::grabImage()
 {
-    if(getStreamFrame())
-    {
-        if(PrimaryCCD.getNAxis()==3)
-            convertINDI_RGBtoFITS_RGB(pFrameOUT->data[0], PrimaryCCD.getFrameBuffer());
-        else
-            memcpy(PrimaryCCD.getFrameBuffer(), pFrameOUT->data[0], numBytes);
-        if(webcamStacking)
-            addToStack();
-    }
-    else
+    //The frame buffers are gone if an earlier frame could not be read
+    if(!pFrame)
+        return false;
+    if(!getStreamFrame())
     {
         freeMemory();
         return false;
     }
 
-    return true;
-}
-
-//This adds each image to the running stack
-bool indi_webcam::addToStack()
-{
-    if(!stackBuffer)
+    //Single frames are converted straight into the frame buffer, stacked frames into a scratch buffer first.
+    //Either way they come out cropped and in FITS layout, so the stack needs no conversion at the end.
+    uint8_t *target = webcamStacking ? pFrameOUT->data[0] : PrimaryCCD.getFrameBuffer();
+    auto start = std::chrono::steady_clock::now();
+    bool converted = converter.convert(pDecoded, target);
+    timings.convert += secondsSince(start);
+    if(!converted)
     {
-        stackBuffer = (float *)malloc(numBytes*sizeof(float_t));
-        numberOfFramesInStack = 0;
+        LOG_ERROR("Could not convert the frame to the output format.");
+        return false;
     }
 
-    int w = pCodecCtx->width  * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    int h = pCodecCtx->height;
+    if(webcamStacking)
+    {
+        start = std::chrono::steady_clock::now();
+        stacker.addFrame(target);
+        timings.stack += secondsSince(start);
+    }
+    timings.frames++;
 
-    for (int i = 0; i < w * h; i++)
-       {
-           int x = i % w;
-           int y = i / w;
-           if(x >= 0 && y >= 0 && x < w && y < h)
-           {
-                   if(numberOfFramesInStack == 0)
-                       stackBuffer[i]=getImageDataFloatValue(x, y);
-                   else
-                       stackBuffer[i]+=getImageDataFloatValue(x, y);
-           }
-       }
-    numberOfFramesInStack++;
     return true;
 }
 
-//This gets the pixel value at an x, y position in the image
-float indi_webcam::getImageDataFloatValue(int x, int y){
-    int w = pCodecCtx->width  * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    uint8_t *primaryBuffer = PrimaryCCD.getFrameBuffer();
-    if(PrimaryCCD.getBPP()==8)
-        return (float) primaryBuffer[y * w + x];
-    else if(PrimaryCCD.getBPP()==16)
-    {
-        uint16_t *newBuffer = reinterpret_cast<uint16_t *>(primaryBuffer);
-        return (float) newBuffer[y * w + x];
-    }
-    else
-        return 0;
-}
-//This sets the pixel value at an x, y position in the image
-void indi_webcam::setImageDataValueFromFloat(int x, int y, float value, bool roundAnswer)
+//This starts stacking the frames of a new exposure.
+//Frames are stacked as converted, one sample per color channel, on the stacker's worker thread.
+bool indi_webcam::startStack()
 {
-    uint8_t *primaryBuffer = PrimaryCCD.getFrameBuffer();
-    int w = pCodecCtx->width * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    if(!stackBuffer)
-        return;
-    if(PrimaryCCD.getBPP()==8)
-    {
-        int max = std::numeric_limits<uint8_t>::max();
-        if (value > max)
-            value = max;
-        if(roundAnswer)
-            primaryBuffer[y * w + x] = round(value);
-        else
-            primaryBuffer[y * w + x] = value;
-    }
-    else if(PrimaryCCD.getBPP()==16)
+    int bpp = PrimaryCCD.getBPP();
+    size_t frameBytes = WebcamCapture::frameSize(captureOutput, pCodecCtx->pix_fmt, PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+    if(!stacker.start(stackMode, bpp, frameBytes / (bpp / 8), RapidStackingSigmaN[0].value))
     {
-        int max = std::numeric_limits<uint16_t>::max();
-        if (value > max)
-            value = max;
-        uint16_t *newBuffer = reinterpret_cast<uint16_t *>(primaryBuffer);
-        if(roundAnswer)
-            newBuffer[y * w + x] = round(value);
-        else
-            newBuffer[y * w + x] = value;
+        LOGF_ERROR("Rapid stacking does not support %d bit frames.", bpp);
+        return false;
     }
+    LOGF_DEBUG("Rapid stacking with %s kernels.", WebcamStack::kernelName());
+    return true;
 }
 
-//This will take the final image stack and copy it back to the primary buffer for final download.
+//This will write the final image stack to the primary buffer for final download.
 void indi_webcam::copyFinalStackToPrimaryFrameBuffer()
 {
-    int w = pCodecCtx->width  * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    int h = pCodecCtx->height;
-    for (int i = 0; i < w*h; i++)
-        {
-            int x = i % w;
-            int y = i / w;
-            if(x >= 0 && y >= 0 && x < w && y < h)
-            {
-                if(averaging)
-                    setImageDataValueFromFloat(x, y, round(stackBuffer[i]/numberOfFramesInStack), true);
-                else //Integrating
-                    setImageDataValueFromFloat(x, y, round(stackBuffer[i]), true);
-            }
-        }
+    int frames = stacker.finish(PrimaryCCD.getFrameBuffer());
 
-    LOGF_INFO("Final Image is a stack of %u exposures.", numberOfFramesInStack);
+    LOGF_INFO("Final Image is a stack of %d exposures.", frames);
 }
 
-//This will crop the image to a subframe if desired.
-//Then it will send the final image.
+//The frames were cropped to the subframe as they were converted,
+//so the frame buffer already holds the final image.  This sends it.
 void indi_webcam::finishExposure()
 {
-    uint8_t *memptr = PrimaryCCD.getFrameBuffer();
-    int w = pCodecCtx->width;
-    int h = pCodecCtx->height;
-    int bpp = PrimaryCCD.getBPP();
-    int naxis = PrimaryCCD.getNAxis();
-
-    if (PrimaryCCD.getSubW() < w || PrimaryCCD.getSubH() < h)
-    {
-        int subFrameSize     = PrimaryCCD.getSubW() * PrimaryCCD.getSubH() * bpp / 8 * ((naxis == 3) ? 3 : 1);
-        int oneFrameSize     = PrimaryCCD.getSubW() * PrimaryCCD.getSubH() * bpp / 8;
-        uint8_t *subframeBuf = (uint8_t *)malloc(subFrameSize);
+    int subFrameSize = WebcamCapture::frameSize(captureOutput, pCodecCtx->pix_fmt, PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
 
-        int startY = PrimaryCCD.getSubY();
-        int endY   = startY + PrimaryCCD.getSubH();
-        int lineW  = PrimaryCCD.getSubW() * bpp / 8;
-        int subX   = PrimaryCCD.getSubX();
+    updateTimings();
 
-        LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - startY: %d - endY: %d - lineW: %d - subX: %d", subFrameSize, oneFrameSize,
-                   startY, endY, lineW, subX);
-
-        if (naxis == 2)
-        {
-            for (int i = startY; i < endY; i++)
-                memcpy(subframeBuf + (i - startY) * lineW, memptr + (i * w + subX) * PrimaryCCD.getBPP() / 8, lineW);
-        }
-        else
-        {
-            uint8_t *subR = subframeBuf;
-            uint8_t *subG = subframeBuf + oneFrameSize;
-            uint8_t *subB = subframeBuf + oneFrameSize * 2;
-
-            uint8_t *startR = memptr;
-            uint8_t *startG = memptr + (w * h * bpp / 8);
-            uint8_t *startB = memptr + (w * h * bpp / 8 * 2);
-
-            for (int i = startY; i < endY; i++)
-            {
-                memcpy(subR + (i - startY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
-                memcpy(subG + (i - startY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
-                memcpy(subB + (i - startY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
-            }
-        }
+    PrimaryCCD.setFrameBufferSize(subFrameSize, false);
+    ExposureComplete(&PrimaryCCD);
+    PrimaryCCD.setFrameBufferSize(numBytes, false);
+}
 
-        PrimaryCCD.setFrameBuffer(subframeBuf);
-        PrimaryCCD.setFrameBufferSize(subFrameSize, false);
-        PrimaryCCD.setResolution(w, h);
-        PrimaryCCD.setNAxis(naxis);
-        PrimaryCCD.setBPP(bpp);
+//These keep track of the time spent in each stage of the capture
+void indi_webcam::resetTimings()
+{
+    timings = WebcamCapture::Timings();
+}
 
-        ExposureComplete(&PrimaryCCD);
+void indi_webcam::updateTimings()
+{
+    if(timings.frames == 0)
+        return;
 
-        // Restore old pointer and release memory
-        PrimaryCCD.setFrameBuffer(memptr);
-        PrimaryCCD.setFrameBufferSize(numBytes, false);
-        if(subframeBuf)
-            free(subframeBuf);
-    }
-    else
-        ExposureComplete(&PrimaryCCD);
+    CaptureTimingsN[0].value = timings.read * 1000 / timings.frames;
+    CaptureTimingsN[1].value = timings.decode * 1000 / timings.frames;
+    CaptureTimingsN[2].value = timings.convert * 1000 / timings.frames;
+    CaptureTimingsN[3].value = timings.stack * 1000 / timings.frames;
+    CaptureTimingsN[4].value = timings.frames;
+    CaptureTimingsNP.s = IPS_OK;
+    IDSetNumber(&CaptureTimingsNP, nullptr);
 }
 
 bool indi_webcam::UpdateCCDFrame(int x, int y, int w, int h)
 {
-
+    //Keep the Bayer pattern of the subframe the same as the one of the sensor, so the pattern
+    //sent to the client holds and SubX/SubY match the pixels that are sent
+    if(HasBayer())
+    {
+        x &= ~1;
+        y &= ~1;
+    }
     PrimaryCCD.setFrame(x, y, w, h);
     return true;
 }
@@ -1403,6 +1450,14 @@ void indi_webcam::run_capture()
         PrimaryCCD.setNAxis(2);
         Streamer->setPixelFormat(INDI_MONO);
     }
+    else if(outputFormat == "Native")
+    {
+        LOG_INFO("Note, Native format not supported in video stream using 8 Bit Grayscale instead.");
+        out_pix_fmt=AV_PIX_FMT_GRAY8;
+        PrimaryCCD.setBPP(8);
+        PrimaryCCD.setNAxis(2);
+        Streamer->setPixelFormat(INDI_MONO);
+    }
     else
         return;
 
@@ -1418,15 +1473,23 @@ void indi_webcam::run_capture()
   if(!flush_frame_buffer())
       return;
 
+  resetTimings();
   while (is_capturing && is_streaming) {
 
-    if(getStreamFrame())
+    if(getStreamFrame() && scaleStreamFrame())
         Streamer->newFrame(pFrameOUT->data[0], numBytes);
     else
     {
         is_capturing = false;
         is_streaming = false;
     }
+
+    //Report the capture timings about once a second
+    if(timings.frames >= frameRate)
+    {
+        updateTimings();
+        resetTimings();
+    }
   }
 
   freeMemory();
@@ -1434,42 +1497,6 @@ void indi_webcam::run_capture()
   DEBUG(INDI::Logger::DBG_SESSION,"Capture thread releasing device.");
 }
 
-//This converts an image from INDI_RGB to FITS_RGB so the FITSViewer can read it.
-bool indi_webcam::convertINDI_RGBtoFITS_RGB(uint8_t *originalImage, uint8_t *convertedImage)
-{
-    if(PrimaryCCD.getBPP() == 8)
-    {
-        int size =  numBytes / 3;
-        uint8_t *r,*g,*b;
-        r = (convertedImage);
-        g = (convertedImage + size);
-        b = (convertedImage + size * 2);
-        for(int i=0; i < numBytes; i+=3)
-        {
-            *r++ = *originalImage++;
-            *g++ = *originalImage++;
-            *b++ = *originalImage++;
-        }
-    }
-    else if(PrimaryCCD.getBPP() == 16)
-    {
-        uint16_t *bigOriginalImage = reinterpret_cast<uint16_t *>(originalImage);
-        uint16_t *bigConvertedImage = reinterpret_cast<uint16_t *>(convertedImage);
-        int size =  numBytes / 2 / 3;
-        uint16_t *r,*g,*b;
-        r = (bigConvertedImage);
-        g = (bigConvertedImage + size);
-        b = (bigConvertedImage + size * 2);
-        for(int i=0; i < numBytes / 2; i+=3)
-        {
-            *r++ = *bigOriginalImage++;
-            *g++ = *bigOriginalImage++;
-            *b++ = *bigOriginalImage++;
-        }
-    }
-    return true;
-}
-
 //This sets up the webcam to get images
 //It is used for both the streaming and exposing algorithms
 bool indi_webcam::setupStreaming()
@@ -1477,10 +1504,13 @@ bool indi_webcam::setupStreaming()
     // Determine required buffer size and allocate buffer for pframeRGB
     numBytes = av_image_get_buffer_size(out_pix_fmt, pCodecCtx->width, pCodecCtx->height, 1);
 
-    // Allocate video frame
+    // Allocate video frame, and the one hardware decoded frames are downloaded to
     pFrame=av_frame_alloc();
     if(pFrame==nullptr)
       return false;
+    pFrameSW=av_frame_alloc();
+    if(pFrameSW==nullptr)
+      return false;
     // Allocate an AVFrame structure
     pFrameOUT=av_frame_alloc();
     if(pFrameOUT==nullptr)
@@ -1494,13 +1524,8 @@ bool indi_webcam::setupStreaming()
     av_image_fill_arrays (pFrameOUT->data, pFrameOUT->linesize, buffer, out_pix_fmt,
               pCodecCtx->width, pCodecCtx->height, 1);
 
-    // initialize SWS context for software scaling
-    sws_ctx = sws_getContext( pCodecCtx->width, pCodecCtx->height,
-                 pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height,
-                 out_pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr
-                 );
-    if(sws_ctx==nullptr)
-      return false;
+    //The SWS context for the video stream is set up with the first frame, see scaleStreamFrame.
+    //A hardware decoder only tells the format of its frames once they are downloaded.
 
     PrimaryCCD.setFrameBufferSize(numBytes);
     PrimaryCCD.setResolution(pCodecCtx->width, pCodecCtx->height);
@@ -1508,20 +1533,21 @@ bool indi_webcam::setupStreaming()
     return true;
 }
 
-//This gets one image from the camera.
+//This gets one image from the camera and decodes it into pDecoded.
 //It is used for both the streaming and exposing algorithms
 bool indi_webcam::getStreamFrame()
 {
     AVPacket packet;
-    //If at first you don't succees to get a frame, try again.
-    int ret = -1;
-    while(ret < 0)
+    while(true)
     {
-        ret = av_read_frame(pFormatCtx, &packet);
-        char errbuff[200];
-        av_make_error_string(errbuff, 200, ret);
+        //If at first you don't succeed to get a packet, try again.
+        auto start = std::chrono::steady_clock::now();
+        int ret = av_read_frame(pFormatCtx, &packet);
+        timings.read += secondsSince(start);
         if(ret < 0) // Negative return value means stream stopped
         {
+            char errbuff[200];
+            av_make_error_string(errbuff, 200, ret);
             DEBUGF(INDI::Logger::DBG_SESSION, "FFMPEG Error:%s, attempting to reconnect.", errbuff);
             if(reconnectSource())
             {
@@ -1535,45 +1561,61 @@ bool indi_webcam::getStreamFrame()
                 }
                 //Flush it one more time because of the disconnect.
                 flush_frame_buffer();
+                continue;
             }
-            else
-            {
-                DEBUG(INDI::Logger::DBG_SESSION, "Device did not reconnect after 10 tries.");
-                av_packet_unref(&packet);
-                return false;
-            }
+            DEBUG(INDI::Logger::DBG_SESSION, "Device did not reconnect after 10 tries.");
+            av_packet_unref(&packet);
+            return false;
         }
-    }
-    if(packet.stream_index==videoStream) {
-        int ret;
-        ret = avcodec_send_packet(pCodecCtx, &packet);
-        char errbuff[200];
-        av_make_error_string(errbuff, 200, ret);
+        if(packet.stream_index != videoStream)
+        {
+            av_packet_unref(&packet);
+            continue;
+        }
+
+        start = std::chrono::steady_clock::now();
+        //A decoder holding decoded frames gives the first of them back while it takes the packet
+        ret = WebcamCapture::sendPacket(pCodecCtx, &packet, pFrame, pFrameSW, &pDecoded);
+        av_packet_unref(&packet);
         if (ret < 0) {
+            char errbuff[200];
+            av_make_error_string(errbuff, 200, ret);
             DEBUGF(INDI::Logger::DBG_SESSION, "Error sending a packet for decoding:%s",errbuff);
-            av_packet_unref(&packet);
             return false;
         }
-        while (ret >= 0) {
-            ret = avcodec_receive_frame(pCodecCtx, pFrame);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-                continue;
-            else if (ret < 0) {
-                DEBUG(INDI::Logger::DBG_SESSION, "Error during decoding");
-                av_packet_unref(&packet);
-                return false;
-            }
-            // We have a frame at that point
-            // Convert the image from its native format to our output format
-           sws_scale(sws_ctx, (uint8_t const * const *)pFrame->data,
-                pFrame->linesize, 0, pCodecCtx->height,
-                pFrameOUT->data, pFrameOUT->linesize);
-           av_packet_unref(&packet);
-           return true;
+        if (pDecoded != nullptr) {
+            timings.decode += secondsSince(start);
+            return true;
         }
-
+        ret = WebcamCapture::receiveFrame(pCodecCtx, pFrame, pFrameSW, &pDecoded);
+        timings.decode += secondsSince(start);
+        //A threaded decoder takes a few packets before the first frame comes out
+        if (ret == AVERROR(EAGAIN))
+            continue;
+        if (ret < 0) {
+            DEBUG(INDI::Logger::DBG_SESSION, "Error during decoding");
+            return false;
+        }
+        // We have a frame at that point
+        return true;
     }
-    return false;
+}
+
+//This converts the decoded image to the interleaved format of the video stream.
+bool indi_webcam::scaleStreamFrame()
+{
+    auto start = std::chrono::steady_clock::now();
+    sws_ctx = sws_getCachedContext(sws_ctx, pDecoded->width, pDecoded->height, (AVPixelFormat)pDecoded->format,
+                 pCodecCtx->width, pCodecCtx->height, out_pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if(sws_ctx==nullptr)
+        return false;
+
+    sws_scale(sws_ctx, (uint8_t const * const *)pDecoded->data,
+         pDecoded->linesize, 0, pDecoded->height,
+         pFrameOUT->data, pFrameOUT->linesize);
+    timings.convert += secondsSince(start);
+    timings.frames++;
+    return true;
 }
 
 //This will clear out the frame buffer of any unread frames.
@@ -1629,6 +1671,8 @@ bool indi_webcam::flush_frame_buffer() {
         packetReceiveTime = now.tv_usec - then.tv_usec;
         av_packet_unref(&packet);
     }
+    //A threaded decoder still holds frames of packets sent before, drop them too
+    avcodec_flush_buffers(pCodecCtx);
     DEBUGF(INDI::Logger::DBG_SESSION, "Buffer Cleared of %u stale frames.", num);
     return true;  //Buffer Cleared
 
@@ -1657,6 +1701,10 @@ void indi_webcam::freeMemory()
         av_free(pFrame);
     pFrame = nullptr;
 
+    // Free the frame hardware decoded images were downloaded to
+    av_frame_free(&pFrameSW);
+    pDecoded = nullptr;
+
 }
 
 bool indi_webcam::saveConfigItems(FILE *fp)
@@ -1664,7 +1712,9 @@ bool indi_webcam::saveConfigItems(FILE *fp)
     INDI::CCD::saveConfigItems(fp);
     IUSaveConfigSwitch(fp, &CaptureDeviceSelection);
     IUSaveConfigSwitch(fp, &RapidStackingSelection);
+    IUSaveConfigNumber(fp, &RapidStackingSigmaNP);
     IUSaveConfigSwitch(fp, &OutputFormatSelection);
+    IUSaveConfigSwitch(fp, &HardwareDecoderSP);
     IUSaveConfigText(fp, &HTTPInputOptionsP);
     IUSaveConfigText(fp, &InputOptionsTP);
     IUSaveConfigText(fp, &TimeoutOptionsTP);
@@ -43,6 +43,9 @@ extern "C" {
 //#include <ctime>
 #include <thread>
 
+#include "webcam_capture.h"
+#include "webcam_stack.h"
+
 //These are required to check for AVFoundation Devices
 //The reason is that we have to print and parse the output
 //These can't be in indi_webcam class declaration because the callback method has to be passed to FFMpeg
@@ -94,7 +97,7 @@ private:
     //Related to exposures
     struct timeval ExpStart { 0, 0 };
     float ExposureRequest { 0 };
-    bool convertINDI_RGBtoFITS_RGB(uint8_t *originalImage, uint8_t *convertedImage);
+    bool setupOutput();
 
     //These are related to how we change sources
     bool ConnectToSource(std::string device, std::string source, int framerate, std::string videosize, std::string htmlSource);
@@ -112,15 +115,10 @@ private:
 
     //webcam stacking.
     bool webcamStacking;
-    bool averaging;
-    float *stackBuffer;
-    int numberOfFramesInStack;
-    bool addToStack();
+    WebcamStack::Mode stackMode;
+    WebcamStack::FrameStacker stacker;
+    bool startStack();
     void copyFinalStackToPrimaryFrameBuffer();
-    void setImageDataValueFromFloat(int x, int y, float value, bool roundAnswer);
-    void setRGBImageDataValueFromFloat(int x, int y, int channel, float value, bool roundAnswer);
-    float getImageDataFloatValue(int x, int y);
-    float getRGBImageDataFloatValue(int x, int y, int channel);
 
     //These are our device capture settings
     bool use16Bit = true;
@@ -155,18 +153,33 @@ private:
     ISwitchVectorProperty VideoSizeSelection;
     ISwitch *RapidStacking = nullptr;
     ISwitchVectorProperty RapidStackingSelection;
+    INumber RapidStackingSigmaN[1];
+    INumberVectorProperty RapidStackingSigmaNP;
     ISwitch *OutputFormats = nullptr;
     ISwitchVectorProperty OutputFormatSelection;
     IText TimeoutOptionsT[2] {};
     ITextVectorProperty TimeoutOptionsTP;
+    ISwitch HardwareDecoderS[2];
+    ISwitchVectorProperty HardwareDecoderSP;
+    INumber CaptureTimingsN[5];
+    INumberVectorProperty CaptureTimingsNP;
 
 
     //Webcam setup, release, and frame capture
     bool setupStreaming();
     void freeMemory();
     bool getStreamFrame();
+    bool scaleStreamFrame();
     bool flush_frame_buffer();
 
+    //Related to the capture path of exposures
+    bool useHardwareDecoder = false;
+    WebcamCapture::Output captureOutput;
+    WebcamCapture::FrameConverter converter;
+    WebcamCapture::Timings timings;
+    void resetTimings();
+    void updateTimings();
+
     //Related to streaming
     std::thread capture_thread;
     static void RunCaptureThread(indi_webcam *webcam);
@@ -186,6 +199,8 @@ private:
     AVCodecContext  *pCodecCtx;
     AVCodec         *pCodec;
     AVFrame         *pFrame;
+    AVFrame         *pFrameSW;
+    AVFrame         *pDecoded;
     AVFrame         *pFrameOUT;
     AVDictionary *optionsDict;
 
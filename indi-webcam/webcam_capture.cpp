@@ -0,0 +1,279 @@
+/*
+INDI Webcam CCD Driver - Capture path
+
+This driver is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "webcam_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#if LIBAVCODEC_VERSION_MAJOR >= 58
+#include <libavutil/hwcontext.h>
+#define WEBCAM_HW_DECODER
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+namespace WebcamCapture
+{
+
+#ifdef WEBCAM_HW_DECODER
+//The decoder asks for its output format once it knows the stream.
+//Take the hardware format we set the device up for, or the first software one if it is not offered.
+static enum AVPixelFormat getHardwareFormat(AVCodecContext *ctx, const enum AVPixelFormat *formats)
+{
+    enum AVPixelFormat wanted = static_cast<enum AVPixelFormat>(reinterpret_cast<intptr_t>(ctx->opaque));
+    for (const enum AVPixelFormat *p = formats; *p != AV_PIX_FMT_NONE; p++)
+        if (*p == wanted)
+            return *p;
+    for (const enum AVPixelFormat *p = formats; *p != AV_PIX_FMT_NONE; p++)
+        if (!(av_pix_fmt_desc_get(*p)->flags & AV_PIX_FMT_FLAG_HWACCEL))
+            return *p;
+    return AV_PIX_FMT_NONE;
+}
+#endif
+
+bool openDecoder(AVCodecContext *ctx, AVCodec *codec, bool hardware, AVDictionary **options, std::string &device)
+{
+    device.clear();
+#ifdef WEBCAM_HW_DECODER
+    for (int i = 0; hardware; i++)
+    {
+        const AVCodecHWConfig *config = avcodec_get_hw_config(codec, i);
+        if (config == nullptr)
+            break;
+        if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
+            continue;
+        AVBufferRef *deviceCtx = nullptr;
+        if (av_hwdevice_ctx_create(&deviceCtx, config->device_type, nullptr, nullptr, 0) < 0)
+            continue;
+        //The codec context owns the device reference from here on
+        ctx->hw_device_ctx = deviceCtx;
+        ctx->opaque = reinterpret_cast<void *>(static_cast<intptr_t>(config->pix_fmt));
+        ctx->get_format = getHardwareFormat;
+        device = av_hwdevice_get_type_name(config->device_type);
+        break;
+    }
+#else
+    (void)hardware;
+#endif
+
+    //Software decoders decode several frames (MJPEG, H.264) or slices at once on all cores
+    if (device.empty() && (codec->capabilities & (AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS)))
+    {
+        ctx->thread_count = 0;
+        ctx->thread_type  = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    }
+
+    return avcodec_open2(ctx, codec, options) >= 0;
+}
+
+int receiveFrame(AVCodecContext *ctx, AVFrame *frame, AVFrame *swFrame, AVFrame **decoded)
+{
+    int ret = avcodec_receive_frame(ctx, frame);
+    if (ret < 0)
+        return ret;
+
+    *decoded = frame;
+#ifdef WEBCAM_HW_DECODER
+    if (frame->hw_frames_ctx)
+    {
+        av_frame_unref(swFrame);
+        ret = av_hwframe_transfer_data(swFrame, frame, 0);
+        if (ret < 0)
+            return ret;
+        *decoded = swFrame;
+    }
+#else
+    (void)swFrame;
+#endif
+    return 0;
+}
+
+int sendPacket(AVCodecContext *ctx, const AVPacket *packet, AVFrame *frame, AVFrame *swFrame, AVFrame **decoded)
+{
+    *decoded = nullptr;
+    int ret = avcodec_send_packet(ctx, packet);
+    if (ret != AVERROR(EAGAIN))
+        return ret;
+
+    ret = receiveFrame(ctx, frame, swFrame, decoded);
+    AVFrame *spare = nullptr;
+    while (ret == 0)
+    {
+        ret = avcodec_send_packet(ctx, packet);
+        if (ret != AVERROR(EAGAIN))
+            break;
+        if (spare == nullptr)
+            spare = av_frame_alloc();
+        //A decoder that refuses input has a frame ready, EAGAIN here would be a decoder bug
+        ret = spare ? avcodec_receive_frame(ctx, spare) : AVERROR(ENOMEM);
+        av_frame_unref(spare);
+    }
+    av_frame_free(&spare);
+    return ret;
+}
+
+bool nativeFormat(int format, int *bpp, const char **bayerPattern)
+{
+    const char *pattern = nullptr;
+    int bits = 8;
+    switch (format)
+    {
+        case AV_PIX_FMT_GRAY8:
+            break;
+        case AV_PIX_FMT_GRAY16LE:
+            bits = 16;
+            break;
+        case AV_PIX_FMT_BAYER_RGGB8:
+            pattern = "RGGB";
+            break;
+        case AV_PIX_FMT_BAYER_BGGR8:
+            pattern = "BGGR";
+            break;
+        case AV_PIX_FMT_BAYER_GRBG8:
+            pattern = "GRBG";
+            break;
+        case AV_PIX_FMT_BAYER_GBRG8:
+            pattern = "GBRG";
+            break;
+        case AV_PIX_FMT_BAYER_RGGB16LE:
+            pattern = "RGGB";
+            bits    = 16;
+            break;
+        case AV_PIX_FMT_BAYER_BGGR16LE:
+            pattern = "BGGR";
+            bits    = 16;
+            break;
+        case AV_PIX_FMT_BAYER_GRBG16LE:
+            pattern = "GRBG";
+            bits    = 16;
+            break;
+        case AV_PIX_FMT_BAYER_GBRG16LE:
+            pattern = "GBRG";
+            bits    = 16;
+            break;
+        default:
+            return false;
+    }
+    if (bpp)
+        *bpp = bits;
+    if (bayerPattern)
+        *bayerPattern = pattern;
+    return true;
+}
+
+size_t frameSize(Output output, int sourceFormat, int w, int h)
+{
+    size_t pixels = static_cast<size_t>(w) * h;
+    int bpp = 0;
+    switch (output)
+    {
+        case OUTPUT_RGB8:
+            return pixels * 3;
+        case OUTPUT_RGB16:
+            return pixels * 6;
+        case OUTPUT_GRAY16:
+            return pixels * 2;
+        case OUTPUT_NATIVE:
+            return nativeFormat(sourceFormat, &bpp, nullptr) ? pixels * bpp / 8 : 0;
+    }
+    return 0;
+}
+
+FrameConverter::~FrameConverter()
+{
+    if (m_Sws)
+        sws_freeContext(m_Sws);
+}
+
+void FrameConverter::configure(Output output, int x, int y, int w, int h)
+{
+    m_Output = output;
+    m_X      = x;
+    m_Y      = y;
+    m_W      = w;
+    m_H      = h;
+}
+
+bool FrameConverter::convert(AVFrame *frame, uint8_t *dst)
+{
+    int x = m_X, y = m_Y;
+    int bpp = 8;
+    bool native = m_Output == OUTPUT_NATIVE;
+    if (native && !nativeFormat(frame->format, &bpp, nullptr))
+        return false;
+
+    if (x < 0 || y < 0 || x + m_W > frame->width || y + m_H > frame->height)
+        return false;
+
+    //Cropping only moves the plane pointers, so no pixel outside the subframe is touched
+    frame->crop_left   = x;
+    frame->crop_top    = y;
+    frame->crop_right  = frame->width - x - m_W;
+    frame->crop_bottom = frame->height - y - m_H;
+    if (av_frame_apply_cropping(frame, AV_FRAME_CROP_UNALIGNED) < 0)
+        return false;
+
+    if (native)
+    {
+        int lineBytes = m_W * bpp / 8;
+        av_image_copy_plane(dst, lineBytes, frame->data[0], frame->linesize[0], lineBytes, m_H);
+        return true;
+    }
+
+    //Planar RGB comes out of swscale as G, B, R planes, point them at the FITS R, G, B planes
+    enum AVPixelFormat format;
+    size_t plane = static_cast<size_t>(m_W) * m_H;
+    uint8_t *planes[4] = { dst, nullptr, nullptr, nullptr };
+    int linesizes[4]   = { 0, 0, 0, 0 };
+    switch (m_Output)
+    {
+        case OUTPUT_RGB8:
+            format       = AV_PIX_FMT_GBRP;
+            planes[0]    = dst + plane;
+            planes[1]    = dst + plane * 2;
+            planes[2]    = dst;
+            linesizes[0] = linesizes[1] = linesizes[2] = m_W;
+            break;
+        case OUTPUT_RGB16:
+            format       = AV_PIX_FMT_GBRP16LE;
+            planes[0]    = dst + plane * 2;
+            planes[1]    = dst + plane * 4;
+            planes[2]    = dst;
+            linesizes[0] = linesizes[1] = linesizes[2] = m_W * 2;
+            break;
+        case OUTPUT_GRAY16:
+        default:
+            format       = AV_PIX_FMT_GRAY16LE;
+            linesizes[0] = m_W * 2;
+            break;
+    }
+
+    m_Sws = sws_getCachedContext(m_Sws, m_W, m_H, static_cast<enum AVPixelFormat>(frame->format), m_W, m_H, format,
+                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (m_Sws == nullptr)
+        return false;
+
+    return sws_scale(m_Sws, frame->data, frame->linesize, 0, m_H, planes, linesizes) == m_H;
+}
+
+}
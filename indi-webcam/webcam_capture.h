@@ -0,0 +1,130 @@
+/*
+INDI Webcam CCD Driver - Capture path
+
+This driver is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * Decoding and conversion of the frames of an exposure. Decoded frames are cropped to the
+ * subframe by offsetting their planes, then converted by swscale (or copied, for native
+ * gray and Bayer sources) straight into the CCD frame buffer, already in FITS layout.
+ */
+namespace WebcamCapture
+{
+
+enum Output
+{
+    OUTPUT_RGB8,   /* 8 bit RGB, FITS planes R, G, B */
+    OUTPUT_RGB16,  /* 16 bit RGB, FITS planes R, G, B */
+    OUTPUT_GRAY16, /* 16 bit grayscale */
+    OUTPUT_NATIVE  /* Samples of a gray or Bayer source, as they come */
+};
+
+/* Time spent in each stage of the capture, summed over the frames */
+struct Timings
+{
+    double read { 0 };    /* av_read_frame */
+    double decode { 0 };  /* Decoder, including the download of hardware frames */
+    double convert { 0 }; /* Crop and conversion into the frame buffer */
+    double stack { 0 };   /* Handing the frame to the stacker */
+    int frames { 0 };
+};
+
+/**
+ * @brief openDecoder Opens ctx with codec. Uses the first hardware decoder that can be
+ * set up when hardware is true, otherwise enables frame and slice threading if the codec
+ * supports them (MJPEG and H.264 do).
+ * @param device set to the name of the hardware device type in use, or empty.
+ * @return false if the codec could not be opened.
+ */
+bool openDecoder(AVCodecContext *ctx, AVCodec *codec, bool hardware, AVDictionary **options, std::string &device);
+
+/**
+ * @brief receiveFrame Receives the next decoded frame from ctx.
+ * @param frame frame the decoder writes to.
+ * @param swFrame frame hardware frames are downloaded to.
+ * @param decoded set to frame or swFrame, whichever holds the picture in system memory.
+ * @return 0, or the error of avcodec_receive_frame (AVERROR(EAGAIN) if more packets are needed).
+ */
+int receiveFrame(AVCodecContext *ctx, AVFrame *frame, AVFrame *swFrame, AVFrame **decoded);
+
+/**
+ * @brief sendPacket Sends packet to ctx. A decoder holding decoded frames takes no input
+ * (frame threaded decoders often hold several): the frames are received, the first one into
+ * frame and the rest dropped, until the packet is accepted.
+ * @param decoded set to the first frame received, as by receiveFrame, or nullptr if the
+ * packet was accepted right away.
+ * @return 0, or the error that kept the packet from being decoded.
+ */
+int sendPacket(AVCodecContext *ctx, const AVPacket *packet, AVFrame *frame, AVFrame *swFrame, AVFrame **decoded);
+
+/**
+ * @brief nativeFormat Tells whether frames of format can be used without conversion.
+ * @param bpp set to the bits per sample, 8 or 16.
+ * @param bayerPattern set to the Bayer pattern (e.g. "RGGB"), or nullptr for gray formats.
+ */
+bool nativeFormat(int format, int *bpp, const char **bayerPattern);
+
+/** @return bytes of a w x h frame converted to output from frames of sourceFormat, 0 if unsupported. */
+size_t frameSize(Output output, int sourceFormat, int w, int h);
+
+/**
+ * @brief Crops and converts decoded frames into a buffer laid out as the FITS data of the
+ * subframe: rows of w samples, one plane per color. The swscale context is kept for as
+ * long as the source format and the subframe stay the same.
+ */
+class FrameConverter
+{
+    public:
+        FrameConverter() = default;
+        ~FrameConverter();
+
+        /**
+         * @brief configure Sets what convert produces.
+         * @param x, y, w, h subframe, in source pixels. The caller keeps Bayer subframes on even
+         * pixels, so that they have the Bayer pattern of the sensor.
+         */
+        void configure(Output output, int x, int y, int w, int h);
+
+        /**
+         * @brief convert Crops frame to the subframe and converts it into dst. The planes and
+         * size of frame are adjusted by the crop.
+         * @return false if the subframe does not fit in the frame or the conversion failed.
+         */
+        bool convert(AVFrame *frame, uint8_t *dst);
+
+    private:
+        Output m_Output { OUTPUT_RGB8 };
+        int m_X { 0 }, m_Y { 0 }, m_W { 0 }, m_H { 0 };
+        SwsContext *m_Sws { nullptr };
+};
+
+}
@@ -0,0 +1,376 @@
+/*
+INDI Webcam Capture Benchmark
+
+Reads a video from a local file or a pipe the way indi_webcam_ccd reads its sources and
+runs every decoded frame through both capture paths of an exposure: the one the driver
+used before (sws_scale of the whole frame, conversion to FITS RGB, then a subframe copy)
+and the current one (crop, then sws_scale straight into FITS planes). The results are
+compared and each stage is timed. For files, threaded decoding is also timed against a
+single decoding thread.
+
+  webcam_capture_benchmark <video file | pipe:0> [frames] [x y w h]
+
+For instance, to feed it an MJPEG stream:
+
+  ffmpeg -f lavfi -i testsrc2=size=1920x1080:rate=30 -t 10 -f mjpeg - | webcam_capture_benchmark pipe:0
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "webcam_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#ifdef __cplusplus
+}
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* Largest mean difference per frame, in 8 bit units, accepted between the two paths */
+#define MAX_MEAN_DIFFERENCE 1.0
+
+/* Input and decoder setup of indi_webcam::ConnectToSource */
+class VideoInput
+{
+    public:
+        ~VideoInput()
+        {
+            av_frame_free(&frame);
+            av_frame_free(&swFrame);
+            if (codecCtx)
+                avcodec_free_context(&codecCtx);
+            if (formatCtx)
+                avformat_close_input(&formatCtx);
+        }
+
+        bool open(const char *url, bool threaded)
+        {
+            if (avformat_open_input(&formatCtx, url, nullptr, nullptr) != 0 ||
+                    avformat_find_stream_info(formatCtx, nullptr) < 0)
+                return false;
+
+            for (unsigned int i = 0; i < formatCtx->nb_streams; i++)
+                if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+                    videoStream = i;
+            if (videoStream == -1)
+                return false;
+
+            AVCodec *codec = avcodec_find_decoder(formatCtx->streams[videoStream]->codecpar->codec_id);
+            if (codec == nullptr)
+                return false;
+            codecCtx = avcodec_alloc_context3(codec);
+            avcodec_parameters_to_context(codecCtx, formatCtx->streams[videoStream]->codecpar);
+            frame = av_frame_alloc();
+            swFrame = av_frame_alloc();
+
+            if (!threaded)
+            {
+                codecCtx->thread_count = 1;
+                return avcodec_open2(codecCtx, codec, nullptr) >= 0;
+            }
+            std::string device;
+            return WebcamCapture::openDecoder(codecCtx, codec, false, nullptr, device);
+        }
+
+        /* indi_webcam::getStreamFrame: next decoded video frame, or nullptr at the end */
+        AVFrame *read(WebcamCapture::Timings &timings)
+        {
+            AVPacket packet;
+            bool flushing = false;
+            while (true)
+            {
+                auto start = Clock::now();
+                int ret = flushing ? AVERROR_EOF : av_read_frame(formatCtx, &packet);
+                timings.read += seconds(start);
+
+                start = Clock::now();
+                if (ret < 0)
+                {
+                    // Drain the frames the decoder threads still hold
+                    if (!flushing)
+                        avcodec_send_packet(codecCtx, nullptr);
+                    flushing = true;
+                }
+                else if (packet.stream_index != videoStream)
+                {
+                    av_packet_unref(&packet);
+                    continue;
+                }
+                else
+                {
+                    AVFrame *decoded = nullptr;
+                    ret = WebcamCapture::sendPacket(codecCtx, &packet, frame, swFrame, &decoded);
+                    av_packet_unref(&packet);
+                    if (ret < 0)
+                        return nullptr;
+                    if (decoded != nullptr)
+                    {
+                        timings.decode += seconds(start);
+                        return decoded;
+                    }
+                }
+
+                AVFrame *decoded = nullptr;
+                ret = WebcamCapture::receiveFrame(codecCtx, frame, swFrame, &decoded);
+                timings.decode += seconds(start);
+                if (ret == 0)
+                    return decoded;
+                if (ret != AVERROR(EAGAIN))
+                    return nullptr;
+            }
+        }
+
+        AVFormatContext *formatCtx { nullptr };
+        AVCodecContext *codecCtx { nullptr };
+        AVFrame *frame { nullptr };
+        AVFrame *swFrame { nullptr };
+        int videoStream { -1 };
+};
+
+/* One output format of the driver, run through both paths */
+struct Path
+{
+    const char *name;
+    WebcamCapture::Output output;
+    AVPixelFormat packed;
+    int bpp;
+    int channels;
+
+    SwsContext *sws { nullptr };
+    WebcamCapture::FrameConverter converter;
+    std::vector<uint8_t> packedFrame, fitsFrame, result;
+    double before { 0 }, after { 0 }, maxMean { 0 };
+    int maxDifference { 0 };
+};
+
+/*
+ * The capture path of indi_webcam before: sws_scale of the whole frame into pFrameOUT,
+ * convertINDI_RGBtoFITS_RGB into the frame buffer, then the subframe copied out of it
+ * into a malloc'd buffer by finishExposure.
+ */
+static void captureBefore(Path &path, AVFrame *frame, int x, int y, int w, int h)
+{
+    int width = frame->width, height = frame->height;
+    size_t bytes = path.bpp / 8;
+    path.packedFrame.resize((size_t)width * height * path.channels * bytes);
+    path.fitsFrame.resize(path.packedFrame.size());
+
+    path.sws = sws_getCachedContext(path.sws, width, height, (AVPixelFormat)frame->format, width, height, path.packed,
+                                    SWS_BILINEAR, nullptr, nullptr, nullptr);
+    uint8_t *out[4] = { path.packedFrame.data(), nullptr, nullptr, nullptr };
+    int outLinesize[4] = { (int)(width * path.channels * bytes), 0, 0, 0 };
+    sws_scale(path.sws, (uint8_t const * const *)frame->data, frame->linesize, 0, height, out, outLinesize);
+
+    size_t plane = (size_t)width * height;
+    if (path.channels == 3)
+    {
+        for (size_t i = 0; i < plane; i++)
+            for (int c = 0; c < 3; c++)
+                memcpy(&path.fitsFrame[(c * plane + i) * bytes], &path.packedFrame[(i * 3 + c) * bytes], bytes);
+    }
+    else
+        memcpy(path.fitsFrame.data(), path.packedFrame.data(), path.packedFrame.size());
+
+    size_t lineW = w * bytes;
+    uint8_t *subframe = (uint8_t *)malloc(lineW * h * path.channels);
+    for (int c = 0; c < path.channels; c++)
+        for (int row = y; row < y + h; row++)
+            memcpy(subframe + (c * h + row - y) * lineW, &path.fitsFrame[(c * plane + (size_t)row * width + x) * bytes],
+                   lineW);
+    path.result.assign(subframe, subframe + lineW * h * path.channels);
+    free(subframe);
+}
+
+/* Compares the subframe of captureBefore with the output of the converter */
+static void compare(Path &path, const std::vector<uint8_t> &converted)
+{
+    size_t samples = converted.size() / (path.bpp / 8);
+    double total = 0;
+    for (size_t i = 0; i < samples; i++)
+    {
+        int a, b;
+        if (path.bpp == 16)
+        {
+            a = ((const uint16_t *)path.result.data())[i] / 257;
+            b = ((const uint16_t *)converted.data())[i] / 257;
+        }
+        else
+        {
+            a = path.result[i];
+            b = converted[i];
+        }
+        int difference = abs(a - b);
+        total += difference;
+        if (difference > path.maxDifference)
+            path.maxDifference = difference;
+    }
+    double mean = samples ? total / samples : 0;
+    if (mean > path.maxMean)
+        path.maxMean = mean;
+}
+
+static double decodeOnly(const char *url, bool threaded, int count)
+{
+    VideoInput input;
+    if (!input.open(url, threaded))
+        return 0;
+    WebcamCapture::Timings timings;
+    int frames = 0;
+    auto start = Clock::now();
+    while (frames < count && input.read(timings))
+        frames++;
+    return frames / seconds(start);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <video file | pipe:0> [frames] [x y w h]\n", argv[0]);
+        return 1;
+    }
+    const char *url = argv[1];
+    int count = argc > 2 ? atoi(argv[2]) : 300;
+    bool pipe = !strncmp(url, "pipe:", 5);
+
+    VideoInput input;
+    if (!input.open(url, true))
+    {
+        fprintf(stderr, "Cannot open a video stream in %s\n", url);
+        return 1;
+    }
+    int width = input.codecCtx->width, height = input.codecCtx->height;
+
+    // The default subframe is the middle of the frame, starting on odd pixels
+    int x = width / 4 | 1, y = height / 4 | 1, w = width / 2, h = height / 2;
+    if (argc > 6)
+    {
+        x = atoi(argv[3]);
+        y = atoi(argv[4]);
+        w = atoi(argv[5]);
+        h = atoi(argv[6]);
+    }
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > width || y + h > height)
+    {
+        fprintf(stderr, "Subframe %dx%d+%d+%d does not fit in %dx%d\n", w, h, x, y, width, height);
+        return 1;
+    }
+
+    printf("%s: %s %dx%d %s, %d decoder threads, subframe %dx%d+%d+%d\n", url, input.codecCtx->codec->name, width,
+           height, av_get_pix_fmt_name(input.codecCtx->pix_fmt), input.codecCtx->thread_count, w, h, x, y);
+
+    std::vector<Path> paths(3);
+    paths[0].name = "8 bit RGB";
+    paths[0].output = WebcamCapture::OUTPUT_RGB8;
+    paths[0].packed = AV_PIX_FMT_RGB24;
+    paths[0].bpp = 8;
+    paths[0].channels = 3;
+    paths[1].name = "16 bit RGB";
+    paths[1].output = WebcamCapture::OUTPUT_RGB16;
+    paths[1].packed = AV_PIX_FMT_RGB48LE;
+    paths[1].bpp = 16;
+    paths[1].channels = 3;
+    paths[2].name = "16 bit Grayscale";
+    paths[2].output = WebcamCapture::OUTPUT_GRAY16;
+    paths[2].packed = AV_PIX_FMT_GRAY16LE;
+    paths[2].bpp = 16;
+    paths[2].channels = 1;
+    for (auto &path : paths)
+        path.converter.configure(path.output, x, y, w, h);
+
+    WebcamCapture::Timings timings;
+    AVFrame *cropped = av_frame_alloc();
+    std::vector<uint8_t> converted;
+    int frames = 0;
+    auto start = Clock::now();
+    AVFrame *frame;
+    while (frames < count && (frame = input.read(timings)) != nullptr)
+    {
+        for (auto &path : paths)
+        {
+            auto pathStart = Clock::now();
+            captureBefore(path, frame, x, y, w, h);
+            path.before += seconds(pathStart);
+
+            // The converter crops the frame it is given, so give it a reference of its own
+            av_frame_ref(cropped, frame);
+            converted.resize(WebcamCapture::frameSize(path.output, frame->format, w, h));
+            pathStart = Clock::now();
+            bool ok = path.converter.convert(cropped, converted.data());
+            path.after += seconds(pathStart);
+            av_frame_unref(cropped);
+            if (!ok)
+            {
+                fprintf(stderr, "%s: conversion failed\n", path.name);
+                return 1;
+            }
+            compare(path, converted);
+        }
+        frames++;
+    }
+    double elapsed = seconds(start);
+    av_frame_free(&cropped);
+    for (auto &path : paths)
+        sws_freeContext(path.sws);
+
+    if (frames == 0)
+    {
+        fprintf(stderr, "No frames decoded\n");
+        return 1;
+    }
+
+    printf("%d frames in %.2f s\n", frames, elapsed);
+    printf("  read    %7.3f ms/frame\n", timings.read * 1000 / frames);
+    printf("  decode  %7.3f ms/frame\n", timings.decode * 1000 / frames);
+    bool passed = true;
+    for (auto &path : paths)
+    {
+        bool ok = path.maxMean <= MAX_MEAN_DIFFERENCE;
+        passed = passed && ok;
+        printf("  %-17s before %7.3f ms/frame, now %7.3f ms/frame (%.1fx), mean difference %.3f, max %d %s\n", path.name,
+               path.before * 1000 / frames, path.after * 1000 / frames, path.before / path.after, path.maxMean,
+               path.maxDifference, ok ? "" : "MISMATCH");
+    }
+
+    // A pipe can only be read once
+    if (!pipe)
+    {
+        double single = decodeOnly(url, false, count);
+        double threaded = decodeOnly(url, true, count);
+        printf("  decoding alone: %.1f fps on one thread, %.1f fps threaded (%.1fx)\n", single, threaded,
+               single > 0 ? threaded / single : 0);
+    }
+
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,438 @@
+/*
+INDI Webcam CCD Driver - Rapid stacking engine
+
+This driver is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "webcam_stack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WEBCAM_STACK_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define WEBCAM_STACK_NEON
+#include <arm_neon.h>
+#endif
+
+// Frames that can wait for the worker before addFrame blocks
+#define STACK_QUEUE_SLOTS 3
+
+namespace WebcamStack
+{
+
+template <typename T>
+static void sumScalar(const T *src, uint32_t *sum, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++)
+        sum[i] += src[i];
+}
+
+/*
+ * One step of Welford's running mean and variance, skipped when the sample lies more than
+ * sigma deviations from the mean. The variance gets a floor of one unit so that samples
+ * which happened to read the same value a few times are not frozen by quantization.
+ * Written as count * delta^2 > sigma^2 * (m2 + count) to avoid a square root and a division.
+ */
+template <typename T>
+static void sigmaClipScalar(const T *src, float *mean, float *m2, float *count, size_t samples, float sigma2)
+{
+    for (size_t i = 0; i < samples; i++)
+    {
+        float x = src[i];
+        float delta = x - mean[i];
+        if (count[i] >= STACK_SIGMA_MIN_FRAMES && delta * delta * count[i] > sigma2 * (m2[i] + count[i]))
+            continue;
+        count[i] += 1.0f;
+        mean[i] += delta / count[i];
+        m2[i] += delta * (x - mean[i]);
+    }
+}
+
+#ifdef WEBCAM_STACK_SSE2
+__attribute__((target("sse2")))
+static void sum8SSE2(const uint8_t *src, uint32_t *sum, size_t samples)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t blocks = samples / 16;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i *s = reinterpret_cast<__m128i *>(sum);
+
+        _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(s + 2, _mm_add_epi32(_mm_loadu_si128(s + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(s + 3, _mm_add_epi32(_mm_loadu_si128(s + 3), _mm_unpackhi_epi16(hi, zero)));
+
+        src += 16;
+        sum += 16;
+    }
+
+    sumScalar(src, sum, samples % 16);
+}
+
+__attribute__((target("sse2")))
+static void sum16SSE2(const uint16_t *src, uint32_t *sum, size_t samples)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t blocks = samples / 8;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i *s = reinterpret_cast<__m128i *>(sum);
+
+        _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(v, zero)));
+        _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(v, zero)));
+
+        src += 8;
+        sum += 8;
+    }
+
+    sumScalar(src, sum, samples % 8);
+}
+
+__attribute__((target("sse2")))
+static inline __m128 load4(const uint8_t *src)
+{
+    int32_t bytes;
+    memcpy(&bytes, src, sizeof(bytes));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+    return _mm_cvtepi32_ps(v);
+}
+
+__attribute__((target("sse2")))
+static inline __m128 load4(const uint16_t *src)
+{
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* Same arithmetic as sigmaClipScalar, four samples at a time */
+template <typename T>
+__attribute__((target("sse2")))
+static void sigmaClipSSE2(const T *src, float *mean, float *m2, float *count, size_t samples, float sigma2)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minFrames = _mm_set1_ps(STACK_SIGMA_MIN_FRAMES);
+    const __m128 s2 = _mm_set1_ps(sigma2);
+    size_t blocks = samples / 4;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        __m128 x = load4(src);
+        __m128 mu = _mm_loadu_ps(mean);
+        __m128 var = _mm_loadu_ps(m2);
+        __m128 n = _mm_loadu_ps(count);
+        __m128 delta = _mm_sub_ps(x, mu);
+
+        __m128 keep = _mm_or_ps(_mm_cmplt_ps(n, minFrames),
+                                _mm_cmple_ps(_mm_mul_ps(_mm_mul_ps(delta, delta), n), _mm_mul_ps(s2, _mm_add_ps(var, n))));
+        __m128 n1 = _mm_add_ps(n, one);
+        __m128 mu1 = _mm_add_ps(mu, _mm_div_ps(delta, n1));
+        __m128 var1 = _mm_add_ps(var, _mm_mul_ps(delta, _mm_sub_ps(x, mu1)));
+
+        _mm_storeu_ps(mean, select(keep, mu1, mu));
+        _mm_storeu_ps(m2, select(keep, var1, var));
+        _mm_storeu_ps(count, select(keep, n1, n));
+
+        src += 4;
+        mean += 4;
+        m2 += 4;
+        count += 4;
+    }
+
+    sigmaClipScalar(src, mean, m2, count, samples % 4, sigma2);
+}
+#endif
+
+#ifdef WEBCAM_STACK_NEON
+static void sum8NEON(const uint8_t *src, uint32_t *sum, size_t samples)
+{
+    size_t blocks = samples / 16;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        uint8x16_t v = vld1q_u8(src);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+
+        vst1q_u32(sum, vaddw_u16(vld1q_u32(sum), vget_low_u16(lo)));
+        vst1q_u32(sum + 4, vaddw_u16(vld1q_u32(sum + 4), vget_high_u16(lo)));
+        vst1q_u32(sum + 8, vaddw_u16(vld1q_u32(sum + 8), vget_low_u16(hi)));
+        vst1q_u32(sum + 12, vaddw_u16(vld1q_u32(sum + 12), vget_high_u16(hi)));
+
+        src += 16;
+        sum += 16;
+    }
+
+    sumScalar(src, sum, samples % 16);
+}
+
+static void sum16NEON(const uint16_t *src, uint32_t *sum, size_t samples)
+{
+    size_t blocks = samples / 8;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        uint16x8_t v = vld1q_u16(src);
+
+        vst1q_u32(sum, vaddw_u16(vld1q_u32(sum), vget_low_u16(v)));
+        vst1q_u32(sum + 4, vaddw_u16(vld1q_u32(sum + 4), vget_high_u16(v)));
+
+        src += 8;
+        sum += 8;
+    }
+
+    sumScalar(src, sum, samples % 8);
+}
+#endif
+
+struct Kernels
+{
+    void (*sum8)(const uint8_t *, uint32_t *, size_t);
+    void (*sum16)(const uint16_t *, uint32_t *, size_t);
+    void (*clip8)(const uint8_t *, float *, float *, float *, size_t, float);
+    void (*clip16)(const uint16_t *, float *, float *, float *, size_t, float);
+    const char *name;
+};
+
+static Kernels selectKernels()
+{
+#if defined(WEBCAM_STACK_SSE2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        return { sum8SSE2, sum16SSE2, sigmaClipSSE2<uint8_t>, sigmaClipSSE2<uint16_t>, "SSE2" };
+#elif defined(WEBCAM_STACK_NEON)
+    // NEON has no single precision division on 32 bit ARM, sigma clipping stays scalar
+    return { sum8NEON, sum16NEON, sigmaClipScalar<uint8_t>, sigmaClipScalar<uint16_t>, "NEON" };
+#endif
+    return { sumScalar<uint8_t>, sumScalar<uint16_t>, sigmaClipScalar<uint8_t>, sigmaClipScalar<uint16_t>, "Scalar" };
+}
+
+static const Kernels &kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+const char *kernelName()
+{
+    return kernels().name;
+}
+
+static void sumSamples(const uint8_t *src, uint32_t *sum, size_t samples)
+{
+    kernels().sum8(src, sum, samples);
+}
+
+static void sumSamples(const uint16_t *src, uint32_t *sum, size_t samples)
+{
+    kernels().sum16(src, sum, samples);
+}
+
+static void sigmaClipSamples(const uint8_t *src, float *mean, float *m2, float *count, size_t samples, float sigma2)
+{
+    kernels().clip8(src, mean, m2, count, samples, sigma2);
+}
+
+static void sigmaClipSamples(const uint16_t *src, float *mean, float *m2, float *count, size_t samples, float sigma2)
+{
+    kernels().clip16(src, mean, m2, count, samples, sigma2);
+}
+
+template <typename T>
+Stack<T>::Stack(Mode mode, size_t samples, float sigma) : m_Mode(mode), m_Samples(samples), m_Sigma2(sigma * sigma)
+{
+    if (m_Mode == STACK_SIGMA_CLIP)
+    {
+        m_Mean.assign(samples, 0.0f);
+        m_M2.assign(samples, 0.0f);
+        m_Count.assign(samples, 0.0f);
+    }
+    else
+        m_Sum.assign(samples, 0);
+}
+
+template <typename T>
+void Stack<T>::add(const T *frame)
+{
+    if (m_Mode == STACK_SIGMA_CLIP)
+        sigmaClipSamples(frame, m_Mean.data(), m_M2.data(), m_Count.data(), m_Samples, m_Sigma2);
+    else
+        sumSamples(frame, m_Sum.data(), m_Samples);
+    m_Frames++;
+}
+
+template <typename T>
+void Stack<T>::result(T *frame) const
+{
+    const uint32_t max = std::numeric_limits<T>::max();
+
+    if (m_Mode == STACK_SIGMA_CLIP)
+    {
+        for (size_t i = 0; i < m_Samples; i++)
+            frame[i] = static_cast<T>(std::min<float>(std::round(m_Mean[i]), max));
+    }
+    else if (m_Mode == STACK_AVERAGE && m_Frames > 0)
+    {
+        const uint32_t n = m_Frames;
+        for (size_t i = 0; i < m_Samples; i++)
+            frame[i] = static_cast<T>((m_Sum[i] + n / 2) / n);
+    }
+    else
+    {
+        for (size_t i = 0; i < m_Samples; i++)
+            frame[i] = static_cast<T>(std::min(m_Sum[i], max));
+    }
+}
+
+template class Stack<uint8_t>;
+template class Stack<uint16_t>;
+
+FrameStacker::~FrameStacker()
+{
+    abort();
+}
+
+bool FrameStacker::start(Mode mode, int bpp, size_t samples, float sigma)
+{
+    abort();
+
+    m_Stack8.reset();
+    m_Stack16.reset();
+    if (bpp == 8)
+        m_Stack8.reset(new Stack<uint8_t>(mode, samples, sigma));
+    else if (bpp == 16)
+        m_Stack16.reset(new Stack<uint16_t>(mode, samples, sigma));
+    else
+        return false;
+
+    m_FrameBytes = samples * bpp / 8;
+    m_Slots.resize(STACK_QUEUE_SLOTS);
+    m_Free.clear();
+    for (size_t i = 0; i < m_Slots.size(); i++)
+    {
+        m_Slots[i].resize(m_FrameBytes);
+        m_Free.push_back(i);
+    }
+    m_Pending.clear();
+    m_Stopping = false;
+
+    m_Worker = std::thread(&FrameStacker::run, this);
+    return true;
+}
+
+void FrameStacker::addFrame(const uint8_t *frame)
+{
+    if (!isRunning())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Condition.wait(lock, [this] { return !m_Free.empty(); });
+    size_t slot = m_Free.back();
+    m_Free.pop_back();
+
+    // The slot is ours until it is queued, copy without holding the lock
+    lock.unlock();
+    memcpy(m_Slots[slot].data(), frame, m_FrameBytes);
+    lock.lock();
+
+    m_Pending.push_back(slot);
+    m_Condition.notify_all();
+}
+
+int FrameStacker::finish(uint8_t *frame)
+{
+    if (!isRunning())
+        return 0;
+
+    // The worker drains the queue before it exits
+    stop();
+
+    if (m_Stack8)
+    {
+        m_Stack8->result(frame);
+        return m_Stack8->frames();
+    }
+    m_Stack16->result(reinterpret_cast<uint16_t *>(frame));
+    return m_Stack16->frames();
+}
+
+void FrameStacker::abort()
+{
+    if (!isRunning())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (size_t slot : m_Pending)
+            m_Free.push_back(slot);
+        m_Pending.clear();
+    }
+    stop();
+}
+
+void FrameStacker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+    m_Worker.join();
+}
+
+void FrameStacker::run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_Condition.wait(lock, [this] { return !m_Pending.empty() || m_Stopping; });
+        if (m_Pending.empty())
+            break;
+
+        size_t slot = m_Pending.front();
+        m_Pending.pop_front();
+
+        lock.unlock();
+        addToStack(m_Slots[slot].data());
+        lock.lock();
+
+        m_Free.push_back(slot);
+        m_Condition.notify_all();
+    }
+}
+
+void FrameStacker::addToStack(const uint8_t *frame)
+{
+    if (m_Stack8)
+        m_Stack8->add(frame);
+    else
+        m_Stack16->add(reinterpret_cast<const uint16_t *>(frame));
+}
+
+}
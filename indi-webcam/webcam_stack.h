@@ -0,0 +1,141 @@
+/*
+INDI Webcam CCD Driver - Rapid stacking engine
+
+This driver is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Stacking of the frames captured during a rapid stacking exposure. Frames are stacked
+ * sample by sample in whatever layout they come in; the driver hands them over already
+ * cropped and in FITS layout, so the stack is written straight to the frame buffer.
+ *
+ * The accumulation kernels use SSE2 on x86 and NEON on ARM when the CPU has them, and
+ * portable loops otherwise.
+ */
+namespace WebcamStack
+{
+
+enum Mode
+{
+    STACK_SUM,       /* Integration: sum of the frames, clamped to the sample range */
+    STACK_AVERAGE,   /* Mean of the frames */
+    STACK_SIGMA_CLIP /* Running mean rejecting samples more than sigma deviations away */
+};
+
+/* Frames kept by every sample before sigma clipping starts rejecting */
+constexpr int STACK_SIGMA_MIN_FRAMES = 3;
+
+/**
+ * @brief Stacks frames of samples of type T. Sums are kept exactly in 32 bit planes, the
+ * sigma clipping mean and variance (Welford) in float planes.
+ */
+template <typename T>
+class Stack
+{
+    public:
+        Stack(Mode mode, size_t samples, float sigma);
+
+        /** Adds one frame of samples to the stack. */
+        void add(const T *frame);
+
+        /** Writes the stacked frame, rounded and clamped to the range of T. */
+        void result(T *frame) const;
+
+        int frames() const
+        {
+            return m_Frames;
+        }
+
+    private:
+        Mode m_Mode;
+        size_t m_Samples;
+        float m_Sigma2;
+        int m_Frames { 0 };
+        std::vector<uint32_t> m_Sum;
+        std::vector<float> m_Mean, m_M2, m_Count;
+};
+
+/**
+ * @brief Runs a Stack on a worker thread, so the next frame can be decoded while the
+ * previous one is being accumulated. Frames are copied into a few queue slots; addFrame
+ * only waits when all of them are still pending.
+ */
+class FrameStacker
+{
+    public:
+        FrameStacker() = default;
+        ~FrameStacker();
+
+        /**
+         * @brief start Drops any previous stack and starts a new one.
+         * @param mode stacking mode.
+         * @param bpp bits per sample of the frames, 8 or 16.
+         * @param samples number of samples per frame.
+         * @param sigma rejection threshold of STACK_SIGMA_CLIP, in standard deviations.
+         * @return false if the bit depth is not supported.
+         */
+        bool start(Mode mode, int bpp, size_t samples, float sigma);
+
+        /** Queues a copy of frame, samples * bpp / 8 bytes, for stacking. */
+        void addFrame(const uint8_t *frame);
+
+        /**
+         * @brief finish Waits for the queued frames and writes the stacked frame.
+         * @return number of frames stacked.
+         */
+        int finish(uint8_t *frame);
+
+        /** Stops stacking and drops the queued frames. */
+        void abort();
+
+        bool isRunning() const
+        {
+            return m_Worker.joinable();
+        }
+
+    private:
+        void run();
+        void addToStack(const uint8_t *frame);
+        void stop();
+
+        std::unique_ptr<Stack<uint8_t>> m_Stack8;
+        std::unique_ptr<Stack<uint16_t>> m_Stack16;
+        size_t m_FrameBytes { 0 };
+
+        std::thread m_Worker;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::vector<std::vector<uint8_t>> m_Slots;
+        std::vector<size_t> m_Free;
+        std::deque<size_t> m_Pending;
+        bool m_Stopping { false };
+};
+
+/** @return name of the selected kernel set, e.g. "SSE2". */
+const char *kernelName();
+
+}
@@ -0,0 +1,443 @@
+/*
+INDI Webcam Rapid Stacking Benchmark
+
+Decodes frames from a local video file the way indi_webcam_ccd reads its sources
+(avformat, avcodec, then swscale to the output format), checks the stacking engine
+against the per-sample loops the driver used before, and times both. Without a file,
+random frames of the given size are stacked instead.
+
+  webcam_stack_benchmark [video file | WIDTHxHEIGHT] [frames]
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "webcam_stack.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+#ifdef __cplusplus
+}
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/* Frames decoded to one output format, with the layout of pFrameOUT in the driver */
+struct Frames
+{
+    int width { 0 };
+    int height { 0 };
+    int bpp { 0 };
+    int channels { 0 };
+    size_t bytes { 0 };
+    std::vector<std::vector<uint8_t>> data;
+};
+
+/* Input and decoder setup of indi_webcam::ConnectToSource, for a file */
+class VideoFile
+{
+    public:
+        ~VideoFile()
+        {
+            if (codecCtx)
+                avcodec_free_context(&codecCtx);
+            if (formatCtx)
+                avformat_close_input(&formatCtx);
+        }
+
+        bool open(const char *path)
+        {
+            if (avformat_open_input(&formatCtx, path, nullptr, nullptr) != 0 ||
+                    avformat_find_stream_info(formatCtx, nullptr) < 0)
+                return false;
+
+            for (unsigned int i = 0; i < formatCtx->nb_streams; i++)
+                if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+                    videoStream = i;
+            if (videoStream == -1)
+                return false;
+
+            AVCodec *codec = avcodec_find_decoder(formatCtx->streams[videoStream]->codecpar->codec_id);
+            if (codec == nullptr)
+                return false;
+            codecCtx = avcodec_alloc_context3(codec);
+            avcodec_parameters_to_context(codecCtx, formatCtx->streams[videoStream]->codecpar);
+            return avcodec_open2(codecCtx, codec, nullptr) >= 0;
+        }
+
+        /* indi_webcam::getStreamFrame: next video frame, converted with sws_scale */
+        bool read(SwsContext *sws, AVFrame *frame, AVFrame *out)
+        {
+            AVPacket packet;
+            while (av_read_frame(formatCtx, &packet) >= 0)
+            {
+                bool decoded = false;
+                if (packet.stream_index == videoStream && avcodec_send_packet(codecCtx, &packet) >= 0)
+                    decoded = avcodec_receive_frame(codecCtx, frame) >= 0;
+                av_packet_unref(&packet);
+                if (decoded)
+                {
+                    sws_scale(sws, (uint8_t const * const *)frame->data, frame->linesize, 0, codecCtx->height,
+                              out->data, out->linesize);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        AVFormatContext *formatCtx { nullptr };
+        AVCodecContext *codecCtx { nullptr };
+        int videoStream { -1 };
+};
+
+/*
+ * Decodes up to count frames to format and passes each one to consume, as the driver
+ * does during an exposure. Returns the time spent decoding and consuming.
+ */
+template <typename Consume>
+static double decodeFile(const char *path, AVPixelFormat format, int count, Frames &frames, Consume consume)
+{
+    VideoFile file;
+    if (!file.open(path))
+    {
+        fprintf(stderr, "Cannot open a video stream in %s\n", path);
+        exit(1);
+    }
+
+    int w = file.codecCtx->width;
+    int h = file.codecCtx->height;
+    frames.width = w;
+    frames.height = h;
+    frames.bytes = av_image_get_buffer_size(format, w, h, 1);
+
+    AVFrame *frame = av_frame_alloc();
+    AVFrame *out = av_frame_alloc();
+    uint8_t *buffer = (uint8_t *)av_malloc(frames.bytes);
+    av_image_fill_arrays(out->data, out->linesize, buffer, format, w, h, 1);
+    SwsContext *sws = sws_getContext(w, h, file.codecCtx->pix_fmt, w, h, format, SWS_BILINEAR, nullptr, nullptr,
+                                     nullptr);
+
+    auto start = Clock::now();
+    for (int i = 0; i < count && file.read(sws, frame, out); i++)
+        consume(buffer);
+    double elapsed = seconds(start);
+
+    sws_freeContext(sws);
+    av_free(buffer);
+    av_frame_free(&out);
+    av_frame_free(&frame);
+    return elapsed;
+}
+
+static void loadFile(const char *path, AVPixelFormat format, int bpp, int channels, int count, Frames &frames)
+{
+    frames.bpp = bpp;
+    frames.channels = channels;
+    frames.data.clear();
+    decodeFile(path, format, count, frames, [&](const uint8_t *buffer)
+    {
+        frames.data.emplace_back(buffer, buffer + frames.bytes);
+    });
+}
+
+static void makeFrames(int width, int height, int bpp, int channels, int count, Frames &frames)
+{
+    frames.width = width;
+    frames.height = height;
+    frames.bpp = bpp;
+    frames.channels = channels;
+    frames.bytes = (size_t)width * height * channels * bpp / 8;
+    frames.data.assign(count, std::vector<uint8_t>(frames.bytes));
+
+    // Noise around a fixed scene, with a bright trail across one frame for sigma clipping to reject
+    std::vector<uint8_t> scene(frames.bytes);
+    for (auto &value : scene)
+        value = rand();
+    for (int f = 0; f < count; f++)
+        for (size_t i = 0; i < frames.bytes; i++)
+            frames.data[f][i] = (bpp == 16 && i % 2 == 0) ? rand() : scene[i] / 2 + rand() % 16;
+    if (count > WebcamStack::STACK_SIGMA_MIN_FRAMES)
+    {
+        size_t line = (size_t)width * channels * bpp / 8;
+        memset(frames.data[count - 1].data() + (height / 2) * line, 0xFF, line);
+    }
+}
+
+/*
+ * The stacking of indi_webcam before the engine: every frame converted to FITS RGB, then
+ * added sample by sample through the float helpers, which re-read the bit depth and
+ * recompute the line width on each call.
+ */
+struct Reference
+{
+    const Frames &frames;
+    std::vector<uint8_t> primary;
+    std::vector<float> stack;
+    int stacked { 0 };
+
+    explicit Reference(const Frames &f) : frames(f), primary(f.bytes), stack(f.bytes) {}
+
+    int bpp() const
+    {
+        return frames.bpp;
+    }
+
+    float getImageDataFloatValue(int x, int y) const
+    {
+        int w = frames.width * frames.channels;
+        if (bpp() == 8)
+            return (float)primary[y * w + x];
+        else if (bpp() == 16)
+            return (float)reinterpret_cast<const uint16_t *>(primary.data())[y * w + x];
+        return 0;
+    }
+
+    void setImageDataValueFromFloat(int x, int y, float value)
+    {
+        int w = frames.width * frames.channels;
+        if (bpp() == 8)
+            primary[y * w + x] = round(std::min<float>(value, std::numeric_limits<uint8_t>::max()));
+        else if (bpp() == 16)
+            reinterpret_cast<uint16_t *>(primary.data())[y * w + x] =
+                round(std::min<float>(value, std::numeric_limits<uint16_t>::max()));
+    }
+
+    void toFITS(const uint8_t *src)
+    {
+        size_t pixels = (size_t)frames.width * frames.height;
+        if (frames.channels == 1)
+            memcpy(primary.data(), src, frames.bytes);
+        else if (bpp() == 8)
+        {
+            for (size_t i = 0; i < pixels * 3; i++)
+                primary[(i % 3) * pixels + i / 3] = src[i];
+        }
+        else
+        {
+            const uint16_t *s = reinterpret_cast<const uint16_t *>(src);
+            uint16_t *d = reinterpret_cast<uint16_t *>(primary.data());
+            for (size_t i = 0; i < pixels * 3; i++)
+                d[(i % 3) * pixels + i / 3] = s[i];
+        }
+    }
+
+    void add(const uint8_t *src)
+    {
+        toFITS(src);
+        int w = frames.width * frames.channels;
+        size_t samples = frames.bytes / (bpp() / 8);
+        for (size_t i = 0; i < samples; i++)
+        {
+            int x = i % w;
+            int y = i / w;
+            if (stacked == 0)
+                stack[i] = getImageDataFloatValue(x, y);
+            else
+                stack[i] += getImageDataFloatValue(x, y);
+        }
+        stacked++;
+    }
+
+    void finish(bool averaging)
+    {
+        int w = frames.width * frames.channels;
+        size_t samples = frames.bytes / (bpp() / 8);
+        for (size_t i = 0; i < samples; i++)
+            setImageDataValueFromFloat(i % w, i / w, round(averaging ? stack[i] / stacked : stack[i]));
+    }
+};
+
+/* Sample i of an interleaved frame, at its FITS (planar) position */
+static size_t planarIndex(const Frames &frames, size_t i)
+{
+    if (frames.channels == 1)
+        return i;
+    size_t pixels = (size_t)frames.width * frames.height;
+    return (i % 3) * pixels + i / 3;
+}
+
+static uint32_t sample(const Frames &frames, const uint8_t *data, size_t i)
+{
+    return frames.bpp == 8 ? data[i] : reinterpret_cast<const uint16_t *>(data)[i];
+}
+
+/* Scalar Welford sigma clipping, the reference for the engine's kernels */
+static std::vector<float> referenceSigmaClip(const Frames &frames, float sigma)
+{
+    size_t samples = frames.bytes / (frames.bpp / 8);
+    std::vector<float> mean(samples), m2(samples), count(samples);
+    for (auto &frame : frames.data)
+    {
+        for (size_t i = 0; i < samples; i++)
+        {
+            float x = sample(frames, frame.data(), i);
+            float delta = x - mean[i];
+            if (count[i] >= WebcamStack::STACK_SIGMA_MIN_FRAMES && delta * delta * count[i] > sigma * sigma * (m2[i] + count[i]))
+                continue;
+            count[i] += 1.0f;
+            mean[i] += delta / count[i];
+            m2[i] += delta * (x - mean[i]);
+        }
+    }
+    return mean;
+}
+
+static double stackFrames(const Frames &frames, WebcamStack::Mode mode, float sigma, std::vector<uint8_t> &result)
+{
+    WebcamStack::FrameStacker stacker;
+    result.assign(frames.bytes, 0);
+
+    auto start = Clock::now();
+    stacker.start(mode, frames.bpp, frames.bytes / (frames.bpp / 8), sigma);
+    for (auto &frame : frames.data)
+        stacker.addFrame(frame.data());
+    stacker.finish(result.data());
+    return seconds(start);
+}
+
+static bool run(const Frames &frames, const char *path, AVPixelFormat format)
+{
+    size_t samples = frames.bytes / (frames.bpp / 8);
+    int count = frames.data.size();
+    double mb = frames.bytes / 1e6;
+    bool success = true;
+    std::vector<uint8_t> result;
+
+    printf("%dx%d %s %d bit, %d frames of %.1f MB, %s kernels\n", frames.width, frames.height,
+           frames.channels == 3 ? "RGB" : "gray", frames.bpp, count, mb, WebcamStack::kernelName());
+
+    // Driver loops before the engine
+    for (int averaging = 0; averaging < 2; averaging++)
+    {
+        Reference reference(frames);
+        auto start = Clock::now();
+        for (auto &frame : frames.data)
+            reference.add(frame.data());
+        reference.finish(averaging);
+        double elapsed = seconds(start);
+
+        double engine = stackFrames(frames, averaging ? WebcamStack::STACK_AVERAGE : WebcamStack::STACK_SUM, 3, result);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < samples; i++)
+            if (sample(frames, result.data(), i) != sample(frames, reference.primary.data(), planarIndex(frames, i)))
+                mismatches++;
+
+        printf("  %-11s before %7.1f fps   engine %7.1f fps   x%5.1f   %s\n", averaging ? "average" : "integration",
+               count / elapsed, count / engine, elapsed / engine, mismatches ? "MISMATCH" : "OK");
+        success = success && mismatches == 0;
+    }
+
+    // Sigma clipping against the scalar reference
+    {
+        std::vector<float> reference = referenceSigmaClip(frames, 3);
+        double engine = stackFrames(frames, WebcamStack::STACK_SIGMA_CLIP, 3, result);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < samples; i++)
+            if (std::fabs((float)sample(frames, result.data(), i) - reference[i]) > 0.5f)
+                mismatches++;
+
+        printf("  %-11s %22s engine %7.1f fps   %7s   %s\n", "sigma clip", "", count / engine, "",
+               mismatches ? "MISMATCH" : "OK");
+        success = success && mismatches == 0;
+    }
+
+    // Decoding and stacking of the same file, one after the other or overlapped
+    if (path)
+    {
+        Frames decoded;
+        Reference sequential(frames);
+        double alone = decodeFile(path, format, count, decoded, [&](const uint8_t *) {});
+        double before = decodeFile(path, format, count, decoded, [&](const uint8_t *buffer)
+        {
+            sequential.add(buffer);
+        });
+
+        WebcamStack::FrameStacker stacker;
+        stacker.start(WebcamStack::STACK_AVERAGE, frames.bpp, samples, 3);
+        double overlapped = decodeFile(path, format, count, decoded, [&](const uint8_t *buffer)
+        {
+            stacker.addFrame(buffer);
+        });
+        auto start = Clock::now();
+        stacker.finish(result.data());
+        overlapped += seconds(start);
+
+        printf("  decode only %7.1f fps   decode + stack before %7.1f fps   decode + engine %7.1f fps\n",
+               count / alone, count / before, count / overlapped);
+    }
+
+    printf("\n");
+    return success;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    int width = 1920, height = 1080;
+    int count = argc > 2 ? atoi(argv[2]) : 90;
+
+    if (argc > 1 && sscanf(argv[1], "%dx%d", &width, &height) != 2)
+        path = argv[1];
+    if (width < 1 || height < 1 || count < 1)
+    {
+        fprintf(stderr, "Usage: %s [video file | WIDTHxHEIGHT] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    // The output formats of the driver's rapid stacking: "8 bit RGB", "16 bit RGB", "16 bit Grayscale"
+    struct
+    {
+        AVPixelFormat format;
+        int bpp;
+        int channels;
+    } outputs[] = { { AV_PIX_FMT_RGB24, 8, 3 }, { AV_PIX_FMT_RGB48LE, 16, 3 }, { AV_PIX_FMT_GRAY16LE, 16, 1 } };
+
+    bool success = true;
+    for (auto &output : outputs)
+    {
+        Frames frames;
+        if (path)
+            loadFile(path, output.format, output.bpp, output.channels, count, frames);
+        else
+            makeFrames(width, height, output.bpp, output.channels, count, frames);
+        if (frames.data.empty())
+        {
+            fprintf(stderr, "No frames decoded from %s\n", path);
+            return 1;
+        }
+        success = run(frames, path, output.format) && success;
+    }
+
+    printf("%s\n", success ? "PASSED" : "FAILED");
+    return success ? 0 : 1;
+}
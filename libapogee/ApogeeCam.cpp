@@ -544,6 +544,19 @@ uint16_t  ApogeeCam::GetImageCount()
     return m_CamIo->ReadMirrorReg( CameraRegs::IMAGE_COUNT );
 }
 
+//////////////////////////// 
+// GET  IMAGE      NUM      PIXELS
+int32_t ApogeeCam::GetImageNumPixels()
+{
+#ifdef DEBUGGING_CAMERA
+    apgHelper::DebugMsg( "ApogeeCam::GetImageNumPixels" );
+#endif
+
+    uint16_t r=0, c=0;
+    ExposureAndGetImgRC( r, c );
+    return r*GetImageZ()*GetRoiNumCols();
+}
+
 //////////////////////////// 
 // GET  IMG    SEQUENCE        COUNT
 uint16_t ApogeeCam::GetImgSequenceCount()
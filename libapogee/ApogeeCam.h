@@ -1166,6 +1166,24 @@ class DLL_EXPORT ApogeeCam
          */
         virtual void GetImage( std::vector<uint16_t> & out ) = 0;
 
+        /*! 
+         * Downloads the image data from the camera straight into a caller
+         * supplied buffer, such as a frame buffer, saving the copy out of
+         * a vector.
+         * \param [out] out Buffer that will recieve the image data
+         * \param [in] numPixels Size of the out buffer in pixels, it must hold
+         * at least GetImageNumPixels() pixels.
+         * \exception std::runtime_error
+         */
+        virtual void GetImage( uint16_t * out, size_t numPixels ) = 0;
+
+        /*! 
+         * Returns the number of pixels GetImage() will download with the
+         * current ROI and bulk download settings.
+         * \exception std::runtime_error
+         */
+        int32_t GetImageNumPixels();
+
         /*! 
          * This method halts an in progress exposure. If this method is called 
          * and there is no exposure in progress a std::runtime_error exception is thrown.
@@ -1284,7 +1302,7 @@ class DLL_EXPORT ApogeeCam
         virtual uint16_t GetImageZ() = 0;
         virtual uint16_t GetIlluminationMask() = 0;
         virtual void FixImgFromCamera( const std::vector<uint16_t> & data,
-            std::vector<uint16_t> & out,  int32_t rows, int32_t cols) = 0;
+            uint16_t * out,  int32_t rows, int32_t cols) = 0;
                 
 //this code removes vc++ compiler warning C4251
 //from http://www.unknownroad.com/rtfm/VisualStudio/warningC4251.html
@@ -1316,6 +1334,7 @@ class DLL_EXPORT ApogeeCam
         bool m_IsInitialized;
         bool m_IsConnected;
 		double m_LastExposureTime;
+        std::vector<uint16_t> m_ImgFromCam;
      
     private:
 
@@ -205,27 +205,22 @@ void AspenEthernetIo::GetImageData(std::vector<uint16_t> & ImageData)
     //grab the data
     std::string fullUrl = m_url + "/aspen.bin?keyval=" + m_sessionKey;
     
-    std::vector<uint8_t> result;
-	// set container capacity so it doesn't waste time
-	// dynamically allocating space
-	result.reserve( NumBytesExpected );
 	m_libcurl->setTimeout( 60 + getLastExposureTime() ); // set extended timeout
-    m_libcurl->HttpGet( fullUrl, result );
+    //the pixels are already little endian, they go straight to ImageData
+    const size_t received = m_libcurl->HttpGetImage( fullUrl, 
+        &(*ImageData.begin()), ImageData.size(), false );
 	m_libcurl->setTimeout( -1 ); // restore default timeout
 
-    if( NumBytesExpected !=  apgHelper::SizeT2Int32( result.size() ) )
+    if( NumBytesExpected !=  apgHelper::SizeT2Int32( received ) )
     {
         std::stringstream msg;
         msg <<  fullUrl.c_str() << " error -  requested ";
         msg << NumBytesExpected << " bytes, but received ";
-        msg << result.size() << " bytes.";
+        msg << received << " bytes.";
 
         apgHelper::throwRuntimeException( m_fileName, msg.str() , 
             __LINE__, Apg::ErrorType_Critical );
     }
-
-    //faster than for loop
-    memcpy(&(*ImageData.begin()), &(*result.begin()), NumBytesExpected);
 }
 
 
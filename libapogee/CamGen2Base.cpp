@@ -316,6 +316,21 @@ Apg::Status CamGen2Base::GetImagingStatus()
 //////////////////////////// 
 // GET  IMAGE 
 void CamGen2Base::GetImage( std::vector<uint16_t> & out )
+{
+    const int32_t numPixels = GetImageNumPixels();
+
+    if( numPixels != apgHelper::SizeT2Int32( out.size() ) )
+    {
+        out.clear();
+        out.resize( numPixels );
+    }
+
+    GetImage( out.data(), out.size() );
+}
+
+//////////////////////////// 
+// GET  IMAGE 
+void CamGen2Base::GetImage( uint16_t * out, const size_t numPixels )
 {
 #ifdef DEBUGGING_CAMERA
     apgHelper::DebugMsg( "CamGen2Base::GetImage -> BEGIN" );
@@ -342,26 +357,33 @@ void CamGen2Base::GetImage( std::vector<uint16_t> & out )
     }
 
 
-    // allocating the buffers for the image
+    // sizing the staging buffer for the image
     // doing this outside of the try / catch, so that
     // even if the GetImage function throws
     // we can try to copy whatever data we managed
     // to fetch from the camera into the user supplied
-    // vector
+    // buffer.  the staging buffer is kept between images
+    // to save allocating it for every one of them
     uint16_t r=0, c= 0;
     ExposureAndGetImgRC( r, c );
     const uint16_t z = GetImageZ();
-    std::vector<uint16_t>  datafromCam( r*c*z );
 
     const int32_t dataLen = r*z;
     const int32_t numCols = GetRoiNumCols();
     
-    if( dataLen*numCols != apgHelper::SizeT2Int32( out.size() ) )
+    if( static_cast<size_t>( dataLen*numCols ) > numPixels )
     {
-        out.clear();
-        out.resize( dataLen*numCols );
+        std::stringstream msg;
+        msg << "Image buffer of " << numPixels << " pixels too small for ";
+        msg << dataLen << " rows by " << numCols << " cols.";
+        apgHelper::throwRuntimeException( m_fileName, msg.str(), 
+            __LINE__, Apg::ErrorType_InvalidUsage );
     }
 
+    std::vector<uint16_t> & datafromCam = m_ImgFromCam;
+    datafromCam.resize( r*c*z );
+    std::fill( datafromCam.begin(), datafromCam.end(), 0 );
+
     try
     {
         m_CamIo->GetImageData( datafromCam );
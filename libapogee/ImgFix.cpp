@@ -11,6 +11,154 @@
 
 #include "ImgFix.h" 
 #include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#define IMGFIX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMGFIX_NEON
+#include <arm_neon.h>
+#endif
+
+//////////////////////////// 
+// LOCAL     NAMESPACE
+// The reorder kernels work on 8 columns at a time, the scalar loops
+// in the functions below finish the rows.
+namespace
+{
+    const int32_t BLOCK_COLS = 8;
+
+#if defined(IMGFIX_SSE2)
+    inline __m128i Load( const uint16_t * p )
+    {
+        return _mm_loadu_si128( reinterpret_cast<const __m128i *>(p) );
+    }
+
+    inline void Store( uint16_t * p, const __m128i v )
+    {
+        _mm_storeu_si128( reinterpret_cast<__m128i *>(p), v );
+    }
+
+    inline __m128i Reverse( const __m128i v )
+    {
+        const __m128i r = _mm_shuffle_epi32( v, _MM_SHUFFLE(0,1,2,3) );
+        return _mm_shufflehi_epi16( _mm_shufflelo_epi16( r, _MM_SHUFFLE(2,3,0,1) ), 
+            _MM_SHUFFLE(2,3,0,1) );
+    }
+
+    // even and odd pixels of 16
+    inline void Deinterleave2( const uint16_t * src, __m128i & even, __m128i & odd )
+    {
+        const __m128i v0 = Load( src );
+        const __m128i v1 = Load( src + 8 );
+        const __m128i x0 = _mm_unpacklo_epi16( v0, v1 );
+        const __m128i x1 = _mm_unpackhi_epi16( v0, v1 );
+        const __m128i y0 = _mm_unpacklo_epi16( x0, x1 );
+        const __m128i y1 = _mm_unpackhi_epi16( x0, x1 );
+        even = _mm_unpacklo_epi16( y0, y1 );
+        odd = _mm_unpackhi_epi16( y0, y1 );
+    }
+
+    // pixels 4n, 4n+1, 4n+2 and 4n+3 of 32
+    inline void Deinterleave4( const uint16_t * src, __m128i & a, __m128i & b, 
+        __m128i & c, __m128i & d )
+    {
+        const __m128i v0 = Load( src );
+        const __m128i v1 = Load( src + 8 );
+        const __m128i v2 = Load( src + 16 );
+        const __m128i v3 = Load( src + 24 );
+        const __m128i x0 = _mm_unpacklo_epi16( v0, v1 );
+        const __m128i x1 = _mm_unpackhi_epi16( v0, v1 );
+        const __m128i x2 = _mm_unpacklo_epi16( v2, v3 );
+        const __m128i x3 = _mm_unpackhi_epi16( v2, v3 );
+        const __m128i y0 = _mm_unpacklo_epi16( x0, x1 );
+        const __m128i y1 = _mm_unpackhi_epi16( x0, x1 );
+        const __m128i y2 = _mm_unpacklo_epi16( x2, x3 );
+        const __m128i y3 = _mm_unpackhi_epi16( x2, x3 );
+        a = _mm_unpacklo_epi64( y0, y2 );
+        b = _mm_unpackhi_epi64( y0, y2 );
+        c = _mm_unpacklo_epi64( y1, y3 );
+        d = _mm_unpackhi_epi64( y1, y3 );
+    }
+
+    int32_t QuadRowBlocks( const uint16_t * src, uint16_t * top, uint16_t * bottom, 
+        const int32_t cols, const int32_t halfCols )
+    {
+        int32_t c = 0;
+        for( ; c + BLOCK_COLS <= halfCols; c += BLOCK_COLS, src += 4*BLOCK_COLS )
+        {
+            __m128i ul, ur, lr, ll;
+            Deinterleave4( src, ul, ur, lr, ll );
+            Store( top + c, ul );
+            Store( top + cols - c - BLOCK_COLS, Reverse( ur ) );
+            Store( bottom + cols - c - BLOCK_COLS, Reverse( lr ) );
+            Store( bottom + c, ll );
+        }
+        return c;
+    }
+
+    int32_t DualRowBlocks( const uint16_t * src, uint16_t * top, 
+        const int32_t urEnd, const int32_t halfCols )
+    {
+        int32_t c = 0;
+        for( ; c + BLOCK_COLS <= halfCols; c += BLOCK_COLS, src += 2*BLOCK_COLS )
+        {
+            __m128i ur, ul;
+            Deinterleave2( src, ur, ul );
+            Store( top + urEnd - c - BLOCK_COLS, Reverse( ur ) );
+            Store( top + c, ul );
+        }
+        return c;
+    }
+#elif defined(IMGFIX_NEON)
+    inline uint16x8_t Reverse( const uint16x8_t v )
+    {
+        const uint16x8_t r = vrev64q_u16( v );
+        return vcombine_u16( vget_high_u16( r ), vget_low_u16( r ) );
+    }
+
+    int32_t QuadRowBlocks( const uint16_t * src, uint16_t * top, uint16_t * bottom, 
+        const int32_t cols, const int32_t halfCols )
+    {
+        int32_t c = 0;
+        for( ; c + BLOCK_COLS <= halfCols; c += BLOCK_COLS, src += 4*BLOCK_COLS )
+        {
+            const uint16x8x4_t v = vld4q_u16( src );
+            vst1q_u16( top + c, v.val[0] );
+            vst1q_u16( top + cols - c - BLOCK_COLS, Reverse( v.val[1] ) );
+            vst1q_u16( bottom + cols - c - BLOCK_COLS, Reverse( v.val[2] ) );
+            vst1q_u16( bottom + c, v.val[3] );
+        }
+        return c;
+    }
+
+    int32_t DualRowBlocks( const uint16_t * src, uint16_t * top, 
+        const int32_t urEnd, const int32_t halfCols )
+    {
+        int32_t c = 0;
+        for( ; c + BLOCK_COLS <= halfCols; c += BLOCK_COLS, src += 2*BLOCK_COLS )
+        {
+            const uint16x8x2_t v = vld2q_u16( src );
+            vst1q_u16( top + urEnd - c - BLOCK_COLS, Reverse( v.val[0] ) );
+            vst1q_u16( top + c, v.val[1] );
+        }
+        return c;
+    }
+#else
+    int32_t QuadRowBlocks( const uint16_t *, uint16_t *, uint16_t *, 
+        const int32_t, const int32_t )
+    {
+        return 0;
+    }
+
+    int32_t DualRowBlocks( const uint16_t *, uint16_t *, 
+        const int32_t, const int32_t )
+    {
+        return 0;
+    }
+#endif
+}
 
 //////////////////////////// 
 //      SINGLE       OUPUT       ERASE
@@ -32,26 +180,58 @@ void ImgFix::SingleOuputCopy( const std::vector<uint16_t> & data,
       std::vector<uint16_t> & out, const int32_t rows,  const int32_t numImgCols,  
       const int32_t numLatencyPixels )
 {
+    SingleOuputCopy( &data[0], &out[0], rows, numImgCols, numLatencyPixels );
+}
+
+//////////////////////////// 
+//      QUAD      OUPUT       COPY
+void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data, 
+      std::vector<uint16_t> & out, const int32_t rows,  const int32_t cols,  
+      const int32_t numLatencyPixels, const int32_t outputBuffOffset )
+{
+    QuadOuputCopy( &data[0], &out[0], rows, cols, numLatencyPixels, outputBuffOffset );
+}
 
+//////////////////////////// 
+//      QUAD       OUPUT       FIX
+void ImgFix::QuadOuputFix( const std::vector<uint16_t> & data, 
+                                             std::vector<uint16_t> & out,
+                                             const int32_t rows,  const int32_t cols,
+                                             const int32_t numLatencyPixels)
+{
+    QuadOuputFix( &data[0], &out[0], rows, cols, numLatencyPixels );
+}
+
+//////////////////////////// 
+//      DUAL       OUPUT       FIX
+void ImgFix::DualOuputFix( const std::vector<uint16_t> & data, 
+                                             std::vector<uint16_t> & out,
+                                             const int32_t rows,  const int32_t cols,
+                                             const int32_t numLatencyPixels)
+{
+    DualOuputFix( &data[0], &out[0], rows, cols, numLatencyPixels );
+}
+
+//////////////////////////// 
+//      SINGLE       OUPUT       COPY
+void ImgFix::SingleOuputCopy( const uint16_t * data, uint16_t * out, 
+    const int32_t rows, const int32_t numImgCols, const int32_t numLatencyPixels )
+{
     // in testing found that this function is much faster than the erase function
     const int32_t actNumCols = numImgCols + numLatencyPixels;
 
     for(int32_t r = 0, actColsOffset=numLatencyPixels, outColsOffset=0; r < rows;
 		    actColsOffset += actNumCols, outColsOffset += numImgCols, ++r)
     {
-        std::vector<uint16_t>::const_iterator start = data.begin()+actColsOffset;
-        std::vector<uint16_t>::const_iterator end = start + numImgCols;
-        std::vector<uint16_t>::iterator outStart = out.begin() + outColsOffset;
-        std::copy( start, end, outStart );
+        memcpy( out + outColsOffset, data + actColsOffset, numImgCols*sizeof(uint16_t) );
     }
 }
 
-
 //////////////////////////// 
 //      QUAD      OUPUT       COPY
-void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data, 
-      std::vector<uint16_t> & out, const int32_t rows,  const int32_t cols,  
-      const int32_t numLatencyPixels, const int32_t outputBuffOffset )
+void ImgFix::QuadOuputCopy( const uint16_t * data, uint16_t * out, 
+    const int32_t rows, const int32_t cols, const int32_t numLatencyPixels, 
+    const int32_t outputBuffOffset )
 {
     int32_t numGood =  ( cols / 2 ) * 4;
     int32_t numBad = numLatencyPixels*2;
@@ -65,10 +245,7 @@ void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data,
     {
          int32_t len = std::min<int32_t>( down, numGood );
 
-        std::vector<uint16_t>::const_iterator start = data.begin()+badStart;
-        std::vector<uint16_t>::const_iterator end = start + len;
-        std::vector<uint16_t>::iterator outStart = out.begin() + outputBuffOffset + goodStart;
-        std::copy( start, end, outStart );
+         memcpy( out + outputBuffOffset + goodStart, data + badStart, len*sizeof(uint16_t) );
 
          goodStart += len;
          badStart += (len + numBad);
@@ -78,80 +255,65 @@ void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data,
 
 //////////////////////////// 
 //      QUAD       OUPUT       FIX
-void ImgFix::QuadOuputFix( const std::vector<uint16_t> & data, 
-                                             std::vector<uint16_t> & out,
-                                             const int32_t rows,  const int32_t cols,
-                                             const int32_t numLatencyPixels)
+// Each input row carries a row pair: the top row from both ends and the
+// bottom row from both ends, one pixel of each in turn.
+void ImgFix::QuadOuputFix( const uint16_t * data, uint16_t * out,
+    const int32_t rows, const int32_t cols, const int32_t numLatencyPixels )
 {
     const int32_t HALF_COLS = cols / 2;
     const int32_t HALF_ROWS = rows / 2;
     
-    int32_t index = numLatencyPixels*2;
+    const uint16_t * src = data + numLatencyPixels*2;
   
     for( int32_t r=0; r < HALF_ROWS; ++r )
     {
-        int32_t topOffset = cols*r;
-        int32_t bottomOffset = (cols*(rows-(r+1)));
+        uint16_t * top = out + cols*r;
+        uint16_t * bottom = out + cols*(rows-(r+1));
+
+        int32_t c = QuadRowBlocks( src, top, bottom, cols, HALF_COLS );
 
-        for( int32_t c=0; c < HALF_COLS; ++c)
+        for( ; c < HALF_COLS; ++c)
         {
-            int32_t ul = topOffset + c;
-            out[ul] = data[index];
-
-            int32_t ur =  topOffset + (cols-(c+1) );
-            ++index;
-            out[ur] = data[index];
-            
-            int32_t lr = bottomOffset + (cols-(c+1) );
-            ++index;
-            out[lr] = data[index];
-
-            int32_t ll = bottomOffset+c;
-            ++index;
-            out[ll] = data[index];
-
-            ++index;
+            top[c] = src[4*c];
+            top[cols-(c+1)] = src[4*c+1];
+            bottom[cols-(c+1)] = src[4*c+2];
+            bottom[c] = src[4*c+3];
         }
 
         //skip the latency pixels
-        index += numLatencyPixels*2;
+        src += 4*HALF_COLS + numLatencyPixels*2;
     }
 }
 
 //////////////////////////// 
 //      DUAL       OUPUT       FIX
-void ImgFix::DualOuputFix( const std::vector<uint16_t> & data, 
-                                             std::vector<uint16_t> & out,
-                                             const int32_t rows,  const int32_t cols,
-                                             const int32_t numLatencyPixels)
+// Each input row carries the right half from its end and the left half
+// from its start, one pixel of each in turn.
+void ImgFix::DualOuputFix( const uint16_t * data, uint16_t * out,
+    const int32_t rows, const int32_t cols, const int32_t numLatencyPixels )
 {
-   
     const int32_t HALF_COLS = cols / 2;
 
      //account for the odd no op col
     const int32_t oddAdjust = ( cols % 2 ) ? 1 : 0;
-    const int32_t START_UR_COL = cols;
+    const int32_t UR_END = cols - oddAdjust;
 
-    int32_t index = numLatencyPixels;
+    const uint16_t * src = data + numLatencyPixels;
   
     for( int32_t r=0; r < rows; ++r )
     {
-        int32_t topOffset = cols*r;
+        uint16_t * top = out + cols*r;
+
+        int32_t c = DualRowBlocks( src, top, UR_END, HALF_COLS );
 
-        for( int32_t c=0; c < HALF_COLS; ++c)
+        for( ; c < HALF_COLS; ++c)
         {
             // skip odd col if need with oddAdjust
-            int32_t ur =  topOffset + (START_UR_COL-(c+1) ) - oddAdjust;
-            out[ur] = data[index];
-
-           int32_t ul = topOffset + c;
-            ++index;
-            out[ul] = data[index];
-            
-            ++index;
+            top[UR_END-(c+1)] = src[2*c];
+            top[c] = src[2*c+1];
         }
 
         //skip the latency pixels
-        index += numLatencyPixels;
+        src += 2*HALF_COLS + numLatencyPixels;
     }
 }
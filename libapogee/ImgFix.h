@@ -38,6 +38,23 @@ namespace ImgFix
                                      std::vector<uint16_t> & out,
                                      const int32_t rows,  const int32_t cols,
                                      const int32_t numLatencyPixels );
+
+    // Same as above, writing straight into a caller supplied buffer of
+    // rows*cols pixels (plus outputBuffOffset for QuadOuputCopy).  The
+    // data buffer holds the pixels as they come from the camera, latency
+    // pixels included.
+    void SingleOuputCopy( const uint16_t * data, uint16_t * out,
+        int32_t rows, int32_t numImgCols, int32_t numLatencyPixels );
+
+    void QuadOuputCopy( const uint16_t * data, uint16_t * out,
+        int32_t rows, int32_t cols, int32_t numLatencyPixels,
+        int32_t outputBuffOffset=0 );
+
+    void QuadOuputFix( const uint16_t * data, uint16_t * out,
+        int32_t rows, int32_t cols, int32_t numLatencyPixels );
+
+    void DualOuputFix( const uint16_t * data, uint16_t * out,
+        int32_t rows, int32_t cols, int32_t numLatencyPixels );
 }; 
 
 #endif
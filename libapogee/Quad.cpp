@@ -200,7 +200,7 @@ void Quad::VerifyCamId()
 //////////////////////////// 
 //      FIX      IMG        FROM          CAMERA
 void Quad::FixImgFromCamera( const std::vector<uint16_t> & data,
-                                            std::vector<uint16_t> & out,  const int32_t rows, 
+                                            uint16_t * out,  const int32_t rows, 
                                             const int32_t cols)
 {
     int32_t offset = 0; 
@@ -209,7 +209,7 @@ void Quad::FixImgFromCamera( const std::vector<uint16_t> & data,
     {
         case 1:
             offset = m_CcdAcqSettings->GetPixelShift();
-            ImgFix::SingleOuputCopy( data, out, rows, cols, offset );
+            ImgFix::SingleOuputCopy( &data[0], out, rows, cols, offset );
         break;
 
         case 4:
@@ -219,11 +219,11 @@ void Quad::FixImgFromCamera( const std::vector<uint16_t> & data,
             offset = c - cols;
             if( m_DoPixelReorder )
             {
-                ImgFix::QuadOuputFix( data, out, rows, cols, offset );
+                ImgFix::QuadOuputFix( &data[0], out, rows, cols, offset );
             }
             else
             {
-                ImgFix::QuadOuputCopy( data, out, rows, cols, offset );
+                ImgFix::QuadOuputCopy( &data[0], out, rows, cols, offset );
             }
         }
         break;
@@ -0,0 +1,275 @@
+/*!
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this file,
+* You can obtain one at http://mozilla.org/MPL/2.0/.
+*
+* Image download benchmark for the ethernet cameras. A local HTTP server
+* serves synthetic image.bin frames, read the way AltaEthernetIo used to
+* (a new curl handle per frame, the whole frame in a string, then swapped
+* pixel by pixel) or streamed into the image on one keep-alive handle:
+*
+*     apogee_ethernet_bench [legacy|stream] [width] [height] [frames]
+*
+* Peak RSS covers the whole process, so run one mode at a time.
+*/
+
+#include "libCurlWrap.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // odd sized writes, so pixels get split between the chunks curl sees
+    const size_t SERVER_WRITE = 4093;
+
+    uint16_t PixelValue( size_t i )
+    {
+        return static_cast<uint16_t>( i * 2654435761u >> 7 );
+    }
+
+    ////////////////////////////
+    // Serves /UE/image.bin (big endian) and /aspen.bin (little endian)
+    // with keep-alive, until the listening socket is closed.
+    class ImageServer
+    {
+        public:
+            ImageServer( size_t numPixels ) : m_connections( 0 )
+            {
+                for( size_t i = 0; i < numPixels; ++i )
+                {
+                    const uint16_t v = PixelValue( i );
+                    m_bigEndian.push_back( static_cast<char>(v >> 8) );
+                    m_bigEndian.push_back( static_cast<char>(v & 0xFF) );
+                    m_littleEndian.push_back( static_cast<char>(v & 0xFF) );
+                    m_littleEndian.push_back( static_cast<char>(v >> 8) );
+                }
+
+                m_listen = socket( AF_INET, SOCK_STREAM, 0 );
+                sockaddr_in addr;
+                memset( &addr, 0, sizeof(addr) );
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+                addr.sin_port = 0;
+                socklen_t len = sizeof(addr);
+                if( bind( m_listen, reinterpret_cast<sockaddr *>(&addr), sizeof(addr) ) < 0 ||
+                    listen( m_listen, 8 ) < 0 ||
+                    getsockname( m_listen, reinterpret_cast<sockaddr *>(&addr), &len ) < 0 )
+                {
+                    perror( "image server" );
+                    exit( 1 );
+                }
+                m_port = ntohs( addr.sin_port );
+                m_thread = std::thread( &ImageServer::Run, this );
+            }
+
+            ~ImageServer()
+            {
+                shutdown( m_listen, SHUT_RDWR );
+                close( m_listen );
+                m_thread.join();
+            }
+
+            std::string Url() const
+            {
+                std::stringstream ss;
+                ss << "http://127.0.0.1:" << m_port;
+                return ss.str();
+            }
+
+            int Connections() const { return m_connections; }
+
+        private:
+            void Run()
+            {
+                int fd;
+                while( (fd = accept( m_listen, 0, 0 )) >= 0 )
+                {
+                    ++m_connections;
+                    std::thread( &ImageServer::Serve, this, fd ).detach();
+                }
+            }
+
+            void Serve( int fd )
+            {
+                const int one = 1;
+                setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+
+                std::string request;
+                char buf[1024];
+                ssize_t n;
+                while( (n = recv( fd, buf, sizeof(buf), 0 )) > 0 )
+                {
+                    request.append( buf, n );
+                    size_t end;
+                    while( (end = request.find("\r\n\r\n")) != std::string::npos )
+                    {
+                        const std::string & body =
+                            request.find("GET /aspen.bin") == 0 ? m_littleEndian : m_bigEndian;
+                        request.erase( 0, end + 4 );
+
+                        std::stringstream header;
+                        header << "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+                               << "Content-Length: " << body.size() << "\r\n\r\n";
+                        if( !SendAll( fd, header.str().data(), header.str().size() ) )
+                            break;
+                        for( size_t off = 0; off < body.size(); off += SERVER_WRITE )
+                        {
+                            if( !SendAll( fd, body.data() + off, std::min( SERVER_WRITE, body.size() - off ) ) )
+                                break;
+                        }
+                    }
+                }
+                close( fd );
+            }
+
+            static bool SendAll( int fd, const char * data, size_t size )
+            {
+                while( size )
+                {
+                    const ssize_t n = send( fd, data, size, MSG_NOSIGNAL );
+                    if( n <= 0 )
+                        return false;
+                    data += n;
+                    size -= n;
+                }
+                return true;
+            }
+
+            std::string m_bigEndian;
+            std::string m_littleEndian;
+            int m_listen;
+            int m_port;
+            std::atomic<int> m_connections;
+            std::thread m_thread;
+    };
+
+    ////////////////////////////
+    // The download AltaEthernetIo::GetImageData did before streaming
+    void LegacyDownload( const std::string & url, std::vector<uint16_t> & ImageData )
+    {
+        CLibCurlWrap theCurl;
+        std::string result;
+        theCurl.HttpGet( url, result );
+
+        if( result.size() != ImageData.size() * sizeof(uint16_t) )
+        {
+            fprintf( stderr, "%s: %zu bytes received\n", url.c_str(), result.size() );
+            exit( 1 );
+        }
+
+        std::string::iterator strIter;
+        std::string::iterator strIterNext;
+        int32_t i=0;
+
+        for(strIter = result.begin(); strIter != result.end(); strIter+=2, ++i)
+        {
+            strIterNext = strIter+1;
+            uint8_t a = (*strIter);
+            uint8_t b = (*strIterNext);
+
+            uint16_t v = ((a << 8) | b);
+            ImageData.at(i) = v;
+        }
+    }
+
+    void StreamDownload( CLibCurlWrap & curl, const std::string & url,
+        std::vector<uint16_t> & ImageData, bool bigEndian )
+    {
+        const size_t received = curl.HttpGetImage( url, &(*ImageData.begin()), ImageData.size(), bigEndian );
+
+        if( received != ImageData.size() * sizeof(uint16_t) )
+        {
+            fprintf( stderr, "%s: %zu bytes received\n", url.c_str(), received );
+            exit( 1 );
+        }
+    }
+
+    bool Check( const char * name, const std::vector<uint16_t> & ImageData )
+    {
+        for( size_t i = 0; i < ImageData.size(); ++i )
+        {
+            if( ImageData[i] != PixelValue( i ) )
+            {
+                fprintf( stderr, "%s: pixel %zu is 0x%04x instead of 0x%04x\n", name, i,
+                    ImageData[i], PixelValue( i ) );
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main( int argc, char * argv[] )
+{
+    const std::string mode = argc > 1 ? argv[1] : "stream";
+    const size_t width = argc > 2 ? atoi( argv[2] ) : 4096;
+    const size_t height = argc > 3 ? atoi( argv[3] ) : 4096;
+    const int frames = argc > 4 ? atoi( argv[4] ) : 10;
+    const bool legacy = ( mode == "legacy" );
+
+    if( !legacy && mode != "stream" )
+    {
+        fprintf( stderr, "usage: %s [legacy|stream] [width] [height] [frames]\n", argv[0] );
+        return 1;
+    }
+
+    curl_global_init( CURL_GLOBAL_ALL );
+
+    std::vector<uint16_t> ImageData( width * height );
+    ImageServer server( ImageData.size() );
+    const std::string altaUrl = server.Url() + "/UE/image.bin";
+    const std::string aspenUrl = server.Url() + "/aspen.bin";
+
+    bool ok = true;
+    double seconds = 0;
+    {
+        CLibCurlWrap curl;
+
+        for( int f = 0; f < frames; ++f )
+        {
+            std::fill( ImageData.begin(), ImageData.end(), 0 );
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if( legacy )
+                LegacyDownload( altaUrl, ImageData );
+            else
+                StreamDownload( curl, altaUrl, ImageData, true );
+            seconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+            if( f == 0 )
+                ok = Check( "image.bin", ImageData ) && ok;
+        }
+
+        if( !legacy )
+        {
+            StreamDownload( curl, aspenUrl, ImageData, false );
+            ok = Check( "aspen.bin", ImageData ) && ok;
+        }
+    }
+
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+
+    const double megabytes = frames * ImageData.size() * sizeof(uint16_t) / 1e6;
+    printf( "%s: %d frames of %zux%zu, %.1f MB/s, %.1f ms per frame, %d connections, peak RSS %.1f MB\n",
+        mode.c_str(), frames, width, height, megabytes / seconds, 1000 * seconds / frames,
+        server.Connections(), usage.ru_maxrss / 1024.0 );
+
+    curl_global_cleanup();
+    return ok ? 0 : 1;
+}
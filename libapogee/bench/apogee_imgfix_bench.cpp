@@ -0,0 +1,125 @@
+/*!
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this file,
+* You can obtain one at http://mozilla.org/MPL/2.0/.
+*
+* Checks the ImgFix modes against the implementation they replaced, on
+* odd and even geometries with and without latency pixels, then times
+* each mode on a full frame:
+*
+*     apogee_imgfix_bench [rows] [cols] [rounds]
+*/
+
+#include "ImgFix.h"
+#include "test/ImgFixReference.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace ImgFixReference;
+
+    void RunDirect( const Mode mode, const uint16_t * data, uint16_t * out,
+        const int32_t rows, const int32_t cols, const int32_t latency )
+    {
+        switch( mode )
+        {
+            case SINGLE_COPY: ImgFix::SingleOuputCopy( data, out, rows, cols, latency ); break;
+            case DUAL_FIX: ImgFix::DualOuputFix( data, out, rows, cols, latency ); break;
+            case QUAD_COPY: ImgFix::QuadOuputCopy( data, out, rows, cols, latency ); break;
+            default: ImgFix::QuadOuputFix( data, out, rows, cols, latency ); break;
+        }
+    }
+
+    void RunVector( const Mode mode, const std::vector<uint16_t> & data, std::vector<uint16_t> & out,
+        const int32_t rows, const int32_t cols, const int32_t latency )
+    {
+        switch( mode )
+        {
+            case SINGLE_COPY: ImgFix::SingleOuputCopy( data, out, rows, cols, latency ); break;
+            case DUAL_FIX: ImgFix::DualOuputFix( data, out, rows, cols, latency ); break;
+            case QUAD_COPY: ImgFix::QuadOuputCopy( data, out, rows, cols, latency ); break;
+            default: ImgFix::QuadOuputFix( data, out, rows, cols, latency ); break;
+        }
+    }
+
+    bool Check( const Mode mode, const int32_t rows, const int32_t cols, const int32_t latency )
+    {
+        const std::vector<uint16_t> data = CameraData( CameraPixels( mode, rows, cols, latency ) );
+
+        // pixels a mode leaves alone must stay as they were
+        std::vector<uint16_t> expected( rows * cols, 0xDEAD );
+        std::vector<uint16_t> direct( expected ), vect( expected );
+
+        RunReference( mode, data, expected, rows, cols, latency );
+        RunDirect( mode, &data[0], &direct[0], rows, cols, latency );
+        RunVector( mode, data, vect, rows, cols, latency );
+
+        if( direct != expected || vect != expected )
+        {
+            fprintf( stderr, "%s %dx%d latency %d: output differs\n", MODE_NAMES[mode],
+                rows, cols, latency );
+            return false;
+        }
+        return true;
+    }
+
+    double Time( const Mode mode, const bool reference, const std::vector<uint16_t> & data,
+        std::vector<uint16_t> & out, const int32_t rows, const int32_t cols,
+        const int32_t latency, const int rounds )
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for( int i = 0; i < rounds; ++i )
+        {
+            if( reference )
+                RunReference( mode, data, out, rows, cols, latency );
+            else
+                RunDirect( mode, &data[0], &out[0], rows, cols, latency );
+        }
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    }
+}
+
+int main( int argc, char * argv[] )
+{
+    const int32_t rows = argc > 1 ? atoi( argv[1] ) : 4096;
+    const int32_t cols = argc > 2 ? atoi( argv[2] ) : 4096;
+    const int rounds = argc > 3 ? atoi( argv[3] ) : 20;
+
+    bool ok = true;
+    int checks = 0;
+    for( int m = 0; m < NUM_MODES; ++m )
+    {
+        for( const auto & g : GEOMETRIES )
+        {
+            for( const int32_t latency : LATENCIES )
+            {
+                ok = Check( static_cast<Mode>(m), g[0], g[1], latency ) && ok;
+                ++checks;
+            }
+        }
+    }
+    printf( "%d geometries checked: %s\n", checks, ok ? "all match" : "FAILED" );
+    if( !ok )
+        return 1;
+
+    const int32_t latency = 8;
+    const double mpix = rounds * static_cast<double>(rows) * cols / 1e6;
+    for( int m = 0; m < NUM_MODES; ++m )
+    {
+        const Mode mode = static_cast<Mode>(m);
+        const std::vector<uint16_t> data = CameraData( CameraPixels( mode, rows, cols, latency ) );
+        std::vector<uint16_t> out( rows * cols );
+
+        const double before = Time( mode, true, data, out, rows, cols, latency, rounds );
+        const double after = Time( mode, false, data, out, rows, cols, latency, rounds );
+        printf( "%-16s %dx%d: before %7.1f Mpix/s, now %7.1f Mpix/s\n", MODE_NAMES[m], rows, cols,
+            mpix / before, mpix / after );
+    }
+
+    return 0;
+}
@@ -11,6 +11,16 @@
 
 #include "libCurlWrap.h" 
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#define APG_SWAP_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define APG_SWAP_NEON
+#include <arm_neon.h>
+#endif
 
 #include "apgHelper.h" 
 
@@ -44,6 +54,86 @@ static int32_t strWriter(char *data, size_t size, size_t nmemb,
     return apgHelper::SizeT2Int32( numBytes );
 }
 
+//////////////////////////// 
+// IMAGE WRITER
+// Each chunk goes straight to its place in the image, a pixel split
+// between two chunks waits in partial.
+namespace
+{
+    struct ImageSink
+    {
+        uint8_t * dest;
+        size_t capacity;    // bytes
+        size_t received;    // bytes
+        bool swap;
+        uint8_t partial;
+    };
+
+    void copySwap16( uint8_t * dest, const uint8_t * src, size_t numPixels )
+    {
+        size_t i = 0;
+#if defined(APG_SWAP_SSE2)
+        for( ; i + 8 <= numPixels; i += 8 )
+        {
+            const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i *>(src + 2*i) );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>(dest + 2*i),
+                _mm_or_si128( _mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8) ) );
+        }
+#elif defined(APG_SWAP_NEON)
+        for( ; i + 8 <= numPixels; i += 8 )
+        {
+            vst1q_u8( dest + 2*i, vrev16q_u8( vld1q_u8(src + 2*i) ) );
+        }
+#endif
+        for( ; i < numPixels; ++i )
+        {
+            dest[2*i] = src[2*i+1];
+            dest[2*i+1] = src[2*i];
+        }
+    }
+}
+
+static size_t imageWriter(uint8_t *data, size_t size, size_t nmemb,
+                  ImageSink * sink)
+{
+    const size_t numBytes = size * nmemb;
+    size_t offset = sink->received;
+    sink->received += numBytes;
+
+    if( offset >= sink->capacity )
+    {
+        //too much data, the caller reports the size mismatch
+        return numBytes;
+    }
+
+    size_t count = std::min( numBytes, sink->capacity - offset );
+
+    if( !sink->swap )
+    {
+        memcpy( sink->dest + offset, data, count );
+        return numBytes;
+    }
+
+    //finish the pixel split by the previous chunk
+    if( offset % 2 )
+    {
+        sink->dest[offset-1] = data[0];
+        sink->dest[offset] = sink->partial;
+        ++data;
+        ++offset;
+        --count;
+    }
+
+    copySwap16( sink->dest + offset, data, count / 2 );
+
+    if( count % 2 )
+    {
+        sink->partial = data[count-1];
+    }
+
+    return numBytes;
+}
+
 //////////////////////////// 
 // LOCAL     NAMESPACE
 namespace
@@ -64,6 +154,10 @@ CLibCurlWrap::CLibCurlWrap() : m_curlHandle( 0 ),
          apgHelper::throwRuntimeException( m_fileName, 
              errStr, __LINE__, Apg::ErrorType_Connection );
     }
+
+    //the handle keeps its connection open between requests,
+    //keep it from going stale while the camera exposes
+    curl_easy_setopt(m_curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
 } 
 
 //////////////////////////// 
@@ -93,6 +187,40 @@ void CLibCurlWrap::HttpGet(const std::string & url,
     ExecuteVect( result );
 }
 
+//////////////////////////// 
+// HTTP GET IMAGE
+size_t CLibCurlWrap::HttpGetImage(const std::string & url,
+            uint16_t * image, const size_t numPixels, const bool bigEndian)
+{
+    ImageSink sink;
+    sink.dest = reinterpret_cast<uint8_t *>( image );
+    sink.capacity = numPixels * sizeof(uint16_t);
+    sink.received = 0;
+    const uint16_t one = 1;
+    const bool hostBigEndian = ( 0 == *reinterpret_cast<const uint8_t *>(&one) );
+    sink.swap = ( bigEndian != hostBigEndian );
+    sink.partial = 0;
+
+    curl_easy_setopt(m_curlHandle, CURLOPT_ERRORBUFFER, errorBuffer);  
+    curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());  
+    curl_easy_setopt(m_curlHandle, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(m_curlHandle, CURLOPT_WRITEFUNCTION, imageWriter);  
+    curl_easy_setopt(m_curlHandle, CURLOPT_WRITEDATA, &sink); 
+    curl_easy_setopt(m_curlHandle, CURLOPT_TIMEOUT, m_timeout);
+
+    const CURLcode returnCode = curl_easy_perform(m_curlHandle);
+
+    if( CURLE_OK != returnCode )
+    {
+        std::string curlError( errorBuffer );
+
+        apgHelper::throwRuntimeException( m_fileName, curlError, 
+            __LINE__, Apg::ErrorType_Critical );
+    }
+
+    return sink.received;
+}
+
 //////////////////////////// 
 // HTTP POST 
 void CLibCurlWrap::HttpPost(const std::string & url,
@@ -125,6 +253,7 @@ void CLibCurlWrap::CurlSetupStrWrite(const std::string & url)
      // Now set up all of the curl options  
     curl_easy_setopt(m_curlHandle, CURLOPT_ERRORBUFFER, errorBuffer);  
     curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());  
+    curl_easy_setopt(m_curlHandle, CURLOPT_HTTPGET, 1L);
     curl_easy_setopt(m_curlHandle, CURLOPT_WRITEFUNCTION, strWriter);  
     curl_easy_setopt(m_curlHandle, CURLOPT_WRITEDATA, &bufferStr); 
     curl_easy_setopt(m_curlHandle, CURLOPT_TIMEOUT, m_timeout);
@@ -138,6 +267,7 @@ void CLibCurlWrap::CurlSetupVectWrite(const std::string & url, const std::vector
      // Now set up all of the curl options  
     curl_easy_setopt(m_curlHandle, CURLOPT_ERRORBUFFER, errorBuffer);  
     curl_easy_setopt(m_curlHandle, CURLOPT_URL, url.c_str());  
+    curl_easy_setopt(m_curlHandle, CURLOPT_HTTPGET, 1L);
     curl_easy_setopt(m_curlHandle, CURLOPT_WRITEFUNCTION, vectWriter);  
     curl_easy_setopt(m_curlHandle, CURLOPT_WRITEDATA, &result); 
     curl_easy_setopt(m_curlHandle, CURLOPT_TIMEOUT, m_timeout);
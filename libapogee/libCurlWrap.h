@@ -30,6 +30,13 @@ class CLibCurlWrap
         void HttpGet(const std::string & url,
             std::vector<uint8_t> & result);
 
+        // Downloads 16 bit pixels straight into image as the data comes in,
+        // swapping the bytes of each pixel when bigEndian does not match
+        // the host. At most numPixels pixels are written, the return value
+        // is the number of bytes the server sent.
+        size_t HttpGetImage(const std::string & url,
+            uint16_t * image, size_t numPixels, bool bigEndian);
+
         void HttpPost(const std::string & url,
             const std::string & postFields, 
             std::string & result);
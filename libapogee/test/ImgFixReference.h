@@ -0,0 +1,197 @@
+/*!
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this file,
+* You can obtain one at http://mozilla.org/MPL/2.0/.
+*
+* The ImgFix implementation the direct output kernels replaced, and the
+* camera data they are checked on, shared by the ImgFix test and bench
+*/
+
+#ifndef IMGFIX_REFERENCE_INCLUDE_H__
+#define IMGFIX_REFERENCE_INCLUDE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "stdint.h"
+
+namespace ImgFixReference
+{
+    // The ImgFix functions before the direct output kernels
+    namespace Reference
+    {
+        inline void SingleOuputCopy( const std::vector<uint16_t> & data,
+              std::vector<uint16_t> & out, const int32_t rows,  const int32_t numImgCols,
+              const int32_t numLatencyPixels )
+        {
+            const int32_t actNumCols = numImgCols + numLatencyPixels;
+
+            for(int32_t r = 0, actColsOffset=numLatencyPixels, outColsOffset=0; r < rows;
+                    actColsOffset += actNumCols, outColsOffset += numImgCols, ++r)
+            {
+                std::vector<uint16_t>::const_iterator start = data.begin()+actColsOffset;
+                std::vector<uint16_t>::const_iterator end = start + numImgCols;
+                std::vector<uint16_t>::iterator outStart = out.begin() + outColsOffset;
+                std::copy( start, end, outStart );
+            }
+        }
+
+        inline void QuadOuputCopy( const std::vector<uint16_t> & data,
+              std::vector<uint16_t> & out, const int32_t rows,  const int32_t cols,
+              const int32_t numLatencyPixels, const int32_t outputBuffOffset )
+        {
+            int32_t numGood =  ( cols / 2 ) * 4;
+            int32_t numBad = numLatencyPixels*2;
+
+            int32_t down = rows*cols;
+
+            int32_t goodStart = 0;
+            int32_t badStart = numLatencyPixels*2;
+
+            while( down > 0 )
+            {
+                 int32_t len = std::min<int32_t>( down, numGood );
+
+                std::vector<uint16_t>::const_iterator start = data.begin()+badStart;
+                std::vector<uint16_t>::const_iterator end = start + len;
+                std::vector<uint16_t>::iterator outStart = out.begin() + outputBuffOffset + goodStart;
+                std::copy( start, end, outStart );
+
+                 goodStart += len;
+                 badStart += (len + numBad);
+                 down -= len;
+            }
+        }
+
+        inline void QuadOuputFix( const std::vector<uint16_t> & data,
+                std::vector<uint16_t> & out, const int32_t rows,  const int32_t cols,
+                const int32_t numLatencyPixels)
+        {
+            const int32_t HALF_COLS = cols / 2;
+            const int32_t HALF_ROWS = rows / 2;
+
+            int32_t index = numLatencyPixels*2;
+
+            for( int32_t r=0; r < HALF_ROWS; ++r )
+            {
+                int32_t topOffset = cols*r;
+                int32_t bottomOffset = (cols*(rows-(r+1)));
+
+                for( int32_t c=0; c < HALF_COLS; ++c)
+                {
+                    int32_t ul = topOffset + c;
+                    out[ul] = data[index];
+
+                    int32_t ur =  topOffset + (cols-(c+1) );
+                    ++index;
+                    out[ur] = data[index];
+
+                    int32_t lr = bottomOffset + (cols-(c+1) );
+                    ++index;
+                    out[lr] = data[index];
+
+                    int32_t ll = bottomOffset+c;
+                    ++index;
+                    out[ll] = data[index];
+
+                    ++index;
+                }
+
+                //skip the latency pixels
+                index += numLatencyPixels*2;
+            }
+        }
+
+        inline void DualOuputFix( const std::vector<uint16_t> & data,
+                std::vector<uint16_t> & out, const int32_t rows,  const int32_t cols,
+                const int32_t numLatencyPixels)
+        {
+            const int32_t HALF_COLS = cols / 2;
+
+             //account for the odd no op col
+            const int32_t oddAdjust = ( cols % 2 ) ? 1 : 0;
+            const int32_t START_UR_COL = cols;
+
+            int32_t index = numLatencyPixels;
+
+            for( int32_t r=0; r < rows; ++r )
+            {
+                int32_t topOffset = cols*r;
+
+                for( int32_t c=0; c < HALF_COLS; ++c)
+                {
+                    int32_t ur =  topOffset + (START_UR_COL-(c+1) ) - oddAdjust;
+                    out[ur] = data[index];
+
+                   int32_t ul = topOffset + c;
+                    ++index;
+                    out[ul] = data[index];
+
+                    ++index;
+                }
+
+                //skip the latency pixels
+                index += numLatencyPixels;
+            }
+        }
+    }
+
+    enum Mode
+    {
+        SINGLE_COPY,
+        DUAL_FIX,
+        QUAD_COPY,
+        QUAD_FIX,
+        NUM_MODES
+    };
+
+    static const char * const MODE_NAMES[NUM_MODES] = { "SingleOuputCopy", "DualOuputFix",
+        "QuadOuputCopy", "QuadOuputFix" };
+
+    // Odd and even geometries, with and without latency pixels
+    static const int32_t GEOMETRIES[][2] = { { 1, 2 }, { 2, 7 }, { 3, 16 }, { 8, 17 }, { 10, 33 },
+        { 16, 64 }, { 33, 130 }, { 64, 255 } };
+    static const int32_t LATENCIES[] = { 0, 1, 8, 13 };
+
+    // Pixels the camera sends for a rows x cols image
+    inline size_t CameraPixels( const Mode mode, const int32_t rows, const int32_t cols,
+        const int32_t latency )
+    {
+        switch( mode )
+        {
+            case SINGLE_COPY:
+                return static_cast<size_t>(rows) * (cols + latency);
+            case DUAL_FIX:
+                return latency + static_cast<size_t>(rows) * ((cols / 2) * 2 + latency);
+            default:
+                // one more latency run than needed, as the cameras send it
+                return static_cast<size_t>(rows / 2 + 1) * ((cols / 2) * 4 + latency * 2) + rows * cols;
+        }
+    }
+
+    inline void RunReference( const Mode mode, const std::vector<uint16_t> & data, std::vector<uint16_t> & out,
+        const int32_t rows, const int32_t cols, const int32_t latency )
+    {
+        switch( mode )
+        {
+            case SINGLE_COPY: Reference::SingleOuputCopy( data, out, rows, cols, latency ); break;
+            case DUAL_FIX: Reference::DualOuputFix( data, out, rows, cols, latency ); break;
+            case QUAD_COPY: Reference::QuadOuputCopy( data, out, rows, cols, latency, 0 ); break;
+            default: Reference::QuadOuputFix( data, out, rows, cols, latency ); break;
+        }
+    }
+
+    inline std::vector<uint16_t> CameraData( const size_t size )
+    {
+        std::vector<uint16_t> data( size );
+        uint32_t seed = 12345;
+        for( size_t i = 0; i < size; ++i )
+        {
+            seed = seed * 1103515245 + 12345;
+            data[i] = static_cast<uint16_t>( seed >> 16 );
+        }
+        return data;
+    }
+}
+
+#endif
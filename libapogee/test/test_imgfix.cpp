@@ -0,0 +1,104 @@
+/*!
+* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this file,
+* You can obtain one at http://mozilla.org/MPL/2.0/.
+*
+* Each ImgFix mode, vector and direct output, against the implementation
+* the direct output kernels replaced
+*/
+
+#include <gtest/gtest.h>
+
+#include "ImgFix.h"
+#include "ImgFixReference.h"
+
+using namespace ImgFixReference;
+
+namespace
+{
+    void RunDirect( const Mode mode, const uint16_t * data, uint16_t * out,
+        const int32_t rows, const int32_t cols, const int32_t latency )
+    {
+        switch( mode )
+        {
+            case SINGLE_COPY: ImgFix::SingleOuputCopy( data, out, rows, cols, latency ); break;
+            case DUAL_FIX: ImgFix::DualOuputFix( data, out, rows, cols, latency ); break;
+            case QUAD_COPY: ImgFix::QuadOuputCopy( data, out, rows, cols, latency ); break;
+            default: ImgFix::QuadOuputFix( data, out, rows, cols, latency ); break;
+        }
+    }
+
+    void RunVector( const Mode mode, const std::vector<uint16_t> & data, std::vector<uint16_t> & out,
+        const int32_t rows, const int32_t cols, const int32_t latency )
+    {
+        switch( mode )
+        {
+            case SINGLE_COPY: ImgFix::SingleOuputCopy( data, out, rows, cols, latency ); break;
+            case DUAL_FIX: ImgFix::DualOuputFix( data, out, rows, cols, latency ); break;
+            case QUAD_COPY: ImgFix::QuadOuputCopy( data, out, rows, cols, latency ); break;
+            default: ImgFix::QuadOuputFix( data, out, rows, cols, latency ); break;
+        }
+    }
+
+    void CheckMode( const Mode mode )
+    {
+        for( const auto & g : GEOMETRIES )
+        {
+            for( const int32_t latency : LATENCIES )
+            {
+                const int32_t rows = g[0], cols = g[1];
+                SCOPED_TRACE( testing::Message() << MODE_NAMES[mode] << " " << rows << "x" << cols
+                    << " latency " << latency );
+
+                const std::vector<uint16_t> data = CameraData( CameraPixels( mode, rows, cols, latency ) );
+
+                // pixels a mode leaves alone must stay as they were
+                std::vector<uint16_t> expected( rows * cols, 0xDEAD );
+                std::vector<uint16_t> direct( expected ), vect( expected );
+
+                RunReference( mode, data, expected, rows, cols, latency );
+                RunDirect( mode, &data[0], &direct[0], rows, cols, latency );
+                RunVector( mode, data, vect, rows, cols, latency );
+
+                EXPECT_EQ( expected, direct );
+                EXPECT_EQ( expected, vect );
+            }
+        }
+    }
+}
+
+TEST( ImgFix, SingleOuputCopy )
+{
+    CheckMode( SINGLE_COPY );
+}
+
+TEST( ImgFix, DualOuputFix )
+{
+    CheckMode( DUAL_FIX );
+}
+
+TEST( ImgFix, QuadOuputCopy )
+{
+    CheckMode( QUAD_COPY );
+}
+
+TEST( ImgFix, QuadOuputCopyOffset )
+{
+    const int32_t rows = 10, cols = 33, latency = 8, offset = 5;
+    const std::vector<uint16_t> data = CameraData( CameraPixels( QUAD_COPY, rows, cols, latency ) );
+
+    std::vector<uint16_t> expected( offset + rows * cols, 0xDEAD );
+    std::vector<uint16_t> direct( expected ), vect( expected );
+
+    Reference::QuadOuputCopy( data, expected, rows, cols, latency, offset );
+    ImgFix::QuadOuputCopy( &data[0], &direct[0], rows, cols, latency, offset );
+    ImgFix::QuadOuputCopy( data, vect, rows, cols, latency, offset );
+
+    EXPECT_EQ( expected, direct );
+    EXPECT_EQ( expected, vect );
+}
+
+TEST( ImgFix, QuadOuputFix )
+{
+    CheckMode( QUAD_FIX );
+}
@@ -0,0 +1,223 @@
+/*
+
+  Copyright (c) 2002 Finger Lakes Instrumentation (FLI), L.L.C.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+        Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above
+        copyright notice, this list of conditions and the following
+        disclaimer in the documentation and/or other materials
+        provided with the distribution.
+
+        Neither the name of Finger Lakes Instrumentation (FLI), LLC
+        nor the names of its contributors may be used to endorse or
+        promote products derived from this software without specific
+        prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+  ======================================================================
+
+  Finger Lakes Instrumentation, L.L.C. (FLI)
+  web: http://www.fli-cam.com
+  email: support@fli-cam.com
+
+*/
+
+/*
+  Checks FLIGrabFrame() against FLIGrabRow() on the fake USB camera, then
+  times a whole frame download both ways:
+
+    fli_grab_bench [width] [height] [MB/s] [frames]
+
+  At 0 MB/s the fake camera sends rows as fast as they can be copied, so
+  only the host side of the download is timed.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libfli-libfli.h"
+#include "libfli-fake-usb.h"
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long open_fake(flidev_t *dev, long width, long height, double rate,
+		      long hwrev)
+{
+  char name[64];
+  long r;
+
+  snprintf(name, sizeof(name), FAKE_USB_PREFIX "%ldx%ld:%g:%ld",
+	   width, height, rate, hwrev);
+
+  if ((r = FLIOpen(dev, name, FLIDOMAIN_USB | FLIDEVICE_CAMERA)))
+    fprintf(stderr, "%s: open failed, %ld\n", name, r);
+
+  return r;
+}
+
+/* Downloads a frame with FLIGrabRow() for the first rowfirst rows and
+   FLIGrabFrame() for the rest */
+static long grab(flidev_t dev, unsigned short *img, long width, long height,
+		 long rowfirst)
+{
+  size_t grabbed = 0;
+  long r, row;
+
+  if (rowfirst > height)
+    rowfirst = height;
+
+  if ((r = FLIExposeFrame(dev)))
+    return r;
+
+  for (row = 0; row < rowfirst; row++)
+    if ((r = FLIGrabRow(dev, img + row * width, width)))
+      return r;
+
+  if (rowfirst >= height)
+    return 0;
+
+  if ((r = FLIGrabFrame(dev, img + rowfirst * width,
+			(height - rowfirst) * width * sizeof(unsigned short), &grabbed)))
+    return r;
+
+  if (grabbed != (height - rowfirst) * width * sizeof(unsigned short))
+  {
+    fprintf(stderr, "FLIGrabFrame() grabbed %zu bytes\n", grabbed);
+    return -EIO;
+  }
+
+  return 0;
+}
+
+static int check(long width, long height, long hwrev, long rowfirst)
+{
+  unsigned short offset = ((hwrev & 0xff00) == 0x0100) ? 32768 : 0;
+  unsigned short *img;
+  flidev_t dev;
+  long r, c, err;
+  int ok = 1;
+
+  if (open_fake(&dev, width, height, 0, hwrev))
+    return 0;
+
+  img = calloc(width * height, sizeof(unsigned short));
+
+  if ((err = grab(dev, img, width, height, rowfirst)))
+  {
+    fprintf(stderr, "%ldx%ld: download failed, %ld\n", width, height, err);
+    ok = 0;
+  }
+
+  for (r = 0; ok && (r < height); r++)
+  {
+    for (c = 0; c < width; c++)
+    {
+      unsigned short want = unix_fake_usb_pixel(r, c) + offset;
+
+      if (img[r * width + c] != want)
+      {
+	fprintf(stderr, "%ldx%ld hwrev 0x%04lx, %ld rows first: pixel %ld,%ld is 0x%04x instead of 0x%04x\n",
+		width, height, hwrev, rowfirst, c, r, img[r * width + c], want);
+	ok = 0;
+	break;
+      }
+    }
+  }
+
+  free(img);
+  FLIClose(dev);
+
+  return ok;
+}
+
+static double time_frames(long width, long height, double rate, int frames,
+			  int rows)
+{
+  unsigned short *img;
+  flidev_t dev;
+  double start, t;
+  int f;
+
+  if (open_fake(&dev, width, height, rate, 0x0200))
+    exit(1);
+
+  img = malloc(width * height * sizeof(unsigned short));
+
+  start = now();
+  for (f = 0; f < frames; f++)
+  {
+    if (grab(dev, img, width, height, rows ? height : 0))
+    {
+      fprintf(stderr, "download failed\n");
+      exit(1);
+    }
+  }
+  t = now() - start;
+
+  free(img);
+  FLIClose(dev);
+
+  return t / frames;
+}
+
+int main(int argc, char *argv[])
+{
+  long width = (argc > 1) ? atol(argv[1]) : 4096;
+  long height = (argc > 2) ? atol(argv[2]) : 4096;
+  double rate = (argc > 3) ? atof(argv[3]) : 0;
+  int frames = (argc > 4) ? atoi(argv[4]) : 5;
+
+  const long geometries[][2] = { {1, 1}, {3, 5}, {7, 130}, {100, 100},
+				 {513, 67}, {1024, 300}, {16385, 4}, {32768, 3} };
+  const long rowsfirst[] = { 0, 1, 5 };
+  const long hwrevs[] = { 0x0200, 0x0100 };
+  double rows, frame, mb;
+  int ok = 1, checks = 0;
+  size_t g, h, f;
+
+  for (g = 0; g < sizeof(geometries) / sizeof(geometries[0]); g++)
+    for (h = 0; h < sizeof(hwrevs) / sizeof(hwrevs[0]); h++)
+      for (f = 0; f < sizeof(rowsfirst) / sizeof(rowsfirst[0]); f++, checks++)
+	ok = check(geometries[g][0], geometries[g][1], hwrevs[h],
+		   rowsfirst[f]) && ok;
+
+  printf("%d downloads checked: %s\n", checks, ok ? "all match" : "FAILED");
+  if (!ok)
+    return 1;
+
+  rows = time_frames(width, height, rate, frames, 1);
+  frame = time_frames(width, height, rate, frames, 0);
+  mb = width * height * 2 / 1e6;
+
+  printf("%ldx%ld at %g MB/s: FLIGrabRow %.1f ms (%.1f MB/s), FLIGrabFrame %.1f ms (%.1f MB/s)\n",
+	 width, height, rate, 1000 * rows, mb / rows, 1000 * frame, mb / frame);
+
+  return 0;
+}
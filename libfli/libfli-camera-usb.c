@@ -48,6 +48,15 @@
 #include <sys/param.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <pthread.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+	defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define FLI_USB_NEON
 #endif
 
 #include <stdio.h>
@@ -1027,6 +1036,45 @@ long fli_camera_usb_get_temperature(flidev_t dev, double *temperature)
 	return fli_camera_usb_read_temperature(dev, 0, temperature);
 }
 
+/* Old MaxCam hardware sends signed pixels */
+static unsigned short fli_camera_usb_pixel_offset(flidev_t dev)
+{
+	return ((DEVICE->devinfo.hwrev & 0xff00) == 0x0100) ? 32768 : 0;
+}
+
+/* Converts n big endian pixels from the camera to host order, adding
+ * offset to each. src and dst may be the same buffer.
+ */
+static void fli_camera_usb_swab_pixels(unsigned short *dst,
+	const unsigned short *src, long n, unsigned short offset)
+{
+	long x = 0;
+
+#if defined(__SSE2__)
+	__m128i add = _mm_set1_epi16((short) offset);
+
+	for (; x + 8 <= n; x += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + x));
+
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i *) (dst + x), _mm_add_epi16(v, add));
+	}
+#elif defined(FLI_USB_NEON)
+	uint16x8_t add = vdupq_n_u16(offset);
+
+	for (; x + 8 <= n; x += 8)
+	{
+		uint16x8_t v = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8((const uint8_t *) (src + x))));
+
+		vst1q_u16(dst + x, vaddq_u16(v, add));
+	}
+#endif
+
+	for (; x < n; x++)
+		dst[x] = (unsigned short) (ntohs(src[x]) + offset);
+}
+
 long fli_camera_usb_grab_row(flidev_t dev, void *buff, size_t width)
 {
   flicamdata_t *cam = DEVICE->device_data;
@@ -1084,17 +1132,9 @@ long fli_camera_usb_grab_row(flidev_t dev, void *buff, size_t width)
 				cam->gbuf[2] = htons((unsigned short) cam->grabrowbatchsize);
 				IO(dev, cam->gbuf, &wlen, &rlen);
 
-				for (x = 0; x < (cam->grabrowwidth * cam->grabrowbatchsize); x++)
-				{
-					if ((DEVICE->devinfo.hwrev & 0xff00) == 0x0100)
-					{
-						cam->gbuf[x] = ntohs(cam->gbuf[x]) + 32768;
-					}
-					else
-					{
-						cam->gbuf[x] = ntohs(cam->gbuf[x]);
-					}
-				}
+				fli_camera_usb_swab_pixels(cam->gbuf, cam->gbuf,
+					cam->grabrowwidth * cam->grabrowbatchsize,
+					fli_camera_usb_pixel_offset(dev));
 				cam->grabrowbufferindex = 0;
 			}
 
@@ -1729,6 +1769,249 @@ long fli_camera_usb_grab_row(flidev_t dev, void *buff, size_t width)
 	return 0;
 }
 
+/* Whole frame download for MaxCam and IMG cameras. One thread requests
+ * batches of rows into the two halves of gbuf while the other converts
+ * the previous batch straight into the frame, so the next USB transfer
+ * is in flight while the pixels are swapped.
+ */
+typedef struct {
+	flidev_t dev;
+	unsigned short *half[2];
+	unsigned short offset;
+	long width;
+	long rows;      /* Rows to download */
+	long batch;     /* Rows per FLI_USBCAM_SENDROW request */
+	long batches;
+	long fetched;   /* Batches downloaded */
+	long converted; /* Batches converted, their halves can be reused */
+	long err;
+#ifndef _WIN32
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+} fli_usb_prefetch_t;
+
+static long fli_camera_usb_batch_rows(fli_usb_prefetch_t *p, long k)
+{
+	return MIN(p->batch, p->rows - k * p->batch);
+}
+
+static long fli_camera_usb_fetch_batch(fli_usb_prefetch_t *p, long k)
+{
+	flidev_t dev = p->dev;
+	unsigned short *buf = p->half[k & 1];
+	long rows = fli_camera_usb_batch_rows(p, k);
+	long rlen, wlen, want;
+
+	debug(FLIDEBUG_INFO, "Grabbing %d rows of width %d.", rows, p->width);
+	want = rlen = p->width * 2 * rows;
+	wlen = 6;
+	buf[0] = htons(FLI_USBCAM_SENDROW);
+	buf[1] = htons((unsigned short) p->width);
+	buf[2] = htons((unsigned short) rows);
+	IO(dev, buf, &wlen, &rlen);
+
+	if ((rlen >= 0) && (rlen < want))
+	{
+		debug(FLIDEBUG_WARN, "Transfer did not complete (%d of %d bytes), padding...", rlen, want);
+		memset((char *) buf + rlen, 0x00, want - rlen);
+	}
+
+	return 0;
+}
+
+static void fli_camera_usb_convert_batch(fli_usb_prefetch_t *p, long k,
+	unsigned short *out)
+{
+	fli_camera_usb_swab_pixels(out + k * p->batch * p->width, p->half[k & 1],
+		fli_camera_usb_batch_rows(p, k) * p->width, p->offset);
+}
+
+#ifndef _WIN32
+static void *fli_camera_usb_prefetch_thread(void *arg)
+{
+	fli_usb_prefetch_t *p = arg;
+	long k, r;
+
+	for (k = 0; k < p->batches; k++)
+	{
+		/* Wait until the converter is done with this half */
+		pthread_mutex_lock(&p->lock);
+		while (k - p->converted >= 2)
+			pthread_cond_wait(&p->cond, &p->lock);
+		pthread_mutex_unlock(&p->lock);
+
+		r = fli_camera_usb_fetch_batch(p, k);
+
+		pthread_mutex_lock(&p->lock);
+		if (r == 0)
+			p->fetched = k + 1;
+		else
+			p->err = r;
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->lock);
+
+		if (r != 0)
+			break;
+	}
+
+	return NULL;
+}
+#endif
+
+static long fli_camera_usb_prefetch_rows(fli_usb_prefetch_t *p,
+	unsigned short *out)
+{
+	long k, r = 0;
+
+#ifndef _WIN32
+	if (p->batches > 1)
+	{
+		pthread_t thread;
+
+		pthread_mutex_init(&p->lock, NULL);
+		pthread_cond_init(&p->cond, NULL);
+
+		if (pthread_create(&thread, NULL, fli_camera_usb_prefetch_thread, p) == 0)
+		{
+			for (k = 0; k < p->batches; k++)
+			{
+				pthread_mutex_lock(&p->lock);
+				while ((p->fetched <= k) && (p->err == 0))
+					pthread_cond_wait(&p->cond, &p->lock);
+				if (p->fetched <= k)
+					r = p->err;
+				pthread_mutex_unlock(&p->lock);
+
+				if (r != 0)
+					break;
+
+				fli_camera_usb_convert_batch(p, k, out);
+
+				pthread_mutex_lock(&p->lock);
+				p->converted = k + 1;
+				pthread_cond_broadcast(&p->cond);
+				pthread_mutex_unlock(&p->lock);
+			}
+
+			pthread_join(thread, NULL);
+			pthread_cond_destroy(&p->cond);
+			pthread_mutex_destroy(&p->lock);
+
+			return r;
+		}
+
+		debug(FLIDEBUG_WARN, "Could not start the download thread, grabbing rows in turn.");
+		pthread_cond_destroy(&p->cond);
+		pthread_mutex_destroy(&p->lock);
+	}
+#endif
+
+	for (k = 0; k < p->batches; k++)
+	{
+		if ((r = fli_camera_usb_fetch_batch(p, k)))
+			return r;
+
+		fli_camera_usb_convert_batch(p, k, out);
+		p->converted = k + 1;
+	}
+
+	return 0;
+}
+
+long fli_camera_usb_grab_frame(flidev_t dev, void *buff, size_t buffsize,
+	size_t *bytesgrabbed)
+{
+	flicamdata_t *cam = DEVICE->device_data;
+	fli_usb_prefetch_t p;
+	unsigned short *out = (unsigned short *) buff;
+	size_t rowsize;
+	long rows, grabbed = 0, r = 0;
+
+	/* Only the MaxCam and IMG cameras have a faster path than FLIGrabRow() */
+	if (DEVICE->devinfo.devid != FLIUSB_CAM_ID)
+		return fli_camera_grab_frame_rows(dev, fli_camera_usb_grab_row,
+			buff, buffsize, bytesgrabbed);
+
+	if (bytesgrabbed != NULL)
+		*bytesgrabbed = 0;
+
+	if (cam->gbuf == NULL)
+		return -ENOMEM;
+
+	rowsize = cam->grabrowwidth * 2;
+	if ((buff == NULL) || (rowsize == 0) || (buffsize < rowsize))
+		return -EINVAL;
+
+	rows = cam->grabrowcount;
+	if ((size_t) rows > buffsize / rowsize)
+		rows = (long) (buffsize / rowsize);
+
+	memset(&p, 0x00, sizeof(p));
+	p.batch = (long) (MIN(USB_READ_SIZ_MAX, cam->gbuf_siz / 2) / rowsize);
+	if (p.batch > 64)
+		p.batch = 64;
+
+	/* Rows FLIGrabRow() already has in memory go first, and cameras whose
+	 * rows are too wide to batch are read a row at a time */
+	while ((grabbed < rows) &&
+		((cam->grabrowbufferindex < cam->grabrowbatchsize) || (p.batch < 1)))
+	{
+		if ((r = fli_camera_usb_grab_row(dev, out + grabbed * cam->grabrowwidth,
+			cam->grabrowwidth)))
+			goto done;
+		grabbed++;
+	}
+
+	if (grabbed == rows)
+		goto done;
+
+	if (cam->flushcountbeforefirstrow > 0)
+	{
+		debug(FLIDEBUG_INFO, "Flushing %d rows before image download.", cam->flushcountbeforefirstrow);
+		if ((r = fli_camera_usb_flush_rows(dev, cam->flushcountbeforefirstrow, 1)))
+			goto done;
+
+		cam->flushcountbeforefirstrow = 0;
+	}
+
+	p.dev = dev;
+	p.half[0] = cam->gbuf;
+	p.half[1] = cam->gbuf + cam->gbuf_siz / 4;
+	p.offset = fli_camera_usb_pixel_offset(dev);
+	p.width = cam->grabrowwidth;
+	p.rows = rows - grabbed;
+	p.batches = (p.rows + p.batch - 1) / p.batch;
+
+	r = fli_camera_usb_prefetch_rows(&p, out + grabbed * cam->grabrowwidth);
+
+	/* Nothing is left in gbuf for FLIGrabRow() */
+	p.rows = MIN(p.rows, p.converted * p.batch);
+	grabbed += p.rows;
+	cam->grabrowindex += p.rows;
+	cam->grabrowcount -= p.rows;
+	cam->grabrowbufferindex = cam->grabrowbatchsize;
+
+	if ((r == 0) && (cam->grabrowcount == 0))
+	{
+		if (cam->flushcountafterlastrow > 0)
+		{
+			debug(FLIDEBUG_INFO, "Flushing %d rows after image download.", cam->flushcountafterlastrow);
+			r = fli_camera_usb_flush_rows(dev, cam->flushcountafterlastrow, 1);
+		}
+
+		cam->flushcountafterlastrow = 0;
+		cam->grabrowbatchsize = 1;
+		cam->grabrowbufferindex = cam->grabrowbatchsize;
+	}
+
+done:
+	if (bytesgrabbed != NULL)
+		*bytesgrabbed = grabbed * rowsize;
+
+	return r;
+}
+
 long fli_camera_usb_stop_video_mode(flidev_t dev)
 {
   flicamdata_t *cam = DEVICE->device_data;
@@ -668,6 +668,35 @@ long fli_camera_command(flidev_t dev, int cmd, int argc, ...)
 			}
 			break;
 
+		case FLI_GRAB_FRAME:
+			if (argc != 3)
+				r = -EINVAL;
+			else
+			{
+				void *buf;
+				size_t size, *grabbed;
+
+				buf = va_arg(ap, void *);
+				size = *va_arg(ap, size_t *);
+				grabbed = va_arg(ap, size_t *);
+
+				switch (DEVICE->domain)
+				{
+					case FLIDOMAIN_PARALLEL_PORT:
+						r = fli_camera_grab_frame_rows(dev, fli_camera_parport_grab_row,
+							buf, size, grabbed);
+						break;
+
+					case FLIDOMAIN_USB:
+						r = fli_camera_usb_grab_frame(dev, buf, size, grabbed);
+						break;
+
+					default:
+						r = -EINVAL;
+				}
+			}
+			break;
+
 		case FLI_EXPOSE_FRAME:
 			if (argc != 0)
 				r = -EINVAL;
@@ -1302,3 +1331,40 @@ static long fli_camera_set_flushes(flidev_t dev, long nflushes)
 
   return 0;
 }
+
+/* Whole frame download one FLIGrabRow() at a time, for cameras that have
+   nothing faster. Grabs as many rows of the image area as fit in buff. */
+long fli_camera_grab_frame_rows(flidev_t dev,
+				long (*grab_row)(flidev_t dev, void *buff, size_t width),
+				void *buff, size_t buffsize, size_t *bytesgrabbed)
+{
+  flicamdata_t *cam;
+  size_t width, rowsize;
+  long rows, row, r = 0;
+
+  cam = DEVICE->device_data;
+
+  if (bytesgrabbed != NULL)
+    *bytesgrabbed = 0;
+
+  width = (size_t) (cam->image_area.lr.x - cam->image_area.ul.x);
+  rowsize = width * ((cam->bitdepth == FLI_MODE_8BIT) ? 1 : 2);
+  rows = cam->image_area.lr.y - cam->image_area.ul.y;
+
+  if ((buff == NULL) || (rowsize == 0) || (buffsize < rowsize))
+    return -EINVAL;
+
+  if ((size_t) rows > buffsize / rowsize)
+    rows = (long) (buffsize / rowsize);
+
+  for (row = 0; row < rows; row++)
+  {
+    if ((r = grab_row(dev, (char *) buff + row * rowsize, width)))
+      break;
+  }
+
+  if (bytesgrabbed != NULL)
+    *bytesgrabbed = row * rowsize;
+
+  return r;
+}
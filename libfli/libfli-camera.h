@@ -167,5 +167,8 @@ extern const fliccdinfo_t knowndev[];
 long fli_camera_open(flidev_t dev);
 long fli_camera_close(flidev_t dev);
 long fli_camera_command(flidev_t dev, int cmd, int argc, ...);
+long fli_camera_grab_frame_rows(flidev_t dev,
+				long (*grab_row)(flidev_t dev, void *buff, size_t width),
+				void *buff, size_t buffsize, size_t *bytesgrabbed);
 
 #endif /* _LIBFLI_CAMERA_H_ */
@@ -224,10 +224,41 @@ LIBFLIAPI FLIUsbBulkIO(flidev_t dev, int ep, void *buf, long *len)
 	return usb_bulktransfer(dev, ep, buf, len);
 }
 
+/**
+   Grab a whole image.  This function downloads the rows of the image
+   from camera \texttt{dev} that have not been grabbed yet and places
+   them one after the other in the buffer pointed to by
+   \texttt{buff}.  As many whole rows as fit in \texttt{buffsize}
+   bytes are grabbed.  Pixels are 16-bit, except for 8-bit images on
+   parallel port cameras.
+
+   On USB MaxCam and IMG cameras the next batch of rows is requested
+   while the previous one is converted into \texttt{buff}, which makes
+   this much faster than calling FLIGrabRow for each row.  Other
+   cameras grab the rows one at a time.
+
+   @param dev Camera whose image to grab.
+
+   @param buff Pointer to where the image will be placed.
+
+   @param buffsize Size of the buffer pointed to by \texttt{buff} in
+   bytes.
+
+   @param bytesgrabbed Pointer to where the number of bytes placed in
+   \texttt{buff} will be stored, may be NULL.
+
+   @return Zero on success.
+   @return Non-zero on failure.
+
+   @see FLIGrabRow
+   @see FLIExposeFrame
+*/
 LIBFLIAPI FLIGrabFrame(flidev_t dev, void* buff,
 		       size_t buffsize, size_t* bytesgrabbed)
 {
-	return -EINVAL;
+  CHKDEVICE(dev);
+
+  return DEVICE->fli_command(dev, FLI_GRAB_FRAME, 3, buff, &buffsize, bytesgrabbed);
 }
 
 /**
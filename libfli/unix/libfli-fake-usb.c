@@ -0,0 +1,325 @@
+/*
+
+  Copyright (c) 2002 Finger Lakes Instrumentation (FLI), L.L.C.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+        Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above
+        copyright notice, this list of conditions and the following
+        disclaimer in the documentation and/or other materials
+        provided with the distribution.
+
+        Neither the name of Finger Lakes Instrumentation (FLI), LLC
+        nor the names of its contributors may be used to endorse or
+        promote products derived from this software without specific
+        prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+  ======================================================================
+
+  Finger Lakes Instrumentation, L.L.C. (FLI)
+  web: http://www.fli-cam.com
+  email: support@fli-cam.com
+
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+
+#include "libfli-libfli.h"
+#include "libfli-debug.h"
+#include "libfli-mem.h"
+#include "libfli-sys.h"
+#include "libfli-camera-usb.h"
+#include "libfli-fake-usb.h"
+
+typedef struct {
+  long width;			/* Array size */
+  long height;
+  long hwrev;
+  long serno;
+  double rate;			/* Bytes per second, 0 for no delay */
+  double busy;			/* Time the last transfer is done */
+  unsigned short *frame;	/* Big endian, as the camera sends it */
+
+  unsigned short cmd;		/* Last command, for the reply */
+  long xoffset;
+  long row;			/* Rows read out since the exposure started */
+  long sendwidth;		/* Rows asked for with FLI_USBCAM_SENDROW */
+  long sendrows;
+  long sendpos;			/* Pixels of them read so far */
+} fli_fakeusb_t;
+
+static double fake_usb_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Holds a transfer of len bytes back until the bus would be done with it */
+static void fake_usb_transfer(fli_fakeusb_t *fake, long len)
+{
+  double now, wait;
+  struct timespec ts;
+
+  if (fake->rate <= 0)
+    return;
+
+  now = fake_usb_now();
+  if (fake->busy < now)
+    fake->busy = now;
+  fake->busy += len / fake->rate;
+
+  if ((wait = fake->busy - now) > 0)
+  {
+    ts.tv_sec = (time_t) wait;
+    ts.tv_nsec = (long) ((wait - ts.tv_sec) * 1e9);
+    while ((nanosleep(&ts, &ts) == -1) && (errno == EINTR))
+      ;
+  }
+}
+
+/* Float the way the parameter block stores it, for dconvert() */
+static void fake_usb_write_float(unsigned char *b, double value)
+{
+  float f = (float) value;
+  unsigned int u;
+
+  memcpy(&u, &f, sizeof(u));
+  b[0] = u & 0xff;
+  b[1] = (u >> 8) & 0xff;
+  b[2] = (u >> 16) & 0xff;
+  b[3] = (u >> 24) & 0xff;
+}
+
+static void fake_usb_read_rows(fli_fakeusb_t *fake, unsigned short *buf,
+			       long n)
+{
+  while (n > 0)
+  {
+    long r = (fake->row + fake->sendpos / fake->sendwidth) % fake->height;
+    long c = fake->sendpos % fake->sendwidth;
+    long len = MIN(n, fake->sendwidth - c);
+    long avail = MIN(len, fake->width - (fake->xoffset + c));
+
+    if (avail < 0)
+      avail = 0;
+
+    memcpy(buf, fake->frame + r * fake->width + fake->xoffset + c,
+	   avail * sizeof(unsigned short));
+    memset(buf + avail, 0x00, (len - avail) * sizeof(unsigned short));
+
+    buf += len;
+    n -= len;
+    fake->sendpos += len;
+  }
+
+  if (fake->sendpos >= fake->sendwidth * fake->sendrows)
+  {
+    fake->row += fake->sendrows;
+    fake->sendrows = 0;
+    fake->sendpos = 0;
+  }
+}
+
+static void fake_usb_reply(flidev_t dev, fli_fakeusb_t *fake,
+			   iobuf_t *buf, long rlen)
+{
+  memset(buf, 0x00, rlen);
+
+  switch (fake->cmd)
+  {
+  case FLI_USBCAM_HARDWAREREV:
+    if (rlen >= 2)
+      IOWRITE_U16(buf, 0, fake->hwrev);
+    break;
+
+  case FLI_USBCAM_SERIALNUM:
+    if (rlen >= 2)
+      IOWRITE_U16(buf, 0, fake->serno);
+    break;
+
+  case FLI_USBCAM_READPARAMBLOCK:
+    if (rlen >= 39)
+    {
+      fake_usb_write_float(buf + 23, 1.0);	/* tempslope */
+      fake_usb_write_float(buf + 27, 0.0);	/* tempintercept */
+      fake_usb_write_float(buf + 31, 9.0);	/* pixel width */
+      fake_usb_write_float(buf + 35, 9.0);	/* pixel height */
+    }
+    break;
+
+  case FLI_USBCAM_DEVICENAME:
+    strncpy((char *) buf, "Fake MaxCam", rlen - 1);
+    break;
+
+  case FLI_USBCAM_ARRAYSIZE:
+  case FLI_USBCAM_IMAGESIZE:
+    if (rlen >= 4)
+    {
+      IOWRITE_U16(buf, 0, fake->width);
+      IOWRITE_U16(buf, 2, fake->height);
+    }
+    break;
+
+  default:
+    /* Zero image offset, exposure done, and so on */
+    break;
+  }
+}
+
+int unix_fake_usb_name(const char *name)
+{
+  return (name != NULL) &&
+    (strncmp(name, FAKE_USB_PREFIX, strlen(FAKE_USB_PREFIX)) == 0);
+}
+
+unsigned short unix_fake_usb_pixel(long row, long col)
+{
+  return (unsigned short) ((row * 40503UL) ^ ((col * 2654435761UL) >> 13));
+}
+
+long unix_fake_usb_connect(flidev_t dev, fli_unixio_t *io, char *name)
+{
+  fli_fakeusb_t *fake;
+  long width = 0, height = 0, hwrev = 0x0200, r, c;
+  double rate = 0;
+
+  if (DEVICE->devinfo.type != FLIDEVICE_CAMERA)
+    return -ENODEV;
+
+  if ((sscanf(name + strlen(FAKE_USB_PREFIX), "%ldx%ld:%lf:%li",
+	      &width, &height, &rate, &hwrev) < 2) ||
+      (width < 1) || (width > 65535) || (height < 1) || (height > 65535))
+  {
+    debug(FLIDEBUG_FAIL, "Bad fake camera name <%s>", name);
+    return -EINVAL;
+  }
+
+  if ((fake = xcalloc(1, sizeof(fli_fakeusb_t))) == NULL)
+    return -ENOMEM;
+
+  if ((fake->frame = xmalloc(width * height * sizeof(unsigned short))) == NULL)
+  {
+    xfree(fake);
+    return -ENOMEM;
+  }
+
+  for (r = 0; r < height; r++)
+    for (c = 0; c < width; c++)
+      fake->frame[r * width + c] = htons(unix_fake_usb_pixel(r, c));
+
+  fake->width = width;
+  fake->height = height;
+  fake->hwrev = hwrev;
+  fake->serno = dev + 1;
+  fake->rate = rate * 1e6;
+
+  io->han = fake;
+  DEVICE->devinfo.devid = FLIUSB_CAM_ID;
+  DEVICE->devinfo.fwrev = 0x0201;
+  DEVICE->devinfo.serial = xstrdup(name);
+
+  debug(FLIDEBUG_INFO, "Fake camera %ldx%ld at %g MB/s", width, height, rate);
+
+  return 0;
+}
+
+long unix_fake_usb_disconnect(flidev_t dev, fli_unixio_t *io)
+{
+  fli_fakeusb_t *fake = io->han;
+
+  if (fake != NULL)
+  {
+    xfree(fake->frame);
+    xfree(fake);
+  }
+  io->han = NULL;
+
+  return 0;
+}
+
+long unix_fake_usbio(flidev_t dev, void *buf, long *wlen, long *rlen)
+{
+  fli_fakeusb_t *fake = ((fli_unixio_t *) DEVICE->io_data)->han;
+  iobuf_t *b = buf;
+
+  if (fake == NULL)
+    return -ENODEV;
+
+  if (*wlen >= 2)
+  {
+    IOREAD_U16(b, 0, fake->cmd);
+
+    switch (fake->cmd)
+    {
+    case FLI_USBCAM_SETFRAMEOFFSET:
+      if (*wlen >= 4)
+	IOREAD_U16(b, 2, fake->xoffset);
+      break;
+
+    case FLI_USBCAM_STARTEXPOSURE:
+      fake->row = 0;
+      fake->sendrows = 0;
+      fake->sendpos = 0;
+      break;
+
+    case FLI_USBCAM_SENDROW:
+      if (*wlen < 6)
+	return -EINVAL;
+      IOREAD_U16(b, 2, fake->sendwidth);
+      IOREAD_U16(b, 4, fake->sendrows);
+      fake->sendpos = 0;
+      if (fake->sendwidth == 0)
+	fake->sendrows = 0;
+      break;
+
+    default:
+      break;
+    }
+
+    fake_usb_transfer(fake, *wlen);
+  }
+
+  if (*rlen > 0)
+  {
+    if (fake->sendrows > 0)
+    {
+      long left = (fake->sendwidth * fake->sendrows - fake->sendpos) * 2;
+
+      if (*rlen > left)
+	*rlen = left;
+      fake_usb_read_rows(fake, buf, *rlen / 2);
+    }
+    else
+      fake_usb_reply(dev, fake, b, *rlen);
+
+    fake_usb_transfer(fake, *rlen);
+  }
+
+  return 0;
+}
@@ -0,0 +1,66 @@
+/*
+
+  Copyright (c) 2002 Finger Lakes Instrumentation (FLI), L.L.C.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+        Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+
+        Redistributions in binary form must reproduce the above
+        copyright notice, this list of conditions and the following
+        disclaimer in the documentation and/or other materials
+        provided with the distribution.
+
+        Neither the name of Finger Lakes Instrumentation (FLI), LLC
+        nor the names of its contributors may be used to endorse or
+        promote products derived from this software without specific
+        prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+  ======================================================================
+
+  Finger Lakes Instrumentation, L.L.C. (FLI)
+  web: http://www.fli-cam.com
+  email: support@fli-cam.com
+
+*/
+
+#ifndef _LIBFLI_FAKE_USB_H_
+#define _LIBFLI_FAKE_USB_H_
+
+/* Stand-in for a USB MaxCam, for download tests without a camera. Only
+   built into programs compiled with FLI_FAKE_USB. Opening a USB camera
+   named
+
+     fakeusb:<width>x<height>[:<MB/s>[:<hardware revision>]]
+
+   connects to it instead of the USB bus. Rows go out at the given rate,
+   or as fast as they can be copied when it is 0 or missing. */
+
+#define FAKE_USB_PREFIX "fakeusb:"
+
+int unix_fake_usb_name(const char *name);
+long unix_fake_usb_connect(flidev_t dev, fli_unixio_t *io, char *name);
+long unix_fake_usb_disconnect(flidev_t dev, fli_unixio_t *io);
+long unix_fake_usbio(flidev_t dev, void *buf, long *wlen, long *rlen);
+
+/* Pixel the fake camera reads out at row, col of its array */
+unsigned short unix_fake_usb_pixel(long row, long col);
+
+#endif /* _LIBFLI_FAKE_USB_H_ */
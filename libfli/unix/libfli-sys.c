@@ -64,6 +64,9 @@
 #include "libfli-parport.h"
 #include "libfli-usb.h"
 #include "libfli-serial.h"
+#ifdef FLI_FAKE_USB
+#include "libfli-fake-usb.h"
+#endif
 
 static long unix_fli_list_parport(flidomain_t domain, char ***names);
 static long unix_fli_list_usb(flidomain_t domain, char ***names);
@@ -141,6 +144,17 @@ long unix_fli_connect(flidev_t dev, char *name, long domain)
     {
       int r;
 
+#ifdef FLI_FAKE_USB
+      if (unix_fake_usb_name(name))
+      {
+        if ((r = unix_fake_usb_connect(dev, io, name)))
+        {
+          xfree(io);
+          return r;
+        }
+      }
+      else
+#endif
       if ((r = unix_usb_connect(dev, io, name)))
       {
 				unix_usb_disconnect(dev,io);
@@ -188,6 +202,10 @@ long unix_fli_connect(flidev_t dev, char *name, long domain)
       }
       
       DEVICE->fli_io = unix_usbio;
+#ifdef FLI_FAKE_USB
+      if (unix_fake_usb_name(name))
+        DEVICE->fli_io = unix_fake_usbio;
+#endif
     }
     break;
 
@@ -258,6 +276,11 @@ long unix_fli_disconnect(flidev_t dev)
   switch (DEVICE->domain)
   {
   case FLIDOMAIN_USB:
+#ifdef FLI_FAKE_USB
+    if (DEVICE->fli_io == unix_fake_usbio)
+      err = unix_fake_usb_disconnect(dev, io);
+    else
+#endif
     err = unix_usb_disconnect(dev,io);
     break;
 